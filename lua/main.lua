@@ -7,7 +7,11 @@ function init()
     print("Lua init called!")
     -- TODO: Initialize game state
     -- TODO: Register sprites
-    -- TODO: Load initial map
+
+    -- The demo room is created by the engine; edit it in bulk, e.g.
+    --   engine.tile_paste(1, 2, 2, { "#.#", "..." }, { ["#"] = { glyph = "#", material = id, height = 1.0 } })
+    local width, height, layers = engine.tilemap_size()
+    print(string.format("Tilemap: %dx%d, %d layers", width, height, layers))
 end
 
 function update(dt)
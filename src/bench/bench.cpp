@@ -0,0 +1,67 @@
+#include "bench.hpp"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <cstdlib>
+#include <exception>
+#include <memory>
+
+namespace ascii::bench {
+
+namespace {
+
+struct BenchCase {
+    const char* name;
+    void (*fn)();
+    const char* description;
+};
+
+const BenchCase BENCHES[] = {
+    {"instances", instances, "TLAS instance writes from SoA TRS at 1M instances"},
+    {"scene_binary", scene_binary, "Mapped binary scene load vs the scene.json path"},
+    {"snapshot", snapshot, "Copy-on-write play-mode snapshot enter/exit at 1M entities"},
+    {"state_file", state_file, "Binary engine state save/load, raw and LZ-compressed, up to 1M entities"},
+    {"pathfinding", pathfinding, "Dijkstra maps, flow fields and batched A* on a 256x256 dungeon"},
+    {"coroutines", coroutines, "10k sleeping Lua behaviors: timer wheel scheduler vs resuming all every frame"},
+    {"lua_workers", lua_workers, "AI-heavy Lua system on 1..N parallel worker states, with a determinism check"},
+    {"lua_math", lua_math, "Vector-heavy Lua loop on table vectors vs native vec3 userdata, pooled and not"},
+};
+
+} // anonymous namespace
+
+int run(const std::string& name) {
+    // Log to both console and bench_output.txt
+    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>("bench_output.txt");
+    auto logger = std::make_shared<spdlog::logger>("bench", spdlog::sinks_init_list{console_sink, file_sink});
+    logger->set_pattern("[%H:%M:%S.%e] %v");
+    spdlog::set_default_logger(logger);
+
+    bool found = false;
+    for (const auto& bench : BENCHES) {
+        if (name != "all" && name != bench.name) {
+            continue;
+        }
+        found = true;
+        spdlog::info("=== {} - {} ===", bench.name, bench.description);
+        try {
+            bench.fn();
+        } catch (const std::exception& e) {
+            spdlog::error("Benchmark {} failed: {}", bench.name, e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!found) {
+        spdlog::error("Unknown benchmark: {}", name);
+        for (const auto& bench : BENCHES) {
+            spdlog::info("  {} - {}", bench.name, bench.description);
+        }
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace ascii::bench
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+namespace ascii::bench {
+
+// Offline benchmarks, run with --bench <name> (or "all").
+// They don't open a window or touch Vulkan, so they run on any machine.
+// Results are logged and appended to bench_output.txt.
+int run(const std::string& name);
+
+// Individual benchmarks
+void instances();
+void scene_binary();
+void snapshot();
+void state_file();
+void pathfinding();
+void coroutines();
+void lua_workers();
+void lua_math();
+
+} // namespace ascii::bench
@@ -0,0 +1,148 @@
+#include "bench.hpp"
+#include "core/stopwatch.hpp"
+#include "core/timer_wheel.hpp"
+#include "scripting/coroutine_scheduler.hpp"
+#include "scripting/engine_api.hpp"
+#include "scripting/lua_runtime.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <random>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr int BEHAVIORS = 10000;
+constexpr int FRAMES = 600;
+constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+// The same NPC loop twice: sleeping 0.5-3 s between bits of work, either
+// through the scheduler or by checking the clock every frame
+constexpr const char* BEHAVIORS_LUA = R"(
+work = 0
+now = 0
+
+function sleeper(seed)
+    while true do
+        engine.wait(0.5 + (seed % 250) / 100)
+        work = work + 1
+    end
+end
+
+function poller(seed)
+    while true do
+        local due = now + 0.5 + (seed % 250) / 100
+        while now < due do
+            coroutine.yield()
+        end
+        work = work + 1
+    end
+end
+)";
+
+struct Result {
+    double ms = 0.0;
+    double resumes = 0.0;
+    double deferred = 0.0;
+    int64_t work = 0;
+};
+
+Result run_scheduled(uint32_t budget) {
+    LuaRuntime lua;
+    CoroutineScheduler scheduler(lua);
+    bind_scheduler(lua, scheduler);
+    lua.state().script(BEHAVIORS_LUA);
+    scheduler.set_budget(budget);
+    sol::protected_function sleeper = lua.state()["sleeper"];
+    for (int i = 0; i < BEHAVIORS; i++) {
+        scheduler.spawn(sleeper, {sol::make_object(lua.state(), i)});
+    }
+    scheduler.update(FRAME_TIME);      // First resumes: everyone starts sleeping
+
+    Result result;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        scheduler.update(FRAME_TIME);
+        result.ms += scheduler.stats().ms;
+        result.resumes += scheduler.stats().resumed;
+        result.deferred += scheduler.stats().deferred;
+    }
+    result.work = lua.state()["work"].get<int64_t>();
+    return result;
+}
+
+Result run_polling() {
+    LuaRuntime lua;
+    lua.state().script(BEHAVIORS_LUA);
+    sol::protected_function poller = lua.state()["poller"];
+    std::vector<sol::thread> threads;
+    std::vector<sol::coroutine> coroutines;
+    for (int i = 0; i < BEHAVIORS; i++) {
+        threads.push_back(sol::thread::create(lua.state().lua_state()));
+        coroutines.emplace_back(threads.back().thread_state(), poller);
+        coroutines.back()(i);
+    }
+
+    Result result;
+    double now = 0.0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        Stopwatch timer;
+        now += FRAME_TIME;
+        lua.state()["now"] = now;
+        for (sol::coroutine& coroutine : coroutines) {
+            coroutine();
+        }
+        result.ms += timer.elapsed_ms();
+        result.resumes += BEHAVIORS;
+    }
+    result.work = lua.state()["work"].get<int64_t>();
+    return result;
+}
+
+void log_result(const char* name, const Result& result) {
+    spdlog::info("{:<24} | {:>9.3f} | {:>10.0f} | {:>9.0f} | {:>8}", name, result.ms / FRAMES,
+                 result.resumes / FRAMES, result.deferred / FRAMES, result.work);
+}
+
+// The wheel alone: a steady population of timers, each rescheduled when it fires
+void wheel_only(size_t timers) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> delay(0.5, 3.0);
+    TimerWheel wheel;
+    Stopwatch timer;
+    for (size_t i = 0; i < timers; i++) {
+        wheel.schedule(delay(rng), static_cast<uint32_t>(i));
+    }
+    const double schedule_ms = timer.elapsed_ms();
+
+    std::vector<uint32_t> fired;
+    size_t total = 0;
+    timer.reset();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        fired.clear();
+        wheel.advance(FRAME_TIME, fired);
+        for (uint32_t payload : fired) {
+            wheel.schedule(delay(rng), payload);
+        }
+        total += fired.size();
+    }
+    const double advance_ms = timer.elapsed_ms();
+    spdlog::info("wheel {:>7} timers: schedule {:.1f} ns each, {:.3f} ms/frame advancing ({:.0f} fired/frame)",
+                 timers, schedule_ms * 1.0e6 / timers, advance_ms / FRAMES, double(total) / FRAMES);
+}
+
+} // anonymous namespace
+
+void coroutines() {
+    spdlog::info("{} behaviors sleeping 0.5-3 s, {} frames", BEHAVIORS, FRAMES);
+    spdlog::info("{:<24} | {:>9} | {:>10} | {:>9} | {:>8}", "", "ms/frame", "resumes", "deferred", "work");
+    log_result("resume all, poll clock", run_polling());
+    log_result("timer wheel", run_scheduled(CoroutineScheduler::DEFAULT_BUDGET));
+    log_result("timer wheel, budget 128", run_scheduled(128));
+    for (size_t timers : {size_t(10000), size_t(100000)}) {
+        wheel_only(timers);
+    }
+}
+
+} // namespace ascii::bench
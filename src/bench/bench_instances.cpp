@@ -0,0 +1,140 @@
+#include "bench.hpp"
+#include "core/stopwatch.hpp"
+#include "renderer/instance_store.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+// The per-instance record build_tlas used to take: a full matrix plus fields
+struct MatrixInstance {
+    glm::mat4 transform;
+    uint32_t custom_index;
+    uint32_t mask;
+    uint32_t sbt_offset;
+    VkGeometryInstanceFlagsKHR flags;
+    uint32_t blas_index;
+};
+
+// Old path: transpose + memcpy each matrix into a temporary vector, then copy
+// the vector into the destination (what Buffer::upload did)
+void write_matrix_instances(const std::vector<MatrixInstance>& instances,
+                            const VkDeviceAddress* blas_addresses,
+                            VkAccelerationStructureInstanceKHR* dst) {
+    std::vector<VkAccelerationStructureInstanceKHR> vk_instances;
+    vk_instances.reserve(instances.size());
+    for (const auto& inst : instances) {
+        VkAccelerationStructureInstanceKHR vk_inst{};
+        glm::mat4 transposed = glm::transpose(inst.transform);
+        std::memcpy(&vk_inst.transform, &transposed, sizeof(VkTransformMatrixKHR));
+        vk_inst.instanceCustomIndex = inst.custom_index;
+        vk_inst.mask = inst.mask;
+        vk_inst.instanceShaderBindingTableRecordOffset = inst.sbt_offset;
+        vk_inst.flags = inst.flags;
+        vk_inst.accelerationStructureReference = blas_addresses[inst.blas_index];
+        vk_instances.push_back(vk_inst);
+    }
+    std::memcpy(dst, vk_instances.data(), vk_instances.size() * sizeof(VkAccelerationStructureInstanceKHR));
+}
+
+} // anonymous namespace
+
+void instances() {
+    constexpr uint32_t count = 1000000;
+    constexpr int iterations = 10;
+    const VkDeviceAddress blas_addresses[4] = {0x10000, 0x20000, 0x30000, 0x40000};
+
+    InstanceStore store;
+    store.reserve(count);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coord(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+    for (uint32_t i = 0; i < count; i++) {
+        glm::quat rotation(unit(rng), unit(rng), unit(rng), unit(rng));
+        float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y +
+                                 rotation.z * rotation.z + rotation.w * rotation.w);
+        length = std::max(length, 1.0e-6f);
+        rotation = glm::quat(rotation.w / length, rotation.x / length, rotation.y / length, rotation.z / length);
+        store.add(glm::vec3(coord(rng), coord(rng), coord(rng)), rotation,
+                  glm::vec3(size(rng), size(rng), size(rng)), i % 4, i & 0xFFFFFFu);
+    }
+
+    // Pre-touched destinations stand in for the mapped instance buffer
+    std::vector<VkAccelerationStructureInstanceKHR> scalar_out(count);
+    std::vector<VkAccelerationStructureInstanceKHR> simd_out(count);
+
+    // Same instances as full matrices, for the old path
+    store.write_tlas_instances(blas_addresses, scalar_out.data(), false);
+    std::vector<MatrixInstance> matrices(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const auto& m = scalar_out[i].transform.matrix;
+        glm::mat4 transform(1.0f);
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 4; col++) {
+                transform[col][row] = m[row][col];
+            }
+        }
+        matrices[i] = {transform, store.custom_index(i), 0xFF, 0, InstanceStore::DEFAULT_FLAGS, store.blas_index(i)};
+    }
+    std::vector<VkAccelerationStructureInstanceKHR> matrix_out(count);
+
+    auto report = [&](const char* label, double ms, size_t bytes_per_instance) {
+        spdlog::info("{:<24} {:>8.2f} ms  {:>7.1f} M instances/s  {:>3} B/instance",
+                     label, ms, count / (ms * 1000.0), bytes_per_instance);
+    };
+
+    Stopwatch timer;
+    for (int i = 0; i < iterations; i++) {
+        write_matrix_instances(matrices, blas_addresses, matrix_out.data());
+    }
+    report("mat4 + transpose + copy", timer.elapsed_ms() / iterations, sizeof(MatrixInstance));
+
+    // SoA footprint: 10 floats of TRS + blas, custom index, sbt offset, mask, flags
+    constexpr size_t soa_bytes = 10 * sizeof(float) + 3 * sizeof(uint32_t) + 2;
+
+    timer.reset();
+    for (int i = 0; i < iterations; i++) {
+        store.write_tlas_instances(blas_addresses, scalar_out.data(), false);
+    }
+    report("SoA TRS scalar", timer.elapsed_ms() / iterations, soa_bytes);
+
+    if (!InstanceStore::simd_available()) {
+        spdlog::info("AVX2 kernel not compiled in (configure with ASCII_ENABLE_AVX2=ON)");
+        return;
+    }
+
+    timer.reset();
+    for (int i = 0; i < iterations; i++) {
+        store.write_tlas_instances(blas_addresses, simd_out.data(), true);
+    }
+    report("SoA TRS AVX2", timer.elapsed_ms() / iterations, soa_bytes);
+
+    // The two SoA paths must agree
+    float max_error = 0.0f;
+    bool fields_match = true;
+    for (uint32_t i = 0; i < count; i++) {
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 4; col++) {
+                max_error = std::max(max_error, std::abs(simd_out[i].transform.matrix[row][col] -
+                                                         scalar_out[i].transform.matrix[row][col]));
+            }
+        }
+        fields_match = fields_match &&
+            std::memcmp(reinterpret_cast<const char*>(&simd_out[i]) + sizeof(VkTransformMatrixKHR),
+                        reinterpret_cast<const char*>(&scalar_out[i]) + sizeof(VkTransformMatrixKHR),
+                        sizeof(VkAccelerationStructureInstanceKHR) - sizeof(VkTransformMatrixKHR)) == 0;
+    }
+    spdlog::info("AVX2 vs scalar: max transform error {:.2e}, instance fields {}",
+                 max_error, fields_match ? "match" : "DIFFER");
+}
+
+} // namespace ascii::bench
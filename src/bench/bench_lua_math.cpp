@@ -0,0 +1,141 @@
+#include "bench.hpp"
+#include "core/stopwatch.hpp"
+#include "scripting/engine_api.hpp"
+#include "scripting/lua_runtime.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cmath>
+#include <string>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr int BODIES = 10000;
+constexpr int FRAMES = 120;
+constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+// Bodies steering toward a target. step() is written once against
+// operators and :length(), so it runs on the table vectors below (what
+// lua/engine/vec.lua would be) or on the native vec3; step_in_place() uses
+// the native in-place methods and a scratch vector.
+constexpr const char* BODIES_LUA = R"(
+local V = {}
+V.__index = V
+local function tvec3(x, y, z) return setmetatable({ x = x or 0, y = y or 0, z = z or 0 }, V) end
+V.__add = function(a, b) return tvec3(a.x + b.x, a.y + b.y, a.z + b.z) end
+V.__sub = function(a, b) return tvec3(a.x - b.x, a.y - b.y, a.z - b.z) end
+V.__mul = function(a, s) return tvec3(a.x * s, a.y * s, a.z * s) end
+function V:length() return math.sqrt(self.x * self.x + self.y * self.y + self.z * self.z) end
+table_vec3 = tvec3
+
+function setup(new)
+    bodies = {}
+    for i = 1, BODIES do
+        bodies[i] = { pos = new(i % 100, (i * 7) % 100, (i * 13) % 10), vel = new(0, 0, 0) }
+    end
+    target = new(50, 50, 5)
+end
+
+function step(dt)
+    for i = 1, #bodies do
+        local b = bodies[i]
+        local to = target - b.pos
+        local d = to:length()
+        if d > 0 then b.vel = b.vel + to * (4 * dt / d) end
+        b.vel = b.vel * 0.99
+        b.pos = b.pos + b.vel * dt
+    end
+end
+
+local to
+function step_in_place(dt)
+    to = to or vec3()
+    for i = 1, #bodies do
+        local b = bodies[i]
+        to:set(target)
+        to:sub(b.pos)
+        local d = to:length()
+        if d > 0 then
+            to:scale(4 * dt / d)
+            b.vel:add(to)
+        end
+        b.vel:scale(0.99)
+        to:set(b.vel)
+        to:scale(dt)
+        b.pos:add(to)
+    end
+end
+
+function checksum()
+    local sum = 0
+    for i = 1, #bodies do sum = sum + bodies[i].pos.x + bodies[i].pos.y + bodies[i].pos.z end
+    return sum
+end
+)";
+
+struct Result {
+    double ms = 0.0;
+    double allocations = -1.0;                 // Per frame; negative: not counted
+    double checksum = 0.0;
+};
+
+Result run(sol::state& state, const LuaAllocator* allocator, const char* constructor, const char* step_name) {
+    state["BODIES"] = BODIES;
+    state.script(BODIES_LUA);
+    sol::protected_function setup = state["setup"];
+    sol::protected_function step = state[step_name];
+    const sol::object new_vector = state[constructor];
+    setup(new_vector);
+    state.collect_garbage();
+
+    Result result;
+    const uint64_t allocations = allocator ? allocator->allocations() : 0;
+    Stopwatch timer;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        step(FRAME_TIME);
+    }
+    result.ms = timer.elapsed_ms() / FRAMES;
+    if (allocator) {
+        result.allocations = double(allocator->allocations() - allocations) / FRAMES;
+    }
+    sol::protected_function checksum = state["checksum"];
+    result.checksum = checksum().get<double>();
+    return result;
+}
+
+// Same run on a plain state: the system allocator instead of the pool
+Result run_unpooled() {
+    sol::state state;
+    state.open_libraries(sol::lib::base, sol::lib::math);
+    return run(state, nullptr, "table_vec3", "step");
+}
+
+Result run_pooled(const char* constructor, const char* step_name) {
+    LuaRuntime lua;
+    bind_math(lua);
+    return run(lua.state(), &lua.allocator(), constructor, step_name);
+}
+
+} // anonymous namespace
+
+void lua_math() {
+    spdlog::info("{} bodies steering, {} frames", BODIES, FRAMES);
+    spdlog::info("{:<28} | {:>9} | {:>12} | {:>14}", "", "ms/frame", "allocs/frame", "checksum");
+
+    const Result tables = run_unpooled();
+    auto log_result = [&](const char* name, const Result& result) {
+        // float userdata vs double tables: the sums agree to a few digits
+        const bool match = std::abs(result.checksum - tables.checksum) <= 1.0e-3 * std::abs(tables.checksum);
+        spdlog::info("{:<28} | {:>9.3f} | {:>12} | {:>14.3f}{}", name, result.ms,
+                     result.allocations < 0.0 ? std::string("-") : fmt::format("{:.0f}", result.allocations),
+                     result.checksum, match ? "" : " MISMATCH");
+    };
+    log_result("tables, system allocator", tables);
+    log_result("tables, pooled", run_pooled("table_vec3", "step"));
+    log_result("vec3 userdata", run_pooled("vec3", "step"));
+    log_result("vec3 userdata, in place", run_pooled("vec3", "step_in_place"));
+}
+
+} // namespace ascii::bench
@@ -0,0 +1,129 @@
+#include "bench.hpp"
+#include "core/job_system.hpp"
+#include "ecs/schema.hpp"
+#include "scene/scene_world.hpp"
+#include "scene/transform_hierarchy.hpp"
+#include "scripting/lua_runtime.hpp"
+#include "scripting/lua_workers.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr size_t AGENTS = 20000;
+constexpr int FRAMES = 30;
+constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+// AI-heavy system: every agent picks its nearest goal, then the best of 16
+// headings toward it that keeps clear of the obstacles
+constexpr const char* AGENTS_LUA = R"(
+local goals, obstacles = {}, {}
+for i = 1, 16 do goals[i] = { (i * 37) % 100, (i * 61) % 100 } end
+for i = 1, 32 do obstacles[i] = { (i * 53) % 100, (i * 29) % 100 } end
+
+engine.system("steer", function(dt, entities)
+    for _, e in ipairs(entities) do
+        local x, y, z = engine.position(e)
+        local speed = engine.get(e, "Agent", "speed")
+        local gx, gy, nearest = 0, 0, math.huge
+        for _, g in ipairs(goals) do
+            local d = (g[1] - x) ^ 2 + (g[2] - y) ^ 2
+            if d < nearest then nearest, gx, gy = d, g[1], g[2] end
+        end
+        local bx, by, best = x, y, -math.huge
+        for k = 0, 15 do
+            local a = k * math.pi / 8
+            local nx, ny = x + math.cos(a) * speed * dt, y + math.sin(a) * speed * dt
+            local score = -((gx - nx) ^ 2 + (gy - ny) ^ 2)
+            for _, o in ipairs(obstacles) do
+                local d = (o[1] - nx) ^ 2 + (o[2] - ny) ^ 2
+                if d < 4 then score = score - (4 - d) * 10 end
+            end
+            if score > best then best, bx, by = score, nx, ny end
+        end
+        engine.set_position(e, bx, by, z)
+        engine.set(e, "Agent", "energy", engine.get(e, "Agent", "energy") - dt)
+    end
+end, "Agent")
+)";
+
+std::vector<SchemaFieldDesc> agent_fields() {
+    std::vector<SchemaFieldDesc> fields(2);
+    fields[0].name = "speed";
+    fields[0].type = SchemaFieldType::Float;
+    fields[0].defaults[0] = 2.0;
+    fields[1].name = "energy";
+    fields[1].type = SchemaFieldType::Float;
+    fields[1].defaults[0] = 100.0;
+    return fields;
+}
+
+// FNV-1a over every agent's position and energy
+uint64_t state_hash(const World& world, const SchemaStore& agents) {
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t row = 0; row < agents.size(); row++) {
+        const LocalTransform* local = world.get<const LocalTransform>(agents.entities()[row]);
+        const float values[] = {local->position.x, local->position.y, float(agents.get(uint32_t(row), 1))};
+        uint32_t bits[3];
+        std::memcpy(bits, values, sizeof(bits));
+        for (uint32_t b : bits) {
+            hash = (hash ^ b) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
+void lua_workers() {
+    const std::string path = "bench_workers.lua";
+    std::ofstream(path) << AGENTS_LUA;
+
+    JobSystem jobs;
+    spdlog::info("{} agents, {} frames, {} job threads", AGENTS, FRAMES, jobs.thread_count());
+    spdlog::info("{:>8} | {:>10} | {:>10} | {:>8} | {:>8}", "workers", "run ms", "merge ms", "speedup", "match");
+
+    double single_ms = 0.0;
+    uint64_t single_hash = 0;
+    for (unsigned count : {1u, 2u, 4u, jobs.thread_count()}) {
+        World world;
+        SchemaRegistry schemas;
+        SchemaStore& agents = schemas.define("Agent", agent_fields());
+        for (size_t i = 0; i < AGENTS; i++) {
+            const LocalTransform local{{float(i % 100), float(i / 100 % 100), 0.0f}, {}, {1.0f, 1.0f, 1.0f}};
+            agents.add(world.spawn(Parent{}, local, WorldTransform{}));
+        }
+        TransformHierarchy transforms;
+        transforms.rebuild(world);
+
+        LuaRuntime lua;
+        LuaWorkers workers(lua, jobs);
+        if (!workers.start(path, count)) {
+            break;
+        }
+        double run_ms = 0.0;
+        double merge_ms = 0.0;
+        for (int frame = 0; frame < FRAMES; frame++) {
+            workers.update(FRAME_TIME, world, schemas, transforms);
+            run_ms += workers.run_ms();
+            merge_ms += workers.merge_ms();
+        }
+        const uint64_t hash = state_hash(world, agents);
+        if (count == 1) {
+            single_ms = run_ms + merge_ms;
+            single_hash = hash;
+        }
+        spdlog::info("{:>8} | {:>10.3f} | {:>10.3f} | {:>7.2f}x | {:>8}", count, run_ms / FRAMES, merge_ms / FRAMES,
+                     single_ms / (run_ms + merge_ms), hash == single_hash ? "yes" : "NO");
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace ascii::bench
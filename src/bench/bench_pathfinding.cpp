@@ -0,0 +1,176 @@
+#include "bench.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "world/pathfinding.hpp"
+#include "world/tilemap.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr int MAP_SIZE = 256;
+constexpr int ROOM = 16;
+
+// Rooms of ROOM x ROOM tiles with a door in each wall and some clutter
+void generate_dungeon(Tilemap& map) {
+    std::mt19937 rng(5);
+    map.resize(MAP_SIZE, MAP_SIZE, 2);
+    map.set_layer_base(1, 0.1f);
+    map.fill_rect(0, 0, 0, MAP_SIZE, MAP_SIZE, {'.', 0, 0.1f});
+    const Tile wall{'#', 0, 1.0f};
+    for (int i = 0; i < MAP_SIZE; i += ROOM) {
+        map.fill_rect(1, i, 0, 1, MAP_SIZE, wall);
+        map.fill_rect(1, 0, i, MAP_SIZE, 1, wall);
+    }
+    for (int ry = 0; ry < MAP_SIZE; ry += ROOM) {
+        for (int rx = 0; rx < MAP_SIZE; rx += ROOM) {
+            map.set(1, rx, ry + 1 + static_cast<int>(rng() % (ROOM - 2)), {});
+            map.set(1, rx + 1 + static_cast<int>(rng() % (ROOM - 2)), ry, {});
+            for (int c = 0; c < 6; c++) {
+                map.set(1, rx + 2 + static_cast<int>(rng() % (ROOM - 4)), ry + 2 + static_cast<int>(rng() % (ROOM - 4)), wall);
+            }
+        }
+    }
+}
+
+std::vector<glm::ivec2> open_tiles(const PathGrid& grid, size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<glm::ivec2> tiles;
+    while (tiles.size() < count) {
+        const glm::ivec2 tile(static_cast<int>(rng() % MAP_SIZE), static_cast<int>(rng() % MAP_SIZE));
+        if (!grid.blocked(tile.x, tile.y)) {
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+} // anonymous namespace
+
+void pathfinding() {
+    Tilemap map;
+    generate_dungeon(map);
+    JobSystem jobs;
+    JobSystem inline_jobs(0);
+    Pathfinder pathfinder;
+    PathGrid& grid = pathfinder.grid();
+    grid.sync(map);
+
+    const glm::ivec2 player = open_tiles(grid, 1, 1)[0];
+    spdlog::info("{}x{} dungeon, player at ({}, {}), {} threads", MAP_SIZE, MAP_SIZE, player.x, player.y,
+                 jobs.thread_count());
+
+    // One map toward the player, shared by every monster
+    DijkstraMap& chase = pathfinder.field("player");
+    chase.set_goals({{player.x, player.y}});
+    Stopwatch timer;
+    const size_t settled = chase.update(jobs);
+    spdlog::info("Dijkstra map build: {:.3f} ms ({} tiles settled)", timer.elapsed_ms(), settled);
+
+    // Repairs: a door closing and opening, monsters stepping
+    const glm::ivec2 door = [&]() {
+        for (int y = 1; y < MAP_SIZE; y++) {
+            if (!grid.blocked(ROOM, y)) {
+                return glm::ivec2(ROOM, y);
+            }
+        }
+        throw std::runtime_error("No door in the first room wall");
+    }();
+    for (bool close : {true, false}) {
+        map.set(1, door.x, door.y, close ? Tile{'#', 0, 1.0f} : Tile{});
+        timer.reset();
+        grid.sync(map);
+        const size_t repaired = chase.update(jobs);
+        spdlog::info("Door {}: sync + repair {:.3f} ms ({} tiles settled)",
+                     close ? "closed" : "opened", timer.elapsed_ms(), repaired);
+    }
+
+    for (size_t monsters : {size_t(100), size_t(1000)}) {
+        std::vector<glm::ivec2> positions = open_tiles(grid, monsters, 9);
+        for (const glm::ivec2& at : positions) {
+            grid.add_occupant(at.x, at.y);
+        }
+        chase.update(jobs);
+
+        // Every monster reads its step, then they all move. Occupants steer
+        // the steps only, so the moves leave the shared map valid.
+        timer.reset();
+        size_t moved = 0;
+        std::vector<glm::ivec2> next = positions;
+        for (glm::ivec2& at : next) {
+            if (auto step = chase.next_step(at.x, at.y)) {
+                at = *step;
+                moved++;
+            }
+        }
+        const double step_ms = timer.elapsed_ms();
+        size_t sidestepped = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            const uint32_t distance = chase.distance(positions[i].x, positions[i].y);
+            const uint32_t step = next[i].x != positions[i].x && next[i].y != positions[i].y
+                ? PathGrid::DIAGONAL_COST : PathGrid::STRAIGHT_COST;
+            sidestepped += next[i] != positions[i] && chase.distance(next[i].x, next[i].y) + step != distance;
+        }
+
+        timer.reset();
+        for (size_t i = 0; i < positions.size(); i++) {
+            grid.remove_occupant(positions[i].x, positions[i].y);
+            grid.add_occupant(next[i].x, next[i].y);
+        }
+        const size_t repaired = chase.update(jobs);
+        const double move_ms = timer.elapsed_ms();
+
+        // The same chase done with one A* per monster
+        std::vector<PathRequest> requests;
+        for (const glm::ivec2& at : next) {
+            requests.push_back({at, player});
+        }
+        timer.reset();
+        const auto serial_paths = find_paths(grid, requests, inline_jobs);
+        const double serial_ms = timer.elapsed_ms();
+        timer.reset();
+        const auto paths = find_paths(grid, requests, jobs);
+        const double batch_ms = timer.elapsed_ms();
+        size_t found = 0;
+        for (const auto& path : paths) {
+            found += path.empty() ? 0 : 1;
+        }
+
+        spdlog::info("{:>5} monsters: flow steps {:.3f} ms ({} moved, {} sidestepped), moves + update {:.3f} ms "
+                     "({} settled), A* per monster {:.2f} ms serial / {:.2f} ms batched ({} found)",
+                     monsters, step_ms, moved, sidestepped, move_ms, repaired, serial_ms, batch_ms, found);
+        for (const glm::ivec2& at : next) {
+            grid.remove_occupant(at.x, at.y);
+        }
+    }
+
+    // Unique goals: batched A* fallback
+    for (size_t count : {size_t(100), size_t(1000)}) {
+        const std::vector<glm::ivec2> from = open_tiles(grid, count, 21);
+        const std::vector<glm::ivec2> to = open_tiles(grid, count, 22);
+        std::vector<PathRequest> requests;
+        for (size_t i = 0; i < count; i++) {
+            requests.push_back({from[i], to[i]});
+        }
+        timer.reset();
+        find_paths(grid, requests, inline_jobs);
+        const double serial_ms = timer.elapsed_ms();
+        timer.reset();
+        const auto paths = find_paths(grid, requests, jobs);
+        const double batch_ms = timer.elapsed_ms();
+        size_t length = 0;
+        for (const auto& path : paths) {
+            length += path.size();
+        }
+        spdlog::info("{:>5} unique goals: A* {:.2f} ms serial / {:.2f} ms batched, {:.1f} tiles per path",
+                     count, serial_ms, batch_ms, double(length) / count);
+    }
+}
+
+} // namespace ascii::bench
@@ -0,0 +1,137 @@
+#include "bench.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "scene/scene_json.hpp"
+#include "scene/scene_instantiate.hpp"
+#include "scene/scene_binary.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr size_t NODES_PER_ROOM = 1000;     // Children per room node
+
+const char* const GLYPHS[] = {"#", "@", "T", "~", "A", "+"};
+
+// Editor-style scene.json: rooms under the root, each with NODES_PER_ROOM
+// props. Every prop has a Glyph and a Collider; one in 50 also has a Light.
+std::string generate_scene_json(size_t node_count) {
+    std::string out;
+    out.reserve(node_count * 420);
+    out += R"({"version":"1.0.0","rootNode":{"id":"root","name":"Root","type":"Node","transform":{"position":[0,0,0],"rotation":[0,0,0],"scale":[1,1,1]},"components":[],"children":[)";
+
+    size_t written = 1;
+    for (size_t room = 0; written < node_count; room++) {
+        const size_t room_x = (room % 32) * 40;
+        const size_t room_y = (room / 32) * 40;
+        out += room == 0 ? "" : ",";
+        out += R"({"id":"room-)" + std::to_string(room) + R"(","name":"Room","type":"Node2D","transform":{"position":[)" +
+               std::to_string(room_x) + "," + std::to_string(room_y) +
+               R"(,0],"rotation":[0,0,0],"scale":[1,1,1]},"components":[{"id":"floor-)" + std::to_string(room) +
+               R"(","script":"Terrain","enabled":true,"properties":{"width":32,"height":32,"fillChar":".","palette":"stone"}}],"children":[)";
+        written++;
+
+        for (size_t i = 0; i < NODES_PER_ROOM && written < node_count; i++, written++) {
+            const std::string id = std::to_string(written);
+            out += i == 0 ? "" : ",";
+            out += R"({"id":"n)" + id + R"(","name":"Prop","type":"Node2D","transform":{"position":[)" +
+                   std::to_string(i % 32) + "," + std::to_string((i / 32) % 32) +
+                   R"(,0],"rotation":[0,0,0],"scale":[1,1,1]},"components":[{"id":"g)" + id +
+                   R"(","script":"Glyph","enabled":true,"properties":{"char":")" + GLYPHS[i % 6] +
+                   R"(","fg":"#)" + (i % 2 ? "ff8844" : "88aaff") +
+                   R"(","bg":"transparent","bold":false}},{"id":"c)" + id +
+                   R"(","script":"Collider","enabled":true,"properties":{"blocksMovement":true,"blocksVision":false,"layer":"default"}})";
+            if (i % 50 == 0) {
+                out += R"(,{"id":"l)" + id +
+                       R"(","script":"Light","enabled":true,"properties":{"color":[1,0.7,0.4],"intensity":1.5,"radius":6}})";
+            }
+            out += R"(],"children":[],"meta":{}})";
+        }
+        out += "]}";
+    }
+    out += "]}}";
+    return out;
+}
+
+} // anonymous namespace
+
+void scene_binary() {
+    const size_t node_counts[] = {10000, 100000, 1000000};
+    const std::string json_path = "bench_scene.json";
+    const std::string binary_path = "bench_scene.ascn";
+
+    JobSystem jobs;
+    SceneGeometry geometry;
+
+    spdlog::info("{:>8} {:>9} {:>9} {:>10} {:>11} {:>10} {:>11} {:>10}",
+                 "nodes", "json MB", "ascn MB", "bake ms", "json load", "ascn map", "ascn copy", "speedup");
+
+    for (size_t node_count : node_counts) {
+        {
+            std::ofstream file(json_path, std::ios::binary | std::ios::trunc);
+            file << generate_scene_json(node_count);
+        }
+
+        // Offline conversion (what --convert-scene does)
+        Stopwatch timer;
+        {
+            SceneDocument doc = load_scene_json(json_path);
+            SceneBake bake = bake_scene(doc, jobs);
+            save_scene_binary(binary_path, doc, bake);
+        }
+        const double bake_ms = timer.elapsed_ms();
+
+        // JSON path: read + SAX parse + instantiate
+        double json_ms = 0.0;
+        uint32_t json_instances = 0;
+        {
+            InstanceStore instances;
+            MaterialTable materials;
+            std::vector<Light> lights;
+            Tilemap tilemap;
+            SceneTargets targets{instances, materials, lights, tilemap};
+            timer.reset();
+            SceneDocument doc = load_scene_json(json_path);
+            json_instances = instantiate_scene(doc, geometry, targets, jobs).glyph_instances;
+            json_ms = timer.elapsed_ms();
+        }
+
+        // Binary path: map + copy the precomputed arrays
+        double map_ms = 0.0;
+        double copy_ms = 0.0;
+        size_t binary_size = 0;
+        {
+            InstanceStore instances;
+            MaterialTable materials;
+            std::vector<Light> lights;
+            Tilemap tilemap;
+            SceneTargets targets{instances, materials, lights, tilemap};
+            timer.reset();
+            SceneBinary scene(binary_path);
+            map_ms = timer.elapsed_ms();
+            SceneInstantiateResult result = instantiate_scene_binary(scene, geometry, targets);
+            copy_ms = timer.elapsed_ms() - map_ms;
+            binary_size = scene.file_size();
+            if (result.glyph_instances != json_instances) {
+                spdlog::error("Instance count mismatch: json {} vs binary {}", json_instances, result.glyph_instances);
+            }
+        }
+
+        const double mb = 1024.0 * 1024.0;
+        spdlog::info("{:>8} {:>9.1f} {:>9.1f} {:>10.2f} {:>11.2f} {:>10.2f} {:>11.2f} {:>9.1f}x",
+                     node_count, std::filesystem::file_size(json_path) / mb, binary_size / mb,
+                     bake_ms, json_ms, map_ms, copy_ms, json_ms / (map_ms + copy_ms));
+    }
+
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(binary_path);
+}
+
+} // namespace ascii::bench
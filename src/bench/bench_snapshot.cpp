@@ -0,0 +1,140 @@
+#include "bench.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "ecs/schema.hpp"
+#include "scene/play_snapshot.hpp"
+#include "scene/scene_index.hpp"
+#include "scene/transform_hierarchy.hpp"
+#include "world/tilemap.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ascii::bench {
+
+namespace {
+
+// Rooms of props of glyphs: ROOTS x ROOM_CHILDREN x PROP_CHILDREN leaves
+constexpr size_t ROOTS = 1000;
+constexpr size_t ROOM_CHILDREN = 10;
+constexpr size_t PROP_CHILDREN = 100;
+constexpr int MAP_SIZE = 1024;
+constexpr int MAP_LAYERS = 2;
+
+std::vector<Entity> spawn_rooms(World& world) {
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> coord(-50.0f, 50.0f);
+    auto local = [&]() {
+        return LocalTransform{{coord(rng), coord(rng), 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+    };
+
+    std::vector<Entity> roots;
+    for (size_t r = 0; r < ROOTS; r++) {
+        Entity room = world.spawn(Parent{}, local(), WorldTransform{});
+        roots.push_back(room);
+        for (size_t p = 0; p < ROOM_CHILDREN; p++) {
+            Entity prop = world.spawn(Parent{room}, local(), WorldTransform{});
+            for (size_t g = 0; g < PROP_CHILDREN; g++) {
+                world.spawn(Parent{prop}, local(), WorldTransform{});
+            }
+        }
+    }
+    return roots;
+}
+
+// Order-independent digest of everything play mode may change
+double checksum(World& world, const Tilemap& tilemap) {
+    double sum = static_cast<double>(world.size());
+    world.each<const LocalTransform, const WorldTransform>(
+        [&](Entity entity, const LocalTransform& local, const WorldTransform& transform) {
+            sum += local.position.x + transform.position.x * 0.5 + entity.index * 1e-3;
+        });
+    for (int layer = 0; layer < tilemap.layers(); layer++) {
+        const uint32_t* glyphs = tilemap.layer_glyphs(layer);
+        for (size_t i = 0; i < size_t(tilemap.width()) * tilemap.height(); i++) {
+            sum += glyphs[i] * (layer + 1);
+        }
+    }
+    return sum;
+}
+
+} // anonymous namespace
+
+void snapshot() {
+    World world;
+    SceneIndex index;
+    SchemaRegistry schemas;
+    Tilemap tilemap;
+    JobSystem jobs;
+
+    std::vector<Entity> roots = spawn_rooms(world);
+    tilemap.resize(MAP_SIZE, MAP_SIZE, MAP_LAYERS);
+    tilemap.fill_rect(0, 0, 0, MAP_SIZE, MAP_SIZE, {'.', 1, 0.1f});
+    TransformHierarchy hierarchy;
+    hierarchy.update(world, jobs);
+    const double original = checksum(world, tilemap);
+
+    // What an eager snapshot would copy: every component and tile
+    Stopwatch timer;
+    std::vector<Parent> parents;
+    std::vector<LocalTransform> locals;
+    std::vector<WorldTransform> transforms;
+    world.each<const Parent, const LocalTransform, const WorldTransform>(
+        [&](Entity, const Parent& parent, const LocalTransform& local, const WorldTransform& transform) {
+            parents.push_back(parent);
+            locals.push_back(local);
+            transforms.push_back(transform);
+        });
+    std::vector<std::vector<uint32_t>> glyphs;
+    for (int layer = 0; layer < MAP_LAYERS; layer++) {
+        glyphs.emplace_back(tilemap.layer_glyphs(layer), tilemap.layer_glyphs(layer) + MAP_SIZE * MAP_SIZE);
+    }
+    const size_t eager_bytes = parents.size() * (sizeof(Parent) + sizeof(LocalTransform) + sizeof(WorldTransform)) +
+                               size_t(MAP_SIZE) * MAP_SIZE * MAP_LAYERS * (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(float));
+    spdlog::info("{} entities, {}x{}x{} tiles; eager copy {:.2f} ms, {:.1f} MB", world.size(), MAP_SIZE, MAP_SIZE,
+                 MAP_LAYERS, timer.elapsed_ms(), eager_bytes / 1e6);
+
+    MaterialTable materials;
+    PlaySnapshot play(world, index, tilemap, schemas, materials);
+    std::mt19937 rng(7);
+    for (double fraction : {0.01, 0.1, 1.0}) {
+        timer.reset();
+        play.begin();
+        const double begin_ms = timer.elapsed_ms();
+
+        // Play: move a share of the rooms (their subtrees follow), repaint the
+        // same share of the map, and spawn / destroy a few entities
+        const size_t rooms = static_cast<size_t>(ROOTS * fraction);
+        timer.reset();
+        for (size_t k = 0; k < rooms; k++) {
+            Entity room = roots[(k * 7919 + rng() % 7) % roots.size()];
+            world.get<LocalTransform>(room)->position.x += 1.0f;
+            hierarchy.mark_dirty(world, room);
+        }
+        hierarchy.update(world, jobs);
+        const int rows = static_cast<int>(MAP_SIZE * fraction);
+        tilemap.fill_rect(1, 0, 0, MAP_SIZE, rows, {'#', 2, 1.0f});
+        for (int i = 0; i < 100; i++) {
+            world.destroy(world.entity_at(rng() % world.size()));
+            world.spawn(Parent{}, LocalTransform{}, WorldTransform{});
+        }
+        const double play_ms = timer.elapsed_ms();
+        const size_t bytes = play.bytes();
+
+        timer.reset();
+        play.restore();
+        const double restore_ms = timer.elapsed_ms();
+
+        if (checksum(world, tilemap) != original) {
+            throw std::runtime_error("Restored state differs from the snapshot");
+        }
+        hierarchy.update(world, jobs);      // Restore is a structural change: rebuild
+        spdlog::info("{:>5.0f}% rooms/map: begin {:>6.3f} ms  play {:>8.2f} ms  restore {:>7.2f} ms  {:>7.1f} MB saved",
+                     fraction * 100.0, begin_ms, play_ms, restore_ms, bytes / 1e6);
+    }
+}
+
+} // namespace ascii::bench
@@ -0,0 +1,169 @@
+#include "bench.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "ecs/schema.hpp"
+#include "scene/scene_world.hpp"
+#include "scene/state_file.hpp"
+#include "world/tilemap.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+namespace ascii::bench {
+
+namespace {
+
+constexpr size_t PROPS_PER_ROOM = 1000;
+constexpr int MAP_SIZE = 256;
+constexpr int MAP_LAYERS = 2;
+constexpr size_t STATS_EVERY = 4;           // One entity in 4 has a Type.define instance
+
+const uint32_t GLYPHS[] = {'#', '@', 'T', '~', 'A', '+'};
+
+// Rooms of props like the scene_binary bench: a Glyph and a Collider on every
+// prop, a Light on one in 50
+SceneDocument generate_scene(size_t entity_count) {
+    SceneDocument doc;
+    doc.version = "1.0.0";
+    doc.add_node(-1);
+    doc.node_id[0] = "root";
+    int32_t room = -1;
+    for (size_t i = 1; i < entity_count; i++) {
+        if ((i - 1) % (PROPS_PER_ROOM + 1) == 0) {
+            room = doc.add_node(0);
+            doc.node_id[room] = "room-" + std::to_string(i);
+            doc.position[room] = {float((i / PROPS_PER_ROOM) % 32) * 40.0f, float(i / PROPS_PER_ROOM / 32) * 40.0f, 0.0f};
+            continue;
+        }
+        const int32_t node = doc.add_node(room);
+        doc.node_id[node] = "n" + std::to_string(i);
+        doc.node_name[node] = "Prop";
+        doc.position[node] = {float(i % 32), float((i / 32) % 32), 0.0f};
+
+        GlyphComponent& glyph = doc.glyphs.emplace_back();
+        glyph.node = node;
+        glyph.id = "g" + std::to_string(i);
+        glyph.glyph = GLYPHS[i % 6];
+        glyph.fg = i % 2 ? "#ff8844" : "#88aaff";
+        ColliderComponent& collider = doc.colliders.emplace_back();
+        collider.node = node;
+        collider.id = "c" + std::to_string(i);
+        collider.layer = "default";
+        if (i % 50 == 0) {
+            LightComponent& light = doc.lights.emplace_back();
+            light.node = node;
+            light.id = "l" + std::to_string(i);
+            light.color = {1.0f, 0.7f, 0.4f};
+        }
+    }
+    return doc;
+}
+
+// Order-independent digest of what the state file holds
+double checksum(World& world, SceneIndex& index, const Tilemap& tilemap, SchemaRegistry& schemas) {
+    double sum = static_cast<double>(world.size()) + static_cast<double>(index.size());
+    world.each<const SceneNode, const LocalTransform, const WorldTransform>(
+        [&](Entity, const SceneNode& node, const LocalTransform& local, const WorldTransform& transform) {
+            sum += node.id * 1e-3 + local.position.x + transform.position.z * 0.5;
+        });
+    world.each<const SceneNode, const Parent>([&](Entity, const SceneNode& node, const Parent& parent) {
+        if (const SceneNode* up = world.get<const SceneNode>(parent.entity)) {
+            sum += (node.id % 97) * double(up->id);
+        }
+    });
+    world.each<const GlyphSprite, const ColliderComponent>(
+        [&](Entity, const GlyphSprite& sprite, const ColliderComponent& collider) {
+            sum += sprite.glyph + sprite.material * 3.0 + collider.layer.size();
+        });
+    for (int layer = 0; layer < tilemap.layers(); layer++) {
+        const uint32_t* glyphs = tilemap.layer_glyphs(layer);
+        for (size_t i = 0; i < size_t(tilemap.width()) * tilemap.height(); i++) {
+            sum += glyphs[i] * (layer + 1);
+        }
+    }
+    if (SchemaStore* stats = schemas.find("Stats")) {
+        for (uint32_t r = 0; r < stats->size(); r++) {
+            sum += stats->get(r, stats->schema().find("hp")) + stats->get(r, stats->schema().find("speed"), 0) * 0.25;
+        }
+    }
+    return sum;
+}
+
+std::vector<SchemaFieldDesc> stats_fields() {
+    std::vector<SchemaFieldDesc> fields(3);
+    fields[0].name = "hp";
+    fields[0].type = SchemaFieldType::Int;
+    fields[0].defaults[0] = 10;
+    fields[1].name = "speed";
+    fields[1].type = SchemaFieldType::Float;
+    fields[2].name = "velocity";
+    fields[2].type = SchemaFieldType::Vec2;
+    return fields;
+}
+
+} // anonymous namespace
+
+void state_file() {
+    const size_t entity_counts[] = {10000, 100000, 1000000};
+    const std::string path = "bench_state.asav";
+    JobSystem jobs;
+
+    spdlog::info("{:>8} {:>6} {:>8} {:>8} | {:>9} {:>9} {:>9} {:>9} | {:>9} {:>9} {:>9} {:>9} {:>9} | {:>8}  ({} threads)",
+                 "entities", "codec", "raw MB", "file MB", "encode ms", "pack ms", "write ms", "save ms",
+                 "decode ms", "check ms", "spawn ms", "fill ms", "load ms", "lazy ms", jobs.thread_count());
+
+    for (size_t entity_count : entity_counts) {
+        World world;
+        SceneIndex index;
+        MaterialTable materials;
+        Tilemap tilemap;
+        SchemaRegistry schemas;
+        spawn_scene(generate_scene(entity_count), world, index, materials);
+        tilemap.resize(MAP_SIZE, MAP_SIZE, MAP_LAYERS);
+        tilemap.fill_rect(0, 0, 0, MAP_SIZE, MAP_SIZE, {'.', 0, 0.0f});
+        tilemap.fill_rect(1, 16, 16, 64, 32, {'#', 0, 1.0f});
+        SchemaStore& stats = schemas.define("Stats", stats_fields());
+        for (size_t i = 0; i < world.size(); i += STATS_EVERY) {
+            const uint32_t r = stats.add(world.entity_at(i));
+            stats.set(r, 0, 0, double(i % 100));
+            stats.set(r, 1, 0, double(i % 7) * 0.5);
+        }
+        EngineState state{world, index, tilemap, materials, schemas};
+        const double original = checksum(world, index, tilemap, schemas);
+
+        for (bool compress : {false, true}) {
+            Stopwatch timer;
+            const StateSaveStats saved = save_state(path, state, jobs, compress);
+            const double save_ms = timer.elapsed_ms();
+
+            // Load into the same stores (they are cleared first)
+            timer.reset();
+            StateFile file(path);
+            const StateLoadStats loaded = load_state(file, state, jobs);
+            const double load_ms = timer.elapsed_ms();
+            if (checksum(world, index, tilemap, schemas) != original || world.size() != saved.entities) {
+                throw std::runtime_error("Loaded state differs from the saved one");
+            }
+
+            // A reader after one thing: open, then one entity's transform
+            timer.reset();
+            StateFile lazy(path);
+            const size_t row = lazy.info().entity_count / 2;
+            const LocalTransform local = lazy.range<LocalTransform>(state_format::SectionId::LocalTransforms, row, 1)[0];
+            const double lazy_ms = timer.elapsed_ms();
+            (void)local;
+
+            spdlog::info("{:>8} {:>6} {:>8.1f} {:>8.1f} | {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} | {:>9.2f} {:>9.2f} "
+                         "{:>9.2f} {:>9.2f} {:>9.2f} | {:>8.3f}",
+                         saved.entities, compress ? "lz" : "raw", saved.raw_bytes / 1e6, saved.file_bytes / 1e6,
+                         saved.encode_ms, saved.compress_ms, saved.write_ms, save_ms,
+                         loaded.decode_ms, loaded.validate_ms, loaded.spawn_ms, loaded.fill_ms, load_ms, lazy_ms);
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+} // namespace ascii::bench
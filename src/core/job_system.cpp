@@ -0,0 +1,132 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ascii {
+
+JobSystem::JobSystem(unsigned worker_count) {
+    if (worker_count == AUTO) {
+        unsigned hardware = std::thread::hardware_concurrency();
+        worker_count = hardware > 1 ? hardware - 1 : 0;
+    }
+    m_workers.reserve(worker_count);
+    for (unsigned i = 0; i < worker_count; i++) {
+        m_workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::submit(Group& group, std::function<void()> job) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    if (m_workers.empty()) {
+        Job inline_job{std::move(job), &group};
+        run(inline_job);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({std::move(job), &group});
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::wait(Group& group) {
+    while (group.pending.load(std::memory_order_acquire) != 0) {
+        if (!try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+    if (group.failed.load(std::memory_order_acquire)) {
+        std::exception_ptr error = std::exchange(group.error, nullptr);
+        group.failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    if (m_workers.empty() || count <= grain) {
+        fn(0, count);
+        return;
+    }
+
+    // No more ranges than a few per thread; each range is one job
+    const size_t max_ranges = static_cast<size_t>(thread_count()) * 4;
+    const size_t ranges = std::min((count + grain - 1) / grain, max_ranges);
+    const size_t step = (count + ranges - 1) / ranges;
+
+    Group group;
+    for (size_t begin = step; begin < count; begin += step) {
+        const size_t end = std::min(begin + step, count);
+        submit(group, [&fn, begin, end] { fn(begin, end); });
+    }
+    // First range on the calling thread; the queued ranges reference `fn`
+    // and `group`, so wait for them even when it throws
+    try {
+        fn(0, std::min(step, count));
+    } catch (...) {
+        fail(group, std::current_exception());
+    }
+    wait(group);
+}
+
+void JobSystem::worker_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;  // Stopping and drained
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        run(job);
+    }
+}
+
+bool JobSystem::try_run_one() {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty()) {
+            return false;
+        }
+        job = std::move(m_queue.front());
+        m_queue.pop_front();
+    }
+    run(job);
+    return true;
+}
+
+void JobSystem::run(Job& job) {
+    try {
+        job.fn();
+    } catch (...) {
+        fail(*job.group, std::current_exception());
+    }
+    job.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::fail(Group& group, std::exception_ptr error) {
+    if (!group.failed.exchange(true, std::memory_order_acq_rel)) {
+        group.error = std::move(error);
+    }
+}
+
+} // namespace ascii
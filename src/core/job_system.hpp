@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ascii {
+
+// Small fixed-size worker pool for CPU-side batch work (scene loading,
+// system updates). Jobs are grouped; wait() blocks until a group is done and
+// runs queued jobs on the calling thread meanwhile, so nested waits from
+// inside jobs can't deadlock the pool. A job that throws still completes;
+// wait() rethrows the group's first exception once every job is done.
+class JobSystem {
+public:
+    // Completion counter for a batch of jobs
+    struct Group {
+        std::atomic<uint32_t> pending{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;              // First one thrown; set once `failed` is won
+    };
+
+    // AUTO uses one worker per hardware thread, minus the caller;
+    // 0 runs every job inline on the submitting thread
+    static constexpr unsigned AUTO = ~0u;
+    explicit JobSystem(unsigned worker_count = AUTO);
+    ~JobSystem();
+
+    // Non-copyable
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(Group& group, std::function<void()> job);
+    void wait(Group& group);
+
+    // Run fn(begin, end) over [0, count) in ranges of about `grain` items,
+    // in parallel, and return when all ranges are done (rethrowing the first
+    // exception any range threw)
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // Threads that execute jobs: the workers plus the waiting caller
+    unsigned thread_count() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        Group* group;
+    };
+
+    void worker_loop();
+    bool try_run_one();
+    static void run(Job& job);
+    static void fail(Group& group, std::exception_ptr error);
+
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
+
+} // namespace ascii
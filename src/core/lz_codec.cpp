@@ -0,0 +1,194 @@
+#include "lz_codec.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace ascii {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;    // A block ends with at least this many literals
+constexpr size_t MFLIMIT = 12;         // The last match starts at least this far from the end
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 14;
+
+uint32_t load32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t load64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Length past the token's 4 bits: runs of 255 and a final byte below 255
+uint8_t* write_length(uint8_t* op, size_t length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+// One sequence: literals, then a match unless match_length is 0 (the last one)
+uint8_t* write_sequence(uint8_t* op, const uint8_t* literals, size_t literal_length,
+                        size_t offset, size_t match_length) {
+    uint8_t* token = op++;
+    uint8_t bits = 0;
+    if (literal_length >= 15) {
+        bits = 15 << 4;
+        op = write_length(op, literal_length - 15);
+    } else {
+        bits = static_cast<uint8_t>(literal_length << 4);
+    }
+    if (literal_length > 0) {
+        std::memcpy(op, literals, literal_length);
+        op += literal_length;
+    }
+
+    if (match_length > 0) {
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        const size_t extra = match_length - MIN_MATCH;
+        if (extra >= 15) {
+            bits |= 15;
+            op = write_length(op, extra - 15);
+        } else {
+            bits |= static_cast<uint8_t>(extra);
+        }
+    }
+    *token = bits;
+    return op;
+}
+
+} // anonymous namespace
+
+size_t lz_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t* src, size_t size, uint8_t* dst) {
+    uint8_t* op = dst;
+    size_t anchor = 0;     // First byte not yet emitted
+
+    if (size > MFLIMIT) {
+        uint32_t table[1 << HASH_BITS] = {};    // Last position seen per hash
+        const size_t match_limit = size - LAST_LITERALS;
+        const size_t start_limit = size - MFLIMIT;
+
+        size_t ip = 0;
+        while (ip < start_limit) {
+            const uint32_t sequence = load32(src + ip);
+            const uint32_t h = hash(sequence);
+            const size_t ref = table[h];
+            table[h] = static_cast<uint32_t>(ip);
+            if (ref >= ip || ip - ref > MAX_OFFSET || load32(src + ref) != sequence) {
+                // Step faster through data that keeps missing
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            const size_t offset = ip - ref;
+            size_t start = ip;
+            while (start > anchor && start > offset && src[start - 1] == src[start - 1 - offset]) {
+                start--;
+            }
+            size_t end = ip + MIN_MATCH;
+            while (end + 8 <= match_limit) {
+                const uint64_t diff = load64(src + end) ^ load64(src + end - offset);
+                if (diff != 0) {
+                    end += std::countr_zero(diff) / 8;     // Little-endian: first differing byte
+                    break;
+                }
+                end += 8;
+            }
+            if (end + 8 > match_limit) {
+                while (end < match_limit && src[end] == src[end - offset]) {
+                    end++;
+                }
+            }
+
+            op = write_sequence(op, src + anchor, start - anchor, offset, end - start);
+            table[hash(load32(src + end - 2))] = static_cast<uint32_t>(end - 2);
+            ip = end;
+            anchor = end;
+        }
+    }
+
+    return static_cast<size_t>(write_sequence(op, src + anchor, size - anchor, 0, 0) - dst);
+}
+
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size) {
+    const uint8_t* ip = src;
+    const uint8_t* const end = src + size;
+    uint8_t* op = dst;
+    uint8_t* const op_end = dst + dst_size;
+
+    auto read_length = [&](size_t& length) {
+        uint8_t byte = 0;
+        do {
+            if (ip == end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < end) {
+        const uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(literal_length)) {
+            return false;
+        }
+        if (literal_length > static_cast<size_t>(end - ip) || literal_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        if (literal_length > 0) {
+            std::memcpy(op, ip, literal_length);
+            ip += literal_length;
+            op += literal_length;
+        }
+        if (ip == end) {
+            break;          // The last sequence has no match
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length(match_length)) {
+            return false;
+        }
+        match_length += MIN_MATCH;
+        if (match_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        const uint8_t* from = op - offset;
+        if (offset >= match_length) {
+            std::memcpy(op, from, match_length);
+        } else {
+            for (size_t i = 0; i < match_length; i++) {     // Overlapping: repeats the last offset bytes
+                op[i] = from[i];
+            }
+        }
+        op += match_length;
+    }
+    return op == op_end;
+}
+
+} // namespace ascii
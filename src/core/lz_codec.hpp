@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ascii {
+
+// Byte-oriented LZ77 block compression in the LZ4 block format: a greedy
+// single-probe hash match finder, so compression runs at memory-bandwidth
+// order speeds and decompression is literal and match copies. Blocks are
+// independent, which lets callers compress and decompress them in parallel.
+
+// Worst-case compressed size of `size` input bytes
+size_t lz_compress_bound(size_t size);
+
+// Compress src into dst (at least lz_compress_bound(size) bytes); returns
+// the compressed size
+size_t lz_compress(const uint8_t* src, size_t size, uint8_t* dst);
+
+// Decompress a whole block into exactly dst_size bytes. False if the input
+// is malformed or does not decode to dst_size bytes; never reads or writes
+// out of bounds.
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size);
+
+} // namespace ascii
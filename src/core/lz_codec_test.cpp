@@ -0,0 +1,126 @@
+#include "core/lz_codec.hpp"
+#include "core/test.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+std::vector<uint8_t> compress(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> out(lz_compress_bound(data.size()));
+    out.resize(lz_compress(data.data(), data.size(), out.data()));
+    return out;
+}
+
+bool round_trips(const std::vector<uint8_t>& data) {
+    const std::vector<uint8_t> packed = compress(data);
+    std::vector<uint8_t> unpacked(data.size());
+    return packed.size() <= lz_compress_bound(data.size()) &&
+           lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()) &&
+           unpacked == data;
+}
+
+std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Engine-state-like input: repeated records with a few changing fields
+std::vector<uint8_t> records(size_t count) {
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; i < count; i++) {
+        const float record[8] = {float(i % 32), float((i / 32) % 32), 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f};
+        const auto* bytes = reinterpret_cast<const uint8_t*>(record);
+        data.insert(data.end(), bytes, bytes + sizeof(record));
+    }
+    return data;
+}
+
+void round_trip_sizes() {
+    CHECK(round_trips({}));
+    CHECK(round_trips({42}));
+    for (size_t size : {2, 5, 12, 13, 15, 16, 64, 255, 256, 65535, 65536, 300000}) {
+        CHECK(round_trips(random_bytes(size, uint32_t(size))));
+        CHECK(round_trips(std::vector<uint8_t>(size, 0xAB)));
+    }
+}
+
+void compresses_redundant_input() {
+    const std::vector<uint8_t> data = records(10000);
+    CHECK(round_trips(data));
+    CHECK(compress(data).size() < data.size() / 4);
+
+    // Runs: overlapping matches (offset smaller than the match length)
+    std::vector<uint8_t> runs;
+    for (int i = 0; i < 1000; i++) {
+        runs.insert(runs.end(), size_t(i % 300 + 1), uint8_t(i));
+    }
+    CHECK(round_trips(runs));
+
+    const std::string text = "the quick brown fox jumps over the lazy dog; ";
+    std::vector<uint8_t> repeated;
+    for (int i = 0; i < 500; i++) {
+        repeated.insert(repeated.end(), text.begin(), text.end() - (i % 7));
+    }
+    CHECK(round_trips(repeated));
+}
+
+void incompressible_stays_within_bound() {
+    const std::vector<uint8_t> data = random_bytes(1 << 20, 7);
+    const std::vector<uint8_t> packed = compress(data);
+    CHECK(packed.size() <= lz_compress_bound(data.size()));
+    CHECK(round_trips(data));
+}
+
+void rejects_wrong_size() {
+    const std::vector<uint8_t> data = records(1000);
+    const std::vector<uint8_t> packed = compress(data);
+    std::vector<uint8_t> out(data.size() + 1);
+    CHECK(!lz_decompress(packed.data(), packed.size(), out.data(), data.size() - 1));
+    CHECK(!lz_decompress(packed.data(), packed.size(), out.data(), data.size() + 1));
+    CHECK(!lz_decompress(packed.data(), packed.size() - 1, out.data(), data.size()));
+    CHECK(!lz_decompress(packed.data(), 0, out.data(), data.size()));
+}
+
+// Corrupt blocks decode to false or to some bytes, never out of bounds
+// (run under a sanitizer to catch that)
+void survives_corruption() {
+    const std::vector<uint8_t> data = records(2000);
+    const std::vector<uint8_t> packed = compress(data);
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> out(data.size());
+    for (int trial = 0; trial < 2000; trial++) {
+        std::vector<uint8_t> bad = packed;
+        for (int flips = 1 + trial % 4; flips > 0; flips--) {
+            bad[rng() % bad.size()] = static_cast<uint8_t>(rng());
+        }
+        bad.resize(bad.size() - rng() % 4);
+        (void)lz_decompress(bad.data(), bad.size(), out.data(), out.size());
+    }
+    for (int trial = 0; trial < 200; trial++) {
+        const std::vector<uint8_t> junk = random_bytes(1 + trial * 7, uint32_t(trial));
+        (void)lz_decompress(junk.data(), junk.size(), out.data(), out.size());
+    }
+    CHECK(lz_decompress(packed.data(), packed.size(), out.data(), out.size()) && out == data);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"round_trip_sizes", round_trip_sizes},
+        {"compresses_redundant_input", compresses_redundant_input},
+        {"incompressible_stays_within_bound", incompressible_stays_within_bound},
+        {"rejects_wrong_size", rejects_wrong_size},
+        {"survives_corruption", survives_corruption},
+    });
+}
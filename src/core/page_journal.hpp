@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace ascii {
+
+// Copy-on-write pre-images of one array of plain values. begin() copies
+// nothing; afterwards the first touch() of each fixed-size page saves the
+// page as it was, and restore() copies the saved pages back, so the cost
+// is O(pages written). Writers touch an element before writing it, and
+// before shrinking the array past it.
+template<typename T, size_t PAGE = 1024>
+class PageJournal {
+public:
+    void begin(size_t size) {
+        static_assert(std::is_trivially_copyable_v<T>, "Journal pages are copied bytewise");
+        clear();
+        m_active = true;
+        m_size = size;
+    }
+
+    bool active() const { return m_active; }
+
+    void touch(const std::vector<T>& data, size_t index) {
+        if (!m_active || index >= m_size) {
+            return;
+        }
+        const size_t page = index / PAGE;
+        if (m_page_slot.empty()) {
+            m_page_slot.assign((m_size + PAGE - 1) / PAGE, NO_SLOT);
+        }
+        if (m_page_slot[page] == NO_SLOT) {
+            save(data, page);
+        }
+    }
+
+    // [first, last)
+    void touch_range(const std::vector<T>& data, size_t first, size_t last) {
+        last = std::min(last, m_size);
+        for (size_t index = first; index < last; index = (index / PAGE + 1) * PAGE) {
+            touch(data, index);
+        }
+    }
+
+    // Back to the contents and size of begin(); ends the journal
+    void restore(std::vector<T>& data) {
+        data.resize(m_size);
+        for (size_t slot = 0; slot < m_pages.size(); slot++) {
+            const size_t first = m_pages[slot] * PAGE;
+            const size_t count = std::min(PAGE, m_size - first);
+            std::copy_n(m_saved.begin() + slot * PAGE, count, data.begin() + first);
+        }
+        clear();
+    }
+
+    // Keep the current contents; ends the journal
+    void commit() { clear(); }
+
+    // fn(index) for every element of the saved pages below size
+    template<typename Fn>
+    void for_each_saved(size_t size, Fn&& fn) const {
+        for (uint32_t page : m_pages) {
+            const size_t last = std::min({(page + 1) * PAGE, m_size, size});
+            for (size_t index = page * PAGE; index < last; index++) {
+                fn(index);
+            }
+        }
+    }
+
+    size_t saved_pages() const { return m_pages.size(); }
+    size_t bytes() const {
+        return m_saved.capacity() * sizeof(T) + (m_pages.capacity() + m_page_slot.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    void save(const std::vector<T>& data, size_t page) {
+        const size_t first = page * PAGE;
+        const size_t count = std::min(PAGE, m_size - first);
+        m_page_slot[page] = static_cast<uint32_t>(m_pages.size());
+        m_pages.push_back(static_cast<uint32_t>(page));
+        m_saved.resize(m_saved.size() + PAGE);
+        std::copy_n(data.begin() + first, count, m_saved.end() - PAGE);
+    }
+
+    void clear() {
+        m_active = false;
+        m_size = 0;
+        m_saved = {};
+        m_pages = {};
+        m_page_slot = {};
+    }
+
+    bool m_active = false;
+    size_t m_size = 0;                      // Array size at begin()
+    std::vector<T> m_saved;                 // PAGE values per saved page
+    std::vector<uint32_t> m_pages;          // Page index of each saved page
+    std::vector<uint32_t> m_page_slot;      // Page -> saved page, sized on the first touch
+};
+
+} // namespace ascii
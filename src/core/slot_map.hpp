@@ -0,0 +1,221 @@
+#pragma once
+
+#include "page_journal.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace ascii {
+
+// Stable reference into a SlotMap. The generation is bumped every time a
+// slot is freed, so a handle to a removed element never resolves to
+// whatever reuses its slot.
+struct Handle {
+    static constexpr uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+    uint32_t index = NO_INDEX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != NO_INDEX; }
+    bool operator==(const Handle&) const = default;
+
+    // One integer for IPC and Lua: generation in the high 32 bits
+    uint64_t bits() const { return (uint64_t(generation) << 32) | index; }
+    static Handle from_bits(uint64_t bits) {
+        return {static_cast<uint32_t>(bits), static_cast<uint32_t>(bits >> 32)};
+    }
+};
+
+struct HandleHash {
+    size_t operator()(const Handle& handle) const { return std::hash<uint64_t>()(handle.bits()); }
+};
+
+// Values live in one dense array (removal swaps the last value into the
+// hole), so iteration is a linear scan; handles go through a sparse slot
+// array that maps them to the dense position in O(1).
+template<typename T>
+class SlotMap {
+public:
+    Handle insert(T value) {
+        uint32_t index;
+        if (m_free_head != Handle::NO_INDEX) {
+            index = m_free_head;
+            m_slot_journal.touch(m_slots, index);
+            m_free_head = m_slots[index].dense;
+        } else {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back({});
+            m_issued.push_back(0);
+        }
+        Slot& slot = m_slots[index];
+        m_issued[index] = slot.generation;
+        slot.dense = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_handles.push_back({index, slot.generation});
+        return {index, slot.generation};
+    }
+
+    bool erase(Handle handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+        Slot& slot = m_slots[handle.index];
+        const uint32_t hole = slot.dense;
+        const uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+        if (m_value_journal.active()) {
+            m_slot_journal.touch(m_slots, handle.index);
+            m_slot_journal.touch(m_slots, m_handles[last].index);
+            for (uint32_t dense : {hole, last}) {
+                m_value_journal.touch(m_values, dense);
+                m_handle_journal.touch(m_handles, dense);
+            }
+        }
+        if (hole != last) {
+            m_values[hole] = std::move(m_values[last]);
+            m_handles[hole] = m_handles[last];
+            m_slots[m_handles[hole].index].dense = hole;
+        }
+        m_values.pop_back();
+        m_handles.pop_back();
+
+        slot.generation = next_generation(handle.index);
+        slot.dense = m_free_head;      // Free slots chain through `dense`
+        m_free_head = handle.index;
+        return true;
+    }
+
+    // The dense back-reference also rejects handles made up for free slots
+    bool contains(Handle handle) const {
+        return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation &&
+               m_slots[handle.index].dense < m_values.size() &&
+               m_handles[m_slots[handle.index].dense] == handle;
+    }
+
+    // nullptr for stale or null handles. The non-const overload counts as a
+    // write for an active snapshot.
+    T* get(Handle handle) {
+        if (!contains(handle)) {
+            return nullptr;
+        }
+        const uint32_t dense = m_slots[handle.index].dense;
+        m_value_journal.touch(m_values, dense);
+        return &m_values[dense];
+    }
+    const T* get(Handle handle) const {
+        return contains(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+    }
+
+    // Dense view; positions change when elements are erased
+    size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+    T* data() { return m_values.data(); }
+    const T* data() const { return m_values.data(); }
+    Handle handle_at(size_t dense) const { return m_handles[dense]; }
+
+    auto begin() { return m_values.begin(); }
+    auto end() { return m_values.end(); }
+    auto begin() const { return m_values.begin(); }
+    auto end() const { return m_values.end(); }
+
+    // Keeps slot generations, so handles from before stay stale
+    void clear() {
+        if (m_value_journal.active()) {
+            m_slot_journal.touch_range(m_slots, 0, m_slots.size());
+            m_value_journal.touch_range(m_values, 0, m_values.size());
+            m_handle_journal.touch_range(m_handles, 0, m_handles.size());
+        }
+        for (const Handle& handle : m_handles) {
+            Slot& slot = m_slots[handle.index];
+            slot.generation = next_generation(handle.index);
+            slot.dense = m_free_head;
+            m_free_head = handle.index;
+        }
+        m_values.clear();
+        m_handles.clear();
+    }
+
+    // Copy-on-write snapshot (T must be trivially copyable). Taking it copies
+    // nothing; restore_snapshot() brings back the values and handles of
+    // begin_snapshot() in O(pages written since). Handles handed out in
+    // between stay stale: slots freed by the restore, and slots erased
+    // later, get a generation past any handle ever issued for them.
+    void begin_snapshot() {
+        m_slot_journal.begin(m_slots.size());
+        m_value_journal.begin(m_values.size());
+        m_handle_journal.begin(m_handles.size());
+        m_saved_free_head = m_free_head;
+        m_saved_slot_count = m_slots.size();
+    }
+
+    void restore_snapshot() {
+        // Slots written since: one that ends up free must not hand out a
+        // generation already given to a later handle
+        std::vector<uint32_t> written;
+        m_slot_journal.for_each_saved(m_slots.size(), [&](size_t index) {
+            written.push_back(static_cast<uint32_t>(index));
+        });
+        for (size_t index = m_saved_slot_count; index < m_slots.size(); index++) {
+            written.push_back(static_cast<uint32_t>(index));
+        }
+
+        m_slot_journal.restore(m_slots);
+        m_value_journal.restore(m_values);
+        m_handle_journal.restore(m_handles);
+        m_free_head = m_saved_free_head;
+        for (uint32_t index : written) {
+            if (index >= m_slots.size()) {
+                m_slots.push_back({m_free_head, 0});     // Slot added since: keep it, free
+                m_free_head = index;
+            }
+            Slot& slot = m_slots[index];
+            const bool live = index < m_saved_slot_count && slot.dense < m_handles.size() &&
+                              m_handles[slot.dense].index == index;
+            if (!live) {
+                slot.generation = next_generation(index);
+            }
+        }
+    }
+
+    void commit_snapshot() {
+        m_slot_journal.commit();
+        m_value_journal.commit();
+        m_handle_journal.commit();
+    }
+
+    bool snapshot_active() const { return m_value_journal.active(); }
+    size_t snapshot_bytes() const {
+        return m_slot_journal.bytes() + m_value_journal.bytes() + m_handle_journal.bytes();
+    }
+
+private:
+    struct Slot {
+        uint32_t dense = 0;         // Dense position, or the next free slot
+        uint32_t generation = 0;
+    };
+
+    // For a slot being freed: past every handle it ever had
+    uint32_t next_generation(uint32_t index) const {
+        return std::max(m_slots[index].generation, m_issued[index]) + 1;
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<T> m_values;
+    std::vector<Handle> m_handles;  // Dense position -> handle
+    uint32_t m_free_head = Handle::NO_INDEX;
+
+    // Slot -> highest generation handed out. Not journaled: a restore brings
+    // back old generations for live slots, never the high-water mark.
+    std::vector<uint32_t> m_issued;
+
+    PageJournal<Slot> m_slot_journal;
+    PageJournal<T> m_value_journal;
+    PageJournal<Handle> m_handle_journal;
+    uint32_t m_saved_free_head = Handle::NO_INDEX;
+    size_t m_saved_slot_count = 0;
+};
+
+} // namespace ascii
@@ -0,0 +1,162 @@
+#include "core/slot_map.hpp"
+#include "core/test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+bool holds(const std::vector<Handle>& handles, Handle handle) {
+    return std::find(handles.begin(), handles.end(), handle) != handles.end();
+}
+
+void erase_reuses_slot_with_new_generation() {
+    SlotMap<int> map;
+    const Handle a = map.insert(1);
+    const Handle b = map.insert(2);
+    CHECK(map.erase(a));
+    CHECK(!map.erase(a));
+    CHECK(!map.contains(a) && map.get(a) == nullptr);
+
+    const Handle c = map.insert(3);
+    CHECK(c.index == a.index && c.generation != a.generation);
+    CHECK(map.get(a) == nullptr && *map.get(c) == 3 && *map.get(b) == 2);
+
+    map.clear();
+    CHECK(map.empty() && !map.contains(b) && !map.contains(c));
+    const Handle d = map.insert(4);
+    CHECK(d != b && d != c && *map.get(d) == 4);
+}
+
+// Handles from before the snapshot resolve to their old values again;
+// handles issued during it are stale, and slots reused after the restore
+// never hand one of them out again
+void restore_never_reissues_handles() {
+    SlotMap<int> map;
+    std::vector<Handle> before;
+    for (int i = 0; i < 8; i++) {
+        before.push_back(map.insert(i));
+    }
+    map.erase(before[3]);
+    before.erase(before.begin() + 3);
+
+    map.begin_snapshot();
+    std::vector<Handle> during;
+    map.erase(before[0]);                 // Freed, then reused during play
+    during.push_back(map.insert(100));
+    during.push_back(map.insert(101));    // Reuses the slot freed before the snapshot
+    during.push_back(map.insert(102));    // A slot added since
+    *map.get(before[5]) = -5;
+    map.restore_snapshot();
+
+    CHECK(map.size() == before.size());
+    for (size_t i = 0; i < before.size(); i++) {
+        CHECK(map.contains(before[i]));
+    }
+    CHECK(*map.get(before[5]) != -5);
+    for (Handle handle : during) {
+        CHECK(!map.contains(handle));
+    }
+
+    // Refill every free slot: none may come back as a handle from play
+    std::vector<Handle> after;
+    for (int i = 0; i < 8; i++) {
+        after.push_back(map.insert(200 + i));
+    }
+    for (Handle handle : after) {
+        CHECK(!holds(during, handle) && !holds(before, handle));
+    }
+    for (Handle handle : during) {
+        CHECK(!map.contains(handle));
+    }
+}
+
+void commit_keeps_current_state() {
+    SlotMap<int> map;
+    const Handle a = map.insert(1);
+    const Handle b = map.insert(2);
+    map.begin_snapshot();
+    map.erase(a);
+    const Handle c = map.insert(3);
+    *map.get(b) = 20;
+    map.commit_snapshot();
+    CHECK(!map.snapshot_active());
+    CHECK(!map.contains(a) && *map.get(b) == 20 && *map.get(c) == 3);
+}
+
+// Random inserts, erases and clears around snapshots, checked against the
+// handles the test itself holds
+void random_snapshots() {
+    std::mt19937 rng(7);
+    int reissued = 0;
+    int wrong = 0;
+    for (int round = 0; round < 500; round++) {
+        SlotMap<uint32_t> map;
+        std::unordered_set<uint64_t> issued;
+        std::vector<Handle> live;
+        auto mutate = [&](uint32_t steps) {
+            for (uint32_t i = 0; i < steps; i++) {
+                if (live.empty() || rng() % 2) {
+                    const Handle handle = map.insert(static_cast<uint32_t>(issued.size()));
+                    reissued += !issued.insert(handle.bits()).second;
+                    live.push_back(handle);
+                } else {
+                    const size_t k = rng() % live.size();
+                    wrong += !map.erase(live[k]);
+                    live[k] = live.back();
+                    live.pop_back();
+                }
+                if (rng() % 50 == 0) {
+                    map.clear();
+                    live.clear();
+                }
+            }
+        };
+
+        mutate(rng() % 200);
+        const std::vector<Handle> saved = live;
+        std::vector<uint32_t> values;
+        for (Handle handle : saved) {
+            values.push_back(*map.get(handle));
+        }
+        map.begin_snapshot();
+        mutate(rng() % 300);
+        const std::vector<Handle> played = live;
+        map.restore_snapshot();
+        live = saved;
+
+        wrong += map.size() != saved.size();
+        for (size_t i = 0; i < saved.size(); i++) {
+            const uint32_t* value = map.get(saved[i]);
+            wrong += !value || *value != values[i];
+        }
+        for (Handle handle : played) {
+            wrong += !holds(saved, handle) && map.contains(handle);
+        }
+        mutate(rng() % 300);
+        if (rng() % 2) {
+            map.begin_snapshot();
+            mutate(50);
+            map.commit_snapshot();
+            mutate(50);
+        }
+    }
+    CHECK(reissued == 0);
+    CHECK(wrong == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"erase_reuses_slot_with_new_generation", erase_reuses_slot_with_new_generation},
+        {"restore_never_reissues_handles", restore_never_reissues_handles},
+        {"commit_keeps_current_state", commit_keeps_current_state},
+        {"random_snapshots", random_snapshots},
+    });
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+
+namespace ascii {
+
+// Wall-clock timer for load-time reporting and benchmarks
+class Stopwatch {
+public:
+    Stopwatch() : m_start(Clock::now()) {}
+
+    void reset() { m_start = Clock::now(); }
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point m_start;
+};
+
+} // namespace ascii
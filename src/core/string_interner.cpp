@@ -0,0 +1,104 @@
+#include "string_interner.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ascii {
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+
+// FNV-1a
+uint64_t hash_string(std::string_view text) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : text) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
+StringInterner::StringInterner() : m_table(INITIAL_SLOTS, EMPTY) {}
+
+size_t StringInterner::probe(std::string_view text, uint64_t hash) const {
+    const size_t mask = m_table.size() - 1;
+    size_t slot = hash & mask;
+    while (m_table[slot] != EMPTY) {
+        const StringId id = m_table[slot];
+        if (m_hashes[id] == hash && m_strings[id] == text) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+StringId StringInterner::find(std::string_view text) const {
+    const uint32_t id = m_table[probe(text, hash_string(text))];
+    return id == EMPTY ? NO_STRING : id;
+}
+
+StringId StringInterner::intern(std::string_view text) {
+    const uint64_t hash = hash_string(text);
+    size_t slot = probe(text, hash);
+    if (m_table[slot] != EMPTY) {
+        return m_table[slot];
+    }
+
+    const StringId id = static_cast<StringId>(m_strings.size());
+    m_strings.push_back(store(text));
+    m_hashes.push_back(hash);
+    if (m_strings.size() * 2 > m_table.size()) {
+        grow();                                 // Re-inserts every id, including this one
+    } else {
+        m_table[slot] = id;
+    }
+    return id;
+}
+
+void StringInterner::grow() {
+    std::vector<uint32_t> table(m_table.size() * 2, EMPTY);
+    const size_t mask = table.size() - 1;
+    for (StringId id = 0; id < m_strings.size(); id++) {
+        size_t slot = m_hashes[id] & mask;
+        while (table[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = id;
+    }
+    m_table.swap(table);
+}
+
+std::string_view StringInterner::store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    if (text.size() > BLOCK_BYTES / 4) {
+        // Long strings get a block of their own, kept behind the block being filled
+        auto block = std::make_unique<char[]>(text.size());
+        std::memcpy(block.get(), text.data(), text.size());
+        std::string_view view(block.get(), text.size());
+        m_blocks.insert(m_blocks.empty() ? m_blocks.end() : m_blocks.end() - 1, std::move(block));
+        return view;
+    }
+    if (text.size() > BLOCK_BYTES - m_block_used) {
+        m_blocks.push_back(std::make_unique<char[]>(BLOCK_BYTES));
+        m_block_used = 0;
+    }
+    char* dst = m_blocks.back().get() + m_block_used;
+    std::memcpy(dst, text.data(), text.size());
+    m_block_used += text.size();
+    return {dst, text.size()};
+}
+
+void StringInterner::clear() {
+    m_table.assign(INITIAL_SLOTS, EMPTY);
+    m_strings.clear();
+    m_hashes.clear();
+    m_blocks.clear();
+    m_block_used = BLOCK_BYTES;
+}
+
+} // namespace ascii
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace ascii {
+
+using StringId = uint32_t;
+constexpr StringId NO_STRING = 0xFFFFFFFFu;
+
+// Deduplicated strings with small dense ids. Lookup is an open-addressing
+// table (linear probing, power-of-two size, at most half full) keyed by
+// the string hash; the characters live in fixed blocks, so views stay
+// valid as the table grows.
+class StringInterner {
+public:
+    StringInterner();
+
+    // Id of the string, adding it if new
+    StringId intern(std::string_view text);
+
+    // NO_STRING if the string was never interned
+    StringId find(std::string_view text) const;
+
+    std::string_view str(StringId id) const { return id < m_strings.size() ? m_strings[id] : std::string_view(); }
+    size_t size() const { return m_strings.size(); }
+
+    void clear();
+
+private:
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    size_t probe(std::string_view text, uint64_t hash) const;  // Slot holding text, or the empty slot ending the run
+    void grow();
+    std::string_view store(std::string_view text);
+
+    std::vector<uint32_t> m_table;              // StringId per slot, EMPTY if unused
+    std::vector<std::string_view> m_strings;    // By id
+    std::vector<uint64_t> m_hashes;             // By id, for rehashing
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    size_t m_block_used = BLOCK_BYTES;
+};
+
+} // namespace ascii
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <initializer_list>
+
+namespace ascii::test {
+
+// Minimal harness for the src/**/*_test.cpp executables that ctest runs.
+// CHECK doesn't stop the case (unlike assert, it also works in Release);
+// run() returns nonzero if any check failed or a case threw.
+
+struct Case {
+    const char* name;
+    void (*fn)();
+};
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool ok, const char* expr, const char* file, int line) {
+    if (!ok) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+        failures()++;
+    }
+}
+
+inline int run(std::initializer_list<Case> cases) {
+    for (const Case& c : cases) {
+        const int before = failures();
+        try {
+            c.fn();
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: threw %s\n", c.name, e.what());
+            failures()++;
+        }
+        std::printf("%s %s\n", failures() == before ? "PASS" : "FAIL", c.name);
+    }
+    return failures() == 0 ? 0 : 1;
+}
+
+} // namespace ascii::test
+
+#define CHECK(expr) ::ascii::test::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
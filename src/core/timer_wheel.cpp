@@ -0,0 +1,152 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ascii {
+
+namespace {
+
+constexpr uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+// Ticks covered by levels 0..level
+constexpr uint64_t level_span(int level) {
+    return uint64_t(1) << (TimerWheel::SLOT_BITS * (level + 1));
+}
+
+} // anonymous namespace
+
+TimerWheel::TimerWheel(double tick_seconds) : m_tick(tick_seconds) {
+    std::fill(std::begin(m_heads), std::end(m_heads), NO_TIMER);
+}
+
+uint32_t TimerWheel::schedule(double delay, uint32_t payload) {
+    uint32_t timer;
+    if (m_free != NO_TIMER) {
+        timer = m_free;
+        m_free = m_timers[timer].next;
+    } else {
+        timer = static_cast<uint32_t>(m_timers.size());
+        m_timers.push_back({});
+    }
+    const double due = std::ceil((m_time + std::max(delay, 0.0)) / m_tick);
+    m_timers[timer].due = std::max(static_cast<uint64_t>(due), m_now + 1);
+    m_timers[timer].payload = payload;
+    link(timer);
+    m_size++;
+    return timer;
+}
+
+bool TimerWheel::cancel(uint32_t timer) {
+    if (timer >= m_timers.size() || m_timers[timer].bucket == NO_TIMER) {
+        return false;
+    }
+    unlink(timer);
+    m_timers[timer].next = m_free;
+    m_free = timer;
+    m_size--;
+    return true;
+}
+
+void TimerWheel::advance(double dt, std::vector<uint32_t>& fired) {
+    m_time += std::max(dt, 0.0);
+    const uint64_t target = static_cast<uint64_t>(std::floor(m_time / m_tick));
+    while (m_now < target) {
+        if (m_size == 0) {
+            m_now = target;
+            break;
+        }
+        m_now++;
+
+        // Crossing into a new bucket of a higher level refiles it, top down
+        // so refiled timers can land in buckets cascaded right after
+        for (int level = LEVELS - 1; level > 0; level--) {
+            if ((m_now & (level_span(level - 1) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+
+        const uint32_t bucket = static_cast<uint32_t>(m_now & SLOT_MASK);
+        if (!(m_occupied[0] & (uint64_t(1) << bucket))) {
+            continue;
+        }
+        uint32_t timer = m_heads[bucket];
+        m_heads[bucket] = NO_TIMER;
+        m_occupied[0] &= ~(uint64_t(1) << bucket);
+        while (timer != NO_TIMER) {
+            Timer& t = m_timers[timer];
+            const uint32_t next = t.next;
+            fired.push_back(t.payload);
+            t.bucket = NO_TIMER;
+            t.next = m_free;
+            m_free = timer;
+            m_size--;
+            timer = next;
+        }
+    }
+}
+
+void TimerWheel::clear() {
+    m_timers.clear();
+    m_free = NO_TIMER;
+    std::fill(std::begin(m_heads), std::end(m_heads), NO_TIMER);
+    std::fill(std::begin(m_occupied), std::end(m_occupied), 0);
+    m_size = 0;
+}
+
+// File a timer by its distance from now; past the top level it goes into
+// the top level's furthest bucket and is refiled from there
+void TimerWheel::link(uint32_t timer) {
+    Timer& t = m_timers[timer];
+    const uint64_t distance = t.due - m_now;
+    int level = 0;
+    while (level < LEVELS - 1 && distance >= level_span(level)) {
+        level++;
+    }
+    const uint64_t due = std::min(t.due, m_now + level_span(LEVELS - 1) - 1);
+    const uint32_t slot = static_cast<uint32_t>((due >> (SLOT_BITS * level)) & SLOT_MASK);
+    const uint32_t bucket = static_cast<uint32_t>(level) * SLOTS + slot;
+
+    t.bucket = bucket;
+    t.prev = NO_TIMER;
+    t.next = m_heads[bucket];
+    if (t.next != NO_TIMER) {
+        m_timers[t.next].prev = timer;
+    }
+    m_heads[bucket] = timer;
+    m_occupied[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(uint32_t timer) {
+    Timer& t = m_timers[timer];
+    if (t.prev != NO_TIMER) {
+        m_timers[t.prev].next = t.next;
+    } else {
+        m_heads[t.bucket] = t.next;
+        if (t.next == NO_TIMER) {
+            m_occupied[t.bucket / SLOTS] &= ~(uint64_t(1) << (t.bucket % SLOTS));
+        }
+    }
+    if (t.next != NO_TIMER) {
+        m_timers[t.next].prev = t.prev;
+    }
+    t.bucket = NO_TIMER;
+}
+
+void TimerWheel::cascade(int level) {
+    const uint32_t slot = static_cast<uint32_t>((m_now >> (SLOT_BITS * level)) & SLOT_MASK);
+    if (!(m_occupied[level] & (uint64_t(1) << slot))) {
+        return;
+    }
+    const uint32_t bucket = static_cast<uint32_t>(level) * SLOTS + slot;
+    uint32_t timer = m_heads[bucket];
+    m_heads[bucket] = NO_TIMER;
+    m_occupied[level] &= ~(uint64_t(1) << slot);
+    while (timer != NO_TIMER) {
+        const uint32_t next = m_timers[timer].next;
+        link(timer);
+        timer = next;
+    }
+}
+
+} // namespace ascii
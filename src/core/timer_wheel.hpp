@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// Hierarchical timing wheel of one-shot timers. LEVELS wheels of SLOTS
+// buckets each; a bucket on level L spans SLOTS^L ticks. Timers are filed
+// by how far away they are, so scheduling and cancelling are O(1) list
+// operations, and advancing only visits the buckets time passes through:
+// when it reaches a higher-level bucket, that bucket's timers are refiled
+// into the levels below. Timers further out than the whole wheel wait in
+// the top level and are refiled until they are in range.
+class TimerWheel {
+public:
+    static constexpr uint32_t NO_TIMER = 0xFFFFFFFFu;
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+
+    explicit TimerWheel(double tick_seconds = 1.0 / 1000.0);
+
+    // Fire `payload` after `delay` seconds, rounded up to whole ticks (at
+    // least one). Timer ids are reused once the timer fired or was cancelled.
+    uint32_t schedule(double delay, uint32_t payload);
+    bool cancel(uint32_t timer);
+
+    // Move time forward by dt seconds, appending the payloads of the timers
+    // that came due, in due order
+    void advance(double dt, std::vector<uint32_t>& fired);
+
+    void clear();
+
+    size_t size() const { return m_size; }
+    double tick_seconds() const { return m_tick; }
+    uint64_t now() const { return m_now; }     // Ticks
+
+private:
+    struct Timer {
+        uint64_t due = 0;                      // Tick
+        uint32_t payload = 0;
+        uint32_t prev = NO_TIMER;
+        uint32_t next = NO_TIMER;              // Bucket list, or the free list
+        uint32_t bucket = NO_TIMER;            // level * SLOTS + slot; NO_TIMER when free
+    };
+
+    void link(uint32_t timer);
+    void unlink(uint32_t timer);
+    void cascade(int level);
+
+    std::vector<Timer> m_timers;
+    uint32_t m_free = NO_TIMER;
+    uint32_t m_heads[LEVELS * SLOTS];
+    uint64_t m_occupied[LEVELS] = {};          // Bit per non-empty bucket
+    size_t m_size = 0;
+
+    double m_tick;
+    double m_time = 0.0;                       // Seconds
+    uint64_t m_now = 0;                        // Last tick processed
+};
+
+} // namespace ascii
@@ -0,0 +1,134 @@
+#include "core/timer_wheel.hpp"
+#include "core/test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+// Whole-second ticks keep the expected due ticks exact
+constexpr double TICK = 1.0;
+
+void fires_once_when_due() {
+    TimerWheel wheel(TICK);
+    std::vector<uint32_t> fired;
+    wheel.schedule(3.0, 30);
+    wheel.schedule(0.0, 1);                   // At least one tick
+    wheel.schedule(2.5, 25);                  // Rounded up
+    CHECK(wheel.size() == 3);
+
+    wheel.advance(1.0, fired);
+    CHECK(fired == std::vector<uint32_t>{1});
+    wheel.advance(1.0, fired);
+    CHECK(fired.size() == 1);
+    wheel.advance(1.0, fired);
+    CHECK(fired == (std::vector<uint32_t>{1, 25, 30}) || fired == (std::vector<uint32_t>{1, 30, 25}));
+    wheel.advance(100.0, fired);
+    CHECK(fired.size() == 3 && wheel.size() == 0);
+}
+
+// Cancelled timers never fire, even when their id is handed out again
+void cancel_and_reuse() {
+    TimerWheel wheel(TICK);
+    std::vector<uint32_t> fired;
+    const uint32_t a = wheel.schedule(5.0, 1);
+    CHECK(wheel.cancel(a));
+    CHECK(!wheel.cancel(a) && !wheel.cancel(TimerWheel::NO_TIMER));
+    const uint32_t b = wheel.schedule(10.0, 2);
+    CHECK(b == a && wheel.size() == 1);
+
+    wheel.advance(6.0, fired);
+    CHECK(fired.empty());
+    wheel.advance(4.0, fired);
+    CHECK(fired == std::vector<uint32_t>{2});
+    CHECK(!wheel.cancel(b));                  // Already fired
+}
+
+// Timers past every level wait in the top one and still fire on time
+void beyond_the_wheel() {
+    TimerWheel wheel(TICK);
+    std::vector<uint32_t> fired;
+    const double far = double(uint64_t(1) << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS)) + 1234.0;
+    wheel.schedule(far, 7);
+    wheel.schedule(far - 1.0, 6);
+    wheel.advance(far - 2.0, fired);
+    CHECK(fired.empty());
+    wheel.advance(1.0, fired);
+    CHECK(fired == std::vector<uint32_t>{6});
+    wheel.advance(1.0, fired);
+    CHECK(fired == (std::vector<uint32_t>{6, 7}));
+}
+
+// Random schedules, cancels and advances against a sorted reference
+void matches_reference() {
+    TimerWheel wheel(TICK);
+    std::multimap<uint64_t, uint32_t> expected;            // Due tick -> payload
+    std::map<uint32_t, std::multimap<uint64_t, uint32_t>::iterator> pending;   // Payload -> entry
+    std::map<uint32_t, uint32_t> timers;                   // Payload -> timer id
+    std::mt19937 rng(11);
+    uint64_t now = 0;
+    uint32_t next_payload = 0;
+    int mismatches = 0;
+
+    for (int step = 0; step < 20000; step++) {
+        const uint32_t op = rng() % 10;
+        if (op < 5) {
+            // Mostly near, sometimes a few levels out
+            const uint64_t delay = 1 + (rng() % 4 == 0 ? rng() % 300000 : rng() % 200);
+            const uint32_t payload = next_payload++;
+            timers[payload] = wheel.schedule(double(delay), payload);
+            pending[payload] = expected.emplace(now + delay, payload);
+        } else if (op < 7 && !pending.empty()) {
+            auto it = pending.begin();
+            std::advance(it, rng() % pending.size());
+            mismatches += !wheel.cancel(timers[it->first]);
+            expected.erase(it->second);
+            timers.erase(it->first);
+            pending.erase(it);
+        } else {
+            const uint64_t dt = rng() % 8 == 0 ? rng() % 20000 : rng() % 50;
+            now += dt;
+            std::vector<uint32_t> fired;
+            wheel.advance(double(dt), fired);
+
+            std::vector<uint32_t> due;
+            uint64_t last = 0;
+            for (uint32_t payload : fired) {
+                auto it = pending.find(payload);
+                if (it == pending.end()) {
+                    mismatches++;
+                    continue;
+                }
+                mismatches += it->second->first < last;       // In due order
+                last = it->second->first;
+            }
+            while (!expected.empty() && expected.begin()->first <= now) {
+                due.push_back(expected.begin()->second);
+                pending.erase(expected.begin()->second);
+                timers.erase(expected.begin()->second);
+                expected.erase(expected.begin());
+            }
+            std::sort(fired.begin(), fired.end());
+            std::sort(due.begin(), due.end());
+            mismatches += fired != due;
+        }
+        mismatches += wheel.size() != expected.size();
+    }
+    CHECK(mismatches == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"fires_once_when_due", fires_once_when_due},
+        {"cancel_and_reuse", cancel_and_reuse},
+        {"beyond_the_wheel", beyond_the_wheel},
+        {"matches_reference", matches_reference},
+    });
+}
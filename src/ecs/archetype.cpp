@@ -0,0 +1,205 @@
+#include "archetype.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ascii {
+
+namespace {
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+Archetype::Archetype(ComponentMask mask) : m_mask(mask) {
+    m_column_of.fill(-1);
+    for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+        if (mask & (ComponentMask(1) << id)) {
+            m_column_of[id] = static_cast<int16_t>(m_components.size());
+            m_components.push_back(id);
+            m_infos.push_back(component_info(id));
+        }
+    }
+
+    // Largest row count whose columns fit a chunk; rows too big for one
+    // chunk get a chunk sized for a single row
+    auto layout_bytes = [&](uint32_t capacity) {
+        size_t bytes = capacity * sizeof(Entity);
+        for (const auto& info : m_infos) {
+            bytes = align_up(bytes, info.align) + capacity * info.size;
+        }
+        return bytes;
+    };
+    size_t row_bytes = sizeof(Entity);
+    for (const auto& info : m_infos) {
+        row_bytes += info.size;
+    }
+    m_capacity = static_cast<uint32_t>(std::max<size_t>(1, CHUNK_BYTES / row_bytes));
+    while (m_capacity > 1 && layout_bytes(m_capacity) > CHUNK_BYTES) {
+        m_capacity--;
+    }
+    m_chunk_bytes = std::max(CHUNK_BYTES, align_up(layout_bytes(m_capacity), CHUNK_ALIGN));
+
+    size_t offset = m_capacity * sizeof(Entity);
+    for (const auto& info : m_infos) {
+        offset = align_up(offset, info.align);
+        m_offsets.push_back(offset);
+        offset += m_capacity * info.size;
+    }
+}
+
+Archetype::~Archetype() {
+    commit_snapshot();
+    for (Chunk& chunk : m_chunks) {
+        free_chunk(chunk);
+    }
+}
+
+std::byte* Archetype::allocate_chunk() const {
+    return static_cast<std::byte*>(::operator new[](m_chunk_bytes, std::align_val_t(CHUNK_ALIGN)));
+}
+
+void Archetype::free_chunk(Chunk& chunk) {
+    for (size_t i = 0; i < m_infos.size(); i++) {
+        for (uint32_t row = 0; row < chunk.count; row++) {
+            m_infos[i].destroy(chunk.data + m_offsets[i] + row * m_infos[i].size);
+        }
+    }
+    ::operator delete[](chunk.data, std::align_val_t(CHUNK_ALIGN));
+    chunk = {nullptr, 0};
+}
+
+Archetype::Location Archetype::push_row(Entity entity) {
+    if (m_chunks.empty() || m_chunks.back().count == m_capacity) {
+        m_chunks.push_back({allocate_chunk(), 0});
+    }
+    touch(m_chunks.size() - 1);
+    Chunk& chunk = m_chunks.back();
+    const uint32_t row = chunk.count++;
+    reinterpret_cast<Entity*>(chunk.data)[row] = entity;
+    m_size++;
+    return {static_cast<uint32_t>(m_chunks.size() - 1), row};
+}
+
+Archetype::Location Archetype::allocate(Entity entity) {
+    Location at = push_row(entity);
+    for (size_t i = 0; i < m_infos.size(); i++) {
+        m_infos[i].construct(m_chunks[at.chunk].data + m_offsets[i] + at.row * m_infos[i].size);
+    }
+    return at;
+}
+
+Archetype::Location Archetype::move_row_to(Location from, Archetype& to) {
+    touch(from.chunk);
+    const Entity entity = entities(from.chunk)[from.row];
+    Location at = to.push_row(entity);
+    for (size_t i = 0; i < to.m_infos.size(); i++) {
+        void* dst = to.m_chunks[at.chunk].data + to.m_offsets[i] + at.row * to.m_infos[i].size;
+        const int16_t source = m_column_of[to.m_components[i]];
+        if (source >= 0) {
+            to.m_infos[i].move_construct(dst, m_chunks[from.chunk].data + m_offsets[source] + from.row * m_infos[source].size);
+        } else {
+            to.m_infos[i].construct(dst);
+        }
+    }
+    return at;
+}
+
+Entity Archetype::remove_row(Location at) {
+    Chunk& last_chunk = m_chunks.back();
+    const uint32_t last_index = static_cast<uint32_t>(m_chunks.size() - 1);
+    const uint32_t last_row = last_chunk.count - 1;
+    const bool is_last = at.chunk == last_index && at.row == last_row;
+    touch(at.chunk);
+    touch(last_index);
+
+    Entity moved = NULL_ENTITY;
+    for (size_t i = 0; i < m_infos.size(); i++) {
+        const ComponentInfo& info = m_infos[i];
+        std::byte* hole = m_chunks[at.chunk].data + m_offsets[i] + at.row * info.size;
+        info.destroy(hole);
+        if (!is_last) {
+            std::byte* tail = last_chunk.data + m_offsets[i] + last_row * info.size;
+            info.move_construct(hole, tail);
+            info.destroy(tail);
+        }
+    }
+    if (!is_last) {
+        moved = entities(last_index)[last_row];
+        entities(at.chunk)[at.row] = moved;
+    }
+
+    last_chunk.count--;
+    m_size--;
+    if (last_chunk.count == 0) {
+        free_chunk(last_chunk);
+        m_chunks.pop_back();
+    }
+    return moved;
+}
+
+void Archetype::begin_snapshot() {
+    commit_snapshot();
+    m_snapshot = std::make_unique<Snapshot>();
+    m_snapshot->chunks.assign(m_chunks.size(), {nullptr, 0});
+    m_snapshot->saved = std::make_unique<std::atomic<bool>[]>(m_chunks.size());
+    m_snapshot->size = m_size;
+}
+
+void Archetype::save_chunk(size_t c) {
+    std::lock_guard<std::mutex> lock(m_snapshot->mutex);
+    if (m_snapshot->saved[c].load(std::memory_order_relaxed)) {
+        return;
+    }
+    const Chunk& chunk = m_chunks[c];
+    Chunk copy{allocate_chunk(), chunk.count};
+    std::memcpy(copy.data, chunk.data, chunk.count * sizeof(Entity));
+    for (size_t i = 0; i < m_infos.size(); i++) {
+        for (uint32_t row = 0; row < chunk.count; row++) {
+            const size_t offset = m_offsets[i] + row * m_infos[i].size;
+            m_infos[i].copy_construct(copy.data + offset, chunk.data + offset);
+        }
+    }
+    m_snapshot->chunks[c] = copy;
+    m_snapshot->bytes += m_chunk_bytes;
+    m_snapshot->saved[c].store(true, std::memory_order_release);
+}
+
+void Archetype::restore_snapshot() {
+    if (!m_snapshot) {
+        return;
+    }
+    // Written chunks and chunks added since are dropped; a saved chunk that
+    // was emptied (and freed) since comes back from its copy
+    Snapshot& snapshot = *m_snapshot;
+    const size_t saved_count = snapshot.chunks.size();
+    for (size_t c = 0; c < m_chunks.size(); c++) {
+        if (c >= saved_count || snapshot.saved[c].load(std::memory_order_relaxed)) {
+            free_chunk(m_chunks[c]);
+        }
+    }
+    m_chunks.resize(saved_count, {nullptr, 0});
+    for (size_t c = 0; c < saved_count; c++) {
+        if (snapshot.saved[c].load(std::memory_order_relaxed)) {
+            m_chunks[c] = snapshot.chunks[c];
+        }
+    }
+    m_size = snapshot.size;
+    m_snapshot.reset();
+}
+
+void Archetype::commit_snapshot() {
+    if (!m_snapshot) {
+        return;
+    }
+    for (size_t c = 0; c < m_snapshot->chunks.size(); c++) {
+        if (m_snapshot->saved[c].load(std::memory_order_relaxed)) {
+            free_chunk(m_snapshot->chunks[c]);
+        }
+    }
+    m_snapshot.reset();
+}
+
+} // namespace ascii
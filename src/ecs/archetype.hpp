@@ -0,0 +1,125 @@
+#pragma once
+
+#include "component.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ascii {
+
+// All entities with exactly one set of component types. Rows live in
+// fixed-size chunks; inside a chunk every component type is one contiguous
+// column (SoA), preceded by the entity column. Rows are kept dense: removal
+// moves the archetype's last row into the hole.
+class Archetype {
+public:
+    static constexpr size_t CHUNK_BYTES = 16 * 1024;
+    static constexpr size_t CHUNK_ALIGN = 64;
+
+    explicit Archetype(ComponentMask mask);
+    ~Archetype();
+
+    // Non-copyable
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    ComponentMask mask() const { return m_mask; }
+    const std::vector<ComponentId>& components() const { return m_components; }
+    bool has(ComponentId id) const { return m_column_of[id] >= 0; }
+
+    uint32_t chunk_capacity() const { return m_capacity; }
+    size_t chunk_count() const { return m_chunks.size(); }
+    uint32_t chunk_size(size_t chunk) const { return m_chunks[chunk].count; }
+    size_t size() const { return m_size; }
+
+    Entity* entities(size_t chunk) const {
+        return reinterpret_cast<Entity*>(m_chunks[chunk].data);
+    }
+
+    // Column base of a component in a chunk, nullptr if the archetype lacks it
+    void* column(size_t chunk, ComponentId id) const {
+        const int16_t index = m_column_of[id];
+        return index < 0 ? nullptr : m_chunks[chunk].data + m_offsets[index];
+    }
+    void* component(size_t chunk, uint32_t row, ComponentId id) const {
+        const int16_t index = m_column_of[id];
+        return m_chunks[chunk].data + m_offsets[index] + row * m_infos[index].size;
+    }
+
+    struct Location {
+        uint32_t chunk;
+        uint32_t row;
+    };
+
+    // New row with default-constructed components
+    Location allocate(Entity entity);
+
+    // New row in `to` whose shared components are moved from this row
+    // (the rest are default constructed). The source row is left moved-from;
+    // remove it with remove_row().
+    Location move_row_to(Location from, Archetype& to);
+
+    // Destroy the row's components and fill the hole with the last row.
+    // Returns the entity that moved into `at`, or NULL_ENTITY.
+    Entity remove_row(Location at);
+
+    // Copy-on-write snapshot. Taking one copies nothing; the first write to
+    // a chunk afterwards (touch) copies its rows aside. restore_snapshot()
+    // puts the copies back and drops chunks added since; commit_snapshot()
+    // frees the copies and keeps the current rows.
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot();
+    bool snapshot_active() const { return m_snapshot != nullptr; }
+    size_t snapshot_bytes() const { return m_snapshot ? m_snapshot->bytes : 0; }
+
+    // Call before writing a chunk's rows. Thread-safe; one atomic load once
+    // the chunk is saved or when no snapshot is active.
+    void touch(size_t chunk) {
+        if (m_snapshot && chunk < m_snapshot->chunks.size() &&
+            !m_snapshot->saved[chunk].load(std::memory_order_acquire)) {
+            save_chunk(chunk);
+        }
+    }
+
+    // Cached archetype transitions (add / remove one component)
+    std::array<Archetype*, MAX_COMPONENTS> add_edges{};
+    std::array<Archetype*, MAX_COMPONENTS> remove_edges{};
+
+private:
+    struct Chunk {
+        std::byte* data;
+        uint32_t count;
+    };
+
+    struct Snapshot {
+        std::vector<Chunk> chunks;                      // Copy of each chunk of the snapshot, once saved
+        std::unique_ptr<std::atomic<bool>[]> saved;     // Parallel to chunks
+        size_t size = 0;
+        size_t bytes = 0;
+        std::mutex mutex;
+    };
+
+    Location push_row(Entity entity);
+    std::byte* allocate_chunk() const;
+    void free_chunk(Chunk& chunk);
+    void save_chunk(size_t chunk);
+
+    ComponentMask m_mask;
+    std::vector<ComponentId> m_components;
+    std::vector<ComponentInfo> m_infos;            // Parallel to m_components
+    std::vector<size_t> m_offsets;                 // Column offsets inside a chunk
+    std::array<int16_t, MAX_COMPONENTS> m_column_of;
+    uint32_t m_capacity = 0;
+    size_t m_chunk_bytes = CHUNK_BYTES;
+    std::vector<Chunk> m_chunks;
+    size_t m_size = 0;
+    std::unique_ptr<Snapshot> m_snapshot;
+};
+
+} // namespace ascii
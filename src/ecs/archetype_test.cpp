@@ -0,0 +1,166 @@
+#include "ecs/archetype.hpp"
+#include "ecs/world.hpp"
+#include "core/test.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+struct Position {
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+// Not trivially copyable: snapshots copy-construct it
+struct Label {
+    std::string text;
+};
+
+struct Tag {
+    uint32_t value = 0;
+};
+
+Entity make_entity(uint32_t i) {
+    return {i, 1};
+}
+
+// An archetype of `count` rows, Position (i, -i) and Label "e<i>"
+void fill(Archetype& archetype, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const Archetype::Location at = archetype.allocate(make_entity(i));
+        *static_cast<Position*>(archetype.component(at.chunk, at.row, component_id<Position>())) = {float(i), -float(i)};
+        static_cast<Label*>(archetype.component(at.chunk, at.row, component_id<Label>()))->text = "e" + std::to_string(i);
+    }
+}
+
+// Rows as (entity, x, label), in chunk order
+std::vector<std::string> rows(const Archetype& archetype) {
+    std::vector<std::string> out;
+    for (size_t c = 0; c < archetype.chunk_count(); c++) {
+        const auto* positions = static_cast<const Position*>(archetype.column(c, component_id<Position>()));
+        const auto* labels = static_cast<const Label*>(archetype.column(c, component_id<Label>()));
+        for (uint32_t r = 0; r < archetype.chunk_size(c); r++) {
+            out.push_back(std::to_string(archetype.entities(c)[r].index) + ":" + std::to_string(positions[r].x) + ":" +
+                          labels[r].text);
+        }
+    }
+    return out;
+}
+
+// Writes, removals and growth during a snapshot all come undone; only the
+// chunks written were copied
+void restore_undoes_writes() {
+    Archetype archetype(component_mask<Position, Label>());
+    const uint32_t capacity = archetype.chunk_capacity();
+    fill(archetype, capacity * 3);
+    const std::vector<std::string> before = rows(archetype);
+    const size_t chunks = archetype.chunk_count();
+
+    archetype.begin_snapshot();
+    CHECK(archetype.snapshot_bytes() == 0);
+
+    archetype.touch(1);
+    static_cast<Position*>(archetype.column(1, component_id<Position>()))[0].x = 1e6f;
+    static_cast<Label*>(archetype.column(1, component_id<Label>()))[0].text = "written";
+    const size_t one_chunk = archetype.snapshot_bytes();
+    CHECK(one_chunk > 0);
+
+    archetype.remove_row({0, 3});                  // The last row moves into chunk 0
+    for (uint32_t i = 0; i < capacity * 2; i++) {  // Grows past the saved chunks
+        archetype.allocate(make_entity(100000 + i));
+    }
+    CHECK(archetype.chunk_count() > chunks);
+
+    archetype.restore_snapshot();
+    CHECK(!archetype.snapshot_active());
+    CHECK(archetype.size() == capacity * 3);
+    CHECK(archetype.chunk_count() == chunks);
+    CHECK(rows(archetype) == before);
+}
+
+// Restore after a chunk was emptied (and freed) during the snapshot
+void restore_brings_back_emptied_chunks() {
+    Archetype archetype(component_mask<Position, Label>());
+    const uint32_t capacity = archetype.chunk_capacity();
+    fill(archetype, capacity + capacity / 2);
+    const std::vector<std::string> before = rows(archetype);
+
+    archetype.begin_snapshot();
+    while (archetype.size() > 0) {
+        archetype.remove_row({0, 0});
+    }
+    archetype.restore_snapshot();
+    CHECK(archetype.size() == before.size());
+    CHECK(rows(archetype) == before);
+}
+
+void commit_keeps_writes() {
+    Archetype archetype(component_mask<Position, Label>());
+    fill(archetype, 10);
+    archetype.begin_snapshot();
+    archetype.touch(0);
+    static_cast<Label*>(archetype.column(0, component_id<Label>()))[2].text = "kept";
+    archetype.remove_row({0, 0});
+    archetype.commit_snapshot();
+    CHECK(!archetype.snapshot_active() && archetype.snapshot_bytes() == 0);
+    CHECK(archetype.size() == 9);
+    CHECK(static_cast<const Label*>(archetype.column(0, component_id<Label>()))[2].text == "kept");
+}
+
+// The same through the World: component writes, archetype moves, creates
+// and destroys are undone, and entities created during play stay dead
+void world_restore() {
+    World world;
+    std::vector<Entity> entities;
+    for (uint32_t i = 0; i < 5000; i++) {
+        entities.push_back(i % 3 ? world.spawn(Position{float(i), 0.0f}, Label{"e" + std::to_string(i)})
+                                 : world.spawn(Position{float(i), 0.0f}));
+    }
+    auto digest = [&]() {
+        double sum = 0.0;
+        world.each<const Position>([&](Entity entity, const Position& p) { sum += p.x * (entity.index + 1); });
+        world.each<const Label>([&](Entity, const Label& label) { sum += label.text.size(); });
+        world.each<const Tag>([&](Entity, const Tag& tag) { sum += tag.value; });
+        return sum;
+    };
+    const double before = digest();
+
+    world.begin_snapshot();
+    world.get<Position>(entities[10])->x = -1.0f;
+    world.get<Label>(entities[11])->text = "changed";
+    world.add(entities[12], Tag{7});
+    world.remove<Label>(entities[13]);
+    world.destroy(entities[14]);
+    const Entity created = world.spawn(Position{}, Tag{3});
+    world.each<Position>([](Entity, Position& p) { p.y += 1.0f; });
+    world.restore_snapshot();
+
+    CHECK(world.size() == entities.size());
+    CHECK(!world.alive(created));
+    for (Entity entity : entities) {
+        CHECK(world.alive(entity));
+    }
+    CHECK(world.get<const Position>(entities[10])->x == 10.0f);
+    CHECK(world.get<const Label>(entities[11])->text == "e11");
+    CHECK(!world.has<Tag>(entities[12]));
+    CHECK(world.has<Label>(entities[13]));
+    CHECK(digest() == before);
+
+    const Entity after = world.spawn(Position{});
+    CHECK(after != created && world.alive(after) && !world.alive(created));
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"restore_undoes_writes", restore_undoes_writes},
+        {"restore_brings_back_emptied_chunks", restore_brings_back_emptied_chunks},
+        {"commit_keeps_writes", commit_keeps_writes},
+        {"world_restore", world_restore},
+    });
+}
@@ -0,0 +1,41 @@
+#include "component.hpp"
+
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace ascii {
+
+namespace {
+
+// deque: references stay valid while other types register
+std::deque<ComponentInfo>& registry() {
+    static std::deque<ComponentInfo> infos;
+    return infos;
+}
+
+std::mutex& registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+} // anonymous namespace
+
+ComponentId register_component(const ComponentInfo& info) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    auto& infos = registry();
+    if (infos.size() >= MAX_COMPONENTS) {
+        throw std::runtime_error("Too many component types (max " + std::to_string(MAX_COMPONENTS) +
+                                 "), registering " + info.name);
+    }
+    infos.push_back(info);
+    return static_cast<ComponentId>(infos.size() - 1);
+}
+
+const ComponentInfo& component_info(ComponentId id) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    return registry()[id];
+}
+
+} // namespace ascii
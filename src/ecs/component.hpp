@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/slot_map.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace ascii {
+
+// Generational handle: stays valid while the entity lives and never
+// aliases a later entity that reuses its slot
+using Entity = Handle;
+constexpr Entity NULL_ENTITY{};
+
+// Component types get small dense ids the first time they are used, so an
+// archetype's component set fits one 64-bit mask
+using ComponentId = uint32_t;
+using ComponentMask = uint64_t;
+constexpr ComponentId MAX_COMPONENTS = 64;
+
+// Type-erased operations archetype columns need
+struct ComponentInfo {
+    const char* name;
+    size_t size;
+    size_t align;
+    void (*construct)(void* dst);                 // Default construct
+    void (*move_construct)(void* dst, void* src);
+    void (*copy_construct)(void* dst, const void* src);     // Snapshots
+    void (*destroy)(void* ptr);
+};
+
+// Thread-safe; throws std::runtime_error past MAX_COMPONENTS types
+ComponentId register_component(const ComponentInfo& info);
+const ComponentInfo& component_info(ComponentId id);
+
+// const T names the same component (read-only access in queries)
+template<typename T>
+ComponentId component_id() {
+    if constexpr (std::is_const_v<T>) {
+        return component_id<std::remove_const_t<T>>();
+    } else {
+        static const ComponentId id = register_component({
+            typeid(T).name(), sizeof(T), alignof(T),
+            [](void* dst) { new (dst) T(); },
+            [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+            [](void* dst, const void* src) { new (dst) T(*static_cast<const T*>(src)); },
+            [](void* ptr) { static_cast<T*>(ptr)->~T(); },
+        });
+        return id;
+    }
+}
+
+template<typename... Ts>
+ComponentMask component_mask() {
+    return (ComponentMask(0) | ... | (ComponentMask(1) << component_id<Ts>()));
+}
+
+} // namespace ascii
@@ -0,0 +1,448 @@
+#include "schema.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ascii {
+
+namespace {
+
+struct FieldTypeInfo {
+    const char* name;
+    SchemaFieldType type;
+    uint32_t lanes;
+    uint32_t lane_size;
+};
+
+const FieldTypeInfo FIELD_TYPES[] = {
+    {"int",   SchemaFieldType::Int,   1, sizeof(int32_t)},
+    {"float", SchemaFieldType::Float, 1, sizeof(float)},
+    {"bool",  SchemaFieldType::Bool,  1, sizeof(uint8_t)},
+    {"enum",  SchemaFieldType::Enum,  1, sizeof(uint16_t)},
+    {"vec2",  SchemaFieldType::Vec2,  2, sizeof(float)},
+    {"vec3",  SchemaFieldType::Vec3,  3, sizeof(float)},
+    {"color", SchemaFieldType::Color, 4, sizeof(float)},
+};
+
+const FieldTypeInfo& type_info(SchemaFieldType type) {
+    for (const auto& info : FIELD_TYPES) {
+        if (info.type == type) {
+            return info;
+        }
+    }
+    return FIELD_TYPES[1];
+}
+
+double clamp_value(const SchemaField& field, double value) {
+    switch (field.type) {
+        case SchemaFieldType::Int:
+            return std::clamp(std::round(value), std::max(field.min, -2147483648.0), std::min(field.max, 2147483647.0));
+        case SchemaFieldType::Float:
+            return std::clamp(value, field.min, field.max);
+        case SchemaFieldType::Bool:
+            return value != 0.0 ? 1.0 : 0.0;
+        case SchemaFieldType::Enum:
+            return field.options.empty() ? 0.0 : std::clamp(std::round(value), 0.0, double(field.options.size() - 1));
+        default:
+            return value;
+    }
+}
+
+// One scalar in the field's lane representation
+void store_scalar(SchemaFieldType type, std::byte* dst, double value) {
+    switch (type) {
+        case SchemaFieldType::Int: {
+            const int32_t v = static_cast<int32_t>(value);
+            std::memcpy(dst, &v, sizeof(v));
+            break;
+        }
+        case SchemaFieldType::Bool: {
+            const uint8_t v = value != 0.0;
+            std::memcpy(dst, &v, sizeof(v));
+            break;
+        }
+        case SchemaFieldType::Enum: {
+            const uint16_t v = static_cast<uint16_t>(value);
+            std::memcpy(dst, &v, sizeof(v));
+            break;
+        }
+        default: {
+            const float v = static_cast<float>(value);
+            std::memcpy(dst, &v, sizeof(v));
+            break;
+        }
+    }
+}
+
+double load_scalar(SchemaFieldType type, const std::byte* src) {
+    switch (type) {
+        case SchemaFieldType::Int: {
+            int32_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case SchemaFieldType::Bool: {
+            uint8_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case SchemaFieldType::Enum: {
+            uint16_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        default: {
+            float v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+    }
+}
+
+} // anonymous namespace
+
+bool parse_schema_field_type(std::string_view name, SchemaFieldType& out) {
+    for (const auto& info : FIELD_TYPES) {
+        if (name == info.name) {
+            out = info.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* schema_field_type_name(SchemaFieldType type) {
+    return type_info(type).name;
+}
+
+Schema::Schema(std::string name, std::vector<SchemaFieldDesc> fields) : m_name(std::move(name)) {
+    m_fields.reserve(fields.size());
+    for (auto& desc : fields) {
+        SchemaField field;
+        static_cast<SchemaFieldDesc&>(field) = std::move(desc);
+        const FieldTypeInfo& info = type_info(field.type);
+        field.lanes = info.lanes;
+        field.lane_size = info.lane_size;
+        m_fields.push_back(std::move(field));
+    }
+    std::sort(m_fields.begin(), m_fields.end(), [](const SchemaField& a, const SchemaField& b) {
+        return a.lane_size != b.lane_size ? a.lane_size > b.lane_size : a.name < b.name;
+    });
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < m_fields.size(); i++) {
+        SchemaField& field = m_fields[i];
+        field.offset = offset;
+        field.column = m_columns;
+        offset += field.lanes * field.lane_size;
+        m_columns += field.lanes;
+        m_field_of[field.name] = static_cast<int>(i);
+    }
+    m_stride = (offset + 3) & ~3u;
+
+    m_defaults.assign(m_stride, std::byte{0});
+    for (const SchemaField& field : m_fields) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            store_scalar(field.type, m_defaults.data() + field.offset + lane * field.lane_size,
+                         clamp_value(field, field.defaults[lane]));
+        }
+    }
+}
+
+int Schema::find(std::string_view field) const {
+    auto it = m_field_of.find(std::string(field));
+    return it == m_field_of.end() ? -1 : it->second;
+}
+
+SchemaStore::SchemaStore(Schema schema) : m_schema(std::move(schema)), m_columns(m_schema.column_count()) {}
+
+uint32_t SchemaStore::row(Entity entity) const {
+    if (entity.index >= m_row_of.size()) {
+        return NO_ROW;
+    }
+    const uint32_t r = m_row_of[entity.index];
+    return r != NO_ROW && m_entities[r] == entity ? r : NO_ROW;
+}
+
+uint32_t SchemaStore::add(Entity entity) {
+    if (const uint32_t existing = row(entity); existing != NO_ROW) {
+        return existing;
+    }
+    if (entity.index >= m_row_of.size()) {
+        m_row_of.resize(entity.index + 1, NO_ROW);
+    }
+    const uint32_t r = static_cast<uint32_t>(m_entities.size());
+    m_entities.push_back(entity);
+    m_row_journal.touch(m_row_of, entity.index);
+    m_row_of[entity.index] = r;
+    for (const SchemaField& field : m_schema.fields()) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            m_columns[field.column + lane].resize(m_entities.size() * field.lane_size);
+        }
+    }
+    unpack(r, m_schema.defaults().data());
+    return r;
+}
+
+bool SchemaStore::remove(Entity entity) {
+    const uint32_t r = row(entity);
+    if (r == NO_ROW) {
+        return false;
+    }
+    swap_remove(r);
+    return true;
+}
+
+void SchemaStore::swap_remove(uint32_t r) {
+    const uint32_t last = static_cast<uint32_t>(m_entities.size() - 1);
+    if (snapshot_active()) {
+        touch_row(r);
+        touch_row(last);
+        m_row_journal.touch(m_row_of, m_entities[r].index);
+        m_row_journal.touch(m_row_of, m_entities[last].index);
+    }
+    m_row_of[m_entities[r].index] = NO_ROW;
+    if (r != last) {
+        m_entities[r] = m_entities[last];
+        m_row_of[m_entities[r].index] = r;
+    }
+    m_entities.pop_back();
+    for (const SchemaField& field : m_schema.fields()) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            auto& column = m_columns[field.column + lane];
+            if (r != last) {
+                std::memcpy(column.data() + r * field.lane_size, column.data() + last * field.lane_size,
+                            field.lane_size);
+            }
+            column.resize(last * field.lane_size);
+        }
+    }
+}
+
+size_t SchemaStore::prune(const World& world) {
+    size_t removed = 0;
+    for (uint32_t r = static_cast<uint32_t>(m_entities.size()); r-- > 0;) {
+        if (!world.alive(m_entities[r])) {
+            swap_remove(r);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void SchemaStore::clear() {
+    commit_snapshot();
+    for (auto& column : m_columns) {
+        column.clear();
+    }
+    m_entities.clear();
+    m_row_of.clear();
+}
+
+void SchemaStore::redefine(Schema schema) {
+    // Same fields in the same columns (a script reloaded unchanged, or new
+    // defaults / ranges): the columns stay as they are
+    const auto& fields = schema.fields();
+    const bool same_layout = std::equal(fields.begin(), fields.end(), m_schema.fields().begin(), m_schema.fields().end(),
+                                        [](const SchemaField& a, const SchemaField& b) {
+                                            return a.name == b.name && a.type == b.type && a.column == b.column;
+                                        });
+    if (same_layout) {
+        m_schema = std::move(schema);
+        return;
+    }
+    commit_snapshot();
+    std::vector<std::vector<std::byte>> columns(schema.column_count());
+    const size_t rows = m_entities.size();
+    for (const SchemaField& field : schema.fields()) {
+        const int old_index = m_schema.find(field.name);
+        const SchemaField* old = old_index >= 0 ? &m_schema.fields()[old_index] : nullptr;
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            auto& column = columns[field.column + lane];
+            if (old && old->type == field.type) {
+                column = std::move(m_columns[old->column + lane]);
+                continue;
+            }
+            column.resize(rows * field.lane_size);
+            const std::byte* value = schema.defaults().data() + field.offset + lane * field.lane_size;
+            for (size_t r = 0; r < rows; r++) {
+                std::memcpy(column.data() + r * field.lane_size, value, field.lane_size);
+            }
+        }
+    }
+    m_schema = std::move(schema);
+    m_columns = std::move(columns);
+}
+
+size_t SchemaStore::memory_bytes() const {
+    size_t bytes = m_entities.capacity() * sizeof(Entity) + m_row_of.capacity() * sizeof(uint32_t);
+    for (const auto& column : m_columns) {
+        bytes += column.capacity();
+    }
+    return bytes;
+}
+
+double SchemaStore::get(uint32_t r, size_t field, uint32_t lane) const {
+    const SchemaField& f = m_schema.fields()[field];
+    return load_scalar(f.type, m_columns[f.column + lane].data() + r * f.lane_size);
+}
+
+void SchemaStore::set(uint32_t r, size_t field, uint32_t lane, double value) {
+    const SchemaField& f = m_schema.fields()[field];
+    if (!m_column_journals.empty()) {
+        m_column_journals[f.column + lane].touch(m_columns[f.column + lane], r * f.lane_size);
+    }
+    store_scalar(f.type, m_columns[f.column + lane].data() + r * f.lane_size, clamp_value(f, value));
+}
+
+void SchemaStore::pack(uint32_t r, std::byte* out) const {
+    for (const SchemaField& field : m_schema.fields()) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            std::memcpy(out + field.offset + lane * field.lane_size,
+                        m_columns[field.column + lane].data() + r * field.lane_size, field.lane_size);
+        }
+    }
+}
+
+void SchemaStore::unpack(uint32_t r, const std::byte* in) {
+    touch_row(r);
+    for (const SchemaField& field : m_schema.fields()) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            std::memcpy(m_columns[field.column + lane].data() + r * field.lane_size,
+                        in + field.offset + lane * field.lane_size, field.lane_size);
+        }
+    }
+}
+
+void SchemaStore::touch_row(uint32_t r) {
+    if (m_column_journals.empty()) {
+        return;
+    }
+    m_entity_journal.touch(m_entities, r);
+    for (const SchemaField& field : m_schema.fields()) {
+        for (uint32_t lane = 0; lane < field.lanes; lane++) {
+            m_column_journals[field.column + lane].touch(m_columns[field.column + lane], r * field.lane_size);
+        }
+    }
+}
+
+void SchemaStore::begin_snapshot() {
+    m_column_journals.assign(m_columns.size(), {});
+    for (size_t c = 0; c < m_columns.size(); c++) {
+        m_column_journals[c].begin(m_columns[c].size());
+    }
+    m_entity_journal.begin(m_entities.size());
+    m_row_journal.begin(m_row_of.size());
+}
+
+void SchemaStore::restore_snapshot() {
+    if (!snapshot_active()) {
+        return;
+    }
+    for (size_t c = 0; c < m_columns.size(); c++) {
+        m_column_journals[c].restore(m_columns[c]);
+    }
+    m_column_journals.clear();
+    m_entity_journal.restore(m_entities);
+    const size_t rows_of = m_row_of.size();
+    m_row_journal.restore(m_row_of);
+    m_row_of.resize(rows_of, NO_ROW);
+}
+
+void SchemaStore::commit_snapshot() {
+    m_column_journals.clear();
+    m_entity_journal.commit();
+    m_row_journal.commit();
+}
+
+size_t SchemaStore::snapshot_bytes() const {
+    size_t bytes = m_entity_journal.bytes() + m_row_journal.bytes();
+    for (const auto& journal : m_column_journals) {
+        bytes += journal.bytes();
+    }
+    return bytes;
+}
+
+SchemaStore& SchemaRegistry::define(const std::string& name, std::vector<SchemaFieldDesc> fields) {
+    Schema schema(name, std::move(fields));
+    auto it = m_stores.find(name);
+    if (it != m_stores.end()) {
+        it->second->redefine(std::move(schema));
+        return *it->second;
+    }
+    SchemaStore& store = *m_stores.emplace(name, std::make_unique<SchemaStore>(std::move(schema))).first->second;
+    if (m_snapshot_active) {
+        store.begin_snapshot();     // Empty at the snapshot, so restoring empties it
+    }
+    return store;
+}
+
+SchemaStore* SchemaRegistry::find(std::string_view name) {
+    auto it = m_stores.find(std::string(name));
+    return it == m_stores.end() ? nullptr : it->second.get();
+}
+
+void SchemaRegistry::remove(Entity entity) {
+    for (auto& [name, store] : m_stores) {
+        store->remove(entity);
+    }
+}
+
+size_t SchemaRegistry::prune(const World& world) {
+    size_t removed = 0;
+    for (auto& [name, store] : m_stores) {
+        removed += store->prune(world);
+    }
+    return removed;
+}
+
+void SchemaRegistry::clear() {
+    for (auto& [name, store] : m_stores) {
+        store->clear();
+    }
+    m_snapshot_active = false;
+}
+
+std::vector<const SchemaStore*> SchemaRegistry::stores() const {
+    std::vector<const SchemaStore*> out;
+    for (const auto& [name, store] : m_stores) {
+        out.push_back(store.get());
+    }
+    std::sort(out.begin(), out.end(), [](const SchemaStore* a, const SchemaStore* b) {
+        return a->schema().name() < b->schema().name();
+    });
+    return out;
+}
+
+void SchemaRegistry::begin_snapshot() {
+    for (auto& [name, store] : m_stores) {
+        store->begin_snapshot();
+    }
+    m_snapshot_active = true;
+}
+
+void SchemaRegistry::restore_snapshot() {
+    for (auto& [name, store] : m_stores) {
+        store->restore_snapshot();
+    }
+    m_snapshot_active = false;
+}
+
+void SchemaRegistry::commit_snapshot() {
+    for (auto& [name, store] : m_stores) {
+        store->commit_snapshot();
+    }
+    m_snapshot_active = false;
+}
+
+size_t SchemaRegistry::snapshot_bytes() const {
+    size_t bytes = 0;
+    for (const auto& [name, store] : m_stores) {
+        bytes += store->snapshot_bytes();
+    }
+    return bytes;
+}
+
+} // namespace ascii
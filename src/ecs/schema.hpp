@@ -0,0 +1,183 @@
+#pragma once
+
+#include "component.hpp"
+#include "core/page_journal.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class World;
+
+// Type.define field types that have a packed native form. string, asset,
+// ref, array and table fields stay in Lua.
+enum class SchemaFieldType : uint8_t { Int, Float, Bool, Enum, Vec2, Vec3, Color };
+
+// False for types without a native form
+bool parse_schema_field_type(std::string_view name, SchemaFieldType& out);
+const char* schema_field_type_name(SchemaFieldType type);
+
+// A field as declared (Type.normalizeField)
+struct SchemaFieldDesc {
+    std::string name;
+    SchemaFieldType type = SchemaFieldType::Float;
+    double defaults[4] = {0.0, 0.0, 0.0, 0.0};     // One per lane; Enum: option index
+    double min = -1e300;                            // Clamps Int/Float writes
+    double max = 1e300;
+    std::vector<std::string> options;               // Enum
+};
+
+struct SchemaField : SchemaFieldDesc {
+    uint32_t lanes = 1;         // Scalars per value (vec3: 3)
+    uint32_t lane_size = 4;     // Bytes per scalar (int32 / float; Enum uint16; Bool uint8)
+    uint32_t offset = 0;        // In the packed row
+    uint32_t column = 0;        // First lane's column in the store
+};
+
+// Compiled layout of one type. Fields are packed by scalar size (largest
+// first, then by name, since Lua hands them over in no particular order),
+// so a row has no padding inside; the row is padded to 4 bytes.
+class Schema {
+public:
+    Schema(std::string name, std::vector<SchemaFieldDesc> fields);
+
+    const std::string& name() const { return m_name; }
+    const std::vector<SchemaField>& fields() const { return m_fields; }
+    uint32_t stride() const { return m_stride; }
+    uint32_t column_count() const { return m_columns; }
+
+    // Field index, or -1
+    int find(std::string_view field) const;
+
+    // Packed row holding every field's default
+    const std::vector<std::byte>& defaults() const { return m_defaults; }
+
+private:
+    std::string m_name;
+    std::vector<SchemaField> m_fields;
+    std::unordered_map<std::string, int> m_field_of;
+    std::vector<std::byte> m_defaults;
+    uint32_t m_stride = 0;
+    uint32_t m_columns = 0;
+};
+
+// Instances of one schema, attached to entities. Every scalar lane is its
+// own contiguous column (SoA), so a system updating one field streams one
+// array; rows stay dense (removal moves the last row into the hole). Packed
+// rows (Schema offsets) are the unit for copying one instance in or out.
+class SchemaStore {
+public:
+    static constexpr uint32_t NO_ROW = 0xFFFFFFFFu;
+
+    explicit SchemaStore(Schema schema);
+
+    const Schema& schema() const { return m_schema; }
+
+    // Row of the entity's instance, adding one with the defaults if needed
+    uint32_t add(Entity entity);
+    bool remove(Entity entity);
+    uint32_t row(Entity entity) const;
+
+    // Drop the instances of destroyed entities; returns how many
+    size_t prune(const World& world);
+
+    // Drop every instance (ends an active snapshot, keeping the layout)
+    void clear();
+
+    // Replace the layout. Instances keep the values of fields that exist
+    // in both with the same type; new fields get their defaults. A changed
+    // layout ends an active snapshot, keeping the current state.
+    void redefine(Schema schema);
+
+    size_t size() const { return m_entities.size(); }
+    const Entity* entities() const { return m_entities.data(); }
+    size_t memory_bytes() const;
+
+    // Lane column of a field: int32_t (Int), float (Float, vectors, Color),
+    // uint16_t (Enum option) or uint8_t (Bool)
+    // Counts as a write of the whole lane for an active snapshot.
+    template<typename T>
+    T* column(size_t field, uint32_t lane = 0) {
+        auto& column = m_columns[m_schema.fields()[field].column + lane];
+        if (!m_column_journals.empty()) {
+            m_column_journals[m_schema.fields()[field].column + lane].touch_range(column, 0, column.size());
+        }
+        return reinterpret_cast<T*>(column.data());
+    }
+    template<typename T>
+    const T* column(size_t field, uint32_t lane = 0) const {
+        return reinterpret_cast<const T*>(m_columns[m_schema.fields()[field].column + lane].data());
+    }
+
+    // One lane as a double; set() clamps to the field's range and rounds ints
+    double get(uint32_t row, size_t field, uint32_t lane = 0) const;
+    void set(uint32_t row, size_t field, uint32_t lane, double value);
+
+    void pack(uint32_t row, std::byte* out) const;
+    void unpack(uint32_t row, const std::byte* in);
+
+    // Copy-on-write snapshot (play mode), page-granular per column
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot();
+    bool snapshot_active() const { return m_entity_journal.active(); }
+    size_t snapshot_bytes() const;
+
+private:
+    static constexpr size_t JOURNAL_PAGE = 4096;
+
+    void swap_remove(uint32_t row);
+    void touch_row(uint32_t row);
+
+    Schema m_schema;
+    std::vector<std::vector<std::byte>> m_columns;  // By lane
+    std::vector<Entity> m_entities;                 // By row
+    std::vector<uint32_t> m_row_of;                 // Entity index -> row
+
+    std::vector<PageJournal<std::byte, JOURNAL_PAGE>> m_column_journals;    // Empty without a snapshot
+    PageJournal<Entity> m_entity_journal;
+    PageJournal<uint32_t> m_row_journal;
+};
+
+// Every compiled type by name. Stores live as long as the registry, so
+// pointers to them stay valid across redefinitions.
+class SchemaRegistry {
+public:
+    // Compile a type, or recompile it in place (hot reload)
+    SchemaStore& define(const std::string& name, std::vector<SchemaFieldDesc> fields);
+
+    // nullptr for unknown types
+    SchemaStore* find(std::string_view name);
+
+    // Remove every instance of entity
+    void remove(Entity entity);
+
+    // Drop instances of destroyed entities (after structural changes)
+    size_t prune(const World& world);
+
+    // Drop every instance; the types stay defined. Ends an active snapshot.
+    void clear();
+
+    size_t size() const { return m_stores.size(); }
+
+    // Every store, by type name
+    std::vector<const SchemaStore*> stores() const;
+
+    // Snapshot of every store; types defined since come back empty
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot();
+    size_t snapshot_bytes() const;
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<SchemaStore>> m_stores;
+    bool m_snapshot_active = false;
+};
+
+} // namespace ascii
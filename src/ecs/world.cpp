@@ -0,0 +1,217 @@
+#include "world.hpp"
+
+#include <algorithm>
+
+namespace ascii {
+
+void CommandBuffer::push(std::function<void(World&)> fn) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.push_back(std::move(fn));
+}
+
+void CommandBuffer::destroy(Entity entity) {
+    push([entity](World& world) { world.destroy(entity); });
+}
+
+bool CommandBuffer::empty() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_commands.empty();
+}
+
+void CommandBuffer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.clear();
+}
+
+void CommandBuffer::apply(World& world) {
+    // Commands may record more commands; those run in the same flush
+    for (;;) {
+        std::vector<std::function<void(World&)>> commands;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            commands.swap(m_commands);
+        }
+        if (commands.empty()) {
+            return;
+        }
+        for (auto& command : commands) {
+            command(world);
+        }
+    }
+}
+
+EntityImage& EntityImage::operator=(EntityImage&& other) noexcept {
+    if (this != &other) {
+        reset();
+        m_entity = other.m_entity;
+        m_mask = other.m_mask;
+        m_ids = std::move(other.m_ids);
+        m_offsets = std::move(other.m_offsets);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        other.m_ids.clear();
+    }
+    return *this;
+}
+
+void EntityImage::reset() {
+    for (size_t i = 0; i < m_ids.size() && m_data; i++) {
+        component_info(m_ids[i]).destroy(m_data + m_offsets[i]);
+    }
+    ::operator delete[](m_data, std::align_val_t(Archetype::CHUNK_ALIGN));
+    m_data = nullptr;
+    m_size = 0;
+    m_ids.clear();
+    m_offsets.clear();
+}
+
+EntityImage World::capture(Entity entity) const {
+    EntityImage image;
+    const Record* record = m_records.get(entity);
+    if (!record) {
+        return image;
+    }
+    const Archetype& archetype = *record->archetype;
+    image.m_entity = entity;
+    image.m_mask = archetype.mask();
+    image.m_ids = archetype.components();
+    for (ComponentId id : image.m_ids) {
+        const ComponentInfo& info = component_info(id);
+        image.m_size = (image.m_size + info.align - 1) / info.align * info.align;
+        image.m_offsets.push_back(image.m_size);
+        image.m_size += info.size;
+    }
+    image.m_data = static_cast<std::byte*>(::operator new[](std::max<size_t>(image.m_size, 1),
+                                                             std::align_val_t(Archetype::CHUNK_ALIGN)));
+    for (size_t i = 0; i < image.m_ids.size(); i++) {
+        const ComponentId id = image.m_ids[i];
+        component_info(id).copy_construct(image.m_data + image.m_offsets[i],
+                                          archetype.component(record->chunk, record->row, id));
+    }
+    return image;
+}
+
+Entity World::create(const EntityImage& image) {
+    const Entity entity = create(image.m_mask);
+    const Record& record = *std::as_const(m_records).get(entity);
+    for (size_t i = 0; i < image.m_ids.size(); i++) {
+        const ComponentInfo& info = component_info(image.m_ids[i]);
+        void* component = record.archetype->component(record.chunk, record.row, image.m_ids[i]);
+        info.destroy(component);
+        info.copy_construct(component, image.m_data + image.m_offsets[i]);
+    }
+    return entity;
+}
+
+Archetype& World::archetype_for(ComponentMask mask) {
+    auto it = m_archetypes.find(mask);
+    if (it != m_archetypes.end()) {
+        return *it->second;
+    }
+    auto archetype = std::make_unique<Archetype>(mask);
+    Archetype& result = *archetype;
+    if (m_snapshot_active) {
+        result.begin_snapshot();    // Empty at the snapshot, so restoring empties it
+    }
+    m_archetype_list.push_back(archetype.get());
+    m_archetypes.emplace(mask, std::move(archetype));
+    return result;
+}
+
+Entity World::create(ComponentMask mask) {
+    Archetype& archetype = archetype_for(mask);
+    const Entity entity = m_records.insert({&archetype, 0, 0});
+    Archetype::Location at = archetype.allocate(entity);
+    Record& record = *m_records.get(entity);
+    record.chunk = at.chunk;
+    record.row = at.row;
+    m_structure_version++;
+    return entity;
+}
+
+void World::remove_from_archetype(Entity entity) {
+    const Record& record = *m_records.get(entity);
+    Entity moved = record.archetype->remove_row({record.chunk, record.row});
+    if (moved != NULL_ENTITY) {
+        Record& moved_record = *m_records.get(moved);
+        moved_record.chunk = record.chunk;
+        moved_record.row = record.row;
+    }
+}
+
+void World::destroy(Entity entity) {
+    if (!alive(entity)) {
+        return;
+    }
+    remove_from_archetype(entity);
+    m_records.erase(entity);
+    m_structure_version++;
+}
+
+void World::change_archetype(Entity entity, ComponentId id, bool add) {
+    Record& record = *m_records.get(entity);
+    Archetype& from = *record.archetype;
+
+    auto& edges = add ? from.add_edges : from.remove_edges;
+    if (!edges[id]) {
+        const ComponentMask bit = ComponentMask(1) << id;
+        edges[id] = &archetype_for(add ? (from.mask() | bit) : (from.mask() & ~bit));
+    }
+    Archetype& to = *edges[id];
+
+    Archetype::Location at = from.move_row_to({record.chunk, record.row}, to);
+    remove_from_archetype(entity);
+    record = {&to, at.chunk, at.row};
+    m_structure_version++;
+}
+
+void World::clear() {
+    commit_snapshot();
+    m_records.clear();
+    m_archetype_list.clear();
+    m_archetypes.clear();
+    m_structure_version++;
+}
+
+void World::begin_snapshot() {
+    commit_snapshot();
+    m_records.begin_snapshot();
+    for (Archetype* archetype : m_archetype_list) {
+        archetype->begin_snapshot();
+    }
+    m_snapshot_active = true;
+}
+
+void World::restore_snapshot() {
+    if (!m_snapshot_active) {
+        return;
+    }
+    m_commands.clear();
+    m_records.restore_snapshot();
+    for (Archetype* archetype : m_archetype_list) {
+        archetype->restore_snapshot();
+    }
+    m_snapshot_active = false;
+    m_structure_version++;
+}
+
+void World::commit_snapshot() {
+    if (!m_snapshot_active) {
+        return;
+    }
+    m_records.commit_snapshot();
+    for (Archetype* archetype : m_archetype_list) {
+        archetype->commit_snapshot();
+    }
+    m_snapshot_active = false;
+}
+
+size_t World::snapshot_bytes() const {
+    size_t bytes = m_records.snapshot_bytes();
+    for (const Archetype* archetype : m_archetype_list) {
+        bytes += archetype->snapshot_bytes();
+    }
+    return bytes;
+}
+
+} // namespace ascii
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "archetype.hpp"
+#include "component.hpp"
+#include "core/job_system.hpp"
+#include "core/slot_map.hpp"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ascii {
+
+class World;
+
+// Structural changes recorded while systems run (possibly from several
+// jobs at once) and applied in order at the next World::flush().
+class CommandBuffer {
+public:
+    void destroy(Entity entity);
+
+    template<typename T>
+    void add(Entity entity, T value);
+
+    template<typename T>
+    void remove(Entity entity);
+
+    // Any other deferred edit, e.g. creating an entity
+    void run(std::function<void(World&)> fn) { push(std::move(fn)); }
+
+    bool empty() const;
+    void apply(World& world);
+
+    // Drop pending commands
+    void clear();
+
+private:
+    void push(std::function<void(World&)> fn);
+
+    mutable std::mutex m_mutex;
+    std::vector<std::function<void(World&)>> m_commands;
+};
+
+// Copies of one entity's components, to create an equal entity later
+// (undoing a destroy). Independent of the world once taken.
+class EntityImage {
+public:
+    EntityImage() = default;
+    ~EntityImage() { reset(); }
+
+    EntityImage(EntityImage&& other) noexcept { *this = std::move(other); }
+    EntityImage& operator=(EntityImage&& other) noexcept;
+    EntityImage(const EntityImage&) = delete;
+    EntityImage& operator=(const EntityImage&) = delete;
+
+    // Entity the image was taken from
+    Entity entity() const { return m_entity; }
+    ComponentMask mask() const { return m_mask; }
+    size_t bytes() const { return m_size; }
+
+    // nullptr if the entity lacked T
+    template<typename T>
+    T* get() {
+        const ComponentId id = component_id<T>();
+        for (size_t i = 0; i < m_ids.size(); i++) {
+            if (m_ids[i] == id) {
+                return reinterpret_cast<T*>(m_data + m_offsets[i]);
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    friend class World;
+
+    void reset();
+
+    Entity m_entity = NULL_ENTITY;
+    ComponentMask m_mask = 0;
+    std::vector<ComponentId> m_ids;
+    std::vector<size_t> m_offsets;
+    std::byte* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// One chunk of an archetype as seen by a query
+class ChunkView {
+public:
+    ChunkView(Archetype& archetype, size_t chunk) : m_archetype(&archetype), m_chunk(chunk) {}
+
+    uint32_t size() const { return m_archetype->chunk_size(m_chunk); }
+    const Entity* entities() const { return m_archetype->entities(m_chunk); }
+    ComponentMask mask() const { return m_archetype->mask(); }
+
+    // Column pointer, nullptr when the archetype lacks T (optional
+    // components). Read-only systems ask for const T, which does not count
+    // as a write to an active snapshot.
+    template<typename T>
+    T* column() const {
+        void* column = m_archetype->column(m_chunk, component_id<T>());
+        if constexpr (!std::is_const_v<T>) {
+            if (column) {
+                m_archetype->touch(m_chunk);
+            }
+        }
+        return static_cast<T*>(column);
+    }
+
+private:
+    Archetype* m_archetype;
+    size_t m_chunk;
+};
+
+// Archetype-based entity store. Entities with the same component types
+// share an archetype; queries visit the archetypes whose mask contains the
+// requested types and hand out whole chunks, so systems run tight loops
+// over SoA columns. Structural changes (create, destroy, add, remove) move
+// rows between archetypes and must not happen while a query runs; systems
+// record them in commands() and they are applied at flush().
+class World {
+public:
+    World() = default;
+
+    // Non-copyable
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Entity with default-constructed components of the given types
+    Entity create(ComponentMask mask = 0);
+
+    template<typename... Ts>
+    Entity spawn(Ts... values) {
+        Entity entity = create(component_mask<Ts...>());
+        ((*get<Ts>(entity) = std::move(values)), ...);
+        return entity;
+    }
+
+    void destroy(Entity entity);
+
+    // Copy every component of a live entity; create() makes a new entity
+    // holding copies of the image's components
+    EntityImage capture(Entity entity) const;
+    Entity create(const EntityImage& image);
+
+    bool alive(Entity entity) const { return m_records.contains(entity); }
+    size_t size() const { return m_records.size(); }
+
+    // Every live entity, in no particular order (dense, so a linear scan)
+    Entity entity_at(size_t i) const { return m_records.handle_at(i); }
+
+    template<typename T>
+    T& add(Entity entity, T value = T{}) {
+        const ComponentId id = component_id<T>();
+        if (!has(entity, id)) {
+            change_archetype(entity, id, true);
+        }
+        T* component = get<T>(entity);
+        *component = std::move(value);
+        return *component;
+    }
+
+    template<typename T>
+    void remove(Entity entity) {
+        const ComponentId id = component_id<T>();
+        if (has(entity, id)) {
+            change_archetype(entity, id, false);
+        }
+    }
+
+    template<typename T>
+    bool has(Entity entity) const { return has(entity, component_id<T>()); }
+
+    // nullptr if the entity is dead or lacks T. Pointers are invalidated by
+    // structural changes. get<T> on a non-const world counts as a write to
+    // an active snapshot; readers use get<const T>.
+    template<typename T>
+    T* get(Entity entity) {
+        const Record* record = std::as_const(m_records).get(entity);
+        const ComponentId id = component_id<T>();
+        if (!record || !record->archetype->has(id)) {
+            return nullptr;
+        }
+        if constexpr (!std::is_const_v<T>) {
+            record->archetype->touch(record->chunk);
+        }
+        return static_cast<T*>(record->archetype->component(record->chunk, record->row, id));
+    }
+    template<typename T>
+    const T* get(Entity entity) const {
+        const Record* record = m_records.get(entity);
+        const ComponentId id = component_id<T>();
+        if (!record || !record->archetype->has(id)) {
+            return nullptr;
+        }
+        return static_cast<const T*>(record->archetype->component(record->chunk, record->row, id));
+    }
+
+    // fn(ChunkView&) for every chunk holding all of Ts...
+    template<typename... Ts, typename Fn>
+    void each_chunk(Fn&& fn) {
+        const ComponentMask mask = component_mask<Ts...>();
+        for (Archetype* archetype : m_archetype_list) {
+            if ((archetype->mask() & mask) != mask) {
+                continue;
+            }
+            for (size_t c = 0; c < archetype->chunk_count(); c++) {
+                ChunkView view(*archetype, c);
+                fn(view);
+            }
+        }
+    }
+
+    // fn(Entity, Ts&...) for every entity holding all of Ts...
+    template<typename... Ts, typename Fn>
+    void each(Fn&& fn) {
+        each_chunk<Ts...>([&](ChunkView& chunk) {
+            std::tuple<Ts*...> columns(chunk.column<Ts>()...);
+            const Entity* entities = chunk.entities();
+            const uint32_t count = chunk.size();
+            for (uint32_t i = 0; i < count; i++) {
+                fn(entities[i], std::get<Ts*>(columns)[i]...);
+            }
+        });
+    }
+
+    // Matching chunks in query order, for systems that split work
+    template<typename... Ts>
+    std::vector<ChunkView> chunks() {
+        std::vector<ChunkView> out;
+        each_chunk<Ts...>([&](ChunkView& chunk) { out.push_back(chunk); });
+        return out;
+    }
+
+    // each_chunk with chunks spread over the job system
+    template<typename... Ts, typename Fn>
+    void parallel_each_chunk(JobSystem& jobs, Fn&& fn) {
+        std::vector<ChunkView> list = chunks<Ts...>();
+        jobs.parallel_for(list.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                fn(list[i]);
+            }
+        });
+    }
+
+    template<typename... Ts>
+    size_t count() {
+        size_t total = 0;
+        each_chunk<Ts...>([&](ChunkView& chunk) { total += chunk.size(); });
+        return total;
+    }
+
+    // Deferred structural changes; flush() is the sync point that applies them
+    CommandBuffer& commands() { return m_commands; }
+    void flush() { m_commands.apply(*this); }
+
+    // Bumped by every structural change
+    uint64_t structure_version() const { return m_structure_version; }
+
+    // Ends an active snapshot, keeping the current state
+    void clear();
+
+    // Copy-on-write snapshot of every entity and component (play mode).
+    // Taking one copies nothing: each archetype only notes its chunk count,
+    // and the first write to a chunk afterwards copies that chunk aside
+    // (writes go through get<T>, non-const query columns and structural
+    // changes). restore_snapshot() swaps the copies back, so its cost is the
+    // number of chunks and record pages written since; it drops pending
+    // commands and counts as a structural change.
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot();
+    bool snapshot_active() const { return m_snapshot_active; }
+    size_t snapshot_bytes() const;
+
+    // Mark the entity's row as about to be written through a pointer taken
+    // before the snapshot began (e.g. cached by a system). Thread-safe.
+    void touch(Entity entity) const {
+        if (const Record* record = m_records.get(entity)) {
+            record->archetype->touch(record->chunk);
+        }
+    }
+
+private:
+    struct Record {
+        Archetype* archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+    };
+
+    bool has(Entity entity, ComponentId id) const {
+        const Record* record = m_records.get(entity);
+        return record && record->archetype->has(id);
+    }
+    Archetype& archetype_for(ComponentMask mask);
+    void change_archetype(Entity entity, ComponentId id, bool add);
+    void remove_from_archetype(Entity entity);
+
+    SlotMap<Record> m_records;
+    std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_archetypes;
+    std::vector<Archetype*> m_archetype_list;          // Creation order, for stable queries
+    CommandBuffer m_commands;
+    uint64_t m_structure_version = 0;
+    bool m_snapshot_active = false;
+};
+
+template<typename T>
+void CommandBuffer::add(Entity entity, T value) {
+    push([entity, value = std::move(value)](World& world) mutable {
+        if (world.alive(entity)) {
+            world.add<T>(entity, std::move(value));
+        }
+    });
+}
+
+template<typename T>
+void CommandBuffer::remove(Entity entity) {
+    push([entity](World& world) { world.remove<T>(entity); });
+}
+
+} // namespace ascii
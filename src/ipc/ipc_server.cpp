@@ -6,15 +6,26 @@
 
 #include <mutex>
 #include <set>
+#include <vector>
 
 namespace ascii {
 
 struct IPCServer::Impl {
+    // A request waiting for poll(), answered on ws if it is still connected
+    struct Request {
+        ix::WebSocket* ws;
+        std::string id;
+        std::string method;
+        json params;
+    };
+
     uint16_t port;
     ix::WebSocketServer server;
     std::unordered_map<std::string, CommandHandler> handlers;
     std::set<ix::WebSocket*> clients;
     std::mutex clients_mutex;
+    std::vector<Request> requests;
+    std::mutex requests_mutex;
     bool running = false;
 
     Impl(uint16_t p) : port(p), server(p, "127.0.0.1") {
@@ -22,6 +33,7 @@ struct IPCServer::Impl {
         server.disablePerMessageDeflate();
     }
 
+    // Network thread: validate and queue, the handler runs in poll()
     void handle_message(ix::WebSocket& ws, const std::string& msg) {
         try {
             auto request = json::parse(msg);
@@ -41,37 +53,39 @@ struct IPCServer::Impl {
                 return;
             }
 
-            // Find and call handler
-            auto it = handlers.find(method);
-            if (it == handlers.end()) {
-                send_error(ws, id, "Unknown method: " + method);
-                return;
-            }
-
-            try {
-                json result = it->second(params);
-                send_response(ws, id, true, result);
-            } catch (const std::exception& e) {
-                send_error(ws, id, e.what());
-            }
+            std::lock_guard<std::mutex> lock(requests_mutex);
+            requests.push_back({&ws, std::move(id), std::move(method), std::move(params)});
         } catch (const json::parse_error& e) {
             spdlog::error("[IPC] JSON parse error: {}", e.what());
         }
     }
 
-    void send_response(ix::WebSocket& ws, const std::string& id,
-                       bool success, const json& data) {
+    // Owning thread: find and call the handler, then reply
+    void dispatch(const Request& request) {
         json response = {
             {"type", "response"},
-            {"id", id},
-            {"success", success}
+            {"id", request.id}
         };
-        if (success) {
-            response["data"] = data;
+        auto it = handlers.find(request.method);
+        if (it == handlers.end()) {
+            response["success"] = false;
+            response["error"] = "Unknown method: " + request.method;
         } else {
-            response["error"] = data.get<std::string>();
+            try {
+                response["data"] = it->second(request.params);
+                response["success"] = true;
+            } catch (const std::exception& e) {
+                response["success"] = false;
+                response["error"] = e.what();
+            }
+        }
+
+        // The client may have disconnected while the request was queued;
+        // holding the lock keeps its socket alive until the send returns
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        if (clients.count(request.ws) > 0) {
+            request.ws->send(response.dump());
         }
-        ws.send(response.dump());
     }
 
     void send_error(ix::WebSocket& ws, const std::string& id,
@@ -165,6 +179,10 @@ void IPCServer::stop() {
         std::lock_guard<std::mutex> lock(m_impl->clients_mutex);
         m_impl->clients.clear();
     }
+    {
+        std::lock_guard<std::mutex> lock(m_impl->requests_mutex);
+        m_impl->requests.clear();
+    }
 
     spdlog::info("[IPC] Server stopped");
 }
@@ -178,6 +196,17 @@ void IPCServer::register_command(const std::string& method, CommandHandler handl
     spdlog::debug("[IPC] Registered command: {}", method);
 }
 
+void IPCServer::poll() {
+    std::vector<Impl::Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->requests_mutex);
+        requests.swap(m_impl->requests);
+    }
+    for (const Impl::Request& request : requests) {
+        m_impl->dispatch(request);
+    }
+}
+
 void IPCServer::emit_event(const std::string& event, const json& data) {
     json message = {
         {"type", "event"},
@@ -10,7 +10,7 @@ namespace ascii {
 
 using json = nlohmann::json;
 
-// Handler for IPC commands
+// Handler for IPC commands, run on the thread that calls poll()
 // Receives: params JSON object
 // Returns: result JSON object (will be wrapped in response)
 using CommandHandler = std::function<json(const json& params)>;
@@ -37,6 +37,12 @@ public:
     // handler: Function to handle the command
     void register_command(const std::string& method, CommandHandler handler);
 
+    // Run the handlers of the requests received since the last call and
+    // send their responses. Requests arrive on the server's network thread
+    // and are only queued there, so handlers may touch engine state as
+    // long as poll() is called from the thread that owns it.
+    void poll();
+
     // Emit an event to all connected clients
     // event: Event name (e.g., "frame_rendered", "lua_error")
     // data: Event payload
@@ -1,8 +1,35 @@
 #include "core/window.hpp"
 #include "core/vulkan_context.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "ecs/schema.hpp"
 #include "renderer/acceleration.hpp"
 #include "renderer/rt_pipeline.hpp"
+#include "renderer/lod_system.hpp"
+#include "renderer/particle_system.hpp"
+#include "world/tilemap.hpp"
+#include "world/tilemap_renderer.hpp"
+#include "world/field_of_view.hpp"
+#include "world/pathfinding.hpp"
+#include "scene/scene_json.hpp"
+#include "scene/scene_physics.hpp"
+#include "scene/scene_proximity.hpp"
+#include "scene/scene_binary.hpp"
+#include "scene/scene_instantiate.hpp"
+#include "scene/scene_world.hpp"
+#include "scene/scene_query.hpp"
+#include "scene/play_snapshot.hpp"
+#include "scene/edit_history.hpp"
+#include "scene/state_file.hpp"
+#include "scene/transform_hierarchy.hpp"
+#include "scene/tween_system.hpp"
+#include "scripting/lua_runtime.hpp"
+#include "scripting/engine_api.hpp"
+#include "scripting/coroutine_scheduler.hpp"
+#include "scripting/lua_workers.hpp"
+#include "scripting/lua_profiler.hpp"
 #include "ipc/ipc_server.hpp"
+#include "bench/bench.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -11,7 +38,10 @@
 #include <spdlog/spdlog.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
@@ -20,6 +50,7 @@
 #include <vector>
 #include <thread>
 #include <chrono>
+#include <unordered_map>
 
 // Command line options
 struct LaunchOptions {
@@ -33,6 +64,11 @@ struct LaunchOptions {
     bool editor_mode = false;    // If true, don't capture mouse (for use with editor)
     uint64_t parent_hwnd = 0;    // Parent window handle for embedding (0 = standalone)
     bool no_vulkan = false;      // Disable Vulkan, just test window embedding with GDI
+    bool static_geometry = true; // Bake tilemap chunks into merged meshes (false = one cube per tile)
+    std::string bench;           // Run an offline benchmark and exit (see bench/bench.hpp)
+    std::string scene;           // Load this scene (.json or binary .ascn) instead of the built-in dungeon
+    std::string convert_from;    // Convert a scene between scene.json and .ascn, then exit
+    std::string convert_to;
 };
 
 // Simple PPM image writer (no external dependencies)
@@ -88,6 +124,15 @@ LaunchOptions parse_args(int argc, char* argv[]) {
             opts.parent_hwnd = std::strtoull(argv[++i], nullptr, 10);
         } else if (std::strcmp(argv[i], "--no-vulkan") == 0) {
             opts.no_vulkan = true;
+        } else if (std::strcmp(argv[i], "--no-static-geometry") == 0) {
+            opts.static_geometry = false;
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            opts.bench = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "all";
+        } else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            opts.scene = argv[++i];
+        } else if (std::strcmp(argv[i], "--convert-scene") == 0 && i + 2 < argc) {
+            opts.convert_from = argv[++i];
+            opts.convert_to = argv[++i];
         }
     }
     return opts;
@@ -95,6 +140,8 @@ LaunchOptions parse_args(int argc, char* argv[]) {
 
 namespace {
 
+const glm::quat NO_ROTATION(1.0f, 0.0f, 0.0f, 0.0f);
+
 // Helper to insert image memory barrier
 void transition_image(VkCommandBuffer cmd, VkImage image,
                       VkImageLayout old_layout, VkImageLayout new_layout,
@@ -126,229 +173,203 @@ void transition_image(VkCommandBuffer cmd, VkImage image,
     vkCmdPipelineBarrier2(cmd, &dependency);
 }
 
-// Helper to add a letter "A" composed of cube instances
-// This ensures proper normals since each cube is axis-aligned in local space
-void add_letter_a(uint32_t cube_blas,
-                  std::vector<ascii::Instance>& instances,
-                  std::vector<ascii::GlyphInstance>& glyph_data,
+// Helper to add a letter "A" as one glyph mesh instance. The instance is
+// tracked by the LOD system, which swaps its BLAS as it shrinks on screen.
+void add_letter_a(ascii::LodSystem& lod,
+                  uint32_t chain_id,
+                  const ascii::GlyphLodChain& chain,
+                  ascii::InstanceStore& instances,
+                  ascii::MaterialTable& materials,
                   const glm::vec3& position,
                   float scale,
                   float yRotation,
                   const glm::vec4& color,
                   const glm::vec4& emission)
 {
-    // Letter A dimensions (in local space, will be scaled)
-    const float width = 1.0f;
-    const float height = 1.5f;
-    const float depth = 0.3f;
-    const float leg_width = 0.15f;
-    const float crossbar_height = 0.5f;
-
-    // Rotation matrix for the whole letter
-    glm::mat4 base_transform = glm::translate(glm::mat4(1.0f), position);
-    base_transform = glm::rotate(base_transform, yRotation, glm::vec3(0, 1, 0));
-    base_transform = glm::scale(base_transform, glm::vec3(scale));
-
-    // Left leg - angled outward
-    {
-        ascii::Instance inst;
-        inst.transform = base_transform;
-        inst.transform = glm::translate(inst.transform, glm::vec3(-width * 0.22f, 0.0f, 0.0f));
-        inst.transform = glm::rotate(inst.transform, glm::radians(-12.0f), glm::vec3(0, 0, 1));
-        inst.transform = glm::scale(inst.transform, glm::vec3(leg_width, height * 0.9f, depth));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = color;
-        glyph.emission = emission;
-        glyph_data.push_back(glyph);
+    // The glyph mesh is 1 unit tall; the letter used to be 1.5 units at scale 1
+    const float mesh_scale = scale * 1.5f;
+
+    uint16_t material = materials.add({color, emission});
+    uint32_t index = instances.add(position,
+                                   glm::angleAxis(yRotation, glm::vec3(0, 1, 0)),
+                                   glm::vec3(mesh_scale),
+                                   chain.blas[0],
+                                   ascii::MaterialTable::custom_index(material));
+    lod.track(index, chain_id, position, mesh_scale);
+}
+
+// Tile as sent over IPC: {"glyph": "#", "material": id, "height": 1.0}; null
+// clears. False for a material id the table doesn't have.
+bool tile_from_json(const ascii::json& value, const ascii::MaterialTable& materials, ascii::Tile& tile) {
+    tile = ascii::Tile();
+    if (!value.is_object()) {
+        return true;
     }
+    if (value.contains("glyph")) {
+        const auto& glyph = value["glyph"];
+        tile.glyph = glyph.is_string() ? ascii::decode_glyph(glyph.get<std::string>()) : glyph.get<uint32_t>();
+    }
+    const int64_t material = value.value("material", int64_t(0));
+    if (material < 0 || !materials.contains(static_cast<uint32_t>(material))) {
+        return false;
+    }
+    tile.material = static_cast<uint16_t>(material);
+    tile.height = value.value("height", 1.0f);
+    return true;
+}
 
-    // Right leg - angled outward (mirrored)
-    {
-        ascii::Instance inst;
-        inst.transform = base_transform;
-        inst.transform = glm::translate(inst.transform, glm::vec3(width * 0.22f, 0.0f, 0.0f));
-        inst.transform = glm::rotate(inst.transform, glm::radians(12.0f), glm::vec3(0, 0, 1));
-        inst.transform = glm::scale(inst.transform, glm::vec3(leg_width, height * 0.9f, depth));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = color;
-        glyph.emission = emission;
-        glyph_data.push_back(glyph);
+// Scene entity named by "id" (authored string id) or "entity" (handle bits)
+ascii::Entity entity_from_json(const ascii::json& params, const ascii::World& world, const ascii::SceneIndex& index) {
+    ascii::Entity entity = ascii::NULL_ENTITY;
+    if (params.contains("id") && params["id"].is_string()) {
+        entity = index.find(params["id"].get<std::string>());
+    } else if (params.contains("entity") && params["entity"].is_number_unsigned()) {
+        entity = ascii::Handle::from_bits(params["entity"].get<uint64_t>());
     }
+    return world.alive(entity) ? entity : ascii::NULL_ENTITY;
+}
 
-    // Crossbar
-    {
-        ascii::Instance inst;
-        inst.transform = base_transform;
-        inst.transform = glm::translate(inst.transform, glm::vec3(0.0f, -height * 0.15f, 0.0f));
-        inst.transform = glm::scale(inst.transform, glm::vec3(width * 0.5f, leg_width * 0.8f, depth));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = color;
-        glyph.emission = emission;
-        glyph_data.push_back(glyph);
+ascii::json entity_to_json(const ascii::World& world, const ascii::SceneIndex& index, ascii::Entity entity) {
+    ascii::json out = {{"entity", entity.bits()}};
+    if (const auto* node = world.get<ascii::SceneNode>(entity)) {
+        out["id"] = index.str(node->id);
+        out["name"] = index.str(node->name);
+        out["type"] = index.str(node->type);
+    }
+    const auto* parent = world.get<ascii::Parent>(entity);
+    const auto* parent_node = parent ? world.get<ascii::SceneNode>(parent->entity) : nullptr;
+    out["parent"] = parent_node ? ascii::json(index.str(parent_node->id)) : ascii::json(nullptr);
+    if (const auto* local = world.get<ascii::LocalTransform>(entity)) {
+        out["position"] = {local->position.x, local->position.y, local->position.z};
+        out["rotation"] = {local->rotation.x, local->rotation.y, local->rotation.z};
+        out["scale"] = {local->scale.x, local->scale.y, local->scale.z};
     }
+    return out;
+}
 
-    // Top cap (apex of A)
-    {
-        ascii::Instance inst;
-        inst.transform = base_transform;
-        inst.transform = glm::translate(inst.transform, glm::vec3(0.0f, height * 0.4f, 0.0f));
-        inst.transform = glm::scale(inst.transform, glm::vec3(leg_width * 1.2f, leg_width * 0.8f, depth));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = color;
-        glyph.emission = emission;
-        glyph_data.push_back(glyph);
+ascii::QueryValue query_value_from_json(const ascii::json& value) {
+    if (value.is_boolean()) {
+        return ascii::QueryValue::of(value.get<bool>());
+    }
+    if (value.is_number()) {
+        return ascii::QueryValue::of(value.get<double>());
     }
+    if (value.is_string()) {
+        return ascii::QueryValue::of(value.get<std::string>());
+    }
+    return {};
+}
+
+ascii::json query_value_to_json(const ascii::QueryValue& value) {
+    switch (value.kind) {
+        case ascii::QueryValue::Kind::Bool: return value.number != 0.0;
+        case ascii::QueryValue::Kind::Number: return value.number;
+        case ascii::QueryValue::Kind::String: return value.text;
+        default: return nullptr;
+    }
+}
+
+// scene.query parameters: with/without (component names), where
+// ([{field, op, value}] or [[field, op, value]]), near ([x, y]) with
+// radius, limit
+ascii::SceneQueryFilter query_filter_from_json(const ascii::json& params) {
+    ascii::SceneQueryFilter filter;
+    filter.with = params.value("with", std::vector<std::string>());
+    filter.without = params.value("without", std::vector<std::string>());
+    for (const auto& clause : params.value("where", ascii::json::array())) {
+        ascii::QueryPredicate predicate;
+        if (clause.is_array() && clause.size() == 3) {
+            predicate.field = clause[0].get<std::string>();
+            predicate.op = ascii::parse_query_op(clause[1].get<std::string>());
+            predicate.value = query_value_from_json(clause[2]);
+        } else {
+            predicate.field = clause.at("field").get<std::string>();
+            predicate.op = ascii::parse_query_op(clause.value("op", std::string("==")));
+            predicate.value = query_value_from_json(clause.value("value", ascii::json()));
+        }
+        filter.where.push_back(std::move(predicate));
+    }
+    if (params.contains("near")) {
+        const auto& near = params["near"];
+        filter.near = glm::vec3(near[0].get<float>(), near[1].get<float>(), 0.0f);
+        filter.radius = params.value("radius", 0.0f);
+    }
+    filter.limit = params.value("limit", size_t(0));
+    return filter;
 }
 
 // Build a simple dungeon scene
 void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
                          ascii::RTPipeline& pipeline,
-                         std::vector<ascii::Instance>& instances,
-                         std::vector<ascii::GlyphInstance>& glyph_data,
-                         std::vector<ascii::Light>& lights)
+                         ascii::InstanceStore& instances,
+                         ascii::MaterialTable& materials,
+                         std::vector<ascii::Light>& lights,
+                         ascii::LodSystem& lod,
+                         ascii::Tilemap& tilemap,
+                         ascii::TilemapRenderer& tilemap_renderer,
+                         ascii::ParticleSystem& particles)
 {
     instances.clear();
-    glyph_data.clear();
+    materials.clear();
     lights.clear();
+    lod.clear();
+    tilemap_renderer.reset();
+    particles.reset();
 
-    // Create geometry - just the cube BLAS, letter A is built from cubes
+    // Create geometry - the cube BLAS plus the letter A LOD chain
     uint32_t cube_blas = accel.create_cube_blas();
+    ascii::GlyphLodChain letter_lods = accel.create_letter_a_lods();
+    uint32_t letter_chain = lod.add_chain(letter_lods);
 
     // Build a simple room: 10x10 floor with walls
     const int room_size = 10;
     const float wall_height = 1.0f;
 
-    // Floor tiles
-    for (int z = 0; z < room_size; z++) {
-        for (int x = 0; x < room_size; x++) {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, -0.5f, z));
-            inst.transform = glm::scale(inst.transform, glm::vec3(1.0f, 0.1f, 1.0f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            // Floor is dark gray
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.15f, 0.15f, 0.15f, 0.95f);  // Dark gray, high roughness
-            glyph.emission = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-            glyph_data.push_back(glyph);
-        }
-    }
-
-    // Walls around the perimeter
-    for (int i = 0; i < room_size; i++) {
-        // North wall (z = 0)
-        {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(i, wall_height / 2.0f, -0.5f));
-            inst.transform = glm::scale(inst.transform, glm::vec3(1.0f, wall_height, 0.2f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.3f, 0.3f, 0.35f, 0.9f);
-            glyph.emission = glm::vec4(0.0f);
-            glyph_data.push_back(glyph);
-        }
-
-        // South wall (z = room_size)
-        {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(i, wall_height / 2.0f, room_size - 0.5f));
-            inst.transform = glm::scale(inst.transform, glm::vec3(1.0f, wall_height, 0.2f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.3f, 0.3f, 0.35f, 0.9f);
-            glyph.emission = glm::vec4(0.0f);
-            glyph_data.push_back(glyph);
-        }
-
-        // West wall (x = 0)
-        {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, wall_height / 2.0f, i));
-            inst.transform = glm::scale(inst.transform, glm::vec3(0.2f, wall_height, 1.0f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.3f, 0.3f, 0.35f, 0.9f);
-            glyph.emission = glm::vec4(0.0f);
-            glyph_data.push_back(glyph);
-        }
-
-        // East wall (x = room_size)
-        {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(room_size - 0.5f, wall_height / 2.0f, i));
-            inst.transform = glm::scale(inst.transform, glm::vec3(0.2f, wall_height, 1.0f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.3f, 0.3f, 0.35f, 0.9f);
-            glyph.emission = glm::vec4(0.0f);
-            glyph_data.push_back(glyph);
-        }
-    }
+    // Floor and walls are tilemap layers: a thin floor layer and a one-tile
+    // wall ring standing on it
+    uint16_t floor_material = materials.add({
+        glm::vec4(0.15f, 0.15f, 0.15f, 0.95f),  // Dark gray, high roughness
+        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f)});
+    uint16_t wall_material = materials.add({
+        glm::vec4(0.3f, 0.3f, 0.35f, 0.9f),
+        glm::vec4(0.0f)});
+
+    tilemap.resize(room_size + 2, room_size + 2, 2);
+    tilemap.origin = glm::vec3(-1.5f, -0.55f, -1.5f);  // Floor tile (x, y) is centered on world (x, z)
+    tilemap.set_layer_base(1, 0.1f);
+    tilemap.fill_rect(0, 0, 0, tilemap.width(), tilemap.height(), {'.', floor_material, 0.1f});
+    tilemap.fill_rect(1, 0, 0, tilemap.width(), tilemap.height(), {'#', wall_material, wall_height + 0.45f});
+    tilemap.fill_rect(1, 1, 1, room_size, room_size, {});
+
+    tilemap_renderer.sync(tilemap);
+    spdlog::info("Tilemap: {}x{} tiles, {} layers, {} chunks ({} chunk mesh triangles)",
+                 tilemap.width(), tilemap.height(), tilemap.layers(), tilemap.chunk_count(),
+                 tilemap_renderer.triangle_count());
 
     // Add a pillar in the middle
     {
-        ascii::Instance inst;
-        inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(room_size / 2.0f, wall_height / 2.0f, room_size / 2.0f));
-        inst.transform = glm::scale(inst.transform, glm::vec3(0.5f, wall_height, 0.5f));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = glm::vec4(0.4f, 0.35f, 0.3f, 0.85f);
-        glyph.emission = glm::vec4(0.0f);
-        glyph_data.push_back(glyph);
+        ascii::Material material;
+        material.color = glm::vec4(0.4f, 0.35f, 0.3f, 0.85f);
+        material.emission = glm::vec4(0.0f);
+        instances.add(glm::vec3(room_size / 2.0f, wall_height / 2.0f, room_size / 2.0f), NO_ROTATION,
+                      glm::vec3(0.5f, wall_height, 0.5f),
+                      cube_blas, ascii::MaterialTable::custom_index(materials.add(material)));
     }
 
     // Add a glowing torch on the pillar (main light source)
     {
-        ascii::Instance inst;
-        inst.transform = glm::translate(glm::mat4(1.0f), glm::vec3(room_size / 2.0f, wall_height + 0.2f, room_size / 2.0f));
-        inst.transform = glm::scale(inst.transform, glm::vec3(0.2f, 0.35f, 0.2f));
-        inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-        inst.blas_index = cube_blas;
-        instances.push_back(inst);
-
-        ascii::GlyphInstance glyph;
-        glyph.color = glm::vec4(1.0f, 0.7f, 0.3f, 0.15f);  // Very smooth
-        glyph.emission = glm::vec4(1.0f, 0.55f, 0.15f, 8.0f);  // Bright glow
-        glyph_data.push_back(glyph);
+        ascii::Material material;
+        material.color = glm::vec4(1.0f, 0.7f, 0.3f, 0.15f);  // Very smooth
+        material.emission = glm::vec4(1.0f, 0.55f, 0.15f, 8.0f);  // Bright glow
+        instances.add(glm::vec3(room_size / 2.0f, wall_height + 0.2f, room_size / 2.0f), NO_ROTATION,
+                      glm::vec3(0.2f, 0.35f, 0.2f),
+                      cube_blas, ascii::MaterialTable::custom_index(materials.add(material)));
     }
 
-    // Add letter "A" instances using the helper function (builds from cubes for correct normals)
+    // Add letter "A" instances using the helper function
 
     // LEFT: Red letter A
-    add_letter_a(cube_blas, instances, glyph_data,
+    add_letter_a(lod, letter_chain, letter_lods, instances, materials,
                  glm::vec3(3.0f, 1.0f, 3.0f),
                  1.5f,  // scale
                  glm::radians(30.0f),  // rotation
@@ -356,7 +377,7 @@ void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
                  glm::vec4(0.0f));                        // No emission (lit by red accent light)
 
     // MIDDLE: Green letter A (center of room)
-    add_letter_a(cube_blas, instances, glyph_data,
+    add_letter_a(lod, letter_chain, letter_lods, instances, materials,
                  glm::vec3(room_size / 2.0f, 1.5f, room_size / 2.0f - 2.0f),
                  2.5f,  // scale
                  0.0f,  // rotation
@@ -364,7 +385,7 @@ void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
                  glm::vec4(0.0f));                        // No emission (lit by green accent light)
 
     // RIGHT: Blue letter A
-    add_letter_a(cube_blas, instances, glyph_data,
+    add_letter_a(lod, letter_chain, letter_lods, instances, materials,
                  glm::vec3(7.0f, 1.2f, 3.0f),
                  1.8f,  // scale
                  glm::radians(-20.0f),  // rotation
@@ -392,17 +413,11 @@ void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
     for (const auto& pos : torch_positions) {
         // Torch geometry (glowing emissive)
         {
-            ascii::Instance inst;
-            inst.transform = glm::translate(glm::mat4(1.0f), pos);
-            inst.transform = glm::scale(inst.transform, glm::vec3(0.12f, 0.25f, 0.12f));
-            inst.custom_index = static_cast<uint32_t>(glyph_data.size());
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
-
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(1.0f, 0.6f, 0.2f, 0.2f);  // Smooth, low roughness
-            glyph.emission = glm::vec4(1.0f, 0.5f, 0.1f, 5.0f);  // Emission
-            glyph_data.push_back(glyph);
+            ascii::Material material;
+            material.color = glm::vec4(1.0f, 0.6f, 0.2f, 0.2f);  // Smooth, low roughness
+            material.emission = glm::vec4(1.0f, 0.5f, 0.1f, 5.0f);  // Emission
+            instances.add(pos, NO_ROTATION, glm::vec3(0.12f, 0.25f, 0.12f),
+                          cube_blas, ascii::MaterialTable::custom_index(materials.add(material)));
         }
 
         // Light
@@ -412,6 +427,47 @@ void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
         lights.push_back(light);
     }
 
+    // Embers and smoke rising off every torch flame
+    {
+        ascii::ParticleEmitter embers;
+        embers.material = materials.add({glm::vec4(1.0f, 0.6f, 0.2f, 0.3f), glm::vec4(1.0f, 0.45f, 0.1f, 6.0f)});
+        embers.jitter = glm::vec3(0.05f, 0.02f, 0.05f);
+        embers.rate = 24.0f;
+        embers.life_min = 0.6f;
+        embers.life_max = 1.4f;
+        embers.velocity = glm::vec3(0.0f, 0.6f, 0.0f);
+        embers.spread = 0.25f;
+        embers.acceleration = glm::vec3(0.0f, 0.4f, 0.0f);   // Hot air lifts them
+        embers.drag = 1.0f;
+        embers.size_start = 0.03f;
+        embers.size_end = 0.005f;
+        embers.max_particles = 48;
+
+        ascii::ParticleEmitter smoke;
+        smoke.material = materials.add({glm::vec4(0.25f, 0.24f, 0.23f, 1.0f), glm::vec4(0.0f)});
+        smoke.jitter = glm::vec3(0.04f, 0.0f, 0.04f);
+        smoke.rate = 10.0f;
+        smoke.life_min = 1.5f;
+        smoke.life_max = 2.5f;
+        smoke.velocity = glm::vec3(0.0f, 0.35f, 0.0f);
+        smoke.spread = 0.08f;
+        smoke.drag = 0.3f;
+        smoke.size_start = 0.04f;
+        smoke.size_end = 0.16f;
+        smoke.max_particles = 32;
+
+        std::vector<glm::vec3> flames = {glm::vec3(room_size / 2.0f, wall_height + 0.375f, room_size / 2.0f)};
+        for (const auto& pos : torch_positions) {
+            flames.push_back(pos + glm::vec3(0.0f, 0.125f, 0.0f));
+        }
+        for (const auto& flame : flames) {
+            embers.position = flame;
+            smoke.position = flame + glm::vec3(0.0f, 0.1f, 0.0f);
+            particles.add_emitter(embers);
+            particles.add_emitter(smoke);
+        }
+    }
+
     // RGB accent lights for each letter A
     // RED accent light near the left A
     {
@@ -457,11 +513,117 @@ void build_dungeon_scene(ascii::AccelerationStructureManager& accel,
     accel.build_tlas(instances);
 
     // Update pipeline buffers
-    pipeline.set_instances(glyph_data);
+    pipeline.set_materials(materials.entries());
     pipeline.set_lights(lights);
 
-    spdlog::info("Built dungeon scene: {} instances, {} lights",
-                 instances.size(), lights.size() - 1);
+    spdlog::info("Built dungeon scene: {} instances, {} materials, {} lights",
+                 instances.size(), materials.size(), lights.size() - 1);
+}
+
+bool is_binary_scene(const std::string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".ascn") == 0;
+}
+
+// Convert scene.json -> .ascn (baking renderer data) or .ascn -> scene.json
+int convert_scene(const std::string& from, const std::string& to) {
+    try {
+        ascii::Stopwatch timer;
+        if (is_binary_scene(from)) {
+            ascii::SceneBinary scene(from);
+            ascii::save_scene_json(to, scene.to_document());
+            spdlog::info("Converted {} -> {}: {} nodes in {:.2f} ms", from, to, scene.node_count(), timer.elapsed_ms());
+        } else {
+            ascii::JobSystem jobs;
+            ascii::SceneDocument doc = ascii::load_scene_json(from);
+            ascii::SceneBake bake = ascii::bake_scene(doc, jobs);
+            ascii::save_scene_binary(to, doc, bake);
+            spdlog::info("Converted {} -> {}: {} nodes, {} instances, {} lights in {:.2f} ms",
+                         from, to, doc.node_count(), bake.instances.size(), bake.lights.size(), timer.elapsed_ms());
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Scene conversion failed: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Build the scene from an editor scene.json or a binary .ascn. scene.json is
+// parsed straight into native arrays and spawned into the ECS world, which
+// the extractor turns into instances and lights (and does again whenever the
+// world's structure changes); .ascn files are mapped and their precomputed
+// arrays copied, leaving the world empty.
+ascii::SceneInstantiateResult build_scene_file(const std::string& path,
+                                               ascii::JobSystem& jobs,
+                                               ascii::World& scene_world,
+                                               ascii::SceneIndex& scene_index,
+                                               ascii::TransformHierarchy& scene_transforms,
+                                               ascii::SceneExtractor& scene_extractor,
+                                               ascii::SceneGeometry& geometry,
+                                               ascii::AccelerationStructureManager& accel,
+                                               ascii::RTPipeline& pipeline,
+                                               ascii::InstanceStore& instances,
+                                               ascii::MaterialTable& materials,
+                                               std::vector<ascii::Light>& lights,
+                                               ascii::LodSystem& lod,
+                                               ascii::Tilemap& tilemap,
+                                               ascii::TilemapRenderer& tilemap_renderer,
+                                               ascii::ParticleSystem& particles)
+{
+    instances.clear();
+    materials.clear();
+    lights.clear();
+    lod.clear();
+    tilemap_renderer.reset();
+    particles.reset();
+    scene_world.clear();
+    scene_index.clear();
+    scene_extractor.reset();
+
+    geometry = {};
+    geometry.glyph_blas = accel.create_cube_blas();
+    // Glyph meshes start at full detail; the LOD system swaps their BLAS
+    const ascii::GlyphLodChain letter_lods = accel.create_letter_a_lods();
+    geometry.glyph_meshes['A'] = letter_lods.blas[0];
+    geometry.glyph_lod_chains['A'] = lod.add_chain(letter_lods);
+
+    // Both formats spawn the scene world; instances, lights and terrain are
+    // extracted from it, so scripts, IPC and the editor see the same scene.
+    // A binary scene is mapped and decoded instead of parsed.
+    ascii::Stopwatch timer;
+    ascii::SceneDocument doc;
+    if (is_binary_scene(path)) {
+        ascii::SceneBinary scene(path);
+        doc = scene.to_document();
+        spdlog::info("Scene load: map and decode {:.2f} ms ({:.1f} MB)",
+                     timer.elapsed_ms(), scene.file_size() / (1024.0 * 1024.0));
+    } else {
+        doc = ascii::load_scene_json(path);
+        spdlog::info("Scene load: parse {:.2f} ms", timer.elapsed_ms());
+    }
+    timer.reset();
+    ascii::SceneInstantiateResult result;
+    ascii::spawn_scene(doc, scene_world, scene_index, materials);
+    result.transform_ms = timer.elapsed_ms();
+    timer.reset();
+    scene_transforms.rebuild(scene_world);
+    scene_transforms.update(scene_world, jobs);
+    result.glyph_instances = scene_extractor.extract_instances(scene_world, geometry, jobs, &scene_transforms, &lod);
+    result.lights = scene_extractor.extract_lights(scene_world, lights);
+    result.terrain_tiles = ascii::extract_terrain(scene_world, tilemap, materials);
+    result.has_camera = ascii::find_scene_camera(scene_world, result.camera_target, result.camera_zoom);
+    result.component_ms = timer.elapsed_ms();
+    const size_t node_count = doc.node_count();
+    spdlog::info("Scene load: spawn {:.2f} ms ({} entities), extract {:.2f} ms ({} threads)",
+                 result.transform_ms, scene_world.size(), result.component_ms, jobs.thread_count());
+
+    tilemap_renderer.sync(tilemap);
+    accel.build_tlas(instances);
+    pipeline.set_materials(materials.entries());
+    pipeline.set_lights(lights);
+
+    spdlog::info("Loaded scene {}: {} nodes -> {} glyphs, {} lights, {} terrain tiles",
+                 path, node_count, result.glyph_instances, result.lights, result.terrain_tiles);
+    return result;
 }
 
 } // anonymous namespace
@@ -471,6 +633,14 @@ int main(int argc, char* argv[]) {
         // Parse command line
         LaunchOptions opts = parse_args(argc, argv);
 
+        // Offline benchmarks don't need a window or GPU
+        if (!opts.bench.empty()) {
+            return ascii::bench::run(opts.bench);
+        }
+        if (!opts.convert_from.empty()) {
+            return convert_scene(opts.convert_from, opts.convert_to);
+        }
+
         // Setup logging for real-time debug output
         spdlog::set_level(spdlog::level::debug);
         spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
@@ -599,6 +769,9 @@ int main(int argc, char* argv[]) {
 
             while (!window.should_close()) {
                 window.poll_events();
+                if (ipc_server) {
+                    ipc_server->poll();
+                }
                 window.update_follow_owner();
 
                 // Handle escape to quit
@@ -682,23 +855,16 @@ int main(int argc, char* argv[]) {
         ascii::AccelerationStructureManager accel(vulkan);
 
         // Build initial scene (need TLAS before creating pipeline)
-        std::vector<ascii::Instance> instances;
-        std::vector<ascii::GlyphInstance> glyph_data;
+        ascii::InstanceStore instances;
+        ascii::MaterialTable materials;
         std::vector<ascii::Light> lights;
 
         // Create a minimal scene first
         uint32_t cube_blas = accel.create_cube_blas();
         {
-            ascii::Instance inst;
-            inst.transform = glm::mat4(1.0f);
-            inst.custom_index = 0;
-            inst.blas_index = cube_blas;
-            instances.push_back(inst);
+            instances.add(glm::vec3(0.0f), NO_ROTATION, glm::vec3(1.0f), cube_blas, 0);
 
-            ascii::GlyphInstance glyph;
-            glyph.color = glm::vec4(0.5f, 0.5f, 0.5f, 0.8f);
-            glyph.emission = glm::vec4(0.0f);
-            glyph_data.push_back(glyph);
+            materials.add({glm::vec4(0.5f, 0.5f, 0.5f, 0.8f), glm::vec4(0.0f)});
 
             ascii::Light light;
             light.position = glm::vec4(0.0f, 2.0f, 0.0f, 10.0f);
@@ -715,7 +881,70 @@ int main(int argc, char* argv[]) {
         ascii::RTPipeline rt_pipeline(vulkan, accel);
 
         // Now build the actual dungeon scene
-        build_dungeon_scene(accel, rt_pipeline, instances, glyph_data, lights);
+        ascii::LodSystem lod;
+        ascii::Tilemap tilemap;
+        ascii::TilemapRenderer tilemap_renderer(accel, instances, cube_blas,
+            opts.static_geometry ? ascii::TilemapRenderer::Mode::ChunkMeshes
+                                 : ascii::TilemapRenderer::Mode::TileCubes);
+        ascii::ParticleSystem particles(instances, cube_blas);
+        ascii::JobSystem jobs;
+        ascii::World scene_world;
+        ascii::SceneIndex scene_index;
+        ascii::TransformHierarchy scene_transforms;
+        ascii::SceneQuery scene_query;
+        ascii::SchemaRegistry schemas;     // Outlives the Lua views into it
+        ascii::SceneExtractor scene_extractor(instances);
+        ascii::SceneGeometry scene_geometry;
+        ascii::SceneInstantiateResult scene_info;
+        if (!opts.scene.empty()) {
+            scene_info = build_scene_file(opts.scene, jobs, scene_world, scene_index, scene_transforms, scene_extractor,
+                                          scene_geometry, accel, rt_pipeline, instances, materials, lights, lod,
+                                          tilemap, tilemap_renderer, particles);
+        } else {
+            build_dungeon_scene(accel, rt_pipeline, instances, materials, lights, lod, tilemap, tilemap_renderer,
+                                particles);
+        }
+
+        // Lights as uploaded to the GPU (distant ones merged by the LOD system)
+        std::vector<ascii::Light> render_lights;
+
+        // Scene lights plus those following lit particle emitters, rebuilt
+        // every frame while any emitter is lit
+        std::vector<ascii::Light> frame_lights;
+        bool particle_lights = false;
+
+        // Scene world structure last extracted
+        uint64_t scene_version = scene_world.structure_version();
+
+        // Play mode: scene, tilemap, schema and material state to return to on play.stop
+        ascii::PlaySnapshot play_snapshot(scene_world, scene_index, tilemap, schemas, materials);
+        bool play_paused = false;
+
+        // Undo/redo of IPC edits made outside play mode
+        ascii::EditHistory edit_history(scene_world, scene_index, tilemap, materials, scene_transforms);
+        std::vector<ascii::TileChange> tile_changes;
+        auto recorded_tile_edit = [&](const char* label, bool stroke, auto&& edit) -> size_t {
+            if (play_snapshot.active()) {
+                return edit();
+            }
+            // Stop recording even when the edit throws (bad params), or
+            // script tile edits would land in the history
+            auto finish = [&] {
+                tilemap.record_changes(nullptr);
+                edit_history.record_tiles(label, tile_changes, stroke);
+                tile_changes.clear();
+            };
+            tilemap.record_changes(&tile_changes);
+            size_t changed = 0;
+            try {
+                changed = edit();
+            } catch (...) {
+                finish();
+                throw;
+            }
+            finish();
+            return changed;
+        };
 
         // IMPORTANT: Update TLAS descriptor after rebuilding the acceleration structure
         rt_pipeline.update_tlas_descriptor();
@@ -725,50 +954,401 @@ int main(int argc, char* argv[]) {
         if (opts.ipc_port > 0) {
             ipc_server = std::make_unique<ascii::IPCServer>(static_cast<uint16_t>(opts.ipc_port));
 
-            // Register command handlers
-            // Note: We capture references to mutable state - these handlers run synchronously in poll()
+            // Register command handlers. They capture engine state by
+            // reference and run on this thread, from ipc_server->poll() at
+            // the frame's sync point.
 
             // stats.get - Return performance stats
             ipc_server->register_command("stats.get", [&](const ascii::json& params) -> ascii::json {
                 return {
                     {"fps", 1.0f / window.delta_time()},
                     {"frame_time", window.delta_time()},
+                    {"trace_ms", rt_pipeline.last_trace_ms()},
                     {"instance_count", instances.size()},
-                    {"light_count", lights.size() - 1}  // Exclude terminator
+                    {"material_count", materials.size()},
+                    {"light_count", lights.size() - 1},  // Exclude terminator
+                    {"rendered_light_count", render_lights.empty() ? 0 : render_lights.size() - 1},
+                    {"lod_levels", lod.level_counts()},
+                    {"tilemap_chunks_rebuilt", tilemap_renderer.chunks_rebuilt()}
                 };
             });
 
             // scene.get - Return full scene data
             ipc_server->register_command("scene.get", [&](const ascii::json& params) -> ascii::json {
-                ascii::json entities = ascii::json::array();
-                for (size_t i = 0; i < glyph_data.size(); i++) {
-                    const auto& glyph = glyph_data[i];
-                    const auto& inst = instances[i];
-                    entities.push_back({
+                ascii::json material_array = ascii::json::array();
+                for (size_t i = 0; i < materials.size(); i++) {
+                    const auto& material = materials.entries()[i];
+                    material_array.push_back({
                         {"id", i},
-                        {"color", {glyph.color.r, glyph.color.g, glyph.color.b, glyph.color.a}},
-                        {"emission", {glyph.emission.r, glyph.emission.g, glyph.emission.b, glyph.emission.a}}
+                        {"color", {material.color.r, material.color.g, material.color.b, material.color.a}},
+                        {"emission", {material.emission.r, material.emission.g, material.emission.b, material.emission.a}}
                     });
                 }
 
+                // Lights extracted from the scene world carry their source entity
+                const auto& light_entities = scene_extractor.light_entities();
                 ascii::json light_array = ascii::json::array();
                 for (size_t i = 0; i < lights.size() - 1; i++) {  // Exclude terminator
                     const auto& light = lights[i];
-                    light_array.push_back({
-                        {"id", i},
+                    ascii::json entry = {
                         {"position", {light.position.x, light.position.y, light.position.z}},
                         {"radius", light.position.w},
                         {"color", {light.color.r, light.color.g, light.color.b}},
                         {"power", light.color.a}
-                    });
+                    };
+                    if (i < light_entities.size() && scene_world.alive(light_entities[i])) {
+                        entry["entity"] = light_entities[i].bits();
+                    }
+                    light_array.push_back(entry);
+                }
+
+                // Scene nodes by stable handle and authored id
+                ascii::json entity_array = ascii::json::array();
+                for (size_t i = 0; i < scene_world.size(); i++) {
+                    const ascii::Entity entity = scene_world.entity_at(i);
+                    if (scene_world.has<ascii::SceneNode>(entity)) {
+                        entity_array.push_back(entity_to_json(scene_world, scene_index, entity));
+                    }
+                }
+
+                return {
+                    {"materials", material_array},
+                    {"lights", light_array},
+                    {"entities", entity_array}
+                };
+            });
+
+            // entity.get / entity.set / entity.destroy - by "id" or "entity", O(1) lookup
+            ipc_server->register_command("entity.get", [&](const ascii::json& params) -> ascii::json {
+                ascii::Entity entity = entity_from_json(params, scene_world, scene_index);
+                if (!entity.valid()) {
+                    return {{"success", false}, {"error", "Unknown entity"}};
+                }
+                return {{"success", true}, {"entity", entity_to_json(scene_world, scene_index, entity)}};
+            });
+
+            ipc_server->register_command("entity.set", [&](const ascii::json& params) -> ascii::json {
+                ascii::Entity entity = entity_from_json(params, scene_world, scene_index);
+                auto* local = scene_world.get<ascii::LocalTransform>(entity);
+                if (!local) {
+                    return {{"success", false}, {"error", "Unknown entity"}};
+                }
+                const ascii::LocalTransform before = *local;
+                auto read_vec3 = [&](const char* key, glm::vec3& value) {
+                    if (params.contains(key)) {
+                        const auto& v = params[key];
+                        value = glm::vec3(v[0].get<float>(), v[1].get<float>(), v[2].get<float>());
+                    }
+                };
+                read_vec3("position", local->position);
+                read_vec3("rotation", local->rotation);
+                read_vec3("scale", local->scale);
+                scene_transforms.mark_dirty(scene_world, entity);
+                if (!play_snapshot.active()) {
+                    edit_history.record_transform(entity, before, *local);
+                }
+                return {{"success", true}};
+            });
+
+            // Applied at the next frame's sync point, with the entity's children
+            ipc_server->register_command("entity.destroy", [&](const ascii::json& params) -> ascii::json {
+                ascii::Entity entity = entity_from_json(params, scene_world, scene_index);
+                if (!entity.valid()) {
+                    return {{"success", false}, {"error", "Unknown entity"}};
+                }
+                if (!play_snapshot.active()) {
+                    edit_history.record_destroy(entity);
+                }
+                scene_world.commands().run([&scene_index, entity](ascii::World& world) {
+                    ascii::destroy_scene_entity(world, scene_index, entity);
+                });
+                return {{"success", true}};
+            });
+
+            // scene.query - Entities matching a component/field filter (see
+            // query_filter_from_json), with only the requested "fields":
+            // "Component.field" names or "position" (scene space)
+            ipc_server->register_command("scene.query", [&](const ascii::json& params) -> ascii::json {
+                const ascii::SceneQueryFilter filter = query_filter_from_json(params);
+                const std::vector<ascii::Entity> matches = scene_query.run(scene_world, scene_index, filter);
+                const auto fields = params.value("fields", std::vector<std::string>());
+                ascii::json results = ascii::json::array();
+                for (ascii::Entity entity : matches) {
+                    ascii::json entry = {{"entity", entity.bits()}};
+                    if (const auto* node = scene_world.get<const ascii::SceneNode>(entity)) {
+                        entry["id"] = scene_index.str(node->id);
+                    }
+                    for (const std::string& field : fields) {
+                        if (field == "position") {
+                            const auto* transform = scene_world.get<const ascii::WorldTransform>(entity);
+                            const glm::vec3 p = transform ? ascii::scene_to_world(transform->position) : glm::vec3(0.0f);
+                            entry[field] = {p.x, p.y, p.z};
+                        } else {
+                            entry[field] = query_value_to_json(scene_query.field(scene_world, scene_index, entity, field));
+                        }
+                    }
+                    results.push_back(std::move(entry));
+                }
+                return {{"success", true}, {"count", matches.size()}, {"results", results}};
+            });
+
+            // scene.query_index - Declare a sorted (range) or hash (equality) index on a field
+            ipc_server->register_command("scene.query_index", [&](const ascii::json& params) -> ascii::json {
+                const std::string kind = params.value("kind", std::string("sorted"));
+                if (kind != "sorted" && kind != "hash") {
+                    return {{"success", false}, {"error", "kind must be sorted or hash"}};
+                }
+                scene_query.declare_index(params.value("field", std::string()),
+                                          kind == "hash" ? ascii::SceneQuery::IndexKind::Hash
+                                                         : ascii::SceneQuery::IndexKind::Sorted);
+                return {{"success", true}};
+            });
+
+            // play.start - Snapshot the scene (copy-on-write, so only the
+            // material table is copied) and run scripts from here
+            ipc_server->register_command("play.start", [&](const ascii::json& params) -> ascii::json {
+                if (play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Already playing"}};
                 }
+                ascii::Stopwatch timer;
+                scene_world.flush();
+                play_snapshot.begin();
+                play_paused = false;
+                return {{"success", true}, {"ms", timer.elapsed_ms()}};
+            });
+
+            // play.stop - Back to the state at play.start, or keep it with apply: true
+            ipc_server->register_command("play.stop", [&](const ascii::json& params) -> ascii::json {
+                if (!play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not playing"}};
+                }
+                const size_t bytes = play_snapshot.bytes();
+                ascii::Stopwatch timer;
+                if (params.value("apply", false)) {
+                    play_snapshot.commit();
+                    edit_history.clear();       // Its deltas no longer match the scene
+                } else {
+                    play_snapshot.restore();
+                    vulkan.wait_idle();     // Material buffer is read by in-flight frames
+                    rt_pipeline.set_materials(materials.entries());
+                }
+                play_paused = false;
+                return {{"success", true}, {"ms", timer.elapsed_ms()}, {"snapshot_bytes", bytes}};
+            });
+
+            // play.pause / play.resume - Stop or restart on_update while playing
+            ipc_server->register_command("play.pause", [&](const ascii::json& params) -> ascii::json {
+                if (!play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not playing"}};
+                }
+                play_paused = true;
+                return {{"success", true}};
+            });
+            ipc_server->register_command("play.resume", [&](const ascii::json& params) -> ascii::json {
+                if (!play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not playing"}};
+                }
+                play_paused = false;
+                return {{"success", true}};
+            });
+
+            ipc_server->register_command("play.status", [&](const ascii::json& params) -> ascii::json {
+                return {
+                    {"success", true},
+                    {"playing", play_snapshot.active()},
+                    {"paused", play_paused},
+                    {"snapshot_bytes", play_snapshot.bytes()}
+                };
+            });
+
+            // history.undo / history.redo - Step through IPC edits (entity.set,
+            // entity.destroy, material.set, tilemap edits); refused while playing.
+            // Like every handler this runs from poll() on the main thread, so the
+            // entities, tiles and materials it writes back are not in use.
+            auto step_history = [&](bool redo) -> ascii::json {
+                if (play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not available in play mode"}};
+                }
+                scene_world.flush();    // An entity.destroy earlier in the same poll() must have happened
+                auto applied = redo ? edit_history.redo() : edit_history.undo();
+                if (!applied) {
+                    return {{"success", false}, {"error", redo ? "Nothing to redo" : "Nothing to undo"}};
+                }
+                for (uint16_t id : applied->materials) {
+                    rt_pipeline.update_material(id, materials.get(id));
+                }
+                return {{"success", true}, {"label", applied->label}};
+            };
+            ipc_server->register_command("history.undo", [&, step_history](const ascii::json& params) -> ascii::json {
+                return step_history(false);
+            });
+            ipc_server->register_command("history.redo", [&, step_history](const ascii::json& params) -> ascii::json {
+                return step_history(true);
+            });
+
+            ipc_server->register_command("history.status", [&](const ascii::json& params) -> ascii::json {
+                return {
+                    {"success", true},
+                    {"undo", edit_history.undo_count()},
+                    {"redo", edit_history.redo_count()},
+                    {"bytes", edit_history.bytes()},
+                    {"recent", edit_history.undo_labels(params.value("limit", size_t(20)))}
+                };
+            });
+
+            ipc_server->register_command("history.clear", [&](const ascii::json& params) -> ascii::json {
+                edit_history.clear();
+                return {{"success", true}};
+            });
 
+            // state.save - Write world, index, tilemap, materials and Type.define
+            // instances to a binary state file (LZ-compressed blocks unless compress: false)
+            ascii::EngineState engine_state{scene_world, scene_index, tilemap, materials, schemas};
+            ipc_server->register_command("state.save", [&, engine_state](const ascii::json& params) -> ascii::json {
+                const std::string path = params.value("path", std::string());
+                if (path.empty()) {
+                    return {{"success", false}, {"error", "Missing path"}};
+                }
+                if (play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not available in play mode"}};
+                }
+                ascii::Stopwatch timer;
+                scene_world.flush();
+                const ascii::StateSaveStats stats = ascii::save_state(path, engine_state, jobs,
+                                                                      params.value("compress", true));
                 return {
-                    {"entities", entities},
-                    {"lights", light_array}
+                    {"success", true},
+                    {"entities", stats.entities},
+                    {"raw_bytes", stats.raw_bytes},
+                    {"file_bytes", stats.file_bytes},
+                    {"ms", timer.elapsed_ms()}
                 };
             });
 
+            // state.load - Replace the state with a state file's. Runs from
+            // poll() at the frame sync point, before the flush, so nothing
+            // reads the world, index, tilemap or schemas while they are
+            // replaced; the same frame then re-extracts instances and lights
+            // like after play.stop
+            ipc_server->register_command("state.load", [&, engine_state](const ascii::json& params) -> ascii::json {
+                const std::string path = params.value("path", std::string());
+                if (path.empty()) {
+                    return {{"success", false}, {"error", "Missing path"}};
+                }
+                if (play_snapshot.active()) {
+                    return {{"success", false}, {"error", "Not available in play mode"}};
+                }
+                ascii::Stopwatch timer;
+                ascii::StateFile file(path);
+                scene_world.flush();
+                edit_history.clear();       // Its deltas won't match the scene, even if the load throws
+                const ascii::StateLoadStats stats = ascii::load_state(file, engine_state, jobs);
+                vulkan.wait_idle();         // Material buffer is read by in-flight frames
+                rt_pipeline.set_materials(materials.entries());
+                return {{"success", true}, {"entities", stats.entities}, {"ms", timer.elapsed_ms()}};
+            });
+
+            // material.set - Edit one material table entry (every instance using it changes)
+            ipc_server->register_command("material.set", [&](const ascii::json& params) -> ascii::json {
+                uint32_t id = params.value("id", ascii::MaterialTable::MAX_MATERIALS);
+                if (!materials.contains(id)) {
+                    return {{"success", false}, {"error", "Unknown material id"}};
+                }
+                ascii::Material material = materials.get(static_cast<uint16_t>(id));
+                const ascii::Material before = material;
+                if (params.contains("color")) {
+                    auto c = params["color"];
+                    material.color = glm::vec4(c[0].get<float>(), c[1].get<float>(), c[2].get<float>(), c[3].get<float>());
+                }
+                if (params.contains("emission")) {
+                    auto e = params["emission"];
+                    material.emission = glm::vec4(e[0].get<float>(), e[1].get<float>(), e[2].get<float>(), e[3].get<float>());
+                }
+                materials.set(static_cast<uint16_t>(id), material);
+                rt_pipeline.update_material(static_cast<uint16_t>(id), material);
+                if (!play_snapshot.active()) {
+                    edit_history.record_material(static_cast<uint16_t>(id), before, material);
+                }
+                return {{"success", true}};
+            });
+
+            // tilemap.get - Map size, or one tile with layer/x/y
+            ipc_server->register_command("tilemap.get", [&](const ascii::json& params) -> ascii::json {
+                if (!params.contains("x")) {
+                    return {
+                        {"width", tilemap.width()},
+                        {"height", tilemap.height()},
+                        {"layers", tilemap.layers()},
+                        {"chunk_size", ascii::Tilemap::CHUNK_SIZE}
+                    };
+                }
+                ascii::Tile tile = tilemap.get(params.value("layer", 0), params.value("x", 0), params.value("y", 0));
+                if (tile.empty()) {
+                    return {{"tile", nullptr}};
+                }
+                return {{"tile", {
+                    {"glyph", ascii::encode_glyph(tile.glyph)},
+                    {"material", tile.material},
+                    {"height", tile.height}
+                }}};
+            });
+
+            // Bulk tile edits. They run from poll() before the tilemap renderer,
+            // field of view and physics sync the layers, and only the touched
+            // chunks are re-emitted that frame.
+            ipc_server->register_command("tilemap.set", [&](const ascii::json& params) -> ascii::json {
+                ascii::Tile tile;
+                if (!tile_from_json(params.value("tile", ascii::json()), materials, tile)) {
+                    return {{"success", false}, {"error", "Unknown material id"}};
+                }
+                size_t changed = recorded_tile_edit("tilemap.set", true, [&] {
+                    return tilemap.set(params.value("layer", 0), params.value("x", 0), params.value("y", 0), tile);
+                });
+                return {{"success", true}, {"changed", changed}};
+            });
+
+            ipc_server->register_command("tilemap.fill_rect", [&](const ascii::json& params) -> ascii::json {
+                ascii::Tile tile;
+                if (!tile_from_json(params.value("tile", ascii::json()), materials, tile)) {
+                    return {{"success", false}, {"error", "Unknown material id"}};
+                }
+                size_t changed = recorded_tile_edit("tilemap.fill_rect", false, [&] {
+                    return tilemap.fill_rect(params.value("layer", 0), params.value("x", 0), params.value("y", 0),
+                                             params.value("w", 0), params.value("h", 0), tile);
+                });
+                return {{"success", true}, {"changed", changed}};
+            });
+
+            ipc_server->register_command("tilemap.flood_fill", [&](const ascii::json& params) -> ascii::json {
+                ascii::Tile tile;
+                if (!tile_from_json(params.value("tile", ascii::json()), materials, tile)) {
+                    return {{"success", false}, {"error", "Unknown material id"}};
+                }
+                size_t changed = recorded_tile_edit("tilemap.flood_fill", false, [&] {
+                    return tilemap.flood_fill(params.value("layer", 0), params.value("x", 0), params.value("y", 0), tile);
+                });
+                return {{"success", true}, {"changed", changed}};
+            });
+
+            // tilemap.paste - rows: ["#..#", ...], legend: {"#": tile, ...}
+            ipc_server->register_command("tilemap.paste", [&](const ascii::json& params) -> ascii::json {
+                if (!params.contains("rows") || !params["rows"].is_array()) {
+                    return {{"success", false}, {"error", "rows must be an array of strings"}};
+                }
+                const ascii::json legend_json = params.value("legend", ascii::json::object());
+                std::unordered_map<uint32_t, ascii::Tile> legend;
+                for (const auto& [glyph, tile] : legend_json.items()) {
+                    if (!tile_from_json(tile, materials, legend[ascii::decode_glyph(glyph)])) {
+                        return {{"success", false}, {"error", "Unknown material id in legend: " + glyph}};
+                    }
+                }
+                size_t changed = recorded_tile_edit("tilemap.paste", false, [&] {
+                    return tilemap.paste(params.value("layer", 0), params.value("x", 0), params.value("y", 0),
+                                         params["rows"].get<std::vector<std::string>>(), legend);
+                });
+                return {{"success", true}, {"changed", changed}};
+            });
+
             // camera.get - Return camera state
             // Capture camera variables by reference (they're declared below)
             // We'll re-register this after camera vars are declared
@@ -829,10 +1409,116 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // Field of view, pathfinding, proximity queries, physics and tweens for scripts
+        ascii::FieldOfView fov;
+        ascii::Pathfinder pathfinder;
+        ascii::SceneProximity proximity;
+        proximity.sync(scene_world, scene_index);
+        ascii::ScenePhysics scene_physics;
+        ascii::TweenSystem tweens;
+
+        // Game scripts. Bindings edit engine state directly; tile edits are
+        // picked up by the tilemap renderer at the start of the next frame.
+        ascii::LuaRuntime lua;
+        lua.set_error_callback([&](const std::string& message) {
+            if (ipc_server) {
+                ipc_server->emit_event("lua_error", {{"message", message}});
+            }
+        });
+        ascii::bind_math(lua);
+        ascii::bind_materials(lua, materials);
+        ascii::bind_tilemap(lua, tilemap, materials);
+        ascii::bind_fov(lua, fov, tilemap, jobs);
+        ascii::bind_paths(lua, pathfinder, tilemap, jobs);
+        ascii::bind_proximity(lua, proximity, jobs);
+        ascii::bind_physics(lua, scene_physics);
+        ascii::bind_particles(lua, particles);
+        ascii::bind_tweens(lua, tweens, scene_world, scene_index, materials);
+        ascii::bind_scene(lua, scene_world, scene_index, scene_transforms);
+        ascii::bind_schemas(lua, schemas, scene_world, scene_index);
+        ascii::CoroutineScheduler scheduler(lua);
+        ascii::bind_scheduler(lua, scheduler);
+        ascii::LuaWorkers lua_workers(lua, jobs);
+        ascii::bind_workers(lua, lua_workers);
+        ascii::LuaProfiler lua_profiler(lua);
+        if (lua.run_file("lua/main.lua")) {
+            lua.call("on_init");
+        }
+
+        if (ipc_server) {
+            // scripts.stats - Coroutine scheduler and Lua worker counters of the last frame
+            ipc_server->register_command("scripts.stats", [&](const ascii::json& params) -> ascii::json {
+                const ascii::SchedulerStats& stats = scheduler.stats();
+                return {
+                    {"success", true},
+                    {"tasks", scheduler.size()},
+                    {"timers", scheduler.timers()},
+                    {"budget", scheduler.budget()},
+                    {"resumed", stats.resumed},
+                    {"timers_fired", stats.timers_fired},
+                    {"signalled", stats.signalled},
+                    {"conditions_polled", stats.conditions_polled},
+                    {"deferred", stats.deferred},
+                    {"finished", stats.finished},
+                    {"ms", stats.ms},
+                    {"workers", lua_workers.count()},
+                    {"workers_run_ms", lua_workers.run_ms()},
+                    {"workers_merge_ms", lua_workers.merge_ms()},
+                    {"workers_writes", lua_workers.writes()}
+                };
+            });
+
+            // lua.profile.start - Sample the game scripts (params: interval in VM instructions)
+            ipc_server->register_command("lua.profile.start", [&](const ascii::json& params) -> ascii::json {
+                const int interval = params.value("interval", ascii::LuaProfiler::DEFAULT_INTERVAL);
+                if (interval <= 0) {
+                    return {{"success", false}, {"error", "Invalid interval"}};
+                }
+                lua_profiler.start(interval);
+                return {{"success", true}, {"interval", interval}};
+            });
+
+            // lua.profile.stop - Collapsed stacks in microseconds (flamegraph.pl input), also
+            // written to params.path when given
+            ipc_server->register_command("lua.profile.stop", [&](const ascii::json& params) -> ascii::json {
+                if (!lua_profiler.running()) {
+                    return {{"success", false}, {"error", "Profiler not running"}};
+                }
+                const ascii::ProfileReport report = lua_profiler.stop();
+                const std::string path = params.value("path", std::string());
+                if (!path.empty()) {
+                    std::ofstream file(path, std::ios::binary);
+                    if (!file) {
+                        return {{"success", false}, {"error", "Cannot write " + path}};
+                    }
+                    file << report.collapsed;
+                }
+                ascii::json bindings = ascii::json::array();
+                for (const ascii::ProfileBinding& binding : report.bindings) {
+                    bindings.push_back({{"name", binding.name}, {"calls", binding.calls}, {"ms", binding.ms}});
+                }
+                return {
+                    {"success", true},
+                    {"collapsed", report.collapsed},
+                    {"bindings", bindings},
+                    {"samples", report.samples},
+                    {"lua_ms", report.lua_ms},
+                    {"wall_ms", report.wall_ms}
+                };
+            });
+        }
+
         // Camera state
         glm::vec3 camera_pos(5.0f, 1.0f, 8.0f);
         float camera_yaw = 0.0f;
         float camera_pitch = 0.0f;
+        if (scene_info.has_camera) {
+            // Look down at the scene camera's target from the south
+            const float distance = 8.0f / std::max(scene_info.camera_zoom, 0.1f);
+            camera_pos = scene_info.camera_target + glm::vec3(0.0f, distance * 0.75f, distance);
+            camera_yaw = glm::pi<float>();
+            camera_pitch = -0.6f;
+        }
         const float move_speed = 5.0f;
         const float mouse_sensitivity = 0.002f;
 
@@ -915,10 +1601,129 @@ int main(int argc, char* argv[]) {
                 camera_pos += right * move_speed * dt;
             }
 
+            bool tweened = false;
+            if (!play_paused) {
+                lua.call("on_update", dt);
+                scheduler.update(dt);
+                lua_workers.update(dt, scene_world, schemas, scene_transforms);
+                ascii::emit_worker_messages(lua, lua_workers);
+                scene_physics.step(scene_world, scene_transforms, tilemap, dt);
+                ascii::emit_contacts(lua, scene_physics);
+                tweens.update(dt, scene_world, scene_transforms, materials);
+                ascii::emit_tweens_done(lua, tweens);
+                tweened = true;
+                particles.simulate(dt);
+            }
+
+            // Sync point for the scene world: run the IPC requests received
+            // since the last frame, apply deferred structural changes, then
+            // re-extract what the renderer reads from it. Moves only
+            // recompute the dirty subtrees and rewrite their instances.
+            if (ipc_server) {
+                ipc_server->poll();
+            }
+            scene_world.flush();
+            bool scene_changed = false;
+            bool scene_rebuilt = false;    // Structural change; otherwise only transforms moved
+            if (scene_world.structure_version() != scene_version) {
+                scene_version = scene_world.structure_version();
+                schemas.prune(scene_world);
+                scene_transforms.update(scene_world, jobs);
+                scene_extractor.extract_instances(scene_world, scene_geometry, jobs, &scene_transforms, &lod);
+                scene_extractor.extract_lights(scene_world, lights);
+                scene_changed = true;
+                scene_rebuilt = true;
+            } else if (scene_transforms.update(scene_world, jobs) > 0) {
+                scene_extractor.update_instances(scene_transforms);
+                scene_extractor.update_lod(lod);
+                scene_extractor.extract_lights(scene_world, lights);
+                scene_changed = true;
+            }
+            if (scene_changed) {
+                proximity.sync(scene_world, scene_index);
+            }
+            if (tweened && !tweens.rebound_sprites().empty()) {
+                // Glyphs whose color tween gave them a private material
+                scene_extractor.update_materials(scene_world, scene_transforms, tweens.rebound_sprites(),
+                                                 !scene_changed);
+                scene_changed = true;
+            }
+
+            // Materials created by scripts since the last upload, otherwise
+            // just the entries tweens changed (recorded into this frame's
+            // command buffer, no wait)
+            if (materials.size() != rt_pipeline.material_count()) {
+                vulkan.wait_idle();  // Material buffer is host-visible and read by in-flight frames
+                rt_pipeline.set_materials(materials.entries());
+            } else if (tweened && !tweens.dirty_materials().empty()) {
+                for (uint16_t id : tweens.dirty_materials()) {
+                    rt_pipeline.update_material(id, materials.get(id));
+                }
+            }
+
+            // Re-emit tilemap chunks edited by scripts or IPC
+            bool rebuild_tlas = tilemap_renderer.sync(tilemap) || scene_rebuilt;
+
+            const float fov_y = glm::radians(75.0f);
+
+            // Level of detail: swap glyph BLASes by projected size and merge
+            // distant lights. Both only touch the GPU when something changed.
+            {
+                const float viewport_height = static_cast<float>(vulkan.swapchain_extent().height);
+                const float pixels_per_unit = viewport_height / (2.0f * std::tan(fov_y * 0.5f));
+                const auto& changes = lod.update(camera_pos, pixels_per_unit);
+                for (const auto& change : changes) {
+                    instances.set_blas(change.instance_index, change.blas_index);
+                }
+                rebuild_tlas = rebuild_tlas || !changes.empty();
+
+                bool lights_changed = scene_changed;
+                const std::vector<ascii::Light>* light_source = &lights;
+                if (particle_lights || particles.has_lights()) {
+                    frame_lights = lights;
+                    particles.append_lights(frame_lights);
+                    light_source = &frame_lights;
+                    lights_changed = true;
+                    particle_lights = particles.has_lights();
+                }
+                if (lod.aggregate_lights(*light_source, camera_pos, render_lights, lights_changed)) {
+                    vulkan.wait_idle();  // Light buffer is host-visible and read by in-flight frames
+                    rt_pipeline.set_lights(render_lights);
+                }
+            }
+
+            // One TLAS build covers structural scene, tile and LOD changes.
+            // Otherwise moved glyphs (scripts, physics, tweens) and particles
+            // only refit it over the slots they rewrote, in the frame's
+            // command buffer; the first time particle slots are added to
+            // the store it can't, and builds.
+            uint32_t refit_begin = UINT32_MAX;
+            uint32_t refit_end = 0;
+            if (particles.write_instances()) {
+                refit_begin = particles.dirty_first();
+                refit_end = particles.dirty_first() + particles.dirty_count();
+            }
+            if (scene_changed && scene_extractor.dirty_count() > 0) {
+                refit_begin = std::min(refit_begin, scene_extractor.dirty_first());
+                refit_end = std::max(refit_end, scene_extractor.dirty_first() + scene_extractor.dirty_count());
+            }
+            if (refit_begin >= refit_end) {
+                refit_begin = refit_end = 0;
+            } else if (!accel.can_refit(instances)) {
+                rebuild_tlas = true;
+            }
+            if (rebuild_tlas) {
+                accel.build_tlas(instances);
+                rt_pipeline.update_tlas_descriptor();
+            }
+
             // Begin frame
             vulkan.begin_frame();
 
             VkCommandBuffer cmd = vulkan.current_command_buffer();
+            if (!rebuild_tlas && accel.can_refit(instances)) {
+                accel.refit_tlas(cmd, instances, refit_begin, refit_end - refit_begin);
+            }
             VkImage swapchain_image = vulkan.current_swapchain_image();
             VkExtent2D extent = vulkan.swapchain_extent();
 
@@ -929,7 +1734,7 @@ int main(int argc, char* argv[]) {
                 glm::vec3(0, 1, 0)
             );
             glm::mat4 proj = glm::perspective(
-                glm::radians(75.0f),
+                fov_y,
                 static_cast<float>(extent.width) / static_cast<float>(extent.height),
                 0.1f,
                 100.0f
@@ -3,10 +3,34 @@
 
 #include <spdlog/spdlog.h>
 #include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 namespace ascii {
 
+namespace {
+
+void memory_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                    VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
+    VkMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stage;
+    barrier.srcAccessMask = src_access;
+    barrier.dstStageMask = dst_stage;
+    barrier.dstAccessMask = dst_access;
+
+    VkDependencyInfo dependency{};
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.memoryBarrierCount = 1;
+    dependency.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+} // anonymous namespace
+
 AccelerationStructureManager::AccelerationStructureManager(VulkanContext& ctx)
     : m_ctx(ctx)
 {
@@ -26,6 +50,11 @@ AccelerationStructureManager::AccelerationStructureManager(VulkanContext& ctx)
         throw std::runtime_error("Failed to load acceleration structure functions");
     }
 
+    // The primitive buffer is bound by the RT pipeline even before any mesh
+    // registers primitives, so make sure it always exists
+    upload_primitives();
+    m_tlas.frames.resize(VulkanContext::MAX_FRAMES_IN_FLIGHT);
+
     spdlog::info("Acceleration structure manager initialized");
 }
 
@@ -81,66 +110,84 @@ uint32_t AccelerationStructureManager::create_cube_blas() {
     return create_blas(vertices, indices);
 }
 
-uint32_t AccelerationStructureManager::create_letter_a_blas() {
-    // Create a 3D extruded letter "A"
-    // Each face has its own vertices with proper normals for smooth shading
+namespace {
 
+struct GlyphMeshData {
     std::vector<glm::vec3> vertices;
     std::vector<uint32_t> indices;
+    std::vector<MeshPrimitive> primitives;
+};
 
-    // Helper to add a box with proper normals (each face has unique vertices)
-    auto add_box = [&](glm::vec3 center, glm::vec3 size, float rotationZ = 0.0f) {
-        glm::vec3 half = size * 0.5f;
-
-        // Rotation matrix
-        float c = std::cos(rotationZ);
-        float s = std::sin(rotationZ);
-
-        auto rotate_and_translate = [&](glm::vec3 v) -> glm::vec3 {
-            float rx = v.x * c - v.y * s;
-            float ry = v.x * s + v.y * c;
-            return glm::vec3(rx + center.x, ry + center.y, v.z + center.z);
-        };
-
-        // Define each face with 4 vertices (24 vertices total per box)
-        // This allows proper face normals
-        struct Face {
-            glm::vec3 corners[4];
-        };
-
-        Face faces[6] = {
-            // Front face (+Z)
-            {{{-half.x, -half.y, half.z}, {half.x, -half.y, half.z}, {half.x, half.y, half.z}, {-half.x, half.y, half.z}}},
-            // Back face (-Z)
-            {{{half.x, -half.y, -half.z}, {-half.x, -half.y, -half.z}, {-half.x, half.y, -half.z}, {half.x, half.y, -half.z}}},
-            // Right face (+X)
-            {{{half.x, -half.y, half.z}, {half.x, -half.y, -half.z}, {half.x, half.y, -half.z}, {half.x, half.y, half.z}}},
-            // Left face (-X)
-            {{{-half.x, -half.y, -half.z}, {-half.x, -half.y, half.z}, {-half.x, half.y, half.z}, {-half.x, half.y, -half.z}}},
-            // Top face (+Y)
-            {{{-half.x, half.y, half.z}, {half.x, half.y, half.z}, {half.x, half.y, -half.z}, {-half.x, half.y, -half.z}}},
-            // Bottom face (-Y)
-            {{{-half.x, -half.y, -half.z}, {half.x, -half.y, -half.z}, {half.x, -half.y, half.z}, {-half.x, -half.y, half.z}}},
-        };
-
-        for (int f = 0; f < 6; f++) {
-            uint32_t base = static_cast<uint32_t>(vertices.size());
-
-            // Add 4 vertices for this face
-            for (int v = 0; v < 4; v++) {
-                vertices.push_back(rotate_and_translate(faces[f].corners[v]));
-            }
+// Add a box with proper normals (each face has unique vertices).
+// With front_back_only the four thin side faces are skipped (simplified LOD).
+void append_glyph_box(GlyphMeshData& mesh, const GlyphBox& box, bool front_back_only) {
+    glm::vec3 half = box.size * 0.5f;
 
-            // Two triangles per face
-            indices.push_back(base + 0);
-            indices.push_back(base + 1);
-            indices.push_back(base + 2);
-            indices.push_back(base + 2);
-            indices.push_back(base + 3);
-            indices.push_back(base + 0);
-        }
+    // Rotation matrix
+    float c = std::cos(box.rotation_z);
+    float s = std::sin(box.rotation_z);
+
+    auto rotate = [&](glm::vec3 v) -> glm::vec3 {
+        return glm::vec3(v.x * c - v.y * s, v.x * s + v.y * c, v.z);
+    };
+
+    // Define each face with 4 vertices (24 vertices total per box)
+    // This allows proper face normals
+    struct Face {
+        glm::vec3 corners[4];
+        glm::vec3 normal;
+    };
+
+    const Face faces[6] = {
+        // Front face (+Z)
+        {{{-half.x, -half.y, half.z}, {half.x, -half.y, half.z}, {half.x, half.y, half.z}, {-half.x, half.y, half.z}}, {0, 0, 1}},
+        // Back face (-Z)
+        {{{half.x, -half.y, -half.z}, {-half.x, -half.y, -half.z}, {-half.x, half.y, -half.z}, {half.x, half.y, -half.z}}, {0, 0, -1}},
+        // Right face (+X)
+        {{{half.x, -half.y, half.z}, {half.x, -half.y, -half.z}, {half.x, half.y, -half.z}, {half.x, half.y, half.z}}, {1, 0, 0}},
+        // Left face (-X)
+        {{{-half.x, -half.y, -half.z}, {-half.x, -half.y, half.z}, {-half.x, half.y, half.z}, {-half.x, half.y, -half.z}}, {-1, 0, 0}},
+        // Top face (+Y)
+        {{{-half.x, half.y, half.z}, {half.x, half.y, half.z}, {half.x, half.y, -half.z}, {-half.x, half.y, -half.z}}, {0, 1, 0}},
+        // Bottom face (-Y)
+        {{{-half.x, -half.y, -half.z}, {half.x, -half.y, -half.z}, {half.x, -half.y, half.z}, {-half.x, -half.y, half.z}}, {0, -1, 0}},
     };
 
+    const int face_count = front_back_only ? 2 : 6;
+    for (int f = 0; f < face_count; f++) {
+        uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+
+        // Add 4 vertices for this face
+        for (int v = 0; v < 4; v++) {
+            mesh.vertices.push_back(rotate(faces[f].corners[v]) + box.center);
+        }
+
+        // Two triangles per face
+        mesh.indices.insert(mesh.indices.end(), {base + 0, base + 1, base + 2, base + 2, base + 3, base + 0});
+
+        MeshPrimitive primitive;
+        primitive.normal = rotate(faces[f].normal);
+        mesh.primitives.push_back(primitive);
+        mesh.primitives.push_back(primitive);
+    }
+}
+
+// Corners of a (rotated) glyph box in glyph space
+std::array<glm::vec3, 8> glyph_box_corners(const GlyphBox& box) {
+    float c = std::cos(box.rotation_z);
+    float s = std::sin(box.rotation_z);
+    glm::vec3 half = box.size * 0.5f;
+
+    std::array<glm::vec3, 8> corners;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 v((i & 1) ? half.x : -half.x, (i & 2) ? half.y : -half.y, (i & 4) ? half.z : -half.z);
+        corners[i] = glm::vec3(v.x * c - v.y * s, v.x * s + v.y * c, v.z) + box.center;
+    }
+    return corners;
+}
+
+// Boxes making up the 3D extruded letter "A"
+std::vector<GlyphBox> letter_a_boxes() {
     // Letter "A" dimensions
     float depth = 0.2f;       // Z thickness (chunkier)
     float leg_width = 0.15f;  // Width of the legs
@@ -151,37 +198,78 @@ uint32_t AccelerationStructureManager::create_letter_a_blas() {
     float leg_angle = std::atan2(width * 0.5f, height);
     float leg_length = height / std::cos(leg_angle);
 
-    // Left leg (angled - apex at top, so negative rotation)
-    add_box(
-        glm::vec3(-width * 0.22f, 0.0f, 0.0f),
-        glm::vec3(leg_width, leg_length, depth),
-        -leg_angle  // FIXED: negative angle
-    );
-
-    // Right leg (angled - positive rotation)
-    add_box(
-        glm::vec3(width * 0.22f, 0.0f, 0.0f),
-        glm::vec3(leg_width, leg_length, depth),
-        leg_angle   // FIXED: positive angle
-    );
-
-    // Crossbar (horizontal, positioned at ~1/3 from bottom)
-    float crossbar_y = -height * 0.12f;
-    float crossbar_width = width * 0.38f;
-    add_box(
-        glm::vec3(0.0f, crossbar_y, 0.0f),
-        glm::vec3(crossbar_width, leg_width * 0.9f, depth),
-        0.0f
-    );
-
-    // Top peak cap
-    add_box(
-        glm::vec3(0.0f, height * 0.42f, 0.0f),
-        glm::vec3(leg_width * 1.8f, leg_width * 1.2f, depth),
-        0.0f
-    );
+    return {
+        // Left leg (angled - apex at top, so negative rotation)
+        {glm::vec3(-width * 0.22f, 0.0f, 0.0f), glm::vec3(leg_width, leg_length, depth), -leg_angle},
+        // Right leg (angled - positive rotation)
+        {glm::vec3(width * 0.22f, 0.0f, 0.0f), glm::vec3(leg_width, leg_length, depth), leg_angle},
+        // Crossbar (horizontal, positioned at ~1/3 from bottom)
+        {glm::vec3(0.0f, -height * 0.12f, 0.0f), glm::vec3(width * 0.38f, leg_width * 0.9f, depth), 0.0f},
+        // Top peak cap
+        {glm::vec3(0.0f, height * 0.42f, 0.0f), glm::vec3(leg_width * 1.8f, leg_width * 1.2f, depth), 0.0f},
+    };
+}
 
-    return create_blas(vertices, indices);
+} // anonymous namespace
+
+uint32_t AccelerationStructureManager::create_letter_a_blas() {
+    return create_letter_a_lods().blas[0];
+}
+
+GlyphLodChain AccelerationStructureManager::create_letter_a_lods() {
+    return create_glyph_lods(letter_a_boxes());
+}
+
+GlyphLodChain AccelerationStructureManager::create_glyph_lods(const std::vector<GlyphBox>& boxes) {
+    if (boxes.empty()) {
+        throw std::runtime_error("Glyph mesh needs at least one box");
+    }
+
+    GlyphLodChain chain;
+
+    // Bounds of the full glyph (for the box LOD and projected-size selection)
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(std::numeric_limits<float>::lowest());
+    for (const auto& box : boxes) {
+        for (const auto& corner : glyph_box_corners(box)) {
+            bounds_min = glm::min(bounds_min, corner);
+            bounds_max = glm::max(bounds_max, corner);
+            chain.radius = std::max(chain.radius, glm::length(corner));
+        }
+    }
+
+    // LOD 0: every box with all six faces
+    GlyphMeshData full;
+    for (const auto& box : boxes) {
+        append_glyph_box(full, box, false);
+    }
+
+    // LOD 1: drop small detail boxes and the thin side faces, which are
+    // sub-pixel by the time this level is selected
+    float largest_area = 0.0f;
+    for (const auto& box : boxes) {
+        largest_area = std::max(largest_area, box.size.x * box.size.y);
+    }
+    GlyphMeshData simplified;
+    for (const auto& box : boxes) {
+        if (box.size.x * box.size.y >= largest_area * GlyphLodChain::DETAIL_AREA_FRACTION) {
+            append_glyph_box(simplified, box, true);
+        }
+    }
+
+    // LOD 2: plain bounding box
+    GlyphMeshData bounds_box;
+    append_glyph_box(bounds_box, GlyphBox{(bounds_min + bounds_max) * 0.5f, bounds_max - bounds_min, 0.0f}, false);
+
+    const GlyphMeshData* levels[GlyphLodChain::LEVEL_COUNT] = {&full, &simplified, &bounds_box};
+    for (uint32_t level = 0; level < GlyphLodChain::LEVEL_COUNT; level++) {
+        chain.blas[level] = create_blas(levels[level]->vertices, levels[level]->indices, levels[level]->primitives);
+        chain.triangles[level] = static_cast<uint32_t>(levels[level]->indices.size() / 3);
+    }
+
+    spdlog::info("Created glyph LOD chain: {} / {} / {} triangles",
+                 chain.triangles[0], chain.triangles[1], chain.triangles[2]);
+    return chain;
 }
 
 uint32_t AccelerationStructureManager::create_blas(const std::vector<glm::vec3>& vertices,
@@ -189,9 +277,124 @@ uint32_t AccelerationStructureManager::create_blas(const std::vector<glm::vec3>&
     uint32_t index = static_cast<uint32_t>(m_blas_list.size());
     m_blas_list.emplace_back();
     create_blas_internal(m_blas_list.back(), vertices, indices);
+    m_blas_addresses.push_back(m_blas_list.back().device_address);
+    return index;
+}
+
+uint32_t AccelerationStructureManager::create_blas(const std::vector<glm::vec3>& vertices,
+                                                    const std::vector<uint32_t>& indices,
+                                                    const std::vector<MeshPrimitive>& primitives) {
+    if (primitives.size() != indices.size() / 3) {
+        throw std::runtime_error("BLAS primitive count does not match triangle count");
+    }
+
+    uint32_t index = create_blas(vertices, indices);
+    m_blas_list[index].primitive_base = allocate_primitives(static_cast<uint32_t>(primitives.size()));
+    m_blas_list[index].primitive_capacity = static_cast<uint32_t>(primitives.size());
+    write_primitives(m_blas_list[index].primitive_base, primitives);
     return index;
 }
 
+void AccelerationStructureManager::update_blas(uint32_t index,
+                                               const std::vector<glm::vec3>& vertices,
+                                               const std::vector<uint32_t>& indices,
+                                               const std::vector<MeshPrimitive>& primitives) {
+    if (primitives.size() != indices.size() / 3) {
+        throw std::runtime_error("BLAS primitive count does not match triangle count");
+    }
+
+    BLAS& blas = m_blas_list.at(index);
+
+    // The old structure may still be referenced by in-flight frames
+    m_ctx.wait_idle();
+    if (blas.handle != VK_NULL_HANDLE) {
+        vkDestroyAccelerationStructureKHR(m_ctx.device(), blas.handle, nullptr);
+        blas.handle = VK_NULL_HANDLE;
+    }
+    create_blas_internal(blas, vertices, indices);
+    m_blas_addresses[index] = blas.device_address;
+
+    if (blas.primitive_base == BLAS::NO_PRIMITIVES || primitives.size() > blas.primitive_capacity) {
+        // Outgrew its range: free it for other meshes and take a new one
+        if (blas.primitive_base != BLAS::NO_PRIMITIVES) {
+            free_primitives(blas.primitive_base, blas.primitive_capacity);
+        }
+        blas.primitive_base = allocate_primitives(static_cast<uint32_t>(primitives.size()));
+        blas.primitive_capacity = static_cast<uint32_t>(primitives.size());
+    }
+    write_primitives(blas.primitive_base, primitives);
+}
+
+// First fit among the freed ranges, else the end of the array
+uint32_t AccelerationStructureManager::allocate_primitives(uint32_t count) {
+    for (auto it = m_free_primitives.begin(); it != m_free_primitives.end(); ++it) {
+        if (it->count >= count) {
+            const uint32_t first = it->first;
+            it->first += count;
+            it->count -= count;
+            if (it->count == 0) {
+                m_free_primitives.erase(it);
+            }
+            return first;
+        }
+    }
+    const uint32_t first = static_cast<uint32_t>(m_primitives.size());
+    m_primitives.resize(m_primitives.size() + count);
+    return first;
+}
+
+// Into the sorted free list, merged with the ranges next to it; free space
+// at the end of the array is dropped instead
+void AccelerationStructureManager::free_primitives(uint32_t first, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    auto it = std::lower_bound(m_free_primitives.begin(), m_free_primitives.end(), first,
+                               [](const PrimitiveRange& range, uint32_t at) { return range.first < at; });
+    it = m_free_primitives.insert(it, {first, count});
+    if (auto next = it + 1; next != m_free_primitives.end() && it->first + it->count == next->first) {
+        it->count += next->count;
+        m_free_primitives.erase(next);
+    }
+    if (it != m_free_primitives.begin()) {
+        auto prev = it - 1;
+        if (prev->first + prev->count == it->first) {
+            prev->count += it->count;
+            it = m_free_primitives.erase(it) - 1;
+        }
+    }
+    if (it->first + it->count == m_primitives.size()) {
+        m_primitives.resize(it->first);
+        m_free_primitives.erase(it);
+    }
+}
+
+// Into m_primitives and the buffer; only the range is uploaded unless the
+// buffer has to grow
+void AccelerationStructureManager::write_primitives(uint32_t first, const std::vector<MeshPrimitive>& primitives) {
+    std::copy(primitives.begin(), primitives.end(), m_primitives.begin() + first);
+    if (std::max<size_t>(m_primitives.size(), 1) * sizeof(MeshPrimitive) > m_primitive_buffer.size()) {
+        upload_primitives();
+    } else if (!primitives.empty()) {
+        m_primitive_buffer.upload(primitives.data(), primitives.size() * sizeof(MeshPrimitive),
+                                  first * sizeof(MeshPrimitive));
+    }
+}
+
+void AccelerationStructureManager::upload_primitives() {
+    // Keep at least one entry so the storage buffer is never zero-sized
+    VkDeviceSize required_size = std::max<size_t>(m_primitives.size(), 1) * sizeof(MeshPrimitive);
+    if (required_size > m_primitive_buffer.size()) {
+        m_ctx.wait_idle();
+        m_primitive_buffer = Buffer(m_ctx, required_size * 2,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+    if (!m_primitives.empty()) {
+        m_primitive_buffer.upload(m_primitives.data(), m_primitives.size() * sizeof(MeshPrimitive));
+    }
+}
+
 void AccelerationStructureManager::create_blas_internal(BLAS& blas,
                                                          const std::vector<glm::vec3>& vertices,
                                                          const std::vector<uint32_t>& indices) {
@@ -294,57 +497,73 @@ void AccelerationStructureManager::create_blas_internal(BLAS& blas,
     address_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
     address_info.accelerationStructure = blas.handle;
     blas.device_address = vkGetAccelerationStructureDeviceAddressKHR(m_ctx.device(), &address_info);
+    blas.triangle_count = primitive_count;
 
-    spdlog::info("Created BLAS with {} triangles", primitive_count);
+    spdlog::debug("Created BLAS with {} triangles", primitive_count);
 }
 
-void AccelerationStructureManager::build_tlas(const std::vector<Instance>& instances) {
+void AccelerationStructureManager::reserve_instance_buffers(size_t instance_count) {
+    VkDeviceSize instance_size = instance_count * sizeof(VkAccelerationStructureInstanceKHR);
+    VkDeviceSize geometry_size = instance_count * sizeof(uint32_t);
+    for (TLASFrame& frame : m_tlas.frames) {
+        if (instance_size > frame.instance_buffer.size()) {
+            frame.instance_buffer = Buffer(m_ctx, instance_size * 2,
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+        if (geometry_size > frame.geometry_buffer.size()) {
+            frame.geometry_buffer = Buffer(m_ctx, geometry_size * 2,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+    }
+}
+
+// Expand [begin, end) into the frame's mapped buffers
+void AccelerationStructureManager::write_instances(TLASFrame& frame, const InstanceStore& instances,
+                                                   uint32_t begin, uint32_t end) {
+    auto* vk_instances = static_cast<VkAccelerationStructureInstanceKHR*>(frame.instance_buffer.map());
+    instances.write_tlas_instances(begin, end, m_blas_addresses.data(), vk_instances);
+
+    // Where each instance's per-triangle data starts (NO_PRIMITIVES for plain cubes)
+    auto* instance_geometry = static_cast<uint32_t*>(frame.geometry_buffer.map());
+    for (uint32_t i = begin; i < end; i++) {
+        instance_geometry[i] = m_blas_list[instances.blas_index(i)].primitive_base;
+    }
+}
+
+void AccelerationStructureManager::build_tlas(const InstanceStore& instances) {
     if (instances.empty()) {
         spdlog::warn("build_tlas called with empty instance list");
         return;
     }
 
-    // Destroy old TLAS if exists
+    // Destroy old TLAS if exists (this also makes the instance buffers safe to overwrite)
     if (m_tlas.handle != VK_NULL_HANDLE) {
         m_ctx.wait_idle();
         vkDestroyAccelerationStructureKHR(m_ctx.device(), m_tlas.handle, nullptr);
         m_tlas.handle = VK_NULL_HANDLE;
     }
 
-    // Create instance data
-    std::vector<VkAccelerationStructureInstanceKHR> vk_instances;
-    vk_instances.reserve(instances.size());
+    reserve_instance_buffers(instances.size());
 
-    for (const auto& inst : instances) {
-        VkAccelerationStructureInstanceKHR vk_inst{};
-
-        // Convert glm::mat4 to VkTransformMatrixKHR (3x4 row-major)
-        glm::mat4 transposed = glm::transpose(inst.transform);
-        std::memcpy(&vk_inst.transform, &transposed, sizeof(VkTransformMatrixKHR));
-
-        vk_inst.instanceCustomIndex = inst.custom_index;
-        vk_inst.mask = inst.mask;
-        vk_inst.instanceShaderBindingTableRecordOffset = inst.sbt_offset;
-        vk_inst.flags = inst.flags;
-        vk_inst.accelerationStructureReference = m_blas_list[inst.blas_index].device_address;
-
-        vk_instances.push_back(vk_inst);
-    }
-
-    // Create instance buffer
-    VkDeviceSize instance_size = vk_instances.size() * sizeof(VkAccelerationStructureInstanceKHR);
-    m_tlas.instance_buffer = Buffer(m_ctx, instance_size,
-        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_tlas.instance_buffer.upload(vk_instances.data(), instance_size);
+    // Build from the current frame's copy; the others are rewritten whole
+    // before their frames refit
     m_tlas.instance_count = static_cast<uint32_t>(instances.size());
+    for (TLASFrame& frame : m_tlas.frames) {
+        frame.stale_begin = 0;
+        frame.stale_end = m_tlas.instance_count;
+    }
+    TLASFrame& frame = m_tlas.frames[m_ctx.current_frame()];
+    write_instances(frame, instances, 0, m_tlas.instance_count);
+    frame.stale_end = 0;
 
     // Geometry description for instances
     VkAccelerationStructureGeometryInstancesDataKHR instances_data{};
     instances_data.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
     instances_data.arrayOfPointers = VK_FALSE;
-    instances_data.data.deviceAddress = m_tlas.instance_buffer.device_address();
+    instances_data.data.deviceAddress = frame.instance_buffer.device_address();
 
     VkAccelerationStructureGeometryKHR geometry{};
     geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
@@ -356,7 +575,8 @@ void AccelerationStructureManager::build_tlas(const std::vector<Instance>& insta
     VkAccelerationStructureBuildGeometryInfoKHR build_info{};
     build_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
     build_info.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    build_info.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    build_info.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                       VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
     build_info.geometryCount = 1;
     build_info.pGeometries = &geometry;
 
@@ -394,6 +614,12 @@ void AccelerationStructureManager::build_tlas(const std::vector<Instance>& insta
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
         VMA_MEMORY_USAGE_GPU_ONLY);
+    if (size_info.updateScratchSize > m_tlas.update_scratch.size()) {
+        m_tlas.update_scratch = Buffer(m_ctx, size_info.updateScratchSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY);
+    }
 
     // Build the AS
     build_info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
@@ -415,4 +641,82 @@ void AccelerationStructureManager::build_tlas(const std::vector<Instance>& insta
     spdlog::info("Built TLAS with {} instances", instance_count);
 }
 
+bool AccelerationStructureManager::can_refit(const InstanceStore& instances) const {
+    return m_tlas.handle != VK_NULL_HANDLE && instances.size() == m_tlas.instance_count;
+}
+
+void AccelerationStructureManager::refit_tlas(VkCommandBuffer cmd, const InstanceStore& instances,
+                                              uint32_t first, uint32_t count) {
+    if (!can_refit(instances) || static_cast<size_t>(first) + count > instances.size()) {
+        throw std::runtime_error("refit_tlas: instances don't match the TLAS");
+    }
+
+    // The other frames' copies miss this refit until they come round again
+    if (count > 0) {
+        for (TLASFrame& other : m_tlas.frames) {
+            if (other.stale_begin >= other.stale_end) {
+                other.stale_begin = first;
+                other.stale_end = first + count;
+            } else {
+                other.stale_begin = std::min(other.stale_begin, first);
+                other.stale_end = std::max(other.stale_end, first + count);
+            }
+        }
+    }
+
+    // begin_frame() waited for this frame's last submission, so its copy is free
+    TLASFrame& frame = m_tlas.frames[m_ctx.current_frame()];
+    if (frame.stale_begin < frame.stale_end) {
+        write_instances(frame, instances, frame.stale_begin, frame.stale_end);
+        frame.stale_begin = 0;
+        frame.stale_end = 0;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    VkAccelerationStructureGeometryInstancesDataKHR instances_data{};
+    instances_data.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    instances_data.arrayOfPointers = VK_FALSE;
+    instances_data.data.deviceAddress = frame.instance_buffer.device_address();
+
+    VkAccelerationStructureGeometryKHR geometry{};
+    geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+    geometry.geometry.instances = instances_data;
+
+    // Same flags and geometry as the build, updating in place
+    VkAccelerationStructureBuildGeometryInfoKHR build_info{};
+    build_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    build_info.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    build_info.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                       VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    build_info.geometryCount = 1;
+    build_info.pGeometries = &geometry;
+    build_info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+    build_info.srcAccelerationStructure = m_tlas.handle;
+    build_info.dstAccelerationStructure = m_tlas.handle;
+    build_info.scratchData.deviceAddress = m_tlas.update_scratch.device_address();
+
+    VkAccelerationStructureBuildRangeInfoKHR range_info{};
+    range_info.primitiveCount = m_tlas.instance_count;
+    const VkAccelerationStructureBuildRangeInfoKHR* p_range_info = &range_info;
+
+    // The previous frame's trace and refit are done with the TLAS (and the
+    // update scratch) before this refit rewrites it, and the refit is done
+    // before this frame's trace reads it
+    memory_barrier(cmd,
+        VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+    vkCmdBuildAccelerationStructuresKHR(cmd, 1, &build_info, &p_range_info);
+    memory_barrier(cmd,
+        VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+        VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+}
+
 } // namespace ascii
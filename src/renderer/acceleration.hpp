@@ -1,11 +1,13 @@
 #pragma once
 
 #include "buffer.hpp"
+#include "instance_store.hpp"
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <array>
 #include <vector>
 #include <memory>
 
@@ -13,28 +15,61 @@ namespace ascii {
 
 class VulkanContext;
 
+// Per-triangle shading data for meshes whose normals can't be derived
+// analytically from a unit cube in the closest-hit shader
+struct MeshPrimitive {
+    static constexpr uint32_t INHERIT_MATERIAL = 0xFFFFFFFFu;
+
+    glm::vec3 normal{0.0f, 1.0f, 0.0f};     // Object-space face normal
+    uint32_t material = INHERIT_MATERIAL;    // Material id, or use the instance's
+};
+
 // A single bottom-level acceleration structure (geometry)
 struct BLAS {
+    static constexpr uint32_t NO_PRIMITIVES = 0xFFFFFFFFu;
+
     VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
     Buffer buffer;
     VkDeviceAddress device_address = 0;
+    uint32_t triangle_count = 0;
+    uint32_t primitive_base = NO_PRIMITIVES;  // Offset into the primitive buffer
+    uint32_t primitive_capacity = 0;          // Entries reserved at primitive_base
+};
+
+// One box of an extruded glyph mesh, in glyph space
+struct GlyphBox {
+    glm::vec3 center{0.0f};
+    glm::vec3 size{1.0f};
+    float rotation_z = 0.0f;       // Rotation around the extrusion axis (radians)
+};
+
+// BLAS per level of detail for one glyph mesh: full, simplified, plain box
+struct GlyphLodChain {
+    static constexpr uint32_t LEVEL_COUNT = 3;
+    static constexpr float DETAIL_AREA_FRACTION = 0.25f;  // Smaller boxes are dropped at LOD 1
+
+    std::array<uint32_t, LEVEL_COUNT> blas{};
+    std::array<uint32_t, LEVEL_COUNT> triangles{};
+    float radius = 0.0f;           // Bounding sphere radius around the glyph origin
 };
 
-// Instance data for TLAS
-struct Instance {
-    glm::mat4 transform = glm::mat4(1.0f);
-    uint32_t custom_index = 0;     // gl_InstanceCustomIndexEXT
-    uint32_t mask = 0xFF;
-    uint32_t sbt_offset = 0;       // Shader binding table offset
-    VkGeometryInstanceFlagsKHR flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-    uint32_t blas_index = 0;       // Which BLAS to use
+// Instance data one frame in flight builds and traces from, so a refit
+// never writes what an earlier frame may still read. Instances refitted
+// while this copy was in flight are in [stale_begin, stale_end), and
+// rewritten before it is used again.
+struct TLASFrame {
+    Buffer instance_buffer;        // Persistently mapped, reused while large enough
+    Buffer geometry_buffer;        // Per-instance primitive_base (indexed by gl_InstanceID)
+    uint32_t stale_begin = 0;
+    uint32_t stale_end = 0;
 };
 
 // Top-level acceleration structure (scene)
 struct TLAS {
     VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
     Buffer buffer;
-    Buffer instance_buffer;
+    std::vector<TLASFrame> frames; // One per frame in flight
+    Buffer update_scratch;         // Kept for refit_tlas, sized by the last build
     uint32_t instance_count = 0;
 };
 
@@ -49,29 +84,90 @@ public:
     uint32_t create_blas(const std::vector<glm::vec3>& vertices,
                          const std::vector<uint32_t>& indices);
 
+    // Create a BLAS with per-triangle normals/materials (one entry per triangle)
+    uint32_t create_blas(const std::vector<glm::vec3>& vertices,
+                         const std::vector<uint32_t>& indices,
+                         const std::vector<MeshPrimitive>& primitives);
+
+    // Rebuild an existing BLAS with new geometry, keeping its index so
+    // instances referring to it pick up the change on the next build_tlas.
+    // The primitive range is reused when the new mesh fits in it; an
+    // outgrown range is freed for later meshes.
+    void update_blas(uint32_t index,
+                     const std::vector<glm::vec3>& vertices,
+                     const std::vector<uint32_t>& indices,
+                     const std::vector<MeshPrimitive>& primitives);
+
     // Create a simple unit cube BLAS centered at origin
     uint32_t create_cube_blas();
 
-    // Create a 3D letter "A" BLAS
+    // Create a 3D letter "A" BLAS (full detail)
     uint32_t create_letter_a_blas();
 
-    // Build/rebuild the TLAS with given instances
-    void build_tlas(const std::vector<Instance>& instances);
+    // Create all LOD levels of the letter "A"
+    GlyphLodChain create_letter_a_lods();
+
+    // Create the LOD chain for a glyph built from boxes
+    GlyphLodChain create_glyph_lods(const std::vector<GlyphBox>& boxes);
+
+    // Build/rebuild the TLAS with given instances. Transforms are expanded
+    // straight into the current frame's mapped instance buffer; the other
+    // frames' copies catch up in their next refit_tlas().
+    void build_tlas(const InstanceStore& instances);
+
+    // Whether refit_tlas() can update the TLAS for these instances: false
+    // when there is none or the instance count differs, in which case the
+    // caller should build_tlas() instead
+    bool can_refit(const InstanceStore& instances) const;
+
+    // Rewrite instances [first, first + count) into the current frame's
+    // buffers, along with those earlier refits changed while it was in
+    // flight, and record an in-place refit of the TLAS into cmd (same
+    // handle, so descriptors stay valid), fenced off from the previous
+    // frame's trace and ahead of this one's. Call it after begin_frame()
+    // on every frame that doesn't build_tlas(), with count = 0 when nothing
+    // moved: the frame's instance geometry may still have to catch up.
+    // Only transforms, masks and BLAS of existing instances may change, and
+    // can_refit() must hold. Refits loosen the tree, so moving a large share
+    // of the scene this way every frame will slow tracing down until the
+    // next full build.
+    void refit_tlas(VkCommandBuffer cmd, const InstanceStore& instances, uint32_t first, uint32_t count);
 
     // Getters
     const BLAS& get_blas(uint32_t index) const { return m_blas_list[index]; }
     const TLAS& get_tlas() const { return m_tlas; }
     VkAccelerationStructureKHR tlas_handle() const { return m_tlas.handle; }
+    const Buffer& primitive_buffer() const { return m_primitive_buffer; }
+    const Buffer& geometry_buffer(uint32_t frame) const { return m_tlas.frames[frame].geometry_buffer; }
 
 private:
     void create_blas_internal(BLAS& blas,
                               const std::vector<glm::vec3>& vertices,
                               const std::vector<uint32_t>& indices);
 
+    uint32_t allocate_primitives(uint32_t count);
+    void free_primitives(uint32_t first, uint32_t count);
+    void write_primitives(uint32_t first, const std::vector<MeshPrimitive>& primitives);
+    void upload_primitives();
+    void reserve_instance_buffers(size_t instance_count);
+    void write_instances(TLASFrame& frame, const InstanceStore& instances, uint32_t begin, uint32_t end);
+
     VulkanContext& m_ctx;
     std::vector<BLAS> m_blas_list;
+    std::vector<VkDeviceAddress> m_blas_addresses;  // By BLAS index, for instance writes
     TLAS m_tlas;
 
+    struct PrimitiveRange {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Shading data for all BLAS registered with primitives, in ranges
+    // reserved per BLAS; freed ranges are reused first fit
+    std::vector<MeshPrimitive> m_primitives;
+    std::vector<PrimitiveRange> m_free_primitives;     // Sorted by first, never adjacent
+    Buffer m_primitive_buffer;
+
     // Cached function pointers
     PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR = nullptr;
     PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR = nullptr;
@@ -0,0 +1,289 @@
+#include "instance_store.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASCII_INSTANCE_AVX2 1
+#endif
+
+namespace ascii {
+
+namespace {
+
+// The bitfield half of VkAccelerationStructureInstanceKHR packed into plain
+// words, so it is stored with one write instead of read-modify-write on
+// bitfields (reads from write-combined memory are very slow)
+struct InstanceTail {
+    uint32_t custom_index_mask;
+    uint32_t sbt_offset_flags;
+    uint64_t reference;
+};
+static_assert(sizeof(VkAccelerationStructureInstanceKHR) == sizeof(VkTransformMatrixKHR) + sizeof(InstanceTail));
+
+} // anonymous namespace
+
+uint32_t InstanceStore::add(const glm::vec3& position,
+                            const glm::quat& rotation,
+                            const glm::vec3& scale,
+                            uint32_t blas_index,
+                            uint32_t custom_index) {
+    m_pos_x.push_back(position.x);
+    m_pos_y.push_back(position.y);
+    m_pos_z.push_back(position.z);
+    m_rot_x.push_back(rotation.x);
+    m_rot_y.push_back(rotation.y);
+    m_rot_z.push_back(rotation.z);
+    m_rot_w.push_back(rotation.w);
+    m_scale_x.push_back(scale.x);
+    m_scale_y.push_back(scale.y);
+    m_scale_z.push_back(scale.z);
+    m_blas.push_back(blas_index);
+    m_custom_index.push_back(custom_index);
+    m_sbt_offset.push_back(0);
+    m_mask.push_back(0xFF);
+    m_flags.push_back(static_cast<uint8_t>(DEFAULT_FLAGS));
+    return static_cast<uint32_t>(m_blas.size() - 1);
+}
+
+void InstanceStore::resize(size_t count) {
+    for (auto* column : {&m_pos_x, &m_pos_y, &m_pos_z, &m_rot_x, &m_rot_y, &m_rot_z}) {
+        column->resize(count, 0.0f);
+    }
+    m_rot_w.resize(count, 1.0f);
+    for (auto* column : {&m_scale_x, &m_scale_y, &m_scale_z}) {
+        column->resize(count, 1.0f);
+    }
+    m_blas.resize(count, 0);
+    m_custom_index.resize(count, 0);
+    m_sbt_offset.resize(count, 0);
+    m_mask.resize(count, 0xFF);
+    m_flags.resize(count, static_cast<uint8_t>(DEFAULT_FLAGS));
+}
+
+uint32_t InstanceStore::append_transforms(size_t count, const InstanceTransformArrays& src) {
+    const size_t first = size();
+    resize(first + count);
+    if (count == 0) {
+        return static_cast<uint32_t>(first);
+    }
+
+    std::vector<float>* columns[10] = {&m_pos_x, &m_pos_y, &m_pos_z, &m_rot_x, &m_rot_y, &m_rot_z, &m_rot_w,
+                                       &m_scale_x, &m_scale_y, &m_scale_z};
+    const float* sources[10] = {src.position[0], src.position[1], src.position[2],
+                                src.rotation[0], src.rotation[1], src.rotation[2], src.rotation[3],
+                                src.scale[0], src.scale[1], src.scale[2]};
+    for (int i = 0; i < 10; i++) {
+        std::memcpy(columns[i]->data() + first, sources[i], count * sizeof(float));
+    }
+    return static_cast<uint32_t>(first);
+}
+
+InstanceTransformArrays InstanceStore::transform_arrays() const {
+    return {{m_pos_x.data(), m_pos_y.data(), m_pos_z.data()},
+            {m_rot_x.data(), m_rot_y.data(), m_rot_z.data(), m_rot_w.data()},
+            {m_scale_x.data(), m_scale_y.data(), m_scale_z.data()}};
+}
+
+void InstanceStore::reserve(size_t count) {
+    for (auto* column : {&m_pos_x, &m_pos_y, &m_pos_z, &m_rot_x, &m_rot_y, &m_rot_z, &m_rot_w,
+                         &m_scale_x, &m_scale_y, &m_scale_z}) {
+        column->reserve(count);
+    }
+    m_blas.reserve(count);
+    m_custom_index.reserve(count);
+    m_sbt_offset.reserve(count);
+    m_mask.reserve(count);
+    m_flags.reserve(count);
+}
+
+void InstanceStore::clear() {
+    for (auto* column : {&m_pos_x, &m_pos_y, &m_pos_z, &m_rot_x, &m_rot_y, &m_rot_z, &m_rot_w,
+                         &m_scale_x, &m_scale_y, &m_scale_z}) {
+        column->clear();
+    }
+    m_blas.clear();
+    m_custom_index.clear();
+    m_sbt_offset.clear();
+    m_mask.clear();
+    m_flags.clear();
+}
+
+void InstanceStore::set_position(uint32_t index, const glm::vec3& position) {
+    m_pos_x[index] = position.x;
+    m_pos_y[index] = position.y;
+    m_pos_z[index] = position.z;
+}
+
+void InstanceStore::set_rotation(uint32_t index, const glm::quat& rotation) {
+    m_rot_x[index] = rotation.x;
+    m_rot_y[index] = rotation.y;
+    m_rot_z[index] = rotation.z;
+    m_rot_w[index] = rotation.w;
+}
+
+void InstanceStore::set_scale(uint32_t index, const glm::vec3& scale) {
+    m_scale_x[index] = scale.x;
+    m_scale_y[index] = scale.y;
+    m_scale_z[index] = scale.z;
+}
+
+bool InstanceStore::simd_available() {
+#ifdef ASCII_INSTANCE_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void InstanceStore::write_tlas_instances(const VkDeviceAddress* blas_addresses,
+                                         VkAccelerationStructureInstanceKHR* dst,
+                                         bool allow_simd) const {
+    write_tlas_instances(0, size(), blas_addresses, dst, allow_simd);
+}
+
+void InstanceStore::write_tlas_instances(size_t begin, size_t end,
+                                         const VkDeviceAddress* blas_addresses,
+                                         VkAccelerationStructureInstanceKHR* dst,
+                                         bool allow_simd) const {
+    size_t done = begin;
+#ifdef ASCII_INSTANCE_AVX2
+    if (allow_simd) {
+        done = end - (end - begin) % 8;
+        write_avx2(begin, done, blas_addresses, dst);
+    }
+#else
+    (void)allow_simd;
+#endif
+    write_scalar(done, end, blas_addresses, dst);
+}
+
+void InstanceStore::write_scalar(size_t begin, size_t end, const VkDeviceAddress* blas_addresses,
+                                 VkAccelerationStructureInstanceKHR* dst) const {
+    for (size_t i = begin; i < end; i++) {
+        const float x = m_rot_x[i], y = m_rot_y[i], z = m_rot_z[i], w = m_rot_w[i];
+        const float sx = m_scale_x[i], sy = m_scale_y[i], sz = m_scale_z[i];
+
+        // Rotation matrix from the quaternion, columns scaled
+        VkTransformMatrixKHR transform;
+        transform.matrix[0][0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+        transform.matrix[0][1] = 2.0f * (x * y - w * z) * sy;
+        transform.matrix[0][2] = 2.0f * (x * z + w * y) * sz;
+        transform.matrix[0][3] = m_pos_x[i];
+        transform.matrix[1][0] = 2.0f * (x * y + w * z) * sx;
+        transform.matrix[1][1] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+        transform.matrix[1][2] = 2.0f * (y * z - w * x) * sz;
+        transform.matrix[1][3] = m_pos_y[i];
+        transform.matrix[2][0] = 2.0f * (x * z - w * y) * sx;
+        transform.matrix[2][1] = 2.0f * (y * z + w * x) * sy;
+        transform.matrix[2][2] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+        transform.matrix[2][3] = m_pos_z[i];
+
+        InstanceTail tail;
+        tail.custom_index_mask = (m_custom_index[i] & 0xFFFFFFu) | (static_cast<uint32_t>(m_mask[i]) << 24);
+        tail.sbt_offset_flags = (m_sbt_offset[i] & 0xFFFFFFu) | (static_cast<uint32_t>(m_flags[i]) << 24);
+        tail.reference = blas_addresses[m_blas[i]];
+
+        char* out = reinterpret_cast<char*>(dst + i);
+        std::memcpy(out, &transform, sizeof(transform));
+        std::memcpy(out + sizeof(transform), &tail, sizeof(tail));
+    }
+}
+
+#ifdef ASCII_INSTANCE_AVX2
+
+void InstanceStore::write_avx2(size_t begin, size_t end, const VkDeviceAddress* blas_addresses,
+                               VkAccelerationStructureInstanceKHR* dst) const {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 x = _mm256_loadu_ps(&m_rot_x[i]);
+        const __m256 y = _mm256_loadu_ps(&m_rot_y[i]);
+        const __m256 z = _mm256_loadu_ps(&m_rot_z[i]);
+        const __m256 w = _mm256_loadu_ps(&m_rot_w[i]);
+        const __m256 sx = _mm256_loadu_ps(&m_scale_x[i]);
+        const __m256 sy = _mm256_loadu_ps(&m_scale_y[i]);
+        const __m256 sz = _mm256_loadu_ps(&m_scale_z[i]);
+
+        const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        const __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        // Matrix elements for 8 instances, in 3x4 row-major order
+        __m256 a[8];
+        a[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        a[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        a[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        a[3] = _mm256_loadu_ps(&m_pos_x[i]);
+        a[4] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        a[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        a[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        a[7] = _mm256_loadu_ps(&m_pos_y[i]);
+        __m256 b[4];
+        b[0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        b[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        b[2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+        b[3] = _mm256_loadu_ps(&m_pos_z[i]);
+
+        // Transpose rows 0-1 (8x8): row[k] = first 8 floats of instance k
+        __m256 t[8];
+        for (int k = 0; k < 8; k += 2) {
+            t[k] = _mm256_unpacklo_ps(a[k], a[k + 1]);
+            t[k + 1] = _mm256_unpackhi_ps(a[k], a[k + 1]);
+        }
+        __m256 s[8];
+        s[0] = _mm256_shuffle_ps(t[0], t[2], 0x44);
+        s[1] = _mm256_shuffle_ps(t[0], t[2], 0xEE);
+        s[2] = _mm256_shuffle_ps(t[1], t[3], 0x44);
+        s[3] = _mm256_shuffle_ps(t[1], t[3], 0xEE);
+        s[4] = _mm256_shuffle_ps(t[4], t[6], 0x44);
+        s[5] = _mm256_shuffle_ps(t[4], t[6], 0xEE);
+        s[6] = _mm256_shuffle_ps(t[5], t[7], 0x44);
+        s[7] = _mm256_shuffle_ps(t[5], t[7], 0xEE);
+        __m256 row[8];
+        for (int k = 0; k < 4; k++) {
+            row[k] = _mm256_permute2f128_ps(s[k], s[k + 4], 0x20);
+            row[k + 4] = _mm256_permute2f128_ps(s[k], s[k + 4], 0x31);
+        }
+
+        // Transpose row 2 (4x8): lane 0 of last[k] is instance k, lane 1 is instance k + 4
+        const __m256 u0 = _mm256_unpacklo_ps(b[0], b[1]);
+        const __m256 u1 = _mm256_unpackhi_ps(b[0], b[1]);
+        const __m256 u2 = _mm256_unpacklo_ps(b[2], b[3]);
+        const __m256 u3 = _mm256_unpackhi_ps(b[2], b[3]);
+        const __m256 last[4] = {
+            _mm256_shuffle_ps(u0, u2, 0x44),
+            _mm256_shuffle_ps(u0, u2, 0xEE),
+            _mm256_shuffle_ps(u1, u3, 0x44),
+            _mm256_shuffle_ps(u1, u3, 0xEE),
+        };
+
+        // Each instance is written as one contiguous 64-byte run
+        for (int k = 0; k < 8; k++) {
+            const size_t n = i + k;
+            const __m128 row2 = k < 4 ? _mm256_castps256_ps128(last[k]) : _mm256_extractf128_ps(last[k - 4], 1);
+            const uint32_t custom_index_mask = (m_custom_index[n] & 0xFFFFFFu) | (static_cast<uint32_t>(m_mask[n]) << 24);
+            const uint32_t sbt_offset_flags = (m_sbt_offset[n] & 0xFFFFFFu) | (static_cast<uint32_t>(m_flags[n]) << 24);
+            const __m128i tail = _mm_set_epi64x(
+                static_cast<long long>(blas_addresses[m_blas[n]]),
+                static_cast<long long>((static_cast<uint64_t>(sbt_offset_flags) << 32) | custom_index_mask));
+
+            float* out = reinterpret_cast<float*>(dst + n);
+            _mm256_storeu_ps(out, row[k]);
+            _mm_storeu_ps(out + 8, row2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), tail);
+        }
+    }
+}
+
+#else
+
+void InstanceStore::write_avx2(size_t begin, size_t end, const VkDeviceAddress* blas_addresses,
+                               VkAccelerationStructureInstanceKHR* dst) const {
+    write_scalar(begin, end, blas_addresses, dst);
+}
+
+#endif
+
+} // namespace ascii
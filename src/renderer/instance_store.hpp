@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// Borrowed pointers to the ten SoA transform columns of a run of instances
+struct InstanceTransformArrays {
+    const float* position[3];      // x, y, z
+    const float* rotation[4];      // x, y, z, w
+    const float* scale[3];
+};
+
+// TLAS instances stored as structure-of-arrays with a compact
+// translation / rotation / scale instead of a full matrix per instance.
+// write_tlas_instances() expands batches of 8 into 3x4 row-major transforms
+// with AVX2 (scalar fallback otherwise), writing each
+// VkAccelerationStructureInstanceKHR whole so it can target mapped
+// (write-combined) GPU memory directly.
+class InstanceStore {
+public:
+    static constexpr VkGeometryInstanceFlagsKHR DEFAULT_FLAGS = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+
+    // Returns the instance index (gl_InstanceID)
+    uint32_t add(const glm::vec3& position,
+                 const glm::quat& rotation,
+                 const glm::vec3& scale,
+                 uint32_t blas_index,
+                 uint32_t custom_index);
+
+    // Grow or shrink to count instances; new ones get an identity transform,
+    // BLAS 0 and custom index 0. Setters on distinct indices may then be
+    // called from several threads at once.
+    void resize(size_t count);
+
+    // Append count instances whose transforms are copied column by column
+    // from src (e.g. arrays in a mapped scene file); the other fields get
+    // the resize() defaults. Returns the first new index.
+    uint32_t append_transforms(size_t count, const InstanceTransformArrays& src);
+
+    // The transform columns, valid until the store is next resized
+    InstanceTransformArrays transform_arrays() const;
+
+    void reserve(size_t count);
+    void clear();
+    size_t size() const { return m_blas.size(); }
+    bool empty() const { return m_blas.empty(); }
+
+    void set_position(uint32_t index, const glm::vec3& position);
+    void set_rotation(uint32_t index, const glm::quat& rotation);
+    void set_scale(uint32_t index, const glm::vec3& scale);
+    void set_blas(uint32_t index, uint32_t blas_index) { m_blas[index] = blas_index; }
+    void set_custom_index(uint32_t index, uint32_t custom_index) { m_custom_index[index] = custom_index; }
+    void set_mask(uint32_t index, uint8_t mask) { m_mask[index] = mask; }
+    void set_flags(uint32_t index, VkGeometryInstanceFlagsKHR flags) { m_flags[index] = static_cast<uint8_t>(flags); }
+
+    glm::vec3 position(uint32_t index) const { return {m_pos_x[index], m_pos_y[index], m_pos_z[index]}; }
+    glm::vec3 scale(uint32_t index) const { return {m_scale_x[index], m_scale_y[index], m_scale_z[index]}; }
+    uint32_t blas_index(uint32_t index) const { return m_blas[index]; }
+    uint32_t custom_index(uint32_t index) const { return m_custom_index[index]; }
+
+    // Fill dst[0, size()) with Vulkan instances.
+    // blas_addresses maps blas_index -> BLAS device address.
+    // allow_simd = false forces the scalar path (for benchmarks).
+    void write_tlas_instances(const VkDeviceAddress* blas_addresses,
+                              VkAccelerationStructureInstanceKHR* dst,
+                              bool allow_simd = true) const;
+
+    // Fill dst[begin, end) only, e.g. a range refitted in place
+    void write_tlas_instances(size_t begin, size_t end,
+                              const VkDeviceAddress* blas_addresses,
+                              VkAccelerationStructureInstanceKHR* dst,
+                              bool allow_simd = true) const;
+
+    // True when the AVX2 kernel was compiled in
+    static bool simd_available();
+
+private:
+    void write_scalar(size_t begin, size_t end, const VkDeviceAddress* blas_addresses,
+                      VkAccelerationStructureInstanceKHR* dst) const;
+    void write_avx2(size_t begin, size_t end, const VkDeviceAddress* blas_addresses,
+                    VkAccelerationStructureInstanceKHR* dst) const;
+
+    // Transform (SoA)
+    std::vector<float> m_pos_x, m_pos_y, m_pos_z;
+    std::vector<float> m_rot_x, m_rot_y, m_rot_z, m_rot_w;   // Unit quaternion
+    std::vector<float> m_scale_x, m_scale_y, m_scale_z;
+
+    // Vulkan instance fields
+    std::vector<uint32_t> m_blas;
+    std::vector<uint32_t> m_custom_index;                    // gl_InstanceCustomIndexEXT (24 bits)
+    std::vector<uint32_t> m_sbt_offset;                      // Shader binding table offset (24 bits)
+    std::vector<uint8_t> m_mask;
+    std::vector<uint8_t> m_flags;
+};
+
+} // namespace ascii
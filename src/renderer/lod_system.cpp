@@ -0,0 +1,222 @@
+#include "lod_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASCII_LOD_SSE 1
+#endif
+
+namespace ascii {
+
+LodSystem::LodSystem(const LodSettings& settings)
+    : m_settings(settings)
+{
+}
+
+uint32_t LodSystem::add_chain(const GlyphLodChain& chain) {
+    m_chains.push_back(chain);
+    return static_cast<uint32_t>(m_chains.size() - 1);
+}
+
+uint32_t LodSystem::track(uint32_t instance_index, uint32_t chain_id, const glm::vec3& position, float scale) {
+    if (chain_id >= m_chains.size()) {
+        throw std::runtime_error("Unknown LOD chain");
+    }
+
+    m_pos_x.push_back(position.x);
+    m_pos_y.push_back(position.y);
+    m_pos_z.push_back(position.z);
+    m_radius.push_back(m_chains[chain_id].radius * scale);
+    m_instance.push_back(instance_index);
+    m_chain.push_back(chain_id);
+    m_level.push_back(0);
+    return static_cast<uint32_t>(m_instance.size() - 1);
+}
+
+void LodSystem::set_position(uint32_t handle, const glm::vec3& position) {
+    m_pos_x[handle] = position.x;
+    m_pos_y[handle] = position.y;
+    m_pos_z[handle] = position.z;
+}
+
+void LodSystem::truncate(size_t count) {
+    if (count >= m_instance.size()) {
+        return;
+    }
+    m_pos_x.resize(count);
+    m_pos_y.resize(count);
+    m_pos_z.resize(count);
+    m_radius.resize(count);
+    m_instance.resize(count);
+    m_chain.resize(count);
+    m_level.resize(count);
+}
+
+void LodSystem::clear() {
+    m_chains.clear();
+    m_pos_x.clear();
+    m_pos_y.clear();
+    m_pos_z.clear();
+    m_radius.clear();
+    m_instance.clear();
+    m_chain.clear();
+    m_level.clear();
+    m_changes.clear();
+    m_lights_valid = false;
+}
+
+void LodSystem::compute_projected_sizes(const glm::vec3& camera_pos, float pixels_per_unit) {
+    const size_t count = m_instance.size();
+    m_projected.resize(count);
+
+    // Projected diameter = 2 * radius * pixels_per_unit / distance
+    const float scale = 2.0f * pixels_per_unit;
+    constexpr float min_dist2 = 1.0e-4f;
+    size_t i = 0;
+
+#ifdef ASCII_LOD_SSE
+    const __m128 cx = _mm_set1_ps(camera_pos.x);
+    const __m128 cy = _mm_set1_ps(camera_pos.y);
+    const __m128 cz = _mm_set1_ps(camera_pos.z);
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 vmin = _mm_set1_ps(min_dist2);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_pos_x[i]), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_pos_y[i]), cy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_pos_z[i]), cz);
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        // Approximate reciprocal sqrt is plenty for picking a level
+        __m128 inv_dist = _mm_rsqrt_ps(_mm_max_ps(dist2, vmin));
+        __m128 size = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_radius[i]), vscale), inv_dist);
+        _mm_storeu_ps(&m_projected[i], size);
+    }
+#endif
+
+    for (; i < count; i++) {
+        float dx = m_pos_x[i] - camera_pos.x;
+        float dy = m_pos_y[i] - camera_pos.y;
+        float dz = m_pos_z[i] - camera_pos.z;
+        float dist2 = std::max(dx * dx + dy * dy + dz * dz, min_dist2);
+        m_projected[i] = m_radius[i] * scale / std::sqrt(dist2);
+    }
+}
+
+const std::vector<LodChange>& LodSystem::update(const glm::vec3& camera_pos, float pixels_per_unit) {
+    m_changes.clear();
+    compute_projected_sizes(camera_pos, pixels_per_unit);
+
+    // thresholds[l] = size below which level l is wanted (level 0 has none)
+    const float thresholds[GlyphLodChain::LEVEL_COUNT] = {
+        0.0f, m_settings.simplified_below_px, m_settings.box_below_px
+    };
+    const float coarser = 1.0f - m_settings.hysteresis;
+    const float finer = 1.0f + m_settings.hysteresis;
+    constexpr uint8_t max_level = GlyphLodChain::LEVEL_COUNT - 1;
+
+    for (size_t i = 0; i < m_instance.size(); i++) {
+        const float size = m_projected[i];
+        uint8_t level = m_level[i];
+        while (level < max_level && size < thresholds[level + 1] * coarser) {
+            level++;
+        }
+        while (level > 0 && size > thresholds[level] * finer) {
+            level--;
+        }
+
+        if (level != m_level[i]) {
+            m_level[i] = level;
+            m_changes.push_back({m_instance[i], m_chains[m_chain[i]].blas[level], level});
+        }
+    }
+    return m_changes;
+}
+
+bool LodSystem::aggregate_lights(const std::vector<Light>& source, const glm::vec3& camera_pos,
+                                 std::vector<Light>& out, bool source_changed) {
+    const float cell = m_settings.light_merge_cell;
+    glm::ivec3 camera_cell(static_cast<int>(std::floor(camera_pos.x / cell)),
+                           static_cast<int>(std::floor(camera_pos.y / cell)),
+                           static_cast<int>(std::floor(camera_pos.z / cell)));
+
+    if (m_lights_valid && !source_changed && camera_cell == m_light_camera_cell) {
+        return false;
+    }
+    m_light_camera_cell = camera_cell;
+    m_lights_valid = true;
+
+    // Measure from the cell center so the result only depends on the cell,
+    // which is what the cache above keys on
+    glm::vec3 reference((camera_cell.x + 0.5f) * cell, (camera_cell.y + 0.5f) * cell, (camera_cell.z + 0.5f) * cell);
+    const float merge_dist2 = m_settings.light_merge_distance * m_settings.light_merge_distance;
+
+    struct Aggregate {
+        glm::vec3 weighted_pos{0.0f};
+        glm::vec3 weighted_color{0.0f};
+        float power = 0.0f;
+        std::vector<const Light*> members;
+    };
+    std::map<std::tuple<int, int, int>, Aggregate> aggregates;  // Ordered for stable output
+
+    out.clear();
+    for (const auto& light : source) {
+        if (light.color.a <= 0.0f) {
+            break;  // Terminator
+        }
+
+        glm::vec3 pos(light.position);
+        glm::vec3 delta = pos - reference;
+        if (glm::dot(delta, delta) <= merge_dist2) {
+            out.push_back(light);
+            continue;
+        }
+
+        auto key = std::make_tuple(static_cast<int>(std::floor(pos.x / cell)),
+                                   static_cast<int>(std::floor(pos.y / cell)),
+                                   static_cast<int>(std::floor(pos.z / cell)));
+        Aggregate& agg = aggregates[key];
+        float power = light.color.a;
+        agg.weighted_pos += pos * power;
+        agg.weighted_color += glm::vec3(light.color) * power;
+        agg.power += power;
+        agg.members.push_back(&light);
+    }
+
+    for (const auto& [key, agg] : aggregates) {
+        if (agg.members.size() == 1) {
+            out.push_back(*agg.members.front());
+            continue;
+        }
+
+        glm::vec3 center = agg.weighted_pos / agg.power;
+        float radius = 0.0f;
+        for (const Light* member : agg.members) {
+            radius = std::max(radius, glm::length(glm::vec3(member->position) - center) + member->position.w);
+        }
+
+        Light merged;
+        merged.position = glm::vec4(center, radius);
+        merged.color = glm::vec4(agg.weighted_color / agg.power, agg.power);
+        out.push_back(merged);
+    }
+
+    Light terminator;
+    terminator.position = glm::vec4(0.0f);
+    terminator.color = glm::vec4(0.0f);  // power = 0 signals end
+    out.push_back(terminator);
+    return true;
+}
+
+std::array<uint32_t, GlyphLodChain::LEVEL_COUNT> LodSystem::level_counts() const {
+    std::array<uint32_t, GlyphLodChain::LEVEL_COUNT> counts{};
+    for (uint8_t level : m_level) {
+        counts[level]++;
+    }
+    return counts;
+}
+
+} // namespace ascii
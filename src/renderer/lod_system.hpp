@@ -0,0 +1,93 @@
+#pragma once
+
+#include "acceleration.hpp"
+#include "rt_pipeline.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+struct LodSettings {
+    // Projected size (pixels of bounding diameter) below which a coarser level is used
+    float simplified_below_px = 96.0f;
+    float box_below_px = 24.0f;
+    // Fraction of the threshold an instance must cross before switching back,
+    // so instances sitting on a boundary don't flip every frame
+    float hysteresis = 0.15f;
+
+    // Lights further than this from the camera are merged into aggregates
+    float light_merge_distance = 20.0f;
+    float light_merge_cell = 8.0f;     // Aggregation grid cell size
+};
+
+// An instance whose BLAS should change after update()
+struct LodChange {
+    uint32_t instance_index;
+    uint32_t blas_index;
+    uint8_t level;
+};
+
+// Per-instance LOD selection for glyph meshes and distance-based merging of
+// lights. Tracked instances are stored as SoA so the projected-size pass runs
+// four instances per SIMD step; only instances that actually change level are
+// reported, so the caller only rebuilds the TLAS when something moved.
+class LodSystem {
+public:
+    explicit LodSystem(const LodSettings& settings = {});
+
+    // Register a LOD chain, returns its id
+    uint32_t add_chain(const GlyphLodChain& chain);
+
+    // Track an instance using a chain; scale multiplies the chain's bounding radius.
+    // The instance starts at full detail.
+    uint32_t track(uint32_t instance_index, uint32_t chain_id, const glm::vec3& position, float scale);
+    void set_position(uint32_t handle, const glm::vec3& position);
+
+    // Stop tracking the instances tracked after the first count (their
+    // handles become free again); chains stay registered
+    void truncate(size_t count);
+    void clear();
+
+    // Select levels for all tracked instances.
+    // pixels_per_unit: projected size of 1 world unit at distance 1
+    // (viewport_height / (2 * tan(fov_y / 2))).
+    const std::vector<LodChange>& update(const glm::vec3& camera_pos, float pixels_per_unit);
+
+    // Merge lights beyond light_merge_distance into one aggregate per grid
+    // cell. Returns false (and leaves out untouched) when the camera hasn't
+    // changed cell and the source lights are unchanged since the last call.
+    // Both lists end with the power = 0 terminator the shader expects.
+    bool aggregate_lights(const std::vector<Light>& source, const glm::vec3& camera_pos,
+                          std::vector<Light>& out, bool source_changed = false);
+
+    size_t tracked_count() const { return m_instance.size(); }
+    std::array<uint32_t, GlyphLodChain::LEVEL_COUNT> level_counts() const;
+
+private:
+    void compute_projected_sizes(const glm::vec3& camera_pos, float pixels_per_unit);
+
+    LodSettings m_settings;
+    std::vector<GlyphLodChain> m_chains;
+
+    // Tracked instances (SoA)
+    std::vector<float> m_pos_x;
+    std::vector<float> m_pos_y;
+    std::vector<float> m_pos_z;
+    std::vector<float> m_radius;
+    std::vector<float> m_projected;   // Scratch: projected diameter in pixels
+    std::vector<uint32_t> m_instance;
+    std::vector<uint32_t> m_chain;
+    std::vector<uint8_t> m_level;
+
+    std::vector<LodChange> m_changes;
+
+    // Light aggregation cache
+    glm::ivec3 m_light_camera_cell{0};
+    bool m_lights_valid = false;
+};
+
+} // namespace ascii
@@ -0,0 +1,93 @@
+#include "material_table.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace ascii {
+
+static_assert(sizeof(Material) == 8 * sizeof(uint32_t), "Material must match the shader layout");
+
+bool MaterialTable::Key::operator==(const Key& other) const {
+    return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+}
+
+size_t MaterialTable::KeyHash::operator()(const Key& key) const {
+    // FNV-1a over the words
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : key.bits) {
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+MaterialTable::Key MaterialTable::make_key(const Material& material) {
+    Key key;
+    std::memcpy(key.bits, &material, sizeof(key.bits));
+    return key;
+}
+
+uint16_t MaterialTable::add(const Material& material) {
+    Key key = make_key(material);
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+        return it->second;
+    }
+
+    if (m_materials.size() >= MAX_MATERIALS) {
+        throw std::runtime_error("Material table is full");
+    }
+    uint16_t id = static_cast<uint16_t>(m_materials.size());
+    m_materials.push_back(material);
+    m_private.push_back(0);
+    m_lookup.emplace(key, id);
+    return id;
+}
+
+uint16_t MaterialTable::add_private(const Material& material) {
+    if (m_materials.size() >= MAX_MATERIALS) {
+        throw std::runtime_error("Material table is full");
+    }
+    uint16_t id = static_cast<uint16_t>(m_materials.size());
+    m_materials.push_back(material);
+    m_private.push_back(1);
+    return id;
+}
+
+void MaterialTable::set(uint16_t id, const Material& material) {
+    if (id >= m_materials.size()) {
+        throw std::runtime_error("Unknown material id");
+    }
+
+    if (m_private[id]) {
+        m_materials[id] = material;
+        return;
+    }
+
+    // Drop the old value from the lookup if it pointed here
+    auto it = m_lookup.find(make_key(m_materials[id]));
+    if (it != m_lookup.end() && it->second == id) {
+        m_lookup.erase(it);
+    }
+    m_materials[id] = material;
+    m_lookup.emplace(make_key(material), id);  // Keeps an existing identical entry if any
+}
+
+void MaterialTable::assign(const Material* materials, size_t count) {
+    if (count > MAX_MATERIALS) {
+        throw std::runtime_error("Material table is full");
+    }
+    clear();
+    m_materials.assign(materials, materials + count);
+    m_private.assign(count, 0);
+    for (size_t id = 0; id < count; id++) {
+        m_lookup.emplace(make_key(m_materials[id]), static_cast<uint16_t>(id));
+    }
+}
+
+void MaterialTable::clear() {
+    m_materials.clear();
+    m_private.clear();
+    m_lookup.clear();
+}
+
+} // namespace ascii
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+// Surface material stored in the material SSBO
+struct Material {
+    glm::vec4 color;           // rgb = color, a = roughness
+    glm::vec4 emission;        // rgb = emission, a = power
+};
+
+// Deduplicated material table. Instances refer to materials by a 16-bit id
+// packed into the low bits of instanceCustomIndex, so there is no
+// per-instance shading data on the GPU at all; editing a material touches
+// one table entry.
+class MaterialTable {
+public:
+    static constexpr uint32_t MAX_MATERIALS = 0x10000;
+    static constexpr uint32_t ID_MASK = 0xFFFFu;     // instanceCustomIndex bits holding the id
+
+    // Returns the id of an identical existing material, or adds a new one
+    uint16_t add(const Material& material);
+
+    // A new entry that add() never returns, for one owner to edit on its
+    // own (an entity's color tweens)
+    uint16_t add_private(const Material& material);
+
+    // Replace a material in place (every instance using it changes)
+    void set(uint16_t id, const Material& material);
+
+    // Replace the table with exactly these entries, keeping their ids
+    // (duplicates stay separate entries; add() finds the first). All of
+    // them are shared again.
+    void assign(const Material* materials, size_t count);
+
+    const Material& get(uint16_t id) const { return m_materials[id]; }
+    const std::vector<Material>& entries() const { return m_materials; }
+    size_t size() const { return m_materials.size(); }
+    bool contains(uint32_t id) const { return id < m_materials.size(); }
+    bool is_private(uint16_t id) const { return id < m_private.size() && m_private[id]; }
+    void clear();
+
+    static uint32_t custom_index(uint16_t id) { return id; }
+    static uint16_t material_id(uint32_t custom_index) { return static_cast<uint16_t>(custom_index & ID_MASK); }
+
+private:
+    struct Key {
+        uint32_t bits[8];
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    static Key make_key(const Material& material);
+
+    std::vector<Material> m_materials;
+    std::vector<uint8_t> m_private;     // Per entry: made by add_private, kept out of m_lookup
+    std::unordered_map<Key, uint16_t, KeyHash> m_lookup;
+};
+
+} // namespace ascii
@@ -0,0 +1,414 @@
+#include "particle_system.hpp"
+#include "material_table.hpp"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASCII_PARTICLE_AVX2 1
+#endif
+
+namespace ascii {
+
+namespace {
+
+const glm::quat NO_ROTATION(1.0f, 0.0f, 0.0f, 0.0f);
+
+uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Uniform in [0, 1)
+float random_unit(uint32_t& state) {
+    return static_cast<float>(next_random(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Uniform in [-1, 1) per axis
+glm::vec3 random_signed(uint32_t& state) {
+    const float x = random_unit(state);
+    const float y = random_unit(state);
+    const float z = random_unit(state);
+    return glm::vec3(x, y, z) * 2.0f - 1.0f;
+}
+
+} // anonymous namespace
+
+ParticleSystem::ParticleSystem(InstanceStore& instances, uint32_t cube_blas, uint32_t capacity)
+    : m_instances(instances), m_cube_blas(cube_blas), m_capacity(capacity)
+{
+    for (std::vector<float>* column : {&m_px, &m_py, &m_pz, &m_vx, &m_vy, &m_vz, &m_age, &m_inv_life, &m_size}) {
+        column->assign(capacity, 0.0f);
+    }
+}
+
+size_t ParticleSystem::find(uint32_t id) const {
+    auto it = std::lower_bound(m_emitters.begin(), m_emitters.end(), id,
+                               [](const Emitter& emitter, uint32_t key) { return emitter.id < key; });
+    return it != m_emitters.end() && it->id == id ? static_cast<size_t>(it - m_emitters.begin()) : m_emitters.size();
+}
+
+// First fit among the runs of the other emitters
+bool ParticleSystem::allocate_run(uint32_t size, uint32_t ignore_id, uint32_t& first) const {
+    if (size == 0 || size > m_capacity) {
+        return false;
+    }
+    std::vector<Run> taken;
+    for (const Emitter& emitter : m_emitters) {
+        if (emitter.id != ignore_id) {
+            taken.push_back({emitter.first, emitter.desc.max_particles});
+        }
+    }
+    std::sort(taken.begin(), taken.end(), [](const Run& a, const Run& b) { return a.first < b.first; });
+    uint32_t start = 0;
+    for (const Run& run : taken) {
+        if (run.first - start >= size) {
+            break;
+        }
+        start = std::max(start, run.first + run.count);
+    }
+    if (m_capacity - start < size) {
+        return false;
+    }
+    first = start;
+    return true;
+}
+
+uint32_t ParticleSystem::add_emitter(const ParticleEmitter& desc) {
+    uint32_t first;
+    if (!allocate_run(desc.max_particles, NO_EMITTER, first)) {
+        return NO_EMITTER;
+    }
+    Emitter emitter;
+    emitter.id = m_next_id++;
+    emitter.desc = desc;
+    emitter.first = first;
+    emitter.rng = (emitter.id + 1) * 0x9E3779B9u | 1u;
+    m_emitters.push_back(emitter);
+    return emitter.id;
+}
+
+bool ParticleSystem::set_emitter(uint32_t id, const ParticleEmitter& desc) {
+    const size_t i = find(id);
+    if (i == m_emitters.size()) {
+        return false;
+    }
+    Emitter& emitter = m_emitters[i];
+    if (desc.max_particles != emitter.desc.max_particles) {
+        uint32_t first;
+        if (!allocate_run(desc.max_particles, id, first)) {
+            return false;
+        }
+        // Runs may overlap; copy in the direction that doesn't overwrite
+        const uint32_t keep = std::min(emitter.alive, desc.max_particles);
+        if (first <= emitter.first) {
+            for (uint32_t k = 0; k < keep; k++) {
+                move_particle(emitter.first + k, first + k);
+            }
+        } else {
+            for (uint32_t k = keep; k-- > 0;) {
+                move_particle(emitter.first + k, first + k);
+            }
+        }
+        m_stale.push_back({emitter.first, emitter.drawn});
+        emitter.first = first;
+        emitter.alive = keep;
+        emitter.drawn = 0;
+    }
+    emitter.desc = desc;
+    return true;
+}
+
+const ParticleEmitter* ParticleSystem::emitter(uint32_t id) const {
+    const size_t i = find(id);
+    return i == m_emitters.size() ? nullptr : &m_emitters[i].desc;
+}
+
+bool ParticleSystem::remove_emitter(uint32_t id) {
+    const size_t i = find(id);
+    if (i == m_emitters.size()) {
+        return false;
+    }
+    m_stale.push_back({m_emitters[i].first, m_emitters[i].drawn});
+    m_emitters.erase(m_emitters.begin() + static_cast<std::ptrdiff_t>(i));
+    return true;
+}
+
+uint32_t ParticleSystem::burst(uint32_t id, uint32_t count) {
+    const size_t i = find(id);
+    if (i == m_emitters.size()) {
+        return 0;
+    }
+    Emitter& emitter = m_emitters[i];
+    const uint32_t before = emitter.alive;
+    spawn(emitter, count);
+    return emitter.alive - before;
+}
+
+void ParticleSystem::reset() {
+    m_emitters.clear();
+    m_stale.clear();
+    m_allocated = false;
+    m_first_slot = 0;
+    m_dirty_first = 0;
+    m_dirty_count = 0;
+}
+
+size_t ParticleSystem::live_count() const {
+    size_t count = 0;
+    for (const Emitter& emitter : m_emitters) {
+        count += emitter.alive;
+    }
+    return count;
+}
+
+bool ParticleSystem::simd_available() {
+#ifdef ASCII_PARTICLE_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ParticleSystem::simulate(float dt, bool allow_simd) {
+    if (dt <= 0.0f) {
+        return;
+    }
+    for (Emitter& emitter : m_emitters) {
+        const float damping = 1.0f / (1.0f + std::max(emitter.desc.drag, 0.0f) * dt);
+        const size_t begin = emitter.first;
+        const size_t end = begin + emitter.alive;
+        size_t done = begin;
+#ifdef ASCII_PARTICLE_AVX2
+        if (allow_simd) {
+            done = end - (end - begin) % 8;
+            integrate_avx2(begin, done, emitter, dt, damping);
+        }
+#else
+        (void)allow_simd;
+#endif
+        integrate_scalar(done, end, emitter, dt, damping);
+        retire(emitter);
+
+        if (emitter.desc.active && emitter.desc.rate > 0.0f) {
+            emitter.accumulator += emitter.desc.rate * dt;
+            const uint32_t count = static_cast<uint32_t>(emitter.accumulator);
+            emitter.accumulator -= static_cast<float>(count);
+            spawn(emitter, count);
+        }
+    }
+}
+
+void ParticleSystem::integrate_scalar(size_t begin, size_t end, const Emitter& emitter, float dt, float damping) {
+    const ParticleEmitter& desc = emitter.desc;
+    const glm::vec3 dv = desc.acceleration * dt;
+    const float size_delta = desc.size_end - desc.size_start;
+    for (size_t i = begin; i < end; i++) {
+        m_vx[i] = (m_vx[i] + dv.x) * damping;
+        m_vy[i] = (m_vy[i] + dv.y) * damping;
+        m_vz[i] = (m_vz[i] + dv.z) * damping;
+        m_px[i] = m_px[i] + m_vx[i] * dt;
+        m_py[i] = m_py[i] + m_vy[i] * dt;
+        m_pz[i] = m_pz[i] + m_vz[i] * dt;
+        m_age[i] = m_age[i] + m_inv_life[i] * dt;
+        m_size[i] = desc.size_start + size_delta * m_age[i];
+    }
+}
+
+#ifdef ASCII_PARTICLE_AVX2
+
+void ParticleSystem::integrate_avx2(size_t begin, size_t end, const Emitter& emitter, float dt, float damping) {
+    const ParticleEmitter& desc = emitter.desc;
+    const glm::vec3 dv = desc.acceleration * dt;
+    const __m256 dvx = _mm256_set1_ps(dv.x), dvy = _mm256_set1_ps(dv.y), dvz = _mm256_set1_ps(dv.z);
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 keep = _mm256_set1_ps(damping);
+    const __m256 size_start = _mm256_set1_ps(desc.size_start);
+    const __m256 size_delta = _mm256_set1_ps(desc.size_end - desc.size_start);
+
+    // Same operation order as integrate_scalar
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 vx = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&m_vx[i]), dvx), keep);
+        const __m256 vy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&m_vy[i]), dvy), keep);
+        const __m256 vz = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&m_vz[i]), dvz), keep);
+        _mm256_storeu_ps(&m_vx[i], vx);
+        _mm256_storeu_ps(&m_vy[i], vy);
+        _mm256_storeu_ps(&m_vz[i], vz);
+        _mm256_storeu_ps(&m_px[i], _mm256_add_ps(_mm256_loadu_ps(&m_px[i]), _mm256_mul_ps(vx, step)));
+        _mm256_storeu_ps(&m_py[i], _mm256_add_ps(_mm256_loadu_ps(&m_py[i]), _mm256_mul_ps(vy, step)));
+        _mm256_storeu_ps(&m_pz[i], _mm256_add_ps(_mm256_loadu_ps(&m_pz[i]), _mm256_mul_ps(vz, step)));
+        const __m256 age = _mm256_add_ps(_mm256_loadu_ps(&m_age[i]),
+                                         _mm256_mul_ps(_mm256_loadu_ps(&m_inv_life[i]), step));
+        _mm256_storeu_ps(&m_age[i], age);
+        _mm256_storeu_ps(&m_size[i], _mm256_add_ps(size_start, _mm256_mul_ps(size_delta, age)));
+    }
+}
+
+#else
+
+void ParticleSystem::integrate_avx2(size_t begin, size_t end, const Emitter& emitter, float dt, float damping) {
+    integrate_scalar(begin, end, emitter, dt, damping);
+}
+
+#endif
+
+// Swap the last live particle into each expired one
+void ParticleSystem::retire(Emitter& emitter) {
+    size_t i = emitter.first;
+    size_t end = emitter.first + emitter.alive;
+    while (i < end) {
+        if (m_age[i] >= 1.0f) {
+            move_particle(--end, i);
+        } else {
+            i++;
+        }
+    }
+    emitter.alive = static_cast<uint32_t>(end - emitter.first);
+}
+
+void ParticleSystem::move_particle(size_t from, size_t to) {
+    m_px[to] = m_px[from];
+    m_py[to] = m_py[from];
+    m_pz[to] = m_pz[from];
+    m_vx[to] = m_vx[from];
+    m_vy[to] = m_vy[from];
+    m_vz[to] = m_vz[from];
+    m_age[to] = m_age[from];
+    m_inv_life[to] = m_inv_life[from];
+    m_size[to] = m_size[from];
+}
+
+void ParticleSystem::spawn(Emitter& emitter, uint32_t count) {
+    const ParticleEmitter& desc = emitter.desc;
+    count = std::min(count, desc.max_particles - emitter.alive);
+    const float life_min = std::max(desc.life_min, 1.0e-3f);
+    const float life_max = std::max(desc.life_max, life_min);
+    for (uint32_t k = 0; k < count; k++) {
+        const size_t i = emitter.first + emitter.alive++;
+        const glm::vec3 position = desc.position + desc.jitter * random_signed(emitter.rng);
+        const glm::vec3 velocity = desc.velocity + desc.spread * random_signed(emitter.rng);
+        m_px[i] = position.x;
+        m_py[i] = position.y;
+        m_pz[i] = position.z;
+        m_vx[i] = velocity.x;
+        m_vy[i] = velocity.y;
+        m_vz[i] = velocity.z;
+        m_age[i] = 0.0f;
+        m_inv_life[i] = 1.0f / (life_min + (life_max - life_min) * random_unit(emitter.rng));
+        m_size[i] = desc.size_start;
+    }
+}
+
+void ParticleSystem::allocate_slots() {
+    m_first_slot = static_cast<uint32_t>(m_instances.size());
+    m_instances.resize(m_first_slot + m_capacity);
+    for (uint32_t i = 0; i < m_capacity; i++) {
+        m_instances.set_blas(m_first_slot + i, m_cube_blas);
+        m_instances.set_mask(m_first_slot + i, 0);
+    }
+    m_allocated = true;
+}
+
+void ParticleSystem::hide_slots(uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; i++) {
+        m_instances.set_mask(m_first_slot + i, 0);
+    }
+}
+
+bool ParticleSystem::write_instances() {
+    m_dirty_first = 0;
+    m_dirty_count = 0;
+    if (!m_allocated) {
+        if (m_emitters.empty()) {
+            return false;
+        }
+        allocate_slots();
+        m_dirty_count = m_capacity;
+    }
+
+    uint32_t lo = m_capacity;
+    uint32_t hi = 0;
+    auto touch = [&](uint32_t first, uint32_t count) {
+        if (count > 0) {
+            lo = std::min(lo, first);
+            hi = std::max(hi, first + count);
+        }
+    };
+
+    // Hide given-up runs first; a new emitter may already own their slots
+    for (const Run& run : m_stale) {
+        hide_slots(run.first, run.count);
+        touch(run.first, run.count);
+    }
+    m_stale.clear();
+
+    for (Emitter& emitter : m_emitters) {
+        const uint32_t custom_index = MaterialTable::custom_index(emitter.desc.material);
+        for (uint32_t k = 0; k < emitter.alive; k++) {
+            const uint32_t i = emitter.first + k;
+            const uint32_t slot = m_first_slot + i;
+            m_instances.set_position(slot, {m_px[i], m_py[i], m_pz[i]});
+            m_instances.set_rotation(slot, NO_ROTATION);
+            m_instances.set_scale(slot, glm::vec3(std::max(m_size[i], 0.0f)));
+            m_instances.set_custom_index(slot, custom_index);
+            m_instances.set_mask(slot, 0xFF);
+        }
+        if (emitter.drawn > emitter.alive) {
+            hide_slots(emitter.first + emitter.alive, emitter.drawn - emitter.alive);
+        }
+        touch(emitter.first, std::max(emitter.alive, emitter.drawn));
+        emitter.drawn = emitter.alive;
+    }
+
+    if (m_dirty_count == 0 && lo < hi) {
+        m_dirty_first = m_first_slot + lo;
+        m_dirty_count = hi - lo;
+    } else if (m_dirty_count > 0) {
+        m_dirty_first = m_first_slot;
+    }
+    return m_dirty_count > 0;
+}
+
+size_t ParticleSystem::append_lights(std::vector<Light>& lights) const {
+    const bool terminated = !lights.empty() && lights.back().color.a == 0.0f;
+    if (terminated) {
+        lights.pop_back();
+    }
+    size_t added = 0;
+    for (const Emitter& emitter : m_emitters) {
+        const ParticleEmitter& desc = emitter.desc;
+        if (desc.light.a <= 0.0f || emitter.alive == 0) {
+            continue;
+        }
+        glm::vec3 centroid(0.0f);
+        for (uint32_t k = 0; k < emitter.alive; k++) {
+            const uint32_t i = emitter.first + k;
+            centroid += glm::vec3(m_px[i], m_py[i], m_pz[i]);
+        }
+        centroid /= static_cast<float>(emitter.alive);
+
+        const float steady = std::min(desc.rate * 0.5f * (desc.life_min + desc.life_max),
+                                      static_cast<float>(desc.max_particles));
+        const float fill = steady > 0.0f ? std::min(static_cast<float>(emitter.alive) / steady, 1.0f) : 1.0f;
+        Light light;
+        light.position = glm::vec4(centroid, desc.light_radius);
+        light.color = glm::vec4(glm::vec3(desc.light), desc.light.a * fill);
+        lights.push_back(light);
+        added++;
+    }
+    lights.push_back(Light{glm::vec4(0.0f), glm::vec4(0.0f)});
+    return added;
+}
+
+bool ParticleSystem::has_lights() const {
+    for (const Emitter& emitter : m_emitters) {
+        if (emitter.desc.light.a > 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace ascii
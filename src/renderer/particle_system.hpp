@@ -0,0 +1,143 @@
+#pragma once
+
+#include "instance_store.hpp"
+#include "rt_pipeline.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// What an emitter spawns, in world space (y up)
+struct ParticleEmitter {
+    glm::vec3 position{0.0f};
+    glm::vec3 jitter{0.0f};            // Spawn box half extents around position
+    float rate = 20.0f;                // Particles per second (0: bursts only)
+    float life_min = 0.5f;             // Seconds
+    float life_max = 1.0f;
+    glm::vec3 velocity{0.0f, 1.0f, 0.0f};
+    float spread = 0.5f;               // Random velocity added per axis, +-spread
+    glm::vec3 acceleration{0.0f};      // Gravity or buoyancy
+    float drag = 0.0f;                 // Share of the velocity lost per second
+    float size_start = 0.05f;          // Cube edge at birth, lerped to size_end at death
+    float size_end = 0.0f;
+    uint16_t material = 0;             // MaterialTable id
+    uint32_t max_particles = 64;       // Pool slots the emitter owns
+    glm::vec4 light{0.0f};             // rgb, a = power; power 0: no light
+    float light_radius = 4.0f;
+    bool active = true;                // False: stop spawning, live particles finish
+};
+
+// CPU particles drawn as TLAS instances. All emitters share one pool stored
+// as structure-of-arrays; each owns a fixed run of it (max_particles slots)
+// with its live particles packed at the front, so simulate() integrates
+// every emitter's run in one pass (8 at a time with AVX2, scalar fallback
+// otherwise) with the emitter's constants broadcast.
+//
+// The pool maps one-to-one onto a run of instance slots, appended to the
+// store on the first write_instances() and never moved afterwards; free and
+// dead slots are kept with mask 0. write_instances() rewrites only the
+// slots whose particles changed and reports them as one range, which the
+// caller hands to AccelerationStructureManager::refit_tlas() instead of
+// rebuilding the TLAS every frame.
+class ParticleSystem {
+public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 4096;
+    static constexpr uint32_t NO_EMITTER = 0xFFFFFFFFu;
+
+    ParticleSystem(InstanceStore& instances, uint32_t cube_blas, uint32_t capacity = DEFAULT_CAPACITY);
+
+    // Returns the emitter id, or NO_EMITTER when the pool has no run of
+    // max_particles free slots left
+    uint32_t add_emitter(const ParticleEmitter& emitter);
+
+    // Change an emitter; a new max_particles moves it to another run (live
+    // particles beyond the new size are dropped). False for unknown ids or
+    // when the pool can't fit the new size, leaving the emitter unchanged.
+    bool set_emitter(uint32_t id, const ParticleEmitter& emitter);
+    const ParticleEmitter* emitter(uint32_t id) const;
+    bool remove_emitter(uint32_t id);
+
+    // Spawn up to count particles now (inactive emitters too); returns how
+    // many fit
+    uint32_t burst(uint32_t id, uint32_t count);
+
+    // Drop all emitters and forget the slot range (call after clearing the
+    // instance store)
+    void reset();
+
+    // Age, move and retire particles, then spawn this frame's new ones.
+    // allow_simd = false forces the scalar path (for benchmarks).
+    void simulate(float dt, bool allow_simd = true);
+
+    // Write the slots that changed since the last call into the instance
+    // store. Returns false when none did; otherwise they lie in
+    // [dirty_first(), dirty_first() + dirty_count()).
+    bool write_instances();
+    uint32_t dirty_first() const { return m_dirty_first; }
+    uint32_t dirty_count() const { return m_dirty_count; }
+
+    // Add one light per lit emitter with live particles, at their centroid
+    // and dimmed while the emitter is below its steady-state count. Keeps
+    // the power = 0 terminator at the end of lights. Returns the number added.
+    size_t append_lights(std::vector<Light>& lights) const;
+    bool has_lights() const;
+
+    size_t emitter_count() const { return m_emitters.size(); }
+    size_t live_count() const;
+    uint32_t capacity() const { return m_capacity; }
+
+    // True when the AVX2 kernel was compiled in
+    static bool simd_available();
+
+private:
+    struct Emitter {
+        uint32_t id;
+        ParticleEmitter desc;
+        uint32_t first;                // Pool index of the emitter's run
+        uint32_t alive = 0;            // Live particles, packed at the front of the run
+        uint32_t drawn = 0;            // Slots shown by the last write_instances()
+        float accumulator = 0.0f;      // Fractional particles owed to the next frame
+        uint32_t rng;                  // xorshift32 state
+    };
+
+    struct Run {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    size_t find(uint32_t id) const;
+    bool allocate_run(uint32_t size, uint32_t ignore_id, uint32_t& first) const;
+    void allocate_slots();
+    void spawn(Emitter& emitter, uint32_t count);
+    void integrate_scalar(size_t begin, size_t end, const Emitter& emitter, float dt, float damping);
+    void integrate_avx2(size_t begin, size_t end, const Emitter& emitter, float dt, float damping);
+    void retire(Emitter& emitter);
+    void move_particle(size_t from, size_t to);
+    void hide_slots(uint32_t first, uint32_t count);
+
+    InstanceStore& m_instances;
+    uint32_t m_cube_blas;
+    uint32_t m_capacity;
+
+    bool m_allocated = false;
+    uint32_t m_first_slot = 0;                 // Instance index of pool index 0
+    uint32_t m_next_id = 0;
+    std::vector<Emitter> m_emitters;           // Sorted by id
+
+    // Particle pool (SoA); age is normalized to [0, 1) over the lifetime
+    std::vector<float> m_px, m_py, m_pz;
+    std::vector<float> m_vx, m_vy, m_vz;
+    std::vector<float> m_age;
+    std::vector<float> m_inv_life;             // 1 / lifetime in seconds
+    std::vector<float> m_size;
+
+    // Runs given up by removed or moved emitters, hidden on the next write
+    std::vector<Run> m_stale;
+    uint32_t m_dirty_first = 0;
+    uint32_t m_dirty_count = 0;
+};
+
+} // namespace ascii
@@ -30,6 +30,7 @@ RTPipeline::RTPipeline(VulkanContext& ctx, AccelerationStructureManager& accel)
     props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
     props2.pNext = &m_rt_properties;
     vkGetPhysicalDeviceProperties2(ctx.physical_device(), &props2);
+    m_timestamp_period = props2.properties.limits.timestampPeriod;
 
     spdlog::info("RT shader group handle size: {}", m_rt_properties.shaderGroupHandleSize);
     spdlog::info("RT shader group base alignment: {}", m_rt_properties.shaderGroupBaseAlignment);
@@ -40,9 +41,10 @@ RTPipeline::RTPipeline(VulkanContext& ctx, AccelerationStructureManager& accel)
     create_pipeline();
     create_shader_binding_table();
     create_descriptor_pool();
-    create_instance_buffer();
+    create_material_buffer();
     create_light_buffer();
     create_descriptor_sets();
+    create_timestamp_pool();
 
     spdlog::info("RT pipeline initialized");
 }
@@ -57,6 +59,10 @@ RTPipeline::~RTPipeline() {
         vmaDestroyImage(m_ctx.allocator(), m_storage_image, m_storage_image_allocation);
     }
 
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_ctx.device(), m_timestamp_pool, nullptr);
+    }
+
     vkDestroyDescriptorPool(m_ctx.device(), m_descriptor_pool, nullptr);
     vkDestroyPipeline(m_ctx.device(), m_pipeline, nullptr);
     vkDestroyPipelineLayout(m_ctx.device(), m_pipeline_layout, nullptr);
@@ -117,10 +123,14 @@ void RTPipeline::create_descriptor_set_layout() {
         {0, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
         // Binding 1: Output image
         {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
-        // Binding 2: Instance data
+        // Binding 2: Material table
         {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
         // Binding 3: Lights
         {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
+        // Binding 4: Mesh primitives (per-triangle normal/material)
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
+        // Binding 5: Instance geometry (per-instance primitive base)
+        {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
     };
 
     VkDescriptorSetLayoutCreateInfo layout_info{};
@@ -313,17 +323,18 @@ void RTPipeline::create_shader_binding_table() {
 }
 
 void RTPipeline::create_descriptor_pool() {
+    const uint32_t sets = VulkanContext::MAX_FRAMES_IN_FLIGHT;
     std::vector<VkDescriptorPoolSize> pool_sizes = {
-        {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+        {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, sets},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, sets},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * sets},
     };
 
     VkDescriptorPoolCreateInfo pool_info{};
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
     pool_info.pPoolSizes = pool_sizes.data();
-    pool_info.maxSets = 1;
+    pool_info.maxSets = sets;
     pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
 
     if (vkCreateDescriptorPool(m_ctx.device(), &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS) {
@@ -331,11 +342,11 @@ void RTPipeline::create_descriptor_pool() {
     }
 }
 
-void RTPipeline::create_instance_buffer() {
+void RTPipeline::create_material_buffer() {
     // Create with initial capacity
-    const uint32_t initial_capacity = 1024;
-    m_instance_buffer = Buffer(m_ctx, initial_capacity * sizeof(GlyphInstance),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    const uint32_t initial_capacity = 256;
+    m_material_buffer = Buffer(m_ctx, initial_capacity * sizeof(Material),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VMA_MEMORY_USAGE_CPU_TO_GPU);
 }
 
@@ -347,14 +358,33 @@ void RTPipeline::create_light_buffer() {
         VMA_MEMORY_USAGE_CPU_TO_GPU);
 }
 
+void RTPipeline::create_timestamp_pool() {
+    if (m_timestamp_period <= 0.0f) {
+        spdlog::warn("Device does not support timestamps, trace timing disabled");
+        return;
+    }
+
+    VkQueryPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = 2 * VulkanContext::MAX_FRAMES_IN_FLIGHT;
+
+    if (vkCreateQueryPool(m_ctx.device(), &pool_info, nullptr, &m_timestamp_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+    m_timestamps_written.assign(VulkanContext::MAX_FRAMES_IN_FLIGHT, false);
+}
+
 void RTPipeline::create_descriptor_sets() {
     VkDescriptorSetAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     alloc_info.descriptorPool = m_descriptor_pool;
-    alloc_info.descriptorSetCount = 1;
-    alloc_info.pSetLayouts = &m_descriptor_set_layout;
+    std::vector<VkDescriptorSetLayout> layouts(VulkanContext::MAX_FRAMES_IN_FLIGHT, m_descriptor_set_layout);
+    alloc_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    alloc_info.pSetLayouts = layouts.data();
 
-    if (vkAllocateDescriptorSets(m_ctx.device(), &alloc_info, &m_descriptor_set) != VK_SUCCESS) {
+    m_descriptor_sets.resize(layouts.size());
+    if (vkAllocateDescriptorSets(m_ctx.device(), &alloc_info, m_descriptor_sets.data()) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate descriptor sets");
     }
 
@@ -366,10 +396,10 @@ void RTPipeline::create_descriptor_sets() {
     accel_write.pAccelerationStructures = &tlas;
 
     // Write instance buffer
-    VkDescriptorBufferInfo instance_info{};
-    instance_info.buffer = m_instance_buffer.handle();
-    instance_info.offset = 0;
-    instance_info.range = VK_WHOLE_SIZE;
+    VkDescriptorBufferInfo material_info{};
+    material_info.buffer = m_material_buffer.handle();
+    material_info.offset = 0;
+    material_info.range = VK_WHOLE_SIZE;
 
     // Write light buffer
     VkDescriptorBufferInfo light_info{};
@@ -377,33 +407,73 @@ void RTPipeline::create_descriptor_sets() {
     light_info.offset = 0;
     light_info.range = VK_WHOLE_SIZE;
 
-    std::vector<VkWriteDescriptorSet> writes(3);
-
-    // Binding 0: TLAS
-    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[0].dstSet = m_descriptor_set;
-    writes[0].dstBinding = 0;
-    writes[0].descriptorCount = 1;
-    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-    writes[0].pNext = &accel_write;
-
-    // Binding 2: Instances
-    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[1].dstSet = m_descriptor_set;
-    writes[1].dstBinding = 2;
-    writes[1].descriptorCount = 1;
-    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    writes[1].pBufferInfo = &instance_info;
-
-    // Binding 3: Lights
-    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[2].dstSet = m_descriptor_set;
-    writes[2].dstBinding = 3;
-    writes[2].descriptorCount = 1;
-    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    writes[2].pBufferInfo = &light_info;
-
-    vkUpdateDescriptorSets(m_ctx.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    for (VkDescriptorSet set : m_descriptor_sets) {
+        std::vector<VkWriteDescriptorSet> writes(3);
+
+        // Binding 0: TLAS
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = set;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        writes[0].pNext = &accel_write;
+
+        // Binding 2: Instances
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = set;
+        writes[1].dstBinding = 2;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[1].pBufferInfo = &material_info;
+
+        // Binding 3: Lights
+        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].dstSet = set;
+        writes[2].dstBinding = 3;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[2].pBufferInfo = &light_info;
+
+        vkUpdateDescriptorSets(m_ctx.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    update_geometry_descriptors();
+}
+
+void RTPipeline::update_geometry_descriptors() {
+    // Both buffers are owned by the acceleration structure manager and may be
+    // recreated whenever a BLAS is added or the TLAS is rebuilt
+    VkDescriptorBufferInfo primitive_info{};
+    primitive_info.buffer = m_accel.primitive_buffer().handle();
+    primitive_info.offset = 0;
+    primitive_info.range = VK_WHOLE_SIZE;
+
+    for (uint32_t frame = 0; frame < m_descriptor_sets.size(); frame++) {
+        VkDescriptorBufferInfo geometry_info{};
+        geometry_info.buffer = m_accel.geometry_buffer(frame).handle();
+        geometry_info.offset = 0;
+        geometry_info.range = VK_WHOLE_SIZE;
+
+        std::vector<VkWriteDescriptorSet> writes(2);
+
+        // Binding 4: Mesh primitives
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = m_descriptor_sets[frame];
+        writes[0].dstBinding = 4;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[0].pBufferInfo = &primitive_info;
+
+        // Binding 5: Instance geometry, this frame's copy
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = m_descriptor_sets[frame];
+        writes[1].dstBinding = 5;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[1].pBufferInfo = &geometry_info;
+
+        vkUpdateDescriptorSets(m_ctx.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
 }
 
 void RTPipeline::update_tlas_descriptor() {
@@ -413,15 +483,18 @@ void RTPipeline::update_tlas_descriptor() {
     VkAccelerationStructureKHR tlas = m_accel.tlas_handle();
     accel_write.pAccelerationStructures = &tlas;
 
-    VkWriteDescriptorSet write{};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.dstSet = m_descriptor_set;
-    write.dstBinding = 0;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-    write.pNext = &accel_write;
+    for (VkDescriptorSet set : m_descriptor_sets) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        write.pNext = &accel_write;
 
-    vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+        vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+    }
+    update_geometry_descriptors();
     spdlog::debug("Updated TLAS descriptor");
 }
 
@@ -489,48 +562,89 @@ void RTPipeline::resize_storage_image(uint32_t width, uint32_t height) {
     desc_image_info.imageView = m_storage_image_view;
     desc_image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-    VkWriteDescriptorSet write{};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.dstSet = m_descriptor_set;
-    write.dstBinding = 1;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    write.pImageInfo = &desc_image_info;
+    for (VkDescriptorSet set : m_descriptor_sets) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 1;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.pImageInfo = &desc_image_info;
 
-    vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+        vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+    }
 
     spdlog::info("Created storage image: {}x{}", width, height);
 }
 
-void RTPipeline::set_instances(const std::vector<GlyphInstance>& instances) {
-    if (instances.empty()) return;
+void RTPipeline::set_materials(const std::vector<Material>& materials) {
+    if (materials.empty()) return;
 
-    VkDeviceSize required_size = instances.size() * sizeof(GlyphInstance);
-    if (required_size > m_instance_buffer.size()) {
+    VkDeviceSize required_size = materials.size() * sizeof(Material);
+    if (required_size > m_material_buffer.size()) {
         // Recreate buffer with larger size
-        m_instance_buffer = Buffer(m_ctx, required_size * 2,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        m_material_buffer = Buffer(m_ctx, required_size * 2,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VMA_MEMORY_USAGE_CPU_TO_GPU);
 
         // Update descriptor
         VkDescriptorBufferInfo info{};
-        info.buffer = m_instance_buffer.handle();
+        info.buffer = m_material_buffer.handle();
         info.offset = 0;
         info.range = VK_WHOLE_SIZE;
 
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = m_descriptor_set;
-        write.dstBinding = 2;
-        write.descriptorCount = 1;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write.pBufferInfo = &info;
+        for (VkDescriptorSet set : m_descriptor_sets) {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = set;
+            write.dstBinding = 2;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &info;
+
+            vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+        }
+    }
 
-        vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+    m_material_buffer.upload(materials.data(), required_size);
+    m_material_count = static_cast<uint32_t>(materials.size());
+    m_material_edits.clear();  // The table already has them
+}
+
+void RTPipeline::update_material(uint16_t id, const Material& material) {
+    if (id >= m_material_count) {
+        throw std::runtime_error("Material id out of range");
+    }
+    m_material_edits.emplace_back(id, material);
+}
+
+void RTPipeline::record_material_updates(VkCommandBuffer cmd) {
+    if (m_material_edits.empty()) {
+        return;
     }
 
-    m_instance_buffer.upload(instances.data(), required_size);
-    m_instance_count = static_cast<uint32_t>(instances.size());
+    // Earlier frames' traces are done reading the table before it changes
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    // In queue order, so the last edit of an id wins
+    for (const auto& [id, material] : m_material_edits) {
+        vkCmdUpdateBuffer(cmd, m_material_buffer.handle(), id * sizeof(Material), sizeof(Material), &material);
+    }
+    m_material_edits.clear();
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
 }
 
 void RTPipeline::set_lights(const std::vector<Light>& lights) {
@@ -549,15 +663,17 @@ void RTPipeline::set_lights(const std::vector<Light>& lights) {
         info.offset = 0;
         info.range = VK_WHOLE_SIZE;
 
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = m_descriptor_set;
-        write.dstBinding = 3;
-        write.descriptorCount = 1;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write.pBufferInfo = &info;
-
-        vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+        for (VkDescriptorSet set : m_descriptor_sets) {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = set;
+            write.dstBinding = 3;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &info;
+
+            vkUpdateDescriptorSets(m_ctx.device(), 1, &write, 0, nullptr);
+        }
     }
 
     m_light_buffer.upload(lights.data(), required_size);
@@ -568,19 +684,36 @@ void RTPipeline::trace_rays(VkCommandBuffer cmd, uint32_t width, uint32_t height
                             const CameraPushConstants& camera) {
     // Ensure storage image is the right size
     resize_storage_image(width, height);
+    record_material_updates(cmd);
 
     // Bind pipeline
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipeline);
 
-    // Bind descriptor set
+    // Bind this frame's descriptor set
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
-                            m_pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+                            m_pipeline_layout, 0, 1, &m_descriptor_sets[m_ctx.current_frame()], 0, nullptr);
 
     // Push constants
     vkCmdPushConstants(cmd, m_pipeline_layout,
                        VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR,
                        0, sizeof(CameraPushConstants), &camera);
 
+    // Read back the timing of the last trace recorded into this frame slot.
+    // Its fence has already been waited on in begin_frame(), so no stall here.
+    const uint32_t first_query = m_ctx.current_frame() * 2;
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        if (m_timestamps_written[m_ctx.current_frame()]) {
+            uint64_t ticks[2] = {};
+            if (vkGetQueryPoolResults(m_ctx.device(), m_timestamp_pool, first_query, 2,
+                                      sizeof(ticks), ticks, sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+                m_last_trace_ms = static_cast<float>(ticks[1] - ticks[0]) * m_timestamp_period / 1.0e6f;
+            }
+        }
+        vkCmdResetQueryPool(cmd, m_timestamp_pool, first_query, 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pool, first_query);
+    }
+
     // Trace rays
     vkCmdTraceRaysKHR(cmd,
         &m_raygen_region,
@@ -588,6 +721,11 @@ void RTPipeline::trace_rays(VkCommandBuffer cmd, uint32_t width, uint32_t height
         &m_hit_region,
         &m_callable_region,
         width, height, 1);
+
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, m_timestamp_pool, first_query + 1);
+        m_timestamps_written[m_ctx.current_frame()] = true;
+    }
 }
 
 std::vector<uint8_t> RTPipeline::capture_screenshot() {
@@ -2,6 +2,7 @@
 
 #include "buffer.hpp"
 #include "acceleration.hpp"
+#include "material_table.hpp"
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
@@ -9,6 +10,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <utility>
 
 namespace ascii {
 
@@ -21,12 +23,6 @@ struct CameraPushConstants {
     glm::vec4 camera_pos;  // xyz = position, w = time
 };
 
-// Instance data stored in SSBO
-struct GlyphInstance {
-    glm::vec4 color;           // rgb = color, a = roughness
-    glm::vec4 emission;        // rgb = emission, a = power
-};
-
 // Light data
 struct Light {
     glm::vec4 position;        // xyz = pos, w = radius
@@ -38,17 +34,26 @@ public:
     RTPipeline(VulkanContext& ctx, AccelerationStructureManager& accel);
     ~RTPipeline();
 
-    // Update instance data
-    void set_instances(const std::vector<GlyphInstance>& instances);
+    // Upload the whole material table (no frame may be in flight)
+    void set_materials(const std::vector<Material>& materials);
+
+    // Queue a single edited material (id must already be uploaded). The
+    // next trace_rays() records it into its command buffer, so frames in
+    // flight keep reading the old entry and nothing waits for them.
+    void update_material(uint16_t id, const Material& material);
+    uint32_t material_count() const { return m_material_count; }
 
     // Update lights
     void set_lights(const std::vector<Light>& lights);
 
-    // Record raytracing commands (uses internal storage image)
+    // Record raytracing commands (uses internal storage image), after any
+    // queued material edits
     void trace_rays(VkCommandBuffer cmd, uint32_t width, uint32_t height,
                     const CameraPushConstants& camera);
 
     // Update TLAS descriptor after rebuilding acceleration structure
+    // (also rebinds the mesh primitive / instance geometry buffers). Only
+    // while no frame is in flight, like the other descriptor writes.
     void update_tlas_descriptor();
 
     // Recreate storage image if size changed
@@ -61,6 +66,9 @@ public:
     // Capture screenshot (returns RGBA pixels)
     std::vector<uint8_t> capture_screenshot();
 
+    // GPU time of the last completed trace_rays() call, from timestamp queries
+    float last_trace_ms() const { return m_last_trace_ms; }
+
 private:
     void load_shaders();
     void create_descriptor_set_layout();
@@ -69,9 +77,12 @@ private:
     void create_shader_binding_table();
     void create_descriptor_pool();
     void create_descriptor_sets();
+    void update_geometry_descriptors();
     void create_storage_image();
-    void create_instance_buffer();
+    void create_material_buffer();
     void create_light_buffer();
+    void create_timestamp_pool();
+    void record_material_updates(VkCommandBuffer cmd);
 
     std::vector<char> read_shader_file(const std::string& filename);
     VkShaderModule create_shader_module(const std::vector<char>& code);
@@ -83,8 +94,10 @@ private:
     VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
     VkPipeline m_pipeline = VK_NULL_HANDLE;
 
+    // One set per frame in flight, differing only in the instance geometry
+    // buffer (see TLASFrame)
     VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
-    VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_descriptor_sets;
 
     // Shader modules
     VkShaderModule m_raygen_shader = VK_NULL_HANDLE;
@@ -107,9 +120,10 @@ private:
     uint32_t m_storage_width = 0;
     uint32_t m_storage_height = 0;
 
-    // Instance data buffer
-    Buffer m_instance_buffer;
-    uint32_t m_instance_count = 0;
+    // Material table buffer
+    Buffer m_material_buffer;
+    uint32_t m_material_count = 0;
+    std::vector<std::pair<uint16_t, Material>> m_material_edits;  // Queued by update_material
 
     // Light buffer
     Buffer m_light_buffer;
@@ -118,6 +132,12 @@ private:
     // RT properties
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR m_rt_properties{};
 
+    // GPU timing (two timestamps per frame in flight)
+    VkQueryPool m_timestamp_pool = VK_NULL_HANDLE;
+    float m_timestamp_period = 0.0f;  // Nanoseconds per tick
+    std::vector<bool> m_timestamps_written;
+    float m_last_trace_ms = 0.0f;
+
     // Function pointers
     PFN_vkCreateRayTracingPipelinesKHR vkCreateRayTracingPipelinesKHR = nullptr;
     PFN_vkGetRayTracingShaderGroupHandlesKHR vkGetRayTracingShaderGroupHandlesKHR = nullptr;
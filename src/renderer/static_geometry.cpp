@@ -0,0 +1,175 @@
+#include "static_geometry.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace ascii {
+
+void StaticTileGrid::resize(int w, int d, std::vector<float> heights) {
+    width = w;
+    depth = d;
+    layer_heights = std::move(heights);
+    cells.assign(static_cast<size_t>(width) * depth * layer_heights.size(), EMPTY);
+}
+
+StaticMesh compile_static_geometry(const StaticTileGrid& grid, StaticMeshStats* stats) {
+    if (grid.cells.size() != static_cast<size_t>(grid.width) * grid.depth * grid.layers()) {
+        throw std::runtime_error("Static tile grid size does not match its dimensions");
+    }
+
+    StaticMesh mesh;
+    StaticMeshStats local_stats;
+
+    // Axis order is (x, layer, z); cell coordinates are indexed the same way
+    const std::array<int, 3> dims = {grid.width, grid.layers(), grid.depth};
+
+    // Cell boundary positions along each axis (dims + 1 entries)
+    std::array<std::vector<float>, 3> edges;
+    for (int i = 0; i <= grid.width; i++) {
+        edges[0].push_back(grid.origin.x + static_cast<float>(i) * grid.cell_size.x);
+    }
+    float y = grid.origin.y;
+    edges[1].push_back(y);
+    for (float h : grid.layer_heights) {
+        y += h;
+        edges[1].push_back(y);
+    }
+    for (int i = 0; i <= grid.depth; i++) {
+        edges[2].push_back(grid.origin.z + static_cast<float>(i) * grid.cell_size.y);
+    }
+
+    auto cell_at = [&](const std::array<int, 3>& c) {
+        return grid.get(c[0], c[1], c[2]);
+    };
+
+    for (const auto& material : grid.cells) {
+        if (material != StaticTileGrid::EMPTY) {
+            local_stats.solid_tiles++;
+        }
+    }
+
+    std::vector<uint32_t> mask;
+
+    for (int d = 0; d < 3; d++) {
+        // u x v == d for the cyclic axis order, which keeps the winding consistent
+        const int u = (d + 1) % 3;
+        const int v = (d + 2) % 3;
+        mask.resize(static_cast<size_t>(dims[u]) * dims[v]);
+
+        for (int sign = -1; sign <= 1; sign += 2) {
+            glm::vec3 normal(0.0f);
+            normal[d] = static_cast<float>(sign);
+
+            for (int slice = 0; slice < dims[d]; slice++) {
+                // Build the face mask for this slice: a face is visible when its
+                // tile is solid and the neighbour on the facing side is empty
+                uint32_t visible = 0;
+                std::array<int, 3> c{};
+                c[d] = slice;
+                for (int j = 0; j < dims[v]; j++) {
+                    c[v] = j;
+                    for (int i = 0; i < dims[u]; i++) {
+                        c[u] = i;
+                        uint32_t material = cell_at(c);
+                        if (material != StaticTileGrid::EMPTY) {
+                            std::array<int, 3> n = c;
+                            n[d] += sign;
+                            if (cell_at(n) != StaticTileGrid::EMPTY) {
+                                material = StaticTileGrid::EMPTY;
+                            }
+                        }
+                        mask[static_cast<size_t>(j) * dims[u] + i] = material;
+                        visible += material != StaticTileGrid::EMPTY ? 1 : 0;
+                    }
+                }
+                local_stats.visible_faces += visible;
+                if (visible == 0) {
+                    continue;
+                }
+
+                const float plane = sign > 0 ? edges[d][slice + 1] : edges[d][slice];
+
+                // Greedy merge: grow each quad along u, then along v while the
+                // whole row matches
+                for (int j = 0; j < dims[v]; j++) {
+                    for (int i = 0; i < dims[u];) {
+                        const uint32_t material = mask[static_cast<size_t>(j) * dims[u] + i];
+                        if (material == StaticTileGrid::EMPTY) {
+                            i++;
+                            continue;
+                        }
+
+                        int w = 1;
+                        while (i + w < dims[u] && mask[static_cast<size_t>(j) * dims[u] + i + w] == material) {
+                            w++;
+                        }
+
+                        int h = 1;
+                        for (; j + h < dims[v]; h++) {
+                            bool row_matches = true;
+                            for (int k = 0; k < w; k++) {
+                                if (mask[static_cast<size_t>(j + h) * dims[u] + i + k] != material) {
+                                    row_matches = false;
+                                    break;
+                                }
+                            }
+                            if (!row_matches) {
+                                break;
+                            }
+                        }
+
+                        for (int row = 0; row < h; row++) {
+                            for (int k = 0; k < w; k++) {
+                                mask[static_cast<size_t>(j + row) * dims[u] + i + k] = StaticTileGrid::EMPTY;
+                            }
+                        }
+
+                        // Emit the quad
+                        const float u0 = edges[u][i];
+                        const float u1 = edges[u][i + w];
+                        const float v0 = edges[v][j];
+                        const float v1 = edges[v][j + h];
+
+                        auto corner = [&](float cu, float cv) {
+                            glm::vec3 p(0.0f);
+                            p[d] = plane;
+                            p[u] = cu;
+                            p[v] = cv;
+                            return p;
+                        };
+
+                        const uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+                        mesh.vertices.push_back(corner(u0, v0));
+                        mesh.vertices.push_back(corner(u1, v0));
+                        mesh.vertices.push_back(corner(u1, v1));
+                        mesh.vertices.push_back(corner(u0, v1));
+
+                        if (sign > 0) {
+                            mesh.indices.insert(mesh.indices.end(), {base + 0, base + 1, base + 2, base + 2, base + 3, base + 0});
+                        } else {
+                            mesh.indices.insert(mesh.indices.end(), {base + 0, base + 3, base + 2, base + 2, base + 1, base + 0});
+                        }
+
+                        MeshPrimitive primitive;
+                        primitive.normal = normal;
+                        primitive.material = material;
+                        mesh.primitives.push_back(primitive);
+                        mesh.primitives.push_back(primitive);
+
+                        local_stats.merged_quads++;
+                        i += w;
+                    }
+                }
+            }
+        }
+    }
+
+    local_stats.naive_triangles = local_stats.solid_tiles * 12;
+    local_stats.merged_triangles = mesh.triangle_count();
+    if (stats) {
+        *stats = local_stats;
+    }
+    return mesh;
+}
+
+} // namespace ascii
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "acceleration.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// Grid of solid tiles to be baked into a single static mesh.
+// X/Z cells share one size; each Y layer has its own thickness so a thin
+// floor and tall walls can live in the same grid.
+struct StaticTileGrid {
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    int width = 0;                      // Cells along X
+    int depth = 0;                      // Cells along Z
+    glm::vec3 origin{0.0f};             // Min corner of cell (0, 0, 0)
+    glm::vec2 cell_size{1.0f, 1.0f};    // X/Z size of a cell
+    std::vector<float> layer_heights;   // Y thickness of each layer, bottom-up
+    std::vector<uint32_t> cells;        // Material per cell, EMPTY = no tile
+
+    void resize(int w, int d, std::vector<float> heights);
+
+    int layers() const { return static_cast<int>(layer_heights.size()); }
+
+    bool in_bounds(int x, int layer, int z) const {
+        return x >= 0 && x < width && z >= 0 && z < depth && layer >= 0 && layer < layers();
+    }
+
+    uint32_t get(int x, int layer, int z) const {
+        return in_bounds(x, layer, z) ? cells[index(x, layer, z)] : EMPTY;
+    }
+
+    void set(int x, int layer, int z, uint32_t material) {
+        if (in_bounds(x, layer, z)) {
+            cells[index(x, layer, z)] = material;
+        }
+    }
+
+    size_t index(int x, int layer, int z) const {
+        return (static_cast<size_t>(layer) * depth + z) * width + x;
+    }
+};
+
+// Output of the static geometry compiler, ready for create_blas()
+struct StaticMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<MeshPrimitive> primitives;  // One per triangle
+
+    uint32_t triangle_count() const { return static_cast<uint32_t>(indices.size() / 3); }
+};
+
+struct StaticMeshStats {
+    uint32_t solid_tiles = 0;
+    uint32_t naive_triangles = 0;     // 12 per tile, as separate cube instances
+    uint32_t visible_faces = 0;       // Tile faces left after hidden-face removal
+    uint32_t merged_quads = 0;        // Quads after greedy merging
+    uint32_t merged_triangles = 0;
+};
+
+// Bake a tile grid into merged geometry:
+//  - faces between two solid tiles are dropped (no one can see them)
+//  - remaining coplanar faces with the same material are greedily merged
+//    into large quads, each tagged with its material index
+// Vertices are in world space, so the mesh is instanced with an identity transform.
+StaticMesh compile_static_geometry(const StaticTileGrid& grid, StaticMeshStats* stats = nullptr);
+
+} // namespace ascii
@@ -0,0 +1,266 @@
+#include "edit_history.hpp"
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+namespace ascii {
+
+namespace {
+
+double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+size_t EditHistory::Entry::bytes() const {
+    size_t total = sizeof(Entry) + label.capacity() + tiles.capacity() * sizeof(TileRun);
+    for (const EntityImage& image : images) {
+        total += sizeof(EntityImage) + image.bytes();
+    }
+    return total;
+}
+
+EditHistory::Entry* EditHistory::merge_target(Kind kind, uint64_t target, double now) {
+    if (m_sealed || m_undo.empty()) {
+        return nullptr;
+    }
+    Entry& last = m_undo.back();
+    if (!last.mergeable || last.kind != kind || last.target != target || now - last.time > MERGE_SECONDS) {
+        return nullptr;
+    }
+    return &last;
+}
+
+void EditHistory::push(Entry entry) {
+    for (const Entry& undone : m_redo) {
+        m_bytes -= undone.bytes();
+    }
+    m_redo.clear();
+    m_bytes += entry.bytes();
+    m_undo.push_back(std::move(entry));
+    m_sealed = false;
+    trim();
+}
+
+void EditHistory::trim() {
+    // The oldest edits become part of the baseline that can't be undone
+    while (m_undo.size() > 1 && (m_undo.size() > MAX_ENTRIES || m_bytes > MAX_BYTES)) {
+        m_bytes -= m_undo.front().bytes();
+        m_undo.pop_front();
+    }
+}
+
+void EditHistory::record_transform(Entity entity, const LocalTransform& before, const LocalTransform& after) {
+    const double now = now_seconds();
+    if (Entry* last = merge_target(Kind::Transform, entity.bits(), now)) {
+        last->transform_after = after;
+        last->time = now;
+        return;
+    }
+    Entry entry;
+    entry.kind = Kind::Transform;
+    entry.label = "entity.set";
+    entry.time = now;
+    entry.target = entity.bits();
+    entry.mergeable = true;
+    entry.transform_before = before;
+    entry.transform_after = after;
+    push(std::move(entry));
+}
+
+void EditHistory::record_material(uint16_t id, const Material& before, const Material& after) {
+    const double now = now_seconds();
+    if (Entry* last = merge_target(Kind::Material, id, now)) {
+        last->material_after = after;
+        last->time = now;
+        return;
+    }
+    Entry entry;
+    entry.kind = Kind::Material;
+    entry.label = "material.set";
+    entry.time = now;
+    entry.target = id;
+    entry.mergeable = true;
+    entry.material_before = before;
+    entry.material_after = after;
+    push(std::move(entry));
+}
+
+void EditHistory::record_tiles(const std::string& label, const std::vector<TileChange>& changes, bool stroke) {
+    if (changes.empty()) {
+        return;
+    }
+    const double now = now_seconds();
+    Entry* entry = stroke ? merge_target(Kind::Tiles, 0, now) : nullptr;
+    Entry fresh;
+    if (!entry) {
+        fresh.kind = Kind::Tiles;
+        fresh.label = label;
+        fresh.mergeable = stroke;
+        entry = &fresh;
+    } else {
+        m_bytes -= entry->bytes();
+    }
+    entry->time = now;
+
+    // Edits visit tiles row by row, so runs capture fills in one run per row
+    for (const TileChange& change : changes) {
+        if (!entry->tiles.empty()) {
+            TileRun& run = entry->tiles.back();
+            if (run.layer == change.layer && run.y == change.y && run.x + run.count == change.x &&
+                run.before == change.before && run.after == change.after) {
+                run.count++;
+                continue;
+            }
+        }
+        entry->tiles.push_back({change.layer, change.x, change.y, 1, change.before, change.after});
+    }
+
+    if (entry == &fresh) {
+        push(std::move(fresh));
+    } else {
+        m_bytes += entry->bytes();
+        trim();
+    }
+}
+
+void EditHistory::record_destroy(Entity root) {
+    if (!m_world.alive(root)) {
+        return;
+    }
+    // Same traversal as destroy_scene_entity, parents before children
+    std::vector<Entity> subtree{root};
+    std::unordered_set<Entity, HandleHash> level{root};
+    while (!level.empty()) {
+        std::unordered_set<Entity, HandleHash> next;
+        m_world.each<const Parent>([&](Entity entity, const Parent& parent) {
+            if (level.count(parent.entity)) {
+                next.insert(entity);
+                subtree.push_back(entity);
+            }
+        });
+        level.swap(next);
+    }
+
+    Entry entry;
+    entry.kind = Kind::Destroy;
+    entry.label = "entity.destroy";
+    entry.time = now_seconds();
+    entry.target = root.bits();
+    entry.images.reserve(subtree.size());
+    for (Entity entity : subtree) {
+        entry.images.push_back(m_world.capture(entity));
+    }
+    push(std::move(entry));
+}
+
+Entity EditHistory::resolve(Entity entity) const {
+    for (auto it = m_alias.find(entity); it != m_alias.end(); it = m_alias.find(entity)) {
+        entity = it->second;
+    }
+    return entity;
+}
+
+void EditHistory::apply(Entry& entry, bool forward, Applied& applied) {
+    applied.label = entry.label;
+    switch (entry.kind) {
+        case Kind::Transform: {
+            const Entity entity = resolve(Handle::from_bits(entry.target));
+            if (LocalTransform* local = m_world.get<LocalTransform>(entity)) {
+                *local = forward ? entry.transform_after : entry.transform_before;
+                m_transforms.mark_dirty(m_world, entity);
+            }
+            break;
+        }
+        case Kind::Material: {
+            const uint16_t id = static_cast<uint16_t>(entry.target);
+            if (m_materials.contains(id)) {
+                m_materials.set(id, forward ? entry.material_after : entry.material_before);
+                applied.materials.push_back(id);
+            }
+            break;
+        }
+        case Kind::Tiles: {
+            // Backwards on undo, so a tile painted twice ends at its first "before"
+            auto fill = [&](const TileRun& run, const Tile& tile) {
+                m_tilemap.fill_rect(run.layer, run.x, run.y, run.count, 1, tile);
+            };
+            if (forward) {
+                for (const TileRun& run : entry.tiles) {
+                    fill(run, run.after);
+                }
+            } else {
+                for (auto it = entry.tiles.rbegin(); it != entry.tiles.rend(); ++it) {
+                    fill(*it, it->before);
+                }
+            }
+            break;
+        }
+        case Kind::Destroy: {
+            if (forward) {
+                destroy_scene_entity(m_world, m_index, resolve(entry.images.front().entity()));
+                break;
+            }
+            // Re-create parents first; the copies still name the old handles
+            for (const EntityImage& image : entry.images) {
+                const Entity created = m_world.create(image);
+                m_alias[resolve(image.entity())] = created;
+            }
+            for (const EntityImage& image : entry.images) {
+                const Entity entity = resolve(image.entity());
+                if (Parent* parent = m_world.get<Parent>(entity)) {
+                    parent->entity = resolve(parent->entity);
+                }
+                if (const SceneNode* node = m_world.get<const SceneNode>(entity); node && node->id != NO_STRING) {
+                    m_index.bind(node->id, entity);
+                }
+            }
+            break;
+        }
+    }
+}
+
+std::optional<EditHistory::Applied> EditHistory::undo() {
+    if (m_undo.empty()) {
+        return std::nullopt;
+    }
+    Applied applied;
+    apply(m_undo.back(), false, applied);
+    m_redo.push_back(std::move(m_undo.back()));
+    m_undo.pop_back();
+    m_sealed = true;
+    return applied;
+}
+
+std::optional<EditHistory::Applied> EditHistory::redo() {
+    if (m_redo.empty()) {
+        return std::nullopt;
+    }
+    Applied applied;
+    apply(m_redo.back(), true, applied);
+    m_undo.push_back(std::move(m_redo.back()));
+    m_redo.pop_back();
+    m_sealed = true;
+    return applied;
+}
+
+std::vector<std::string> EditHistory::undo_labels(size_t max) const {
+    std::vector<std::string> labels;
+    for (auto it = m_undo.rbegin(); it != m_undo.rend() && labels.size() < max; ++it) {
+        labels.push_back(it->label);
+    }
+    return labels;
+}
+
+void EditHistory::clear() {
+    m_undo.clear();
+    m_redo.clear();
+    m_alias.clear();
+    m_bytes = 0;
+    m_sealed = false;
+}
+
+} // namespace ascii
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "scene_world.hpp"
+#include "renderer/material_table.hpp"
+#include "world/tilemap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class TransformHierarchy;
+
+// Undo/redo journal of editor mutations (IPC edits; scripts are not
+// recorded). Each entry keeps only the delta of one edit, with the values
+// before and after it: a transform, a material, row runs of changed tiles,
+// or copies of a destroyed subtree. Undo and redo apply those values, so
+// they cost the size of the delta, not of the scene.
+//
+// Edits of the same target arriving within MERGE_SECONDS of each other
+// (a gizmo drag, a color slider, a tile paint stroke) fold into one entry
+// that keeps the first "before" and the latest "after". The journal drops
+// its oldest entries past MAX_ENTRIES or MAX_BYTES.
+class EditHistory {
+public:
+    static constexpr double MERGE_SECONDS = 0.5;
+    static constexpr size_t MAX_ENTRIES = 512;
+    static constexpr size_t MAX_BYTES = 64 * 1024 * 1024;
+
+    EditHistory(World& world, SceneIndex& index, Tilemap& tilemap, MaterialTable& materials,
+                TransformHierarchy& transforms)
+        : m_world(world), m_index(index), m_tilemap(tilemap), m_materials(materials), m_transforms(transforms) {}
+
+    // Record an edit that was just applied
+    void record_transform(Entity entity, const LocalTransform& before, const LocalTransform& after);
+    void record_material(uint16_t id, const Material& before, const Material& after);
+
+    // Tile changes collected with Tilemap::record_changes. Strokes
+    // (single-tile paints) merge; fills and pastes stay separate entries.
+    void record_tiles(const std::string& label, const std::vector<TileChange>& changes, bool stroke);
+
+    // Call before the entity is destroyed: copies it and its descendants
+    void record_destroy(Entity root);
+
+    struct Applied {
+        std::string label;
+        std::vector<uint16_t> materials;    // Material ids to re-upload
+    };
+
+    // nullopt when there is nothing to undo / redo
+    std::optional<Applied> undo();
+    std::optional<Applied> redo();
+
+    size_t undo_count() const { return m_undo.size(); }
+    size_t redo_count() const { return m_redo.size(); }
+    size_t bytes() const { return m_bytes; }
+
+    // Labels of the most recent undoable entries, newest first
+    std::vector<std::string> undo_labels(size_t max) const;
+
+    // Forget everything (the state the entries refer to was replaced)
+    void clear();
+
+private:
+    enum class Kind : uint8_t { Transform, Material, Tiles, Destroy };
+
+    // Consecutive tiles of one row with the same before and after
+    struct TileRun {
+        int layer = 0;
+        int x = 0;
+        int y = 0;
+        int count = 0;
+        Tile before;
+        Tile after;
+    };
+
+    struct Entry {
+        Kind kind = Kind::Transform;
+        std::string label;
+        double time = 0.0;              // Of the latest edit merged in
+        uint64_t target = 0;            // Entity bits / material id; merge key with kind
+        bool mergeable = false;
+
+        LocalTransform transform_before, transform_after;
+        Material material_before{}, material_after{};
+        std::vector<TileRun> tiles;
+        std::vector<EntityImage> images;  // Destroyed subtree, parents first
+
+        size_t bytes() const;
+    };
+
+    // Entry to merge the next edit of (kind, target) into, or nullptr
+    Entry* merge_target(Kind kind, uint64_t target, double now);
+    void push(Entry entry);
+    void apply(Entry& entry, bool forward, Applied& applied);
+    void trim();
+
+    // Latest handle of an entity that undo re-created (possibly repeatedly)
+    Entity resolve(Entity entity) const;
+
+    World& m_world;
+    SceneIndex& m_index;
+    Tilemap& m_tilemap;
+    MaterialTable& m_materials;
+    TransformHierarchy& m_transforms;
+
+    std::deque<Entry> m_undo;
+    std::vector<Entry> m_redo;
+    size_t m_bytes = 0;
+    bool m_sealed = false;              // Undo / redo ran since the last record: no merging
+    std::unordered_map<Entity, Entity, HandleHash> m_alias;
+};
+
+} // namespace ascii
@@ -0,0 +1,49 @@
+#include "play_snapshot.hpp"
+#include "scene_index.hpp"
+#include "ecs/schema.hpp"
+#include "ecs/world.hpp"
+#include "world/tilemap.hpp"
+
+namespace ascii {
+
+void PlaySnapshot::begin() {
+    commit();
+    m_world.begin_snapshot();
+    m_index.begin_snapshot();
+    m_tilemap.begin_snapshot();
+    m_schemas.begin_snapshot();
+    m_saved_materials = m_materials;
+    m_active = true;
+}
+
+void PlaySnapshot::restore() {
+    if (!m_active) {
+        return;
+    }
+    m_world.restore_snapshot();
+    m_index.restore_snapshot();
+    m_tilemap.restore_snapshot();
+    m_schemas.restore_snapshot();
+    m_materials = m_saved_materials;
+    m_saved_materials.clear();
+    m_active = false;
+}
+
+void PlaySnapshot::commit() {
+    if (!m_active) {
+        return;
+    }
+    m_world.commit_snapshot();
+    m_index.commit_snapshot();
+    m_tilemap.commit_snapshot();
+    m_schemas.commit_snapshot();
+    m_saved_materials.clear();
+    m_active = false;
+}
+
+size_t PlaySnapshot::bytes() const {
+    return m_world.snapshot_bytes() + m_index.snapshot_bytes() + m_tilemap.snapshot_bytes() +
+           m_schemas.snapshot_bytes() + m_saved_materials.size() * sizeof(Material);
+}
+
+} // namespace ascii
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "renderer/material_table.hpp"
+
+#include <cstddef>
+
+namespace ascii {
+
+class World;
+class SceneIndex;
+class Tilemap;
+class SchemaRegistry;
+
+// Editor state saved when play mode starts and put back when it stops.
+// Every store keeps copy-on-write pre-images (archetype chunks, tilemap
+// chunks, journal pages), so begin() copies no component or tile data
+// and restore() costs what play mode wrote. The material table is small
+// and copied outright. Script (Lua) state is not part of it.
+class PlaySnapshot {
+public:
+    PlaySnapshot(World& world, SceneIndex& index, Tilemap& tilemap, SchemaRegistry& schemas,
+                 MaterialTable& materials)
+        : m_world(world), m_index(index), m_tilemap(tilemap), m_schemas(schemas), m_materials(materials) {}
+
+    // Replaces an active snapshot
+    void begin();
+
+    // Back to the state of begin(); a structural change for the world.
+    // The material table is replaced, so its GPU copy must be re-uploaded.
+    void restore();
+
+    // Keep what play mode did
+    void commit();
+
+    bool active() const { return m_active; }
+
+    // Pre-images held right now
+    size_t bytes() const;
+
+private:
+    World& m_world;
+    SceneIndex& m_index;
+    Tilemap& m_tilemap;
+    SchemaRegistry& m_schemas;
+    MaterialTable& m_materials;
+    MaterialTable m_saved_materials;
+    bool m_active = false;
+};
+
+} // namespace ascii
@@ -0,0 +1,21 @@
+#include "scene.hpp"
+
+namespace ascii {
+
+int32_t SceneDocument::add_node(int32_t parent_index) {
+    parent.push_back(parent_index);
+    node_id.emplace_back();
+    node_name.emplace_back();
+    node_type.emplace_back();
+    position.emplace_back(0.0f);
+    rotation.emplace_back(0.0f);
+    scale.emplace_back(1.0f);
+    meta.emplace_back();
+    return static_cast<int32_t>(parent.size() - 1);
+}
+
+void SceneDocument::clear() {
+    *this = SceneDocument{};
+}
+
+} // namespace ascii
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ascii {
+
+// A loose property kept as-is (unknown components, node meta)
+struct SceneProperty {
+    enum class Kind : uint8_t { Null, Bool, Number, String, Array };
+
+    std::string key;
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<double> array;         // Arrays of numbers only
+};
+
+// Fields every component record starts with
+struct SceneComponentBase {
+    int32_t node = -1;                 // Owning node index
+    std::string id;
+    bool enabled = true;
+};
+
+// Single character ("Glyph" component)
+struct GlyphComponent : SceneComponentBase {
+    uint32_t glyph = 0;                // Unicode codepoint
+    std::string fg = "#ffffff";        // CSS-style colors as authored
+    std::string bg = "transparent";
+    bool bold = false;
+};
+
+// Multi-line ASCII art ("Ascii" component), one glyph per non-space character
+struct AsciiComponent : SceneComponentBase {
+    std::string art;                   // Rows separated by '\n'
+    int width = 0;
+    int height = 0;
+    std::string palette;
+    float brightness = 1.0f;
+    bool transparent_bg = true;
+    bool animate = false;
+    float animation_speed = 1.0f;
+    std::string animation_type;
+};
+
+// Rectangle of ground tiles ("Terrain" component)
+struct TerrainComponent : SceneComponentBase {
+    int width = 0;
+    int height = 0;
+    uint32_t fill_glyph = '.';
+    std::string palette;
+};
+
+// Point light ("Light" component)
+struct LightComponent : SceneComponentBase {
+    glm::vec3 color{1.0f};
+    float intensity = 1.0f;
+    float radius = 10.0f;
+    float falloff = 1.0f;
+};
+
+// Blocking shape ("Collider" component), one tile at the node
+struct ColliderComponent : SceneComponentBase {
+    bool blocks_movement = true;
+    bool blocks_vision = false;
+    std::string layer;
+};
+
+// Camera target ("Camera" component)
+struct CameraComponent : SceneComponentBase {
+    int priority = 0;
+    bool active = true;
+    float zoom = 1.0f;
+    glm::vec2 damping{0.0f};
+    std::string binding_mode;
+};
+
+// The node's "visual" block
+struct VisualComponent : SceneComponentBase {
+    bool visible = true;
+    uint32_t glyph = 0;
+    glm::vec3 color{1.0f};
+    float opacity = 1.0f;
+    glm::vec3 emission{0.0f};
+    float emission_power = 0.0f;
+};
+
+// Any other component, with its properties kept verbatim
+struct GenericComponent : SceneComponentBase {
+    std::string script;
+    std::vector<SceneProperty> properties;
+};
+
+// Flattened scene.json. Nodes are stored in pre-order (every parent comes
+// before its children) as structure-of-arrays; components are stored per
+// type in native arrays that refer to their node by index.
+// Scene space is the editor's 2D map: x right, y down the map, z up.
+struct SceneDocument {
+    std::string version;
+
+    // Nodes
+    std::vector<int32_t> parent;       // -1 for the root
+    std::vector<std::string> node_id;
+    std::vector<std::string> node_name;
+    std::vector<std::string> node_type;
+    std::vector<glm::vec3> position;   // Local transform
+    std::vector<glm::vec3> rotation;   // Euler angles, degrees
+    std::vector<glm::vec3> scale;
+    std::vector<std::vector<SceneProperty>> meta;
+
+    // Components
+    std::vector<GlyphComponent> glyphs;
+    std::vector<AsciiComponent> ascii;
+    std::vector<TerrainComponent> terrain;
+    std::vector<LightComponent> lights;
+    std::vector<ColliderComponent> colliders;
+    std::vector<CameraComponent> cameras;
+    std::vector<VisualComponent> visuals;
+    std::vector<GenericComponent> other;
+
+    size_t node_count() const { return parent.size(); }
+    size_t component_count() const {
+        return glyphs.size() + ascii.size() + terrain.size() + lights.size() +
+               colliders.size() + cameras.size() + visuals.size() + other.size();
+    }
+
+    // Append a node with an identity transform; returns its index
+    int32_t add_node(int32_t parent_index);
+    void clear();
+};
+
+} // namespace ascii
@@ -0,0 +1,677 @@
+#include "scene_binary.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ascii {
+
+namespace {
+
+using namespace scene_format;
+
+static_assert(sizeof(Header) == 24);
+static_assert(sizeof(Section) == 24);
+static_assert(sizeof(Property) == 32);
+static_assert(sizeof(Info) % ALIGNMENT == 0);
+static_assert(sizeof(glm::vec3) == 12 && sizeof(Material) == 32 && sizeof(ascii::Light) == 32);
+
+uint64_t align_up(uint64_t value) {
+    return (value + ALIGNMENT - 1) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+}
+
+// Deduplicating string table builder
+class StringTableBuilder {
+public:
+    StringTableBuilder() { m_offsets.push_back(0); }
+
+    StringRef add(const std::string& text) {
+        auto [it, inserted] = m_index.try_emplace(text, static_cast<StringRef>(m_offsets.size() - 1));
+        if (inserted) {
+            m_data += text;
+            m_offsets.push_back(static_cast<uint32_t>(m_data.size()));
+        }
+        return it->second;
+    }
+
+    const std::vector<uint32_t>& offsets() const { return m_offsets; }
+    const std::string& data() const { return m_data; }
+
+private:
+    std::vector<uint32_t> m_offsets;
+    std::string m_data;
+    std::unordered_map<std::string, StringRef> m_index;
+};
+
+// Collects sections (borrowed pointers) and writes the file in one go
+class SectionWriter {
+public:
+    template<typename T>
+    void add(SectionId id, const T* data, size_t count) {
+        m_sections.push_back({id, static_cast<uint32_t>(sizeof(T)), count, data});
+    }
+
+    template<typename T>
+    void add(SectionId id, const std::vector<T>& values) {
+        add(id, values.data(), values.size());
+    }
+
+    void write(const std::string& path) const {
+        std::vector<Section> table;
+        uint64_t offset = align_up(sizeof(Header) + m_sections.size() * sizeof(Section));
+        for (const auto& pending : m_sections) {
+            table.push_back({static_cast<uint32_t>(pending.id), pending.element_size, pending.count, offset});
+            offset = align_up(offset + pending.count * pending.element_size);
+        }
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.section_count = static_cast<uint32_t>(table.size());
+        header.file_size = offset;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to open scene file for writing: " + path);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Section));
+
+        const char zeros[ALIGNMENT] = {};
+        uint64_t position = sizeof(Header) + table.size() * sizeof(Section);
+        for (size_t i = 0; i < table.size(); i++) {
+            file.write(zeros, static_cast<std::streamsize>(table[i].offset - position));
+            const uint64_t bytes = table[i].count * table[i].element_size;
+            file.write(static_cast<const char*>(m_sections[i].data), static_cast<std::streamsize>(bytes));
+            position = table[i].offset + bytes;
+        }
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+
+        if (!file) {
+            throw std::runtime_error("Failed to write scene file: " + path);
+        }
+    }
+
+private:
+    struct Pending {
+        SectionId id;
+        uint32_t element_size;
+        uint64_t count;
+        const void* data;
+    };
+    std::vector<Pending> m_sections;
+};
+
+Range add_properties(const std::vector<SceneProperty>& source, StringTableBuilder& strings,
+                     std::vector<Property>& properties, std::vector<double>& numbers) {
+    Range range{static_cast<uint32_t>(properties.size()), static_cast<uint32_t>(source.size())};
+    for (const auto& p : source) {
+        Property out{};
+        out.key = strings.add(p.key);
+        out.kind = static_cast<uint32_t>(p.kind);
+        out.number = p.kind == SceneProperty::Kind::Bool ? (p.boolean ? 1.0 : 0.0) : p.number;
+        out.text = strings.add(p.text);
+        out.array = {static_cast<uint32_t>(numbers.size()), static_cast<uint32_t>(p.array.size())};
+        numbers.insert(numbers.end(), p.array.begin(), p.array.end());
+        properties.push_back(out);
+    }
+    return range;
+}
+
+template<typename Record, typename Component>
+Record component_record(const Component& c, StringTableBuilder& strings) {
+    Record record{};
+    record.base = {c.node, strings.add(c.id), c.enabled ? 1u : 0u};
+    return record;
+}
+
+bool range_valid(const Range& range, size_t size) {
+    return range.first <= size && range.count <= size - range.first;
+}
+
+// Bounds-checked typed access to the sections of a mapped file
+class SectionReader {
+public:
+    SectionReader(const std::string& path, const uint8_t* base, size_t size)
+        : m_path(path), m_base(base), m_size(size) {
+        if (size < sizeof(Header)) {
+            fail("too small");
+        }
+        Header header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            fail("bad magic");
+        }
+        if (header.version != VERSION) {
+            fail("unsupported version " + std::to_string(header.version));
+        }
+        if (header.file_size != size) {
+            fail("truncated");
+        }
+        if (header.section_count > (size - sizeof(Header)) / sizeof(Section)) {
+            fail("section table out of bounds");
+        }
+
+        // Index the table by id; unknown ids (newer writers) are ignored
+        const auto* table = reinterpret_cast<const Section*>(base + sizeof(Header));
+        m_sections.assign(static_cast<size_t>(SectionId::TileHeight) + 1, nullptr);
+        for (uint32_t i = 0; i < header.section_count; i++) {
+            if (table[i].id < m_sections.size()) {
+                m_sections[table[i].id] = &table[i];
+            }
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& reason) const {
+        throw std::runtime_error("Invalid scene file " + m_path + ": " + reason);
+    }
+
+    // Missing sections read as empty
+    template<typename T>
+    std::span<const T> get(SectionId id) const {
+        const Section* section = m_sections[static_cast<size_t>(id)];
+        if (!section || section->count == 0) {
+            return {};
+        }
+        if (section->element_size != sizeof(T)) {
+            fail("section " + std::to_string(section->id) + " has the wrong element size");
+        }
+        if (section->offset % ALIGNMENT != 0 || section->offset > m_size ||
+            section->count > (m_size - section->offset) / sizeof(T)) {
+            fail("section " + std::to_string(section->id) + " out of bounds");
+        }
+        return {reinterpret_cast<const T*>(m_base + section->offset), static_cast<size_t>(section->count)};
+    }
+
+    // A section that must have exactly `count` elements
+    template<typename T>
+    std::span<const T> column(SectionId id, size_t count) const {
+        std::span<const T> values = get<T>(id);
+        if (values.size() != count) {
+            fail("section " + std::to_string(static_cast<uint32_t>(id)) + " has the wrong length");
+        }
+        return values;
+    }
+
+private:
+    std::string m_path;
+    const uint8_t* m_base;
+    size_t m_size;
+    std::vector<const Section*> m_sections;
+};
+
+} // anonymous namespace
+
+SceneBake bake_scene(const SceneDocument& doc, JobSystem& jobs) {
+    SceneBake bake;
+    SceneGeometry geometry;
+    geometry.codepoint_as_blas = true;
+    SceneTargets targets{bake.instances, bake.materials, bake.lights, bake.tilemap};
+    bake.info = instantiate_scene(doc, geometry, targets, jobs);
+    bake.lights.pop_back();  // Terminator; the loader appends its own
+    return bake;
+}
+
+void save_scene_binary(const std::string& path, const SceneDocument& doc, const SceneBake& bake) {
+    StringTableBuilder strings;
+    std::vector<Property> properties;
+    std::vector<double> numbers;
+
+    // Nodes: transforms are written straight from the document's columns
+    const size_t node_count = doc.node_count();
+    std::vector<StringRef> node_id(node_count), node_name(node_count), node_type(node_count);
+    std::vector<Range> node_meta(node_count);
+    for (size_t i = 0; i < node_count; i++) {
+        node_id[i] = strings.add(doc.node_id[i]);
+        node_name[i] = strings.add(doc.node_name[i]);
+        node_type[i] = strings.add(doc.node_type[i]);
+        node_meta[i] = add_properties(doc.meta[i], strings, properties, numbers);
+    }
+
+    // Components
+    std::vector<Glyph> glyphs;
+    for (const auto& c : doc.glyphs) {
+        Glyph r = component_record<Glyph>(c, strings);
+        r.glyph = c.glyph;
+        r.fg = strings.add(c.fg);
+        r.bg = strings.add(c.bg);
+        r.bold = c.bold;
+        glyphs.push_back(r);
+    }
+    std::vector<Ascii> ascii;
+    for (const auto& c : doc.ascii) {
+        Ascii r = component_record<Ascii>(c, strings);
+        r.art = strings.add(c.art);
+        r.width = c.width;
+        r.height = c.height;
+        r.palette = strings.add(c.palette);
+        r.brightness = c.brightness;
+        r.transparent_bg = c.transparent_bg;
+        r.animate = c.animate;
+        r.animation_speed = c.animation_speed;
+        r.animation_type = strings.add(c.animation_type);
+        ascii.push_back(r);
+    }
+    std::vector<Terrain> terrain;
+    for (const auto& c : doc.terrain) {
+        Terrain r = component_record<Terrain>(c, strings);
+        r.width = c.width;
+        r.height = c.height;
+        r.fill_glyph = c.fill_glyph;
+        r.palette = strings.add(c.palette);
+        terrain.push_back(r);
+    }
+    std::vector<scene_format::Light> lights;
+    for (const auto& c : doc.lights) {
+        scene_format::Light r = component_record<scene_format::Light>(c, strings);
+        r.color = c.color;
+        r.intensity = c.intensity;
+        r.radius = c.radius;
+        r.falloff = c.falloff;
+        lights.push_back(r);
+    }
+    std::vector<Collider> colliders;
+    for (const auto& c : doc.colliders) {
+        Collider r = component_record<Collider>(c, strings);
+        r.blocks_movement = c.blocks_movement;
+        r.blocks_vision = c.blocks_vision;
+        r.layer = strings.add(c.layer);
+        colliders.push_back(r);
+    }
+    std::vector<Camera> cameras;
+    for (const auto& c : doc.cameras) {
+        Camera r = component_record<Camera>(c, strings);
+        r.priority = c.priority;
+        r.active = c.active;
+        r.zoom = c.zoom;
+        r.damping = c.damping;
+        r.binding_mode = strings.add(c.binding_mode);
+        cameras.push_back(r);
+    }
+    std::vector<Visual> visuals;
+    for (const auto& c : doc.visuals) {
+        Visual r = component_record<Visual>(c, strings);
+        r.visible = c.visible;
+        r.glyph = c.glyph;
+        r.color = c.color;
+        r.opacity = c.opacity;
+        r.emission = c.emission;
+        r.emission_power = c.emission_power;
+        visuals.push_back(r);
+    }
+    std::vector<Other> other;
+    for (const auto& c : doc.other) {
+        Other r = component_record<Other>(c, strings);
+        r.script = strings.add(c.script);
+        r.properties = add_properties(c.properties, strings, properties, numbers);
+        other.push_back(r);
+    }
+
+    // Precomputed renderer data
+    const InstanceStore& instances = bake.instances;
+    const size_t instance_count = instances.size();
+    std::vector<uint32_t> instance_glyph(instance_count), instance_material(instance_count);
+    for (uint32_t i = 0; i < instance_count; i++) {
+        instance_glyph[i] = instances.blas_index(i);
+        instance_material[i] = MaterialTable::material_id(instances.custom_index(i));
+    }
+
+    const Tilemap& tilemap = bake.tilemap;
+    const bool has_tiles = tilemap.layers() > 0;
+    const size_t tile_count = has_tiles ? static_cast<size_t>(tilemap.width()) * tilemap.height() : 0;
+
+    Info info{};
+    info.version = strings.add(doc.version);
+    info.instance_count = static_cast<uint32_t>(instance_count);
+    info.light_count = static_cast<uint32_t>(bake.lights.size());
+    info.material_count = static_cast<uint32_t>(bake.materials.size());
+    info.terrain_tiles = bake.info.terrain_tiles;
+    info.tile_width = has_tiles ? tilemap.width() : 0;
+    info.tile_height = has_tiles ? tilemap.height() : 0;
+    info.tile_size = tilemap.tile_size;
+    info.tile_origin = tilemap.origin;
+    info.tile_layer_base = has_tiles ? tilemap.layer_base(0) : 0.0f;
+    info.camera_target = bake.info.camera_target;
+    info.camera_zoom = bake.info.camera_zoom;
+    info.has_camera = bake.info.has_camera;
+
+    SectionWriter writer;
+    writer.add(SectionId::StringOffsets, strings.offsets());
+    writer.add(SectionId::StringData, strings.data().data(), strings.data().size());
+    writer.add(SectionId::NodeParent, doc.parent);
+    writer.add(SectionId::NodeId, node_id);
+    writer.add(SectionId::NodeName, node_name);
+    writer.add(SectionId::NodeType, node_type);
+    writer.add(SectionId::NodePosition, doc.position);
+    writer.add(SectionId::NodeRotation, doc.rotation);
+    writer.add(SectionId::NodeScale, doc.scale);
+    writer.add(SectionId::NodeMeta, node_meta);
+    writer.add(SectionId::Properties, properties);
+    writer.add(SectionId::PropertyNumbers, numbers);
+    writer.add(SectionId::Glyphs, glyphs);
+    writer.add(SectionId::Ascii, ascii);
+    writer.add(SectionId::Terrain, terrain);
+    writer.add(SectionId::Lights, lights);
+    writer.add(SectionId::Colliders, colliders);
+    writer.add(SectionId::Cameras, cameras);
+    writer.add(SectionId::Visuals, visuals);
+    writer.add(SectionId::Other, other);
+    writer.add(SectionId::Info, &info, 1);
+    writer.add(SectionId::Materials, bake.materials.entries());
+
+    const InstanceTransformArrays transforms = instances.transform_arrays();
+    const float* columns[10] = {transforms.position[0], transforms.position[1], transforms.position[2],
+                                transforms.rotation[0], transforms.rotation[1], transforms.rotation[2],
+                                transforms.rotation[3],
+                                transforms.scale[0], transforms.scale[1], transforms.scale[2]};
+    for (uint32_t i = 0; i < 10; i++) {
+        writer.add(static_cast<SectionId>(static_cast<uint32_t>(SectionId::InstancePosX) + i), columns[i], instance_count);
+    }
+    writer.add(SectionId::InstanceGlyph, instance_glyph);
+    writer.add(SectionId::InstanceMaterial, instance_material);
+    writer.add(SectionId::LightData, bake.lights);
+    if (has_tiles) {
+        writer.add(SectionId::TileGlyph, tilemap.layer_glyphs(0), tile_count);
+        writer.add(SectionId::TileMaterial, tilemap.layer_materials(0), tile_count);
+        writer.add(SectionId::TileHeight, tilemap.layer_heights(0), tile_count);
+    }
+
+    writer.write(path);
+}
+
+SceneBinary::SceneBinary(const std::string& path) : m_file(path) {
+    SectionReader reader(path, m_file.data(), m_file.size());
+    auto fail = [&](const std::string& reason) { reader.fail(reason); };
+
+    // Strings
+    m_string_offsets = reader.get<uint32_t>(SectionId::StringOffsets);
+    m_string_data = reader.get<char>(SectionId::StringData);
+    if (m_string_offsets.empty() || m_string_offsets[0] != 0 || m_string_offsets.back() != m_string_data.size() ||
+        !std::is_sorted(m_string_offsets.begin(), m_string_offsets.end())) {
+        fail("bad string table");
+    }
+
+    // Nodes
+    m_nodes.parent = reader.get<int32_t>(SectionId::NodeParent);
+    const size_t nodes = m_nodes.parent.size();
+    if (nodes == 0) {
+        fail("no nodes");
+    }
+    for (size_t i = 0; i < nodes; i++) {
+        if (m_nodes.parent[i] < -1 || m_nodes.parent[i] >= static_cast<int32_t>(i)) {
+            fail("nodes are not in pre-order");
+        }
+    }
+    m_nodes.id = reader.column<StringRef>(SectionId::NodeId, nodes);
+    m_nodes.name = reader.column<StringRef>(SectionId::NodeName, nodes);
+    m_nodes.type = reader.column<StringRef>(SectionId::NodeType, nodes);
+    m_nodes.position = reader.column<glm::vec3>(SectionId::NodePosition, nodes);
+    m_nodes.rotation = reader.column<glm::vec3>(SectionId::NodeRotation, nodes);
+    m_nodes.scale = reader.column<glm::vec3>(SectionId::NodeScale, nodes);
+    m_nodes.meta = reader.column<Range>(SectionId::NodeMeta, nodes);
+
+    // Properties and components
+    Components& c = m_components;
+    c.properties = reader.get<Property>(SectionId::Properties);
+    c.property_numbers = reader.get<double>(SectionId::PropertyNumbers);
+    for (const auto& property : c.properties) {
+        if (!range_valid(property.array, c.property_numbers.size())) {
+            fail("property array out of bounds");
+        }
+    }
+    for (const auto& range : m_nodes.meta) {
+        if (!range_valid(range, c.properties.size())) {
+            fail("node meta out of bounds");
+        }
+    }
+
+    auto components = [&]<typename T>(SectionId id, std::span<const T>& out) {
+        out = reader.get<T>(id);
+        for (const auto& record : out) {
+            if (record.base.node < 0 || static_cast<size_t>(record.base.node) >= nodes) {
+                fail("component refers to a missing node");
+            }
+        }
+    };
+    components(SectionId::Glyphs, c.glyphs);
+    components(SectionId::Ascii, c.ascii);
+    components(SectionId::Terrain, c.terrain);
+    components(SectionId::Lights, c.lights);
+    components(SectionId::Colliders, c.colliders);
+    components(SectionId::Cameras, c.cameras);
+    components(SectionId::Visuals, c.visuals);
+    components(SectionId::Other, c.other);
+    for (const auto& record : c.other) {
+        if (!range_valid(record.properties, c.properties.size())) {
+            fail("component properties out of bounds");
+        }
+    }
+
+    // Precomputed renderer data
+    Baked& b = m_baked;
+    b.info = reader.column<Info>(SectionId::Info, 1)[0];
+    b.materials = reader.column<Material>(SectionId::Materials, b.info.material_count);
+    for (uint32_t i = 0; i < 10; i++) {
+        const auto id = static_cast<SectionId>(static_cast<uint32_t>(SectionId::InstancePosX) + i);
+        b.transform[i] = reader.column<float>(id, b.info.instance_count);
+    }
+    b.glyph = reader.column<uint32_t>(SectionId::InstanceGlyph, b.info.instance_count);
+    b.material = reader.column<uint32_t>(SectionId::InstanceMaterial, b.info.instance_count);
+    for (uint32_t material : b.material) {
+        if (material >= b.info.material_count) {
+            fail("instance material out of range");
+        }
+    }
+    b.lights = reader.column<ascii::Light>(SectionId::LightData, b.info.light_count);
+
+    if (b.info.tile_width < 0 || b.info.tile_height < 0) {
+        fail("negative tilemap size");
+    }
+    const size_t tiles = static_cast<size_t>(b.info.tile_width) * static_cast<size_t>(b.info.tile_height);
+    b.tile_glyph = reader.column<uint32_t>(SectionId::TileGlyph, tiles);
+    b.tile_material = reader.column<uint16_t>(SectionId::TileMaterial, tiles);
+    b.tile_height = reader.column<float>(SectionId::TileHeight, tiles);
+    for (uint16_t material : b.tile_material) {
+        if (material >= b.info.material_count) {
+            fail("tile material out of range");
+        }
+    }
+}
+
+std::string_view SceneBinary::string(StringRef ref) const {
+    if (static_cast<size_t>(ref) + 1 >= m_string_offsets.size()) {
+        throw std::runtime_error("Scene string index out of range: " + std::to_string(ref));
+    }
+    const uint32_t begin = m_string_offsets[ref];
+    return {m_string_data.data() + begin, m_string_offsets[ref + 1] - begin};
+}
+
+SceneDocument SceneBinary::to_document() const {
+    SceneDocument doc;
+    doc.version = std::string(string(m_baked.info.version));
+
+    auto properties = [&](const Range& range) {
+        std::vector<SceneProperty> out;
+        out.reserve(range.count);
+        for (uint32_t i = range.first; i < range.first + range.count; i++) {
+            const Property& p = m_components.properties[i];
+            SceneProperty& property = out.emplace_back();
+            property.key = string(p.key);
+            property.kind = static_cast<SceneProperty::Kind>(p.kind);
+            property.boolean = p.number != 0.0;
+            property.number = p.number;
+            property.text = string(p.text);
+            const double* numbers = m_components.property_numbers.data() + p.array.first;
+            property.array.assign(numbers, numbers + p.array.count);
+        }
+        return out;
+    };
+
+    const size_t nodes = node_count();
+    for (size_t i = 0; i < nodes; i++) {
+        doc.add_node(m_nodes.parent[i]);
+        doc.node_id[i] = string(m_nodes.id[i]);
+        doc.node_name[i] = string(m_nodes.name[i]);
+        doc.node_type[i] = string(m_nodes.type[i]);
+        doc.position[i] = m_nodes.position[i];
+        doc.rotation[i] = m_nodes.rotation[i];
+        doc.scale[i] = m_nodes.scale[i];
+        doc.meta[i] = properties(m_nodes.meta[i]);
+    }
+
+    auto base = [&](SceneComponentBase& out, const ComponentHeader& header) {
+        out.node = header.node;
+        out.id = string(header.id);
+        out.enabled = header.enabled != 0;
+    };
+
+    for (const auto& r : m_components.glyphs) {
+        auto& c = doc.glyphs.emplace_back();
+        base(c, r.base);
+        c.glyph = r.glyph;
+        c.fg = string(r.fg);
+        c.bg = string(r.bg);
+        c.bold = r.bold != 0;
+    }
+    for (const auto& r : m_components.ascii) {
+        auto& c = doc.ascii.emplace_back();
+        base(c, r.base);
+        c.art = string(r.art);
+        c.width = r.width;
+        c.height = r.height;
+        c.palette = string(r.palette);
+        c.brightness = r.brightness;
+        c.transparent_bg = r.transparent_bg != 0;
+        c.animate = r.animate != 0;
+        c.animation_speed = r.animation_speed;
+        c.animation_type = string(r.animation_type);
+    }
+    for (const auto& r : m_components.terrain) {
+        auto& c = doc.terrain.emplace_back();
+        base(c, r.base);
+        c.width = r.width;
+        c.height = r.height;
+        c.fill_glyph = r.fill_glyph;
+        c.palette = string(r.palette);
+    }
+    for (const auto& r : m_components.lights) {
+        auto& c = doc.lights.emplace_back();
+        base(c, r.base);
+        c.color = r.color;
+        c.intensity = r.intensity;
+        c.radius = r.radius;
+        c.falloff = r.falloff;
+    }
+    for (const auto& r : m_components.colliders) {
+        auto& c = doc.colliders.emplace_back();
+        base(c, r.base);
+        c.blocks_movement = r.blocks_movement != 0;
+        c.blocks_vision = r.blocks_vision != 0;
+        c.layer = string(r.layer);
+    }
+    for (const auto& r : m_components.cameras) {
+        auto& c = doc.cameras.emplace_back();
+        base(c, r.base);
+        c.priority = r.priority;
+        c.active = r.active != 0;
+        c.zoom = r.zoom;
+        c.damping = r.damping;
+        c.binding_mode = string(r.binding_mode);
+    }
+    for (const auto& r : m_components.visuals) {
+        auto& c = doc.visuals.emplace_back();
+        base(c, r.base);
+        c.visible = r.visible != 0;
+        c.glyph = r.glyph;
+        c.color = r.color;
+        c.opacity = r.opacity;
+        c.emission = r.emission;
+        c.emission_power = r.emission_power;
+    }
+    for (const auto& r : m_components.other) {
+        auto& c = doc.other.emplace_back();
+        base(c, r.base);
+        c.script = string(r.script);
+        c.properties = properties(r.properties);
+    }
+    return doc;
+}
+
+SceneInstantiateResult instantiate_scene_binary(const SceneBinary& scene,
+                                                const SceneGeometry& geometry,
+                                                SceneTargets& targets) {
+    Stopwatch timer;
+    const SceneBinary::Baked& baked = scene.baked();
+    const Info& info = baked.info;
+
+    SceneInstantiateResult result;
+    result.glyph_instances = info.instance_count;
+    result.lights = info.light_count;
+    result.terrain_tiles = info.terrain_tiles;
+    result.has_camera = info.has_camera != 0;
+    result.camera_target = info.camera_target;
+    result.camera_zoom = info.camera_zoom;
+
+    // File material ids -> target ids
+    std::vector<uint16_t> material_ids(baked.materials.size());
+    bool identity = true;
+    for (size_t i = 0; i < baked.materials.size(); i++) {
+        material_ids[i] = targets.materials.add(baked.materials[i]);
+        identity = identity && material_ids[i] == i;
+    }
+
+    // Instances: ten column copies, then BLAS and material per instance
+    InstanceTransformArrays transforms{
+        {baked.transform[0].data(), baked.transform[1].data(), baked.transform[2].data()},
+        {baked.transform[3].data(), baked.transform[4].data(), baked.transform[5].data(), baked.transform[6].data()},
+        {baked.transform[7].data(), baked.transform[8].data(), baked.transform[9].data()}};
+    InstanceStore& instances = targets.instances;
+    const uint32_t first = instances.append_transforms(info.instance_count, transforms);
+
+    uint32_t last_glyph = 0;
+    uint32_t last_blas = geometry.glyph_blas;
+    for (uint32_t i = 0; i < info.instance_count; i++) {
+        const uint32_t glyph = baked.glyph[i];
+        if (glyph != last_glyph) {
+            auto it = geometry.glyph_meshes.find(glyph);
+            last_blas = it != geometry.glyph_meshes.end() ? it->second : geometry.glyph_blas;
+            last_glyph = glyph;
+        }
+        instances.set_blas(first + i, geometry.codepoint_as_blas ? glyph : last_blas);
+        instances.set_custom_index(first + i, MaterialTable::custom_index(material_ids[baked.material[i]]));
+    }
+
+    // Lights and the terminator
+    std::vector<ascii::Light>& lights = targets.lights;
+    lights.insert(lights.end(), baked.lights.begin(), baked.lights.end());
+    lights.push_back({glm::vec4(0.0f), glm::vec4(0.0f)});  // power = 0 ends the list in the shader
+
+    // Terrain layer
+    Tilemap& tilemap = targets.tilemap;
+    if (info.tile_width > 0 && info.tile_height > 0) {
+        tilemap.resize(info.tile_width, info.tile_height, 1);
+        tilemap.origin = info.tile_origin;
+        tilemap.tile_size = info.tile_size;
+        tilemap.set_layer_base(0, info.tile_layer_base);
+        if (identity) {
+            tilemap.assign_layer(0, baked.tile_glyph.data(), baked.tile_material.data(), baked.tile_height.data());
+        } else {
+            std::vector<uint16_t> remapped(baked.tile_material.size());
+            for (size_t i = 0; i < remapped.size(); i++) {
+                remapped[i] = material_ids[baked.tile_material[i]];
+            }
+            tilemap.assign_layer(0, baked.tile_glyph.data(), remapped.data(), baked.tile_height.data());
+        }
+    } else {
+        tilemap.resize(0, 0, 0);
+    }
+
+    result.component_ms = timer.elapsed_ms();
+    return result;
+}
+
+} // namespace ascii
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "scene.hpp"
+#include "scene_instantiate.hpp"
+#include "core/mapped_file.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+
+// On-disk layout of binary scene files (.ascn, little-endian). A header and
+// a section table are followed by sections that are each one flat array,
+// aligned to ALIGNMENT, so a mapped file is used in place: nodes as SoA
+// columns, components as per-type blocks, and the renderer data the scene
+// instantiates to (instances as SoA TRS, materials, lights, terrain tiles)
+// precomputed so loading is mostly memcpy.
+namespace scene_format {
+
+constexpr char MAGIC[4] = {'A', 'S', 'C', 'N'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGNMENT = 16;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t section_count;
+    uint32_t reserved;
+    uint64_t file_size;
+};
+
+struct Section {
+    uint32_t id;                   // SectionId
+    uint32_t element_size;         // Checked against the reader's struct
+    uint64_t count;
+    uint64_t offset;               // From the start of the file
+};
+
+enum class SectionId : uint32_t {
+    // String table: offsets[count + 1] into one blob of UTF-8
+    StringOffsets, StringData,
+
+    // Nodes, pre-order (parents before children)
+    NodeParent, NodeId, NodeName, NodeType, NodePosition, NodeRotation, NodeScale, NodeMeta,
+
+    // Loose properties (node meta, unknown components) and their number arrays
+    Properties, PropertyNumbers,
+
+    // Components, one block per type
+    Glyphs, Ascii, Terrain, Lights, Colliders, Cameras, Visuals, Other,
+
+    // Precomputed renderer data
+    Info, Materials,
+    InstancePosX, InstancePosY, InstancePosZ,
+    InstanceRotX, InstanceRotY, InstanceRotZ, InstanceRotW,
+    InstanceScaleX, InstanceScaleY, InstanceScaleZ,
+    InstanceGlyph, InstanceMaterial,
+    LightData,
+    TileGlyph, TileMaterial, TileHeight,
+};
+
+using StringRef = uint32_t;        // Index into the string table
+
+struct Range {
+    uint32_t first;
+    uint32_t count;
+};
+
+struct Property {
+    StringRef key;
+    uint32_t kind;                 // SceneProperty::Kind
+    double number;                 // Bool: 0 / 1
+    StringRef text;
+    Range array;                   // Into PropertyNumbers
+    uint32_t padding;
+};
+
+struct ComponentHeader {
+    int32_t node;
+    StringRef id;
+    uint32_t enabled;
+};
+
+struct Glyph {
+    ComponentHeader base;
+    uint32_t glyph;
+    StringRef fg;
+    StringRef bg;
+    uint32_t bold;
+};
+
+struct Ascii {
+    ComponentHeader base;
+    StringRef art;
+    int32_t width;
+    int32_t height;
+    StringRef palette;
+    float brightness;
+    uint32_t transparent_bg;
+    uint32_t animate;
+    float animation_speed;
+    StringRef animation_type;
+};
+
+struct Terrain {
+    ComponentHeader base;
+    int32_t width;
+    int32_t height;
+    uint32_t fill_glyph;
+    StringRef palette;
+};
+
+struct Light {
+    ComponentHeader base;
+    glm::vec3 color;
+    float intensity;
+    float radius;
+    float falloff;
+};
+
+struct Collider {
+    ComponentHeader base;
+    uint32_t blocks_movement;
+    uint32_t blocks_vision;
+    StringRef layer;
+};
+
+struct Camera {
+    ComponentHeader base;
+    int32_t priority;
+    uint32_t active;
+    float zoom;
+    glm::vec2 damping;
+    StringRef binding_mode;
+};
+
+struct Visual {
+    ComponentHeader base;
+    uint32_t visible;
+    uint32_t glyph;
+    glm::vec3 color;
+    float opacity;
+    glm::vec3 emission;
+    float emission_power;
+};
+
+struct Other {
+    ComponentHeader base;
+    StringRef script;
+    Range properties;
+};
+
+// Sizes of the precomputed arrays plus the scene-level results
+struct Info {
+    StringRef version;
+    uint32_t instance_count;
+    uint32_t light_count;          // Without the terminator
+    uint32_t material_count;
+    uint32_t terrain_tiles;
+    int32_t tile_width;
+    int32_t tile_height;
+    float tile_size;
+    glm::vec3 tile_origin;
+    float tile_layer_base;
+    glm::vec3 camera_target;
+    float camera_zoom;
+    uint32_t has_camera;
+    uint32_t padding[3];
+};
+
+} // namespace scene_format
+
+// What a scene instantiates to, computed ahead of time for the binary
+// format. Instance BLAS indices hold glyph codepoints; custom indices are
+// ids in this bake's material table.
+struct SceneBake {
+    InstanceStore instances;
+    MaterialTable materials;
+    std::vector<Light> lights;     // No terminator
+    Tilemap tilemap;
+    SceneInstantiateResult info;
+};
+
+SceneBake bake_scene(const SceneDocument& doc, JobSystem& jobs);
+
+// Throws std::runtime_error if the file can't be written
+void save_scene_binary(const std::string& path, const SceneDocument& doc, const SceneBake& bake);
+
+// A mapped binary scene. The constructor validates the header, section
+// bounds and every index the loader follows, then the arrays are read in
+// place. Throws std::runtime_error on a bad file.
+class SceneBinary {
+public:
+    explicit SceneBinary(const std::string& path);
+
+    struct Nodes {
+        std::span<const int32_t> parent;
+        std::span<const scene_format::StringRef> id, name, type;
+        std::span<const glm::vec3> position, rotation, scale;
+        std::span<const scene_format::Range> meta;
+    };
+
+    struct Components {
+        std::span<const scene_format::Glyph> glyphs;
+        std::span<const scene_format::Ascii> ascii;
+        std::span<const scene_format::Terrain> terrain;
+        std::span<const scene_format::Light> lights;
+        std::span<const scene_format::Collider> colliders;
+        std::span<const scene_format::Camera> cameras;
+        std::span<const scene_format::Visual> visuals;
+        std::span<const scene_format::Other> other;
+        std::span<const scene_format::Property> properties;
+        std::span<const double> property_numbers;
+    };
+
+    struct Baked {
+        scene_format::Info info;
+        std::span<const Material> materials;
+        std::span<const float> transform[10];      // pos xyz, rot xyzw, scale xyz
+        std::span<const uint32_t> glyph;
+        std::span<const uint32_t> material;
+        std::span<const Light> lights;
+        std::span<const uint32_t> tile_glyph;
+        std::span<const uint16_t> tile_material;
+        std::span<const float> tile_height;
+    };
+
+    size_t file_size() const { return m_file.size(); }
+    size_t node_count() const { return m_nodes.parent.size(); }
+    const Nodes& nodes() const { return m_nodes; }
+    const Components& components() const { return m_components; }
+    const Baked& baked() const { return m_baked; }
+
+    std::string_view string(scene_format::StringRef ref) const;
+
+    // Rebuild the editable document (for conversion back to scene.json)
+    SceneDocument to_document() const;
+
+private:
+    MappedFile m_file;
+    std::span<const uint32_t> m_string_offsets;
+    std::span<const char> m_string_data;
+    Nodes m_nodes;
+    Components m_components;
+    Baked m_baked{};
+};
+
+// Append the precomputed scene to the targets: transforms are copied
+// column-wise, glyphs resolve to BLASes and materials are re-added.
+SceneInstantiateResult instantiate_scene_binary(const SceneBinary& scene,
+                                                const SceneGeometry& geometry,
+                                                SceneTargets& targets);
+
+} // namespace ascii
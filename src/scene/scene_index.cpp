@@ -0,0 +1,61 @@
+#include "scene_index.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ascii {
+
+Entity SceneIndex::find(std::string_view id) const {
+    const StringId interned = m_strings.find(id);
+    return interned == NO_STRING ? NULL_ENTITY : find(interned);
+}
+
+bool SceneIndex::bind(StringId id, Entity entity) {
+    if (id >= m_entities.size()) {
+        m_entities.resize(std::max<size_t>(id + 1, m_strings.size()), NULL_ENTITY);
+    }
+    if (m_entities[id].valid()) {
+        return m_entities[id] == entity;
+    }
+    m_journal.touch(m_entities, id);
+    m_entities[id] = entity;
+    m_bound++;
+    return true;
+}
+
+void SceneIndex::unbind(StringId id) {
+    if (id < m_entities.size() && m_entities[id].valid()) {
+        m_journal.touch(m_entities, id);
+        m_entities[id] = NULL_ENTITY;
+        m_bound--;
+    }
+}
+
+void SceneIndex::clear() {
+    m_journal.commit();
+    m_strings.clear();
+    m_entities.clear();
+    m_bound = 0;
+}
+
+void SceneIndex::reset(StringInterner strings) {
+    clear();
+    m_strings = std::move(strings);
+}
+
+void SceneIndex::begin_snapshot() {
+    m_journal.begin(m_entities.size());
+    m_saved_bound = m_bound;
+}
+
+void SceneIndex::restore_snapshot() {
+    if (!m_journal.active()) {
+        return;
+    }
+    const size_t size = m_entities.size();
+    m_journal.restore(m_entities);
+    m_entities.resize(size, NULL_ENTITY);       // Ids bound since the snapshot
+    m_bound = m_saved_bound;
+}
+
+} // namespace ascii
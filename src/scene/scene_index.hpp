@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/page_journal.hpp"
+#include "core/string_interner.hpp"
+#include "ecs/component.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace ascii {
+
+// Authored string ids ("player", "ground-layer") -> entities. Ids are
+// interned once; the entity table is indexed by the interned id, so a
+// lookup is one open-addressing probe plus an array read. Names and
+// types are interned here too, so SceneNode stays plain data.
+class SceneIndex {
+public:
+    StringId intern(std::string_view text) { return m_strings.intern(text); }
+    std::string_view str(StringId id) const { return m_strings.str(id); }
+    size_t string_count() const { return m_strings.size(); }
+
+    // NULL_ENTITY if the id is unknown or unbound
+    Entity find(std::string_view id) const;
+    Entity find(StringId id) const { return id < m_entities.size() ? m_entities[id] : NULL_ENTITY; }
+
+    // False (and no change) if the id already names another entity
+    bool bind(StringId id, Entity entity);
+    void unbind(StringId id);
+
+    size_t size() const { return m_bound; }
+
+    // Ends an active snapshot, keeping the current state
+    void clear();
+
+    // clear(), then take `strings` as the interned strings (ids kept)
+    void reset(StringInterner strings);
+
+    // Copy-on-write snapshot of the bindings (play mode); strings interned
+    // since are kept, unbound
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot() { m_journal.commit(); }
+    bool snapshot_active() const { return m_journal.active(); }
+    size_t snapshot_bytes() const { return m_journal.bytes(); }
+
+private:
+    StringInterner m_strings;
+    std::vector<Entity> m_entities;     // By StringId
+    size_t m_bound = 0;
+    PageJournal<Entity> m_journal;
+    size_t m_saved_bound = 0;
+};
+
+} // namespace ascii
@@ -0,0 +1,60 @@
+#include "scene_instantiate.hpp"
+#include "scene_world.hpp"
+#include "core/stopwatch.hpp"
+
+namespace ascii {
+
+void compute_world_transforms(const SceneDocument& doc, SceneWorldTransforms& out) {
+    const size_t count = doc.node_count();
+    out.position.resize(count);
+    out.rotation.resize(count);
+    out.scale.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3& euler = doc.rotation[i];
+        glm::quat local_rotation(glm::vec3(glm::radians(euler.x), glm::radians(euler.z), glm::radians(euler.y)));
+        glm::vec3 local_position = scene_to_world(doc.position[i]);
+        glm::vec3 local_scale = scene_to_world(doc.scale[i]);
+
+        const int32_t parent = doc.parent[i];
+        if (parent < 0) {
+            out.position[i] = local_position;
+            out.rotation[i] = local_rotation;
+            out.scale[i] = local_scale;
+            continue;
+        }
+        out.position[i] = out.position[parent] + out.rotation[parent] * (out.scale[parent] * local_position);
+        out.rotation[i] = out.rotation[parent] * local_rotation;
+        out.scale[i] = out.scale[parent] * local_scale;
+    }
+}
+
+SceneInstantiateResult instantiate_scene(const SceneDocument& doc,
+                                         const SceneGeometry& geometry,
+                                         SceneTargets& targets,
+                                         JobSystem& jobs) {
+    SceneInstantiateResult result;
+    Stopwatch timer;
+
+    World world;
+    SceneIndex index;
+    spawn_scene(doc, world, index, targets.materials);
+    result.transform_ms = timer.elapsed_ms();
+    timer.reset();
+
+    // A fresh extractor appends its slot range after the existing instances
+    SceneExtractor extractor(targets.instances);
+    result.glyph_instances = extractor.extract_instances(world, geometry, jobs);
+
+    std::vector<Light> lights;
+    result.lights = extractor.extract_lights(world, lights);
+    targets.lights.insert(targets.lights.end(), lights.begin(), lights.end());
+
+    result.terrain_tiles = extract_terrain(world, targets.tilemap, targets.materials);
+    result.has_camera = find_scene_camera(world, result.camera_target, result.camera_zoom);
+
+    result.component_ms = timer.elapsed_ms();
+    return result;
+}
+
+} // namespace ascii
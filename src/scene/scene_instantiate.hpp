@@ -0,0 +1,73 @@
+#pragma once
+
+#include "scene.hpp"
+#include "renderer/instance_store.hpp"
+#include "renderer/material_table.hpp"
+#include "renderer/rt_pipeline.hpp"
+#include "world/tilemap.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+
+// Scene space is the editor's 2D map (x right, y down the map, z up);
+// the engine's world is y-up. Scene cell (x, y) covers world [x, x+1) x [y, y+1).
+inline glm::vec3 scene_to_world(const glm::vec3& p) { return {p.x, p.z, p.y}; }
+
+// Meshes used for glyphs
+struct SceneGeometry {
+    uint32_t glyph_blas = 0;                                // Default mesh (unit cube)
+    std::unordered_map<uint32_t, uint32_t> glyph_meshes;    // Codepoint -> BLAS, e.g. letter meshes
+    std::unordered_map<uint32_t, uint32_t> glyph_lod_chains;  // Codepoint -> LodSystem chain of its mesh
+    bool codepoint_as_blas = false;                         // Store the codepoint itself (baking)
+};
+
+// Where instantiated data goes. Instances, materials and lights are
+// appended; the light list gets its terminator. Terrain replaces the
+// tilemap contents (one floor layer).
+struct SceneTargets {
+    InstanceStore& instances;
+    MaterialTable& materials;
+    std::vector<Light>& lights;
+    Tilemap& tilemap;
+};
+
+struct SceneInstantiateResult {
+    uint32_t glyph_instances = 0;
+    uint32_t lights = 0;
+    uint32_t terrain_tiles = 0;
+
+    bool has_camera = false;            // Highest priority active Camera component
+    glm::vec3 camera_target{0.0f};      // World space
+    float camera_zoom = 1.0f;
+
+    double transform_ms = 0.0;          // Transforms and ECS spawn
+    double component_ms = 0.0;          // Extraction
+};
+
+// World transforms of every node, in world space
+struct SceneWorldTransforms {
+    std::vector<glm::vec3> position;
+    std::vector<glm::quat> rotation;
+    std::vector<glm::vec3> scale;
+};
+
+// Parents come before children, so one forward pass resolves the hierarchy
+void compute_world_transforms(const SceneDocument& doc, SceneWorldTransforms& out);
+
+// Turn components into renderer data: spawns the document into a temporary
+// ECS world and runs the scene extractors over it (scene_world.hpp).
+// Glyph instances are written chunk by chunk on the job system.
+SceneInstantiateResult instantiate_scene(const SceneDocument& doc,
+                                         const SceneGeometry& geometry,
+                                         SceneTargets& targets,
+                                         JobSystem& jobs);
+
+} // namespace ascii
@@ -0,0 +1,551 @@
+#include "scene_json.hpp"
+#include "world/tilemap.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace ascii {
+
+namespace {
+
+using json = nlohmann::json;
+
+const SceneProperty* find_property(const std::vector<SceneProperty>& properties, std::string_view key) {
+    for (const auto& property : properties) {
+        if (property.key == key) {
+            return &property;
+        }
+    }
+    return nullptr;
+}
+
+double number_property(const std::vector<SceneProperty>& properties, std::string_view key, double fallback) {
+    const SceneProperty* p = find_property(properties, key);
+    return p && p->kind == SceneProperty::Kind::Number ? p->number : fallback;
+}
+
+bool bool_property(const std::vector<SceneProperty>& properties, std::string_view key, bool fallback) {
+    const SceneProperty* p = find_property(properties, key);
+    return p && p->kind == SceneProperty::Kind::Bool ? p->boolean : fallback;
+}
+
+std::string string_property(const std::vector<SceneProperty>& properties, std::string_view key,
+                            const std::string& fallback) {
+    const SceneProperty* p = find_property(properties, key);
+    return p && p->kind == SceneProperty::Kind::String ? p->text : fallback;
+}
+
+glm::vec3 vec3_property(const std::vector<SceneProperty>& properties, std::string_view key, const glm::vec3& fallback) {
+    const SceneProperty* p = find_property(properties, key);
+    if (!p || p->kind != SceneProperty::Kind::Array) {
+        return fallback;
+    }
+    glm::vec3 v = fallback;
+    for (size_t i = 0; i < 3 && i < p->array.size(); i++) {
+        v[static_cast<int>(i)] = static_cast<float>(p->array[i]);
+    }
+    return v;
+}
+
+// SAX handler. A stack of frames tracks where in the document we are; only
+// the parts of the schema the engine understands are kept, everything else
+// is skipped without being materialized.
+class SceneSaxHandler : public nlohmann::json_sax<json> {
+public:
+    explicit SceneSaxHandler(SceneDocument& doc) : m_doc(doc) {}
+
+    bool null() override {
+        scalar(SceneProperty::Kind::Null, false, 0.0, nullptr);
+        return true;
+    }
+    bool boolean(bool value) override {
+        scalar(SceneProperty::Kind::Bool, value, 0.0, nullptr);
+        return true;
+    }
+    bool number_integer(number_integer_t value) override {
+        return number(static_cast<double>(value));
+    }
+    bool number_unsigned(number_unsigned_t value) override {
+        return number(static_cast<double>(value));
+    }
+    bool number_float(number_float_t value, const string_t&) override {
+        return number(value);
+    }
+    bool string(string_t& value) override {
+        scalar(SceneProperty::Kind::String, false, 0.0, &value);
+        return true;
+    }
+    bool binary(binary_t&) override {
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        m_key = std::move(value);
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        if (m_stack.empty()) {
+            m_stack.push_back({Ctx::Root, -1, {}});
+            return true;
+        }
+
+        Frame& top = m_stack.back();
+        switch (top.ctx) {
+            case Ctx::Root:
+                if (m_key == "rootNode") {
+                    push_node(-1);
+                    return true;
+                }
+                break;
+            case Ctx::Children:
+                push_node(top.node);
+                return true;
+            case Ctx::Components:
+                m_component = {};
+                m_component.node = top.node;
+                m_stack.push_back({Ctx::Component, top.node, {}});
+                return true;
+            case Ctx::Component:
+                if (m_key == "properties") {
+                    m_stack.push_back({Ctx::Properties, top.node, {}});
+                    return true;
+                }
+                break;
+            case Ctx::Node:
+                if (m_key == "transform") {
+                    m_stack.push_back({Ctx::Transform, top.node, {}});
+                    return true;
+                }
+                if (m_key == "visual") {
+                    m_visual = {};
+                    m_visual.node = top.node;
+                    m_stack.push_back({Ctx::Visual, top.node, {}});
+                    return true;
+                }
+                if (m_key == "meta") {
+                    m_stack.push_back({Ctx::Meta, top.node, {}});
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+        m_stack.push_back({Ctx::Skip, -1, {}});
+        return true;
+    }
+
+    bool end_object() override {
+        Frame frame = std::move(m_stack.back());
+        m_stack.pop_back();
+        if (frame.ctx == Ctx::Component) {
+            finish_component();
+        } else if (frame.ctx == Ctx::Visual) {
+            m_doc.visuals.push_back(std::move(m_visual));
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        Ctx ctx = m_stack.empty() ? Ctx::Skip : m_stack.back().ctx;
+        const int32_t node = m_stack.empty() ? -1 : m_stack.back().node;
+
+        if (ctx == Ctx::Node && m_key == "children") {
+            m_stack.push_back({Ctx::Children, node, {}});
+        } else if (ctx == Ctx::Node && m_key == "components") {
+            m_stack.push_back({Ctx::Components, node, {}});
+        } else if (ctx == Ctx::Transform || ctx == Ctx::Visual || ctx == Ctx::Properties || ctx == Ctx::Meta) {
+            m_numbers.clear();
+            m_stack.push_back({Ctx::Numbers, node, m_key});
+        } else {
+            m_stack.push_back({Ctx::Skip, -1, {}});
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        Frame frame = std::move(m_stack.back());
+        m_stack.pop_back();
+        if (frame.ctx == Ctx::Numbers) {
+            finish_numbers(frame);
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        throw std::runtime_error("scene.json parse error at byte " + std::to_string(position) + ": " + ex.what());
+    }
+
+private:
+    enum class Ctx : uint8_t {
+        Root, Node, Children, Components, Component, Properties, Transform, Visual, Meta, Numbers, Skip
+    };
+
+    struct Frame {
+        Ctx ctx;
+        int32_t node;
+        std::string key;               // Numbers: the key the array belongs to
+    };
+
+    // Component being read; typed once its object closes (script may come last)
+    struct PendingComponent {
+        int32_t node = -1;
+        std::string id;
+        std::string script;
+        bool enabled = true;
+        std::vector<SceneProperty> properties;
+    };
+
+    void push_node(int32_t parent) {
+        int32_t node = m_doc.add_node(parent);
+        m_stack.push_back({Ctx::Node, node, {}});
+    }
+
+    bool number(double value) {
+        if (!m_stack.empty() && m_stack.back().ctx == Ctx::Numbers) {
+            m_numbers.push_back(value);
+            return true;
+        }
+        scalar(SceneProperty::Kind::Number, false, value, nullptr);
+        return true;
+    }
+
+    void scalar(SceneProperty::Kind kind, bool boolean, double number, std::string* text) {
+        if (m_stack.empty()) {
+            return;
+        }
+        const Frame& top = m_stack.back();
+        const bool is_string = kind == SceneProperty::Kind::String;
+
+        switch (top.ctx) {
+            case Ctx::Root:
+                if (m_key == "version" && is_string) {
+                    m_doc.version = std::move(*text);
+                }
+                break;
+            case Ctx::Node:
+                if (!is_string) {
+                    break;
+                }
+                if (m_key == "id") {
+                    m_doc.node_id[top.node] = std::move(*text);
+                } else if (m_key == "name") {
+                    m_doc.node_name[top.node] = std::move(*text);
+                } else if (m_key == "type") {
+                    m_doc.node_type[top.node] = std::move(*text);
+                }
+                break;
+            case Ctx::Component:
+                if (m_key == "id" && is_string) {
+                    m_component.id = std::move(*text);
+                } else if (m_key == "script" && is_string) {
+                    m_component.script = std::move(*text);
+                } else if (m_key == "enabled" && kind == SceneProperty::Kind::Bool) {
+                    m_component.enabled = boolean;
+                }
+                break;
+            case Ctx::Visual:
+                if (m_key == "visible" && kind == SceneProperty::Kind::Bool) {
+                    m_visual.visible = boolean;
+                } else if (m_key == "glyph" && is_string) {
+                    m_visual.glyph = decode_glyph(*text);
+                } else if (m_key == "opacity" && kind == SceneProperty::Kind::Number) {
+                    m_visual.opacity = static_cast<float>(number);
+                } else if (m_key == "emissionPower" && kind == SceneProperty::Kind::Number) {
+                    m_visual.emission_power = static_cast<float>(number);
+                }
+                break;
+            case Ctx::Properties:
+            case Ctx::Meta: {
+                SceneProperty property;
+                property.key = m_key;
+                property.kind = kind;
+                property.boolean = boolean;
+                property.number = number;
+                if (is_string) {
+                    property.text = std::move(*text);
+                }
+                auto& target = top.ctx == Ctx::Properties ? m_component.properties : m_doc.meta[top.node];
+                target.push_back(std::move(property));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void finish_numbers(const Frame& frame) {
+        if (m_stack.empty()) {
+            return;
+        }
+        const Frame& owner = m_stack.back();
+
+        glm::vec3 v(0.0f);
+        for (size_t i = 0; i < 3 && i < m_numbers.size(); i++) {
+            v[static_cast<int>(i)] = static_cast<float>(m_numbers[i]);
+        }
+
+        switch (owner.ctx) {
+            case Ctx::Transform:
+                if (frame.key == "position") {
+                    m_doc.position[owner.node] = v;
+                } else if (frame.key == "rotation") {
+                    m_doc.rotation[owner.node] = v;
+                } else if (frame.key == "scale") {
+                    m_doc.scale[owner.node] = v;
+                }
+                break;
+            case Ctx::Visual:
+                if (frame.key == "color") {
+                    m_visual.color = v;
+                } else if (frame.key == "emission") {
+                    m_visual.emission = v;
+                }
+                break;
+            case Ctx::Properties:
+            case Ctx::Meta: {
+                SceneProperty property;
+                property.key = frame.key;
+                property.kind = SceneProperty::Kind::Array;
+                property.array = m_numbers;
+                auto& target = owner.ctx == Ctx::Properties ? m_component.properties : m_doc.meta[owner.node];
+                target.push_back(std::move(property));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    template<typename T>
+    T& begin_typed(std::vector<T>& list) {
+        T& component = list.emplace_back();
+        component.node = m_component.node;
+        component.id = std::move(m_component.id);
+        component.enabled = m_component.enabled;
+        return component;
+    }
+
+    void finish_component() {
+        const auto& props = m_component.properties;
+        const std::string& script = m_component.script;
+
+        if (script == "Glyph") {
+            auto& c = begin_typed(m_doc.glyphs);
+            c.glyph = decode_glyph(string_property(props, "char", ""));
+            c.fg = string_property(props, "fg", c.fg);
+            c.bg = string_property(props, "bg", c.bg);
+            c.bold = bool_property(props, "bold", c.bold);
+        } else if (script == "Ascii") {
+            auto& c = begin_typed(m_doc.ascii);
+            c.art = string_property(props, "art", "");
+            c.width = static_cast<int>(number_property(props, "width", 0));
+            c.height = static_cast<int>(number_property(props, "height", 0));
+            c.palette = string_property(props, "palette", "");
+            c.brightness = static_cast<float>(number_property(props, "brightness", c.brightness));
+            c.transparent_bg = bool_property(props, "transparentBg", c.transparent_bg);
+            c.animate = bool_property(props, "animate", c.animate);
+            c.animation_speed = static_cast<float>(number_property(props, "animationSpeed", c.animation_speed));
+            c.animation_type = string_property(props, "animationType", "");
+        } else if (script == "Terrain") {
+            auto& c = begin_typed(m_doc.terrain);
+            c.width = static_cast<int>(number_property(props, "width", 0));
+            c.height = static_cast<int>(number_property(props, "height", 0));
+            c.fill_glyph = decode_glyph(string_property(props, "fillChar", "."));
+            c.palette = string_property(props, "palette", "");
+        } else if (script == "Light") {
+            auto& c = begin_typed(m_doc.lights);
+            c.color = vec3_property(props, "color", c.color);
+            c.intensity = static_cast<float>(number_property(props, "intensity", c.intensity));
+            c.radius = static_cast<float>(number_property(props, "radius", c.radius));
+            c.falloff = static_cast<float>(number_property(props, "falloff", c.falloff));
+        } else if (script == "Collider") {
+            auto& c = begin_typed(m_doc.colliders);
+            c.blocks_movement = bool_property(props, "blocksMovement", c.blocks_movement);
+            c.blocks_vision = bool_property(props, "blocksVision", c.blocks_vision);
+            c.layer = string_property(props, "layer", "");
+        } else if (script == "Camera") {
+            auto& c = begin_typed(m_doc.cameras);
+            c.priority = static_cast<int>(number_property(props, "priority", 0));
+            c.active = bool_property(props, "active", c.active);
+            c.zoom = static_cast<float>(number_property(props, "zoom", c.zoom));
+            c.damping = glm::vec2(static_cast<float>(number_property(props, "dampingX", 0.0)),
+                                  static_cast<float>(number_property(props, "dampingY", 0.0)));
+            c.binding_mode = string_property(props, "bindingMode", "");
+        } else {
+            auto& c = begin_typed(m_doc.other);
+            c.script = std::move(m_component.script);
+            c.properties = std::move(m_component.properties);
+        }
+    }
+
+    SceneDocument& m_doc;
+    std::vector<Frame> m_stack;
+    std::string m_key;
+    std::vector<double> m_numbers;
+    PendingComponent m_component;
+    VisualComponent m_visual;
+};
+
+using ordered_json = nlohmann::ordered_json;
+
+// Whole numbers are written without a fraction, like the editor does
+ordered_json number_json(double value) {
+    if (value == std::floor(value) && std::abs(value) < 1e15) {
+        return static_cast<int64_t>(value);
+    }
+    return value;
+}
+
+ordered_json vec3_json(const glm::vec3& v) {
+    return ordered_json::array({number_json(v.x), number_json(v.y), number_json(v.z)});
+}
+
+ordered_json properties_json(const std::vector<SceneProperty>& properties) {
+    ordered_json out = ordered_json::object();
+    for (const auto& p : properties) {
+        switch (p.kind) {
+            case SceneProperty::Kind::Null: out[p.key] = nullptr; break;
+            case SceneProperty::Kind::Bool: out[p.key] = p.boolean; break;
+            case SceneProperty::Kind::Number: out[p.key] = number_json(p.number); break;
+            case SceneProperty::Kind::String: out[p.key] = p.text; break;
+            case SceneProperty::Kind::Array: {
+                ordered_json array = ordered_json::array();
+                for (double value : p.array) {
+                    array.push_back(number_json(value));
+                }
+                out[p.key] = std::move(array);
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+ordered_json component_json(const SceneComponentBase& c, const char* script, ordered_json properties) {
+    ordered_json out;
+    out["id"] = c.id;
+    out["script"] = script;
+    out["enabled"] = c.enabled;
+    out["properties"] = std::move(properties);
+    return out;
+}
+
+} // anonymous namespace
+
+std::string scene_to_json(const SceneDocument& doc) {
+    const size_t count = doc.node_count();
+    if (count == 0) {
+        throw std::runtime_error("Scene has no nodes");
+    }
+
+    std::vector<ordered_json> components(count, ordered_json::array());
+    for (const auto& c : doc.glyphs) {
+        components[c.node].push_back(component_json(c, "Glyph", {
+            {"char", encode_glyph(c.glyph)}, {"fg", c.fg}, {"bg", c.bg}, {"bold", c.bold}}));
+    }
+    for (const auto& c : doc.ascii) {
+        components[c.node].push_back(component_json(c, "Ascii", {
+            {"art", c.art}, {"width", c.width}, {"height", c.height}, {"palette", c.palette},
+            {"brightness", c.brightness}, {"transparentBg", c.transparent_bg}, {"animate", c.animate},
+            {"animationSpeed", c.animation_speed}, {"animationType", c.animation_type}}));
+    }
+    for (const auto& c : doc.terrain) {
+        components[c.node].push_back(component_json(c, "Terrain", {
+            {"width", c.width}, {"height", c.height}, {"fillChar", encode_glyph(c.fill_glyph)},
+            {"palette", c.palette}}));
+    }
+    for (const auto& c : doc.lights) {
+        components[c.node].push_back(component_json(c, "Light", {
+            {"color", vec3_json(c.color)}, {"intensity", c.intensity}, {"radius", c.radius},
+            {"falloff", c.falloff}}));
+    }
+    for (const auto& c : doc.colliders) {
+        components[c.node].push_back(component_json(c, "Collider", {
+            {"blocksMovement", c.blocks_movement}, {"blocksVision", c.blocks_vision}, {"layer", c.layer}}));
+    }
+    for (const auto& c : doc.cameras) {
+        components[c.node].push_back(component_json(c, "Camera", {
+            {"priority", c.priority}, {"active", c.active}, {"zoom", c.zoom},
+            {"dampingX", c.damping.x}, {"dampingY", c.damping.y}, {"bindingMode", c.binding_mode}}));
+    }
+    for (const auto& c : doc.other) {
+        components[c.node].push_back(component_json(c, c.script.c_str(), properties_json(c.properties)));
+    }
+
+    std::vector<ordered_json> nodes(count);
+    std::vector<std::vector<int32_t>> children(count);
+    for (size_t i = 0; i < count; i++) {
+        ordered_json& node = nodes[i];
+        node["id"] = doc.node_id[i];
+        node["name"] = doc.node_name[i];
+        node["type"] = doc.node_type[i];
+        node["children"] = ordered_json::array();
+        node["components"] = std::move(components[i]);
+        node["transform"] = {
+            {"position", vec3_json(doc.position[i])},
+            {"rotation", vec3_json(doc.rotation[i])},
+            {"scale", vec3_json(doc.scale[i])}};
+        node["meta"] = properties_json(doc.meta[i]);
+        if (doc.parent[i] >= 0) {
+            children[doc.parent[i]].push_back(static_cast<int32_t>(i));
+        }
+    }
+    for (const auto& visual : doc.visuals) {
+        nodes[visual.node]["visual"] = {
+            {"visible", visual.visible}, {"glyph", encode_glyph(visual.glyph)},
+            {"color", vec3_json(visual.color)}, {"opacity", visual.opacity},
+            {"emission", vec3_json(visual.emission)}, {"emissionPower", visual.emission_power}};
+    }
+
+    // Children always follow their parent, so walking backwards finishes
+    // every subtree before it is moved into its parent
+    for (size_t i = count; i-- > 0;) {
+        for (int32_t child : children[i]) {
+            nodes[i]["children"].push_back(std::move(nodes[child]));
+        }
+    }
+
+    ordered_json root;
+    root["version"] = doc.version.empty() ? "1.0.0" : doc.version;
+    root["rootNode"] = std::move(nodes[0]);
+    return root.dump(2);
+}
+
+void save_scene_json(const std::string& path, const SceneDocument& doc) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file for writing: " + path);
+    }
+    file << scene_to_json(doc) << '\n';
+    if (!file) {
+        throw std::runtime_error("Failed to write scene file: " + path);
+    }
+}
+
+SceneDocument parse_scene_json(std::string_view text) {
+    SceneDocument doc;
+    SceneSaxHandler handler(doc);
+    json::sax_parse(text.begin(), text.end(), &handler);
+    if (doc.node_count() == 0) {
+        throw std::runtime_error("scene.json has no rootNode");
+    }
+    return doc;
+}
+
+SceneDocument load_scene_json(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file: " + path);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return parse_scene_json(contents.str());
+}
+
+} // namespace ascii
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <string>
+#include <string_view>
+
+namespace ascii {
+
+// Parse scene.json with a streaming SAX handler: nodes and components go
+// straight into the document's arrays without building a JSON DOM first.
+// Throws std::runtime_error on malformed input.
+SceneDocument parse_scene_json(std::string_view text);
+SceneDocument load_scene_json(const std::string& path);
+
+// Write a document back out in the editor's scene.json schema. Each node's
+// components come out grouped by type; unknown components and meta keep
+// their properties.
+std::string scene_to_json(const SceneDocument& doc);
+void save_scene_json(const std::string& path, const SceneDocument& doc);
+
+} // namespace ascii
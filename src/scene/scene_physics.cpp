@@ -0,0 +1,85 @@
+#include "scene_physics.hpp"
+#include "scene_world.hpp"
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ascii {
+
+namespace {
+
+const glm::vec2 BODY_SIZE(1.0f);       // A collider covers its node's tile
+
+glm::vec2 map_position(const WorldTransform& transform) {
+    return {transform.position.x, transform.position.z};
+}
+
+} // anonymous namespace
+
+void ScenePhysics::sync(World& world, const Tilemap& tilemap) {
+    if (!m_built || m_version != world.structure_version()) {
+        rebuild(world);
+    }
+    // Moving an existing body leaves the body list as it is
+    for (size_t i = 0; i < m_physics.bodies().size(); i++) {
+        const PhysicsWorld::Body& body = m_physics.bodies()[i];
+        const WorldTransform* transform = world.get<const WorldTransform>(Entity::from_bits(body.id));
+        if (transform && map_position(*transform) != body.position) {
+            m_physics.set_body(body.id, map_position(*transform), body.size);
+        }
+    }
+    m_physics.sync(tilemap);
+}
+
+void ScenePhysics::rebuild(World& world) {
+    std::vector<uint64_t> keep;
+    world.each<const WorldTransform, const ColliderComponent>([&](Entity entity, const WorldTransform& transform,
+                                                                  const ColliderComponent& collider) {
+        if (collider.enabled && collider.blocks_movement) {
+            m_physics.set_body(entity.bits(), map_position(transform), BODY_SIZE);
+            keep.push_back(entity.bits());
+        }
+    });
+    std::sort(keep.begin(), keep.end());
+    std::vector<uint64_t> gone;
+    for (const PhysicsWorld::Body& body : m_physics.bodies()) {
+        if (!std::binary_search(keep.begin(), keep.end(), body.id)) {
+            gone.push_back(body.id);
+        }
+    }
+    for (uint64_t id : gone) {
+        m_physics.remove_body(id);
+    }
+    m_version = world.structure_version();
+    m_built = true;
+}
+
+int ScenePhysics::step(World& world, TransformHierarchy& transforms, const Tilemap& tilemap, float dt) {
+    sync(world, tilemap);
+    std::vector<glm::vec2> before;
+    before.reserve(m_physics.bodies().size());
+    for (const PhysicsWorld::Body& body : m_physics.bodies()) {
+        before.push_back(body.position);
+    }
+    const int steps = m_physics.step(dt);
+    if (steps == 0) {
+        return 0;
+    }
+    const std::vector<PhysicsWorld::Body>& after = m_physics.bodies();
+    for (size_t i = 0; i < after.size(); i++) {
+        const glm::vec2 delta = after[i].position - before[i];
+        if (delta == glm::vec2(0.0f)) {
+            continue;
+        }
+        const Entity entity = Entity::from_bits(after[i].id);
+        if (LocalTransform* local = world.get<LocalTransform>(entity)) {
+            local->position.x += delta.x;
+            local->position.y += delta.y;
+            transforms.mark_dirty(world, entity);
+        }
+    }
+    return steps;
+}
+
+} // namespace ascii
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ecs/world.hpp"
+#include "world/physics.hpp"
+
+#include <cstdint>
+
+namespace ascii {
+
+class Tilemap;
+class TransformHierarchy;
+
+// PhysicsWorld bodies for the scene's enabled, movement-blocking Collider
+// components: one tile-sized box at each entity's map position, keyed by
+// entity handle bits. Scripts give bodies velocities; step() writes where
+// they ended up back into LocalTransform (as a delta, so parents are
+// assumed unrotated and unscaled) and marks them dirty.
+class ScenePhysics {
+public:
+    explicit ScenePhysics(float solid_height = 0.5f) : m_physics(solid_height) {}
+
+    PhysicsWorld& physics() { return m_physics; }
+    const PhysicsWorld& physics() const { return m_physics; }
+
+    // Re-collect bodies after a structural change (velocities of surviving
+    // ones are kept) and place every body at its entity's WorldTransform,
+    // so edits from scripts and IPC win; then pull solid tiles
+    void sync(World& world, const Tilemap& tilemap);
+
+    // sync() then PhysicsWorld::step(); returns the substeps run
+    int step(World& world, TransformHierarchy& transforms, const Tilemap& tilemap, float dt);
+
+private:
+    void rebuild(World& world);
+
+    PhysicsWorld m_physics;
+    bool m_built = false;
+    uint64_t m_version = 0;
+};
+
+} // namespace ascii
@@ -0,0 +1,110 @@
+#include "scene_proximity.hpp"
+#include "scene_index.hpp"
+#include "scene_world.hpp"
+
+#include <algorithm>
+
+namespace ascii {
+
+namespace {
+
+// Engine world space (y-up) -> scene map plane
+glm::vec2 map_position(const WorldTransform& transform) {
+    return {transform.position.x, transform.position.z};
+}
+
+float interaction_range(const GenericComponent& component) {
+    for (const SceneProperty& property : component.properties) {
+        if (property.key == "interactionRange" && property.kind == SceneProperty::Kind::Number) {
+            return std::max(static_cast<float>(property.number), 0.0f);
+        }
+    }
+    return SceneProximity::DEFAULT_INTERACTION_RANGE;
+}
+
+} // anonymous namespace
+
+void SceneProximity::sync(World& world, const SceneIndex& index) {
+    if (!m_built || m_version != world.structure_version()) {
+        rebuild(world, index);
+        return;
+    }
+    for (Tracked& tracked : m_tracked) {
+        const WorldTransform* transform = world.get<const WorldTransform>(tracked.source);
+        if (!transform) {
+            continue;
+        }
+        const glm::vec2 position = map_position(*transform);
+        if (position != tracked.position) {
+            tracked.position = position;
+            m_hash.move(tracked.entity.bits(), position);
+        }
+    }
+}
+
+void SceneProximity::rebuild(World& world, const SceneIndex& index) {
+    m_hash.clear();
+    m_tracked.clear();
+    m_tracked_of.clear();
+    m_max_range = 0.0f;
+
+    auto track = [&](Entity entity, Entity source, uint32_t tag, float range) {
+        auto [it, added] = m_tracked_of.try_emplace(entity.bits(), static_cast<uint32_t>(m_tracked.size()));
+        if (added) {
+            m_tracked.push_back({entity, source});
+        }
+        Tracked& tracked = m_tracked[it->second];
+        tracked.tags |= tag;
+        tracked.range = std::max(tracked.range, range);
+    };
+
+    world.each<const ColliderComponent>([&](Entity entity, const ColliderComponent& collider) {
+        if (collider.enabled) {
+            track(entity, entity, COLLIDER, 0.0f);
+        }
+    });
+
+    world.each<const GenericComponent>([&](Entity entity, const GenericComponent& component) {
+        if (!component.enabled || component.script != "Interactable") {
+            return;
+        }
+        // Extra component entities stand for their node
+        Entity owner = entity;
+        const SceneNode* node = world.get<const SceneNode>(entity);
+        const Parent* parent = world.get<const Parent>(entity);
+        if (node && parent && world.alive(parent->entity) && index.str(node->type) == "Component") {
+            owner = parent->entity;
+        }
+        const float range = interaction_range(component);
+        track(owner, entity, INTERACTABLE, range);
+        m_max_range = std::max(m_max_range, range);
+    });
+
+    for (Tracked& tracked : m_tracked) {
+        if (const WorldTransform* transform = world.get<const WorldTransform>(tracked.source)) {
+            tracked.position = map_position(*transform);
+        }
+        m_hash.insert(tracked.entity.bits(), tracked.position, tracked.tags);
+    }
+    m_version = world.structure_version();
+    m_built = true;
+}
+
+void SceneProximity::interactables_at(glm::vec2 point, std::vector<SpatialHash::Hit>& out) const {
+    out.clear();
+    std::vector<uint64_t> ids;
+    m_hash.query_radius(point, m_max_range, ids, INTERACTABLE);
+    for (uint64_t id : ids) {
+        const Tracked& tracked = m_tracked[m_tracked_of.at(id)];
+        const glm::vec2 d = tracked.position - point;
+        const float distance_sq = glm::dot(d, d);
+        if (distance_sq <= tracked.range * tracked.range) {
+            out.push_back({id, distance_sq});
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const SpatialHash::Hit& a, const SpatialHash::Hit& b) {
+        return a.distance_sq < b.distance_sq || (a.distance_sq == b.distance_sq && a.id < b.id);
+    });
+}
+
+} // namespace ascii
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ecs/world.hpp"
+#include "world/spatial_hash.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class SceneIndex;
+
+// Scene entities scripts ask "what is near" about, in a SpatialHash on the
+// scene map plane (x, y). Entities with an enabled Collider are tagged
+// COLLIDER; those with an enabled Interactable component INTERACTABLE,
+// keeping its interactionRange. An Interactable on an extra component
+// entity counts for its node. Ids are entity handle bits.
+class SceneProximity {
+public:
+    static constexpr uint32_t COLLIDER = 1;
+    static constexpr uint32_t INTERACTABLE = 2;
+    static constexpr float DEFAULT_INTERACTION_RANGE = 1.5f;
+
+    explicit SceneProximity(float cell_size = 8.0f) : m_hash(cell_size) {}
+
+    // Re-collect the entities after a structural change, otherwise move
+    // them to their current WorldTransform (call after transform updates)
+    void sync(World& world, const SceneIndex& index);
+
+    const SpatialHash& hash() const { return m_hash; }
+    size_t size() const { return m_tracked.size(); }
+
+    // Interactables whose own range reaches the point, nearest first
+    void interactables_at(glm::vec2 point, std::vector<SpatialHash::Hit>& out) const;
+
+private:
+    struct Tracked {
+        Entity entity;                 // Reported one (the node)
+        Entity source;                 // Whose WorldTransform places it
+        uint32_t tags = 0;
+        float range = 0.0f;
+        glm::vec2 position{0.0f};
+    };
+
+    void rebuild(World& world, const SceneIndex& index);
+
+    SpatialHash m_hash;
+    bool m_built = false;
+    uint64_t m_version = 0;
+    std::vector<Tracked> m_tracked;
+    std::unordered_map<uint64_t, uint32_t> m_tracked_of;   // Entity bits -> m_tracked
+    float m_max_range = 0.0f;
+};
+
+} // namespace ascii
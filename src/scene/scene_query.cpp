@@ -0,0 +1,452 @@
+#include "scene_query.hpp"
+#include "scene_world.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace ascii {
+
+namespace {
+
+QueryValue to_value(bool value) { return QueryValue::of(value); }
+QueryValue to_value(int value) { return QueryValue::of(static_cast<double>(value)); }
+QueryValue to_value(float value) { return QueryValue::of(static_cast<double>(value)); }
+QueryValue to_value(const std::string& value) { return QueryValue::of(value); }
+
+template<typename T, auto Member>
+QueryValue read_member(const World& world, Entity entity) {
+    const T* component = world.get<T>(entity);
+    return component ? to_value(component->*Member) : QueryValue{};
+}
+
+template<typename T, auto Member>
+QueryValue read_glyph(const World& world, Entity entity) {
+    const T* component = world.get<T>(entity);
+    return component ? QueryValue::of(encode_glyph(component->*Member)) : QueryValue{};
+}
+
+// Fields of the typed components, under their scene.json property names
+struct TypedField {
+    const char* component;
+    const char* field;
+    QueryValue (*read)(const World&, Entity);
+};
+
+const TypedField TYPED_FIELDS[] = {
+    {"Glyph",    "enabled",        read_member<GlyphComponent, &GlyphComponent::enabled>},
+    {"Glyph",    "char",           read_glyph<GlyphComponent, &GlyphComponent::glyph>},
+    {"Glyph",    "fg",             read_member<GlyphComponent, &GlyphComponent::fg>},
+    {"Glyph",    "bg",             read_member<GlyphComponent, &GlyphComponent::bg>},
+    {"Glyph",    "bold",           read_member<GlyphComponent, &GlyphComponent::bold>},
+    {"Ascii",    "enabled",        read_member<AsciiComponent, &AsciiComponent::enabled>},
+    {"Ascii",    "width",          read_member<AsciiComponent, &AsciiComponent::width>},
+    {"Ascii",    "height",         read_member<AsciiComponent, &AsciiComponent::height>},
+    {"Ascii",    "palette",        read_member<AsciiComponent, &AsciiComponent::palette>},
+    {"Ascii",    "brightness",     read_member<AsciiComponent, &AsciiComponent::brightness>},
+    {"Ascii",    "animate",        read_member<AsciiComponent, &AsciiComponent::animate>},
+    {"Terrain",  "enabled",        read_member<TerrainComponent, &TerrainComponent::enabled>},
+    {"Terrain",  "width",          read_member<TerrainComponent, &TerrainComponent::width>},
+    {"Terrain",  "height",         read_member<TerrainComponent, &TerrainComponent::height>},
+    {"Terrain",  "fillChar",       read_glyph<TerrainComponent, &TerrainComponent::fill_glyph>},
+    {"Terrain",  "palette",        read_member<TerrainComponent, &TerrainComponent::palette>},
+    {"Light",    "enabled",        read_member<LightComponent, &LightComponent::enabled>},
+    {"Light",    "intensity",      read_member<LightComponent, &LightComponent::intensity>},
+    {"Light",    "radius",         read_member<LightComponent, &LightComponent::radius>},
+    {"Light",    "falloff",        read_member<LightComponent, &LightComponent::falloff>},
+    {"Collider", "enabled",        read_member<ColliderComponent, &ColliderComponent::enabled>},
+    {"Collider", "blocksMovement", read_member<ColliderComponent, &ColliderComponent::blocks_movement>},
+    {"Collider", "blocksVision",   read_member<ColliderComponent, &ColliderComponent::blocks_vision>},
+    {"Collider", "layer",          read_member<ColliderComponent, &ColliderComponent::layer>},
+    {"Camera",   "enabled",        read_member<CameraComponent, &CameraComponent::enabled>},
+    {"Camera",   "priority",       read_member<CameraComponent, &CameraComponent::priority>},
+    {"Camera",   "active",         read_member<CameraComponent, &CameraComponent::active>},
+    {"Camera",   "zoom",           read_member<CameraComponent, &CameraComponent::zoom>},
+    {"Visual",   "visible",        read_member<VisualComponent, &VisualComponent::visible>},
+    {"Visual",   "char",           read_glyph<VisualComponent, &VisualComponent::glyph>},
+    {"Visual",   "opacity",        read_member<VisualComponent, &VisualComponent::opacity>},
+};
+
+// Component names with their own ECS component; the rest are GenericComponent scripts
+const char* const TYPED_COMPONENTS[] = {"Node", "Sprite", "Glyph", "Ascii", "Terrain", "Light", "Collider",
+                                        "Camera", "Visual"};
+
+bool is_typed(std::string_view component) {
+    return std::find(std::begin(TYPED_COMPONENTS), std::end(TYPED_COMPONENTS), component) !=
+           std::end(TYPED_COMPONENTS);
+}
+
+// "Component.field", resolved once per query
+struct FieldRef {
+    std::string_view component;
+    std::string_view key;
+    const TypedField* typed = nullptr;
+};
+
+FieldRef resolve_field(std::string_view field) {
+    const size_t dot = field.find('.');
+    if (dot == std::string_view::npos || dot == 0 || dot + 1 == field.size()) {
+        throw std::runtime_error("Field must be Component.field: " + std::string(field));
+    }
+    FieldRef ref{field.substr(0, dot), field.substr(dot + 1)};
+    for (const TypedField& typed : TYPED_FIELDS) {
+        if (ref.component == typed.component && ref.key == typed.field) {
+            ref.typed = &typed;
+            break;
+        }
+    }
+    return ref;
+}
+
+QueryValue read_field(const World& world, const SceneIndex& index, Entity entity, const FieldRef& ref) {
+    if (ref.typed) {
+        return ref.typed->read(world, entity);
+    }
+    if (ref.component == "Node") {
+        const SceneNode* node = world.get<SceneNode>(entity);
+        if (!node) {
+            return {};
+        }
+        if (ref.key == "id") return QueryValue::of(std::string(index.str(node->id)));
+        if (ref.key == "name") return QueryValue::of(std::string(index.str(node->name)));
+        if (ref.key == "type") return QueryValue::of(std::string(index.str(node->type)));
+        return {};
+    }
+    const GenericComponent* component = world.get<GenericComponent>(entity);
+    if (!component || component->script != ref.component) {
+        return {};
+    }
+    if (ref.key == "enabled") {
+        return QueryValue::of(component->enabled);
+    }
+    for (const SceneProperty& property : component->properties) {
+        if (property.key != ref.key) {
+            continue;
+        }
+        switch (property.kind) {
+            case SceneProperty::Kind::Bool: return QueryValue::of(property.boolean);
+            case SceneProperty::Kind::Number: return QueryValue::of(property.number);
+            case SceneProperty::Kind::String: return QueryValue::of(property.text);
+            default: return {};
+        }
+    }
+    return {};
+}
+
+bool numeric(const QueryValue& value) {
+    return value.kind == QueryValue::Kind::Number || value.kind == QueryValue::Kind::Bool;
+}
+
+// Null never matches; a number and a string only differ
+bool matches(const QueryValue& value, QueryOp op, const QueryValue& operand) {
+    if (value.kind == QueryValue::Kind::Null || operand.kind == QueryValue::Kind::Null) {
+        return false;
+    }
+    if (numeric(value) != numeric(operand)) {
+        return op == QueryOp::Ne;
+    }
+    int order;
+    if (numeric(value)) {
+        order = value.number < operand.number ? -1 : value.number > operand.number ? 1 : 0;
+    } else {
+        order = value.text.compare(operand.text);
+    }
+    switch (op) {
+        case QueryOp::Eq: return order == 0;
+        case QueryOp::Ne: return order != 0;
+        case QueryOp::Lt: return order < 0;
+        case QueryOp::Le: return order <= 0;
+        case QueryOp::Gt: return order > 0;
+        case QueryOp::Ge: return order >= 0;
+    }
+    return false;
+}
+
+// Hash index key: kind tag plus the value bytes (numbers by bit pattern)
+std::string value_key(const QueryValue& value) {
+    if (numeric(value)) {
+        const double number = value.number == 0.0 ? 0.0 : value.number;    // -0 == 0
+        std::string key(1 + sizeof(double), 'n');
+        std::memcpy(key.data() + 1, &number, sizeof(double));
+        return key;
+    }
+    return "s" + value.text;
+}
+
+// fn(row, const T&) for every entity holding T
+template<typename T, typename Fn>
+void each_row(World& world, const std::vector<uint32_t>& row_of, Fn&& fn) {
+    world.each<const T>([&](Entity entity, const T& component) { fn(row_of[entity.index], component); });
+}
+
+// Membership bits of the entities holding T
+template<typename T, typename Bits>
+void collect(World& world, const std::vector<uint32_t>& row_of, Bits& bits) {
+    each_row<T>(world, row_of, [&](uint32_t row, const T&) { bits.set(row); });
+}
+
+} // anonymous namespace
+
+QueryOp parse_query_op(std::string_view text) {
+    if (text == "==" || text == "=") return QueryOp::Eq;
+    if (text == "!=") return QueryOp::Ne;
+    if (text == "<") return QueryOp::Lt;
+    if (text == "<=") return QueryOp::Le;
+    if (text == ">") return QueryOp::Gt;
+    if (text == ">=") return QueryOp::Ge;
+    throw std::runtime_error("Unknown query operator: " + std::string(text));
+}
+
+void SceneQuery::declare_index(std::string_view field, IndexKind kind) {
+    resolve_field(field);
+    for (FieldIndex& existing : m_indexes) {
+        if (existing.field == field) {
+            existing.kind = kind;
+            m_built = false;
+            return;
+        }
+    }
+    FieldIndex& added = m_indexes.emplace_back();
+    added.field = field;
+    added.kind = kind;
+    m_built = false;
+}
+
+void SceneQuery::rebuild(World& world, const SceneIndex& index) {
+    const size_t rows = world.size();
+    m_rows.resize(rows);
+    std::vector<uint32_t> row_of;
+    for (size_t row = 0; row < rows; row++) {
+        const Entity entity = world.entity_at(row);
+        m_rows[row] = entity;
+        if (entity.index >= row_of.size()) {
+            row_of.resize(entity.index + 1);
+        }
+        row_of[entity.index] = static_cast<uint32_t>(row);
+    }
+
+    m_members.clear();
+    auto members = [&](const char* name) -> Bitset& {
+        Bitset& bits = m_members[name];
+        bits.resize(rows);
+        return bits;
+    };
+    collect<SceneNode>(world, row_of, members("Node"));
+    collect<GlyphSprite>(world, row_of, members("Sprite"));
+    collect<GlyphComponent>(world, row_of, members("Glyph"));
+    collect<AsciiComponent>(world, row_of, members("Ascii"));
+    collect<TerrainComponent>(world, row_of, members("Terrain"));
+    collect<LightComponent>(world, row_of, members("Light"));
+    collect<ColliderComponent>(world, row_of, members("Collider"));
+    collect<CameraComponent>(world, row_of, members("Camera"));
+    collect<VisualComponent>(world, row_of, members("Visual"));
+    each_row<GenericComponent>(world, row_of, [&](uint32_t row, const GenericComponent& component) {
+        if (is_typed(component.script)) {
+            return;     // Would shadow the typed component of that name
+        }
+        auto [it, inserted] = m_members.try_emplace(component.script);
+        if (inserted) {
+            it->second.resize(rows);
+        }
+        it->second.set(row);
+    });
+
+    for (FieldIndex& field_index : m_indexes) {
+        build_index(field_index, world, index);
+    }
+    m_built = true;
+    m_version = world.structure_version();
+}
+
+void SceneQuery::build_index(FieldIndex& field_index, const World& world, const SceneIndex& index) {
+    field_index.numbers.clear();
+    field_index.strings.clear();
+    field_index.buckets.clear();
+    const FieldRef ref = resolve_field(field_index.field);
+    const Bitset* members = membership(ref.component);
+    if (!members) {
+        return;
+    }
+    for (size_t w = 0; w < members->words.size(); w++) {
+        for (uint64_t bits = members->words[w]; bits; bits &= bits - 1) {
+            const uint32_t row = static_cast<uint32_t>(w * 64 + std::countr_zero(bits));
+            QueryValue value = read_field(world, index, m_rows[row], ref);
+            if (value.kind == QueryValue::Kind::Null) {
+                continue;
+            }
+            if (field_index.kind == IndexKind::Hash) {
+                field_index.buckets[value_key(value)].push_back(row);
+            } else if (numeric(value)) {
+                field_index.numbers.emplace_back(value.number, row);
+            } else {
+                field_index.strings.emplace_back(std::move(value.text), row);
+            }
+        }
+    }
+    std::sort(field_index.numbers.begin(), field_index.numbers.end());
+    std::sort(field_index.strings.begin(), field_index.strings.end());
+}
+
+const SceneQuery::Bitset* SceneQuery::membership(std::string_view component) const {
+    auto it = m_members.find(std::string(component));
+    return it == m_members.end() ? nullptr : &it->second;
+}
+
+// Sorted indexes answer everything but !=; hash indexes answer ==
+const SceneQuery::FieldIndex* SceneQuery::find_index(std::string_view field, QueryOp op) const {
+    for (const FieldIndex& field_index : m_indexes) {
+        if (field_index.field == field) {
+            const bool usable = field_index.kind == IndexKind::Hash ? op == QueryOp::Eq : op != QueryOp::Ne;
+            return usable ? &field_index : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void SceneQuery::index_rows(const FieldIndex& field_index, const QueryPredicate& predicate, Bitset& out) const {
+    const QueryValue& operand = predicate.value;
+    if (operand.kind == QueryValue::Kind::Null) {
+        return;
+    }
+    if (field_index.kind == IndexKind::Hash) {
+        auto it = field_index.buckets.find(value_key(operand));
+        if (it != field_index.buckets.end()) {
+            for (uint32_t row : it->second) {
+                out.set(row);
+            }
+        }
+        return;
+    }
+
+    // Sorted: the matching values are one contiguous range
+    auto select = [&](const auto& list, const auto& key) {
+        auto lower = std::lower_bound(list.begin(), list.end(), key,
+                                      [](const auto& entry, const auto& k) { return entry.first < k; });
+        auto upper = std::upper_bound(list.begin(), list.end(), key,
+                                      [](const auto& k, const auto& entry) { return k < entry.first; });
+        auto first = list.begin();
+        auto last = list.end();
+        switch (predicate.op) {
+            case QueryOp::Eq: first = lower; last = upper; break;
+            case QueryOp::Lt: last = lower; break;
+            case QueryOp::Le: last = upper; break;
+            case QueryOp::Gt: first = upper; break;
+            case QueryOp::Ge: first = lower; break;
+            case QueryOp::Ne: break;
+        }
+        for (auto it = first; it != last; ++it) {
+            out.set(it->second);
+        }
+    };
+    if (numeric(operand)) {
+        select(field_index.numbers, operand.number);
+    } else {
+        select(field_index.strings, operand.text);
+    }
+}
+
+std::vector<Entity> SceneQuery::run(World& world, const SceneIndex& index, const SceneQueryFilter& filter) {
+    if (stale(world)) {
+        rebuild(world, index);
+    }
+    std::vector<Entity> out;
+
+    // Required components: explicit ones plus those the predicates read
+    std::vector<FieldRef> refs;
+    refs.reserve(filter.where.size());
+    for (const QueryPredicate& predicate : filter.where) {
+        refs.push_back(resolve_field(predicate.field));
+    }
+    std::vector<const Bitset*> required;
+    auto require = [&](std::string_view component) {
+        const Bitset* bits = membership(component);
+        required.push_back(bits);
+        return bits != nullptr;
+    };
+    if (filter.with.empty() && !require("Node")) {
+        return out;
+    }
+    for (const std::string& component : filter.with) {
+        if (!require(component)) {
+            return out;
+        }
+    }
+    for (const FieldRef& ref : refs) {
+        if (!require(ref.component)) {
+            return out;
+        }
+    }
+    std::sort(required.begin(), required.end(), [](const Bitset* a, const Bitset* b) { return a->count < b->count; });
+
+    std::vector<uint64_t> candidates = required[0]->words;
+    for (size_t i = 1; i < required.size(); i++) {
+        for (size_t w = 0; w < candidates.size(); w++) {
+            candidates[w] &= required[i]->words[w];
+        }
+    }
+    for (const std::string& component : filter.without) {
+        if (const Bitset* bits = membership(component)) {
+            for (size_t w = 0; w < candidates.size(); w++) {
+                candidates[w] &= ~bits->words[w];
+            }
+        }
+    }
+
+    // Indexed predicates narrow the set word-wide; the rest run per candidate
+    std::vector<size_t> scanned;
+    Bitset hits;
+    for (size_t p = 0; p < filter.where.size(); p++) {
+        const FieldIndex* field_index = find_index(filter.where[p].field, filter.where[p].op);
+        if (!field_index) {
+            scanned.push_back(p);
+            continue;
+        }
+        hits.resize(m_rows.size());
+        index_rows(*field_index, filter.where[p], hits);
+        for (size_t w = 0; w < candidates.size(); w++) {
+            candidates[w] &= hits.words[w];
+        }
+    }
+
+    const float radius_sq = filter.radius * filter.radius;
+    for (size_t w = 0; w < candidates.size(); w++) {
+        for (uint64_t bits = candidates[w]; bits; bits &= bits - 1) {
+            const Entity entity = m_rows[w * 64 + std::countr_zero(bits)];
+            bool keep = true;
+            for (size_t p : scanned) {
+                if (!matches(read_field(world, index, entity, refs[p]), filter.where[p].op, filter.where[p].value)) {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep && filter.near) {
+                const WorldTransform* transform = world.get<const WorldTransform>(entity);
+                if (!transform) {
+                    continue;
+                }
+                const glm::vec3 position = scene_to_world(transform->position);    // Swapping y/z goes both ways
+                const glm::vec2 delta(position.x - filter.near->x, position.y - filter.near->y);
+                keep = glm::dot(delta, delta) <= radius_sq;
+            }
+            if (keep) {
+                out.push_back(entity);
+                if (filter.limit != 0 && out.size() == filter.limit) {
+                    return out;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+QueryValue SceneQuery::field(const World& world, const SceneIndex& index, Entity entity, std::string_view field) const {
+    return read_field(world, index, entity, resolve_field(field));
+}
+
+size_t SceneQuery::count(std::string_view component) const {
+    const Bitset* bits = membership(component);
+    return bits ? bits->count : 0;
+}
+
+} // namespace ascii
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "scene_index.hpp"
+#include "ecs/world.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+// A component field as queries see it. Booleans compare as 0/1.
+struct QueryValue {
+    enum class Kind : uint8_t { Null, Bool, Number, String };
+
+    Kind kind = Kind::Null;
+    double number = 0.0;
+    std::string text;
+
+    static QueryValue of(bool value) { return {Kind::Bool, value ? 1.0 : 0.0, {}}; }
+    static QueryValue of(double value) { return {Kind::Number, value, {}}; }
+    static QueryValue of(std::string value) { return {Kind::String, 0.0, std::move(value)}; }
+};
+
+enum class QueryOp : uint8_t { Eq, Ne, Lt, Le, Gt, Ge };
+
+// "==", "!=", "<", "<=", ">", ">="; throws std::runtime_error otherwise
+QueryOp parse_query_op(std::string_view text);
+
+// Component field predicate. Fields are "Component.field": the editor's
+// names for the typed components ("Collider.layer", "Light.radius"), the
+// script name and property key for any other component ("Card.cost"), and
+// "Node.id" / "Node.name" / "Node.type" for the node itself.
+struct QueryPredicate {
+    std::string field;
+    QueryOp op = QueryOp::Eq;
+    QueryValue value;
+};
+
+struct SceneQueryFilter {
+    std::vector<std::string> with;          // Component names; empty = every scene node
+    std::vector<std::string> without;
+    std::vector<QueryPredicate> where;      // All must hold
+    std::optional<glm::vec3> near;          // Scene space; distance over the map plane (x, y)
+    float radius = 0.0f;
+    size_t limit = 0;                       // 0 = no limit
+};
+
+// Answers "which entities have these components and field values" without
+// walking the scene. Every component name has a membership bitset over the
+// world's entity rows, so with/without are word-wide ANDs; fields declared
+// with declare_index() get a sorted index (range comparisons) or a hash
+// index (equality), and only the remaining predicates and the radius test
+// are checked per candidate.
+//
+// The bitsets and indexes are rebuilt lazily after a structural change
+// (World::structure_version). Code that edits component fields in place
+// calls invalidate().
+class SceneQuery {
+public:
+    enum class IndexKind : uint8_t { Sorted, Hash };
+
+    // Applies from the next rebuild. Throws std::runtime_error if the
+    // field is not "Component.field".
+    void declare_index(std::string_view field, IndexKind kind);
+
+    bool stale(const World& world) const { return !m_built || m_version != world.structure_version(); }
+    void rebuild(World& world, const SceneIndex& index);
+    void invalidate() { m_built = false; }
+
+    // Matching entities in row order (rebuilds first if stale). Throws
+    // std::runtime_error for malformed fields.
+    std::vector<Entity> run(World& world, const SceneIndex& index, const SceneQueryFilter& filter);
+
+    // Field value of one entity (Null if it lacks the component or field)
+    QueryValue field(const World& world, const SceneIndex& index, Entity entity, std::string_view field) const;
+
+    // Entities holding the component as of the last rebuild
+    size_t count(std::string_view component) const;
+
+private:
+    struct Bitset {
+        std::vector<uint64_t> words;
+        size_t count = 0;
+
+        void resize(size_t rows) { words.assign((rows + 63) / 64, 0); }
+        void set(size_t row) {
+            words[row >> 6] |= uint64_t(1) << (row & 63);
+            count++;
+        }
+        bool test(size_t row) const { return (words[row >> 6] >> (row & 63)) & 1; }
+    };
+
+    struct FieldIndex {
+        std::string field;
+        IndexKind kind = IndexKind::Sorted;
+        std::vector<std::pair<double, uint32_t>> numbers;          // Sorted: (value, row)
+        std::vector<std::pair<std::string, uint32_t>> strings;
+        std::unordered_map<std::string, std::vector<uint32_t>> buckets;  // Hash: value key -> rows
+    };
+
+    const Bitset* membership(std::string_view component) const;
+    const FieldIndex* find_index(std::string_view field, QueryOp op) const;
+    void build_index(FieldIndex& field_index, const World& world, const SceneIndex& index);
+    void index_rows(const FieldIndex& field_index, const QueryPredicate& predicate, Bitset& out) const;
+
+    bool m_built = false;
+    uint64_t m_version = 0;
+    std::vector<Entity> m_rows;                                 // Row -> entity
+    std::unordered_map<std::string, Bitset> m_members;          // Component name -> rows
+    std::vector<FieldIndex> m_indexes;
+};
+
+} // namespace ascii
@@ -0,0 +1,485 @@
+#include "scene_world.hpp"
+#include "transform_hierarchy.hpp"
+#include "renderer/lod_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <unordered_set>
+
+namespace ascii {
+
+namespace {
+
+constexpr float LIGHT_POWER_SCALE = 4.0f;          // Editor intensity 2 ~ a torch
+constexpr float TERRAIN_THICKNESS = 0.1f;          // Floor tiles; their top is at y = 0
+const glm::vec3 GLYPH_SCALE(0.9f, 1.0f, 0.9f);     // Glyph blocks stand on their cell
+const glm::vec3 SPRITE_OFFSET(0.5f, 0.5f, GLYPH_SCALE.y * 0.5f);  // Cell center, lifted onto the ground (scene space)
+
+struct Palette {
+    const char* name;
+    glm::vec3 color;
+    glm::vec3 emission;
+    float power;
+};
+
+// Named palettes used by Ascii/Terrain components (base color of the editor palette)
+const Palette PALETTES[] = {
+    {"grass",   {0.20f, 0.45f, 0.15f}, {0.0f}, 0.0f},
+    {"forest",  {0.16f, 0.40f, 0.16f}, {0.0f}, 0.0f},
+    {"stone",   {0.50f, 0.50f, 0.52f}, {0.0f}, 0.0f},
+    {"wood",    {0.50f, 0.32f, 0.18f}, {0.0f}, 0.0f},
+    {"water",   {0.20f, 0.40f, 0.85f}, {0.0f}, 0.0f},
+    {"dungeon", {0.63f, 0.50f, 0.31f}, {0.0f}, 0.0f},
+    {"fire",    {1.00f, 0.45f, 0.10f}, {1.0f, 0.5f, 0.1f}, 3.0f},
+};
+const Palette DEFAULT_PALETTE = {"", {0.6f, 0.6f, 0.6f}, {0.0f}, 0.0f};
+
+const Palette& find_palette(const std::string& name) {
+    for (const auto& palette : PALETTES) {
+        if (name == palette.name) {
+            return palette;
+        }
+    }
+    return DEFAULT_PALETTE;
+}
+
+// "#rgb" / "#rrggbb"; anything else ("transparent", names) gives the fallback
+glm::vec3 parse_hex_color(const std::string& text, const glm::vec3& fallback) {
+    if (text.empty() || text[0] != '#' || (text.size() != 4 && text.size() != 7)) {
+        return fallback;
+    }
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    glm::vec3 color;
+    const bool short_form = text.size() == 4;
+    for (int i = 0; i < 3; i++) {
+        int hi = hex(text[short_form ? 1 + i : 1 + i * 2]);
+        int lo = short_form ? hi : hex(text[2 + i * 2]);
+        if (hi < 0 || lo < 0) {
+            return fallback;
+        }
+        color[i] = static_cast<float>(hi * 16 + lo) / 255.0f;
+    }
+    return color;
+}
+
+// Calls fn(codepoint, column, row) for every visible character of ASCII art
+template<typename Fn>
+void for_each_art_glyph(std::string_view art, Fn&& fn) {
+    int column = 0;
+    int row = 0;
+    while (!art.empty()) {
+        size_t length = 0;
+        uint32_t glyph = decode_glyph(art, &length);
+        art.remove_prefix(length);
+        if (glyph == '\n') {
+            column = 0;
+            row++;
+            continue;
+        }
+        if (glyph != ' ' && glyph != '\r') {
+            fn(glyph, column, row);
+        }
+        column++;
+    }
+}
+
+// MaterialTable::add with a fast path for runs of identical materials
+class MaterialCache {
+public:
+    explicit MaterialCache(MaterialTable& table) : m_table(table) {}
+
+    uint16_t add(const Material& material) {
+        if (!m_has_last || std::memcmp(&material, &m_last, sizeof(Material)) != 0) {
+            m_last = material;
+            m_last_id = m_table.add(material);
+            m_has_last = true;
+        }
+        return m_last_id;
+    }
+
+private:
+    MaterialTable& m_table;
+    Material m_last{};
+    uint16_t m_last_id = 0;
+    bool m_has_last = false;
+};
+
+Material visual_material(const VisualComponent& visual) {
+    return {glm::vec4(visual.color, 0.6f), glm::vec4(visual.emission, visual.emission_power)};
+}
+
+Material glyph_material(const GlyphComponent& glyph) {
+    return {glm::vec4(parse_hex_color(glyph.fg, glm::vec3(1.0f)), glyph.bold ? 0.4f : 0.6f), glm::vec4(0.0f)};
+}
+
+Material art_material(const AsciiComponent& art) {
+    const Palette& palette = find_palette(art.palette);
+    return {glm::vec4(palette.color * art.brightness, 0.8f),
+            glm::vec4(palette.emission, palette.power * art.brightness)};
+}
+
+glm::vec3 transform_point(const WorldTransform& transform, const glm::vec3& scene_offset) {
+    return transform.position + transform.rotation * (transform.scale * scene_to_world(scene_offset));
+}
+
+} // anonymous namespace
+
+WorldTransform compose_transform(const WorldTransform& parent, const LocalTransform& local) {
+    const glm::vec3& euler = local.rotation;
+    glm::quat rotation(glm::vec3(glm::radians(euler.x), glm::radians(euler.z), glm::radians(euler.y)));
+    WorldTransform out;
+    out.position = parent.position + parent.rotation * (parent.scale * scene_to_world(local.position));
+    out.rotation = parent.rotation * rotation;
+    out.scale = parent.scale * scene_to_world(local.scale);
+    return out;
+}
+
+std::vector<Entity> spawn_scene(const SceneDocument& doc, World& world, SceneIndex& index, MaterialTable& materials) {
+    const size_t node_count = doc.node_count();
+    SceneWorldTransforms transforms;
+    compute_world_transforms(doc, transforms);
+
+    // Sprite per node: a visible visual glyph wins over a Glyph component
+    MaterialCache material_cache(materials);
+    std::vector<GlyphSprite> sprites(node_count);
+    std::vector<uint8_t> node_has_visual(node_count, 0);
+    for (const auto& visual : doc.visuals) {
+        if (visual.visible && visual.glyph != 0) {
+            sprites[visual.node] = {visual.glyph, material_cache.add(visual_material(visual))};
+            node_has_visual[visual.node] = 1;
+        }
+    }
+    std::vector<uint8_t> glyph_sprite_taken(node_count, 0);
+    for (size_t i = 0; i < doc.glyphs.size(); i++) {
+        const GlyphComponent& glyph = doc.glyphs[i];
+        if (!node_has_visual[glyph.node] && !glyph_sprite_taken[glyph.node] && glyph.enabled && glyph.glyph != 0) {
+            sprites[glyph.node] = {glyph.glyph, material_cache.add(glyph_material(glyph))};
+        }
+        glyph_sprite_taken[glyph.node] = 1;   // Later Glyph components go to extra children
+    }
+
+    // Component set of every node, so each entity is created in its final archetype
+    const ComponentMask base_mask = component_mask<SceneNode, Parent, LocalTransform, WorldTransform>();
+    std::vector<ComponentMask> masks(node_count, base_mask);
+    auto mark = [&]<typename T>(const std::vector<T>& list) {
+        const ComponentMask bit = component_mask<T>();
+        for (const auto& component : list) {
+            masks[component.node] |= bit;
+        }
+    };
+    mark(doc.glyphs);
+    mark(doc.ascii);
+    mark(doc.terrain);
+    mark(doc.lights);
+    mark(doc.colliders);
+    mark(doc.cameras);
+    mark(doc.visuals);
+    mark(doc.other);
+    for (size_t i = 0; i < node_count; i++) {
+        if (sprites[i].glyph != 0) {
+            masks[i] |= component_mask<GlyphSprite>();
+        }
+    }
+
+    std::vector<Entity> entities(node_count);
+    for (size_t i = 0; i < node_count; i++) {
+        const Entity entity = world.create(masks[i]);
+        entities[i] = entity;
+        const StringId id = index.intern(doc.node_id[i]);
+        *world.get<SceneNode>(entity) = {id, index.intern(doc.node_name[i]), index.intern(doc.node_type[i])};
+        index.bind(id, entity);
+        world.get<Parent>(entity)->entity = doc.parent[i] >= 0 ? entities[doc.parent[i]] : NULL_ENTITY;
+        *world.get<LocalTransform>(entity) = {doc.position[i], doc.rotation[i], doc.scale[i]};
+        *world.get<WorldTransform>(entity) = {transforms.position[i], transforms.rotation[i], transforms.scale[i]};
+        if (sprites[i].glyph != 0) {
+            *world.get<GlyphSprite>(entity) = sprites[i];
+        }
+    }
+
+    // Typed components. A node holds one of each type; more go to children.
+    std::vector<ComponentMask> placed(node_count, 0);
+    auto place = [&]<typename T>(const std::vector<T>& list) {
+        const ComponentMask bit = component_mask<T>();
+        for (const auto& component : list) {
+            const Entity node = entities[component.node];
+            if (!(placed[component.node] & bit)) {
+                placed[component.node] |= bit;
+                *world.get<T>(node) = component;
+                continue;
+            }
+            const WorldTransform node_transform = *world.get<WorldTransform>(node);
+            const StringId id = index.intern(component.id);
+            Entity extra = world.spawn(SceneNode{id, id, index.intern("Component")}, Parent{node},
+                                       LocalTransform{}, node_transform, component);
+            index.bind(id, extra);
+            if constexpr (std::is_same_v<T, GlyphComponent>) {
+                if (component.enabled && component.glyph != 0 && !node_has_visual[component.node]) {
+                    world.add(extra, GlyphSprite{component.glyph, material_cache.add(glyph_material(component))});
+                }
+            }
+        }
+    };
+    place(doc.glyphs);
+    place(doc.ascii);
+    place(doc.terrain);
+    place(doc.lights);
+    place(doc.colliders);
+    place(doc.cameras);
+    place(doc.visuals);
+    place(doc.other);
+
+    // ASCII art: one child per visible character
+    for (const auto& art : doc.ascii) {
+        if (!art.enabled) {
+            continue;
+        }
+        const Entity node = entities[art.node];
+        const uint16_t material = material_cache.add(art_material(art));
+        for_each_art_glyph(art.art, [&](uint32_t glyph, int column, int row) {
+            LocalTransform local;
+            local.position = glm::vec3(static_cast<float>(column), static_cast<float>(row), 0.0f);
+            WorldTransform cell = compose_transform(*world.get<WorldTransform>(node), local);
+            world.spawn(Parent{node}, local, cell, GlyphSprite{glyph, material});
+        });
+    }
+
+    return entities;
+}
+
+void destroy_scene_entity(World& world, SceneIndex& index, Entity root) {
+    if (!world.alive(root)) {
+        return;
+    }
+    std::vector<Entity> doomed{root};
+    std::unordered_set<Entity, HandleHash> level{root};
+    while (!level.empty()) {
+        std::unordered_set<Entity, HandleHash> next;
+        world.each<const Parent>([&](Entity entity, const Parent& parent) {
+            if (level.count(parent.entity)) {
+                next.insert(entity);
+                doomed.push_back(entity);
+            }
+        });
+        level.swap(next);
+    }
+    for (Entity entity : doomed) {
+        if (const SceneNode* node = world.get<const SceneNode>(entity); node && index.find(node->id) == entity) {
+            index.unbind(node->id);
+        }
+        world.destroy(entity);
+    }
+}
+
+uint32_t SceneExtractor::extract_instances(World& world, const SceneGeometry& geometry, JobSystem& jobs,
+                                           TransformHierarchy* hierarchy, LodSystem* lod) {
+    std::vector<ChunkView> chunks = world.chunks<const WorldTransform, const GlyphSprite>();
+    std::vector<uint32_t> chunk_first(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        chunk_first[c + 1] = chunk_first[c] + chunks[c].size();
+    }
+    const uint32_t count = chunk_first.back();
+
+    // Grow by appending a new range; the old one stays, hidden
+    m_dirty_first = m_first;
+    if (!m_allocated || count > m_capacity) {
+        for (uint32_t i = 0; i < m_capacity; i++) {
+            m_instances.set_mask(m_first + i, 0);
+        }
+        if (m_capacity == 0) {
+            m_dirty_first = static_cast<uint32_t>(m_instances.size());
+        }
+        m_first = static_cast<uint32_t>(m_instances.size());
+        m_capacity = m_allocated ? count + count / 4 : count;
+        m_instances.resize(m_first + m_capacity);
+        m_allocated = true;
+    }
+
+    auto blas_for = [&](uint32_t glyph) {
+        if (geometry.codepoint_as_blas) {
+            return glyph;
+        }
+        auto it = geometry.glyph_meshes.find(glyph);
+        return it != geometry.glyph_meshes.end() ? it->second : geometry.glyph_blas;
+    };
+
+
+    jobs.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const Entity* entities = chunks[c].entities();
+            const WorldTransform* transforms = chunks[c].column<const WorldTransform>();
+            const GlyphSprite* sprites = chunks[c].column<const GlyphSprite>();
+            const uint32_t size = chunks[c].size();
+            uint32_t slot = m_first + chunk_first[c];
+            for (uint32_t i = 0; i < size; i++, slot++) {
+                const WorldTransform& transform = transforms[i];
+                m_instances.set_position(slot, transform_point(transform, SPRITE_OFFSET));
+                m_instances.set_rotation(slot, transform.rotation);
+                m_instances.set_scale(slot, transform.scale * GLYPH_SCALE);
+                m_instances.set_blas(slot, blas_for(sprites[i].glyph));
+                m_instances.set_custom_index(slot, MaterialTable::custom_index(sprites[i].material));
+                m_instances.set_mask(slot, 0xFF);
+                if (hierarchy) {
+                    hierarchy->bind_instance(entities[i], slot);
+                }
+            }
+        }
+    });
+    for (uint32_t i = count; i < m_capacity; i++) {
+        m_instances.set_mask(m_first + i, 0);
+    }
+    m_dirty_count = m_first + m_capacity - m_dirty_first;
+
+    // Re-track glyph meshes with LOD chains; every slot was just written
+    // with the chain's full-detail BLAS, which is where tracking starts
+    if (lod) {
+        if (!m_lod_tracking) {
+            m_lod_first = lod->tracked_count();
+            m_lod_tracking = true;
+        }
+        lod->truncate(m_lod_first);
+        m_lod_handle.assign(m_capacity, NO_LOD);
+        if (!geometry.glyph_lod_chains.empty() && !geometry.codepoint_as_blas) {
+            for (size_t c = 0; c < chunks.size(); c++) {
+                const GlyphSprite* sprites = chunks[c].column<const GlyphSprite>();
+                for (uint32_t i = 0; i < chunks[c].size(); i++) {
+                    auto it = geometry.glyph_lod_chains.find(sprites[i].glyph);
+                    if (it == geometry.glyph_lod_chains.end()) {
+                        continue;
+                    }
+                    const uint32_t slot = m_first + chunk_first[c] + i;
+                    const glm::vec3 scale = m_instances.scale(slot);
+                    m_lod_handle[chunk_first[c] + i] =
+                        lod->track(slot, it->second, m_instances.position(slot),
+                                   std::max(scale.x, std::max(scale.y, scale.z)));
+                }
+            }
+        }
+    }
+    return count;
+}
+
+void SceneExtractor::update_materials(World& world, const TransformHierarchy& hierarchy,
+                                      std::span<const Entity> entities, bool fresh) {
+    if (fresh) {
+        m_dirty_count = 0;
+    }
+    for (Entity entity : entities) {
+        const GlyphSprite* sprite = world.get<const GlyphSprite>(entity);
+        const uint32_t slot = hierarchy.instance_of(entity);
+        if (!sprite || slot == TransformHierarchy::NO_INSTANCE) {
+            continue;
+        }
+        m_instances.set_custom_index(slot, MaterialTable::custom_index(sprite->material));
+        const uint32_t end = m_dirty_count > 0 ? std::max(m_dirty_first + m_dirty_count, slot + 1) : slot + 1;
+        m_dirty_first = m_dirty_count > 0 ? std::min(m_dirty_first, slot) : slot;
+        m_dirty_count = end - m_dirty_first;
+    }
+}
+
+void SceneExtractor::update_lod(LodSystem& lod) const {
+    if (m_lod_handle.empty() || m_dirty_count == 0) {
+        return;
+    }
+    const uint32_t begin = std::max(m_dirty_first, m_first) - m_first;
+    const uint32_t end = std::min<uint32_t>(m_dirty_first + m_dirty_count - m_first, m_lod_handle.size());
+    for (uint32_t i = begin; i < end; i++) {
+        if (m_lod_handle[i] != NO_LOD) {
+            lod.set_position(m_lod_handle[i], m_instances.position(m_first + i));
+        }
+    }
+}
+
+size_t SceneExtractor::update_instances(const TransformHierarchy& hierarchy) {
+    uint32_t end = 0;
+    const size_t written = hierarchy.write_instances(m_instances, scene_to_world(SPRITE_OFFSET), GLYPH_SCALE,
+                                                     m_dirty_first, end);
+    m_dirty_count = written > 0 ? end - m_dirty_first : 0;
+    return written;
+}
+
+uint32_t SceneExtractor::extract_lights(World& world, std::vector<Light>& lights) {
+    lights.clear();
+    m_light_entities.clear();
+    world.each<const WorldTransform, const LightComponent>([&](Entity entity, const WorldTransform& transform, const LightComponent& source) {
+        if (!source.enabled) {
+            return;
+        }
+        Light light;
+        light.position = glm::vec4(transform_point(transform, glm::vec3(0.5f, 0.5f, 1.0f)), source.radius);
+        light.color = glm::vec4(source.color, source.intensity * LIGHT_POWER_SCALE);
+        lights.push_back(light);
+        m_light_entities.push_back(entity);
+    });
+    const uint32_t count = static_cast<uint32_t>(lights.size());
+    lights.push_back({glm::vec4(0.0f), glm::vec4(0.0f)});  // power = 0 ends the list in the shader
+    return count;
+}
+
+void SceneExtractor::reset() {
+    m_allocated = false;
+    m_first = 0;
+    m_capacity = 0;
+    m_dirty_first = 0;
+    m_dirty_count = 0;
+    m_lod_tracking = false;
+    m_lod_first = 0;
+    m_lod_handle.clear();
+}
+
+uint32_t extract_terrain(World& world, Tilemap& tilemap, MaterialTable& materials) {
+    glm::vec2 lo(std::numeric_limits<float>::max());
+    glm::vec2 hi(std::numeric_limits<float>::lowest());
+    world.each<const WorldTransform, const TerrainComponent>([&](Entity, const WorldTransform& transform, const TerrainComponent& terrain) {
+        if (!terrain.enabled) {
+            return;
+        }
+        const glm::vec3& p = transform.position;
+        lo = glm::min(lo, glm::vec2(p.x, p.z));
+        hi = glm::max(hi, glm::vec2(p.x + terrain.width, p.z + terrain.height));
+    });
+    if (lo.x > hi.x) {
+        tilemap.resize(0, 0, 0);
+        return 0;
+    }
+
+    lo = glm::vec2(std::floor(lo.x), std::floor(lo.y));
+    tilemap.resize(static_cast<int>(std::ceil(hi.x - lo.x)), static_cast<int>(std::ceil(hi.y - lo.y)), 1);
+    tilemap.origin = glm::vec3(lo.x, -TERRAIN_THICKNESS, lo.y);
+
+    size_t tiles = 0;
+    world.each<const WorldTransform, const TerrainComponent>([&](Entity, const WorldTransform& transform, const TerrainComponent& terrain) {
+        if (!terrain.enabled) {
+            return;
+        }
+        const Palette& palette = find_palette(terrain.palette);
+        uint16_t material = materials.add({glm::vec4(palette.color * 0.6f, 0.95f), glm::vec4(0.0f)});
+        const glm::vec3& p = transform.position;
+        tiles += tilemap.fill_rect(0, static_cast<int>(std::floor(p.x - lo.x)), static_cast<int>(std::floor(p.z - lo.y)),
+                                   terrain.width, terrain.height, {terrain.fill_glyph, material, TERRAIN_THICKNESS});
+    });
+    return static_cast<uint32_t>(tiles);
+}
+
+bool find_scene_camera(World& world, glm::vec3& target, float& zoom) {
+    bool found = false;
+    int best_priority = std::numeric_limits<int>::min();
+    world.each<const WorldTransform, const CameraComponent>([&](Entity, const WorldTransform& transform, const CameraComponent& camera) {
+        if (camera.enabled && camera.active && camera.priority > best_priority) {
+            best_priority = camera.priority;
+            found = true;
+            target = transform.position + scene_to_world(glm::vec3(0.5f, 0.5f, 0.0f));
+            zoom = camera.zoom;
+        }
+    });
+    return found;
+}
+
+} // namespace ascii
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "scene.hpp"
+#include "scene_index.hpp"
+#include "scene_instantiate.hpp"
+#include "ecs/world.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ascii {
+
+class LodSystem;
+class TransformHierarchy;
+
+// ECS components for scene nodes. The typed scene.json components
+// (GlyphComponent, LightComponent, ...) are stored as components as-is;
+// these add identity, hierarchy and what the renderer consumes.
+
+// Authored identity, interned in the SceneIndex (only read by tools and IPC)
+struct SceneNode {
+    StringId id = NO_STRING;
+    StringId name = NO_STRING;
+    StringId type = NO_STRING;
+};
+
+struct Parent {
+    Entity entity = NULL_ENTITY;
+};
+
+// Scene space, relative to the parent (rotation: Euler degrees)
+struct LocalTransform {
+    glm::vec3 position{0.0f};
+    glm::vec3 rotation{0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+// Engine world space (y-up)
+struct WorldTransform {
+    glm::vec3 position{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+// One glyph block standing on the entity's cell; one TLAS instance each
+struct GlyphSprite {
+    uint32_t glyph = 0;
+    uint16_t material = 0;
+};
+
+WorldTransform compose_transform(const WorldTransform& parent, const LocalTransform& local);
+
+// Create one entity per node (SceneNode, Parent, LocalTransform,
+// WorldTransform plus its typed components). A second component of a type
+// the node already has goes to an extra child entity; every visible ASCII
+// art character becomes a child entity with a GlyphSprite. Materials are
+// resolved here so extraction only copies ids. Node ids (and the ids of
+// extra component entities) are bound in the index. Returns node index -> entity.
+std::vector<Entity> spawn_scene(const SceneDocument& doc, World& world, SceneIndex& index, MaterialTable& materials);
+
+// Destroy the entity with its descendants, unbinding their ids
+void destroy_scene_entity(World& world, SceneIndex& index, Entity root);
+
+// Turns the world into renderer data with linear scans over the columns
+// each output needs. Glyph instances own a range of instance slots, kept
+// across extractions like the tilemap's chunk slots: it is rewritten in
+// place and only re-allocated (appending, the old range hidden with mask
+// 0) when the sprite count outgrows it.
+class SceneExtractor {
+public:
+    explicit SceneExtractor(InstanceStore& instances) : m_instances(instances) {}
+
+    // (WorldTransform, GlyphSprite) -> instances, chunks spread over the jobs.
+    // With a hierarchy, each sprite's slot is bound to its node so later
+    // transform updates can go through update_instances(). With a LOD
+    // system, sprites whose glyph has a chain in the geometry are tracked
+    // by it, replacing those this extractor tracked before. Returns the
+    // number of sprites written.
+    uint32_t extract_instances(World& world, const SceneGeometry& geometry, JobSystem& jobs,
+                               TransformHierarchy* hierarchy = nullptr, LodSystem* lod = nullptr);
+
+    // Rewrite the instances of sprites the hierarchy's last update moved.
+    // Returns the number written.
+    size_t update_instances(const TransformHierarchy& hierarchy);
+
+    // Slots the last extract_instances() or update_instances() wrote (or
+    // hid): [dirty_first(), dirty_first() + dirty_count())
+    uint32_t dirty_first() const { return m_dirty_first; }
+    uint32_t dirty_count() const { return m_dirty_count; }
+
+    // Rewrite the material of these sprites' instances (their GlyphSprite
+    // material changed). The dirty range is widened over them, or starts
+    // over when nothing else was extracted or updated since it was read.
+    void update_materials(World& world, const TransformHierarchy& hierarchy, std::span<const Entity> entities,
+                          bool fresh);
+
+    // Move the LOD-tracked sprites among the dirty slots to where their
+    // instances are now
+    void update_lod(LodSystem& lod) const;
+
+    // (WorldTransform, LightComponent) -> lights, replacing the list and
+    // appending the terminator. Returns the number of lights.
+    uint32_t extract_lights(World& world, std::vector<Light>& lights);
+
+    // Source entity of each light from the last extract_lights
+    const std::vector<Entity>& light_entities() const { return m_light_entities; }
+
+    // Forget the slot range (call after clearing the instance store)
+    void reset();
+
+    uint32_t first_slot() const { return m_first; }
+    uint32_t capacity() const { return m_capacity; }
+
+private:
+    InstanceStore& m_instances;
+    bool m_allocated = false;
+    uint32_t m_first = 0;
+    uint32_t m_capacity = 0;
+    uint32_t m_dirty_first = 0;
+    uint32_t m_dirty_count = 0;
+    std::vector<Entity> m_light_entities;
+
+    // LOD handles from m_lod_first on are this extractor's sprites
+    static constexpr uint32_t NO_LOD = UINT32_MAX;
+    bool m_lod_tracking = false;
+    size_t m_lod_first = 0;
+    std::vector<uint32_t> m_lod_handle;     // Per slot from m_first, or NO_LOD
+};
+
+// (WorldTransform, TerrainComponent) -> one tilemap floor layer covering
+// every terrain rect. Returns the number of tiles written.
+uint32_t extract_terrain(World& world, Tilemap& tilemap, MaterialTable& materials);
+
+// Highest priority active camera; false if there is none
+bool find_scene_camera(World& world, glm::vec3& target, float& zoom);
+
+} // namespace ascii
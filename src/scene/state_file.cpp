@@ -0,0 +1,1047 @@
+#include "state_file.hpp"
+#include "scene_world.hpp"
+#include "core/job_system.hpp"
+#include "core/lz_codec.hpp"
+#include "core/stopwatch.hpp"
+#include "ecs/schema.hpp"
+#include "renderer/material_table.hpp"
+#include "world/tilemap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace ascii {
+
+namespace {
+
+using namespace state_format;
+using scene_format::Property;
+using scene_format::Glyph;
+using scene_format::Ascii;
+using scene_format::Terrain;
+using scene_format::Collider;
+using scene_format::Camera;
+using scene_format::Visual;
+using scene_format::Other;
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Section) == 32);
+static_assert(sizeof(Block) == 16);
+static_assert(sizeof(Info) == 48);
+static_assert(sizeof(Group) == 16);
+static_assert(sizeof(SchemaType) == 32);
+static_assert(sizeof(SchemaFieldRecord) == 64);
+static_assert(sizeof(SceneNode) == 12 && sizeof(LocalTransform) == 36 && sizeof(WorldTransform) == 40 &&
+              sizeof(GlyphSprite) == 8);
+
+// ComponentBits up to here are stored as columns (SceneNodes .. GlyphSprites)
+constexpr size_t PLAIN_COMPONENTS = static_cast<size_t>(ComponentBit::GlyphSprite) + 1;
+constexpr size_t COMPONENT_BITS = static_cast<size_t>(ComponentBit::Count);
+
+uint64_t align_up(uint64_t value) {
+    return (value + ALIGNMENT - 1) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+}
+
+uint64_t bit(ComponentBit component) {
+    return uint64_t(1) << static_cast<uint32_t>(component);
+}
+
+// ECS component of each ComponentBit
+std::array<ComponentId, COMPONENT_BITS> component_ids() {
+    return {component_id<SceneNode>(), component_id<Parent>(), component_id<LocalTransform>(),
+            component_id<WorldTransform>(), component_id<GlyphSprite>(),
+            component_id<GlyphComponent>(), component_id<AsciiComponent>(), component_id<TerrainComponent>(),
+            component_id<LightComponent>(), component_id<ColliderComponent>(), component_id<CameraComponent>(),
+            component_id<VisualComponent>(), component_id<GenericComponent>()};
+}
+
+// Raw bytes of one block of a section
+size_t block_bytes(const Section& section, size_t block) {
+    const uint64_t first = static_cast<uint64_t>(block) * section.block_elements;
+    return static_cast<size_t>(std::min<uint64_t>(section.block_elements, section.count - first) * section.element_size);
+}
+
+// Collects sections (borrowed pointers), compresses their blocks over the
+// jobs and writes the file in one go
+class BlockWriter {
+public:
+    template<typename T>
+    void add(SectionId id, const T* data, size_t count) {
+        m_sections.push_back({id, static_cast<uint32_t>(sizeof(T)), count, data});
+    }
+
+    template<typename T>
+    void add(SectionId id, const std::vector<T>& values) {
+        add(id, values.data(), values.size());
+    }
+
+    void write(const std::string& path, JobSystem& jobs, bool compress, StateSaveStats& stats) const {
+        Stopwatch timer;
+        std::vector<Section> sections;
+        std::vector<Encoded> blocks;
+        for (const Pending& pending : m_sections) {
+            Section section{};
+            section.id = static_cast<uint32_t>(pending.id);
+            section.element_size = pending.element_size;
+            section.count = pending.count;
+            section.block_elements = static_cast<uint32_t>(std::max<size_t>(1, BLOCK_BYTES / pending.element_size));
+            section.first_block = static_cast<uint32_t>(blocks.size());
+            section.block_count = static_cast<uint32_t>((pending.count + section.block_elements - 1) / section.block_elements);
+            const auto* data = static_cast<const uint8_t*>(pending.data);
+            for (uint32_t b = 0; b < section.block_count; b++) {
+                blocks.push_back({data + static_cast<size_t>(b) * section.block_elements * section.element_size,
+                                  block_bytes(section, b), {}});
+            }
+            sections.push_back(section);
+            stats.raw_bytes += pending.count * pending.element_size;
+        }
+
+        // Keep a compressed block only if it saves at least 1/16
+        if (compress) {
+            jobs.parallel_for(blocks.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    Encoded& block = blocks[i];
+                    std::vector<uint8_t> out(lz_compress_bound(block.raw_size));
+                    const size_t size = lz_compress(block.raw, block.raw_size, out.data());
+                    if (size < block.raw_size - block.raw_size / 16) {
+                        out.resize(size);
+                        block.compressed = std::move(out);
+                    }
+                }
+            });
+        }
+        stats.compress_ms = timer.elapsed_ms();
+        timer.reset();
+
+        std::vector<Block> table(blocks.size());
+        uint64_t offset = sizeof(Header) + sections.size() * sizeof(Section) + blocks.size() * sizeof(Block);
+        for (const Section& section : sections) {
+            offset = align_up(offset);
+            for (uint32_t b = section.first_block; b < section.first_block + section.block_count; b++) {
+                const bool raw = blocks[b].compressed.empty();
+                table[b].offset = offset;
+                table[b].stored_size = static_cast<uint32_t>(raw ? blocks[b].raw_size : blocks[b].compressed.size());
+                table[b].codec = static_cast<uint32_t>(raw ? Codec::Raw : Codec::Lz);
+                offset += table[b].stored_size;
+            }
+        }
+        offset = align_up(offset);
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.section_count = static_cast<uint32_t>(sections.size());
+        header.block_count = static_cast<uint32_t>(blocks.size());
+        header.file_size = offset;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to open state file for writing: " + path);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(Section));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Block));
+
+        const char zeros[ALIGNMENT] = {};
+        uint64_t position = sizeof(Header) + sections.size() * sizeof(Section) + blocks.size() * sizeof(Block);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            file.write(zeros, static_cast<std::streamsize>(table[b].offset - position));
+            const uint8_t* data = blocks[b].compressed.empty() ? blocks[b].raw : blocks[b].compressed.data();
+            file.write(reinterpret_cast<const char*>(data), table[b].stored_size);
+            position = table[b].offset + table[b].stored_size;
+        }
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+
+        if (!file) {
+            throw std::runtime_error("Failed to write state file: " + path);
+        }
+        stats.file_bytes = offset;
+        stats.write_ms = timer.elapsed_ms();
+    }
+
+private:
+    struct Pending {
+        SectionId id;
+        uint32_t element_size;
+        uint64_t count;
+        const void* data;
+    };
+    struct Encoded {
+        const uint8_t* raw;
+        size_t raw_size;
+        std::vector<uint8_t> compressed;    // Empty: stored raw
+    };
+    std::vector<Pending> m_sections;
+};
+
+// offsets[count + 1] into one blob
+struct StringTable {
+    std::vector<uint32_t> offsets{0};
+    std::string data;
+};
+
+template<typename Str>
+StringTable flatten_strings(size_t count, Str&& str) {
+    StringTable table;
+    table.offsets.reserve(count + 1);
+    for (size_t i = 0; i < count; i++) {
+        table.data += str(static_cast<StringId>(i));
+        table.offsets.push_back(static_cast<uint32_t>(table.data.size()));
+    }
+    return table;
+}
+
+// A string table section pair, validated on construction
+class StringTableView {
+public:
+    StringTableView(StateFile& file, SectionId offsets, SectionId data)
+        : m_file(file), m_offsets(file.get<uint32_t>(offsets)), m_data(file.get<char>(data)) {
+        if (m_offsets.empty() || m_offsets[0] != 0 || m_offsets.back() != m_data.size() ||
+            !std::is_sorted(m_offsets.begin(), m_offsets.end())) {
+            file.fail("bad string table");
+        }
+    }
+
+    size_t size() const { return m_offsets.size() - 1; }
+
+    std::string_view operator()(StringRef ref) const {
+        if (static_cast<size_t>(ref) >= size()) {
+            m_file.fail("string index out of range");
+        }
+        return {m_data.data() + m_offsets[ref], m_offsets[ref + 1] - m_offsets[ref]};
+    }
+
+private:
+    StateFile& m_file;
+    std::span<const uint32_t> m_offsets;
+    std::span<const char> m_data;
+};
+
+// A section that must have exactly `count` elements
+template<typename T>
+std::span<const T> column(StateFile& file, SectionId id, size_t count) {
+    std::span<const T> values = file.get<T>(id);
+    if (values.size() != count) {
+        file.fail("section " + std::to_string(static_cast<uint32_t>(id)) + " has the wrong length");
+    }
+    return values;
+}
+
+template<typename T>
+void copy_column(const ChunkView& chunk, std::vector<T>& out, uint32_t offset) {
+    if (const T* column = chunk.column<const T>()) {
+        std::copy_n(column, chunk.size(), out.data() + offset);
+    }
+}
+
+// Typed component records, ComponentHeader::node holding the entity row
+template<typename Record, typename Component, typename Fill>
+std::vector<Record> collect_records(World& world, const std::vector<uint32_t>& row_of, StringInterner& text, Fill&& fill) {
+    std::vector<Record> records;
+    world.each<const Component>([&](Entity entity, const Component& c) {
+        Record& record = records.emplace_back();
+        record.base = {static_cast<int32_t>(row_of[entity.index]), text.intern(c.id), c.enabled ? 1u : 0u};
+        fill(record, c);
+    });
+    return records;
+}
+
+// Stands in for the text table while checking: range-checks the reference
+// and copies nothing
+struct StringCheck {
+    const StringTableView& text;
+
+    std::string_view operator()(StringRef ref) const {
+        text(ref);
+        return {};
+    }
+};
+
+// Components of the group holding `row` (0 past the last group); the
+// groups are already known to be contiguous
+uint64_t row_components(std::span<const Group> groups, int64_t row) {
+    auto it = std::upper_bound(groups.begin(), groups.end(), row,
+                               [](int64_t r, const Group& group) { return r < static_cast<int64_t>(group.first); });
+    if (row < 0 || it == groups.begin()) {
+        return 0;
+    }
+    --it;
+    return static_cast<uint64_t>(row) < it->first + it->count ? it->components : 0;
+}
+
+// Everything apply_records() would reject, the fill's own checks included
+// (run on a scratch component)
+template<typename Record, typename Component, typename Fill>
+void check_records(StateFile& file, SectionId id, std::span<const Group> groups, ComponentBit component,
+                   const StringTableView& text, Fill&& fill) {
+    const StringCheck check{text};
+    Component scratch;
+    for (const Record& record : file.get<Record>(id)) {
+        if (!(row_components(groups, record.base.node) & bit(component))) {
+            file.fail("component of a missing entity");
+        }
+        check(record.base.id);
+        fill(scratch, record, check);
+    }
+}
+
+template<typename Record, typename Component, typename Fill>
+void apply_records(StateFile& file, SectionId id, World& world, const std::vector<Entity>& entities,
+                   const StringTableView& text, Fill&& fill) {
+    for (const Record& record : file.get<Record>(id)) {
+        Component& c = *world.get<Component>(entities[record.base.node]);
+        c.id = text(record.base.id);
+        c.enabled = record.base.enabled != 0;
+        fill(c, record, text);
+    }
+}
+
+} // anonymous namespace
+
+StateSaveStats save_state(const std::string& path, EngineState state, JobSystem& jobs, bool compress) {
+    Stopwatch timer;
+    StateSaveStats stats;
+    World& world = state.world;
+    const auto ids = component_ids();
+
+    // Rows follow the query order of chunks; consecutive chunks with the
+    // same stored components form one group
+    std::vector<ChunkView> chunks = world.chunks<>();
+    std::vector<uint64_t> chunk_bits(chunks.size());
+    std::vector<uint32_t> chunk_row(chunks.size());
+    std::array<std::vector<uint32_t>, PLAIN_COMPONENTS> chunk_offset;
+    std::array<uint32_t, PLAIN_COMPONENTS> plain_count{};
+    std::vector<Group> groups;
+    uint32_t rows = 0;
+    uint32_t max_index = 0;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const ChunkView& chunk = chunks[c];
+        uint64_t bits = 0;
+        for (size_t b = 0; b < COMPONENT_BITS; b++) {
+            if (chunk.mask() & (ComponentMask(1) << ids[b])) {
+                bits |= uint64_t(1) << b;
+            }
+        }
+        chunk_bits[c] = bits;
+        chunk_row[c] = rows;
+        for (size_t p = 0; p < PLAIN_COMPONENTS; p++) {
+            chunk_offset[p].push_back(plain_count[p]);
+            if (bits & (uint64_t(1) << p)) {
+                plain_count[p] += chunk.size();
+            }
+        }
+        if (groups.empty() || groups.back().components != bits) {
+            groups.push_back({bits, rows, 0});
+        }
+        groups.back().count += chunk.size();
+        rows += chunk.size();
+        for (uint32_t i = 0; i < chunk.size(); i++) {
+            max_index = std::max(max_index, chunk.entities()[i].index);
+        }
+    }
+    stats.entities = rows;
+
+    // Plain columns, chunks over the jobs
+    std::vector<uint32_t> row_of(rows > 0 ? max_index + 1 : 0, NO_ROW);
+    std::vector<SceneNode> nodes(plain_count[0]);
+    std::vector<uint32_t> parents(plain_count[1]);
+    std::vector<LocalTransform> locals(plain_count[2]);
+    std::vector<WorldTransform> transforms(plain_count[3]);
+    std::vector<GlyphSprite> sprites(plain_count[4]);
+    jobs.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const ChunkView& chunk = chunks[c];
+            const Entity* entities = chunk.entities();
+            for (uint32_t i = 0; i < chunk.size(); i++) {
+                row_of[entities[i].index] = chunk_row[c] + i;
+            }
+            copy_column(chunk, nodes, chunk_offset[0][c]);
+            copy_column(chunk, locals, chunk_offset[2][c]);
+            copy_column(chunk, transforms, chunk_offset[3][c]);
+            copy_column(chunk, sprites, chunk_offset[4][c]);
+        }
+    });
+    // Parent handles -> rows, once every row is known
+    jobs.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const Parent* column = chunks[c].column<const Parent>();
+            for (uint32_t i = 0; column && i < chunks[c].size(); i++) {
+                const Entity parent = column[i].entity;
+                parents[chunk_offset[1][c] + i] = world.alive(parent) ? row_of[parent.index] : NO_ROW;
+            }
+        }
+    });
+
+    // Typed components
+    StringInterner text;
+    std::vector<Property> properties;
+    std::vector<double> numbers;
+    auto glyphs = collect_records<Glyph, GlyphComponent>(world, row_of, text, [&](Glyph& r, const GlyphComponent& c) {
+        r.glyph = c.glyph;
+        r.fg = text.intern(c.fg);
+        r.bg = text.intern(c.bg);
+        r.bold = c.bold;
+    });
+    auto ascii = collect_records<Ascii, AsciiComponent>(world, row_of, text, [&](Ascii& r, const AsciiComponent& c) {
+        r.art = text.intern(c.art);
+        r.width = c.width;
+        r.height = c.height;
+        r.palette = text.intern(c.palette);
+        r.brightness = c.brightness;
+        r.transparent_bg = c.transparent_bg;
+        r.animate = c.animate;
+        r.animation_speed = c.animation_speed;
+        r.animation_type = text.intern(c.animation_type);
+    });
+    auto terrain = collect_records<Terrain, TerrainComponent>(world, row_of, text, [&](Terrain& r, const TerrainComponent& c) {
+        r.width = c.width;
+        r.height = c.height;
+        r.fill_glyph = c.fill_glyph;
+        r.palette = text.intern(c.palette);
+    });
+    auto lights = collect_records<scene_format::Light, LightComponent>(
+        world, row_of, text, [&](scene_format::Light& r, const LightComponent& c) {
+            r.color = c.color;
+            r.intensity = c.intensity;
+            r.radius = c.radius;
+            r.falloff = c.falloff;
+        });
+    auto colliders = collect_records<Collider, ColliderComponent>(world, row_of, text, [&](Collider& r, const ColliderComponent& c) {
+        r.blocks_movement = c.blocks_movement;
+        r.blocks_vision = c.blocks_vision;
+        r.layer = text.intern(c.layer);
+    });
+    auto cameras = collect_records<Camera, CameraComponent>(world, row_of, text, [&](Camera& r, const CameraComponent& c) {
+        r.priority = c.priority;
+        r.active = c.active;
+        r.zoom = c.zoom;
+        r.damping = c.damping;
+        r.binding_mode = text.intern(c.binding_mode);
+    });
+    auto visuals = collect_records<Visual, VisualComponent>(world, row_of, text, [&](Visual& r, const VisualComponent& c) {
+        r.visible = c.visible;
+        r.glyph = c.glyph;
+        r.color = c.color;
+        r.opacity = c.opacity;
+        r.emission = c.emission;
+        r.emission_power = c.emission_power;
+    });
+    auto other = collect_records<Other, GenericComponent>(world, row_of, text, [&](Other& r, const GenericComponent& c) {
+        r.script = text.intern(c.script);
+        r.properties = {static_cast<uint32_t>(properties.size()), static_cast<uint32_t>(c.properties.size())};
+        for (const SceneProperty& p : c.properties) {
+            Property& out = properties.emplace_back();
+            out.key = text.intern(p.key);
+            out.kind = static_cast<uint32_t>(p.kind);
+            out.number = p.kind == SceneProperty::Kind::Bool ? (p.boolean ? 1.0 : 0.0) : p.number;
+            out.text = text.intern(p.text);
+            out.array = {static_cast<uint32_t>(numbers.size()), static_cast<uint32_t>(p.array.size())};
+            numbers.insert(numbers.end(), p.array.begin(), p.array.end());
+        }
+    });
+
+    // Index: every interned string keeps its id; bindings of saved entities
+    const SceneIndex& index = state.index;
+    const StringTable names = flatten_strings(index.string_count(), [&](StringId id) { return index.str(id); });
+    std::vector<Binding> bindings;
+    for (StringId id = 0; id < index.string_count(); id++) {
+        const Entity entity = index.find(id);
+        if (entity != NULL_ENTITY && world.alive(entity)) {
+            bindings.push_back({id, row_of[entity.index]});
+        }
+    }
+
+    // Tilemap, layers concatenated
+    const Tilemap& tilemap = state.tilemap;
+    const size_t tiles = static_cast<size_t>(tilemap.width()) * tilemap.height();
+    std::vector<uint32_t> tile_glyph;
+    std::vector<uint16_t> tile_material;
+    std::vector<float> tile_height;
+    std::vector<float> layer_base;
+    for (int layer = 0; layer < tilemap.layers(); layer++) {
+        tile_glyph.insert(tile_glyph.end(), tilemap.layer_glyphs(layer), tilemap.layer_glyphs(layer) + tiles);
+        tile_material.insert(tile_material.end(), tilemap.layer_materials(layer), tilemap.layer_materials(layer) + tiles);
+        tile_height.insert(tile_height.end(), tilemap.layer_heights(layer), tilemap.layer_heights(layer) + tiles);
+        layer_base.push_back(tilemap.layer_base(layer));
+    }
+
+    // Type.define instances of saved entities, as packed rows
+    std::vector<SchemaType> schema_types;
+    std::vector<state_format::SchemaFieldRecord> schema_fields;
+    std::vector<StringRef> schema_options;
+    std::vector<uint32_t> schema_rows;
+    std::vector<uint8_t> schema_data;
+    for (const SchemaStore* store : state.schemas.stores()) {
+        const Schema& schema = store->schema();
+        SchemaType& type = schema_types.emplace_back();
+        type.name = text.intern(schema.name());
+        type.fields = {static_cast<uint32_t>(schema_fields.size()), static_cast<uint32_t>(schema.fields().size())};
+        type.stride = schema.stride();
+        type.first_row = static_cast<uint32_t>(schema_rows.size());
+        type.data_offset = schema_data.size();
+        for (const SchemaField& field : schema.fields()) {
+            state_format::SchemaFieldRecord& out = schema_fields.emplace_back();
+            out.name = text.intern(field.name);
+            out.type = static_cast<uint32_t>(field.type);
+            std::copy(std::begin(field.defaults), std::end(field.defaults), out.defaults);
+            out.min = field.min;
+            out.max = field.max;
+            out.options = {static_cast<uint32_t>(schema_options.size()), static_cast<uint32_t>(field.options.size())};
+            for (const std::string& option : field.options) {
+                schema_options.push_back(text.intern(option));
+            }
+        }
+
+        std::vector<uint32_t> source;       // Store row of each saved instance
+        for (uint32_t r = 0; r < store->size(); r++) {
+            const Entity entity = store->entities()[r];
+            if (world.alive(entity)) {
+                source.push_back(r);
+                schema_rows.push_back(row_of[entity.index]);
+            }
+        }
+        type.row_count = static_cast<uint32_t>(source.size());
+        schema_data.resize(schema_data.size() + source.size() * schema.stride());
+        std::byte* out = reinterpret_cast<std::byte*>(schema_data.data() + type.data_offset);
+        jobs.parallel_for(source.size(), 4096, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                store->pack(source[i], out + i * schema.stride());
+            }
+        });
+    }
+
+    const StringTable text_table = flatten_strings(text.size(), [&](StringId id) { return text.str(id); });
+
+    Info info{};
+    info.entity_count = rows;
+    info.name_count = static_cast<uint32_t>(index.string_count());
+    info.material_count = static_cast<uint32_t>(state.materials.size());
+    info.tile_width = tilemap.width();
+    info.tile_height = tilemap.height();
+    info.tile_layers = tilemap.layers();
+    info.tile_size = tilemap.tile_size;
+    info.tile_origin = tilemap.origin;
+    info.schema_count = static_cast<uint32_t>(schema_types.size());
+    stats.encode_ms = timer.elapsed_ms();
+
+    BlockWriter writer;
+    writer.add(SectionId::Info, &info, 1);
+    writer.add(SectionId::NameOffsets, names.offsets);
+    writer.add(SectionId::NameData, names.data.data(), names.data.size());
+    writer.add(SectionId::Bindings, bindings);
+    writer.add(SectionId::TextOffsets, text_table.offsets);
+    writer.add(SectionId::TextData, text_table.data.data(), text_table.data.size());
+    writer.add(SectionId::Groups, groups);
+    writer.add(SectionId::SceneNodes, nodes);
+    writer.add(SectionId::Parents, parents);
+    writer.add(SectionId::LocalTransforms, locals);
+    writer.add(SectionId::WorldTransforms, transforms);
+    writer.add(SectionId::GlyphSprites, sprites);
+    writer.add(SectionId::Glyphs, glyphs);
+    writer.add(SectionId::Ascii, ascii);
+    writer.add(SectionId::Terrain, terrain);
+    writer.add(SectionId::Lights, lights);
+    writer.add(SectionId::Colliders, colliders);
+    writer.add(SectionId::Cameras, cameras);
+    writer.add(SectionId::Visuals, visuals);
+    writer.add(SectionId::Other, other);
+    writer.add(SectionId::Properties, properties);
+    writer.add(SectionId::PropertyNumbers, numbers);
+    writer.add(SectionId::Materials, state.materials.entries());
+    writer.add(SectionId::TileGlyph, tile_glyph);
+    writer.add(SectionId::TileMaterial, tile_material);
+    writer.add(SectionId::TileHeight, tile_height);
+    writer.add(SectionId::LayerBase, layer_base);
+    writer.add(SectionId::Schemas, schema_types);
+    writer.add(SectionId::SchemaFields, schema_fields);
+    writer.add(SectionId::SchemaOptions, schema_options);
+    writer.add(SectionId::SchemaRows, schema_rows);
+    writer.add(SectionId::SchemaData, schema_data);
+    writer.write(path, jobs, compress, stats);
+    return stats;
+}
+
+StateFile::StateFile(const std::string& path) : m_path(path), m_file(path) {
+    const uint8_t* base = m_file.data();
+    const size_t size = m_file.size();
+    if (size < sizeof(Header)) {
+        fail("too small");
+    }
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        fail("bad magic");
+    }
+    if (header.version != VERSION) {
+        fail("unsupported version " + std::to_string(header.version));
+    }
+    if (header.file_size != size) {
+        fail("truncated");
+    }
+    const uint64_t tables = sizeof(Header) + uint64_t(header.section_count) * sizeof(Section) +
+                            uint64_t(header.block_count) * sizeof(Block);
+    if (tables > size) {
+        fail("tables out of bounds");
+    }
+    const auto* sections = reinterpret_cast<const Section*>(base + sizeof(Header));
+    m_blocks = reinterpret_cast<const Block*>(sections + header.section_count);
+    for (uint32_t b = 0; b < header.block_count; b++) {
+        const Block& block = m_blocks[b];
+        if (block.offset < tables || block.offset > size || block.stored_size > size - block.offset ||
+            block.codec > static_cast<uint32_t>(Codec::Lz)) {
+            fail("block " + std::to_string(b) + " out of bounds");
+        }
+    }
+
+    // Index the table by id; unknown ids (newer writers) are ignored
+    m_sections.resize(static_cast<size_t>(SectionId::Count));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        const Section& section = sections[i];
+        if (section.id >= m_sections.size()) {
+            continue;
+        }
+        const std::string name = "section " + std::to_string(section.id);
+        if (section.element_size == 0 || section.block_elements == 0 ||
+            section.count > std::numeric_limits<uint64_t>::max() / section.element_size) {
+            fail(name + " has a bad layout");
+        }
+        if (section.block_count != (section.count + section.block_elements - 1) / section.block_elements ||
+            section.first_block > header.block_count || section.block_count > header.block_count - section.first_block) {
+            fail(name + " has a bad block range");
+        }
+        SectionState& state = m_sections[section.id];
+        state.section = &section;
+        state.in_place = section.count > 0 && m_blocks[section.first_block].offset % ALIGNMENT == 0;
+        uint64_t next = section.count > 0 ? m_blocks[section.first_block].offset : 0;
+        for (uint32_t b = 0; b < section.block_count; b++) {
+            const Block& block = m_blocks[section.first_block + b];
+            const bool raw = block.codec == static_cast<uint32_t>(Codec::Raw);
+            if (raw && block.stored_size != block_bytes(section, b)) {
+                fail(name + " has a raw block of the wrong size");
+            }
+            state.in_place = state.in_place && raw && block.offset == next;
+            next = block.offset + block.stored_size;
+        }
+    }
+
+    if (count(SectionId::Info) != 1) {
+        fail("missing info");
+    }
+    m_info = get<Info>(SectionId::Info)[0];
+}
+
+size_t StateFile::count(SectionId id) const {
+    const Section* section = m_sections[static_cast<size_t>(id)].section;
+    return section ? static_cast<size_t>(section->count) : 0;
+}
+
+void StateFile::fail(const std::string& reason) const {
+    throw std::runtime_error("Invalid state file " + m_path + ": " + reason);
+}
+
+const uint8_t* StateFile::bytes(SectionId id, size_t element_size, size_t first, size_t count, JobSystem* jobs) {
+    if (count == 0) {
+        return nullptr;
+    }
+    SectionState& state = m_sections[static_cast<size_t>(id)];
+    const Section* section = state.section;
+    const std::string name = "section " + std::to_string(static_cast<uint32_t>(id));
+    if (!section || first > section->count || count > section->count - first) {
+        fail(name + " is too short");
+    }
+    if (section->element_size != element_size) {
+        fail(name + " has the wrong element size");
+    }
+    if (state.in_place) {
+        return m_file.data() + m_blocks[section->first_block].offset + first * element_size;
+    }
+
+    std::vector<BlockRef> missing;
+    for (size_t b = first / section->block_elements; b <= (first + count - 1) / section->block_elements; b++) {
+        if (state.decoded.empty() || !state.decoded[b]) {
+            missing.push_back({&state, static_cast<uint32_t>(b)});
+        }
+    }
+    decode(missing, jobs);
+    return state.data.get() + first * element_size;
+}
+
+void StateFile::decode_all(JobSystem& jobs) {
+    std::vector<BlockRef> missing;
+    for (SectionState& state : m_sections) {
+        if (!state.section || state.in_place) {
+            continue;
+        }
+        for (uint32_t b = 0; b < state.section->block_count; b++) {
+            if (state.decoded.empty() || !state.decoded[b]) {
+                missing.push_back({&state, b});
+            }
+        }
+    }
+    decode(missing, &jobs);
+}
+
+void StateFile::decode(const std::vector<BlockRef>& blocks, JobSystem* jobs) {
+    // Sections decode into one buffer each, allocated on first use
+    for (const auto& [state, block] : blocks) {
+        if (!state->data) {
+            const Section& section = *state->section;
+            state->data.reset(new uint8_t[section.count * section.element_size]);
+            state->decoded.assign(section.block_count, 0);
+        }
+    }
+
+    std::atomic<bool> corrupt{false};
+    auto run = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& [state, b] = blocks[i];
+            const Section& section = *state->section;
+            const Block& block = m_blocks[section.first_block + b];
+            const size_t raw = block_bytes(section, b);
+            uint8_t* out = state->data.get() + static_cast<size_t>(b) * section.block_elements * section.element_size;
+            const uint8_t* in = m_file.data() + block.offset;
+            if (block.codec == static_cast<uint32_t>(Codec::Raw)) {
+                std::memcpy(out, in, raw);
+            } else if (!lz_decompress(in, block.stored_size, out, raw)) {
+                corrupt = true;
+            }
+        }
+    };
+    if (jobs && blocks.size() > 1) {
+        jobs->parallel_for(blocks.size(), 1, run);
+    } else {
+        run(0, blocks.size());
+    }
+    if (corrupt) {
+        fail("corrupt compressed block");
+    }
+    for (const auto& [state, b] : blocks) {
+        state->decoded[b] = 1;
+        m_decoded_bytes += block_bytes(*state->section, b);
+    }
+}
+
+StateLoadStats load_state(StateFile& file, EngineState state, JobSystem& jobs) {
+    Stopwatch timer;
+    StateLoadStats stats;
+    file.decode_all(jobs);
+    stats.decode_ms = timer.elapsed_ms();
+    timer.reset();
+
+    // Everything that can reject the file is checked before the state is
+    // touched, so a bad file leaves it as it was
+    const Info info = file.info();
+    const StringTableView names(file, SectionId::NameOffsets, SectionId::NameData);
+    const StringTableView text(file, SectionId::TextOffsets, SectionId::TextData);
+    if (names.size() != info.name_count) {
+        file.fail("name count mismatch");
+    }
+    StringInterner interned;
+    for (StringId id = 0; id < info.name_count; id++) {
+        if (interned.intern(names(id)) != id) {
+            file.fail("duplicate name");
+        }
+    }
+
+    const auto groups = file.get<Group>(SectionId::Groups);
+    std::array<std::vector<uint32_t>, PLAIN_COMPONENTS> group_offset;
+    std::array<size_t, PLAIN_COMPONENTS> plain_count{};
+    uint64_t next_row = 0;
+    for (const Group& group : groups) {
+        if (group.first != next_row || group.count > info.entity_count - next_row ||
+            group.components >= (uint64_t(1) << COMPONENT_BITS)) {
+            file.fail("bad entity group");
+        }
+        for (size_t p = 0; p < PLAIN_COMPONENTS; p++) {
+            group_offset[p].push_back(static_cast<uint32_t>(plain_count[p]));
+            if (group.components & (uint64_t(1) << p)) {
+                plain_count[p] += group.count;
+            }
+        }
+        next_row += group.count;
+    }
+    if (next_row != info.entity_count) {
+        file.fail("entity groups don't cover every row");
+    }
+
+    const auto nodes = column<SceneNode>(file, SectionId::SceneNodes, plain_count[0]);
+    const auto parents = column<uint32_t>(file, SectionId::Parents, plain_count[1]);
+    const auto locals = column<LocalTransform>(file, SectionId::LocalTransforms, plain_count[2]);
+    const auto transforms = column<WorldTransform>(file, SectionId::WorldTransforms, plain_count[3]);
+    const auto sprites = column<GlyphSprite>(file, SectionId::GlyphSprites, plain_count[4]);
+    for (uint32_t parent : parents) {
+        if (parent != NO_ROW && parent >= info.entity_count) {
+            file.fail("parent out of range");
+        }
+    }
+    for (const GlyphSprite& sprite : sprites) {
+        if (sprite.material >= info.material_count) {
+            file.fail("sprite material out of range");
+        }
+    }
+
+    // Typed components: the same fills check and apply, `text` being the
+    // string table or a StringCheck
+    const auto properties = file.get<Property>(SectionId::Properties);
+    const auto numbers = file.get<double>(SectionId::PropertyNumbers);
+    auto range_valid = [](const Range& range, size_t size) {
+        return range.first <= size && range.count <= size - range.first;
+    };
+    auto fill_glyph = [](GlyphComponent& c, const Glyph& r, const auto& text) {
+        c.glyph = r.glyph;
+        c.fg = text(r.fg);
+        c.bg = text(r.bg);
+        c.bold = r.bold != 0;
+    };
+    auto fill_ascii = [](AsciiComponent& c, const Ascii& r, const auto& text) {
+        c.art = text(r.art);
+        c.width = r.width;
+        c.height = r.height;
+        c.palette = text(r.palette);
+        c.brightness = r.brightness;
+        c.transparent_bg = r.transparent_bg != 0;
+        c.animate = r.animate != 0;
+        c.animation_speed = r.animation_speed;
+        c.animation_type = text(r.animation_type);
+    };
+    auto fill_terrain = [](TerrainComponent& c, const Terrain& r, const auto& text) {
+        c.width = r.width;
+        c.height = r.height;
+        c.fill_glyph = r.fill_glyph;
+        c.palette = text(r.palette);
+    };
+    auto fill_light = [](LightComponent& c, const scene_format::Light& r, const auto&) {
+        c.color = r.color;
+        c.intensity = r.intensity;
+        c.radius = r.radius;
+        c.falloff = r.falloff;
+    };
+    auto fill_collider = [](ColliderComponent& c, const Collider& r, const auto& text) {
+        c.blocks_movement = r.blocks_movement != 0;
+        c.blocks_vision = r.blocks_vision != 0;
+        c.layer = text(r.layer);
+    };
+    auto fill_camera = [](CameraComponent& c, const Camera& r, const auto& text) {
+        c.priority = r.priority;
+        c.active = r.active != 0;
+        c.zoom = r.zoom;
+        c.damping = r.damping;
+        c.binding_mode = text(r.binding_mode);
+    };
+    auto fill_visual = [](VisualComponent& c, const Visual& r, const auto&) {
+        c.visible = r.visible != 0;
+        c.glyph = r.glyph;
+        c.color = r.color;
+        c.opacity = r.opacity;
+        c.emission = r.emission;
+        c.emission_power = r.emission_power;
+    };
+    auto fill_other = [&](GenericComponent& c, const Other& r, const auto& text) {
+        c.script = text(r.script);
+        if (!range_valid(r.properties, properties.size())) {
+            file.fail("component properties out of bounds");
+        }
+        c.properties.clear();
+        for (const Property& p : properties.subspan(r.properties.first, r.properties.count)) {
+            if (!range_valid(p.array, numbers.size())) {
+                file.fail("property array out of bounds");
+            }
+            SceneProperty& property = c.properties.emplace_back();
+            property.key = text(p.key);
+            property.kind = static_cast<SceneProperty::Kind>(p.kind);
+            property.boolean = p.number != 0.0;
+            property.number = p.number;
+            property.text = text(p.text);
+            property.array.assign(numbers.begin() + p.array.first, numbers.begin() + p.array.first + p.array.count);
+        }
+    };
+    check_records<Glyph, GlyphComponent>(file, SectionId::Glyphs, groups, ComponentBit::Glyph, text, fill_glyph);
+    check_records<Ascii, AsciiComponent>(file, SectionId::Ascii, groups, ComponentBit::Ascii, text, fill_ascii);
+    check_records<Terrain, TerrainComponent>(file, SectionId::Terrain, groups, ComponentBit::Terrain, text,
+                                             fill_terrain);
+    check_records<scene_format::Light, LightComponent>(file, SectionId::Lights, groups, ComponentBit::Light, text,
+                                                       fill_light);
+    check_records<Collider, ColliderComponent>(file, SectionId::Colliders, groups, ComponentBit::Collider, text,
+                                               fill_collider);
+    check_records<Camera, CameraComponent>(file, SectionId::Cameras, groups, ComponentBit::Camera, text,
+                                           fill_camera);
+    check_records<Visual, VisualComponent>(file, SectionId::Visuals, groups, ComponentBit::Visual, text,
+                                           fill_visual);
+    check_records<Other, GenericComponent>(file, SectionId::Other, groups, ComponentBit::Other, text, fill_other);
+
+    const auto bindings = file.get<Binding>(SectionId::Bindings);
+    for (const Binding& binding : bindings) {
+        if (binding.id >= info.name_count || binding.row >= info.entity_count) {
+            file.fail("binding out of range");
+        }
+    }
+
+    const auto materials = column<Material>(file, SectionId::Materials, info.material_count);
+    if (materials.size() > MaterialTable::MAX_MATERIALS) {
+        file.fail("too many materials");
+    }
+
+    if (info.tile_width < 0 || info.tile_height < 0 || info.tile_layers < 0) {
+        file.fail("negative tilemap size");
+    }
+    const size_t tiles = static_cast<size_t>(info.tile_width) * static_cast<size_t>(info.tile_height);
+    const size_t layer_tiles = tiles * static_cast<size_t>(info.tile_layers);
+    const auto tile_glyph = column<uint32_t>(file, SectionId::TileGlyph, layer_tiles);
+    const auto tile_material = column<uint16_t>(file, SectionId::TileMaterial, layer_tiles);
+    const auto tile_height = column<float>(file, SectionId::TileHeight, layer_tiles);
+    const auto layer_base = column<float>(file, SectionId::LayerBase, info.tile_layers);
+    for (uint16_t material : tile_material) {
+        if (material >= info.material_count) {
+            file.fail("tile material out of range");
+        }
+    }
+
+    // Type.define instances, each type's saved fields kept for the load
+    const auto types = column<SchemaType>(file, SectionId::Schemas, info.schema_count);
+    const auto fields = file.get<state_format::SchemaFieldRecord>(SectionId::SchemaFields);
+    const auto options = file.get<StringRef>(SectionId::SchemaOptions);
+    const auto rows = file.get<uint32_t>(SectionId::SchemaRows);
+    const auto data = file.get<uint8_t>(SectionId::SchemaData);
+    std::vector<std::vector<SchemaFieldDesc>> saved_fields;
+    saved_fields.reserve(types.size());
+    for (const SchemaType& type : types) {
+        if (!range_valid(type.fields, fields.size()) || type.first_row > rows.size() ||
+            type.row_count > rows.size() - type.first_row || type.data_offset > data.size() ||
+            uint64_t(type.row_count) * type.stride > data.size() - type.data_offset) {
+            file.fail("type out of bounds");
+        }
+        std::vector<SchemaFieldDesc>& saved = saved_fields.emplace_back();
+        for (const state_format::SchemaFieldRecord& f : fields.subspan(type.fields.first, type.fields.count)) {
+            if (f.type > static_cast<uint32_t>(SchemaFieldType::Color) || !range_valid(f.options, options.size())) {
+                file.fail("bad type field");
+            }
+            SchemaFieldDesc& desc = saved.emplace_back();
+            desc.name = text(f.name);
+            desc.type = static_cast<SchemaFieldType>(f.type);
+            std::copy(std::begin(f.defaults), std::end(f.defaults), desc.defaults);
+            desc.min = f.min;
+            desc.max = f.max;
+            for (StringRef option : options.subspan(f.options.first, f.options.count)) {
+                desc.options.emplace_back(text(option));
+            }
+        }
+        const std::string name(text(type.name));
+        if (Schema(name, saved).stride() != type.stride) {
+            file.fail("type " + name + " does not match its packed rows");
+        }
+        for (uint32_t row : rows.subspan(type.first_row, type.row_count)) {
+            if (row >= info.entity_count) {
+                file.fail("instance of a missing entity");
+            }
+        }
+    }
+    stats.validate_ms = timer.elapsed_ms();
+    timer.reset();
+
+    // Entities, created group by group
+    World& world = state.world;
+    world.clear();
+    state.index.reset(std::move(interned));
+    state.schemas.clear();
+    const auto ids = component_ids();
+    std::vector<Entity> entities(info.entity_count);
+    for (const Group& group : groups) {
+        ComponentMask mask = 0;
+        for (size_t b = 0; b < COMPONENT_BITS; b++) {
+            if (group.components & (uint64_t(1) << b)) {
+                mask |= ComponentMask(1) << ids[b];
+            }
+        }
+        for (uint32_t r = 0; r < group.count; r++) {
+            entities[group.first + r] = world.create(mask);
+        }
+    }
+    stats.entities = entities.size();
+    stats.spawn_ms = timer.elapsed_ms();
+    timer.reset();
+
+    // Plain components, rows over the jobs
+    jobs.parallel_for(entities.size(), 4096, [&](size_t begin, size_t end) {
+        size_t g = std::upper_bound(groups.begin(), groups.end(), begin,
+                                    [](size_t row, const Group& group) { return row < group.first; }) - groups.begin() - 1;
+        for (size_t r = begin; r < end; r++) {
+            while (r >= groups[g].first + groups[g].count) {
+                g++;
+            }
+            const Group& group = groups[g];
+            const size_t k = r - group.first;
+            const Entity entity = entities[r];
+            if (group.components & bit(ComponentBit::SceneNode)) {
+                *world.get<SceneNode>(entity) = nodes[group_offset[0][g] + k];
+            }
+            if (group.components & bit(ComponentBit::Parent)) {
+                const uint32_t parent = parents[group_offset[1][g] + k];
+                world.get<Parent>(entity)->entity = parent == NO_ROW ? NULL_ENTITY : entities[parent];
+            }
+            if (group.components & bit(ComponentBit::LocalTransform)) {
+                *world.get<LocalTransform>(entity) = locals[group_offset[2][g] + k];
+            }
+            if (group.components & bit(ComponentBit::WorldTransform)) {
+                *world.get<WorldTransform>(entity) = transforms[group_offset[3][g] + k];
+            }
+            if (group.components & bit(ComponentBit::GlyphSprite)) {
+                *world.get<GlyphSprite>(entity) = sprites[group_offset[4][g] + k];
+            }
+        }
+    });
+
+    apply_records<Glyph, GlyphComponent>(file, SectionId::Glyphs, world, entities, text, fill_glyph);
+    apply_records<Ascii, AsciiComponent>(file, SectionId::Ascii, world, entities, text, fill_ascii);
+    apply_records<Terrain, TerrainComponent>(file, SectionId::Terrain, world, entities, text, fill_terrain);
+    apply_records<scene_format::Light, LightComponent>(file, SectionId::Lights, world, entities, text, fill_light);
+    apply_records<Collider, ColliderComponent>(file, SectionId::Colliders, world, entities, text, fill_collider);
+    apply_records<Camera, CameraComponent>(file, SectionId::Cameras, world, entities, text, fill_camera);
+    apply_records<Visual, VisualComponent>(file, SectionId::Visuals, world, entities, text, fill_visual);
+    apply_records<Other, GenericComponent>(file, SectionId::Other, world, entities, text, fill_other);
+
+    for (const Binding& binding : bindings) {
+        state.index.bind(binding.id, entities[binding.row]);
+    }
+
+    state.materials.assign(materials.data(), materials.size());
+
+    Tilemap& tilemap = state.tilemap;
+    tilemap.resize(info.tile_width, info.tile_height, info.tile_layers);
+    tilemap.origin = info.tile_origin;
+    tilemap.tile_size = info.tile_size;
+    for (int layer = 0; layer < info.tile_layers; layer++) {
+        tilemap.set_layer_base(layer, layer_base[layer]);
+        tilemap.assign_layer(layer, tile_glyph.data() + layer * tiles, tile_material.data() + layer * tiles,
+                             tile_height.data() + layer * tiles);
+    }
+
+    // Type.define instances: load under the saved definition, then move
+    // to the current one if the type is defined differently now
+    for (size_t t = 0; t < types.size(); t++) {
+        const SchemaType& type = types[t];
+        const std::string name(text(type.name));
+        std::vector<SchemaFieldDesc> current;
+        const SchemaStore* existing = state.schemas.find(name);
+        if (existing) {
+            current.assign(existing->schema().fields().begin(), existing->schema().fields().end());
+        }
+        SchemaStore& store = state.schemas.define(name, std::move(saved_fields[t]));
+        for (uint32_t i = 0; i < type.row_count; i++) {
+            const uint32_t r = store.add(entities[rows[type.first_row + i]]);
+            store.unpack(r, reinterpret_cast<const std::byte*>(data.data() + type.data_offset + size_t(i) * type.stride));
+        }
+        if (existing) {
+            store.redefine(Schema(name, std::move(current)));
+        }
+    }
+
+    stats.fill_ms = timer.elapsed_ms();
+    return stats;
+}
+
+} // namespace ascii
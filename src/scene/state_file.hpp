@@ -0,0 +1,266 @@
+#pragma once
+
+#include "scene_binary.hpp"
+#include "core/mapped_file.hpp"
+#include "core/string_interner.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+class World;
+class SceneIndex;
+class Tilemap;
+class MaterialTable;
+class SchemaRegistry;
+
+// On-disk layout of engine state files (.asav, little-endian): the live
+// state play and edits change, as opposed to the authored scene of .ascn
+// files. Every section is one flat array cut into blocks of about
+// BLOCK_BYTES, each compressed on its own (LZ4 block format, or stored raw
+// when that doesn't pay), so writers compress blocks in parallel and
+// readers decompress only the blocks they touch. Sections start at
+// ALIGNMENT and their blocks follow back to back, so a section stored
+// all raw is read in place from the mapping.
+//
+// Versioning: VERSION covers the engine's own records, which the reader
+// checks by element size; Type.define instances are saved with the fields
+// they were declared with and migrated by field name when the type has
+// changed since (see load_state).
+namespace state_format {
+
+constexpr char MAGIC[4] = {'A', 'S', 'A', 'V'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGNMENT = 16;
+constexpr size_t BLOCK_BYTES = 256 * 1024;
+
+enum class Codec : uint32_t { Raw, Lz };
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t section_count;
+    uint32_t block_count;
+    uint64_t file_size;
+    uint64_t reserved;
+};
+
+struct Section {
+    uint32_t id;                   // SectionId
+    uint32_t element_size;         // Checked against the reader's struct
+    uint64_t count;
+    uint32_t first_block;          // Into the block table
+    uint32_t block_count;
+    uint32_t block_elements;       // Elements per block (the last may hold fewer)
+    uint32_t reserved;
+};
+
+struct Block {
+    uint64_t offset;               // From the start of the file
+    uint32_t stored_size;
+    uint32_t codec;                // Codec
+};
+
+enum class SectionId : uint32_t {
+    Info,
+
+    // SceneIndex strings by StringId (SceneNode fields refer to these),
+    // as offsets[count + 1] into one blob, and the bound ids
+    NameOffsets, NameData, Bindings,
+
+    // Strings of component fields, same layout; StringRef indexes them
+    TextOffsets, TextData,
+
+    // Entities: rows in groups of one component set, and the plain
+    // components as columns in row order over the groups that have them
+    Groups, SceneNodes, Parents, LocalTransforms, WorldTransforms, GlyphSprites,
+
+    // Typed scene components (ComponentHeader::node is the entity row),
+    // in the .ascn record layouts
+    Glyphs, Ascii, Terrain, Lights, Colliders, Cameras, Visuals, Other,
+    Properties, PropertyNumbers,
+
+    Materials,
+
+    // Tilemap, one layer after another
+    TileGlyph, TileMaterial, TileHeight, LayerBase,
+
+    // Type.define stores: types, their fields as declared, enum options,
+    // then the entity row and the packed row (Schema layout) of each instance
+    Schemas, SchemaFields, SchemaOptions, SchemaRows, SchemaData,
+
+    Count
+};
+
+// Stable bits for Group::components (ECS component ids depend on the order
+// types were first used)
+enum class ComponentBit : uint32_t {
+    SceneNode, Parent, LocalTransform, WorldTransform, GlyphSprite,
+    Glyph, Ascii, Terrain, Light, Collider, Camera, Visual, Other,
+    Count
+};
+
+using scene_format::StringRef;
+using scene_format::Range;
+
+constexpr uint32_t NO_ROW = 0xFFFFFFFFu;
+
+struct Info {
+    uint64_t entity_count;
+    uint32_t name_count;
+    uint32_t material_count;
+    int32_t tile_width;
+    int32_t tile_height;
+    int32_t tile_layers;
+    float tile_size;
+    glm::vec3 tile_origin;
+    uint32_t schema_count;
+};
+
+struct Group {
+    uint64_t components;           // ComponentBit mask
+    uint32_t first;                // Entity row
+    uint32_t count;
+};
+
+struct Binding {
+    StringId id;
+    uint32_t row;
+};
+
+struct SchemaType {
+    StringRef name;
+    Range fields;                  // Into SchemaFields
+    uint32_t stride;               // Packed row bytes
+    uint32_t first_row;            // Into SchemaRows
+    uint32_t row_count;
+    uint64_t data_offset;          // Into SchemaData
+};
+
+struct SchemaFieldRecord {
+    StringRef name;
+    uint32_t type;                 // SchemaFieldType
+    double defaults[4];
+    double min;
+    double max;
+    Range options;                 // Into SchemaOptions
+};
+
+} // namespace state_format
+
+// The stores a state file holds
+struct EngineState {
+    World& world;
+    SceneIndex& index;
+    Tilemap& tilemap;
+    MaterialTable& materials;
+    SchemaRegistry& schemas;
+};
+
+struct StateSaveStats {
+    size_t entities = 0;
+    size_t raw_bytes = 0;          // Section data before compression
+    size_t file_bytes = 0;
+    double encode_ms = 0.0;        // Stores -> flat arrays
+    double compress_ms = 0.0;
+    double write_ms = 0.0;
+};
+
+// Write the state; the world must have no pending commands. Columns are
+// gathered and blocks compressed over the job system. Components without
+// a state record (none in scenes today) are left out. Throws
+// std::runtime_error if the file can't be written.
+StateSaveStats save_state(const std::string& path, EngineState state, JobSystem& jobs, bool compress = true);
+
+// A mapped state file. The constructor validates the header and the
+// section and block tables and decompresses nothing; sections decompress
+// on first access, and only the blocks asked for. Throws
+// std::runtime_error on a bad file. Not thread-safe (decoding fans out
+// over the job system internally).
+class StateFile {
+public:
+    explicit StateFile(const std::string& path);
+
+    const std::string& path() const { return m_path; }
+    size_t file_size() const { return m_file.size(); }
+    const state_format::Info& info() const { return m_info; }
+
+    // Element count of a section (0 if missing)
+    size_t count(state_format::SectionId id) const;
+
+    // Whole section, its missing blocks decompressed over the jobs if given
+    template<typename T>
+    std::span<const T> get(state_format::SectionId id, JobSystem* jobs = nullptr) {
+        return typed<T>(id, 0, count(id), jobs);
+    }
+
+    // Elements [first, first + count), decompressing only the blocks they
+    // fall in
+    template<typename T>
+    std::span<const T> range(state_format::SectionId id, size_t first, size_t count) {
+        return typed<T>(id, first, count, nullptr);
+    }
+
+    // Decompress every block of every section over the jobs
+    void decode_all(JobSystem& jobs);
+
+    size_t decoded_bytes() const { return m_decoded_bytes; }
+
+    [[noreturn]] void fail(const std::string& reason) const;
+
+private:
+    struct SectionState {
+        const state_format::Section* section = nullptr;
+        bool in_place = false;                  // Every block raw: read from the mapping
+        std::unique_ptr<uint8_t[]> data;        // Decompressed section, allocated on first use
+        std::vector<uint8_t> decoded;           // Per block
+    };
+
+    template<typename T>
+    std::span<const T> typed(state_format::SectionId id, size_t first, size_t count, JobSystem* jobs) {
+        const uint8_t* data = bytes(id, sizeof(T), first, count, jobs);
+        return {reinterpret_cast<const T*>(data), data ? count : 0};
+    }
+
+    // Pointer to element `first` once the blocks holding [first, first +
+    // count) are decoded; nullptr for an empty range
+    const uint8_t* bytes(state_format::SectionId id, size_t element_size, size_t first, size_t count, JobSystem* jobs);
+
+    // Decompress (section, block) pairs, in parallel when jobs is given
+    using BlockRef = std::pair<SectionState*, uint32_t>;
+    void decode(const std::vector<BlockRef>& blocks, JobSystem* jobs);
+
+    std::string m_path;
+    MappedFile m_file;
+    const state_format::Block* m_blocks = nullptr;
+    std::vector<SectionState> m_sections;   // By id
+    state_format::Info m_info{};
+    size_t m_decoded_bytes = 0;
+};
+
+struct StateLoadStats {
+    size_t entities = 0;
+    double decode_ms = 0.0;
+    double validate_ms = 0.0;      // Checking the file before replacing anything
+    double spawn_ms = 0.0;         // Creating entities
+    double fill_ms = 0.0;          // Components, index, tilemap, materials, types
+};
+
+// Replace the state with the file's. The whole file is checked first; then
+// the world, index and schema instances are cleared (types stay defined). Types in the file are defined if
+// unknown; a type whose definition changed since keeps its current fields,
+// instances keeping the values of fields with the same name and type.
+// Derived data (transform hierarchy, extracted instances, tilemap chunks
+// on the GPU) is the caller's to rebuild. Throws std::runtime_error on a
+// bad file, leaving the state untouched.
+StateLoadStats load_state(StateFile& file, EngineState state, JobSystem& jobs);
+
+} // namespace ascii
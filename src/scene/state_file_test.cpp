@@ -0,0 +1,345 @@
+#include "scene/state_file.hpp"
+#include "core/job_system.hpp"
+#include "core/test.hpp"
+#include "ecs/schema.hpp"
+#include "scene/scene_world.hpp"
+#include "world/tilemap.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+const std::string PATH = "state_file_test.asav";
+constexpr size_t PROP_COUNT = 20000;        // Several blocks per transform section
+
+// The stores a state file holds, owned together
+struct Stores {
+    World world;
+    SceneIndex index;
+    Tilemap tilemap;
+    MaterialTable materials;
+    SchemaRegistry schemas;
+
+    EngineState state() { return {world, index, tilemap, materials, schemas}; }
+};
+
+std::vector<SchemaFieldDesc> stats_fields() {
+    std::vector<SchemaFieldDesc> fields(2);
+    fields[0].name = "hp";
+    fields[0].type = SchemaFieldType::Int;
+    fields[1].name = "speed";
+    fields[1].type = SchemaFieldType::Float;
+    return fields;
+}
+
+// Props under two rooms: Glyph + Collider each, a Light on one in 50,
+// and a Stats instance on one in 3
+void populate(Stores& s) {
+    SceneDocument doc;
+    doc.version = "1.0.0";
+    doc.add_node(-1);
+    doc.node_id[0] = "root";
+    const int32_t rooms[2] = {doc.add_node(0), doc.add_node(0)};
+    doc.node_id[rooms[0]] = "room-a";
+    doc.node_id[rooms[1]] = "room-b";
+    doc.position[rooms[1]] = {40.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < PROP_COUNT; i++) {
+        const int32_t node = doc.add_node(rooms[i % 2]);
+        doc.node_id[node] = "n" + std::to_string(i);
+        doc.node_name[node] = "Prop";
+        doc.position[node] = {float(i % 32), float(i / 32), float(i % 3)};
+
+        GlyphComponent& glyph = doc.glyphs.emplace_back();
+        glyph.node = node;
+        glyph.id = "g" + std::to_string(i);
+        glyph.glyph = "#@T~"[i % 4];
+        glyph.fg = i % 2 ? "#ff8844" : "#88aaff";
+        ColliderComponent& collider = doc.colliders.emplace_back();
+        collider.node = node;
+        collider.id = "c" + std::to_string(i);
+        collider.layer = i % 5 ? "default" : "walls";
+        if (i % 50 == 0) {
+            LightComponent& light = doc.lights.emplace_back();
+            light.node = node;
+            light.id = "l" + std::to_string(i);
+            light.radius = float(i % 9);
+        }
+    }
+    spawn_scene(doc, s.world, s.index, s.materials);
+
+    s.tilemap.resize(96, 80, 2);
+    s.tilemap.fill_rect(0, 0, 0, 96, 80, {'.', 0, 0.0f});
+    s.tilemap.fill_rect(1, 10, 12, 30, 4, {'#', 1, 1.5f});
+    s.tilemap.set_layer_base(1, 0.25f);
+
+    SchemaStore& stats = s.schemas.define("Stats", stats_fields());
+    const int hp = stats.schema().find("hp");
+    const int speed = stats.schema().find("speed");
+    for (size_t i = 0; i < PROP_COUNT; i += 3) {
+        const uint32_t row = stats.add(s.index.find("n" + std::to_string(i)));
+        stats.set(row, hp, 0, double(i % 100));
+        stats.set(row, speed, 0, double(i % 7) * 0.5);
+    }
+}
+
+std::string node_id(const Stores& s, Entity entity) {
+    const SceneNode* node = s.world.get<const SceneNode>(entity);
+    return node ? std::string(s.index.str(node->id)) : std::string();
+}
+
+bool same_bytes(const auto& a, const auto& b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Everything the file holds, compared through the authored ids (entity
+// handles differ between the two worlds)
+void check_same(Stores& a, Stores& b) {
+    CHECK(a.world.size() == b.world.size());
+    CHECK(a.index.size() == b.index.size());
+    for (size_t i = 0; i < PROP_COUNT; i++) {
+        const std::string id = "n" + std::to_string(i);
+        const Entity ea = a.index.find(id);
+        const Entity eb = b.index.find(id);
+        CHECK(b.world.alive(eb));
+
+        const LocalTransform* la = a.world.get<const LocalTransform>(ea);
+        const LocalTransform* lb = b.world.get<const LocalTransform>(eb);
+        CHECK(la && lb && same_bytes(*la, *lb));
+        const WorldTransform* wa = a.world.get<const WorldTransform>(ea);
+        const WorldTransform* wb = b.world.get<const WorldTransform>(eb);
+        CHECK(wa && wb && same_bytes(*wa, *wb));
+
+        const Parent* pa = a.world.get<const Parent>(ea);
+        const Parent* pb = b.world.get<const Parent>(eb);
+        CHECK(pa && pb && node_id(a, pa->entity) == node_id(b, pb->entity));
+
+        const GlyphComponent* ga = a.world.get<const GlyphComponent>(ea);
+        const GlyphComponent* gb = b.world.get<const GlyphComponent>(eb);
+        CHECK(ga && gb && ga->glyph == gb->glyph && ga->fg == gb->fg && ga->id == gb->id);
+        const ColliderComponent* ca = a.world.get<const ColliderComponent>(ea);
+        const ColliderComponent* cb = b.world.get<const ColliderComponent>(eb);
+        CHECK(ca && cb && ca->layer == cb->layer && ca->blocks_movement == cb->blocks_movement);
+        const LightComponent* lia = a.world.get<const LightComponent>(ea);
+        const LightComponent* lib = b.world.get<const LightComponent>(eb);
+        CHECK((lia == nullptr) == (lib == nullptr));
+        CHECK(!lia || !lib || lia->radius == lib->radius);
+    }
+
+    // Sprites: the same glyphs on the same materials
+    size_t sprites[2] = {};
+    uint64_t sums[2] = {};
+    Stores* stores[2] = {&a, &b};
+    for (int k = 0; k < 2; k++) {
+        stores[k]->world.each<const GlyphSprite>([&](Entity, const GlyphSprite& sprite) {
+            sprites[k]++;
+            sums[k] += sprite.glyph * 31 + sprite.material;
+        });
+    }
+    CHECK(sprites[0] == sprites[1] && sums[0] == sums[1]);
+
+    CHECK(a.materials.size() == b.materials.size());
+    for (uint16_t m = 0; m < a.materials.size() && m < b.materials.size(); m++) {
+        CHECK(same_bytes(a.materials.get(m), b.materials.get(m)));
+    }
+
+    CHECK(a.tilemap.width() == b.tilemap.width() && a.tilemap.height() == b.tilemap.height());
+    CHECK(a.tilemap.layers() == b.tilemap.layers());
+    for (int layer = 0; layer < a.tilemap.layers() && layer < b.tilemap.layers(); layer++) {
+        CHECK(a.tilemap.layer_base(layer) == b.tilemap.layer_base(layer));
+        for (int y = 0; y < a.tilemap.height(); y++) {
+            for (int x = 0; x < a.tilemap.width(); x++) {
+                if (!(a.tilemap.get(layer, x, y) == b.tilemap.get(layer, x, y))) {
+                    CHECK(a.tilemap.get(layer, x, y) == b.tilemap.get(layer, x, y));
+                    return;
+                }
+            }
+        }
+    }
+
+    SchemaStore* sa = a.schemas.find("Stats");
+    SchemaStore* sb = b.schemas.find("Stats");
+    CHECK(sa && sb && sa->size() == sb->size());
+    for (size_t i = 0; sa && sb && i < PROP_COUNT; i += 3) {
+        const std::string id = "n" + std::to_string(i);
+        const uint32_t ra = sa->row(a.index.find(id));
+        const uint32_t rb = sb->row(b.index.find(id));
+        CHECK(sa->get(ra, 0) == sb->get(rb, 0) && sa->get(ra, 1) == sb->get(rb, 1));
+    }
+}
+
+void round_trip(bool compress) {
+    JobSystem jobs(2);
+    Stores saved;
+    populate(saved);
+    const StateSaveStats stats = save_state(PATH, saved.state(), jobs, compress);
+    CHECK(stats.entities == saved.world.size());
+    CHECK(compress ? stats.file_bytes < stats.raw_bytes : stats.file_bytes >= stats.raw_bytes);
+
+    // Into empty stores, and over stores that already hold other state
+    Stores fresh;
+    StateFile file(PATH);
+    const StateLoadStats loaded = load_state(file, fresh.state(), jobs);
+    CHECK(loaded.entities == saved.world.size());
+    check_same(saved, fresh);
+
+    Stores used;
+    used.world.spawn(LocalTransform{});
+    used.index.bind(used.index.intern("stale"), used.world.entity_at(0));
+    used.tilemap.resize(4, 4, 1);
+    StateFile again(PATH);
+    load_state(again, used.state(), jobs);
+    CHECK(!used.world.alive(used.index.find("stale")));
+    check_same(saved, used);
+    std::filesystem::remove(PATH);
+}
+
+void round_trip_raw() {
+    round_trip(false);
+}
+
+void round_trip_compressed() {
+    round_trip(true);
+}
+
+// A lazy reader decodes only the blocks a range falls in
+void reads_ranges_lazily() {
+    JobSystem jobs(2);
+    Stores saved;
+    populate(saved);
+    save_state(PATH, saved.state(), jobs, true);
+
+    StateFile file(PATH);
+    const size_t opened = file.decoded_bytes();     // Just the info
+    const size_t count = file.count(state_format::SectionId::LocalTransforms);
+    CHECK(count == saved.world.size());
+    const auto one = file.range<LocalTransform>(state_format::SectionId::LocalTransforms, count - 1, 1);
+    const size_t decoded = file.decoded_bytes() - opened;
+    CHECK(decoded > 0 && decoded < count * sizeof(LocalTransform));
+
+    StateFile whole(PATH);
+    const auto all = whole.get<LocalTransform>(state_format::SectionId::LocalTransforms, &jobs);
+    CHECK(one.size() == 1 && all.size() == count && same_bytes(one[0], all[count - 1]));
+    std::filesystem::remove(PATH);
+}
+
+// Overwrite the first element of a section in a raw-stored file
+void poke_section(state_format::SectionId id, uint32_t value) {
+    using namespace state_format;
+    std::fstream file(PATH, std::ios::in | std::ios::out | std::ios::binary);
+    Header header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<Section> sections(header.section_count);
+    file.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(Section));
+    std::vector<Block> blocks(header.block_count);
+    file.read(reinterpret_cast<char*>(blocks.data()), blocks.size() * sizeof(Block));
+    for (const Section& section : sections) {
+        if (section.id == static_cast<uint32_t>(id)) {
+            file.seekp(static_cast<std::streamoff>(blocks[section.first_block].offset));
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+}
+
+// A bad file throws and leaves the state as it was
+void rejects_bad_files() {
+    JobSystem jobs(2);
+    Stores saved;
+    populate(saved);
+    save_state(PATH, saved.state(), jobs, false);
+
+    Stores target;
+    populate(target);
+    target.tilemap.set(0, 1, 1, {'X', 0, 0.0f});
+    const size_t entities = target.world.size();
+
+    poke_section(state_format::SectionId::Parents, 0xFFFFFFF0u);
+    bool threw = false;
+    try {
+        StateFile file(PATH);
+        load_state(file, target.state(), jobs);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(target.world.size() == entities);
+    CHECK(target.world.alive(target.index.find("n7")));
+    CHECK(target.tilemap.get(0, 1, 1).glyph == 'X');
+
+    // Truncated, and not a state file at all
+    std::filesystem::resize_file(PATH, std::filesystem::file_size(PATH) / 2);
+    threw = false;
+    try {
+        StateFile file(PATH);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    {
+        std::ofstream junk(PATH, std::ios::binary | std::ios::trunc);
+        junk << "definitely not a state file, but long enough to hold a header";
+    }
+    threw = false;
+    try {
+        StateFile file(PATH);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    std::filesystem::remove(PATH);
+}
+
+// A type redefined since the save keeps its current fields; instances keep
+// the values of fields with the same name and type
+void migrates_changed_types() {
+    JobSystem jobs(2);
+    Stores saved;
+    populate(saved);
+    save_state(PATH, saved.state(), jobs, true);
+
+    Stores target;
+    std::vector<SchemaFieldDesc> fields(2);
+    fields[0].name = "speed";
+    fields[0].type = SchemaFieldType::Float;
+    fields[1].name = "mana";
+    fields[1].type = SchemaFieldType::Int;
+    fields[1].defaults[0] = 5;
+    target.schemas.define("Stats", fields);
+
+    StateFile file(PATH);
+    load_state(file, target.state(), jobs);
+    SchemaStore* stats = target.schemas.find("Stats");
+    CHECK(stats && stats->size() == saved.schemas.find("Stats")->size());
+    if (!stats) {
+        return;
+    }
+    // Fields are found by name: the packed layout orders them itself
+    const int speed = stats->schema().find("speed");
+    const int mana = stats->schema().find("mana");
+    CHECK(stats->schema().find("hp") < 0 && speed >= 0 && mana >= 0);
+    for (size_t i = 0; speed >= 0 && mana >= 0 && i < PROP_COUNT; i += 3) {
+        const uint32_t row = stats->row(target.index.find("n" + std::to_string(i)));
+        CHECK(stats->get(row, speed) == double(i % 7) * 0.5);
+        CHECK(stats->get(row, mana) == 5.0);
+    }
+    std::filesystem::remove(PATH);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"round_trip_raw", round_trip_raw},
+        {"round_trip_compressed", round_trip_compressed},
+        {"reads_ranges_lazily", reads_ranges_lazily},
+        {"rejects_bad_files", rejects_bad_files},
+        {"migrates_changed_types", migrates_changed_types},
+    });
+}
@@ -0,0 +1,368 @@
+#include "transform_hierarchy.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASCII_TRANSFORM_AVX2 1
+#endif
+
+namespace ascii {
+
+namespace {
+
+constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+constexpr size_t LANES = 8;
+constexpr size_t GRAIN_BLOCKS = 512;    // Blocks of 8 nodes per parallel range
+
+} // anonymous namespace
+
+void TransformHierarchy::Columns::resize(size_t count) {
+    for (auto* column : {&px, &py, &pz, &rx, &ry, &rz}) {
+        column->assign(count, 0.0f);
+    }
+    rw.assign(count, 1.0f);
+    for (auto* column : {&sx, &sy, &sz}) {
+        column->assign(count, 1.0f);
+    }
+}
+
+bool TransformHierarchy::simd_available() {
+#ifdef ASCII_TRANSFORM_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TransformHierarchy::rebuild(World& world) {
+    // Gather the hierarchy members
+    std::vector<Entity> entities;
+    std::vector<Entity> parents;
+    std::vector<const LocalTransform*> locals;
+    std::vector<WorldTransform*> components;
+    uint32_t max_index = 0;
+    // Read-only visit, so a play-mode snapshot copies nothing; update()
+    // touches a row before writing through its pointer
+    world.each<const Parent, const LocalTransform, const WorldTransform>(
+        [&](Entity entity, const Parent& parent, const LocalTransform& local, const WorldTransform& transform) {
+            entities.push_back(entity);
+            parents.push_back(parent.entity);
+            locals.push_back(&local);
+            components.push_back(const_cast<WorldTransform*>(&transform));
+            max_index = std::max(max_index, entity.index);
+        });
+    const size_t count = entities.size();
+
+    std::vector<uint32_t> gathered_of(entities.empty() ? 0 : max_index + 1, NO_NODE);
+    for (size_t i = 0; i < count; i++) {
+        gathered_of[entities[i].index] = static_cast<uint32_t>(i);
+    }
+    auto gathered_parent = [&](size_t i) {
+        const Entity parent = parents[i];
+        if (!parent.valid() || parent.index >= gathered_of.size()) {
+            return NO_NODE;
+        }
+        const uint32_t p = gathered_of[parent.index];
+        return p != NO_NODE && entities[p] == parent ? p : NO_NODE;
+    };
+
+    // Children lists (CSR), then breadth-first from the roots
+    std::vector<uint32_t> child_begin(count + 1, 0);
+    std::vector<uint32_t> parent_of(count);
+    for (size_t i = 0; i < count; i++) {
+        parent_of[i] = gathered_parent(i);
+        if (parent_of[i] != NO_NODE) {
+            child_begin[parent_of[i] + 1]++;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        child_begin[i + 1] += child_begin[i];
+    }
+    std::vector<uint32_t> children(child_begin[count]);
+    std::vector<uint32_t> fill(child_begin.begin(), child_begin.end() - 1);
+    for (size_t i = 0; i < count; i++) {
+        if (parent_of[i] != NO_NODE) {
+            children[fill[parent_of[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (parent_of[i] == NO_NODE) {
+            order.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    m_level_begin.assign(1, 0);
+    size_t level_end = order.size();
+    for (size_t cursor = 0; cursor < order.size(); cursor++) {
+        if (cursor == level_end) {
+            m_level_begin.push_back(static_cast<uint32_t>(level_end));
+            level_end = order.size();
+        }
+        const uint32_t i = order[cursor];
+        for (uint32_t c = child_begin[i]; c < child_begin[i + 1]; c++) {
+            order.push_back(children[c]);
+        }
+    }
+    m_level_begin.push_back(static_cast<uint32_t>(order.size()));  // Nodes in parent cycles are left out
+
+    // Lay the nodes out in that order
+    const size_t nodes = order.size();
+    std::vector<uint32_t> node_of_gathered(count, NO_NODE);
+    for (size_t n = 0; n < nodes; n++) {
+        node_of_gathered[order[n]] = static_cast<uint32_t>(n);
+    }
+    m_entity.resize(nodes);
+    m_parent.resize(nodes);
+    m_component.resize(nodes);
+    m_instance.assign(nodes, NO_INSTANCE);
+    m_dirty.assign(nodes + 1, 1);
+    m_dirty[nodes] = 0;                     // Identity node
+    m_changed.assign(nodes + 1, 0);
+    m_local.resize(nodes);
+    m_world.resize(nodes + 1);
+    m_node_of.assign(gathered_of.size(), NO_NODE);
+    for (size_t n = 0; n < nodes; n++) {
+        const uint32_t i = order[n];
+        m_entity[n] = entities[i];
+        m_parent[n] = parent_of[i] == NO_NODE ? static_cast<uint32_t>(nodes) : node_of_gathered[parent_of[i]];
+        m_component[n] = components[i];
+        m_node_of[entities[i].index] = static_cast<uint32_t>(n);
+        load_local(static_cast<uint32_t>(n), *locals[i]);
+    }
+
+    m_dirty_count = nodes;
+    m_changed_count = 0;
+    m_version = world.structure_version();
+    m_built = true;
+}
+
+uint32_t TransformHierarchy::node_of(Entity entity) const {
+    if (entity.index >= m_node_of.size()) {
+        return NO_NODE;
+    }
+    const uint32_t node = m_node_of[entity.index];
+    return node != NO_NODE && m_entity[node] == entity ? node : NO_NODE;
+}
+
+void TransformHierarchy::load_local(uint32_t node, const LocalTransform& local) {
+    // Same conversion as compose_transform: scene axes -> engine axes
+    const glm::vec3& euler = local.rotation;
+    const glm::quat rotation(glm::vec3(glm::radians(euler.x), glm::radians(euler.z), glm::radians(euler.y)));
+    const glm::vec3 position = scene_to_world(local.position);
+    const glm::vec3 scale = scene_to_world(local.scale);
+    m_local.px[node] = position.x;
+    m_local.py[node] = position.y;
+    m_local.pz[node] = position.z;
+    m_local.rx[node] = rotation.x;
+    m_local.ry[node] = rotation.y;
+    m_local.rz[node] = rotation.z;
+    m_local.rw[node] = rotation.w;
+    m_local.sx[node] = scale.x;
+    m_local.sy[node] = scale.y;
+    m_local.sz[node] = scale.z;
+}
+
+void TransformHierarchy::mark_dirty(const World& world, Entity entity) {
+    if (stale(world)) {
+        return;
+    }
+    const uint32_t node = node_of(entity);
+    const LocalTransform* local = world.get<LocalTransform>(entity);
+    if (node == NO_NODE || !local) {
+        return;
+    }
+    load_local(node, *local);
+    if (!m_dirty[node]) {
+        m_dirty[node] = 1;
+        m_dirty_count++;
+    }
+}
+
+void TransformHierarchy::bind_instance(Entity entity, uint32_t slot) {
+    const uint32_t node = node_of(entity);
+    if (node != NO_NODE) {
+        m_instance[node] = slot;
+    }
+}
+
+uint32_t TransformHierarchy::instance_of(Entity entity) const {
+    const uint32_t node = node_of(entity);
+    return node != NO_NODE ? m_instance[node] : NO_INSTANCE;
+}
+
+size_t TransformHierarchy::update(World& world, JobSystem& jobs, bool allow_simd) {
+    if (stale(world)) {
+        rebuild(world);
+    }
+    if (m_changed_count > 0) {
+        std::fill(m_changed.begin(), m_changed.end(), 0);
+        m_changed_count = 0;
+    }
+    if (m_dirty_count == 0) {
+        return 0;
+    }
+#ifndef ASCII_TRANSFORM_AVX2
+    allow_simd = false;
+#endif
+
+    const bool snapshot = world.snapshot_active();
+    std::atomic<size_t> recomputed{0};
+    for (size_t level = 0; level + 1 < m_level_begin.size(); level++) {
+        const size_t begin = m_level_begin[level];
+        const size_t end = m_level_begin[level + 1];
+        const size_t blocks = (end - begin + LANES - 1) / LANES;
+
+        jobs.parallel_for(blocks, GRAIN_BLOCKS, [&](size_t block_begin, size_t block_end) {
+            size_t local_count = 0;
+            for (size_t block = block_begin; block < block_end; block++) {
+                const size_t first = begin + block * LANES;
+                const size_t last = std::min(first + LANES, end);
+
+                // Dirty flags flow down from the (finished) level above
+                bool any = false;
+                for (size_t n = first; n < last; n++) {
+                    m_dirty[n] |= m_dirty[m_parent[n]];
+                    any |= m_dirty[n] != 0;
+                }
+                if (!any) {
+                    continue;
+                }
+
+                // Clean lanes are recomputed too (same result); only dirty ones are published
+                if (allow_simd && last - first == LANES) {
+                    compose_avx2(first, last);
+                } else {
+                    compose_scalar(first, last);
+                }
+                for (size_t n = first; n < last; n++) {
+                    if (!m_dirty[n]) {
+                        continue;
+                    }
+                    if (snapshot) {
+                        world.touch(m_entity[n]);
+                    }
+                    WorldTransform& out = *m_component[n];
+                    out.position = glm::vec3(m_world.px[n], m_world.py[n], m_world.pz[n]);
+                    out.rotation = glm::quat(m_world.rw[n], m_world.rx[n], m_world.ry[n], m_world.rz[n]);
+                    out.scale = glm::vec3(m_world.sx[n], m_world.sy[n], m_world.sz[n]);
+                    local_count++;
+                }
+            }
+            recomputed += local_count;
+        });
+    }
+
+    // This update's dirty set becomes the changed set; the old changed set is all clear
+    m_dirty.swap(m_changed);
+    m_changed_count = recomputed.load();
+    m_dirty_count = 0;
+    return m_changed_count;
+}
+
+void TransformHierarchy::compose_scalar(size_t begin, size_t end) {
+    Columns& w = m_world;
+    const Columns& l = m_local;
+    for (size_t n = begin; n < end; n++) {
+        const uint32_t p = m_parent[n];
+        const float qx = w.rx[p], qy = w.ry[p], qz = w.rz[p], qw = w.rw[p];
+
+        // Local position scaled by the parent, rotated by it: v + w*t + q x t with t = 2 q x v
+        const float vx = l.px[n] * w.sx[p], vy = l.py[n] * w.sy[p], vz = l.pz[n] * w.sz[p];
+        const float tx = 2.0f * (qy * vz - qz * vy);
+        const float ty = 2.0f * (qz * vx - qx * vz);
+        const float tz = 2.0f * (qx * vy - qy * vx);
+        w.px[n] = w.px[p] + vx + qw * tx + (qy * tz - qz * ty);
+        w.py[n] = w.py[p] + vy + qw * ty + (qz * tx - qx * tz);
+        w.pz[n] = w.pz[p] + vz + qw * tz + (qx * ty - qy * tx);
+
+        // Parent rotation * local rotation
+        const float bx = l.rx[n], by = l.ry[n], bz = l.rz[n], bw = l.rw[n];
+        w.rw[n] = qw * bw - qx * bx - qy * by - qz * bz;
+        w.rx[n] = qw * bx + qx * bw + qy * bz - qz * by;
+        w.ry[n] = qw * by - qx * bz + qy * bw + qz * bx;
+        w.rz[n] = qw * bz + qx * by - qy * bx + qz * bw;
+
+        w.sx[n] = w.sx[p] * l.sx[n];
+        w.sy[n] = w.sy[p] * l.sy[n];
+        w.sz[n] = w.sz[p] * l.sz[n];
+    }
+}
+
+#ifdef ASCII_TRANSFORM_AVX2
+
+void TransformHierarchy::compose_avx2(size_t begin, size_t) {
+    Columns& w = m_world;
+    const Columns& l = m_local;
+    const __m256i parent = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&m_parent[begin]));
+    auto gather = [&](const std::vector<float>& column) { return _mm256_i32gather_ps(column.data(), parent, 4); };
+    auto load = [&](const std::vector<float>& column) { return _mm256_loadu_ps(&column[begin]); };
+    auto store = [&](std::vector<float>& column, __m256 value) { _mm256_storeu_ps(&column[begin], value); };
+    auto madd = [](__m256 a, __m256 b, __m256 c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); };
+    auto msub = [](__m256 a, __m256 b, __m256 c) { return _mm256_sub_ps(_mm256_mul_ps(a, b), c); };
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    const __m256 qx = gather(w.rx), qy = gather(w.ry), qz = gather(w.rz), qw = gather(w.rw);
+    const __m256 psx = gather(w.sx), psy = gather(w.sy), psz = gather(w.sz);
+
+    // Same operation order as compose_scalar
+    const __m256 vx = _mm256_mul_ps(load(l.px), psx);
+    const __m256 vy = _mm256_mul_ps(load(l.py), psy);
+    const __m256 vz = _mm256_mul_ps(load(l.pz), psz);
+    const __m256 tx = _mm256_mul_ps(two, msub(qy, vz, _mm256_mul_ps(qz, vy)));
+    const __m256 ty = _mm256_mul_ps(two, msub(qz, vx, _mm256_mul_ps(qx, vz)));
+    const __m256 tz = _mm256_mul_ps(two, msub(qx, vy, _mm256_mul_ps(qy, vx)));
+    store(w.px, _mm256_add_ps(madd(qw, tx, _mm256_add_ps(gather(w.px), vx)), msub(qy, tz, _mm256_mul_ps(qz, ty))));
+    store(w.py, _mm256_add_ps(madd(qw, ty, _mm256_add_ps(gather(w.py), vy)), msub(qz, tx, _mm256_mul_ps(qx, tz))));
+    store(w.pz, _mm256_add_ps(madd(qw, tz, _mm256_add_ps(gather(w.pz), vz)), msub(qx, ty, _mm256_mul_ps(qy, tx))));
+
+    const __m256 bx = load(l.rx), by = load(l.ry), bz = load(l.rz), bw = load(l.rw);
+    store(w.rw, _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(qw, bw), _mm256_mul_ps(qx, bx)),
+                                            _mm256_mul_ps(qy, by)), _mm256_mul_ps(qz, bz)));
+    store(w.rx, _mm256_sub_ps(madd(qy, bz, madd(qx, bw, _mm256_mul_ps(qw, bx))), _mm256_mul_ps(qz, by)));
+    store(w.ry, madd(qz, bx, madd(qy, bw, msub(qw, by, _mm256_mul_ps(qx, bz)))));
+    store(w.rz, madd(qz, bw, _mm256_sub_ps(madd(qx, by, _mm256_mul_ps(qw, bz)), _mm256_mul_ps(qy, bx))));
+
+    store(w.sx, _mm256_mul_ps(psx, load(l.sx)));
+    store(w.sy, _mm256_mul_ps(psy, load(l.sy)));
+    store(w.sz, _mm256_mul_ps(psz, load(l.sz)));
+}
+
+#else
+
+void TransformHierarchy::compose_avx2(size_t begin, size_t end) {
+    compose_scalar(begin, end);
+}
+
+#endif
+
+size_t TransformHierarchy::write_instances(InstanceStore& instances, const glm::vec3& offset,
+                                           const glm::vec3& instance_scale, uint32_t& first, uint32_t& end) const {
+    first = UINT32_MAX;
+    end = 0;
+    if (m_changed_count == 0) {
+        return 0;
+    }
+    size_t written = 0;
+    for (size_t n = 0; n < m_entity.size(); n++) {
+        if (!m_changed[n] || m_instance[n] == NO_INSTANCE) {
+            continue;
+        }
+        const glm::vec3 position(m_world.px[n], m_world.py[n], m_world.pz[n]);
+        const glm::quat rotation(m_world.rw[n], m_world.rx[n], m_world.ry[n], m_world.rz[n]);
+        const glm::vec3 scale(m_world.sx[n], m_world.sy[n], m_world.sz[n]);
+        instances.set_position(m_instance[n], position + rotation * (scale * offset));
+        instances.set_rotation(m_instance[n], rotation);
+        instances.set_scale(m_instance[n], scale * instance_scale);
+        first = std::min(first, m_instance[n]);
+        end = std::max(end, m_instance[n] + 1);
+        written++;
+    }
+    return written;
+}
+
+} // namespace ascii
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "scene_world.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+
+// World transforms of every (Parent, LocalTransform, WorldTransform)
+// entity, kept as SoA columns in breadth-first order: roots first, then
+// each depth level with siblings next to each other. A level only reads
+// the one above it, so levels run one after another and each is split
+// over the job system, 8 nodes at a time through an AVX2 TRS compose
+// (scalar fallback otherwise).
+//
+// Only dirty subtrees are recomputed. Edits write LocalTransform and call
+// mark_dirty(); update() pushes the flags down, recomputes the flagged
+// nodes, and writes their WorldTransform components. Nodes bound to an
+// instance slot then feed the instance store directly (write_instances),
+// with no re-extraction. A structural change makes the order stale; the
+// next update() rebuilds it and recomputes everything.
+class TransformHierarchy {
+public:
+    static constexpr uint32_t NO_INSTANCE = 0xFFFFFFFFu;
+
+    // Re-read the hierarchy from the world (everything becomes dirty)
+    void rebuild(World& world);
+    bool stale(const World& world) const { return !m_built || m_version != world.structure_version(); }
+
+    // The entity's LocalTransform changed. Ignored while stale, since the
+    // rebuild recomputes everything anyway.
+    void mark_dirty(const World& world, Entity entity);
+
+    // Recompute dirty nodes and their descendants. Returns how many were
+    // recomputed. allow_simd = false forces the scalar path (benchmarks).
+    size_t update(World& world, JobSystem& jobs, bool allow_simd = true);
+
+    // Instance slot drawn at the node, kept until the next rebuild
+    void bind_instance(Entity entity, uint32_t slot);
+    uint32_t instance_of(Entity entity) const;     // NO_INSTANCE if none is bound
+
+    // For nodes recomputed by the last update() that have an instance:
+    // position = world position + rotation * (scale * offset),
+    // scale = world scale * instance_scale. Returns instances written; when
+    // there are any, their slots lie in [first, end).
+    size_t write_instances(InstanceStore& instances, const glm::vec3& offset, const glm::vec3& instance_scale,
+                           uint32_t& first, uint32_t& end) const;
+
+    size_t size() const { return m_entity.size(); }
+    size_t depth() const { return m_level_begin.empty() ? 0 : m_level_begin.size() - 1; }
+    size_t dirty_count() const { return m_dirty_count; }
+
+    static bool simd_available();
+
+private:
+    struct Columns {
+        std::vector<float> px, py, pz;
+        std::vector<float> rx, ry, rz, rw;
+        std::vector<float> sx, sy, sz;
+
+        void resize(size_t count);
+    };
+
+    uint32_t node_of(Entity entity) const;
+    void load_local(uint32_t node, const LocalTransform& local);
+    void compose_scalar(size_t begin, size_t end);
+    void compose_avx2(size_t begin, size_t end);
+
+    bool m_built = false;
+    uint64_t m_version = 0;
+
+    // By node, in breadth-first order
+    std::vector<Entity> m_entity;
+    std::vector<uint32_t> m_parent;             // Node index; roots point at the identity node (size())
+    std::vector<uint32_t> m_level_begin;        // Node range of each depth, plus the end
+    std::vector<WorldTransform*> m_component;   // Valid until the next structural change
+    std::vector<uint32_t> m_instance;
+    std::vector<uint8_t> m_dirty;               // Set by mark_dirty, pushed down and cleared by update
+    std::vector<uint8_t> m_changed;             // Recomputed by the last update
+    Columns m_local;                            // Engine axes, rotation as a quaternion
+    Columns m_world;                            // One extra identity node at the end
+
+    std::vector<uint32_t> m_node_of;            // Entity index -> node
+    size_t m_dirty_count = 0;
+    size_t m_changed_count = 0;
+};
+
+} // namespace ascii
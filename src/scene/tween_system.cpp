@@ -0,0 +1,502 @@
+#include "tween_system.hpp"
+#include "scene_world.hpp"
+#include "transform_hierarchy.hpp"
+#include "renderer/material_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASCII_TWEEN_AVX2 1
+#endif
+
+namespace ascii {
+
+namespace {
+
+constexpr int MAX_SPRING_STEPS = 32;       // Per evaluate(); longer frames take bigger steps
+
+struct EaseCoefficients {
+    float a, b, c, sym;
+};
+
+// In-curve u * (a + u * (b + u * c)) for each easing
+EaseCoefficients ease_coefficients(TweenSystem::Ease ease) {
+    switch (ease) {
+        case TweenSystem::Ease::QuadIn:     return {0.0f, 1.0f, 0.0f, 0.0f};
+        case TweenSystem::Ease::QuadOut:    return {2.0f, -1.0f, 0.0f, 0.0f};
+        case TweenSystem::Ease::QuadInOut:  return {0.0f, 1.0f, 0.0f, 1.0f};
+        case TweenSystem::Ease::CubicIn:    return {0.0f, 0.0f, 1.0f, 0.0f};
+        case TweenSystem::Ease::CubicOut:   return {3.0f, -3.0f, 1.0f, 0.0f};
+        case TweenSystem::Ease::CubicInOut: return {0.0f, 0.0f, 1.0f, 1.0f};
+        case TweenSystem::Ease::Smooth:     return {0.0f, 3.0f, -2.0f, 0.0f};
+        case TweenSystem::Ease::Linear:
+        default:                            return {1.0f, 0.0f, 0.0f, 0.0f};
+    }
+}
+
+float* transform_channel(LocalTransform& local, TweenSystem::Channel channel) {
+    const int c = static_cast<int>(channel);
+    if (c < 3) return &local.position[c];
+    if (c < 6) return &local.rotation[c - 3];
+    return &local.scale[c - 6];
+}
+
+float* material_channel(Material& material, TweenSystem::Channel channel) {
+    const int c = static_cast<int>(channel) - static_cast<int>(TweenSystem::Channel::ColorR);
+    return c < 4 ? &material.color[c] : &material.emission[c - 4];
+}
+
+template <typename Pool>
+void swap_remove(Pool& pool, size_t i) {
+    auto erase = [i](auto& column) {
+        column[i] = column.back();
+        column.pop_back();
+    };
+    if constexpr (requires { pool.key_first; }) {
+        for (auto* column : {&pool.time, &pool.inv_duration, &pool.ease_a, &pool.ease_b, &pool.ease_c,
+                             &pool.ease_sym, &pool.repeat, &pool.ping_pong, &pool.value}) {
+            erase(*column);
+        }
+        erase(pool.key_first);
+        erase(pool.key_last);
+    } else {
+        for (auto* column : {&pool.position, &pool.velocity, &pool.goal, &pool.stiffness, &pool.damping}) {
+            erase(*column);
+        }
+    }
+    erase(pool.id);
+    erase(pool.target);
+    erase(pool.done);
+}
+
+} // anonymous namespace
+
+bool TweenSystem::read(const World& world, const MaterialTable& materials, Target target, float& value) {
+    if (is_material_channel(target.channel)) {
+        const GlyphSprite* sprite = world.get<const GlyphSprite>(Entity::from_bits(target.id));
+        if (!sprite || !materials.contains(sprite->material)) {
+            return false;
+        }
+        Material material = materials.get(sprite->material);
+        value = *material_channel(material, target.channel);
+        return true;
+    }
+    const LocalTransform* local = world.get<const LocalTransform>(Entity::from_bits(target.id));
+    if (!local) {
+        return false;
+    }
+    LocalTransform copy = *local;
+    value = *transform_channel(copy, target.channel);
+    return true;
+}
+
+uint32_t TweenSystem::play(Target target, std::span<const float> keys, float duration, Ease ease, Loop loop,
+                           float delay) {
+    if (keys.empty()) {
+        return NO_TWEEN;
+    }
+    const uint32_t id = m_next_id++;
+    const EaseCoefficients coefficients = ease_coefficients(ease);
+    const int32_t first = static_cast<int32_t>(m_keys.size());
+    m_keys.insert(m_keys.end(), keys.begin(), keys.end());
+    if (keys.size() == 1) {
+        m_keys.push_back(keys[0]);     // Every tween interpolates between two keys at least
+    }
+
+    Keyed& k = m_keyed;
+    m_slot_of[id] = {false, static_cast<uint32_t>(k.id.size())};
+    k.id.push_back(id);
+    k.target.push_back(target);
+    k.time.push_back(-std::max(delay, 0.0f));
+    k.inv_duration.push_back(1.0f / std::max(duration, 1.0e-4f));
+    k.ease_a.push_back(coefficients.a);
+    k.ease_b.push_back(coefficients.b);
+    k.ease_c.push_back(coefficients.c);
+    k.ease_sym.push_back(coefficients.sym);
+    k.repeat.push_back(loop == Loop::Repeat ? 1.0f : 0.0f);
+    k.ping_pong.push_back(loop == Loop::PingPong ? 1.0f : 0.0f);
+    k.key_first.push_back(first);
+    k.key_last.push_back(static_cast<int32_t>(m_keys.size()) - 1);
+    k.value.push_back(keys[0]);
+    k.done.push_back(0);
+    return id;
+}
+
+uint32_t TweenSystem::spring(Target target, float from, float to, float stiffness, float damping) {
+    const uint32_t id = m_next_id++;
+    Springs& s = m_springs;
+    m_slot_of[id] = {true, static_cast<uint32_t>(s.id.size())};
+    s.id.push_back(id);
+    s.target.push_back(target);
+    s.position.push_back(from);
+    s.velocity.push_back(0.0f);
+    s.goal.push_back(to);
+    s.stiffness.push_back(std::max(stiffness, 0.0f));
+    s.damping.push_back(std::max(damping, 0.0f));
+    s.done.push_back(0);
+    return id;
+}
+
+bool TweenSystem::retarget(uint32_t id, float to) {
+    auto it = m_slot_of.find(id);
+    if (it == m_slot_of.end()) {
+        return false;
+    }
+    const uint32_t i = it->second.index;
+    if (it->second.spring) {
+        m_springs.goal[i] = to;
+        m_springs.done[i] = 0;
+        return true;
+    }
+    Keyed& k = m_keyed;
+    m_dead_keys += static_cast<size_t>(k.key_last[i] - k.key_first[i]) + 1;
+    k.key_first[i] = static_cast<int32_t>(m_keys.size());
+    m_keys.push_back(k.value[i]);
+    m_keys.push_back(to);
+    k.key_last[i] = k.key_first[i] + 1;
+    k.time[i] = 0.0f;
+    k.done[i] = 0;
+    compact_keys();
+    return true;
+}
+
+bool TweenSystem::stop(uint32_t id) {
+    if (!m_slot_of.contains(id)) {
+        return false;
+    }
+    remove(id);
+    return true;
+}
+
+void TweenSystem::remove(uint32_t id) {
+    auto it = m_slot_of.find(id);
+    const Slot slot = it->second;
+    m_slot_of.erase(it);
+    if (slot.spring) {
+        swap_remove(m_springs, slot.index);
+        if (slot.index < m_springs.id.size()) {
+            m_slot_of[m_springs.id[slot.index]].index = slot.index;
+        }
+        return;
+    }
+    m_dead_keys += static_cast<size_t>(m_keyed.key_last[slot.index] - m_keyed.key_first[slot.index]) + 1;
+    swap_remove(m_keyed, slot.index);
+    if (slot.index < m_keyed.id.size()) {
+        m_slot_of[m_keyed.id[slot.index]].index = slot.index;
+    }
+    compact_keys();
+}
+
+// Drop the keys of removed and retargeted tweens once they are most of m_keys
+void TweenSystem::compact_keys() {
+    if (m_dead_keys * 2 <= m_keys.size()) {
+        return;
+    }
+    std::vector<float> keys;
+    keys.reserve(m_keys.size() - m_dead_keys);
+    Keyed& k = m_keyed;
+    for (size_t i = 0; i < k.id.size(); i++) {
+        const int32_t first = static_cast<int32_t>(keys.size());
+        keys.insert(keys.end(), m_keys.begin() + k.key_first[i], m_keys.begin() + k.key_last[i] + 1);
+        k.key_last[i] = first + (k.key_last[i] - k.key_first[i]);
+        k.key_first[i] = first;
+    }
+    m_keys = std::move(keys);
+    m_dead_keys = 0;
+}
+
+uint16_t TweenSystem::private_material(World& world, MaterialTable& materials, Entity entity, uint16_t shared) {
+    // Take back one whose owner no longer uses it (entries that a restored
+    // or loaded material table dropped or shares are forgotten on the way)
+    for (auto it = m_private_of.begin(); it != m_private_of.end();) {
+        const uint16_t id = it->second;
+        if (!materials.contains(id) || !materials.is_private(id)) {
+            it = m_private_of.erase(it);
+            continue;
+        }
+        const GlyphSprite* owner = world.get<const GlyphSprite>(Entity::from_bits(it->first));
+        if (owner && owner->material == id) {
+            ++it;
+            continue;
+        }
+        m_private_of.erase(it);
+        materials.set(id, materials.get(shared));
+        m_private_of[entity.bits()] = id;
+        return id;
+    }
+    const uint16_t id = materials.add_private(materials.get(shared));
+    m_private_of[entity.bits()] = id;
+    return id;
+}
+
+void TweenSystem::clear() {
+    m_keyed = {};
+    m_springs = {};
+    m_keys.clear();
+    m_dead_keys = 0;
+    m_slot_of.clear();
+    m_dirty_materials.clear();
+    m_finished.clear();
+    m_rebound_sprites.clear();
+}
+
+bool TweenSystem::simd_available() {
+#ifdef ASCII_TWEEN_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TweenSystem::update(float dt, World& world, TransformHierarchy& transforms, MaterialTable& materials) {
+    evaluate(dt);
+    apply(world, transforms, materials);
+}
+
+void TweenSystem::evaluate(float dt, bool allow_simd) {
+    dt = std::max(dt, 0.0f);
+    const int steps = std::clamp(static_cast<int>(std::ceil(dt / MAX_SPRING_STEP)), 1, MAX_SPRING_STEPS);
+    const float step = dt / static_cast<float>(steps);
+
+    const size_t keyed = m_keyed.id.size();
+    const size_t springs = m_springs.id.size();
+    size_t keyed_done = 0;
+    size_t springs_done = 0;
+#ifdef ASCII_TWEEN_AVX2
+    if (allow_simd) {
+        keyed_done = keyed - keyed % 8;
+        springs_done = springs - springs % 8;
+        evaluate_keyed_avx2(0, keyed_done, dt);
+        evaluate_springs_avx2(0, springs_done, step, steps);
+    }
+#else
+    (void)allow_simd;
+#endif
+    evaluate_keyed_scalar(keyed_done, keyed, dt);
+    evaluate_springs_scalar(springs_done, springs, step, steps);
+
+    // Completion, outside the kernels
+    for (size_t i = 0; i < keyed; i++) {
+        m_keyed.done[i] = m_keyed.repeat[i] == 0.0f && m_keyed.ping_pong[i] == 0.0f &&
+                          m_keyed.time[i] * m_keyed.inv_duration[i] >= 1.0f;
+    }
+    for (size_t i = 0; i < springs; i++) {
+        Springs& s = m_springs;
+        s.done[i] = std::fabs(s.goal[i] - s.position[i]) < SPRING_REST && std::fabs(s.velocity[i]) < SPRING_REST;
+        if (s.done[i]) {
+            s.position[i] = s.goal[i];
+        }
+    }
+}
+
+void TweenSystem::evaluate_keyed_scalar(size_t begin, size_t end, float dt) {
+    Keyed& k = m_keyed;
+    for (size_t i = begin; i < end; i++) {
+        k.time[i] = k.time[i] + dt;
+        const float x = std::max(k.time[i] * k.inv_duration[i], 0.0f);
+        const float once = std::min(x, 1.0f);
+        const float repeat = x - std::floor(x);
+        const float half = x * 0.5f;
+        const float ping_pong = 1.0f - std::fabs(2.0f * (half - std::floor(half)) - 1.0f);
+        float u = k.repeat[i] > 0.5f ? repeat : once;
+        u = k.ping_pong[i] > 0.5f ? ping_pong : u;
+
+        const bool sym = k.ease_sym[i] > 0.5f;
+        const float w = sym ? 2.0f * std::min(u, 1.0f - u) : u;
+        float e = w * (k.ease_a[i] + w * (k.ease_b[i] + w * k.ease_c[i]));
+        if (sym) {
+            const float mirrored = 0.5f * e;
+            e = u < 0.5f ? mirrored : 1.0f - mirrored;
+        }
+
+        const int32_t span = k.key_last[i] - k.key_first[i];
+        const float p = e * static_cast<float>(span);
+        const int32_t key = std::clamp(static_cast<int32_t>(std::floor(p)), 0, span - 1);
+        const float frac = p - static_cast<float>(key);
+        const float k0 = m_keys[k.key_first[i] + key];
+        const float k1 = m_keys[k.key_first[i] + key + 1];
+        k.value[i] = k0 + (k1 - k0) * frac;
+    }
+}
+
+// Semi-implicit Euler, the same number of substeps for every spring
+void TweenSystem::evaluate_springs_scalar(size_t begin, size_t end, float step, int steps) {
+    Springs& s = m_springs;
+    for (size_t i = begin; i < end; i++) {
+        float x = s.position[i];
+        float v = s.velocity[i];
+        for (int n = 0; n < steps; n++) {
+            const float a = s.stiffness[i] * (s.goal[i] - x) - s.damping[i] * v;
+            v = v + a * step;
+            x = x + v * step;
+        }
+        s.position[i] = x;
+        s.velocity[i] = v;
+    }
+}
+
+#ifdef ASCII_TWEEN_AVX2
+
+void TweenSystem::evaluate_keyed_avx2(size_t begin, size_t end, float dt) {
+    Keyed& k = m_keyed;
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256i one_i = _mm256_set1_epi32(1);
+    auto load = [](const std::vector<float>& column, size_t i) { return _mm256_loadu_ps(&column[i]); };
+    auto load_i = [](const std::vector<int32_t>& column, size_t i) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&column[i]));
+    };
+
+    // Same operation order as evaluate_keyed_scalar
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 time = _mm256_add_ps(load(k.time, i), step);
+        _mm256_storeu_ps(&k.time[i], time);
+        const __m256 x = _mm256_max_ps(_mm256_mul_ps(time, load(k.inv_duration, i)), zero);
+        const __m256 once = _mm256_min_ps(x, one);
+        const __m256 repeat = _mm256_sub_ps(x, _mm256_floor_ps(x));
+        const __m256 h = _mm256_mul_ps(x, half);
+        const __m256 wave = _mm256_sub_ps(_mm256_mul_ps(two, _mm256_sub_ps(h, _mm256_floor_ps(h))), one);
+        const __m256 ping_pong = _mm256_sub_ps(one, _mm256_andnot_ps(sign, wave));
+        __m256 u = _mm256_blendv_ps(once, repeat, _mm256_cmp_ps(load(k.repeat, i), half, _CMP_GT_OQ));
+        u = _mm256_blendv_ps(u, ping_pong, _mm256_cmp_ps(load(k.ping_pong, i), half, _CMP_GT_OQ));
+
+        const __m256 sym = _mm256_cmp_ps(load(k.ease_sym, i), half, _CMP_GT_OQ);
+        const __m256 w = _mm256_blendv_ps(u, _mm256_mul_ps(two, _mm256_min_ps(u, _mm256_sub_ps(one, u))), sym);
+        __m256 e = _mm256_mul_ps(load(k.ease_c, i), w);
+        e = _mm256_mul_ps(w, _mm256_add_ps(load(k.ease_b, i), e));
+        e = _mm256_mul_ps(w, _mm256_add_ps(load(k.ease_a, i), e));
+        const __m256 mirrored = _mm256_mul_ps(half, e);
+        const __m256 folded = _mm256_blendv_ps(_mm256_sub_ps(one, mirrored), mirrored,
+                                               _mm256_cmp_ps(u, half, _CMP_LT_OQ));
+        e = _mm256_blendv_ps(e, folded, sym);
+
+        const __m256i first = load_i(k.key_first, i);
+        const __m256i span = _mm256_sub_epi32(load_i(k.key_last, i), first);
+        const __m256 p = _mm256_mul_ps(e, _mm256_cvtepi32_ps(span));
+        __m256i key = _mm256_cvttps_epi32(_mm256_floor_ps(p));
+        key = _mm256_max_epi32(_mm256_min_epi32(key, _mm256_sub_epi32(span, one_i)), _mm256_setzero_si256());
+        const __m256 frac = _mm256_sub_ps(p, _mm256_cvtepi32_ps(key));
+        const __m256i index = _mm256_add_epi32(first, key);
+        const __m256 k0 = _mm256_i32gather_ps(m_keys.data(), index, 4);
+        const __m256 k1 = _mm256_i32gather_ps(m_keys.data(), _mm256_add_epi32(index, one_i), 4);
+        _mm256_storeu_ps(&k.value[i], _mm256_add_ps(k0, _mm256_mul_ps(_mm256_sub_ps(k1, k0), frac)));
+    }
+}
+
+void TweenSystem::evaluate_springs_avx2(size_t begin, size_t end, float step, int steps) {
+    Springs& s = m_springs;
+    const __m256 h = _mm256_set1_ps(step);
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 stiffness = _mm256_loadu_ps(&s.stiffness[i]);
+        const __m256 damping = _mm256_loadu_ps(&s.damping[i]);
+        const __m256 goal = _mm256_loadu_ps(&s.goal[i]);
+        __m256 x = _mm256_loadu_ps(&s.position[i]);
+        __m256 v = _mm256_loadu_ps(&s.velocity[i]);
+        for (int n = 0; n < steps; n++) {
+            const __m256 a = _mm256_sub_ps(_mm256_mul_ps(stiffness, _mm256_sub_ps(goal, x)),
+                                           _mm256_mul_ps(damping, v));
+            v = _mm256_add_ps(v, _mm256_mul_ps(a, h));
+            x = _mm256_add_ps(x, _mm256_mul_ps(v, h));
+        }
+        _mm256_storeu_ps(&s.position[i], x);
+        _mm256_storeu_ps(&s.velocity[i], v);
+    }
+}
+
+#else
+
+void TweenSystem::evaluate_keyed_avx2(size_t begin, size_t end, float dt) {
+    evaluate_keyed_scalar(begin, end, dt);
+}
+
+void TweenSystem::evaluate_springs_avx2(size_t begin, size_t end, float step, int steps) {
+    evaluate_springs_scalar(begin, end, step, steps);
+}
+
+#endif
+
+size_t TweenSystem::apply(World& world, TransformHierarchy& transforms, MaterialTable& materials) {
+    m_dirty_materials.clear();
+    m_finished.clear();
+    m_rebound_sprites.clear();
+    m_dropped.clear();
+
+    // Transform writes go to one entity at a time; it is marked dirty after
+    // its last write in a row so the hierarchy loads the final values
+    Entity current = NULL_ENTITY;
+    LocalTransform* local = nullptr;
+    size_t written = 0;
+    auto write = [&](uint32_t id, Target target, float value) {
+        if (is_material_channel(target.channel)) {
+            GlyphSprite* sprite = world.get<GlyphSprite>(Entity::from_bits(target.id));
+            if (!sprite || !materials.contains(sprite->material)) {
+                m_dropped.push_back(id);
+                return;
+            }
+            if (!materials.is_private(sprite->material)) {
+                sprite->material = private_material(world, materials, Entity::from_bits(target.id), sprite->material);
+                m_rebound_sprites.push_back(Entity::from_bits(target.id));
+            }
+            Material material = materials.get(sprite->material);
+            *material_channel(material, target.channel) = value;
+            materials.set(sprite->material, material);
+            m_dirty_materials.push_back(sprite->material);
+            written++;
+            return;
+        }
+        const Entity entity = Entity::from_bits(target.id);
+        if (entity != current) {
+            if (local) {
+                transforms.mark_dirty(world, current);
+            }
+            current = entity;
+            local = world.get<LocalTransform>(entity);
+        }
+        if (!local) {
+            m_dropped.push_back(id);
+            return;
+        }
+        *transform_channel(*local, target.channel) = value;
+        written++;
+    };
+
+    for (size_t i = 0; i < m_keyed.id.size(); i++) {
+        if (m_keyed.time[i] >= 0.0f) {
+            write(m_keyed.id[i], m_keyed.target[i], m_keyed.value[i]);
+        }
+        if (m_keyed.done[i]) {
+            m_finished.push_back(m_keyed.id[i]);
+        }
+    }
+    for (size_t i = 0; i < m_springs.id.size(); i++) {
+        write(m_springs.id[i], m_springs.target[i], m_springs.position[i]);
+        if (m_springs.done[i]) {
+            m_finished.push_back(m_springs.id[i]);
+        }
+    }
+    if (local) {
+        transforms.mark_dirty(world, current);
+    }
+
+    std::sort(m_dirty_materials.begin(), m_dirty_materials.end());
+    m_dirty_materials.erase(std::unique(m_dirty_materials.begin(), m_dirty_materials.end()),
+                            m_dirty_materials.end());
+    std::sort(m_finished.begin(), m_finished.end());
+    for (uint32_t id : m_finished) {
+        remove(id);
+    }
+    for (uint32_t id : m_dropped) {
+        if (m_slot_of.contains(id)) {
+            remove(id);
+        }
+    }
+    return written;
+}
+
+} // namespace ascii
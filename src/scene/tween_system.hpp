@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ecs/world.hpp"
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class MaterialTable;
+class TransformHierarchy;
+
+// Native tweens for the float channels scripts animate every frame: an
+// entity's LocalTransform (scene space) and its sprite's material colors.
+// Two kinds:
+//  - keyed: evenly spaced keys over a duration (from/to is two keys),
+//    shaped by an easing and played once, repeated or ping-ponged
+//  - spring: a damped spring pulled toward a target, finishing once settled
+// Each kind is a structure-of-arrays pool evaluated in one pass per frame,
+// 8 tweens at a time with AVX2 (scalar fallback otherwise). A scalar
+// scatter then writes the values: LocalTransforms are marked dirty in the
+// transform hierarchy (whose update rewrites just those instances), edited
+// materials are listed for upload. The first color write to an entity
+// gives its GlyphSprite a private copy of its material, so glyphs sharing
+// the entry don't change with it; the copy is reused for another entity
+// once its owner is gone or uses a different material.
+class TweenSystem {
+public:
+    static constexpr uint32_t NO_TWEEN = 0xFFFFFFFFu;
+    static constexpr float MAX_SPRING_STEP = 1.0f / 120.0f;   // Substep length
+    static constexpr float SPRING_REST = 1.0e-3f;             // Distance and speed counted as settled
+
+    enum class Channel : uint8_t {
+        PositionX, PositionY, PositionZ,
+        RotationX, RotationY, RotationZ,
+        ScaleX, ScaleY, ScaleZ,
+        ColorR, ColorG, ColorB, Roughness,
+        EmissionR, EmissionG, EmissionB, EmissionPower,
+    };
+
+    // Polynomial easings; the InOut ones mirror the In curve around the midpoint
+    enum class Ease : uint8_t { Linear, QuadIn, QuadOut, QuadInOut, CubicIn, CubicOut, CubicInOut, Smooth };
+    enum class Loop : uint8_t { Once, Repeat, PingPong };
+
+    // Entity handle bits; material channels edit the entity's GlyphSprite material
+    struct Target {
+        uint64_t id = 0;
+        Channel channel = Channel::PositionX;
+    };
+
+    static bool is_material_channel(Channel channel) { return channel >= Channel::ColorR; }
+
+    // Current value of the target's channel; false when it doesn't exist
+    static bool read(const World& world, const MaterialTable& materials, Target target, float& value);
+
+    // Play keys (at least one) spread evenly over duration seconds,
+    // starting after delay. Returns the tween id.
+    uint32_t play(Target target, std::span<const float> keys, float duration, Ease ease = Ease::Linear,
+                  Loop loop = Loop::Once, float delay = 0.0f);
+
+    // Spring from `from` (at rest) toward `to`. Stiffness is in 1/s^2 and
+    // damping in 1/s; damping = 2 * sqrt(stiffness) is critically damped.
+    uint32_t spring(Target target, float from, float to, float stiffness, float damping);
+
+    // Aim a tween at a new end value. Springs keep their velocity; keyed
+    // tweens restart as a two-key tween from their current value.
+    bool retarget(uint32_t id, float to);
+    bool stop(uint32_t id);
+    bool contains(uint32_t id) const { return m_slot_of.contains(id); }
+    void clear();
+
+    // evaluate() then apply()
+    void update(float dt, World& world, TransformHierarchy& transforms, MaterialTable& materials);
+
+    // Advance every tween by dt and compute its value.
+    // allow_simd = false forces the scalar path (for benchmarks).
+    void evaluate(float dt, bool allow_simd = true);
+
+    // Write the values from the last evaluate(), then drop finished tweens
+    // and those whose target is gone. Returns the number of values written.
+    size_t apply(World& world, TransformHierarchy& transforms, MaterialTable& materials);
+
+    // From the last apply(): edited material ids (sorted), the tweens
+    // that ran to completion, and the entities whose sprite got a private
+    // material (their instances need its id)
+    const std::vector<uint16_t>& dirty_materials() const { return m_dirty_materials; }
+    const std::vector<uint32_t>& finished() const { return m_finished; }
+    const std::vector<Entity>& rebound_sprites() const { return m_rebound_sprites; }
+
+    size_t size() const { return m_slot_of.size(); }
+    size_t keyed_count() const { return m_keyed.id.size(); }
+    size_t spring_count() const { return m_springs.id.size(); }
+
+    // True when the AVX2 kernels were compiled in
+    static bool simd_available();
+
+private:
+    struct Slot {
+        bool spring;
+        uint32_t index;
+    };
+
+    // Keyed tweens (SoA). The easing is u * (a + u * (b + u * c)), mirrored
+    // when sym is 1; loop modes are 0/1 lane masks.
+    struct Keyed {
+        std::vector<uint32_t> id;
+        std::vector<Target> target;
+        std::vector<float> time;                   // Seconds, negative while delayed
+        std::vector<float> inv_duration;
+        std::vector<float> ease_a, ease_b, ease_c, ease_sym;
+        std::vector<float> repeat, ping_pong;
+        std::vector<int32_t> key_first;            // Into m_keys
+        std::vector<int32_t> key_last;             // key_first + key count - 1
+        std::vector<float> value;
+        std::vector<uint8_t> done;
+    };
+
+    struct Springs {
+        std::vector<uint32_t> id;
+        std::vector<Target> target;
+        std::vector<float> position, velocity, goal;
+        std::vector<float> stiffness, damping;
+        std::vector<uint8_t> done;
+    };
+
+    void evaluate_keyed_scalar(size_t begin, size_t end, float dt);
+    void evaluate_keyed_avx2(size_t begin, size_t end, float dt);
+    void evaluate_springs_scalar(size_t begin, size_t end, float step, int steps);
+    void evaluate_springs_avx2(size_t begin, size_t end, float step, int steps);
+    void remove(uint32_t id);
+    void compact_keys();
+    uint16_t private_material(World& world, MaterialTable& materials, Entity entity, uint16_t shared);
+
+    Keyed m_keyed;
+    Springs m_springs;
+    std::vector<float> m_keys;                     // Keys of every keyed tween
+    size_t m_dead_keys = 0;                        // Keys of removed tweens still in m_keys
+    std::unordered_map<uint32_t, Slot> m_slot_of;
+    uint32_t m_next_id = 0;
+
+    std::vector<uint16_t> m_dirty_materials;
+    std::vector<uint32_t> m_finished;
+    std::vector<Entity> m_rebound_sprites;
+    std::unordered_map<uint64_t, uint16_t> m_private_of;   // Entity bits -> private material given to it
+    std::vector<uint32_t> m_dropped;
+};
+
+} // namespace ascii
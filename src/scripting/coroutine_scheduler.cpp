@@ -0,0 +1,290 @@
+#include "coroutine_scheduler.hpp"
+#include "core/stopwatch.hpp"
+#include "core/slot_map.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ascii {
+
+namespace {
+
+// References made on a coroutine's stack keep that thread's lua_State and
+// use it again when pushed or released, after the thread may be gone. Keep
+// them on the main state instead.
+template<typename T, typename Ref>
+T on_main(lua_State* main, const Ref& value) {
+    value.push(main);
+    T result(main, -1);
+    lua_pop(main, 1);
+    return result;
+}
+
+} // anonymous namespace
+
+CoroutineScheduler::CoroutineScheduler(LuaRuntime& lua, double tick_seconds)
+    : m_lua(lua), m_wheel(tick_seconds) {
+}
+
+uint64_t CoroutineScheduler::spawn(const sol::protected_function& fn, const std::vector<sol::object>& args) {
+    lua_State* main = m_lua.state().lua_state();
+    uint32_t index;
+    if (!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_tasks.size());
+        m_tasks.emplace_back();
+    }
+    Task& task = m_tasks[index];
+    task.thread = sol::thread::create(main);
+    task.coroutine = sol::coroutine(task.thread.thread_state(), on_main<sol::protected_function>(main, fn));
+    task.args.clear();
+    for (const sol::object& arg : args) {
+        task.args.push_back(on_main<sol::object>(main, arg));
+    }
+    task.serial++;
+    task.wait = Wait::Ready;
+    m_ready.push_back({index, task.serial});
+    m_live++;
+    return Handle{index, task.generation}.bits();
+}
+
+bool CoroutineScheduler::kill(uint64_t id) {
+    const uint32_t index = find(id);
+    if (index == NO_TASK) {
+        return false;
+    }
+    if (index == m_running) {
+        m_tasks[index].killed = true;
+    } else {
+        finish(index);
+    }
+    return true;
+}
+
+bool CoroutineScheduler::contains(uint64_t id) const {
+    const uint32_t index = find(id);
+    return index != NO_TASK && !m_tasks[index].killed;
+}
+
+uint32_t CoroutineScheduler::signal(const std::string& name, const sol::object& value) {
+    auto it = m_events.find(name);
+    if (it == m_events.end() || it->second.waiters.empty()) {
+        return 0;
+    }
+    lua_State* main = m_lua.state().lua_state();
+    const sol::object result = value.valid() ? on_main<sol::object>(main, value) : sol::make_object(main, true);
+
+    // Waking can't add waiters, but take the list first all the same
+    std::vector<Waiter> waiters = std::move(it->second.waiters);
+    it->second.waiters.clear();
+    uint32_t woken = 0;
+    for (const Waiter& waiter : waiters) {
+        if (waiting(waiter, Wait::Event)) {
+            wake(waiter.task, {result});
+            woken++;
+        }
+    }
+    m_signalled += woken;
+    return woken;
+}
+
+void CoroutineScheduler::update(double dt) {
+    Stopwatch timer;
+    m_stats = {};
+    m_stats.signalled = m_signalled;
+    m_signalled = 0;
+
+    for (const Waiter& waiter : m_next_frame) {
+        if (waiting(waiter, Wait::Frame)) {
+            wake(waiter.task, {});
+        }
+    }
+    m_next_frame.clear();
+
+    // Sleeps end with no values, timed out waits with nil (event) or false
+    // (predicate)
+    m_fired.clear();
+    m_wheel.advance(dt, m_fired);
+    lua_State* main = m_lua.state().lua_state();
+    for (uint32_t index : m_fired) {
+        Task& task = m_tasks[index];
+        task.timer = TimerWheel::NO_TIMER;
+        m_stats.timers_fired++;
+        if (task.wait == Wait::Condition) {
+            wake(index, {sol::make_object(main, false)});
+        } else {
+            wake(index, {});
+        }
+    }
+
+    for (size_t i = 0; i < m_conditions.size();) {
+        const Waiter waiter = m_conditions[i];
+        bool keep = waiting(waiter, Wait::Condition);
+        if (keep) {
+            sol::protected_function condition = m_tasks[waiter.task].condition;
+            LuaRuntime::EntryScope entry(m_lua);
+            sol::protected_function_result result = condition();
+            m_stats.conditions_polled++;
+            if (!result.valid()) {
+                sol::error err = result;
+                m_lua.report_error(std::string("wait_until: ") + err.what());
+                finish(waiter.task);
+                keep = false;
+            } else if (result.get<bool>()) {
+                wake(waiter.task, {sol::make_object(main, true)});
+                keep = false;
+            }
+        }
+        if (keep) {
+            i++;
+        } else {
+            m_conditions[i] = m_conditions.back();
+            m_conditions.pop_back();
+        }
+    }
+
+    uint32_t resumed = 0;
+    while (!m_ready.empty() && resumed < m_budget) {
+        const Waiter waiter = m_ready.front();
+        m_ready.pop_front();
+        if (waiting(waiter, Wait::Ready)) {
+            resume(waiter.task);
+            resumed++;
+        }
+    }
+    m_stats.resumed = resumed;
+    m_stats.deferred = static_cast<uint32_t>(m_ready.size());
+    m_stats.ms = timer.elapsed_ms();
+}
+
+void CoroutineScheduler::wake(uint32_t index, std::vector<sol::object> args) {
+    Task& task = m_tasks[index];
+    if (task.timer != TimerWheel::NO_TIMER) {
+        m_wheel.cancel(task.timer);
+        task.timer = TimerWheel::NO_TIMER;
+    }
+    task.condition = sol::protected_function();
+    task.args = std::move(args);
+    task.serial++;
+    task.wait = Wait::Ready;
+    m_ready.push_back({index, task.serial});
+}
+
+void CoroutineScheduler::resume(uint32_t index) {
+    lua_State* main = m_lua.state().lua_state();
+    Task& task = m_tasks[index];
+    task.wait = Wait::Running;
+    m_running = index;
+
+    // The result lives on the coroutine's stack; it has to be read and
+    // released before finish() lets the thread go
+    bool failed = false;
+    bool yielded = false;
+    std::string error;
+    std::vector<sol::object> values;
+    {
+        sol::coroutine coroutine = task.coroutine;
+        const std::vector<sol::object> args = std::move(task.args);
+        task.args.clear();
+
+        // Threads only inherit the debug hook (the profiler's) when created
+        lua_State* thread = task.thread.thread_state();
+        lua_sethook(thread, lua_gethook(main), lua_gethookmask(main), lua_gethookcount(main));
+
+        LuaRuntime::EntryScope entry(m_lua);
+        sol::protected_function_result result = coroutine(sol::as_args(args));
+        if (!result.valid()) {
+            sol::error err = result;
+            error = err.what();
+            failed = true;
+        } else if (result.status() == sol::call_status::yielded) {
+            yielded = true;
+            for (int i = 0; i < result.return_count(); i++) {
+                values.push_back(on_main<sol::object>(main, result.get<sol::object>(i)));
+            }
+        }
+    }
+    m_running = NO_TASK;
+
+    if (failed) {
+        m_lua.report_error("coroutine: " + error);
+    }
+    if (!yielded || task.killed) {
+        finish(index);
+        return;
+    }
+
+    // What the coroutine waits on next; a timeout follows an event name or
+    // predicate
+    const sol::object what = values.empty() ? sol::object(sol::lua_nil) : values[0];
+    double timeout = -1.0;
+    if (values.size() > 1 && values[1].get_type() == sol::type::number) {
+        timeout = values[1].as<double>();
+    }
+    task.serial++;
+    switch (what.get_type()) {
+    case sol::type::lua_nil:
+        task.wait = Wait::Frame;
+        break;
+    case sol::type::number:
+        timeout = what.as<double>();
+        task.wait = timeout > 0.0 ? Wait::Timer : Wait::Frame;
+        break;
+    case sol::type::string: {
+        task.wait = Wait::Event;
+        EventList& list = m_events[what.as<std::string>()];
+        if (list.waiters.size() >= list.prune_at) {
+            std::erase_if(list.waiters, [this](const Waiter& w) { return !waiting(w, Wait::Event); });
+            list.prune_at = std::max<size_t>(32, list.waiters.size() * 2);
+        }
+        list.waiters.push_back({index, task.serial});
+        break;
+    }
+    case sol::type::function:
+        task.wait = Wait::Condition;
+        task.condition = on_main<sol::protected_function>(main, what);
+        m_conditions.push_back({index, task.serial});
+        break;
+    default:
+        m_lua.report_error(std::string("coroutine: can't wait on a ") + sol::type_name(main, what.get_type()));
+        finish(index);
+        return;
+    }
+    if (task.wait == Wait::Frame) {
+        m_next_frame.push_back({index, task.serial});
+    } else if (timeout >= 0.0) {
+        task.timer = m_wheel.schedule(timeout, index);
+    }
+}
+
+void CoroutineScheduler::finish(uint32_t index) {
+    Task& task = m_tasks[index];
+    if (task.timer != TimerWheel::NO_TIMER) {
+        m_wheel.cancel(task.timer);
+        task.timer = TimerWheel::NO_TIMER;
+    }
+    task.condition = sol::protected_function();
+    task.args.clear();
+    task.coroutine = sol::coroutine();         // Before the thread it runs on
+    task.thread = sol::thread();
+    task.generation++;
+    task.serial++;
+    task.wait = Wait::Free;
+    task.killed = false;
+    m_free.push_back(index);
+    m_live--;
+    m_stats.finished++;
+}
+
+uint32_t CoroutineScheduler::find(uint64_t id) const {
+    const Handle handle = Handle::from_bits(id);
+    if (handle.index >= m_tasks.size()) {
+        return NO_TASK;
+    }
+    const Task& task = m_tasks[handle.index];
+    return task.wait != Wait::Free && task.generation == handle.generation ? handle.index : NO_TASK;
+}
+
+} // namespace ascii
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "core/timer_wheel.hpp"
+#include "lua_runtime.hpp"
+
+#include <sol/sol.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+// Counters of one CoroutineScheduler::update()
+struct SchedulerStats {
+    uint32_t resumed = 0;              // Coroutines resumed
+    uint32_t timers_fired = 0;         // Sleeps and wait timeouts that ran out
+    uint32_t signalled = 0;            // Woken by signal() since the previous update
+    uint32_t conditions_polled = 0;    // wait_until predicates called
+    uint32_t deferred = 0;             // Ready but over the budget; first in line next frame
+    uint32_t finished = 0;             // Returned, failed or killed
+    double ms = 0.0;
+};
+
+// Script behaviors as Lua coroutines, resumed only when what they wait on
+// happened. A coroutine yields what it waits for:
+//  - seconds: a timer in a hierarchical TimerWheel
+//  - an event name (and optional timeout): that name's wait list, woken by
+//    signal()
+//  - a predicate (and optional timeout): called once per frame without
+//    resuming the coroutine, which wakes once it returns true
+//  - nothing (or zero seconds): the next frame
+// Woken coroutines queue in wake order and update() resumes at most
+// budget() of them; the rest stay first in line for the next frame.
+class CoroutineScheduler {
+public:
+    static constexpr uint32_t DEFAULT_BUDGET = 4096;
+
+    explicit CoroutineScheduler(LuaRuntime& lua, double tick_seconds = 1.0 / 1000.0);
+
+    // Non-copyable
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    // Run fn(args...) as a coroutine from the next update(). Returns the
+    // task id (Handle bits).
+    uint64_t spawn(const sol::protected_function& fn, const std::vector<sol::object>& args = {});
+
+    // A task killed from inside its own coroutine stops at its next yield
+    bool kill(uint64_t id);
+    bool contains(uint64_t id) const;
+
+    // Wake every task waiting on `name` with `value` (true when nil).
+    // Returns how many woke.
+    uint32_t signal(const std::string& name, const sol::object& value = sol::lua_nil);
+
+    // Advance timers by dt, poll predicates and resume what woke
+    void update(double dt);
+
+    void set_budget(uint32_t budget) { m_budget = budget; }
+    uint32_t budget() const { return m_budget; }
+
+    const SchedulerStats& stats() const { return m_stats; }
+    size_t size() const { return m_live; }
+    size_t timers() const { return m_wheel.size(); }
+
+private:
+    static constexpr uint32_t NO_TASK = 0xFFFFFFFFu;
+
+    enum class Wait : uint8_t { Free, Ready, Running, Frame, Timer, Event, Condition };
+
+    struct Task {
+        sol::thread thread;
+        sol::coroutine coroutine;              // Runs on `thread`
+        sol::protected_function condition;
+        std::vector<sol::object> args;         // Passed to the next resume
+        uint32_t generation = 0;
+        uint32_t serial = 0;                   // Bumped on every wake, so stale waiters don't match
+        uint32_t timer = TimerWheel::NO_TIMER;
+        Wait wait = Wait::Free;
+        bool killed = false;
+    };
+
+    // Entry of the ready queue or a wait list, valid while the serial matches
+    struct Waiter {
+        uint32_t task;
+        uint32_t serial;
+    };
+
+    struct EventList {
+        std::vector<Waiter> waiters;
+        size_t prune_at = 32;                  // Drop stale waiters when the list reaches this size
+    };
+
+    bool waiting(const Waiter& waiter, Wait wait) const {
+        const Task& task = m_tasks[waiter.task];
+        return task.serial == waiter.serial && task.wait == wait;
+    }
+
+    void wake(uint32_t index, std::vector<sol::object> args);
+    void resume(uint32_t index);
+    void finish(uint32_t index);
+    uint32_t find(uint64_t id) const;
+
+    LuaRuntime& m_lua;
+    std::deque<Task> m_tasks;                  // Deque: resumed scripts may spawn while a task is referenced
+    std::vector<uint32_t> m_free;
+    size_t m_live = 0;
+    uint32_t m_running = NO_TASK;
+
+    TimerWheel m_wheel;
+    std::deque<Waiter> m_ready;
+    std::vector<Waiter> m_next_frame;
+    std::vector<Waiter> m_conditions;
+    std::unordered_map<std::string, EventList> m_events;
+    std::vector<uint32_t> m_fired;
+
+    uint32_t m_budget = DEFAULT_BUDGET;
+    uint32_t m_signalled = 0;
+    SchedulerStats m_stats;
+};
+
+} // namespace ascii
@@ -0,0 +1,183 @@
+#include "scripting/coroutine_scheduler.hpp"
+#include "core/test.hpp"
+#include "scripting/engine_api.hpp"
+#include "scripting/lua_runtime.hpp"
+
+#include <sol/sol.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+using namespace ascii;
+
+namespace {
+
+constexpr double FRAME = 1.0 / 60.0;
+
+// Each behavior appends to `log` when it gets past a wait
+constexpr const char* BEHAVIORS_LUA = R"(
+log = {}
+
+function logged()
+    return table.concat(log, ",")
+end
+
+function sleeper(name, seconds)
+    engine.wait(seconds)
+    log[#log + 1] = name
+end
+
+function listener(name, event, timeout)
+    local value = engine.wait_event(event, timeout)
+    log[#log + 1] = name .. "=" .. tostring(value)
+end
+
+flag = false
+function watcher(name)
+    local ok = engine.wait_until(function() return flag end)
+    log[#log + 1] = name .. "=" .. tostring(ok)
+end
+
+function self_killer()
+    log[#log + 1] = "before"
+    engine.kill(self_id)
+    log[#log + 1] = "same resume"
+    engine.wait()
+    log[#log + 1] = "after"
+end
+
+function killer()
+    engine.kill(victim_id)
+    log[#log + 1] = "killer"
+end
+)";
+
+// A runtime with the scheduler bound and the behaviors loaded
+struct Fixture {
+    LuaRuntime lua;
+    CoroutineScheduler scheduler{lua};
+
+    Fixture() {
+        bind_scheduler(lua, scheduler);
+        lua.state().script(BEHAVIORS_LUA);
+    }
+
+    template<typename... Args>
+    uint64_t spawn(const char* behavior, Args&&... args) {
+        sol::protected_function fn = lua.state()[behavior];
+        return scheduler.spawn(fn, {sol::make_object(lua.state(), std::forward<Args>(args))...});
+    }
+
+    std::string log() {
+        sol::protected_function logged = lua.state()["logged"];
+        return logged().get<std::string>();
+    }
+};
+
+// A killed sleeper's timer is cancelled: time passing its due never
+// resumes it
+void kill_sleeping() {
+    Fixture f;
+    const uint64_t id = f.spawn("sleeper", "a", 1.0);
+    f.scheduler.update(FRAME);
+    CHECK(f.scheduler.timers() == 1 && f.scheduler.contains(id));
+
+    CHECK(f.scheduler.kill(id));
+    CHECK(!f.scheduler.kill(id));
+    CHECK(!f.scheduler.contains(id) && f.scheduler.size() == 0 && f.scheduler.timers() == 0);
+    f.scheduler.update(2.0);
+    CHECK(f.scheduler.stats().resumed == 0 && f.scheduler.stats().timers_fired == 0);
+    CHECK(f.log().empty());
+}
+
+// A task reusing a killed task's slot (and timer id) is not woken by what
+// the killed one waited on, and the stale id can't touch it
+void slot_reuse_after_kill() {
+    Fixture f;
+    const uint64_t a = f.spawn("sleeper", "a", 1.0);
+    f.scheduler.update(FRAME);
+    f.scheduler.kill(a);
+    const uint64_t b = f.spawn("sleeper", "b", 2.0);
+    CHECK(a != b);
+    CHECK(!f.scheduler.kill(a) && f.scheduler.contains(b));
+    f.scheduler.update(FRAME);
+
+    f.scheduler.update(1.5);                  // Past a's due, not b's
+    CHECK(f.log().empty());
+    f.scheduler.update(1.0);
+    CHECK(f.log() == "b");
+
+    const uint64_t c = f.spawn("listener", "c", "ping");
+    f.scheduler.update(FRAME);
+    f.scheduler.kill(c);
+    const uint64_t d = f.spawn("listener", "d", "ping");
+    f.scheduler.update(FRAME);
+    CHECK(f.scheduler.signal("ping", sol::make_object(f.lua.state(), 7)) == 1);
+    f.scheduler.update(FRAME);
+    CHECK(f.log() == "b,d=7");
+    CHECK(!f.scheduler.contains(d) && f.scheduler.size() == 0);
+}
+
+// Killed after waking but before its resume: it stays dead
+void kill_while_ready() {
+    Fixture f;
+    const uint64_t id = f.spawn("listener", "a", "go");
+    f.scheduler.update(FRAME);
+    CHECK(f.scheduler.signal("go") == 1);
+    CHECK(f.scheduler.kill(id));
+    f.scheduler.update(FRAME);
+    CHECK(f.scheduler.stats().resumed == 0);
+    CHECK(f.log().empty());
+}
+
+// Waits with a timeout and predicates: neither the timeout nor the
+// predicate coming true wakes a killed task
+void kill_timed_and_conditional_waits() {
+    Fixture f;
+    const uint64_t timed = f.spawn("listener", "a", "never", 0.5);
+    const uint64_t watching = f.spawn("watcher", "w");
+    f.scheduler.update(FRAME);
+    CHECK(f.scheduler.timers() == 1);
+    f.scheduler.kill(timed);
+    f.scheduler.kill(watching);
+    CHECK(f.scheduler.timers() == 0);
+
+    f.lua.state()["flag"] = true;
+    f.scheduler.update(1.0);
+    CHECK(f.scheduler.stats().resumed == 0 && f.scheduler.stats().conditions_polled == 0);
+    CHECK(f.log().empty());
+}
+
+// Killing itself stops a task at its next yield; killing a task queued
+// behind the running one keeps it from resuming
+void kill_from_scripts() {
+    Fixture f;
+    const uint64_t self = f.spawn("self_killer");
+    f.lua.state()["self_id"] = self;
+    f.scheduler.update(FRAME);
+    CHECK(f.log() == "before,same resume");
+    CHECK(!f.scheduler.contains(self) && f.scheduler.size() == 0);
+    f.scheduler.update(FRAME);
+    CHECK(f.log() == "before,same resume");
+
+    f.spawn("killer");
+    const uint64_t victim = f.spawn("sleeper", "victim", 0.0);
+    f.lua.state()["victim_id"] = victim;
+    f.scheduler.update(FRAME);
+    f.scheduler.update(FRAME);
+    CHECK(f.log() == "before,same resume,killer");
+    CHECK(f.scheduler.size() == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"kill_sleeping", kill_sleeping},
+        {"slot_reuse_after_kill", slot_reuse_after_kill},
+        {"kill_while_ready", kill_while_ready},
+        {"kill_timed_and_conditional_waits", kill_timed_and_conditional_waits},
+        {"kill_from_scripts", kill_from_scripts},
+    });
+}
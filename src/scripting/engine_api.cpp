@@ -0,0 +1,1149 @@
+#include "engine_api.hpp"
+#include "coroutine_scheduler.hpp"
+#include "lua_workers.hpp"
+#include "ecs/schema.hpp"
+#include "renderer/material_table.hpp"
+#include "renderer/particle_system.hpp"
+#include "scene/scene_instantiate.hpp"
+#include "scene/scene_physics.hpp"
+#include "scene/scene_proximity.hpp"
+#include "scene/scene_world.hpp"
+#include "scene/transform_hierarchy.hpp"
+#include "scene/tween_system.hpp"
+#include "world/field_of_view.hpp"
+#include "world/pathfinding.hpp"
+#include "world/tilemap.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+namespace {
+
+// Script-side color value, components usually 0..1
+struct Color {
+    float r = 1.0f;
+    float g = 1.0f;
+    float b = 1.0f;
+    float a = 1.0f;
+};
+
+Color color_lerp(const Color& x, const Color& y, float t) {
+    return {x.r + (y.r - x.r) * t, x.g + (y.g - x.g) * t, x.b + (y.b - x.b) * t, x.a + (y.a - x.a) * t};
+}
+
+// Components of a vec2, vec3, vec4 or color userdata into `out`; returns
+// how many there are (0: not one of them)
+int vector_from_userdata(const sol::object& value, glm::vec4& out) {
+    if (value.get_type() != sol::type::userdata) {
+        return 0;
+    }
+    if (value.is<glm::vec3>()) {
+        out = glm::vec4(value.as<glm::vec3>(), 0.0f);
+        return 3;
+    }
+    if (value.is<Color>()) {
+        const Color c = value.as<Color>();
+        out = glm::vec4(c.r, c.g, c.b, c.a);
+        return 4;
+    }
+    if (value.is<glm::vec2>()) {
+        out = glm::vec4(value.as<glm::vec2>(), 0.0f, 0.0f);
+        return 2;
+    }
+    if (value.is<glm::vec4>()) {
+        out = value.as<glm::vec4>();
+        return 4;
+    }
+    return 0;
+}
+
+// {x, y, z} table or vector userdata (a color gives r, g, b)
+glm::vec3 vec3_from_lua(const sol::object& value, const glm::vec3& fallback) {
+    glm::vec4 v;
+    if (const int lanes = vector_from_userdata(value, v)) {
+        glm::vec3 result = fallback;
+        for (int i = 0; i < std::min(lanes, 3); i++) {
+            result[i] = v[i];
+        }
+        return result;
+    }
+    if (value.get_type() != sol::type::table) {
+        return fallback;
+    }
+    sol::table t = value.as<sol::table>();
+    return {t.get_or(1, fallback.x), t.get_or(2, fallback.y), t.get_or(3, fallback.z)};
+}
+
+// Zero vectors stay zero instead of turning into NaNs
+template<typename Vec>
+Vec safe_normalize(const Vec& v) {
+    const float length_sq = glm::dot(v, v);
+    return length_sq > 0.0f ? v / std::sqrt(length_sq) : v;
+}
+
+// vecN(), vecN(s) for every component, vecN(x, y, ...) with missing ones
+// 0, vecN({x, y, ...}) or a copy of another vecN
+template<typename Vec>
+Vec vector_from_args(const sol::variadic_args& va) {
+    constexpr int N = Vec::length();
+    Vec v(0.0f);
+    if (va.size() == 1) {
+        const sol::stack_proxy arg = va[0];
+        switch (arg.get_type()) {
+            case sol::type::number:
+                return Vec(arg.as<float>());
+            case sol::type::table: {
+                sol::table t = arg.as<sol::table>();
+                for (int i = 0; i < N; i++) {
+                    v[i] = t.get_or(i + 1, 0.0f);
+                }
+                return v;
+            }
+            case sol::type::userdata:
+                if (arg.is<Vec>()) {
+                    return arg.as<Vec>();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    for (int i = 0; i < N && i < static_cast<int>(va.size()); i++) {
+        v[i] = va[i].as<float>();
+    }
+    return v;
+}
+
+template<typename Vec>
+auto vector_unpack(const Vec& v) {
+    if constexpr (Vec::length() == 2) {
+        return std::make_tuple(v.x, v.y);
+    } else if constexpr (Vec::length() == 3) {
+        return std::make_tuple(v.x, v.y, v.z);
+    } else {
+        return std::make_tuple(v.x, v.y, v.z, v.w);
+    }
+}
+
+template<typename Vec>
+std::string vector_to_string(const char* name, const Vec& v) {
+    std::string text = std::string(name) + "(";
+    for (int i = 0; i < Vec::length(); i++) {
+        text += i ? ", " : "";
+        text += fmt::format("{:g}", v[i]);
+    }
+    return text + ")";
+}
+
+// Operators and -ed methods make new values; verbs (set, add, sub, scale,
+// normalize, lerp) change the vector in place and allocate nothing
+template<typename Vec>
+sol::usertype<Vec> bind_vector(sol::state& state, const char* name) {
+    sol::usertype<Vec> type = state.new_usertype<Vec>(name,
+        sol::call_constructor, [](const sol::table&, sol::variadic_args va) { return vector_from_args<Vec>(va); },
+        sol::meta_function::addition, [](const Vec& a, const Vec& b) { return a + b; },
+        sol::meta_function::subtraction, [](const Vec& a, const Vec& b) { return a - b; },
+        sol::meta_function::multiplication, sol::overload(
+            [](const Vec& a, const Vec& b) { return a * b; },
+            [](const Vec& a, float s) { return a * s; },
+            [](float s, const Vec& a) { return s * a; }),
+        sol::meta_function::division, sol::overload(
+            [](const Vec& a, const Vec& b) { return a / b; },
+            [](const Vec& a, float s) { return a / s; }),
+        sol::meta_function::unary_minus, [](const Vec& a) { return -a; },
+        sol::meta_function::equal_to, [](const Vec& a, const Vec& b) { return a == b; },
+        sol::meta_function::to_string, [name](const Vec& a) { return vector_to_string(name, a); },
+        "x", &Vec::x,
+        "y", &Vec::y,
+        "length", [](const Vec& a) { return glm::length(a); },
+        "length_sq", [](const Vec& a) { return glm::dot(a, a); },
+        "dot", [](const Vec& a, const Vec& b) { return glm::dot(a, b); },
+        "distance", [](const Vec& a, const Vec& b) { return glm::distance(a, b); },
+        "normalized", [](const Vec& a) { return safe_normalize(a); },
+        "lerped", [](const Vec& a, const Vec& b, float t) { return a + (b - a) * t; },
+        "copy", [](const Vec& a) { return a; },
+        "unpack", &vector_unpack<Vec>,
+        "set", [](Vec& a, sol::variadic_args va) { a = vector_from_args<Vec>(va); },
+        "add", [](Vec& a, const Vec& b) { a += b; },
+        "sub", [](Vec& a, const Vec& b) { a -= b; },
+        "scale", sol::overload(
+            [](Vec& a, float s) { a *= s; },
+            [](Vec& a, const Vec& b) { a *= b; }),
+        "normalize", [](Vec& a) { a = safe_normalize(a); },
+        "lerp", [](Vec& a, const Vec& b, float t) { a += (b - a) * t; });
+    if constexpr (Vec::length() >= 3) {
+        type["z"] = &Vec::z;
+    }
+    if constexpr (Vec::length() >= 4) {
+        type["w"] = &Vec::w;
+    }
+    return type;
+}
+
+uint32_t glyph_from_lua(const sol::object& value) {
+    switch (value.get_type()) {
+        case sol::type::string:
+            return decode_glyph(value.as<std::string>());
+        case sol::type::number:
+            return value.as<uint32_t>();
+        default:
+            return 0;
+    }
+}
+
+// Raises a Lua error for a material the table doesn't have (the renderer
+// would read past the material buffer)
+Tile tile_from_lua(const sol::object& value, const MaterialTable& materials) {
+    Tile tile;
+    if (value.get_type() != sol::type::table) {
+        return tile;  // nil clears
+    }
+    sol::table t = value.as<sol::table>();
+    const int64_t material = t.get_or("material", int64_t(0));
+    if (material < 0 || !materials.contains(static_cast<uint32_t>(material))) {
+        throw std::runtime_error("Unknown material id: " + std::to_string(material));
+    }
+    tile.glyph = glyph_from_lua(t["glyph"]);
+    tile.material = static_cast<uint16_t>(material);
+    tile.height = t.get_or("height", 1.0f);
+    return tile;
+}
+
+sol::object tile_to_lua(sol::this_state s, const Tile& tile) {
+    sol::state_view lua(s);
+    if (tile.empty()) {
+        return sol::make_object(lua, sol::lua_nil);
+    }
+    sol::table t = lua.create_table();
+    t["glyph"] = encode_glyph(tile.glyph);
+    t["material"] = tile.material;
+    t["height"] = tile.height;
+    return t;
+}
+
+std::vector<std::string> rows_from_lua(const sol::object& value) {
+    std::vector<std::string> rows;
+    if (value.get_type() == sol::type::string) {
+        // One multi-line string
+        std::string text = value.as<std::string>();
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            rows.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+    } else if (value.get_type() == sol::type::table) {
+        sol::table t = value.as<sol::table>();
+        for (size_t i = 1; i <= t.size(); i++) {
+            rows.push_back(t.get_or(i, std::string()));
+        }
+    }
+    return rows;
+}
+
+Entity entity_from_lua(const sol::object& value, const World& world, const SceneIndex& index) {
+    Entity entity = NULL_ENTITY;
+    if (value.get_type() == sol::type::string) {
+        entity = index.find(value.as<std::string>());
+    } else if (value.get_type() == sol::type::number) {
+        entity = Handle::from_bits(value.as<uint64_t>());
+    }
+    return world.alive(entity) ? entity : NULL_ENTITY;
+}
+
+sol::table vec3_to_lua(sol::state_view& lua, const glm::vec3& v) {
+    return lua.create_table_with(1, v.x, 2, v.y, 3, v.z);
+}
+
+bool tween_channel_from_lua(const std::string& name, TweenSystem::Channel& channel) {
+    using Channel = TweenSystem::Channel;
+    static const std::unordered_map<std::string, Channel> CHANNELS = {
+        {"x", Channel::PositionX}, {"y", Channel::PositionY}, {"z", Channel::PositionZ},
+        {"rx", Channel::RotationX}, {"ry", Channel::RotationY}, {"rz", Channel::RotationZ},
+        {"sx", Channel::ScaleX}, {"sy", Channel::ScaleY}, {"sz", Channel::ScaleZ},
+        {"r", Channel::ColorR}, {"g", Channel::ColorG}, {"b", Channel::ColorB}, {"roughness", Channel::Roughness},
+        {"er", Channel::EmissionR}, {"eg", Channel::EmissionG}, {"eb", Channel::EmissionB},
+        {"emission", Channel::EmissionPower},
+    };
+    auto it = CHANNELS.find(name);
+    if (it == CHANNELS.end()) {
+        return false;
+    }
+    channel = it->second;
+    return true;
+}
+
+TweenSystem::Ease tween_ease_from_lua(const std::string& name) {
+    using Ease = TweenSystem::Ease;
+    static const std::unordered_map<std::string, Ease> EASES = {
+        {"linear", Ease::Linear}, {"quad_in", Ease::QuadIn}, {"quad_out", Ease::QuadOut},
+        {"quad_in_out", Ease::QuadInOut}, {"cubic_in", Ease::CubicIn}, {"cubic_out", Ease::CubicOut},
+        {"cubic_in_out", Ease::CubicInOut}, {"smooth", Ease::Smooth},
+    };
+    auto it = EASES.find(name);
+    return it == EASES.end() ? Ease::Linear : it->second;
+}
+
+TweenSystem::Loop tween_loop_from_lua(const std::string& name) {
+    if (name == "repeat") return TweenSystem::Loop::Repeat;
+    if (name == "ping_pong") return TweenSystem::Loop::PingPong;
+    return TweenSystem::Loop::Once;
+}
+
+// Emitter table (scene space) over base; missing fields keep base's values
+ParticleEmitter emitter_from_lua(const sol::table& t, ParticleEmitter base) {
+    base.position = scene_to_world(vec3_from_lua(t["position"], scene_to_world(base.position)));
+    base.jitter = scene_to_world(vec3_from_lua(t["jitter"], scene_to_world(base.jitter)));
+    base.velocity = scene_to_world(vec3_from_lua(t["velocity"], scene_to_world(base.velocity)));
+    base.acceleration = scene_to_world(vec3_from_lua(t["acceleration"], scene_to_world(base.acceleration)));
+    base.rate = t.get_or("rate", base.rate);
+    base.spread = t.get_or("spread", base.spread);
+    base.drag = t.get_or("drag", base.drag);
+    base.material = t.get_or("material", base.material);
+    base.max_particles = t.get_or("max", base.max_particles);
+    base.light_radius = t.get_or("light_radius", base.light_radius);
+    base.active = t.get_or("active", base.active);
+    if (sol::optional<sol::table> life = t["life"]) {
+        base.life_min = life->get_or(1, base.life_min);
+        base.life_max = life->get_or(2, base.life_min);
+    }
+    if (sol::optional<sol::table> size = t["size"]) {
+        base.size_start = size->get_or(1, base.size_start);
+        base.size_end = size->get_or(2, base.size_start);
+    }
+    if (sol::optional<sol::table> light = t["light"]) {
+        base.light = glm::vec4(light->get_or(1, 1.0f), light->get_or(2, 1.0f), light->get_or(3, 1.0f),
+                               light->get_or(4, 0.0f));
+    }
+    return base;
+}
+
+
+// Type.define field (short form "int" or a normalized table) -> native
+// field. False for types that stay in Lua.
+bool schema_field_from_lua(const std::string& name, const sol::object& def, SchemaFieldDesc& out) {
+    sol::table t;
+    std::string type = "string";
+    if (def.get_type() == sol::type::string) {
+        type = def.as<std::string>();
+    } else if (def.get_type() == sol::type::table) {
+        t = def.as<sol::table>();
+        type = t.get_or("type", type);
+    }
+    out.name = name;
+    if (!parse_schema_field_type(type, out.type)) {
+        return false;
+    }
+    if (!t.valid()) {
+        return true;
+    }
+    out.min = t.get_or("min", out.min);
+    out.max = t.get_or("max", out.max);
+    if (sol::optional<sol::table> options = t["options"]) {
+        for (size_t i = 1; i <= options->size(); i++) {
+            out.options.push_back(options->get_or(i, std::string()));
+        }
+    }
+    sol::object value = t["default"];
+    switch (value.get_type()) {
+        case sol::type::number:
+            out.defaults[0] = value.as<double>();
+            break;
+        case sol::type::boolean:
+            out.defaults[0] = value.as<bool>() ? 1.0 : 0.0;
+            break;
+        case sol::type::string: {
+            auto it = std::find(out.options.begin(), out.options.end(), value.as<std::string>());
+            out.defaults[0] = it == out.options.end() ? 0.0 : double(it - out.options.begin());
+            break;
+        }
+        case sol::type::table: {
+            sol::table lanes = value.as<sol::table>();
+            for (int lane = 0; lane < 4; lane++) {
+                out.defaults[lane] = lanes.get_or(lane + 1, out.type == SchemaFieldType::Color ? 1.0 : 0.0);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
+
+// Lua handle to one native instance. Fields are read and written in the
+// store's columns on every access, so the view follows its row as rows move.
+struct SchemaView {
+    SchemaStore* store;
+    Entity entity;
+};
+
+sol::object schema_value_to_lua(sol::state_view& lua, const SchemaStore& store, uint32_t row, size_t field) {
+    const SchemaField& f = store.schema().fields()[field];
+    switch (f.type) {
+        case SchemaFieldType::Bool:
+            return sol::make_object(lua, store.get(row, field) != 0.0);
+        case SchemaFieldType::Enum: {
+            const size_t option = static_cast<size_t>(store.get(row, field));
+            return option < f.options.size() ? sol::make_object(lua, f.options[option]) : sol::make_object(lua, sol::lua_nil);
+        }
+        case SchemaFieldType::Vec2:
+        case SchemaFieldType::Vec3:
+        case SchemaFieldType::Color: {
+            sol::table t = lua.create_table(static_cast<int>(f.lanes), 0);
+            for (uint32_t lane = 0; lane < f.lanes; lane++) {
+                t[lane + 1] = store.get(row, field, lane);
+            }
+            return t;
+        }
+        default:
+            return sol::make_object(lua, store.get(row, field));
+    }
+}
+
+void schema_value_from_lua(SchemaStore& store, uint32_t row, size_t field, const sol::object& value) {
+    const SchemaField& f = store.schema().fields()[field];
+    if (f.lanes > 1) {
+        glm::vec4 v;
+        if (const int lanes = vector_from_userdata(value, v)) {
+            for (uint32_t lane = 0; lane < std::min<uint32_t>(f.lanes, lanes); lane++) {
+                store.set(row, field, lane, v[lane]);
+            }
+        } else if (value.get_type() == sol::type::table) {
+            sol::table t = value.as<sol::table>();
+            for (uint32_t lane = 0; lane < f.lanes; lane++) {
+                store.set(row, field, lane, t.get_or(lane + 1, store.get(row, field, lane)));
+            }
+        }
+        return;
+    }
+    switch (value.get_type()) {
+        case sol::type::number:
+            store.set(row, field, 0, value.as<double>());
+            break;
+        case sol::type::boolean:
+            store.set(row, field, 0, value.as<bool>() ? 1.0 : 0.0);
+            break;
+        case sol::type::string: {
+            auto it = std::find(f.options.begin(), f.options.end(), value.as<std::string>());
+            if (it != f.options.end()) {
+                store.set(row, field, 0, double(it - f.options.begin()));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void schema_values_from_lua(SchemaStore& store, uint32_t row, const sol::table& values) {
+    for (const auto& [key, value] : values) {
+        if (key.get_type() == sol::type::string) {
+            const int field = store.schema().find(key.as<std::string>());
+            if (field >= 0) {
+                schema_value_from_lua(store, row, static_cast<size_t>(field), value);
+            }
+        }
+    }
+}
+
+// Proximity tag filter from Lua: "collider", "interactable" or nil for both
+uint32_t proximity_tags(const sol::optional<std::string>& tag) {
+    if (!tag) {
+        return SpatialHash::ALL_TAGS;
+    }
+    if (*tag == "collider") {
+        return SceneProximity::COLLIDER;
+    }
+    if (*tag == "interactable") {
+        return SceneProximity::INTERACTABLE;
+    }
+    throw std::runtime_error("Unknown proximity tag: " + *tag);
+}
+
+template<typename Ids>
+sol::table ids_to_lua(sol::state_view& lua, const Ids& ids) {
+    sol::table t = lua.create_table(static_cast<int>(ids.size()), 0);
+    int n = 0;
+    for (uint64_t id : ids) {
+        t[++n] = id;
+    }
+    return t;
+}
+
+} // anonymous namespace
+
+void bind_math(LuaRuntime& lua) {
+    sol::state& state = lua.state();
+
+    bind_vector<glm::vec2>(state, "vec2");
+    sol::usertype<glm::vec3> vec3 = bind_vector<glm::vec3>(state, "vec3");
+    vec3["cross"] = [](const glm::vec3& a, const glm::vec3& b) { return glm::cross(a, b); };
+    bind_vector<glm::vec4>(state, "vec4");
+
+    state.new_usertype<Color>("color",
+        sol::call_constructor, [](const sol::table&, sol::optional<float> r, sol::optional<float> g,
+                                  sol::optional<float> b, sol::optional<float> a) {
+            return Color{r.value_or(1.0f), g.value_or(1.0f), b.value_or(1.0f), a.value_or(1.0f)};
+        },
+        sol::meta_function::addition, [](const Color& x, const Color& y) {
+            return Color{x.r + y.r, x.g + y.g, x.b + y.b, x.a + y.a};
+        },
+        sol::meta_function::multiplication, sol::overload(
+            [](const Color& x, const Color& y) { return Color{x.r * y.r, x.g * y.g, x.b * y.b, x.a * y.a}; },
+            [](const Color& x, float s) { return Color{x.r * s, x.g * s, x.b * s, x.a}; },
+            [](float s, const Color& x) { return Color{x.r * s, x.g * s, x.b * s, x.a}; }),
+        sol::meta_function::equal_to, [](const Color& x, const Color& y) {
+            return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a;
+        },
+        sol::meta_function::to_string, [](const Color& c) {
+            return vector_to_string("color", glm::vec4(c.r, c.g, c.b, c.a));
+        },
+        "r", &Color::r,
+        "g", &Color::g,
+        "b", &Color::b,
+        "a", &Color::a,
+        "lerped", &color_lerp,
+        "copy", [](const Color& c) { return c; },
+        "unpack", [](const Color& c) { return std::make_tuple(c.r, c.g, c.b, c.a); },
+        "set", [](Color& c, float r, float g, float b, sol::optional<float> a) {
+            c = Color{r, g, b, a.value_or(c.a)};
+        },
+        "lerp", [](Color& x, const Color& y, float t) { x = color_lerp(x, y, t); });
+}
+
+void bind_materials(LuaRuntime& lua, MaterialTable& materials) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("material", [&materials](sol::table desc) -> uint16_t {
+        glm::vec3 color = vec3_from_lua(desc["color"], glm::vec3(0.5f));
+        glm::vec3 emission = vec3_from_lua(desc["emission"], glm::vec3(0.0f));
+        Material material;
+        material.color = glm::vec4(color, desc.get_or("roughness", 0.8f));
+        material.emission = glm::vec4(emission, desc.get_or("emission_power", 0.0f));
+        return materials.add(material);
+    });
+}
+
+void bind_tilemap(LuaRuntime& lua, Tilemap& tilemap, const MaterialTable& materials) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("tilemap_size", [&tilemap]() {
+        return std::make_tuple(tilemap.width(), tilemap.height(), tilemap.layers());
+    });
+
+    engine.set_function("tile_get", [&tilemap](int layer, int x, int y, sol::this_state s) {
+        return tile_to_lua(s, tilemap.get(layer, x, y));
+    });
+
+    engine.set_function("tile_set", [&tilemap, &materials](int layer, int x, int y, sol::object tile) {
+        return tilemap.set(layer, x, y, tile_from_lua(tile, materials));
+    });
+
+    engine.set_function("tile_fill_rect", [&tilemap, &materials](int layer, int x, int y, int w, int h, sol::object tile) {
+        return tilemap.fill_rect(layer, x, y, w, h, tile_from_lua(tile, materials));
+    });
+
+    engine.set_function("tile_flood_fill", [&tilemap, &materials](int layer, int x, int y, sol::object tile) {
+        return tilemap.flood_fill(layer, x, y, tile_from_lua(tile, materials));
+    });
+
+    engine.set_function("tile_paste", [&tilemap, &materials](int layer, int x, int y, sol::object rows, sol::table legend) {
+        std::unordered_map<uint32_t, Tile> tiles;
+        for (const auto& [key, value] : legend) {
+            tiles[glyph_from_lua(key)] = tile_from_lua(value, materials);
+        }
+        return tilemap.paste(layer, x, y, rows_from_lua(rows), tiles);
+    });
+}
+
+void bind_fov(LuaRuntime& lua, FieldOfView& fov, Tilemap& tilemap, JobSystem& jobs) {
+    sol::table engine = lua.engine();
+
+    // Viewer ids travel as Lua integers; entity handles keep their bits
+    engine.set_function("fov", sol::overload(
+        [&fov, &tilemap](int64_t viewer, int x, int y, int radius) {
+            fov.sync(tilemap);
+            fov.compute({static_cast<uint64_t>(viewer), x, y, radius});
+            return fov.visible_count(static_cast<uint64_t>(viewer));
+        },
+        [&fov, &tilemap, &jobs](sol::table batch) {
+            std::vector<FieldOfView::Request> requests;
+            requests.reserve(batch.size());
+            for (size_t i = 1; i <= batch.size(); i++) {
+                sol::table r = batch[i];
+                requests.push_back({static_cast<uint64_t>(r.get_or<int64_t>(1, 0)),
+                                    r.get_or(2, 0), r.get_or(3, 0), r.get_or(4, 0)});
+            }
+            fov.sync(tilemap);
+            return fov.compute(requests, jobs);
+        }));
+
+    engine.set_function("fov_visible", [&fov](int64_t viewer, int x, int y) {
+        return fov.visible(static_cast<uint64_t>(viewer), x, y);
+    });
+
+    engine.set_function("fov_explored", [&fov](int64_t viewer, int x, int y) {
+        return fov.explored(static_cast<uint64_t>(viewer), x, y);
+    });
+
+    engine.set_function("fov_tiles", [&fov](int64_t viewer, sol::this_state s) {
+        sol::state_view lua(s);
+        sol::table tiles = lua.create_table(static_cast<int>(2 * fov.visible_count(static_cast<uint64_t>(viewer))), 0);
+        int n = 0;
+        fov.each_visible(static_cast<uint64_t>(viewer), [&](int x, int y) {
+            tiles[++n] = x;
+            tiles[++n] = y;
+        });
+        return tiles;
+    });
+
+    engine.set_function("fov_forget", [&fov](int64_t viewer) {
+        fov.forget(static_cast<uint64_t>(viewer));
+    });
+}
+
+void bind_paths(LuaRuntime& lua, Pathfinder& pathfinder, Tilemap& tilemap, JobSystem& jobs) {
+    sol::table engine = lua.engine();
+
+    // Looks up a field brought up to date with the tilemap, or nothing
+    auto current_field = [&pathfinder, &tilemap, &jobs](const std::string& name) -> DijkstraMap* {
+        pathfinder.grid().sync(tilemap);
+        DijkstraMap* field = pathfinder.find_field(name);
+        if (field) {
+            field->update(jobs);
+        }
+        return field;
+    };
+
+    engine.set_function("path_field", [&pathfinder](const std::string& name, sol::table goals) {
+        std::vector<DijkstraMap::Goal> list;
+        list.reserve(goals.size());
+        for (size_t i = 1; i <= goals.size(); i++) {
+            sol::table g = goals[i];
+            const float cost = std::max(g.get_or(3, 0.0f), 0.0f);
+            list.push_back({g.get_or(1, 0), g.get_or(2, 0),
+                            static_cast<uint32_t>(cost * PathGrid::STRAIGHT_COST + 0.5f)});
+        }
+        pathfinder.field(name).set_goals(std::move(list));
+    });
+
+    engine.set_function("path_step", [current_field](const std::string& name, int x, int y)
+                                          -> std::tuple<sol::optional<int>, sol::optional<int>> {
+        const DijkstraMap* field = current_field(name);
+        if (!field) {
+            return {sol::nullopt, sol::nullopt};
+        }
+        const std::optional<glm::ivec2> step = field->next_step(x, y);
+        if (!step) {
+            return {sol::nullopt, sol::nullopt};
+        }
+        return {step->x, step->y};
+    });
+
+    engine.set_function("path_steps", [current_field](const std::string& name, sol::table positions, sol::this_state s) {
+        sol::state_view lua(s);
+        const DijkstraMap* field = current_field(name);
+        const size_t n = positions.size();
+        sol::table steps = lua.create_table(static_cast<int>(n), 0);
+        for (size_t i = 1; i + 1 <= n; i += 2) {
+            glm::ivec2 at(positions.get_or(i, 0), positions.get_or(i + 1, 0));
+            if (field) {
+                at = field->next_step(at.x, at.y).value_or(at);
+            }
+            steps[i] = at.x;
+            steps[i + 1] = at.y;
+        }
+        return steps;
+    });
+
+    engine.set_function("path_distance", [current_field](const std::string& name, int x, int y)
+                                              -> sol::optional<double> {
+        const DijkstraMap* field = current_field(name);
+        const uint32_t distance = field ? field->distance(x, y) : PathGrid::UNREACHABLE;
+        if (distance == PathGrid::UNREACHABLE) {
+            return sol::nullopt;
+        }
+        return static_cast<double>(distance) / PathGrid::STRAIGHT_COST;
+    });
+
+    engine.set_function("path_find", [&pathfinder, &tilemap, &jobs](sol::table batch, sol::this_state s) {
+        sol::state_view lua(s);
+        std::vector<PathRequest> requests;
+        requests.reserve(batch.size());
+        for (size_t i = 1; i <= batch.size(); i++) {
+            sol::table r = batch[i];
+            requests.push_back({{r.get_or(1, 0), r.get_or(2, 0)}, {r.get_or(3, 0), r.get_or(4, 0)}});
+        }
+        pathfinder.grid().sync(tilemap);
+        const std::vector<std::vector<glm::ivec2>> paths = find_paths(pathfinder.grid(), requests, jobs);
+
+        sol::table result = lua.create_table(static_cast<int>(paths.size()), 0);
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (paths[i].empty()) {
+                result[i + 1] = false;
+                continue;
+            }
+            sol::table path = lua.create_table(static_cast<int>(2 * paths[i].size()), 0);
+            int n = 0;
+            for (const glm::ivec2& tile : paths[i]) {
+                path[++n] = tile.x;
+                path[++n] = tile.y;
+            }
+            result[i + 1] = path;
+        }
+        return result;
+    });
+
+    engine.set_function("path_occupant", [&pathfinder, &tilemap](int x, int y, int delta) {
+        PathGrid& grid = pathfinder.grid();
+        grid.sync(tilemap);
+        for (; delta > 0; delta--) {
+            grid.add_occupant(x, y);
+        }
+        for (; delta < 0; delta++) {
+            grid.remove_occupant(x, y);
+        }
+    });
+
+    engine.set_function("path_forget", [&pathfinder](const std::string& name) {
+        pathfinder.remove_field(name);
+    });
+}
+
+void bind_proximity(LuaRuntime& lua, SceneProximity& proximity, JobSystem& jobs) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("nearby", sol::overload(
+        [&proximity](float x, float y, float radius, sol::optional<std::string> tag, sol::this_state s) {
+            sol::state_view lua(s);
+            std::vector<uint64_t> ids;
+            proximity.hash().query_radius({x, y}, radius, ids, proximity_tags(tag));
+            return ids_to_lua(lua, ids);
+        },
+        [&proximity, &jobs](sol::table batch, sol::optional<std::string> tag, sol::this_state s) {
+            sol::state_view lua(s);
+            const uint32_t tags = proximity_tags(tag);
+            std::vector<SpatialHash::Query> queries(batch.size());
+            for (size_t i = 0; i < queries.size(); i++) {
+                sol::table q = batch[i + 1];
+                queries[i].center = {q.get_or(1, 0.0f), q.get_or(2, 0.0f)};
+                queries[i].radius = q.get_or(3, 0.0f);
+                queries[i].tags = tags;
+            }
+            SpatialHash::BatchResult result;
+            proximity.hash().query(queries, result, jobs);
+
+            sol::table lists = lua.create_table(static_cast<int>(queries.size()), 0);
+            for (size_t i = 0; i < queries.size(); i++) {
+                lists[i + 1] = ids_to_lua(lua, std::span<const uint64_t>(result.ids.data() + result.offsets[i],
+                                                                         result.offsets[i + 1] - result.offsets[i]));
+            }
+            return lists;
+        }));
+
+    engine.set_function("nearby_box", [&proximity](float x0, float y0, float x1, float y1,
+                                                   sol::optional<std::string> tag, sol::this_state s) {
+        sol::state_view lua(s);
+        std::vector<uint64_t> ids;
+        proximity.hash().query_box({std::min(x0, x1), std::min(y0, y1)}, {std::max(x0, x1), std::max(y0, y1)},
+                                   ids, proximity_tags(tag));
+        return ids_to_lua(lua, ids);
+    });
+
+    engine.set_function("nearest", [&proximity](float x, float y, int k, sol::optional<std::string> tag,
+                                                sol::optional<float> max_distance, sol::this_state s) {
+        sol::state_view lua(s);
+        std::vector<SpatialHash::Hit> hits;
+        proximity.hash().query_nearest({x, y}, static_cast<size_t>(std::max(k, 0)), hits, proximity_tags(tag),
+                                       max_distance.value_or(0.0f));
+        sol::table t = lua.create_table(static_cast<int>(hits.size()), 0);
+        for (size_t i = 0; i < hits.size(); i++) {
+            t[i + 1] = hits[i].id;
+        }
+        return t;
+    });
+
+    engine.set_function("interactables", [&proximity](float x, float y, sol::this_state s) {
+        sol::state_view lua(s);
+        std::vector<SpatialHash::Hit> hits;
+        proximity.interactables_at({x, y}, hits);
+        sol::table t = lua.create_table(static_cast<int>(hits.size()), 0);
+        for (size_t i = 0; i < hits.size(); i++) {
+            t[i + 1] = hits[i].id;
+        }
+        return t;
+    });
+}
+
+void bind_physics(LuaRuntime& lua, ScenePhysics& physics) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("body_velocity", [&physics](int64_t handle, float vx, float vy) {
+        return physics.physics().set_velocity(static_cast<uint64_t>(handle), {vx, vy});
+    });
+
+    engine.set_function("body_get", [&physics](int64_t handle, sol::this_state s) -> sol::object {
+        sol::state_view lua(s);
+        const PhysicsWorld::Body* body = physics.physics().body(static_cast<uint64_t>(handle));
+        if (!body) {
+            return sol::make_object(lua, sol::lua_nil);
+        }
+        sol::table t = lua.create_table(0, 4);
+        t["x"] = body->position.x;
+        t["y"] = body->position.y;
+        t["vx"] = body->velocity.x;
+        t["vy"] = body->velocity.y;
+        return t;
+    });
+}
+
+void emit_contacts(LuaRuntime& lua, const ScenePhysics& physics) {
+    const std::vector<PhysicsWorld::Contact>& contacts = physics.physics().contacts();
+    if (contacts.empty()) {
+        return;
+    }
+    sol::state& state = lua.state();
+    sol::table list = state.create_table(static_cast<int>(contacts.size()), 0);
+    for (size_t i = 0; i < contacts.size(); i++) {
+        const PhysicsWorld::Contact& contact = contacts[i];
+        sol::table t = state.create_table(0, 6);
+        t["body"] = contact.body;
+        if (contact.other != PhysicsWorld::NO_BODY) {
+            t["other"] = contact.other;
+        } else {
+            t["tile_x"] = contact.tile.x;
+            t["tile_y"] = contact.tile.y;
+        }
+        t["nx"] = contact.normal.x;
+        t["ny"] = contact.normal.y;
+        list[i + 1] = t;
+    }
+    lua.call("on_contacts", list);
+}
+
+void bind_particles(LuaRuntime& lua, ParticleSystem& particles) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("emitter", [&particles](sol::table desc) -> sol::optional<uint32_t> {
+        const uint32_t id = particles.add_emitter(emitter_from_lua(desc, ParticleEmitter{}));
+        if (id == ParticleSystem::NO_EMITTER) {
+            return sol::nullopt;
+        }
+        return id;
+    });
+
+    engine.set_function("emitter_set", [&particles](uint32_t id, sol::table desc) {
+        const ParticleEmitter* current = particles.emitter(id);
+        return current && particles.set_emitter(id, emitter_from_lua(desc, *current));
+    });
+
+    engine.set_function("emitter_burst", [&particles](uint32_t id, uint32_t count) {
+        return particles.burst(id, count);
+    });
+
+    engine.set_function("emitter_remove", [&particles](uint32_t id) {
+        return particles.remove_emitter(id);
+    });
+}
+
+void bind_tweens(LuaRuntime& lua, TweenSystem& tweens, World& world, SceneIndex& index, MaterialTable& materials) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("tween", [&tweens, &world, &index, &materials](sol::object target, const std::string& channel,
+                                                                       sol::table desc) -> sol::optional<uint32_t> {
+        TweenSystem::Target t;
+        if (!tween_channel_from_lua(channel, t.channel)) {
+            return sol::nullopt;
+        }
+        t.id = entity_from_lua(target, world, index).bits();
+        float current;
+        if (!TweenSystem::read(world, materials, t, current)) {
+            return sol::nullopt;
+        }
+        const float from = desc.get_or("from", current);
+        const float to = desc.get_or("to", current);
+
+        uint32_t id;
+        if (sol::optional<float> stiffness = desc["spring"]) {
+            const float damping = desc.get_or("damping", 2.0f * std::sqrt(std::max(*stiffness, 0.0f)));
+            id = tweens.spring(t, from, to, *stiffness, damping);
+        } else {
+            std::vector<float> keys;
+            if (sol::optional<sol::table> list = desc["keys"]) {
+                for (size_t i = 1; i <= list->size(); i++) {
+                    keys.push_back(list->get_or(i, current));
+                }
+            } else {
+                keys = {from, to};
+            }
+            id = tweens.play(t, keys, desc.get_or("duration", 1.0f),
+                             tween_ease_from_lua(desc.get_or("ease", std::string("linear"))),
+                             tween_loop_from_lua(desc.get_or("loop", std::string("once"))),
+                             desc.get_or("delay", 0.0f));
+        }
+        if (id == TweenSystem::NO_TWEEN) {
+            return sol::nullopt;
+        }
+        return id;
+    });
+
+    engine.set_function("tween_retarget", [&tweens](uint32_t id, float to) {
+        return tweens.retarget(id, to);
+    });
+
+    engine.set_function("tween_stop", [&tweens](uint32_t id) {
+        return tweens.stop(id);
+    });
+}
+
+void emit_tweens_done(LuaRuntime& lua, const TweenSystem& tweens) {
+    const std::vector<uint32_t>& finished = tweens.finished();
+    if (finished.empty()) {
+        return;
+    }
+    sol::state& state = lua.state();
+    sol::table list = state.create_table(static_cast<int>(finished.size()), 0);
+    for (size_t i = 0; i < finished.size(); i++) {
+        list[i + 1] = finished[i];
+    }
+    lua.call("on_tweens_done", list);
+}
+
+void bind_scheduler(LuaRuntime& lua, CoroutineScheduler& scheduler) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("spawn", [&scheduler](sol::protected_function fn, sol::variadic_args va) {
+        return scheduler.spawn(fn, std::vector<sol::object>(va.begin(), va.end()));
+    });
+
+    engine.set_function("kill", [&scheduler](uint64_t id) {
+        return scheduler.kill(id);
+    });
+
+    // The waits yield what they wait on to the scheduler; the values it
+    // resumes with become their results
+    engine.set_function("wait", sol::yielding([](sol::optional<double> seconds) {
+        return seconds.value_or(0.0);
+    }));
+    engine.set_function("wait_event", sol::yielding([](const std::string& name, sol::optional<double> timeout) {
+        return std::make_tuple(name, timeout);
+    }));
+    engine.set_function("wait_until", sol::yielding([](sol::protected_function predicate, sol::optional<double> timeout) {
+        return std::make_tuple(predicate, timeout);
+    }));
+
+    engine.set_function("signal", [&scheduler](const std::string& name, sol::object value) {
+        return scheduler.signal(name, value);
+    });
+
+    engine.set_function("scheduler_budget", [&scheduler](sol::optional<uint32_t> budget) {
+        if (budget) {
+            scheduler.set_budget(*budget);
+        }
+        return scheduler.budget();
+    });
+
+    engine.set_function("scheduler_stats", [&scheduler](sol::this_state s) {
+        sol::state_view lua(s);
+        const SchedulerStats& stats = scheduler.stats();
+        sol::table t = lua.create_table();
+        t["resumed"] = stats.resumed;
+        t["timers_fired"] = stats.timers_fired;
+        t["signalled"] = stats.signalled;
+        t["conditions_polled"] = stats.conditions_polled;
+        t["deferred"] = stats.deferred;
+        t["finished"] = stats.finished;
+        t["tasks"] = scheduler.size();
+        t["timers"] = scheduler.timers();
+        t["ms"] = stats.ms;
+        return t;
+    });
+}
+
+void bind_workers(LuaRuntime& lua, LuaWorkers& workers) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("workers_start", [&workers](const std::string& path,
+                                                    sol::optional<unsigned> count) -> sol::optional<unsigned> {
+        if (!workers.start(path, count.value_or(0))) {
+            return sol::nullopt;
+        }
+        return workers.count();
+    });
+
+    engine.set_function("workers_stop", [&workers]() {
+        workers.stop();
+    });
+
+    engine.set_function("worker_send", [&workers](uint32_t worker, const std::string& topic, sol::variadic_args va) {
+        WorkerMessage message{0, topic, {}};
+        for (const sol::object& value : std::vector<sol::object>(va.begin(), va.end())) {
+            message.values.push_back(worker_value_from_lua(value));
+        }
+        return workers.send(worker, std::move(message));
+    });
+}
+
+void emit_worker_messages(LuaRuntime& lua, const LuaWorkers& workers) {
+    if (workers.main_inbox().empty()) {
+        return;
+    }
+    lua.call("on_worker_messages", worker_messages_to_lua(lua.state(), workers.main_inbox()));
+}
+
+void bind_scene(LuaRuntime& lua, World& world, SceneIndex& index, TransformHierarchy& transforms) {
+    sol::table engine = lua.engine();
+
+    engine.set_function("entity", [&world, &index](const std::string& id) -> sol::optional<uint64_t> {
+        Entity entity = index.find(id);
+        if (!world.alive(entity)) {
+            return sol::nullopt;
+        }
+        return entity.bits();
+    });
+
+    engine.set_function("entity_get", [&world, &index](sol::object key, sol::this_state s) -> sol::object {
+        sol::state_view lua(s);
+        Entity entity = entity_from_lua(key, world, index);
+        if (!entity.valid()) {
+            return sol::make_object(lua, sol::lua_nil);
+        }
+        sol::table t = lua.create_table();
+        t["entity"] = entity.bits();
+        if (const SceneNode* node = world.get<const SceneNode>(entity)) {
+            t["id"] = std::string(index.str(node->id));
+            t["name"] = std::string(index.str(node->name));
+            t["type"] = std::string(index.str(node->type));
+        }
+        if (const LocalTransform* local = world.get<const LocalTransform>(entity)) {
+            t["position"] = vec3_to_lua(lua, local->position);
+            t["rotation"] = vec3_to_lua(lua, local->rotation);
+            t["scale"] = vec3_to_lua(lua, local->scale);
+        }
+        return t;
+    });
+
+    engine.set_function("entity_set", [&world, &index, &transforms](sol::object key, sol::table desc) {
+        Entity entity = entity_from_lua(key, world, index);
+        LocalTransform* local = world.get<LocalTransform>(entity);
+        if (!local) {
+            return false;
+        }
+        local->position = vec3_from_lua(desc["position"], local->position);
+        local->rotation = vec3_from_lua(desc["rotation"], local->rotation);
+        local->scale = vec3_from_lua(desc["scale"], local->scale);
+        transforms.mark_dirty(world, entity);
+        return true;
+    });
+
+    engine.set_function("entity_destroy", [&world, &index](sol::object key) {
+        Entity entity = entity_from_lua(key, world, index);
+        if (!entity.valid()) {
+            return false;
+        }
+        world.commands().run([&index, entity](World& w) { destroy_scene_entity(w, index, entity); });
+        return true;
+    });
+}
+
+void bind_schemas(LuaRuntime& lua, SchemaRegistry& schemas, World& world, SceneIndex& index) {
+    sol::state& state = lua.state();
+    sol::table engine = lua.engine();
+
+    state.new_usertype<SchemaView>("SchemaView", sol::no_constructor,
+        sol::meta_function::index, [](const SchemaView& view, const std::string& key, sol::this_state s) -> sol::object {
+            sol::state_view lua(s);
+            const uint32_t row = view.store->row(view.entity);
+            if (key == "__type") {
+                return sol::make_object(lua, view.store->schema().name());
+            }
+            const int field = view.store->schema().find(key);
+            if (row == SchemaStore::NO_ROW || field < 0) {
+                return sol::make_object(lua, sol::lua_nil);
+            }
+            return schema_value_to_lua(lua, *view.store, row, static_cast<size_t>(field));
+        },
+        sol::meta_function::new_index, [](SchemaView& view, const std::string& key, sol::object value) {
+            const int field = view.store->schema().find(key);
+            if (field < 0) {
+                throw std::runtime_error(view.store->schema().name() + " has no native field " + key);
+            }
+            const uint32_t row = view.store->row(view.entity);
+            if (row != SchemaStore::NO_ROW) {
+                schema_value_from_lua(*view.store, row, static_cast<size_t>(field), value);
+            }
+        });
+
+    engine.set_function("schema_compile", [&schemas](const std::string& name, sol::table components, sol::this_state s) {
+        sol::state_view lua(s);
+        std::vector<SchemaFieldDesc> fields;
+        sol::table lua_fields = lua.create_table();
+        for (const auto& [key, def] : components) {
+            if (key.get_type() != sol::type::string) {
+                continue;
+            }
+            SchemaFieldDesc field;
+            if (schema_field_from_lua(key.as<std::string>(), def, field)) {
+                fields.push_back(std::move(field));
+            } else {
+                lua_fields.add(key.as<std::string>());
+            }
+        }
+        const Schema& schema = schemas.define(name, std::move(fields)).schema();
+
+        sol::table layout = lua.create_table();
+        layout["name"] = name;
+        layout["size"] = schema.stride();
+        sol::table field_list = lua.create_table();
+        for (const SchemaField& field : schema.fields()) {
+            field_list.add(lua.create_table_with("name", field.name, "type", schema_field_type_name(field.type),
+                                                 "offset", field.offset, "size", field.lanes * field.lane_size));
+        }
+        layout["fields"] = field_list;
+        layout["lua_fields"] = lua_fields;
+        return layout;
+    });
+
+    engine.set_function("component_add", [&schemas, &world, &index](sol::object key, const std::string& type,
+                                                                    sol::optional<sol::table> values) -> sol::optional<SchemaView> {
+        Entity entity = entity_from_lua(key, world, index);
+        SchemaStore* store = schemas.find(type);
+        if (!entity.valid() || !store) {
+            return sol::nullopt;
+        }
+        const uint32_t row = store->add(entity);
+        if (values) {
+            schema_values_from_lua(*store, row, *values);
+        }
+        return SchemaView{store, entity};
+    });
+
+    engine.set_function("component_get", [&schemas, &world, &index](sol::object key,
+                                                                    const std::string& type) -> sol::optional<SchemaView> {
+        Entity entity = entity_from_lua(key, world, index);
+        SchemaStore* store = schemas.find(type);
+        if (!store || store->row(entity) == SchemaStore::NO_ROW) {
+            return sol::nullopt;
+        }
+        return SchemaView{store, entity};
+    });
+
+    engine.set_function("component_remove", [&schemas, &world, &index](sol::object key, const std::string& type) {
+        SchemaStore* store = schemas.find(type);
+        return store && store->remove(entity_from_lua(key, world, index));
+    });
+}
+
+} // namespace ascii
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "lua_runtime.hpp"
+
+namespace ascii {
+
+class CoroutineScheduler;
+class FieldOfView;
+class JobSystem;
+class LuaWorkers;
+class MaterialTable;
+class ParticleSystem;
+class Pathfinder;
+class ScenePhysics;
+class SceneIndex;
+class SceneProximity;
+class SchemaRegistry;
+class Tilemap;
+class TransformHierarchy;
+class TweenSystem;
+class World;
+
+// Bindings that expose engine systems on the Lua `engine` table
+
+// Native vector and color values (userdata holding the floats, not tables):
+//   vec2(x, y), vec3(x, y, z), vec4(x, y, z, w)   -- or (s), ({x, ...}), (v); missing components 0
+//   color(r, g, b, a?)                            -- missing components 1
+// Fields v.x..v.w and c.r..c.a read and write in place. Operators (+, -,
+// * and / by a vector or number, unary -, ==, tostring) and v:normalized(),
+// v:lerped(o, t), v:copy() make new values; v:length(), v:length_sq(),
+// v:dot(o), v:distance(o), v:cross(o) (vec3) and v:unpack() read. In place,
+// allocating nothing: v:set(...), v:add(o), v:sub(o), v:scale(s or v),
+// v:normalize(), v:lerp(o, t). Colors have +, * (by a color or number, alpha
+// kept), ==, tostring, lerped, copy, unpack, set(r, g, b, a?) and lerp.
+// Engine functions taking {x, y, z} or {r, g, b} tables, and vector and
+// color schema fields, take these values as they are.
+void bind_math(LuaRuntime& lua);
+
+// engine.material { color = {r, g, b}, roughness, emission = {r, g, b}, emission_power } -> id
+void bind_materials(LuaRuntime& lua, MaterialTable& materials);
+
+// Tiles are tables { glyph = "#", material = id, height = 1.0 }; nil clears.
+// A material id the table doesn't have raises an error.
+//   engine.tilemap_size() -> width, height, layers
+//   engine.tile_get(layer, x, y) -> tile or nil
+//   engine.tile_set(layer, x, y, tile)
+//   engine.tile_fill_rect(layer, x, y, w, h, tile)
+//   engine.tile_flood_fill(layer, x, y, tile)
+//   engine.tile_paste(layer, x, y, rows, legend)   -- rows: string or list of strings
+// Edits return the number of tiles changed and only mark the touched chunks
+// dirty; the renderer picks them up on the next frame.
+void bind_tilemap(LuaRuntime& lua, Tilemap& tilemap, const MaterialTable& materials);
+
+// Field of view over the tilemap (world/field_of_view.hpp). Viewers are any
+// integer the script picks, e.g. an entity handle; each keeps its visible
+// tiles until it is recomputed and the tiles it has ever seen:
+//   engine.fov(viewer, x, y, radius) -> visible tile count
+//   engine.fov({{viewer, x, y, radius}, ...}) -> viewers recomputed (in parallel)
+//   engine.fov_visible(viewer, x, y) -> bool
+//   engine.fov_explored(viewer, x, y) -> bool
+//   engine.fov_tiles(viewer) -> { x1, y1, x2, y2, ... }
+//   engine.fov_forget(viewer)
+// Recomputing from the same place is free until a tile edit lands near the
+// viewer; tiles block sight by height (FieldOfView's opaque_height).
+void bind_fov(LuaRuntime& lua, FieldOfView& fov, Tilemap& tilemap, JobSystem& jobs);
+
+// Pathfinding over the tilemap (world/pathfinding.hpp). Named Dijkstra maps
+// are shared by every agent chasing the same goals; distances are in tiles:
+//   engine.path_field(name, {{x, y, cost?}, ...})    -- goals; cost makes one less attractive
+//   engine.path_step(name, x, y) -> nx, ny or nil
+//   engine.path_steps(name, {x1, y1, x2, y2, ...}) -> { nx1, ny1, ... }  -- unmoved where no step
+//   engine.path_distance(name, x, y) -> tiles or nil
+//   engine.path_find({{x0, y0, x1, y1}, ...}) -> { { x0, y0, ..., x1, y1 } or false, ... }  -- A*, in parallel
+//   engine.path_occupant(x, y, delta)                -- entities entering (+1) or leaving (-1) a tile
+//   engine.path_forget(name)
+// Maps are repaired around tile edits on the next query. Occupants leave
+// the maps alone: path_step(s) sidestep an occupied tile when another
+// neighbor also leads closer, and path_find routes around them.
+void bind_paths(LuaRuntime& lua, Pathfinder& pathfinder, Tilemap& tilemap, JobSystem& jobs);
+
+// Proximity over scene entities with a Collider or Interactable component
+// (scene/scene_proximity.hpp), in scene map coordinates. Results are entity
+// handles; `tag` is "collider" or "interactable" (nil: both):
+//   engine.nearby(x, y, radius, tag?) -> { handle, ... }
+//   engine.nearby({{x, y, radius}, ...}, tag?) -> { { handle, ... }, ... }  -- in parallel
+//   engine.nearby_box(x0, y0, x1, y1, tag?) -> { handle, ... }
+//   engine.nearest(x, y, k, tag?, max_distance?) -> { handle, ... }        -- nearest first
+//   engine.interactables(x, y) -> { handle, ... }   -- whose interactionRange reaches (x, y), nearest first
+// Positions are those of the last frame's transform update.
+void bind_proximity(LuaRuntime& lua, SceneProximity& proximity, JobSystem& jobs);
+
+// Box physics for scene entities with a movement-blocking Collider
+// (scene/scene_physics.hpp); bodies are named by entity handle:
+//   engine.body_velocity(handle, vx, vy) -> ok     -- map units per second
+//   engine.body_get(handle) -> { x, y, vx, vy } or nil
+// Bodies move in fixed steps after on_update and stop against solid tiles
+// and other bodies, losing the velocity into them. The frame's contacts
+// then arrive in one call, sorted by body:
+//   on_contacts({ { body, other, tile_x, tile_y, nx, ny }, ... })   -- other nil for a tile
+void bind_physics(LuaRuntime& lua, ScenePhysics& physics);
+
+// Call on_contacts with the last step's contacts, if there were any
+void emit_contacts(LuaRuntime& lua, const ScenePhysics& physics);
+
+// Particle emitters (renderer/particle_system.hpp), in scene space. Fields
+// left out of a table keep their defaults (or, for emitter_set, their
+// current values):
+//   engine.emitter { position = {x, y, z}, jitter = {x, y, z}, rate, life = {min, max},
+//                    velocity = {x, y, z}, spread, acceleration = {x, y, z}, drag,
+//                    size = {start, end}, material, max, light = {r, g, b, power},
+//                    light_radius, active } -> id or nil    -- nil when the pool is full
+//   engine.emitter_set(id, { ... }) -> ok
+//   engine.emitter_burst(id, count) -> spawned
+//   engine.emitter_remove(id) -> ok                         -- live particles vanish too
+// Particles are simulated natively after on_update; a lit emitter adds a
+// light that follows its particles.
+void bind_particles(LuaRuntime& lua, ParticleSystem& particles);
+
+// Native tweens (scene/tween_system.hpp) of one float channel each, on an
+// entity id or handle. Transform channels "x", "y", "z", "rx", "ry", "rz",
+// "sx", "sy", "sz" edit its LocalTransform (scene space); material channels
+// "r", "g", "b", "roughness", "er", "eg", "eb", "emission" edit its sprite's
+// material, which becomes a private copy so other glyphs keep their color:
+//   engine.tween(target, channel, { to, from?, duration?, ease?, loop?, delay? }) -> id or nil
+//   engine.tween(target, channel, { keys = {v1, v2, ...}, duration?, ease?, loop?, delay? }) -> id or nil
+//   engine.tween(target, channel, { to, from?, spring = stiffness, damping? }) -> id or nil
+//   engine.tween_retarget(id, to) -> ok      -- springs keep their velocity
+//   engine.tween_stop(id) -> ok
+// from defaults to the current value; keys are spread evenly over the
+// duration (seconds, default 1). ease is "linear", "quad_in", "quad_out",
+// "quad_in_out", "cubic_in", "cubic_out", "cubic_in_out" or "smooth";
+// loop is "once", "repeat" or "ping_pong"; damping defaults to critical.
+// Tweens run after on_update; those that ended (played once, or springs
+// that settled) then arrive in one call:
+//   on_tweens_done({ id, ... })
+void bind_tweens(LuaRuntime& lua, TweenSystem& tweens, World& world, SceneIndex& index, MaterialTable& materials);
+
+// Call on_tweens_done with the tweens the last update finished, if any
+void emit_tweens_done(LuaRuntime& lua, const TweenSystem& tweens);
+
+// Behaviors as coroutines (scripting/coroutine_scheduler.hpp), resumed
+// after on_update only when what they wait on happened:
+//   engine.spawn(fn, ...) -> id              -- fn(...) starts next frame
+//   engine.kill(id) -> ok
+//   engine.wait(seconds?)                    -- no seconds: the next frame
+//   engine.wait_event(name, timeout?) -> value, or nil on timeout
+//   engine.wait_until(predicate, timeout?) -> true, or false on timeout
+//   engine.signal(name, value?) -> woken     -- wait_event returns value (true when nil)
+//   engine.scheduler_budget(max_resumes?) -> max_resumes per frame
+//   engine.scheduler_stats() -> { resumed, timers_fired, signalled, conditions_polled, deferred, finished, tasks, timers, ms }
+// Waits are only valid inside a spawned coroutine; predicates are called
+// once per frame. Coroutines woken past the budget resume first next frame.
+void bind_scheduler(LuaRuntime& lua, CoroutineScheduler& scheduler);
+
+// Opt-in parallel worker states (scripting/lua_workers.hpp), updated after
+// the scheduler:
+//   engine.workers_start(path, count?) -> count or nil   -- count defaults to the job threads
+//   engine.workers_stop()
+//   engine.worker_send(worker, topic, ...) -> ok          -- numbers, booleans and strings
+// Inside a worker's script (sandboxed: no io, os or require; vec2..color as above):
+//   engine.worker() -> number, count
+//   engine.system(name, fn, type?)     -- fn(dt, entities) over this worker's share of type's
+//                                      -- entities; without a type fn(dt) runs on one worker
+//   engine.position(entity) -> x, y, z or nil
+//   engine.set_position(entity, x, y, z)
+//   engine.get(entity, type, field, lane?) -> value or nil
+//   engine.set(entity, type, field, value, lane?) -> ok
+//   engine.send(worker, topic, ...) -> ok                 -- worker 0 is the main state
+//   engine.inbox() -> { { from, topic, ... }, ... }
+// Reads see the scene as of the start of the update; writes land after
+// every worker finished. Messages for the main state arrive right after:
+//   on_worker_messages({ { from, topic, ... }, ... })
+void bind_workers(LuaRuntime& lua, LuaWorkers& workers);
+
+// Call on_worker_messages with what workers sent the main state, if anything
+void emit_worker_messages(LuaRuntime& lua, const LuaWorkers& workers);
+
+// Scene entities are named by their authored string id or by a handle
+// (integer from engine.entity; stale once the entity is destroyed):
+//   engine.entity(id) -> handle or nil
+//   engine.entity_get(id_or_handle) -> { entity, id, name, type, position, rotation, scale } or nil
+//   engine.entity_set(id_or_handle, { position = {x, y, z}, rotation = ..., scale = ... }) -> ok
+//   engine.entity_destroy(id_or_handle) -> ok    -- with its children, at the end of the frame
+// Transforms are in scene space; edits show up on the next frame.
+void bind_scene(LuaRuntime& lua, World& world, SceneIndex& index, TransformHierarchy& transforms);
+
+// Type.define schemas compiled into packed native layouts (ecs/schema.hpp).
+// int, float, bool, enum, vec2, vec3 and color fields are stored natively;
+// other field types stay in Lua. Instances are attached to entities and
+// accessed through views whose fields read and write the native columns
+// (values are clamped to the field's min/max; enums read as option names):
+//   engine.schema_compile(name, components) -> { name, size, fields = {{ name, type, offset, size }}, lua_fields }
+//   engine.component_add(id_or_handle, type, values?) -> view or nil
+//   engine.component_get(id_or_handle, type) -> view or nil
+//   engine.component_remove(id_or_handle, type) -> ok
+// Recompiling a type keeps the values of fields whose name and type are unchanged.
+void bind_schemas(LuaRuntime& lua, SchemaRegistry& schemas, World& world, SceneIndex& index);
+
+} // namespace ascii
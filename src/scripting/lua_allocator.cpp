@@ -0,0 +1,88 @@
+#include "lua_allocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace ascii {
+
+LuaAllocator::~LuaAllocator() {
+    for (void* chunk : m_chunks) {
+        std::free(chunk);
+    }
+}
+
+// Lua passes the block's real size as `osize` whenever `ptr` isn't null,
+// so small and large blocks are told apart without a header
+void* LuaAllocator::alloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+    LuaAllocator& self = *static_cast<LuaAllocator*>(ud);
+    if (nsize == 0) {
+        if (ptr) {
+            self.release(ptr, osize);
+        }
+        return nullptr;
+    }
+    if (!ptr) {
+        return self.allocate(nsize);
+    }
+    if (osize > MAX_SMALL && nsize > MAX_SMALL) {
+        return std::realloc(ptr, nsize);
+    }
+    if (osize <= MAX_SMALL && nsize <= MAX_SMALL && size_class(osize) == size_class(nsize)) {
+        return ptr;
+    }
+    void* block = self.allocate(nsize);
+    if (!block) {
+        // Lua counts on shrinking to succeed. The old block is big enough,
+        // and joins the pool when it's freed.
+        return nsize < osize ? ptr : nullptr;
+    }
+    std::memcpy(block, ptr, std::min(osize, nsize));
+    self.release(ptr, osize);
+    return block;
+}
+
+void* LuaAllocator::allocate(size_t size) {
+    m_allocations++;
+    if (size > MAX_SMALL) {
+        return std::malloc(size);
+    }
+    const size_t index = size_class(size);
+    if (FreeBlock* block = m_free[index]) {
+        m_free[index] = block->next;
+        return block;
+    }
+    const size_t block_size = (index + 1) * GRANULE;
+    if (size_t(m_end - m_cursor) < block_size) {
+        // The newest chunk's leftover is too small for this class; hand it
+        // to smaller ones so nothing is lost
+        while (m_cursor != m_end) {
+            const size_t rest = std::min<size_t>(m_end - m_cursor, MAX_SMALL);
+            release(m_cursor, rest);
+            m_cursor += rest;
+        }
+        char* chunk = static_cast<char*>(std::malloc(CHUNK_SIZE));
+        if (!chunk) {
+            return nullptr;
+        }
+        m_chunks.push_back(chunk);
+        m_cursor = chunk;
+        m_end = chunk + CHUNK_SIZE;
+    }
+    void* block = m_cursor;
+    m_cursor += block_size;
+    return block;
+}
+
+void LuaAllocator::release(void* ptr, size_t size) {
+    if (size > MAX_SMALL) {
+        std::free(ptr);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    const size_t index = size_class(size);
+    block->next = m_free[index];
+    m_free[index] = block;
+}
+
+} // namespace ascii
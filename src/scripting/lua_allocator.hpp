@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// Pooled lua_Alloc for one Lua state. Scripts allocate and free small
+// objects constantly (vector userdata, short strings, closures, small
+// tables): blocks up to MAX_SMALL bytes come from per-size free lists
+// carved out of CHUNK_SIZE chunks, bigger ones from the heap. Chunks are
+// kept until the allocator goes, after the state it serves. Not
+// thread-safe, like the state.
+class LuaAllocator {
+public:
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_SMALL = 256;
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    LuaAllocator() = default;
+    ~LuaAllocator();
+
+    // Non-copyable
+    LuaAllocator(const LuaAllocator&) = delete;
+    LuaAllocator& operator=(const LuaAllocator&) = delete;
+
+    // The lua_Alloc; `ud` is the LuaAllocator
+    static void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    // Allocations made (pooled or not) and bytes held in chunks
+    uint64_t allocations() const { return m_allocations; }
+    size_t pooled_bytes() const { return m_chunks.size() * CHUNK_SIZE; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t CLASSES = MAX_SMALL / GRANULE;
+
+    static size_t size_class(size_t size) { return (size - 1) / GRANULE; }
+
+    void* allocate(size_t size);
+    void release(void* ptr, size_t size);
+
+    FreeBlock* m_free[CLASSES] = {};
+    std::vector<void*> m_chunks;
+    char* m_cursor = nullptr;                  // Uncarved rest of the newest chunk
+    char* m_end = nullptr;
+    uint64_t m_allocations = 0;
+};
+
+} // namespace ascii
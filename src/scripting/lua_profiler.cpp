@@ -0,0 +1,276 @@
+#include "lua_profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string_view>
+
+namespace ascii {
+
+namespace {
+
+// Registry key of the running profiler (a light userdata)
+const char PROFILER_KEY = 0;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+// FNV-1a over the frame ids
+size_t LuaProfiler::StackHash::operator()(const Stack& stack) const {
+    uint64_t hash = 1469598103934665603ull;
+    for (uint32_t frame : stack) {
+        hash = (hash ^ frame) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+LuaProfiler::LuaProfiler(LuaRuntime& lua) : m_lua(lua) {
+}
+
+LuaProfiler::~LuaProfiler() {
+    stop();
+}
+
+void LuaProfiler::start(int interval) {
+    stop();
+    lua_State* L = m_lua.state().lua_state();
+    m_session++;
+    m_started = now_ns();
+    m_inside = false;
+    m_samples = 0;
+
+    lua_pushlightuserdata(L, this);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &PROFILER_KEY);
+    wrap_bindings();
+    m_lua.set_entry_callback([this](bool entered) { this->entered(entered); });
+    lua_sethook(L, &LuaProfiler::hook, LUA_MASKCOUNT, std::max(interval, 1));
+    m_running = true;
+    spdlog::info("Lua profiler started (every {} instructions, {} bindings)", std::max(interval, 1),
+                 m_bindings.size());
+}
+
+ProfileReport LuaProfiler::stop() {
+    ProfileReport report;
+    if (!m_running) {
+        return report;
+    }
+    entered(false);
+    lua_State* L = m_lua.state().lua_state();
+    lua_sethook(L, nullptr, 0, 0);
+    lua_pushnil(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &PROFILER_KEY);
+    m_lua.set_entry_callback(nullptr);
+    unwrap_bindings();
+    m_running = false;
+
+    // Equally named functions merge here
+    std::map<std::string, int64_t> lines;
+    for (const auto& [stack, ns] : m_stacks) {
+        std::string line;
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += m_frame_names[*it];
+        }
+        lines[line.empty() ? "[unsampled]" : line] += ns;
+    }
+    for (const auto& [line, ns] : lines) {
+        const int64_t us = (ns + 500) / 1000;
+        if (us > 0) {
+            report.collapsed += line + ' ' + std::to_string(us) + '\n';
+        }
+        report.lua_ms += ns / 1.0e6;
+    }
+    for (const Binding& binding : m_bindings) {
+        if (binding.calls > 0) {
+            report.bindings.push_back({"engine." + binding.key, binding.calls, binding.ns / 1.0e6});
+        }
+    }
+    std::sort(report.bindings.begin(), report.bindings.end(),
+              [](const ProfileBinding& a, const ProfileBinding& b) { return a.ms > b.ms; });
+    report.samples = m_samples;
+    report.wall_ms = (now_ns() - m_started) / 1.0e6;
+
+    m_stacks.clear();
+    m_frame_ids.clear();
+    m_frame_names.clear();
+    m_bindings.clear();
+    m_tail.clear();
+    spdlog::info("Lua profiler stopped: {} samples, {:.1f} ms of Lua in {:.1f} ms", report.samples,
+                 report.lua_ms, report.wall_ms);
+    return report;
+}
+
+LuaProfiler* LuaProfiler::active(lua_State* L) {
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &PROFILER_KEY);
+    LuaProfiler* profiler = static_cast<LuaProfiler*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    return profiler;
+}
+
+void LuaProfiler::hook(lua_State* L, lua_Debug*) {
+    LuaProfiler* self = active(L);
+    if (!self || !self->m_inside) {
+        return;
+    }
+    const int64_t now = now_ns();
+    self->walk(L);
+    self->m_stacks[self->m_scratch] += now - self->m_last;
+    self->m_tail = self->m_scratch;
+    self->m_last = now;
+    self->m_samples++;
+}
+
+// Upvalues: the wrapped function, its index in m_bindings, the session and
+// the frame name
+int LuaProfiler::binding(lua_State* L) {
+    const int args = lua_gettop(L);
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    const lua_KContext start = static_cast<lua_KContext>(now_ns());
+    lua_callk(L, args, LUA_MULTRET, start, &LuaProfiler::binding_done);
+    return binding_done(L, LUA_OK, start);
+}
+
+// Also the continuation when the binding yielded (engine.wait): the entry
+// that resumed it moved m_last past the time it was suspended
+int LuaProfiler::binding_done(lua_State* L, int status, lua_KContext start) {
+    LuaProfiler* self = active(L);
+    if (self && self->m_inside && lua_tointeger(L, lua_upvalueindex(3)) == self->m_session &&
+        lua_checkstack(L, 2)) {
+        const int64_t now = now_ns();
+        Binding& binding = self->m_bindings[static_cast<size_t>(lua_tointeger(L, lua_upvalueindex(2)))];
+        binding.calls++;
+        if (status == LUA_OK) {
+            binding.ns += now - start;
+        }
+
+        // Lua since the last charge ran in the caller, up to the call. Lua
+        // callbacks the binding ran charged their own time already.
+        self->walk(L);
+        self->m_tail.assign(self->m_scratch.begin() + 1, self->m_scratch.end());
+        if (start > self->m_last) {
+            self->m_stacks[self->m_tail] += start - self->m_last;
+            self->m_last = start;
+        }
+        self->m_stacks[self->m_scratch] += now - self->m_last;
+        self->m_last = now;
+    }
+    return lua_gettop(L);
+}
+
+void LuaProfiler::entered(bool entered) {
+    const int64_t now = now_ns();
+    if (entered) {
+        m_last = now;
+        m_tail.clear();
+    } else if (m_inside) {
+        m_stacks[m_tail] += now - m_last;
+    }
+    m_inside = entered;
+}
+
+void LuaProfiler::wrap_bindings() {
+    lua_State* L = m_lua.state().lua_state();
+    m_lua.engine().push(L);
+    std::vector<std::string> keys;
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+        if (lua_type(L, -2) == LUA_TSTRING && lua_iscfunction(L, -1) &&
+            lua_tocfunction(L, -1) != &LuaProfiler::binding) {
+            keys.emplace_back(lua_tostring(L, -2));
+        }
+        lua_pop(L, 1);
+    }
+    for (const std::string& key : keys) {
+        lua_getfield(L, -1, key.c_str());
+        lua_pushinteger(L, static_cast<lua_Integer>(m_bindings.size()));
+        lua_pushinteger(L, m_session);
+        lua_pushstring(L, ("[C] engine." + key).c_str());
+        lua_pushcclosure(L, &LuaProfiler::binding, 4);
+        lua_setfield(L, -2, key.c_str());
+        m_bindings.push_back({key});
+    }
+    lua_pop(L, 1);
+}
+
+// Scripts that kept a wrapper keep a working function: a stale one just
+// calls through
+void LuaProfiler::unwrap_bindings() {
+    lua_State* L = m_lua.state().lua_state();
+    m_lua.engine().push(L);
+    for (const Binding& binding : m_bindings) {
+        lua_getfield(L, -1, binding.key.c_str());
+        if (lua_tocfunction(L, -1) == &LuaProfiler::binding) {
+            lua_getupvalue(L, -1, 1);
+            lua_setfield(L, -3, binding.key.c_str());
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+void LuaProfiler::walk(lua_State* L) {
+    m_scratch.clear();
+    lua_Debug ar;
+    for (int level = 0; m_scratch.size() < MAX_DEPTH && lua_getstack(L, level, &ar); level++) {
+        lua_getinfo(L, "Sf", &ar);
+        m_scratch.push_back(frame_id(L, ar));
+        lua_pop(L, 1);
+    }
+}
+
+// `fn` is on top of the stack, `ar` has its source
+uint32_t LuaProfiler::frame_id(lua_State* L, lua_Debug& ar) {
+    if (const lua_CFunction fn = lua_tocfunction(L, -1)) {
+        if (fn == &LuaProfiler::binding) {
+            lua_getupvalue(L, -1, 4);
+            m_key = 'B';
+            m_key += lua_tostring(L, -1);
+            lua_pop(L, 1);
+        } else {
+            m_key = 'C';
+            m_key.append(reinterpret_cast<const char*>(&fn), sizeof(fn));
+        }
+    } else {
+        m_key = 'L';
+        m_key.append(ar.source, ar.srclen);
+        m_key += ':';
+        m_key += std::to_string(ar.linedefined);
+    }
+    auto it = m_frame_ids.find(std::string_view(m_key));
+    if (it == m_frame_ids.end()) {
+        it = m_frame_ids.emplace(m_key, static_cast<uint32_t>(m_frame_names.size())).first;
+        m_frame_names.push_back(frame_name(L, ar));
+    }
+    return it->second;
+}
+
+// `fn` is on top of the stack
+std::string LuaProfiler::frame_name(lua_State* L, lua_Debug& ar) {
+    if (lua_tocfunction(L, -1) == &LuaProfiler::binding) {
+        lua_getupvalue(L, -1, 4);
+        std::string name = lua_tostring(L, -1);
+        lua_pop(L, 1);
+        return name;
+    }
+    lua_getinfo(L, "Sn", &ar);
+    std::string name;
+    if (std::string_view(ar.what) == "C") {
+        name = std::string("[C] ") + (ar.name ? ar.name : "?");
+    } else if (std::string_view(ar.what) == "main") {
+        name = std::string("main chunk (") + ar.short_src + ")";
+    } else {
+        name = std::string(ar.name ? ar.name : "?") + " (" + ar.short_src + ":" +
+               std::to_string(ar.linedefined) + ")";
+    }
+    std::replace(name.begin(), name.end(), ';', ',');
+    return name;
+}
+
+} // namespace ascii
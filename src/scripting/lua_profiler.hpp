@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lua_runtime.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+struct ProfileBinding {
+    std::string name;                          // "engine.fov_compute"
+    uint64_t calls = 0;
+    double ms = 0.0;                           // Inclusive of Lua it called back into
+};
+
+struct ProfileReport {
+    // One "root;caller;leaf microseconds" line per stack, ready for
+    // flamegraph.pl or speedscope. Engine bindings appear as "[C] engine.x"
+    // leaves under the Lua that called them.
+    std::string collapsed;
+    std::vector<ProfileBinding> bindings;      // Called ones, slowest first
+    uint64_t samples = 0;
+    double lua_ms = 0.0;                       // Everything attributed, bindings included
+    double wall_ms = 0.0;                      // start() to stop()
+};
+
+// Sampling profiler for the main Lua state. A count hook fires every
+// `interval` VM instructions and charges the time since the last charge to
+// the Lua stack it interrupts. Instructions don't run inside C++, so while
+// profiling the engine table's C functions are swapped for wrappers that
+// charge the time of each call to the binding on top of the calling stack.
+// Every nanosecond is charged once: to a stack, or to the last stack seen
+// when native code leaves Lua.
+//
+// The clock only runs while native code is inside Lua (LuaRuntime entry
+// scopes), so frame work between script calls is never charged to a
+// script. Coroutines are sampled from their first resume after start().
+class LuaProfiler {
+public:
+    static constexpr int DEFAULT_INTERVAL = 10000;
+    static constexpr size_t MAX_DEPTH = 64;
+
+    explicit LuaProfiler(LuaRuntime& lua);
+    ~LuaProfiler();
+
+    // Non-copyable
+    LuaProfiler(const LuaProfiler&) = delete;
+    LuaProfiler& operator=(const LuaProfiler&) = delete;
+
+    // (Re)start, dropping what an unfinished run collected
+    void start(int interval = DEFAULT_INTERVAL);
+    ProfileReport stop();
+    bool running() const { return m_running; }
+
+private:
+    using Stack = std::vector<uint32_t>;       // Frame ids, innermost first
+
+    struct StackHash {
+        size_t operator()(const Stack& stack) const;
+    };
+
+    // Frame keys looked up by string_view, so a hit doesn't allocate
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>()(key); }
+    };
+
+    struct Binding {
+        std::string key;                       // Field of the engine table
+        uint64_t calls = 0;
+        int64_t ns = 0;
+    };
+
+    static LuaProfiler* active(lua_State* L);
+    static void hook(lua_State* L, lua_Debug* ar);
+    static int binding(lua_State* L);
+    static int binding_done(lua_State* L, int status, lua_KContext start);
+
+    void entered(bool entered);
+    void wrap_bindings();
+    void unwrap_bindings();
+
+    // The running stack of `L` into m_scratch
+    void walk(lua_State* L);
+    uint32_t frame_id(lua_State* L, lua_Debug& ar);
+    std::string frame_name(lua_State* L, lua_Debug& ar);
+
+    LuaRuntime& m_lua;
+    bool m_running = false;
+    bool m_inside = false;                     // Native code is running Lua
+    int64_t m_session = 0;                     // Tells stale wrappers apart
+    int64_t m_started = 0;
+    int64_t m_last = 0;                        // Time charged up to
+
+    Stack m_scratch;
+    Stack m_tail;                              // Lua stack seen last in this entry
+    std::unordered_map<Stack, int64_t, StackHash> m_stacks;
+
+    // Frames by function identity, not closure address (addresses come
+    // back after a collection): source and first line for Lua functions,
+    // the binding for engine wrappers, the function pointer for other C
+    // functions. Named after the first call seen.
+    std::unordered_map<std::string, uint32_t, KeyHash, std::equal_to<>> m_frame_ids;
+    std::vector<std::string> m_frame_names;     // By frame id
+    std::string m_key;                          // Scratch for lookups
+    std::vector<Binding> m_bindings;
+    uint64_t m_samples = 0;
+};
+
+} // namespace ascii
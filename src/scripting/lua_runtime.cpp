@@ -0,0 +1,45 @@
+#include "lua_runtime.hpp"
+
+namespace ascii {
+
+LuaRuntime::LuaRuntime(bool sandboxed) : m_lua(sol::default_at_panic, &LuaAllocator::alloc, &m_allocator) {
+    if (sandboxed) {
+        m_lua.open_libraries(sol::lib::base, sol::lib::string, sol::lib::table, sol::lib::math,
+                             sol::lib::utf8, sol::lib::coroutine);
+        m_lua["dofile"] = sol::lua_nil;
+        m_lua["loadfile"] = sol::lua_nil;
+        m_lua.create_named_table("engine");
+        return;
+    }
+    m_lua.open_libraries(sol::lib::base, sol::lib::package, sol::lib::string,
+                         sol::lib::table, sol::lib::math, sol::lib::utf8,
+                         sol::lib::coroutine, sol::lib::os, sol::lib::io);
+    m_lua.create_named_table("engine");
+
+    // Scripts require modules relative to the lua/ directory
+    m_lua["package"]["path"] = std::string("lua/?.lua;lua/?/init.lua;") +
+                               m_lua["package"]["path"].get<std::string>();
+
+    spdlog::info("Lua runtime initialized ({})", LUA_RELEASE);
+}
+
+bool LuaRuntime::run_file(const std::string& path) {
+    EntryScope entry(*this);
+    sol::protected_function_result result = m_lua.safe_script_file(path, sol::script_pass_on_error);
+    if (!result.valid()) {
+        sol::error err = result;
+        report_error(err.what());
+        return false;
+    }
+    spdlog::info("Loaded Lua script: {}", path);
+    return true;
+}
+
+void LuaRuntime::report_error(const std::string& message) {
+    spdlog::error("Lua error: {}", message);
+    if (m_on_error) {
+        m_on_error(message);
+    }
+}
+
+} // namespace ascii
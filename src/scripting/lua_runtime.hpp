@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lua_allocator.hpp"
+
+#include <sol/sol.hpp>
+#include <spdlog/spdlog.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace ascii {
+
+// Owns the game's Lua state. Script errors never throw out of here: they are
+// logged and forwarded to the error callback (e.g. the IPC "lua_error" event).
+class LuaRuntime {
+public:
+    using ErrorCallback = std::function<void(const std::string& message)>;
+    using EntryCallback = std::function<void(bool entered)>;
+
+    // Brackets native code running Lua on this state. call() and run_file()
+    // use one; so does anything else resuming scripts (the coroutine
+    // scheduler). The entry callback sees the outermost scope only.
+    class EntryScope {
+    public:
+        explicit EntryScope(LuaRuntime& lua) : m_lua(lua) {
+            if (m_lua.m_entry_depth++ == 0 && m_lua.m_on_entry) {
+                m_lua.m_on_entry(true);
+            }
+        }
+        ~EntryScope() {
+            if (--m_lua.m_entry_depth == 0 && m_lua.m_on_entry) {
+                m_lua.m_on_entry(false);
+            }
+        }
+
+        // Non-copyable
+        EntryScope(const EntryScope&) = delete;
+        EntryScope& operator=(const EntryScope&) = delete;
+
+    private:
+        LuaRuntime& m_lua;
+    };
+
+    // Sandboxed states (parallel workers) get no io, os or package
+    // libraries and can't load files themselves
+    explicit LuaRuntime(bool sandboxed = false);
+
+    // Non-copyable
+    LuaRuntime(const LuaRuntime&) = delete;
+    LuaRuntime& operator=(const LuaRuntime&) = delete;
+
+    // Run a script file; returns false if it failed to load or errored
+    bool run_file(const std::string& path);
+
+    // Call a global function if the scripts define it; returns false when it
+    // is missing or raised an error
+    template<typename... Args>
+    bool call(const char* name, Args&&... args) {
+        sol::protected_function fn = m_lua[name];
+        if (!fn.valid()) {
+            return false;
+        }
+        EntryScope entry(*this);
+        sol::protected_function_result result = fn(std::forward<Args>(args)...);
+        if (!result.valid()) {
+            sol::error err = result;
+            report_error(std::string(name) + ": " + err.what());
+            return false;
+        }
+        return true;
+    }
+
+    void set_error_callback(ErrorCallback callback) { m_on_error = std::move(callback); }
+
+    // Told when native code starts and stops running Lua (the profiler)
+    void set_entry_callback(EntryCallback callback) { m_on_entry = std::move(callback); }
+
+    // Log and forward an error raised outside call() (e.g. a resumed coroutine)
+    void report_error(const std::string& message);
+
+    sol::state& state() { return m_lua; }
+
+    // The state's pooled allocator
+    const LuaAllocator& allocator() const { return m_allocator; }
+
+    // The global `engine` table that bindings add functions to
+    sol::table engine() { return m_lua["engine"]; }
+
+private:
+    LuaAllocator m_allocator;                  // Outlives the state
+    sol::state m_lua;
+    ErrorCallback m_on_error;
+    EntryCallback m_on_entry;
+    int m_entry_depth = 0;
+};
+
+} // namespace ascii
@@ -0,0 +1,301 @@
+#include "lua_workers.hpp"
+#include "engine_api.hpp"
+#include "core/job_system.hpp"
+#include "core/stopwatch.hpp"
+#include "ecs/schema.hpp"
+#include "scene/scene_world.hpp"
+#include "scene/transform_hierarchy.hpp"
+
+#include <tuple>
+#include <type_traits>
+
+namespace ascii {
+
+struct LuaWorkers::Worker {
+    struct System {
+        std::string name;
+        std::string type;                      // Empty: the system runs on one worker
+        sol::protected_function fn;
+    };
+
+    LuaRuntime lua{true};
+    std::vector<System> systems;
+    std::vector<Write> writes;
+    std::vector<WorkerMessage> inbox;
+    std::vector<Outgoing> outbox;
+    std::vector<std::string> errors;
+};
+
+WorkerValue worker_value_from_lua(const sol::object& value) {
+    switch (value.get_type()) {
+    case sol::type::boolean:
+        return value.as<bool>();
+    case sol::type::number: {
+        lua_State* L = value.lua_state();
+        value.push(L);
+        const bool integer = lua_isinteger(L, -1);
+        lua_pop(L, 1);
+        if (integer) {
+            return value.as<int64_t>();
+        }
+        return value.as<double>();
+    }
+    case sol::type::string:
+        return value.as<std::string>();
+    default:
+        return std::monostate{};
+    }
+}
+
+sol::object worker_value_to_lua(sol::state_view lua, const WorkerValue& value) {
+    return std::visit([&](const auto& v) -> sol::object {
+        if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+            return sol::make_object(lua, sol::lua_nil);
+        } else {
+            return sol::make_object(lua, v);
+        }
+    }, value);
+}
+
+// { { from = n, topic = "...", values... }, ... }
+sol::table worker_messages_to_lua(sol::state_view lua, const std::vector<WorkerMessage>& messages) {
+    sol::table list = lua.create_table(static_cast<int>(messages.size()), 0);
+    for (size_t i = 0; i < messages.size(); i++) {
+        const WorkerMessage& message = messages[i];
+        sol::table t = lua.create_table(static_cast<int>(message.values.size()), 2);
+        t["from"] = message.from;
+        t["topic"] = message.topic;
+        for (size_t v = 0; v < message.values.size(); v++) {
+            t[v + 1] = worker_value_to_lua(lua, message.values[v]);
+        }
+        list[i + 1] = t;
+    }
+    return list;
+}
+
+LuaWorkers::LuaWorkers(LuaRuntime& lua, JobSystem& jobs) : m_lua(lua), m_jobs(jobs) {
+}
+
+LuaWorkers::~LuaWorkers() = default;
+
+bool LuaWorkers::start(const std::string& path, unsigned count) {
+    stop();
+    if (count == 0) {
+        count = m_jobs.thread_count();
+    }
+    for (uint32_t number = 1; number <= count; number++) {
+        m_workers.push_back(std::make_unique<Worker>());
+        bind(*m_workers.back(), number);
+    }
+    for (uint32_t number = 1; number <= count; number++) {
+        sol::state& state = m_workers[number - 1]->lua.state();
+        state["math"]["randomseed"](number);   // Reproducible per worker
+        sol::protected_function_result result = state.safe_script_file(path, sol::script_pass_on_error);
+        if (!result.valid()) {
+            sol::error err = result;
+            m_lua.report_error("worker " + std::to_string(number) + ": " + err.what());
+            stop();
+            return false;
+        }
+    }
+    spdlog::info("Started {} Lua workers running {}", count, path);
+    return true;
+}
+
+void LuaWorkers::stop() {
+    m_workers.clear();
+    m_main_outbox.clear();
+    m_main_inbox.clear();
+}
+
+bool LuaWorkers::send(uint32_t to, WorkerMessage message) {
+    if (to == 0 || to > m_workers.size()) {
+        return false;
+    }
+    message.from = 0;
+    m_main_outbox.push_back({to, std::move(message)});
+    return true;
+}
+
+void LuaWorkers::update(float dt, World& world, SchemaRegistry& schemas, TransformHierarchy& transforms) {
+    m_main_inbox.clear();
+    m_write_count = 0;
+    if (m_workers.empty()) {
+        return;
+    }
+
+    // The main state's messages of this frame follow the workers' of the last
+    for (Outgoing& outgoing : m_main_outbox) {
+        m_workers[outgoing.to - 1]->inbox.push_back(std::move(outgoing.message));
+    }
+    m_main_outbox.clear();
+
+    m_world = &world;
+    m_dt = dt;
+    m_stores.clear();
+    for (const SchemaStore* store : schemas.stores()) {
+        m_stores[store->schema().name()] = schemas.find(store->schema().name());
+    }
+
+    Stopwatch timer;
+    JobSystem::Group group;
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        m_jobs.submit(group, [this, i] { run(*m_workers[i], static_cast<uint32_t>(i + 1)); });
+    }
+    m_jobs.wait(group);
+    m_run_ms = timer.elapsed_ms();
+
+    // Merge in worker order; a later worker's write to the same value wins
+    timer.reset();
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        Worker& worker = *m_workers[i];
+        for (const Write& write : worker.writes) {
+            if (!write.store) {
+                if (LocalTransform* local = world.get<LocalTransform>(write.entity)) {
+                    local->position = write.position;
+                    transforms.mark_dirty(world, write.entity);
+                }
+                continue;
+            }
+            const uint32_t row = write.store->row(write.entity);
+            if (row != SchemaStore::NO_ROW) {
+                write.store->set(row, write.field, write.lane, write.value);
+            }
+        }
+        m_write_count += worker.writes.size();
+        worker.writes.clear();
+        for (const std::string& error : worker.errors) {
+            m_lua.report_error("worker " + std::to_string(i + 1) + ": " + error);
+        }
+        worker.errors.clear();
+        worker.inbox.clear();
+    }
+
+    // Deliver in sender order: to the main state now, to workers next update
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        for (Outgoing& outgoing : m_workers[i]->outbox) {
+            if (outgoing.to == 0) {
+                m_main_inbox.push_back(std::move(outgoing.message));
+            } else {
+                m_workers[outgoing.to - 1]->inbox.push_back(std::move(outgoing.message));
+            }
+        }
+        m_workers[i]->outbox.clear();
+    }
+    m_world = nullptr;
+    m_merge_ms = timer.elapsed_ms();
+}
+
+// Runs on a job thread: reads m_world and m_stores, writes only `worker`
+void LuaWorkers::run(Worker& worker, uint32_t number) {
+    const uint32_t count = this->count();
+    for (size_t s = 0; s < worker.systems.size(); s++) {
+        const Worker::System& system = worker.systems[s];
+        auto check = [&](sol::protected_function_result result) {
+            if (!result.valid()) {
+                sol::error err = result;
+                worker.errors.push_back(system.name + ": " + err.what());
+            }
+        };
+        if (system.type.empty()) {
+            if (s % count == number - 1) {
+                check(system.fn(m_dt));
+            }
+            continue;
+        }
+        auto it = m_stores.find(system.type);
+        if (it == m_stores.end()) {
+            continue;
+        }
+        const SchemaStore& store = *it->second;
+        sol::table entities = worker.lua.state().create_table();
+        int n = 0;
+        for (size_t row = 0; row < store.size(); row++) {
+            const Entity entity = store.entities()[row];
+            if (entity.index % count == number - 1) {
+                entities[++n] = entity.bits();
+            }
+        }
+        check(system.fn(m_dt, entities));
+    }
+}
+
+void LuaWorkers::bind(Worker& worker, uint32_t number) {
+    bind_math(worker.lua);
+    sol::table engine = worker.lua.engine();
+
+    engine.set_function("worker", [this, number]() {
+        return std::make_tuple(number, count());
+    });
+
+    engine.set_function("system", [&worker](const std::string& name, sol::protected_function fn,
+                                            sol::optional<std::string> type) {
+        worker.systems.push_back({name, type.value_or(std::string()), std::move(fn)});
+    });
+
+    engine.set_function("position", [this](uint64_t id)
+                                        -> std::tuple<sol::optional<float>, sol::optional<float>, sol::optional<float>> {
+        const LocalTransform* local = m_world ? m_world->get<const LocalTransform>(Entity::from_bits(id)) : nullptr;
+        if (!local) {
+            return {sol::nullopt, sol::nullopt, sol::nullopt};
+        }
+        return {local->position.x, local->position.y, local->position.z};
+    });
+
+    engine.set_function("set_position", [&worker](uint64_t id, float x, float y, float z) {
+        worker.writes.push_back({Entity::from_bits(id), nullptr, 0, 0, 0.0, glm::vec3(x, y, z)});
+    });
+
+    // Fields by type and name; lanes are 1-based (vec3: 1..3)
+    auto resolve = [this](uint64_t id, const std::string& type, const std::string& field, uint32_t lane,
+                          SchemaStore*& store, int& index) {
+        auto it = m_stores.find(type);
+        if (it == m_stores.end()) {
+            return false;
+        }
+        store = it->second;
+        index = store->schema().find(field);
+        return index >= 0 && lane >= 1 && lane <= store->schema().fields()[index].lanes &&
+               store->row(Entity::from_bits(id)) != SchemaStore::NO_ROW;
+    };
+
+    engine.set_function("get", [resolve](uint64_t id, const std::string& type, const std::string& field,
+                                         sol::optional<uint32_t> lane) -> sol::optional<double> {
+        SchemaStore* store;
+        int index;
+        if (!resolve(id, type, field, lane.value_or(1), store, index)) {
+            return sol::nullopt;
+        }
+        return store->get(store->row(Entity::from_bits(id)), index, lane.value_or(1) - 1);
+    });
+
+    engine.set_function("set", [resolve, &worker](uint64_t id, const std::string& type, const std::string& field,
+                                                  double value, sol::optional<uint32_t> lane) {
+        SchemaStore* store;
+        int index;
+        if (!resolve(id, type, field, lane.value_or(1), store, index)) {
+            return false;
+        }
+        worker.writes.push_back({Entity::from_bits(id), store, static_cast<uint32_t>(index), lane.value_or(1) - 1,
+                                 value, glm::vec3(0.0f)});
+        return true;
+    });
+
+    engine.set_function("send", [this, &worker, number](uint32_t to, const std::string& topic, sol::variadic_args va) {
+        if (to > count()) {
+            return false;
+        }
+        WorkerMessage message{number, topic, {}};
+        for (const sol::object& value : std::vector<sol::object>(va.begin(), va.end())) {
+            message.values.push_back(worker_value_from_lua(value));
+        }
+        worker.outbox.push_back({to, std::move(message)});
+        return true;
+    });
+
+    engine.set_function("inbox", [&worker](sol::this_state s) {
+        return worker_messages_to_lua(sol::state_view(s), worker.inbox);
+    });
+}
+
+} // namespace ascii
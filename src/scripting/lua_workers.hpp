@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ecs/world.hpp"
+#include "lua_runtime.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+class SchemaRegistry;
+class SchemaStore;
+class TransformHierarchy;
+
+// Value carried by a message between Lua states
+using WorkerValue = std::variant<std::monostate, bool, int64_t, double, std::string>;
+
+struct WorkerMessage {
+    uint32_t from = 0;                         // Worker number; 0 is the main state
+    std::string topic;
+    std::vector<WorkerValue> values;
+};
+
+// Conversions for values and message lists crossing into a Lua state;
+// unsupported types (tables, functions) travel as nil
+WorkerValue worker_value_from_lua(const sol::object& value);
+sol::object worker_value_to_lua(sol::state_view lua, const WorkerValue& value);
+sol::table worker_messages_to_lua(sol::state_view lua, const std::vector<WorkerMessage>& messages);
+
+// Opt-in parallel game logic: one sandboxed Lua state per worker, all
+// running the same script, updated side by side on the job system. A
+// script registers systems; a system either owns a whole job (the workers
+// take systems in turn) or runs on every worker over that worker's share
+// of the entities with a schema type (split by entity index).
+//
+// Workers read the scene as it was when update() started and never write
+// it directly: transform and schema field writes are recorded per worker
+// and applied after every worker finished, in worker order, so results
+// don't depend on thread timing. Messages work the same way: a worker only
+// appends to its own outbox while it runs (so nothing is shared and nothing
+// locks), and the merge delivers them for the next update in sender order.
+class LuaWorkers {
+public:
+    // Errors from workers are reported through the main runtime
+    LuaWorkers(LuaRuntime& lua, JobSystem& jobs);
+    ~LuaWorkers();
+
+    // Non-copyable
+    LuaWorkers(const LuaWorkers&) = delete;
+    LuaWorkers& operator=(const LuaWorkers&) = delete;
+
+    // (Re)start `count` workers (0: one per job system thread) running the
+    // script. Returns false when it fails to load in any of them.
+    bool start(const std::string& path, unsigned count = 0);
+    void stop();
+    bool running() const { return !m_workers.empty(); }
+    unsigned count() const { return static_cast<unsigned>(m_workers.size()); }
+
+    // Queue a message for worker `to` (1-based) from the main state
+    bool send(uint32_t to, WorkerMessage message);
+
+    // Deliver messages, run every worker's systems in parallel, then apply
+    // their writes. Transform writes mark the hierarchy dirty.
+    void update(float dt, World& world, SchemaRegistry& schemas, TransformHierarchy& transforms);
+
+    // Messages workers sent to the main state during the last update()
+    const std::vector<WorkerMessage>& main_inbox() const { return m_main_inbox; }
+
+    // From the last update(): time of the parallel phase and the merge
+    double run_ms() const { return m_run_ms; }
+    double merge_ms() const { return m_merge_ms; }
+    size_t writes() const { return m_write_count; }
+
+private:
+    struct Worker;
+
+    struct Write {
+        Entity entity;
+        SchemaStore* store;                    // nullptr: LocalTransform position
+        uint32_t field;
+        uint32_t lane;
+        double value;
+        glm::vec3 position;
+    };
+
+    struct Outgoing {
+        uint32_t to;
+        WorkerMessage message;
+    };
+
+    void bind(Worker& worker, uint32_t number);
+    void run(Worker& worker, uint32_t number);
+
+    LuaRuntime& m_lua;
+    JobSystem& m_jobs;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<Outgoing> m_main_outbox;
+    std::vector<WorkerMessage> m_main_inbox;
+
+    // Read-only state of the current update() for the worker bindings
+    const World* m_world = nullptr;
+    std::unordered_map<std::string, SchemaStore*> m_stores;
+    float m_dt = 0.0f;
+
+    double m_run_ms = 0.0;
+    double m_merge_ms = 0.0;
+    size_t m_write_count = 0;
+};
+
+} // namespace ascii
@@ -0,0 +1,303 @@
+#include "field_of_view.hpp"
+#include "tilemap.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+
+namespace ascii {
+
+namespace {
+
+constexpr uint32_t NO_REQUEST = 0xFFFFFFFFu;
+
+size_t word_count(size_t bits) {
+    return (bits + 63) / 64;
+}
+
+bool test_bit(const std::vector<uint64_t>& bits, size_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+// Sets the bit; false if it was already set
+bool set_bit(std::vector<uint64_t>& bits, size_t i) {
+    const uint64_t mask = uint64_t(1) << (i & 63);
+    const bool was_set = (bits[i >> 6] & mask) != 0;
+    bits[i >> 6] |= mask;
+    return !was_set;
+}
+
+// p / q rounded toward negative infinity, q > 0
+int64_t floor_div(int64_t p, int64_t q) {
+    return p >= 0 ? p / q : -((-p + q - 1) / q);
+}
+
+// num / den with den > 0
+struct Slope {
+    int64_t num;
+    int64_t den;
+};
+
+// Tiles at one distance from the origin within a quadrant, between two slopes
+struct Row {
+    int64_t depth;
+    Slope start;
+    Slope end;
+};
+
+// Slope through the near corner of the tile at (depth, col)
+Slope tile_slope(int64_t depth, int64_t col) {
+    return {2 * col - 1, 2 * depth};
+}
+
+// (depth, col) in a quadrant -> tile offset: dx = col * cx + depth * dx_depth,
+// dy = col * cy + depth * dy_depth
+struct Quadrant {
+    int cx, dx_depth, cy, dy_depth;
+};
+
+constexpr Quadrant QUADRANTS[4] = {
+    {1, 0, 0, -1},     // North
+    {0, 1, 1, 0},      // East
+    {1, 0, 0, 1},      // South
+    {0, -1, 1, 0},     // West
+};
+
+} // anonymous namespace
+
+FieldOfView::FieldOfView(float opaque_height)
+    : m_opaque_height(opaque_height)
+{
+}
+
+void FieldOfView::sync(const Tilemap& map) {
+    const bool resized = !m_synced || map.width() != m_width || map.height() != m_height;
+    if (!resized && map.revision() == m_revision) {
+        return;
+    }
+    if (resized) {
+        m_width = map.width();
+        m_height = map.height();
+        m_opaque.assign(word_count(static_cast<size_t>(m_width) * m_height), 0);
+        for (Viewer& viewer : m_viewers) {
+            viewer.stale = true;
+            viewer.explored.assign(m_opaque.size(), 0);
+        }
+    }
+
+    for (int chunk = 0; chunk < map.chunk_count(); chunk++) {
+        if (!resized && map.chunk_revision(chunk) <= m_revision) {
+            continue;
+        }
+        const int x0 = (chunk % map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int y0 = (chunk / map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int x1 = std::min(x0 + Tilemap::CHUNK_SIZE, m_width);
+        const int y1 = std::min(y0 + Tilemap::CHUNK_SIZE, m_height);
+
+        bool changed = false;
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const size_t i = static_cast<size_t>(y) * m_width + x;
+                bool blocks = false;
+                for (int layer = 0; layer < map.layers() && !blocks; layer++) {
+                    blocks = map.layer_glyphs(layer)[i] != 0 &&
+                             map.layer_base(layer) + map.layer_heights(layer)[i] >= m_opaque_height;
+                }
+                if (blocks != test_bit(m_opaque, i)) {
+                    m_opaque[i >> 6] ^= uint64_t(1) << (i & 63);
+                    changed = true;
+                }
+            }
+        }
+
+        // Only viewers whose square reaches into the chunk can see the change
+        if (changed && !resized) {
+            for (Viewer& viewer : m_viewers) {
+                if (viewer.x + viewer.radius >= x0 && viewer.x - viewer.radius < x1 &&
+                    viewer.y + viewer.radius >= y0 && viewer.y - viewer.radius < y1) {
+                    viewer.stale = true;
+                }
+            }
+        }
+    }
+    m_revision = map.revision();
+    m_synced = true;
+}
+
+bool FieldOfView::opaque(int x, int y) const {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return true;
+    }
+    return test_bit(m_opaque, static_cast<size_t>(y) * m_width + x);
+}
+
+bool FieldOfView::compute(const Request& request) {
+    Viewer& viewer = m_viewers[get_or_add(request.viewer)];
+    if (!needs_cast(viewer, request)) {
+        return false;
+    }
+    cast(viewer, request);
+    return true;
+}
+
+size_t FieldOfView::compute(std::span<const Request> requests, JobSystem& jobs) {
+    std::vector<uint32_t> slots(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        slots[i] = get_or_add(requests[i].viewer);
+    }
+    std::vector<uint32_t> last(m_viewers.size(), NO_REQUEST);
+    for (size_t i = 0; i < requests.size(); i++) {
+        last[slots[i]] = static_cast<uint32_t>(i);
+    }
+    std::vector<uint32_t> run;
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (last[slots[i]] == i && needs_cast(m_viewers[slots[i]], requests[i])) {
+            run.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Viewers are independent and the opacity bitset is only read
+    jobs.parallel_for(run.size(), 4, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            cast(m_viewers[slots[run[r]]], requests[run[r]]);
+        }
+    });
+    return run.size();
+}
+
+bool FieldOfView::visible(uint64_t viewer, int x, int y) const {
+    const Viewer* v = find(viewer);
+    if (!v || v->radius < 0 || x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return false;
+    }
+    const int wx = x - v->x + v->radius;
+    const int wy = y - v->y + v->radius;
+    const int side = 2 * v->radius + 1;
+    if (wx < 0 || wy < 0 || wx >= side || wy >= side) {
+        return false;
+    }
+    return test_bit(v->visible, static_cast<size_t>(wy) * side + wx);
+}
+
+bool FieldOfView::explored(uint64_t viewer, int x, int y) const {
+    const Viewer* v = find(viewer);
+    if (!v || x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return false;
+    }
+    return test_bit(v->explored, static_cast<size_t>(y) * m_width + x);
+}
+
+size_t FieldOfView::visible_count(uint64_t viewer) const {
+    const Viewer* v = find(viewer);
+    return v ? v->visible_count : 0;
+}
+
+void FieldOfView::forget(uint64_t viewer) {
+    auto it = m_slot_of.find(viewer);
+    if (it == m_slot_of.end()) {
+        return;
+    }
+    const uint32_t slot = it->second;
+    m_slot_of.erase(it);
+    if (slot + 1 != m_viewers.size()) {
+        m_viewers[slot] = std::move(m_viewers.back());
+        m_slot_of[m_viewers[slot].id] = slot;
+    }
+    m_viewers.pop_back();
+}
+
+void FieldOfView::clear() {
+    m_viewers.clear();
+    m_slot_of.clear();
+}
+
+uint32_t FieldOfView::get_or_add(uint64_t id) {
+    auto [it, added] = m_slot_of.try_emplace(id, static_cast<uint32_t>(m_viewers.size()));
+    if (added) {
+        Viewer& viewer = m_viewers.emplace_back();
+        viewer.id = id;
+        viewer.explored.assign(m_opaque.size(), 0);
+    }
+    return it->second;
+}
+
+const FieldOfView::Viewer* FieldOfView::find(uint64_t id) const {
+    auto it = m_slot_of.find(id);
+    return it == m_slot_of.end() ? nullptr : &m_viewers[it->second];
+}
+
+bool FieldOfView::needs_cast(const Viewer& viewer, const Request& request) const {
+    return viewer.stale || viewer.x != request.x || viewer.y != request.y ||
+           viewer.radius != std::max(request.radius, 0);
+}
+
+void FieldOfView::reveal(Viewer& viewer, int x, int y) const {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return;
+    }
+    const int side = 2 * viewer.radius + 1;
+    const size_t bit = static_cast<size_t>(y - viewer.y + viewer.radius) * side + (x - viewer.x + viewer.radius);
+    if (set_bit(viewer.visible, bit)) {
+        viewer.visible_count++;
+        set_bit(viewer.explored, static_cast<size_t>(y) * m_width + x);
+    }
+}
+
+// Symmetric shadowcasting (Albert Ford): each quadrant is scanned row by row
+// outward, a row being the tiles at one depth between a start and an end
+// slope. A floor tile is lit only if its center lies within the slopes,
+// which is what makes the result symmetric; a wall is lit if any part of it
+// is. Walls narrow the slopes for the rows behind them. Rows are kept on a
+// stack instead of recursing.
+void FieldOfView::cast(Viewer& viewer, const Request& request) const {
+    const int radius = std::max(request.radius, 0);
+    const int side = 2 * radius + 1;
+    viewer.x = request.x;
+    viewer.y = request.y;
+    viewer.radius = radius;
+    viewer.stale = false;
+    viewer.visible.assign(word_count(static_cast<size_t>(side) * side), 0);
+    viewer.visible_count = 0;
+    reveal(viewer, request.x, request.y);
+
+    const int64_t radius_sq = int64_t(radius) * radius + radius;     // Rounder than radius^2
+    std::vector<Row> rows;
+    for (const Quadrant& q : QUADRANTS) {
+        rows.push_back({1, {-1, 1}, {1, 1}});
+        while (!rows.empty()) {
+            Row row = rows.back();
+            rows.pop_back();
+            if (row.depth > radius) {
+                continue;
+            }
+
+            // Columns whose centers lie within the slopes, rounding ties outward
+            const int64_t min_col = floor_div(2 * row.depth * row.start.num + row.start.den, 2 * row.start.den);
+            const int64_t max_col = -floor_div(row.end.den - 2 * row.depth * row.end.num, 2 * row.end.den);
+            int prev = -1;      // -1 none yet, 0 floor, 1 wall
+            for (int64_t col = min_col; col <= max_col; col++) {
+                const int64_t dx = col * q.cx + row.depth * q.dx_depth;
+                const int64_t dy = col * q.cy + row.depth * q.dy_depth;
+                const int x = request.x + static_cast<int>(dx);
+                const int y = request.y + static_cast<int>(dy);
+                const bool wall = opaque(x, y);
+                const bool symmetric = col * row.start.den >= row.depth * row.start.num &&
+                                       col * row.end.den <= row.depth * row.end.num;
+                if ((wall || symmetric) && dx * dx + dy * dy <= radius_sq) {
+                    reveal(viewer, x, y);
+                }
+                if (prev == 1 && !wall) {
+                    row.start = tile_slope(row.depth, col);
+                }
+                if (prev == 0 && wall) {
+                    rows.push_back({row.depth + 1, row.start, tile_slope(row.depth, col)});
+                }
+                prev = wall ? 1 : 0;
+            }
+            if (prev == 0) {
+                rows.push_back({row.depth + 1, row.start, row.end});
+            }
+        }
+    }
+}
+
+} // namespace ascii
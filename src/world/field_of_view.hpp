@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+class Tilemap;
+
+// Roguelike field of view over a Tilemap's tiles: symmetric shadowcasting
+// (a tile is visible from the origin exactly when the origin is visible
+// from it, walls included), cast per quadrant with exact rational slopes.
+// Opacity is kept as a bitset copied from the map; every viewer keeps a
+// visible bitset over the square its radius covers and an explored bitset
+// over the whole map.
+//
+// Results are cached per viewer: computing again from the same origin and
+// radius is free unless a map edit since touched a chunk inside the
+// viewer's square, so after an edit only the viewers near it recompute.
+class FieldOfView {
+public:
+    // A tile blocks sight when any layer has a tile there whose top (layer
+    // base + tile height) reaches opaque_height; tiles outside the map do too
+    explicit FieldOfView(float opaque_height = 0.5f);
+
+    // Pull opacity from the map: everything on the first call or after a
+    // resize (which also forgets what viewers explored), afterwards only
+    // the chunks edited since the last sync
+    void sync(const Tilemap& map);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    bool opaque(int x, int y) const;
+
+    struct Request {
+        uint64_t viewer;               // Any id the caller picks (e.g. an entity handle)
+        int x;
+        int y;
+        int radius;                    // Euclidean, in tiles
+    };
+
+    // Field of view of one viewer; false when the cached result still held
+    bool compute(const Request& request);
+
+    // Many viewers over the jobs (the last request wins for a viewer named
+    // twice); returns how many were recomputed
+    size_t compute(std::span<const Request> requests, JobSystem& jobs);
+
+    // False for unknown viewers and tiles outside the map
+    bool visible(uint64_t viewer, int x, int y) const;
+    bool explored(uint64_t viewer, int x, int y) const;
+    size_t visible_count(uint64_t viewer) const;
+
+    // fn(x, y) for every visible tile, row by row
+    template<typename Fn>
+    void each_visible(uint64_t viewer, Fn&& fn) const {
+        const Viewer* v = find(viewer);
+        if (!v || v->radius < 0) {
+            return;
+        }
+        const int side = 2 * v->radius + 1;
+        for (int wy = 0; wy < side; wy++) {
+            for (int wx = 0; wx < side; wx++) {
+                const size_t bit = static_cast<size_t>(wy) * side + wx;
+                if (v->visible[bit >> 6] & (uint64_t(1) << (bit & 63))) {
+                    fn(v->x - v->radius + wx, v->y - v->radius + wy);
+                }
+            }
+        }
+    }
+
+    void forget(uint64_t viewer);
+    void clear();
+    size_t viewer_count() const { return m_viewers.size(); }
+
+private:
+    struct Viewer {
+        uint64_t id = 0;
+        int x = 0;
+        int y = 0;
+        int radius = -1;                       // -1 until computed
+        bool stale = true;
+        size_t visible_count = 0;
+        std::vector<uint64_t> visible;         // (2 * radius + 1)^2 bits around (x, y)
+        std::vector<uint64_t> explored;        // width * height bits
+    };
+
+    uint32_t get_or_add(uint64_t id);           // Slot of the viewer
+    const Viewer* find(uint64_t id) const;
+    bool needs_cast(const Viewer& viewer, const Request& request) const;
+    void cast(Viewer& viewer, const Request& request) const;
+    void reveal(Viewer& viewer, int x, int y) const;
+
+    float m_opaque_height;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_synced = false;
+    uint64_t m_revision = 0;                   // Map revision last synced
+    std::vector<uint64_t> m_opaque;            // Bit per tile, row-major
+    std::vector<Viewer> m_viewers;
+    std::unordered_map<uint64_t, uint32_t> m_slot_of;
+};
+
+} // namespace ascii
@@ -0,0 +1,171 @@
+#include "world/field_of_view.hpp"
+#include "core/job_system.hpp"
+#include "core/test.hpp"
+#include "world/tilemap.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+constexpr int SIZE = 40;
+constexpr Tile WALL{'#', 0, 1.0f};
+constexpr Tile FLOOR{'.', 0, 0.0f};
+
+void generate_map(Tilemap& map, uint32_t seed, int pillars) {
+    map.resize(SIZE, SIZE, 1);
+    map.fill_rect(0, 0, 0, SIZE, SIZE, FLOOR);
+    std::mt19937 rng(seed);
+    for (int i = 0; i < pillars; i++) {
+        map.set(0, rng() % SIZE, rng() % SIZE, WALL);
+    }
+    map.fill_rect(0, 10, 5, 1, 20, WALL);
+    map.fill_rect(0, 20, 25, 12, 1, WALL);
+}
+
+uint64_t viewer_id(int x, int y) {
+    return uint64_t(y) * SIZE + x;
+}
+
+// Every tile sees every tile that sees it back: cast from each floor tile,
+// then check each visible pair from both ends
+void symmetric() {
+    JobSystem jobs(2);
+    for (uint32_t seed = 1; seed <= 3; seed++) {
+        for (int radius : {4, 9}) {
+            Tilemap map;
+            generate_map(map, seed, 200);
+            FieldOfView fov;
+            fov.sync(map);
+
+            std::vector<FieldOfView::Request> requests;
+            for (int y = 0; y < SIZE; y++) {
+                for (int x = 0; x < SIZE; x++) {
+                    if (!fov.opaque(x, y)) {
+                        requests.push_back({viewer_id(x, y), x, y, radius});
+                    }
+                }
+            }
+            fov.compute(requests, jobs);
+
+            int asymmetric = 0;
+            for (const FieldOfView::Request& from : requests) {
+                fov.each_visible(from.viewer, [&](int x, int y) {
+                    if (!fov.opaque(x, y) && !fov.visible(viewer_id(x, y), from.x, from.y)) {
+                        asymmetric++;
+                    }
+                });
+            }
+            CHECK(asymmetric == 0);
+        }
+    }
+}
+
+void open_room_and_walls() {
+    Tilemap map;
+    map.resize(21, 21, 1);
+    map.fill_rect(0, 0, 0, 21, 21, FLOOR);
+    map.fill_rect(0, 14, 4, 1, 13, WALL);     // A wall east of the origin
+    FieldOfView fov;
+    fov.sync(map);
+    CHECK(fov.opaque(14, 10) && !fov.opaque(13, 10) && fov.opaque(-1, 0) && fov.opaque(21, 0));
+
+    const int radius = 6;
+    CHECK(fov.compute({1, 10, 10, radius}));
+    CHECK(fov.visible(1, 10, 10));
+    for (int y = 0; y < 21; y++) {
+        for (int x = 0; x < 14; x++) {
+            const int d2 = (x - 10) * (x - 10) + (y - 10) * (y - 10);
+            if (d2 <= radius * radius) {
+                CHECK(fov.visible(1, x, y));
+            }
+            if (d2 > radius * radius + radius) {
+                CHECK(!fov.visible(1, x, y));
+            }
+        }
+    }
+    CHECK(fov.visible(1, 14, 10));            // The wall itself is seen
+    CHECK(!fov.visible(1, 15, 10));           // What's behind it is not
+    CHECK(!fov.visible(1, 16, 11));
+    CHECK(!fov.visible(1, 100, 100) && !fov.visible(2, 10, 10));
+
+    size_t counted = 0;
+    fov.each_visible(1, [&](int, int) { counted++; });
+    CHECK(counted == fov.visible_count(1));
+}
+
+// Same origin and radius is free until an edit lands inside the viewer's
+// square; explored tiles accumulate as the viewer moves
+void caches_and_explores() {
+    Tilemap map;
+    map.resize(128, 64, 1);
+    map.fill_rect(0, 0, 0, 128, 64, FLOOR);
+    FieldOfView fov;
+    fov.sync(map);
+
+    CHECK(fov.compute({7, 10, 10, 5}));
+    CHECK(!fov.compute({7, 10, 10, 5}));
+    CHECK(fov.compute({7, 10, 10, 6}));       // New radius
+
+    map.set(0, 120, 60, WALL);                // Far away
+    fov.sync(map);
+    CHECK(!fov.compute({7, 10, 10, 6}));
+
+    map.set(0, 12, 10, WALL);                 // In view: recast, and it now blocks
+    fov.sync(map);
+    CHECK(fov.compute({7, 10, 10, 6}));
+    CHECK(fov.visible(7, 12, 10) && !fov.visible(7, 14, 10));
+
+    CHECK(fov.compute({7, 40, 30, 6}));
+    CHECK(fov.visible(7, 40, 30) && !fov.visible(7, 10, 10));
+    CHECK(fov.explored(7, 10, 10) && fov.explored(7, 40, 30) && !fov.explored(7, 100, 5));
+
+    fov.forget(7);
+    CHECK(fov.viewer_count() == 0 && !fov.explored(7, 10, 10));
+}
+
+// A batch gives the same result as computing each viewer alone
+void batch_matches_serial() {
+    JobSystem jobs(4);
+    Tilemap map;
+    generate_map(map, 42, 150);
+    FieldOfView batch;
+    FieldOfView serial;
+    batch.sync(map);
+    serial.sync(map);
+
+    std::mt19937 rng(5);
+    std::vector<FieldOfView::Request> requests;
+    for (uint64_t id = 0; id < 64; id++) {
+        requests.push_back({id, int(rng() % SIZE), int(rng() % SIZE), 3 + int(rng() % 8)});
+    }
+    CHECK(batch.compute(requests, jobs) == requests.size());
+    for (const FieldOfView::Request& request : requests) {
+        serial.compute(request);
+    }
+    int different = 0;
+    for (const FieldOfView::Request& request : requests) {
+        different += batch.visible_count(request.viewer) != serial.visible_count(request.viewer);
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                different += batch.visible(request.viewer, x, y) != serial.visible(request.viewer, x, y);
+            }
+        }
+    }
+    CHECK(different == 0);
+    CHECK(batch.compute(requests, jobs) == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"symmetric", symmetric},
+        {"open_room_and_walls", open_room_and_walls},
+        {"caches_and_explores", caches_and_explores},
+        {"batch_matches_serial", batch_matches_serial},
+    });
+}
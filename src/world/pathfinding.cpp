@@ -0,0 +1,523 @@
+#include "pathfinding.hpp"
+#include "tilemap.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <queue>
+
+namespace ascii {
+
+namespace {
+
+constexpr size_t MAX_LOG = 1 << 16;            // Changes kept for repairs
+constexpr size_t REPAIR_LIMIT = 64;            // Repair while changes stay under 1/64 of the tiles
+constexpr size_t REBUILD_SHARE = 8;            // ... and what they invalidate under 1/8
+constexpr uint32_t RING = PathGrid::DIAGONAL_COST + 1;
+
+// Admissible A* estimate: straight steps plus the diagonal ones' extra
+uint32_t octile(int dx, int dy) {
+    const uint32_t ax = static_cast<uint32_t>(std::abs(dx));
+    const uint32_t ay = static_cast<uint32_t>(std::abs(dy));
+    return PathGrid::STRAIGHT_COST * (ax + ay) -
+           (2 * PathGrid::STRAIGHT_COST - PathGrid::DIAGONAL_COST) * std::min(ax, ay);
+}
+
+// Per-range A* state; stamps avoid clearing between searches
+struct SearchScratch {
+    std::vector<uint32_t> cost;
+    std::vector<uint32_t> stamp;
+    std::vector<uint8_t> from;                 // Direction the tile was reached in
+    uint32_t generation = 0;
+};
+
+std::vector<glm::ivec2> find_path(const PathGrid& grid, const PathRequest& request, SearchScratch& scratch) {
+    const glm::ivec2 from = request.from;
+    const glm::ivec2 to = request.to;
+    if (!grid.in_bounds(from.x, from.y) || !grid.in_bounds(to.x, to.y)) {
+        return {};
+    }
+    const uint32_t goal = grid.index(to.x, to.y);
+    const uint32_t generation = ++scratch.generation;
+    auto visit = [&](uint32_t tile, uint32_t cost, uint8_t direction) {
+        scratch.stamp[tile] = generation;
+        scratch.cost[tile] = cost;
+        scratch.from[tile] = direction;
+    };
+
+    // (estimate << 32 | remaining, tile): ties go to the tile nearer the
+    // goal, which keeps open areas from being flooded. Lazily deleted:
+    // entries whose cost went down since are skipped.
+    using Entry = std::pair<uint64_t, uint32_t>;
+    auto key = [](uint32_t cost, uint32_t remaining) {
+        return (uint64_t(cost + remaining) << 32) | remaining;
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    const uint32_t start = grid.index(from.x, from.y);
+    visit(start, 0, 0xFF);
+    open.push({key(0, octile(to.x - from.x, to.y - from.y)), start});
+    bool found = start == goal;
+    while (!open.empty() && !found) {
+        const auto [entry_key, tile] = open.top();
+        open.pop();
+        const int x = static_cast<int>(tile % grid.width());
+        const int y = static_cast<int>(tile / grid.width());
+        const uint32_t cost = scratch.cost[tile];
+        if (entry_key != key(cost, octile(to.x - x, to.y - y))) {
+            continue;
+        }
+        if (tile == goal) {
+            found = true;
+            break;
+        }
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            const uint32_t step = grid.step_cost(x, y, d);
+            if (step == PathGrid::UNREACHABLE) {
+                continue;
+            }
+            const int nx = x + PathGrid::DX[d];
+            const int ny = y + PathGrid::DY[d];
+            const uint32_t next = grid.index(nx, ny);
+            const uint32_t next_cost = cost + step + (next == goal ? 0 : grid.occupied_cost(next));
+            if (scratch.stamp[next] != generation || next_cost < scratch.cost[next]) {
+                visit(next, next_cost, static_cast<uint8_t>(d));
+                open.push({key(next_cost, octile(to.x - nx, to.y - ny)), next});
+            }
+        }
+    }
+    if (!found) {
+        return {};
+    }
+
+    std::vector<glm::ivec2> path;
+    for (glm::ivec2 at = to; ; ) {
+        path.push_back(at);
+        const uint8_t d = scratch.from[grid.index(at.x, at.y)];
+        if (d == 0xFF) {
+            break;
+        }
+        at = {at.x - PathGrid::DX[d], at.y - PathGrid::DY[d]};
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+} // anonymous namespace
+
+// --- PathGrid ---
+
+PathGrid::PathGrid(float blocking_height)
+    : m_blocking_height(blocking_height)
+{
+}
+
+void PathGrid::sync(const Tilemap& map) {
+    const bool resized = !m_synced || map.width() != m_width || map.height() != m_height;
+    if (!resized && map.revision() == m_map_revision) {
+        return;
+    }
+    if (resized) {
+        m_width = map.width();
+        m_height = map.height();
+        m_blocked.assign(static_cast<size_t>(m_width) * m_height, 0);
+        m_moves.assign(m_blocked.size(), 0);
+        m_occupants.assign(m_blocked.size(), 0);
+        m_revision++;
+        m_log_base = m_revision;               // Too far back for every map
+        m_log.clear();
+    }
+
+    for (int chunk = 0; chunk < map.chunk_count(); chunk++) {
+        if (!resized && map.chunk_revision(chunk) <= m_map_revision) {
+            continue;
+        }
+        const int x0 = (chunk % map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int y0 = (chunk / map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int x1 = std::min(x0 + Tilemap::CHUNK_SIZE, m_width);
+        const int y1 = std::min(y0 + Tilemap::CHUNK_SIZE, m_height);
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const uint32_t i = index(x, y);
+                uint8_t wall = 0;
+                for (int layer = 0; layer < map.layers() && !wall; layer++) {
+                    wall = map.layer_glyphs(layer)[i] != 0 &&
+                           map.layer_base(layer) + map.layer_heights(layer)[i] >= m_blocking_height;
+                }
+                if (wall != m_blocked[i]) {
+                    m_blocked[i] = wall;
+                    if (!resized) {
+                        update_moves(x, y);
+                        log_change(i);
+                    }
+                }
+            }
+        }
+    }
+    if (resized) {
+        for (int y = 0; y < m_height; y++) {
+            for (int x = 0; x < m_width; x++) {
+                update_moves(x, y);
+            }
+        }
+    }
+    m_map_revision = map.revision();
+    m_synced = true;
+}
+
+void PathGrid::update_moves(int x, int y) {
+    for (int ty = std::max(y - 1, 0); ty <= std::min(y + 1, m_height - 1); ty++) {
+        for (int tx = std::max(x - 1, 0); tx <= std::min(x + 1, m_width - 1); tx++) {
+            uint8_t moves = 0;
+            if (!m_blocked[index(tx, ty)]) {
+                for (int d = 0; d < DIRECTIONS; d++) {
+                    const bool open = !blocked(tx + DX[d], ty + DY[d]) &&
+                                      (d < 4 || (!blocked(tx + DX[d], ty) && !blocked(tx, ty + DY[d])));
+                    moves |= open ? uint8_t(1u << d) : 0;
+                }
+            }
+            m_moves[index(tx, ty)] = moves;
+        }
+    }
+}
+
+void PathGrid::add_occupant(int x, int y) {
+    if (in_bounds(x, y)) {
+        m_occupants[index(x, y)]++;
+    }
+}
+
+void PathGrid::remove_occupant(int x, int y) {
+    if (in_bounds(x, y) && m_occupants[index(x, y)] > 0) {
+        m_occupants[index(x, y)]--;
+    }
+}
+
+bool PathGrid::changes_since(uint64_t revision, std::vector<uint32_t>& out) const {
+    if (revision < m_log_base) {
+        return false;
+    }
+    out.assign(m_log.begin() + static_cast<ptrdiff_t>(revision - m_log_base), m_log.end());
+    return true;
+}
+
+void PathGrid::log_change(uint32_t tile) {
+    if (m_log.size() == MAX_LOG) {
+        m_log_base += m_log.size();
+        m_log.clear();
+    }
+    m_log.push_back(tile);
+    m_revision++;
+}
+
+// --- DijkstraMap ---
+
+DijkstraMap::DijkstraMap(const PathGrid& grid)
+    : m_grid(grid)
+    , m_buckets(RING)
+{
+}
+
+void DijkstraMap::set_goals(std::vector<Goal> goals) {
+    if (goals != m_goals) {
+        m_goals = std::move(goals);
+        m_goals_changed = true;
+    }
+}
+
+bool DijkstraMap::stale() const {
+    return !m_built || m_goals_changed || m_revision != m_grid.revision();
+}
+
+size_t DijkstraMap::update(JobSystem& jobs) {
+    if (!stale()) {
+        return 0;
+    }
+    std::vector<uint32_t> changed;
+    const bool repairable = m_built && !m_goals_changed && m_distance.size() == m_grid.size() &&
+                            m_grid.changes_since(m_revision, changed) &&
+                            changed.size() * REPAIR_LIMIT <= m_grid.size();
+    const size_t settled = repairable ? repair(changed, jobs) : rebuild(jobs);
+    m_revision = m_grid.revision();
+    m_goals_changed = false;
+    m_built = true;
+    return settled;
+}
+
+uint32_t DijkstraMap::distance(int x, int y) const {
+    if (!m_grid.in_bounds(x, y) || m_distance.size() != m_grid.size()) {
+        return PathGrid::UNREACHABLE;
+    }
+    return m_distance[m_grid.index(x, y)];
+}
+
+// Only neighbors strictly nearer a goal are considered, so an agent never
+// walks back and forth around a crowd
+std::optional<glm::ivec2> DijkstraMap::next_step(int x, int y) const {
+    if (!m_grid.in_bounds(x, y) || m_flow.size() != m_grid.size()) {
+        return std::nullopt;
+    }
+    const uint32_t tile = m_grid.index(x, y);
+    uint8_t best = m_flow[tile];
+    if (best == NO_FLOW) {
+        return std::nullopt;
+    }
+    const uint32_t ahead = m_grid.index(x + PathGrid::DX[best], y + PathGrid::DY[best]);
+    if (!m_goal[ahead] && m_grid.occupants(x + PathGrid::DX[best], y + PathGrid::DY[best]) > 0) {
+        uint32_t best_cost = m_distance[tile] + PathGrid::OCCUPIED_COST;
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            const uint32_t step = m_grid.step_cost(x, y, d);
+            if (step == PathGrid::UNREACHABLE) {
+                continue;
+            }
+            const uint32_t next = m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d]);
+            if (m_distance[next] >= m_distance[tile]) {
+                continue;
+            }
+            const uint32_t cost = m_distance[next] + step + (m_goal[next] ? 0 : m_grid.occupied_cost(next));
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = static_cast<uint8_t>(d);
+            }
+        }
+    }
+    return glm::ivec2(x + PathGrid::DX[best], y + PathGrid::DY[best]);
+}
+
+size_t DijkstraMap::rebuild(JobSystem& jobs) {
+    const size_t tiles = m_grid.size();
+    m_distance.assign(tiles, PathGrid::UNREACHABLE);
+    m_goal.assign(tiles, 0);
+    m_mark.assign(tiles, 0);
+    m_flow.resize(tiles);
+
+    std::vector<Seed> seeds;
+    for (const Goal& goal : m_goals) {
+        if (m_grid.in_bounds(goal.x, goal.y)) {
+            const uint32_t tile = m_grid.index(goal.x, goal.y);
+            m_goal[tile] = 1;
+            m_distance[tile] = std::min(m_distance[tile], goal.cost);
+            seeds.push_back({goal.cost, tile});
+        }
+    }
+    const size_t settled = settle(seeds, nullptr);
+
+    const int width = m_grid.width();
+    jobs.parallel_for(static_cast<size_t>(m_grid.height()), 16, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (int x = 0; x < width; x++) {
+                update_flow(static_cast<uint32_t>(y * width + x));
+            }
+        }
+    });
+    return settled;
+}
+
+// Tiles whose distance may have been carried through a changed tile: the
+// changed tiles and their neighbors (a wall also opens or closes the
+// diagonals past it), then everything downstream of those along edges
+// their old distances were tight on. They are reset, seeded from their
+// intact neighbors and settled again; lower distances spread from there
+// into the intact area by the usual relaxation.
+size_t DijkstraMap::repair(const std::vector<uint32_t>& changed, JobSystem& jobs) {
+    const int width = m_grid.width();
+    std::vector<uint32_t> affected;
+    auto mark = [&](uint32_t tile) {
+        if (!m_mark[tile]) {
+            m_mark[tile] = 1;
+            affected.push_back(tile);
+        }
+    };
+    for (uint32_t tile : changed) {
+        const int x = static_cast<int>(tile % width);
+        const int y = static_cast<int>(tile / width);
+        mark(tile);
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            if (m_grid.in_bounds(x + PathGrid::DX[d], y + PathGrid::DY[d])) {
+                mark(m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d]));
+            }
+        }
+    }
+    for (size_t i = 0; i < affected.size(); i++) {
+        if (affected.size() * REBUILD_SHARE > m_grid.size()) {
+            return rebuild(jobs);              // Cheaper than repairing most of the map
+        }
+        const uint32_t tile = affected[i];
+        const uint32_t distance = m_distance[tile];
+        if (distance == PathGrid::UNREACHABLE) {
+            continue;
+        }
+        const int x = static_cast<int>(tile % width);
+        const int y = static_cast<int>(tile / width);
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            const int nx = x + PathGrid::DX[d];
+            const int ny = y + PathGrid::DY[d];
+            if (!m_grid.in_bounds(nx, ny)) {
+                continue;
+            }
+            const uint32_t next = m_grid.index(nx, ny);
+            if (m_mark[next] || m_distance[next] == PathGrid::UNREACHABLE) {
+                continue;
+            }
+            const uint32_t back = m_grid.step_cost(nx, ny, d ^ 1);
+            if (back != PathGrid::UNREACHABLE && m_distance[next] == distance + back) {
+                mark(next);
+            }
+        }
+    }
+
+    for (uint32_t tile : affected) {
+        m_distance[tile] = PathGrid::UNREACHABLE;
+    }
+    for (const Goal& goal : m_goals) {
+        if (m_grid.in_bounds(goal.x, goal.y)) {
+            const uint32_t tile = m_grid.index(goal.x, goal.y);
+            if (m_mark[tile]) {
+                m_distance[tile] = std::min(m_distance[tile], goal.cost);
+            }
+        }
+    }
+    std::vector<Seed> seeds;
+    for (uint32_t tile : affected) {
+        const int x = static_cast<int>(tile % width);
+        const int y = static_cast<int>(tile / width);
+        uint32_t best = m_distance[tile];
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            const uint32_t cost = m_grid.step_cost(x, y, d);
+            if (cost == PathGrid::UNREACHABLE) {
+                continue;
+            }
+            const uint32_t next = m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d]);
+            if (!m_mark[next] && m_distance[next] != PathGrid::UNREACHABLE) {
+                best = std::min(best, m_distance[next] + cost);
+            }
+        }
+        if (best != PathGrid::UNREACHABLE) {
+            m_distance[tile] = best;
+            seeds.push_back({best, tile});
+        }
+    }
+    for (uint32_t tile : affected) {
+        m_mark[tile] = 0;
+    }
+
+    std::vector<uint32_t> touched = affected;
+    const size_t settled = settle(seeds, &touched);
+
+    // A tile's flow reads its neighbors' distances
+    for (uint32_t tile : touched) {
+        const int x = static_cast<int>(tile % width);
+        const int y = static_cast<int>(tile / width);
+        update_flow(tile);
+        for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+            if (m_grid.in_bounds(x + PathGrid::DX[d], y + PathGrid::DY[d])) {
+                update_flow(m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d]));
+            }
+        }
+    }
+    return settled;
+}
+
+// Dial's algorithm. Seeds already hold their distance; they join the ring
+// when the sweep reaches it, so the ring only ever spans one step's worth
+// of distances.
+size_t DijkstraMap::settle(std::vector<Seed>& seeds, std::vector<uint32_t>* touched) {
+    std::sort(seeds.begin(), seeds.end());
+    const int width = m_grid.width();
+    size_t next_seed = 0;
+    size_t pending = 0;
+    size_t settled = 0;
+    uint32_t current = 0;
+    while (pending > 0 || next_seed < seeds.size()) {
+        if (pending == 0) {
+            current = seeds[next_seed].first;
+        }
+        for (; next_seed < seeds.size() && seeds[next_seed].first == current; next_seed++) {
+            m_buckets[current % RING].push_back(seeds[next_seed].second);
+            pending++;
+        }
+
+        std::vector<uint32_t>& bucket = m_buckets[current % RING];
+        for (size_t i = 0; i < bucket.size(); i++) {
+            const uint32_t tile = bucket[i];
+            pending--;
+            if (m_distance[tile] != current) {
+                continue;       // Reached again at a lower distance
+            }
+            settled++;
+            if (touched) {
+                touched->push_back(tile);
+            }
+            const int x = static_cast<int>(tile % width);
+            const int y = static_cast<int>(tile / width);
+            for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+                const uint32_t step = m_grid.step_cost(x, y, d);
+                if (step == PathGrid::UNREACHABLE) {
+                    continue;
+                }
+                const uint32_t next = m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d]);
+                const uint32_t distance = current + step;
+                if (distance < m_distance[next]) {
+                    m_distance[next] = distance;
+                    m_buckets[distance % RING].push_back(next);
+                    pending++;
+                }
+            }
+        }
+        bucket.clear();
+        current++;
+    }
+    return settled;
+}
+
+void DijkstraMap::update_flow(uint32_t tile) {
+    m_flow[tile] = NO_FLOW;
+    const uint32_t distance = m_distance[tile];
+    if (m_goal[tile] || distance == PathGrid::UNREACHABLE) {
+        return;
+    }
+    const int x = static_cast<int>(tile % m_grid.width());
+    const int y = static_cast<int>(tile / m_grid.width());
+    for (int d = 0; d < PathGrid::DIRECTIONS; d++) {
+        const uint32_t cost = m_grid.step_cost(x, y, d);
+        if (cost == PathGrid::UNREACHABLE) {
+            continue;
+        }
+        const uint32_t next = m_distance[m_grid.index(x + PathGrid::DX[d], y + PathGrid::DY[d])];
+        if (next != PathGrid::UNREACHABLE && next + cost == distance) {
+            m_flow[tile] = static_cast<uint8_t>(d);
+            return;
+        }
+    }
+}
+
+// --- Paths ---
+
+std::vector<std::vector<glm::ivec2>> find_paths(const PathGrid& grid, std::span<const PathRequest> requests,
+                                                JobSystem& jobs) {
+    std::vector<std::vector<glm::ivec2>> paths(requests.size());
+    jobs.parallel_for(requests.size(), 8, [&](size_t begin, size_t end) {
+        SearchScratch scratch;
+        scratch.cost.resize(grid.size());
+        scratch.stamp.assign(grid.size(), 0);
+        scratch.from.resize(grid.size());
+        for (size_t i = begin; i < end; i++) {
+            paths[i] = find_path(grid, requests[i], scratch);
+        }
+    });
+    return paths;
+}
+
+DijkstraMap& Pathfinder::field(const std::string& name) {
+    std::unique_ptr<DijkstraMap>& field = m_fields[name];
+    if (!field) {
+        field = std::make_unique<DijkstraMap>(m_grid);
+    }
+    return *field;
+}
+
+DijkstraMap* Pathfinder::find_field(const std::string& name) {
+    auto it = m_fields.find(name);
+    return it == m_fields.end() ? nullptr : it->second.get();
+}
+
+} // namespace ascii
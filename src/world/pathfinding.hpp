@@ -0,0 +1,193 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+class Tilemap;
+
+// Walkability of a Tilemap's tiles for pathfinding, on an 8-connected grid
+// without corner cutting. Costs are integers: STRAIGHT_COST per orthogonal
+// step, DIAGONAL_COST per diagonal one. Searches add OCCUPIED_COST for
+// stepping onto a tile with occupants (entities the scripts report), so
+// crowds are walked around rather than through.
+//
+// Every tile whose walls change is logged with a revision, so Dijkstra
+// maps can repair just the area around the change. Occupants move every
+// turn and aren't logged: they only steer individual steps and searches.
+class PathGrid {
+public:
+    static constexpr uint32_t STRAIGHT_COST = 10;
+    static constexpr uint32_t DIAGONAL_COST = 14;
+    static constexpr uint32_t OCCUPIED_COST = 40;
+    static constexpr uint32_t UNREACHABLE = 0xFFFFFFFFu;
+
+    // Neighbor offsets, orthogonal ones first; d ^ 1 is the opposite of d
+    static constexpr int DIRECTIONS = 8;
+    static constexpr int DX[DIRECTIONS] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int DY[DIRECTIONS] = {0, 0, 1, -1, 1, -1, -1, 1};
+
+    // A tile is a wall when any layer has a tile there whose top (layer
+    // base + tile height) reaches blocking_height; tiles outside the map too
+    explicit PathGrid(float blocking_height = 0.5f);
+
+    // Pull walls from the map: everything on the first call or after a
+    // resize (occupants are dropped then), afterwards only the chunks
+    // edited since the last sync
+    void sync(const Tilemap& map);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t size() const { return m_blocked.size(); }
+    bool in_bounds(int x, int y) const { return x >= 0 && y >= 0 && x < m_width && y < m_height; }
+    uint32_t index(int x, int y) const { return static_cast<uint32_t>(y) * m_width + x; }
+
+    bool blocked(int x, int y) const { return !in_bounds(x, y) || m_blocked[index(x, y)]; }
+
+    // Occupants standing on a tile; adding and removing are counted, so
+    // several entities can share one
+    uint32_t occupants(int x, int y) const { return in_bounds(x, y) ? m_occupants[index(x, y)] : 0; }
+    void add_occupant(int x, int y);
+    void remove_occupant(int x, int y);
+
+    // Cost of the step from (x, y) toward direction d, not counting the
+    // occupied cost of the tile stepped onto; UNREACHABLE into or out of a
+    // wall and diagonally past one
+    uint32_t step_cost(int x, int y, int d) const {
+        if (!in_bounds(x, y) || !(m_moves[index(x, y)] & (1u << d))) {
+            return UNREACHABLE;
+        }
+        return d < 4 ? STRAIGHT_COST : DIAGONAL_COST;
+    }
+    uint32_t occupied_cost(uint32_t tile) const { return m_occupants[tile] ? OCCUPIED_COST : 0; }
+
+    // Grows with every tile that becomes or stops being a wall
+    uint64_t revision() const { return m_revision; }
+
+    // Tiles changed after `revision` (repeats possible); false when the log
+    // no longer reaches back that far, i.e. anything may have changed
+    bool changes_since(uint64_t revision, std::vector<uint32_t>& out) const;
+
+private:
+    void log_change(uint32_t tile);
+    void update_moves(int x, int y);           // Of the tile and its neighbors
+
+    float m_blocking_height;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_synced = false;
+    uint64_t m_map_revision = 0;               // Tilemap revision last synced
+    std::vector<uint8_t> m_blocked;
+    std::vector<uint8_t> m_moves;              // Bit d: the step toward direction d is allowed
+    std::vector<uint16_t> m_occupants;
+    uint64_t m_revision = 0;
+    uint64_t m_log_base = 0;                   // Revision before m_log[0]
+    std::vector<uint32_t> m_log;
+};
+
+// Multi-source Dijkstra map ("distance to the nearest goal") with its flow
+// field, shared by every agent heading for the same goals: each agent only
+// reads the step its tile points to. Distances go around walls only, so
+// monsters moving don't invalidate the map; next_step() weighs occupants
+// in among the tile's neighbors instead.
+//
+// Distances are settled with a bucket queue (Dial's algorithm: a ring of
+// DIAGONAL_COST + 1 buckets, since no step costs more). After wall changes
+// update() invalidates only the tiles whose shortest path ran through the
+// changed ones and re-settles them from the intact border; if that is a
+// large part of the map, or the goals changed, it starts over.
+class DijkstraMap {
+public:
+    struct Goal {
+        int x;
+        int y;
+        uint32_t cost = 0;             // Starting distance; a higher one makes the goal less attractive
+        bool operator==(const Goal&) const = default;
+    };
+
+    explicit DijkstraMap(const PathGrid& grid);
+
+    const std::vector<Goal>& goals() const { return m_goals; }
+    void set_goals(std::vector<Goal> goals);
+
+    // Bring distances and flow up to date with the grid and goals (the
+    // flow of a full rebuild is computed over the jobs). Returns how many
+    // tiles were settled.
+    size_t update(JobSystem& jobs);
+    bool stale() const;
+
+    // In cost units; PathGrid::UNREACHABLE outside the map and where no
+    // goal can be reached
+    uint32_t distance(int x, int y) const;
+
+    // The neighbor to step to on a shortest path to a goal; nothing at a
+    // goal or where none can be reached. When the flow's tile has
+    // occupants, the neighbor nearer a goal that is cheapest counting
+    // OCCUPIED_COST is taken instead, so agents file past each other.
+    std::optional<glm::ivec2> next_step(int x, int y) const;
+
+private:
+    static constexpr uint8_t NO_FLOW = 0xFF;
+
+    using Seed = std::pair<uint32_t, uint32_t>;        // (distance, tile)
+
+    size_t rebuild(JobSystem& jobs);
+    size_t repair(const std::vector<uint32_t>& changed, JobSystem& jobs);
+    size_t settle(std::vector<Seed>& seeds, std::vector<uint32_t>* touched);
+    void update_flow(uint32_t tile);
+
+    const PathGrid& m_grid;
+    std::vector<Goal> m_goals;
+    bool m_goals_changed = true;
+    bool m_built = false;
+    uint64_t m_revision = 0;                   // Grid revision the distances match
+    std::vector<uint32_t> m_distance;
+    std::vector<uint8_t> m_flow;               // Direction toward the nearest goal
+    std::vector<uint8_t> m_goal;               // Tile is a goal
+    std::vector<uint8_t> m_mark;               // Scratch for repair()
+    std::vector<std::vector<uint32_t>> m_buckets;
+};
+
+// One shortest path for an agent whose goal nobody else shares
+struct PathRequest {
+    glm::ivec2 from;
+    glm::ivec2 to;
+};
+
+// A* per request with the octile heuristic, over the jobs (each range of
+// requests shares one scratch set). A path lists the tiles from `from` to
+// `to`, both included; it is empty when `to` can't be reached. The goal
+// tile's own occupants don't count, so a path can end on an entity.
+std::vector<std::vector<glm::ivec2>> find_paths(const PathGrid& grid, std::span<const PathRequest> requests,
+                                                JobSystem& jobs);
+
+// The grid plus Dijkstra maps shared by name (e.g. "player"), as scripts use them
+class Pathfinder {
+public:
+    explicit Pathfinder(float blocking_height = 0.5f) : m_grid(blocking_height) {}
+
+    PathGrid& grid() { return m_grid; }
+    const PathGrid& grid() const { return m_grid; }
+
+    // The named map, created without goals on first use
+    DijkstraMap& field(const std::string& name);
+    DijkstraMap* find_field(const std::string& name);
+    bool remove_field(const std::string& name) { return m_fields.erase(name) > 0; }
+    size_t field_count() const { return m_fields.size(); }
+
+private:
+    PathGrid m_grid;
+    std::unordered_map<std::string, std::unique_ptr<DijkstraMap>> m_fields;   // Refer to m_grid
+};
+
+} // namespace ascii
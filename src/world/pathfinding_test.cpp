@@ -0,0 +1,322 @@
+#include "world/pathfinding.hpp"
+#include "core/job_system.hpp"
+#include "core/test.hpp"
+#include "world/tilemap.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+constexpr int SIZE = 64;
+constexpr Tile WALL{'#', 0, 1.0f};
+constexpr Tile FLOOR{'.', 0, 0.0f};
+
+// Rooms-and-pillars map: an outer wall, scattered pillars and a few long
+// walls with gaps
+void generate_map(Tilemap& map, uint32_t seed) {
+    map.resize(SIZE, SIZE, 1);
+    map.fill_rect(0, 0, 0, SIZE, SIZE, FLOOR);
+    std::mt19937 rng(seed);
+    for (int i = 0; i < SIZE; i++) {
+        map.set(0, i, 0, WALL);
+        map.set(0, i, SIZE - 1, WALL);
+        map.set(0, 0, i, WALL);
+        map.set(0, SIZE - 1, i, WALL);
+    }
+    for (int i = 0; i < SIZE * SIZE / 8; i++) {
+        map.set(0, 1 + rng() % (SIZE - 2), 1 + rng() % (SIZE - 2), WALL);
+    }
+    for (int x = 16; x < SIZE; x += 16) {
+        map.fill_rect(0, x, 1, 1, SIZE - 2, WALL);
+        map.set(0, x, 1 + rng() % (SIZE - 2), FLOOR);
+    }
+}
+
+// Plain Dijkstra over the grid's step costs, to check the bucket queue
+// and the repairs against
+std::vector<uint32_t> reference_distances(const PathGrid& grid, const std::vector<DijkstraMap::Goal>& goals) {
+    std::vector<uint32_t> distance(grid.size(), PathGrid::UNREACHABLE);
+    using Entry = std::pair<uint32_t, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (const DijkstraMap::Goal& goal : goals) {
+        if (!grid.blocked(goal.x, goal.y) && goal.cost < distance[grid.index(goal.x, goal.y)]) {
+            distance[grid.index(goal.x, goal.y)] = goal.cost;
+            queue.push({goal.cost, grid.index(goal.x, goal.y)});
+        }
+    }
+    while (!queue.empty()) {
+        const auto [d, tile] = queue.top();
+        queue.pop();
+        if (d != distance[tile]) {
+            continue;
+        }
+        const int x = int(tile % grid.width());
+        const int y = int(tile / grid.width());
+        for (int dir = 0; dir < PathGrid::DIRECTIONS; dir++) {
+            const uint32_t cost = grid.step_cost(x, y, dir);
+            if (cost == PathGrid::UNREACHABLE) {
+                continue;
+            }
+            const uint32_t next = grid.index(x + PathGrid::DX[dir], y + PathGrid::DY[dir]);
+            if (d + cost < distance[next]) {
+                distance[next] = d + cost;
+                queue.push({d + cost, next});
+            }
+        }
+    }
+    return distance;
+}
+
+bool matches_reference(const PathGrid& grid, const DijkstraMap& field) {
+    const std::vector<uint32_t> expected = reference_distances(grid, field.goals());
+    for (int y = 0; y < grid.height(); y++) {
+        for (int x = 0; x < grid.width(); x++) {
+            if (field.distance(x, y) != expected[grid.index(x, y)]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Cost of the steps along a path; UNREACHABLE if a step isn't a legal move
+uint32_t path_cost(const PathGrid& grid, const std::vector<glm::ivec2>& path) {
+    uint32_t total = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        const glm::ivec2 delta = path[i] - path[i - 1];
+        int dir = 0;
+        while (dir < PathGrid::DIRECTIONS && (PathGrid::DX[dir] != delta.x || PathGrid::DY[dir] != delta.y)) {
+            dir++;
+        }
+        const uint32_t cost = dir < PathGrid::DIRECTIONS ? grid.step_cost(path[i - 1].x, path[i - 1].y, dir)
+                                                         : PathGrid::UNREACHABLE;
+        if (cost == PathGrid::UNREACHABLE) {
+            return PathGrid::UNREACHABLE;
+        }
+        total += cost;
+    }
+    return total;
+}
+
+void grid_walls_and_corners() {
+    Tilemap map;
+    map.resize(8, 8, 2);
+    map.fill_rect(0, 0, 0, 8, 8, FLOOR);
+    map.set(0, 3, 3, WALL);
+    map.set(1, 5, 5, {'_', 0, 0.2f});      // Too low to block
+    PathGrid grid;
+    grid.sync(map);
+    CHECK(grid.width() == 8 && grid.height() == 8);
+    CHECK(grid.blocked(3, 3) && !grid.blocked(5, 5));
+    CHECK(grid.blocked(-1, 0) && grid.blocked(8, 0));
+    CHECK(grid.step_cost(2, 3, 0) == PathGrid::UNREACHABLE);    // Into the wall
+    CHECK(grid.step_cost(2, 2, 4) == PathGrid::UNREACHABLE);    // Diagonal onto it
+    CHECK(grid.step_cost(2, 4, 6) == PathGrid::UNREACHABLE);    // Diagonal past its corner
+    CHECK(grid.step_cost(2, 2, 0) == PathGrid::STRAIGHT_COST);
+    CHECK(grid.step_cost(5, 5, 4) == PathGrid::DIAGONAL_COST);
+
+    const uint64_t revision = grid.revision();
+    map.set(1, 3, 3, FLOOR);                // Another layer: still a wall
+    map.set(0, 6, 1, WALL);
+    grid.sync(map);
+    CHECK(grid.blocked(6, 1) && grid.revision() > revision);
+    std::vector<uint32_t> changed;
+    CHECK(grid.changes_since(revision, changed));
+    CHECK(changed.size() == 1 && changed[0] == grid.index(6, 1));
+}
+
+void dijkstra_matches_reference() {
+    JobSystem jobs(2);
+    for (uint32_t seed = 1; seed <= 4; seed++) {
+        Tilemap map;
+        generate_map(map, seed);
+        const std::vector<DijkstraMap::Goal> goals = {{5, 5}, {SIZE - 6, SIZE - 6, 30}, {40, 8, 0}};
+        for (const DijkstraMap::Goal& goal : goals) {
+            map.set(0, goal.x, goal.y, FLOOR);
+        }
+        PathGrid grid;
+        grid.sync(map);
+        DijkstraMap field(grid);
+        field.set_goals(goals);
+        CHECK(field.update(jobs) > 0);
+        CHECK(!field.stale());
+        CHECK(matches_reference(grid, field));
+    }
+}
+
+// Following the flow from any reachable tile walks downhill to a goal,
+// each step costing exactly the distance it gains
+void flow_leads_to_goals() {
+    JobSystem jobs(2);
+    Tilemap map;
+    generate_map(map, 9);
+    map.set(0, 5, 5, FLOOR);
+    map.set(0, 50, 50, FLOOR);
+    PathGrid grid;
+    grid.sync(map);
+    DijkstraMap field(grid);
+    field.set_goals({{5, 5}, {50, 50}});
+    field.update(jobs);
+
+    int broken = 0;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            const uint32_t distance = field.distance(x, y);
+            const std::optional<glm::ivec2> step = field.next_step(x, y);
+            if (distance == PathGrid::UNREACHABLE || distance == 0) {
+                broken += step.has_value();
+                continue;
+            }
+            if (!step) {
+                broken++;
+                continue;
+            }
+            const uint32_t cost = path_cost(grid, {{x, y}, *step});
+            broken += cost == PathGrid::UNREACHABLE || field.distance(step->x, step->y) + cost != distance;
+        }
+    }
+    CHECK(broken == 0);
+}
+
+// Repairs after walls appear and disappear give the same distances as a
+// full rebuild
+void repair_matches_rebuild() {
+    JobSystem jobs(2);
+    Tilemap map;
+    generate_map(map, 3);
+    map.set(0, 8, 8, FLOOR);
+    map.set(0, 56, 40, FLOOR);
+    PathGrid grid;
+    grid.sync(map);
+    DijkstraMap field(grid);
+    field.set_goals({{8, 8}, {56, 40, 20}});
+    field.update(jobs);
+
+    std::mt19937 rng(11);
+    for (int round = 0; round < 30; round++) {
+        for (int edit = 0; edit < 1 + round % 5; edit++) {
+            const int x = 1 + int(rng() % (SIZE - 2));
+            const int y = 1 + int(rng() % (SIZE - 2));
+            if ((x != 8 || y != 8) && (x != 56 || y != 40)) {
+                map.set(0, x, y, rng() % 2 ? WALL : FLOOR);
+            }
+        }
+        if (round == 20) {
+            map.fill_rect(0, 16, 1, 1, SIZE - 2, WALL);    // Seal a whole wall: some tiles become unreachable
+        }
+        const uint64_t revision = grid.revision();
+        grid.sync(map);
+        CHECK(field.stale() == (grid.revision() != revision));
+        field.update(jobs);
+        CHECK(matches_reference(grid, field));
+    }
+}
+
+void occupants_steer_steps() {
+    JobSystem jobs(2);
+    Tilemap map;
+    map.resize(12, 5, 1);
+    map.fill_rect(0, 0, 0, 12, 5, FLOOR);
+    PathGrid grid;
+    grid.sync(map);
+    DijkstraMap field(grid);
+    field.set_goals({{10, 2}});
+    field.update(jobs);
+    CHECK(field.next_step(2, 2) == glm::ivec2(3, 2));
+
+    grid.add_occupant(3, 2);
+    grid.add_occupant(3, 2);
+    CHECK(grid.occupants(3, 2) == 2);
+    const std::optional<glm::ivec2> around = field.next_step(2, 2);
+    CHECK(around && around->x == 3 && around->y != 2);
+    CHECK(field.distance(2, 2) == 8 * PathGrid::STRAIGHT_COST);    // Distances ignore occupants
+    grid.remove_occupant(3, 2);
+    grid.remove_occupant(3, 2);
+    CHECK(field.next_step(2, 2) == glm::ivec2(3, 2));
+}
+
+void astar_paths_are_shortest() {
+    JobSystem jobs(2);
+    Tilemap map;
+    generate_map(map, 5);
+    PathGrid grid;
+    grid.sync(map);
+
+    std::mt19937 rng(21);
+    std::vector<PathRequest> requests;
+    while (requests.size() < 200) {
+        const glm::ivec2 from(1 + rng() % (SIZE - 2), 1 + rng() % (SIZE - 2));
+        const glm::ivec2 to(1 + rng() % (SIZE - 2), 1 + rng() % (SIZE - 2));
+        if (!grid.blocked(from.x, from.y) && !grid.blocked(to.x, to.y)) {
+            requests.push_back({from, to});
+        }
+    }
+    requests.push_back({{3, 3}, {3, 3}});
+    const std::vector<std::vector<glm::ivec2>> paths = find_paths(grid, requests, jobs);
+    CHECK(paths.size() == requests.size());
+
+    int wrong = 0;
+    for (size_t i = 0; i < requests.size() && i < paths.size(); i++) {
+        const std::vector<uint32_t> expected = reference_distances(grid, {{requests[i].to.x, requests[i].to.y}});
+        const uint32_t distance = expected[grid.index(requests[i].from.x, requests[i].from.y)];
+        const std::vector<glm::ivec2>& path = paths[i];
+        if (distance == PathGrid::UNREACHABLE) {
+            wrong += !path.empty();
+            continue;
+        }
+        wrong += path.empty() || path.front() != requests[i].from || path.back() != requests[i].to ||
+                 path_cost(grid, path) != distance;
+    }
+    CHECK(wrong == 0);
+    CHECK(paths.back().size() == 1);
+
+    // Walled off: no path
+    map.fill_rect(0, 30, 30, 5, 1, WALL);
+    map.fill_rect(0, 30, 34, 5, 1, WALL);
+    map.fill_rect(0, 30, 30, 1, 5, WALL);
+    map.fill_rect(0, 34, 30, 1, 5, WALL);
+    map.fill_rect(0, 31, 31, 3, 3, FLOOR);
+    grid.sync(map);
+    const PathRequest sealed[] = {{{5, 5}, {32, 32}}};
+    CHECK(find_paths(grid, sealed, jobs)[0].empty());
+}
+
+// A* walks around occupants when the detour is cheap, and may end on one
+void astar_avoids_occupants() {
+    JobSystem jobs(2);
+    Tilemap map;
+    map.resize(12, 5, 1);
+    map.fill_rect(0, 0, 0, 12, 5, FLOOR);
+    PathGrid grid;
+    grid.sync(map);
+    grid.add_occupant(5, 2);
+    grid.add_occupant(10, 2);
+
+    const PathRequest request[] = {{{1, 2}, {10, 2}}};
+    const std::vector<glm::ivec2> path = find_paths(grid, request, jobs)[0];
+    CHECK(!path.empty() && path.back() == glm::ivec2(10, 2));
+    for (const glm::ivec2& tile : path) {
+        CHECK(tile != glm::ivec2(5, 2));
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"grid_walls_and_corners", grid_walls_and_corners},
+        {"dijkstra_matches_reference", dijkstra_matches_reference},
+        {"flow_leads_to_goals", flow_leads_to_goals},
+        {"repair_matches_rebuild", repair_matches_rebuild},
+        {"occupants_steer_steps", occupants_steer_steps},
+        {"astar_paths_are_shortest", astar_paths_are_shortest},
+        {"astar_avoids_occupants", astar_avoids_occupants},
+    });
+}
@@ -0,0 +1,254 @@
+#include "physics.hpp"
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ascii {
+
+namespace {
+
+constexpr float INF = std::numeric_limits<float>::infinity();
+
+// Time of impact of a box at `position` moving by `motion` against the
+// static box [other_min, other_max], as a fraction of the motion. Boxes
+// that only touch along the motion's side don't hit (sliding along a wall);
+// boxes already overlapping don't either.
+bool sweep_box(glm::vec2 position, glm::vec2 size, glm::vec2 motion, glm::vec2 other_min, glm::vec2 other_max,
+               float& time, glm::vec2& normal) {
+    float entry = -INF;
+    float exit = INF;
+    int entry_axis = -1;
+    for (int axis = 0; axis < 2; axis++) {
+        const float lo = position[axis];
+        const float hi = position[axis] + size[axis];
+        if (motion[axis] == 0.0f) {
+            if (hi <= other_min[axis] || lo >= other_max[axis]) {
+                return false;
+            }
+            continue;
+        }
+        const float inv = 1.0f / motion[axis];
+        const float t0 = (other_min[axis] - hi) * inv;
+        const float t1 = (other_max[axis] - lo) * inv;
+        const float axis_entry = std::min(t0, t1);
+        if (axis_entry > entry) {
+            entry = axis_entry;
+            entry_axis = axis;
+        }
+        exit = std::min(exit, std::max(t0, t1));
+    }
+    if (entry_axis < 0 || entry > exit || entry < 0.0f || entry >= 1.0f || exit <= 0.0f) {
+        return false;
+    }
+    time = entry;
+    normal = glm::vec2(0.0f);
+    normal[entry_axis] = motion[entry_axis] > 0.0f ? -1.0f : 1.0f;
+    return true;
+}
+
+// Contact order: by body, then by what was hit
+bool contact_less(const PhysicsWorld::Contact& a, const PhysicsWorld::Contact& b) {
+    if (a.body != b.body) return a.body < b.body;
+    if (a.other != b.other) return a.other < b.other;
+    if (a.tile.y != b.tile.y) return a.tile.y < b.tile.y;
+    return a.tile.x < b.tile.x;
+}
+
+bool same_contact(const PhysicsWorld::Contact& a, const PhysicsWorld::Contact& b) {
+    return a.body == b.body && a.other == b.other && a.tile == b.tile;
+}
+
+} // anonymous namespace
+
+PhysicsWorld::PhysicsWorld(float solid_height)
+    : m_solid_height(solid_height), m_broadphase(4.0f)
+{
+}
+
+void PhysicsWorld::sync(const Tilemap& map) {
+    m_origin = glm::vec2(map.origin.x, map.origin.z);
+    m_tile_size = map.tile_size;
+    const bool resized = !m_synced || map.width() != m_width || map.height() != m_height;
+    if (!resized && map.revision() == m_revision) {
+        return;
+    }
+    if (resized) {
+        m_width = map.width();
+        m_height = map.height();
+        m_solid.assign(static_cast<size_t>(m_width) * m_height, 0);
+    }
+    for (int chunk = 0; chunk < map.chunk_count(); chunk++) {
+        if (!resized && map.chunk_revision(chunk) <= m_revision) {
+            continue;
+        }
+        const int x0 = (chunk % map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int y0 = (chunk / map.chunks_x()) * Tilemap::CHUNK_SIZE;
+        const int x1 = std::min(x0 + Tilemap::CHUNK_SIZE, m_width);
+        const int y1 = std::min(y0 + Tilemap::CHUNK_SIZE, m_height);
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const size_t i = static_cast<size_t>(y) * m_width + x;
+                bool blocks = false;
+                for (int layer = 0; layer < map.layers() && !blocks; layer++) {
+                    blocks = map.layer_glyphs(layer)[i] != 0 &&
+                             map.layer_base(layer) + map.layer_heights(layer)[i] >= m_solid_height;
+                }
+                m_solid[i] = blocks;
+            }
+        }
+    }
+    m_revision = map.revision();
+    m_synced = true;
+}
+
+size_t PhysicsWorld::find(uint64_t id) const {
+    auto it = std::lower_bound(m_bodies.begin(), m_bodies.end(), id,
+                               [](const Body& body, uint64_t key) { return body.id < key; });
+    return it != m_bodies.end() && it->id == id ? static_cast<size_t>(it - m_bodies.begin()) : m_bodies.size();
+}
+
+void PhysicsWorld::set_body(uint64_t id, glm::vec2 position, glm::vec2 size) {
+    size = glm::max(size, glm::vec2(0.0f));
+    auto it = std::lower_bound(m_bodies.begin(), m_bodies.end(), id,
+                               [](const Body& body, uint64_t key) { return body.id < key; });
+    if (it == m_bodies.end() || it->id != id) {
+        it = m_bodies.insert(it, Body{id, position, size});
+    }
+    it->position = position;
+    it->size = size;
+    m_max_size = glm::max(m_max_size, size);
+    m_broadphase.insert(id, position);
+}
+
+bool PhysicsWorld::remove_body(uint64_t id) {
+    const size_t i = find(id);
+    if (i == m_bodies.size()) {
+        return false;
+    }
+    m_bodies.erase(m_bodies.begin() + static_cast<std::ptrdiff_t>(i));
+    m_broadphase.remove(id);
+    return true;
+}
+
+bool PhysicsWorld::set_velocity(uint64_t id, glm::vec2 velocity) {
+    const size_t i = find(id);
+    if (i == m_bodies.size()) {
+        return false;
+    }
+    m_bodies[i].velocity = velocity;
+    return true;
+}
+
+const PhysicsWorld::Body* PhysicsWorld::body(uint64_t id) const {
+    const size_t i = find(id);
+    return i == m_bodies.size() ? nullptr : &m_bodies[i];
+}
+
+void PhysicsWorld::clear() {
+    m_bodies.clear();
+    m_broadphase.clear();
+    m_max_size = glm::vec2(0.0f);
+    m_accumulator = 0.0f;
+    m_contacts.clear();
+}
+
+int PhysicsWorld::step(float dt) {
+    m_contacts.clear();
+    m_accumulator += std::max(dt, 0.0f);
+    int steps = 0;
+    while (m_accumulator >= FIXED_STEP && steps < MAX_SUBSTEPS) {
+        m_accumulator -= FIXED_STEP;
+        substep();
+        steps++;
+    }
+    if (steps == MAX_SUBSTEPS) {
+        m_accumulator = std::min(m_accumulator, FIXED_STEP);
+    }
+
+    // One contact per pair, the first one found
+    std::stable_sort(m_contacts.begin(), m_contacts.end(), contact_less);
+    m_contacts.erase(std::unique(m_contacts.begin(), m_contacts.end(), same_contact), m_contacts.end());
+    return steps;
+}
+
+void PhysicsWorld::substep() {
+    for (Body& body : m_bodies) {
+        if (body.velocity != glm::vec2(0.0f)) {
+            move_body(body);
+        }
+    }
+}
+
+// Move to the first contact (less the skin), drop the velocity into it and
+// slide along it with the rest of the motion
+void PhysicsWorld::move_body(Body& body) {
+    glm::vec2 motion = body.velocity * FIXED_STEP;
+    for (int slide = 0; slide < MAX_SLIDES && motion != glm::vec2(0.0f); slide++) {
+        Hit hit;
+        if (!first_hit(body, motion, hit)) {
+            body.position += motion;
+            break;
+        }
+        const float length = std::sqrt(glm::dot(motion, motion));
+        const float advance = std::max(hit.time - SKIN / length, 0.0f);
+        body.position += motion * advance;
+        m_contacts.push_back({body.id, hit.other, hit.tile, hit.normal});
+
+        motion *= 1.0f - advance;
+        const int axis = hit.normal.x != 0.0f ? 0 : 1;
+        motion[axis] = 0.0f;
+        body.velocity[axis] = 0.0f;
+    }
+    m_broadphase.move(body.id, body.position);
+}
+
+bool PhysicsWorld::first_hit(const Body& body, glm::vec2 motion, Hit& hit) const {
+    const glm::vec2 swept_min = glm::min(body.position, body.position + motion);
+    const glm::vec2 swept_max = glm::max(body.position, body.position + motion) + body.size;
+    bool found = false;
+    float time;
+    glm::vec2 normal;
+
+    // Solid tiles under the swept box, row by row (ties keep the first)
+    if (m_width > 0 && m_height > 0) {
+        const glm::vec2 lo = glm::floor((swept_min - m_origin) / m_tile_size);
+        const glm::vec2 hi = glm::floor((swept_max - m_origin) / m_tile_size);
+        const int x0 = static_cast<int>(std::max(lo.x, 0.0f));
+        const int y0 = static_cast<int>(std::max(lo.y, 0.0f));
+        const int x1 = static_cast<int>(std::min(hi.x, float(m_width - 1)));
+        const int y1 = static_cast<int>(std::min(hi.y, float(m_height - 1)));
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                if (!m_solid[static_cast<size_t>(y) * m_width + x]) {
+                    continue;
+                }
+                const glm::vec2 tile_min = m_origin + glm::vec2(float(x), float(y)) * m_tile_size;
+                if (sweep_box(body.position, body.size, motion, tile_min, tile_min + m_tile_size, time, normal) &&
+                    time < hit.time) {
+                    hit = {time, normal, NO_BODY, {x, y}};
+                    found = true;
+                }
+            }
+        }
+    }
+
+    // Other bodies near the swept box; equal times go to the lower id
+    m_candidates.clear();
+    m_broadphase.query_box(swept_min - m_max_size, swept_max, m_candidates);
+    for (uint64_t id : m_candidates) {
+        if (id == body.id) {
+            continue;
+        }
+        const Body& other = m_bodies[find(id)];
+        if (sweep_box(body.position, body.size, motion, other.position, other.position + other.size, time, normal) &&
+            (time < hit.time || (time == hit.time && hit.other != NO_BODY && id < hit.other))) {
+            hit = {time, normal, id, {0, 0}};
+            found = true;
+        }
+    }
+    return found;
+}
+
+} // namespace ascii
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "spatial_hash.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+class Tilemap;
+
+// Axis-aligned box physics on the map plane (scene x, y): bodies with a
+// velocity sweep their box against solid tiles and every other body and
+// stop at the first contact, sliding along it with what is left of the
+// step. Bodies without a velocity are obstacles. There are no forces or
+// pushing; scripts steer by setting velocities.
+//
+// step() runs fixed FIXED_STEP substeps, carrying leftover time to the next
+// call. Bodies move one after another in id order and contacts are sorted,
+// so the same inputs give the same positions and events (for replays).
+// Bodies that start out overlapping pass through each other until apart.
+class PhysicsWorld {
+public:
+    static constexpr float FIXED_STEP = 1.0f / 60.0f;
+    static constexpr int MAX_SUBSTEPS = 8;     // Per step() call; the rest of a long frame is dropped
+    static constexpr int MAX_SLIDES = 4;       // Contacts resolved per body and substep
+    static constexpr float SKIN = 1.0e-3f;     // Gap kept to what a body stopped against
+
+    static constexpr uint64_t NO_BODY = 0xFFFFFFFFFFFFFFFFull;
+
+    struct Body {
+        uint64_t id;
+        glm::vec2 position;            // Min corner
+        glm::vec2 size;
+        glm::vec2 velocity{0.0f};      // Units per second
+    };
+
+    struct Contact {
+        uint64_t body;                 // The moving one
+        uint64_t other;                // Body hit, NO_BODY for a tile
+        glm::ivec2 tile{0};            // Tile hit, when other is NO_BODY
+        glm::vec2 normal{0.0f};        // Out of what was hit
+    };
+
+    // Tiles block when any layer has a tile whose top (layer base + tile
+    // height) reaches solid_height; outside the tilemap nothing blocks
+    explicit PhysicsWorld(float solid_height = 0.5f);
+
+    // Pull solid tiles from the map: all of them on the first call or after
+    // a resize, afterwards only chunks edited since the last sync
+    void sync(const Tilemap& map);
+
+    // Add a body or move an existing one there (keeping its velocity)
+    void set_body(uint64_t id, glm::vec2 position, glm::vec2 size);
+    bool remove_body(uint64_t id);
+    bool set_velocity(uint64_t id, glm::vec2 velocity);
+    const Body* body(uint64_t id) const;
+    const std::vector<Body>& bodies() const { return m_bodies; }
+    void clear();
+
+    bool solid(int x, int y) const {
+        return x >= 0 && y >= 0 && x < m_width && y < m_height && m_solid[static_cast<size_t>(y) * m_width + x];
+    }
+
+    // Advance by dt; returns the substeps run. contacts() then holds every
+    // contact of those substeps, one per (body, other or tile), sorted.
+    int step(float dt);
+    const std::vector<Contact>& contacts() const { return m_contacts; }
+
+private:
+    struct Hit {
+        float time = 1.0f;             // Fraction of the motion
+        glm::vec2 normal{0.0f};
+        uint64_t other = NO_BODY;
+        glm::ivec2 tile{0};
+    };
+
+    size_t find(uint64_t id) const;
+    void substep();
+    void move_body(Body& body);
+    bool first_hit(const Body& body, glm::vec2 motion, Hit& hit) const;
+
+    float m_solid_height;
+    bool m_synced = false;
+    uint64_t m_revision = 0;                   // Tilemap revision last synced
+    int m_width = 0;
+    int m_height = 0;
+    glm::vec2 m_origin{0.0f};                  // Map position of tile (0, 0)
+    float m_tile_size = 1.0f;
+    std::vector<uint8_t> m_solid;
+
+    std::vector<Body> m_bodies;                // Sorted by id
+    SpatialHash m_broadphase;                  // Min corners by body id
+    glm::vec2 m_max_size{0.0f};
+    float m_accumulator = 0.0f;
+    std::vector<Contact> m_contacts;
+    mutable std::vector<uint64_t> m_candidates;
+};
+
+} // namespace ascii
@@ -0,0 +1,231 @@
+#include "world/physics.hpp"
+#include "core/test.hpp"
+#include "world/tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace ascii;
+
+namespace {
+
+constexpr int SIZE = 48;
+constexpr Tile WALL{'#', 0, 1.0f};
+constexpr Tile FLOOR{'.', 0, 0.0f};
+constexpr glm::vec2 UNIT{0.8f, 0.8f};
+
+void walled_room(Tilemap& map) {
+    map.resize(SIZE, SIZE, 1);
+    map.fill_rect(0, 0, 0, SIZE, SIZE, FLOOR);
+    map.fill_rect(0, 0, 0, SIZE, 1, WALL);
+    map.fill_rect(0, 0, SIZE - 1, SIZE, 1, WALL);
+    map.fill_rect(0, 0, 0, 1, SIZE, WALL);
+    map.fill_rect(0, SIZE - 1, 0, 1, SIZE, WALL);
+    for (int i = 6; i < SIZE - 6; i += 9) {
+        map.fill_rect(0, i, i, 3, 2, WALL);
+    }
+}
+
+bool overlaps(const PhysicsWorld::Body& a, const PhysicsWorld::Body& b) {
+    return a.position.x < b.position.x + b.size.x && b.position.x < a.position.x + a.size.x &&
+           a.position.y < b.position.y + b.size.y && b.position.y < a.position.y + a.size.y;
+}
+
+bool overlaps_solid(const PhysicsWorld& physics, const PhysicsWorld::Body& body) {
+    const int x0 = int(std::floor(body.position.x));
+    const int y0 = int(std::floor(body.position.y));
+    const int x1 = int(std::ceil(body.position.x + body.size.x)) - 1;
+    const int y1 = int(std::ceil(body.position.y + body.size.y)) - 1;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (physics.solid(x, y)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// A grid of bodies with random velocities, added in the given id order;
+// spots on solid tiles are left out
+void populate(PhysicsWorld& physics, const std::vector<uint64_t>& ids) {
+    for (uint64_t id : ids) {
+        std::mt19937 rng(uint32_t(id) * 7919u + 1);
+        const glm::vec2 position(2.0f + float(id % 20) * 2.1f, 2.0f + float(id / 20) * 2.1f);
+        if (overlaps_solid(physics, {id, position, UNIT})) {
+            continue;
+        }
+        physics.set_body(id, position, UNIT);
+        if (id % 5 != 0) {      // One in five stands still
+            physics.set_velocity(id, {float(rng() % 200) / 10.0f - 10.0f, float(rng() % 200) / 10.0f - 10.0f});
+        }
+    }
+}
+
+// Bitwise digest of positions and contacts
+uint64_t state_hash(const PhysicsWorld& physics) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&](const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    for (const PhysicsWorld::Body& body : physics.bodies()) {
+        mix(&body.id, sizeof(body.id));
+        mix(&body.position, sizeof(body.position));
+        mix(&body.velocity, sizeof(body.velocity));
+    }
+    for (const PhysicsWorld::Contact& contact : physics.contacts()) {
+        mix(&contact, sizeof(contact));
+    }
+    return hash;
+}
+
+// The same bodies, added in another order and stepped with the same frame
+// times, end up bit-identical, contacts included
+void deterministic() {
+    Tilemap map;
+    walled_room(map);
+    std::vector<uint64_t> forward;
+    for (uint64_t id = 0; id < 300; id++) {
+        forward.push_back(id);
+    }
+    std::vector<uint64_t> shuffled = forward;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+
+    PhysicsWorld a;
+    PhysicsWorld b;
+    a.sync(map);
+    b.sync(map);
+    populate(a, forward);
+    populate(b, shuffled);
+
+    std::mt19937 rng(17);
+    int differing = 0;
+    size_t contacts = 0;
+    for (int frame = 0; frame < 240; frame++) {
+        const float dt = (12 + rng() % 10) / 1000.0f;     // Jittery frame times
+        a.step(dt);
+        b.step(dt);
+        contacts += a.contacts().size();
+        differing += state_hash(a) != state_hash(b);
+    }
+    CHECK(differing == 0);
+    CHECK(contacts > 0);
+}
+
+// Fixed substeps: how frame time is split doesn't change the result
+void fixed_substeps() {
+    Tilemap map;
+    walled_room(map);
+    PhysicsWorld a;
+    PhysicsWorld b;
+    a.sync(map);
+    b.sync(map);
+    std::vector<uint64_t> ids;
+    for (uint64_t id = 0; id < 100; id++) {
+        ids.push_back(id);
+    }
+    populate(a, ids);
+    populate(b, ids);
+
+    for (int i = 0; i < 60; i++) {
+        CHECK(a.step(2 * PhysicsWorld::FIXED_STEP) == 2);
+        b.step(PhysicsWorld::FIXED_STEP * 0.5f);
+        b.step(PhysicsWorld::FIXED_STEP * 1.5f);
+    }
+    bool same = a.bodies().size() == b.bodies().size();
+    for (size_t i = 0; same && i < a.bodies().size(); i++) {
+        same = std::memcmp(&a.bodies()[i], &b.bodies()[i], sizeof(PhysicsWorld::Body)) == 0;
+    }
+    CHECK(same);
+    CHECK(a.step(1.0f) == PhysicsWorld::MAX_SUBSTEPS);
+}
+
+// A body far too fast for its step stops at the wall instead of passing
+// through, keeping SKIN from it
+void no_tunneling() {
+    Tilemap map;
+    map.resize(40, 5, 1);
+    map.fill_rect(0, 0, 0, 40, 5, FLOOR);
+    map.set(0, 30, 2, WALL);
+    PhysicsWorld physics;
+    physics.sync(map);
+    physics.set_body(1, {2.0f, 2.1f}, UNIT);
+    physics.set_velocity(1, {3000.0f, 0.0f});
+
+    physics.step(PhysicsWorld::FIXED_STEP);
+    const PhysicsWorld::Body* body = physics.body(1);
+    CHECK(body && body->position.x + body->size.x <= 30.0f);
+    CHECK(body && body->position.x + body->size.x > 30.0f - 2.0f * PhysicsWorld::SKIN);
+    CHECK(physics.contacts().size() == 1);
+    if (!physics.contacts().empty()) {
+        const PhysicsWorld::Contact& contact = physics.contacts()[0];
+        CHECK(contact.body == 1 && contact.other == PhysicsWorld::NO_BODY);
+        CHECK(contact.tile == glm::ivec2(30, 2) && contact.normal == glm::vec2(-1.0f, 0.0f));
+    }
+}
+
+// Moving diagonally into a wall keeps the motion along it
+void slides_along_walls() {
+    Tilemap map;
+    map.resize(20, 20, 1);
+    map.fill_rect(0, 0, 0, 20, 20, FLOOR);
+    map.fill_rect(0, 0, 10, 20, 1, WALL);
+    PhysicsWorld physics;
+    physics.sync(map);
+    physics.set_body(1, {2.0f, 8.5f}, UNIT);
+    physics.set_velocity(1, {6.0f, 6.0f});
+    for (int i = 0; i < 30; i++) {
+        physics.step(PhysicsWorld::FIXED_STEP);
+    }
+    const PhysicsWorld::Body* body = physics.body(1);
+    CHECK(body && body->position.y + body->size.y <= 10.0f);
+    CHECK(body && body->position.x > 2.0f + 6.0f * 30 * PhysicsWorld::FIXED_STEP * 0.9f);
+}
+
+// Moving bodies never end up overlapping each other or a wall
+void bodies_stay_apart() {
+    Tilemap map;
+    walled_room(map);
+    PhysicsWorld physics;
+    physics.sync(map);
+    std::vector<uint64_t> ids;
+    for (uint64_t id = 0; id < 300; id++) {
+        ids.push_back(id);
+    }
+    populate(physics, ids);
+
+    int overlapping = 0;
+    for (int frame = 0; frame < 300; frame++) {
+        physics.step(PhysicsWorld::FIXED_STEP);
+        const std::vector<PhysicsWorld::Body>& bodies = physics.bodies();
+        for (size_t i = 0; i < bodies.size(); i++) {
+            overlapping += overlaps_solid(physics, bodies[i]);
+            for (size_t j = i + 1; j < bodies.size(); j++) {
+                overlapping += overlaps(bodies[i], bodies[j]);
+            }
+        }
+    }
+    CHECK(overlapping == 0);
+
+    CHECK(physics.remove_body(7) && !physics.remove_body(7) && physics.body(7) == nullptr);
+    CHECK(!physics.set_velocity(7, {1.0f, 0.0f}));
+}
+
+} // anonymous namespace
+
+int main() {
+    return test::run({
+        {"deterministic", deterministic},
+        {"fixed_substeps", fixed_substeps},
+        {"no_tunneling", no_tunneling},
+        {"slides_along_walls", slides_along_walls},
+        {"bodies_stay_apart", bodies_stay_apart},
+    });
+}
@@ -0,0 +1,327 @@
+#include "spatial_hash.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace ascii {
+
+namespace {
+
+constexpr size_t BATCH_BLOCK = 64;             // Queries per job range
+constexpr float MAX_COORD = float(1 << 30);    // Cell coordinates stay well inside int32
+
+uint32_t hash_cell(int32_t x, int32_t y) {
+    uint32_t h = static_cast<uint32_t>(x) * 0x9E3779B1u ^ static_cast<uint32_t>(y) * 0x85EBCA77u;
+    h ^= h >> 15;
+    return h * 0x2C1B3C6Du;
+}
+
+// Heap order for k-nearest: larger distance first, ties by larger id
+bool closer(const SpatialHash::Hit& a, const SpatialHash::Hit& b) {
+    return a.distance_sq < b.distance_sq || (a.distance_sq == b.distance_sq && a.id < b.id);
+}
+
+} // anonymous namespace
+
+SpatialHash::SpatialHash(float cell_size)
+    : m_cell_size(cell_size), m_inv_cell_size(1.0f / cell_size)
+{
+    if (!(cell_size > 0.0f)) {
+        throw std::runtime_error("Spatial hash cell size must be positive");
+    }
+}
+
+void SpatialHash::insert(uint64_t id, glm::vec2 position, uint32_t tags) {
+    auto [it, added] = m_item_of.try_emplace(id, static_cast<uint32_t>(m_items.size()));
+    if (added) {
+        m_items.push_back({id, EMPTY, 0});
+    }
+    place(it->second, position, tags);
+}
+
+bool SpatialHash::move(uint64_t id, glm::vec2 position) {
+    auto it = m_item_of.find(id);
+    if (it == m_item_of.end()) {
+        return false;
+    }
+    const Item& item = m_items[it->second];
+    place(it->second, position, m_cells[item.cell].entries[item.slot].tags);
+    return true;
+}
+
+bool SpatialHash::remove(uint64_t id) {
+    auto it = m_item_of.find(id);
+    if (it == m_item_of.end()) {
+        return false;
+    }
+    const uint32_t item = it->second;
+    m_item_of.erase(it);
+    unplace(item);
+    if (item + 1 != m_items.size()) {
+        m_items[item] = m_items.back();
+        const Item& moved = m_items[item];
+        m_cells[moved.cell].entries[moved.slot].item = item;
+        m_item_of[moved.id] = item;
+    }
+    m_items.pop_back();
+    return true;
+}
+
+void SpatialHash::clear() {
+    m_cells.clear();
+    m_table.clear();
+    m_cell_min = glm::ivec2(std::numeric_limits<int32_t>::max());
+    m_cell_max = glm::ivec2(std::numeric_limits<int32_t>::min());
+    m_items.clear();
+    m_item_of.clear();
+}
+
+glm::ivec2 SpatialHash::cell_coords(glm::vec2 position) const {
+    const glm::vec2 cell = glm::clamp(glm::floor(position * m_inv_cell_size), -MAX_COORD, MAX_COORD);
+    return {static_cast<int32_t>(cell.x), static_cast<int32_t>(cell.y)};
+}
+
+uint32_t SpatialHash::find_cell(int32_t x, int32_t y) const {
+    if (m_table.empty()) {
+        return EMPTY;
+    }
+    const uint32_t mask = static_cast<uint32_t>(m_table.size()) - 1;
+    for (uint32_t slot = hash_cell(x, y) & mask;; slot = (slot + 1) & mask) {
+        const uint32_t cell = m_table[slot];
+        if (cell == EMPTY || (m_cells[cell].x == x && m_cells[cell].y == y)) {
+            return cell;
+        }
+    }
+}
+
+uint32_t SpatialHash::get_or_add_cell(int32_t x, int32_t y) {
+    const uint32_t found = find_cell(x, y);
+    if (found != EMPTY) {
+        return found;
+    }
+    if ((m_cells.size() + 1) * 2 > m_table.size()) {
+        grow_table();
+    }
+    const uint32_t cell = static_cast<uint32_t>(m_cells.size());
+    m_cells.push_back({x, y, {}});
+    const uint32_t mask = static_cast<uint32_t>(m_table.size()) - 1;
+    uint32_t slot = hash_cell(x, y) & mask;
+    while (m_table[slot] != EMPTY) {
+        slot = (slot + 1) & mask;
+    }
+    m_table[slot] = cell;
+    m_cell_min = glm::min(m_cell_min, glm::ivec2(x, y));
+    m_cell_max = glm::max(m_cell_max, glm::ivec2(x, y));
+    return cell;
+}
+
+void SpatialHash::grow_table() {
+    m_table.assign(std::max<size_t>(64, m_table.size() * 2), EMPTY);
+    const uint32_t mask = static_cast<uint32_t>(m_table.size()) - 1;
+    for (uint32_t cell = 0; cell < m_cells.size(); cell++) {
+        uint32_t slot = hash_cell(m_cells[cell].x, m_cells[cell].y) & mask;
+        while (m_table[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        m_table[slot] = cell;
+    }
+}
+
+void SpatialHash::place(uint32_t item, glm::vec2 position, uint32_t tags) {
+    const glm::ivec2 coords = cell_coords(position);
+    Item& it = m_items[item];
+    if (it.cell != EMPTY && m_cells[it.cell].x == coords.x && m_cells[it.cell].y == coords.y) {
+        m_cells[it.cell].entries[it.slot] = {position, tags, item};
+        return;
+    }
+    if (it.cell != EMPTY) {
+        unplace(item);
+    }
+    const uint32_t cell = get_or_add_cell(coords.x, coords.y);
+    std::vector<Entry>& entries = m_cells[cell].entries;
+    m_items[item].cell = cell;
+    m_items[item].slot = static_cast<uint32_t>(entries.size());
+    entries.push_back({position, tags, item});
+}
+
+void SpatialHash::unplace(uint32_t item) {
+    Item& it = m_items[item];
+    std::vector<Entry>& entries = m_cells[it.cell].entries;
+    if (it.slot + 1 != entries.size()) {
+        entries[it.slot] = entries.back();
+        m_items[entries[it.slot].item].slot = it.slot;
+    }
+    entries.pop_back();
+    it.cell = EMPTY;
+}
+
+template<typename Fn>
+void SpatialHash::each_cell(glm::ivec2 lo, glm::ivec2 hi, Fn&& fn) const {
+    lo = glm::max(lo, m_cell_min);
+    hi = glm::min(hi, m_cell_max);
+    if (lo.x > hi.x || lo.y > hi.y) {
+        return;
+    }
+    // A range wider than the occupied cells is cheaper to scan cell by cell
+    const uint64_t span = uint64_t(hi.x - lo.x + 1) * uint64_t(hi.y - lo.y + 1);
+    if (span > m_cells.size()) {
+        for (const Cell& cell : m_cells) {
+            if (cell.x >= lo.x && cell.x <= hi.x && cell.y >= lo.y && cell.y <= hi.y) {
+                fn(cell);
+            }
+        }
+        return;
+    }
+    for (int32_t y = lo.y; y <= hi.y; y++) {
+        for (int32_t x = lo.x; x <= hi.x; x++) {
+            const uint32_t cell = find_cell(x, y);
+            if (cell != EMPTY) {
+                fn(m_cells[cell]);
+            }
+        }
+    }
+}
+
+void SpatialHash::query_radius(glm::vec2 center, float radius, std::vector<uint64_t>& out, uint32_t tags) const {
+    if (!(radius >= 0.0f)) {
+        return;
+    }
+    const float radius_sq = radius * radius;
+    each_cell(cell_coords(center - radius), cell_coords(center + radius), [&](const Cell& cell) {
+        for (const Entry& entry : cell.entries) {
+            const glm::vec2 d = entry.position - center;
+            if ((entry.tags & tags) && glm::dot(d, d) <= radius_sq) {
+                out.push_back(m_items[entry.item].id);
+            }
+        }
+    });
+}
+
+void SpatialHash::query_box(glm::vec2 min, glm::vec2 max, std::vector<uint64_t>& out, uint32_t tags) const {
+    each_cell(cell_coords(min), cell_coords(max), [&](const Cell& cell) {
+        for (const Entry& entry : cell.entries) {
+            if ((entry.tags & tags) && entry.position.x >= min.x && entry.position.y >= min.y &&
+                entry.position.x <= max.x && entry.position.y <= max.y) {
+                out.push_back(m_items[entry.item].id);
+            }
+        }
+    });
+}
+
+// Rings of cells around the center one, nearest first. Everything in ring r
+// is farther than (r - 1) cell sizes, so the search stops once the k-th
+// best is closer than that, or the rings leave the occupied cells.
+void SpatialHash::query_nearest(glm::vec2 center, size_t k, std::vector<Hit>& out, uint32_t tags,
+                                float max_radius) const {
+    out.clear();
+    if (k == 0 || m_items.empty()) {
+        return;
+    }
+    const float limit_sq = max_radius > 0.0f ? max_radius * max_radius : std::numeric_limits<float>::infinity();
+    const glm::ivec2 c = cell_coords(center);
+    const glm::ivec2 reach = glm::max(glm::abs(c - m_cell_min), glm::abs(m_cell_max - c));
+    int32_t last_ring = std::max(reach.x, reach.y);
+    if (max_radius > 0.0f) {
+        last_ring = std::min(last_ring, static_cast<int32_t>(std::ceil(max_radius * m_inv_cell_size)) + 1);
+    }
+
+    auto scan = [&](int32_t x, int32_t y) {
+        if (x < m_cell_min.x || y < m_cell_min.y || x > m_cell_max.x || y > m_cell_max.y) {
+            return;
+        }
+        const uint32_t cell = find_cell(x, y);
+        if (cell == EMPTY) {
+            return;
+        }
+        for (const Entry& entry : m_cells[cell].entries) {
+            const glm::vec2 d = entry.position - center;
+            const Hit hit{m_items[entry.item].id, glm::dot(d, d)};
+            if (!(entry.tags & tags) || hit.distance_sq > limit_sq) {
+                continue;
+            }
+            if (out.size() < k) {
+                out.push_back(hit);
+                std::push_heap(out.begin(), out.end(), closer);
+            } else if (closer(hit, out.front())) {
+                std::pop_heap(out.begin(), out.end(), closer);
+                out.back() = hit;
+                std::push_heap(out.begin(), out.end(), closer);
+            }
+        }
+    };
+
+    for (int32_t r = 0; r <= last_ring; r++) {
+        if (r > 0 && out.size() == k) {
+            const float bound = float(r - 1) * m_cell_size;
+            if (out.front().distance_sq <= bound * bound) {
+                break;
+            }
+        }
+        if (r == 0) {
+            scan(c.x, c.y);
+            continue;
+        }
+        for (int32_t x = c.x - r; x <= c.x + r; x++) {
+            scan(x, c.y - r);
+            scan(x, c.y + r);
+        }
+        for (int32_t y = c.y - r + 1; y <= c.y + r - 1; y++) {
+            scan(c.x - r, y);
+            scan(c.x + r, y);
+        }
+    }
+    std::sort_heap(out.begin(), out.end(), closer);
+}
+
+void SpatialHash::query(std::span<const Query> queries, BatchResult& out, JobSystem& jobs) const {
+    // Each block of queries collects into its own list; the lists are
+    // joined in order afterwards
+    struct Block {
+        std::vector<uint32_t> counts;
+        std::vector<uint64_t> ids;
+    };
+    const size_t block_count = (queries.size() + BATCH_BLOCK - 1) / BATCH_BLOCK;
+    std::vector<Block> blocks(block_count);
+    jobs.parallel_for(block_count, 1, [&](size_t begin, size_t end) {
+        std::vector<Hit> hits;
+        for (size_t b = begin; b < end; b++) {
+            Block& block = blocks[b];
+            const size_t first = b * BATCH_BLOCK;
+            const size_t last = std::min(first + BATCH_BLOCK, queries.size());
+            for (size_t q = first; q < last; q++) {
+                const Query& query = queries[q];
+                const size_t before = block.ids.size();
+                switch (query.kind) {
+                    case Query::Kind::Radius:
+                        query_radius(query.center, query.radius, block.ids, query.tags);
+                        break;
+                    case Query::Kind::Box:
+                        query_box(query.min, query.max, block.ids, query.tags);
+                        break;
+                    case Query::Kind::Nearest:
+                        query_nearest(query.center, query.k, hits, query.tags, query.radius);
+                        for (const Hit& hit : hits) {
+                            block.ids.push_back(hit.id);
+                        }
+                        break;
+                }
+                block.counts.push_back(static_cast<uint32_t>(block.ids.size() - before));
+            }
+        }
+    });
+
+    out.offsets.clear();
+    out.ids.clear();
+    out.offsets.reserve(queries.size() + 1);
+    out.offsets.push_back(0);
+    for (const Block& block : blocks) {
+        for (uint32_t count : block.counts) {
+            out.offsets.push_back(out.offsets.back() + count);
+        }
+        out.ids.insert(out.ids.end(), block.ids.begin(), block.ids.end());
+    }
+}
+
+} // namespace ascii
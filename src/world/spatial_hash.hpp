@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+class JobSystem;
+
+// Uniform spatial hash over 2D points (scene map x, y) for proximity
+// queries. Each occupied cell is one contiguous array of entries holding
+// the position and tags inline, so a query scans memory linearly and only
+// touches the item table for ids. Cells are found through an
+// open-addressing table keyed by cell coordinates; cells are kept once
+// created (until clear()), so entities moving back and forth never
+// allocate. Moving within a cell rewrites the entry in place, across cells
+// it is one swap-remove and one append.
+//
+// Ids are any integer the caller picks (entity handles); tags are a bit
+// mask a query filters on.
+class SpatialHash {
+public:
+    static constexpr uint32_t ALL_TAGS = 0xFFFFFFFFu;
+
+    struct Hit {
+        uint64_t id;
+        float distance_sq;
+    };
+
+    // One query of a batch
+    struct Query {
+        enum class Kind : uint8_t { Radius, Box, Nearest };
+
+        Kind kind = Kind::Radius;
+        glm::vec2 center{0.0f};        // Radius, Nearest
+        float radius = 0.0f;           // Radius; Nearest: how far to look (0 = anywhere)
+        glm::vec2 min{0.0f};           // Box
+        glm::vec2 max{0.0f};
+        uint32_t k = 1;                // Nearest
+        uint32_t tags = ALL_TAGS;
+    };
+
+    // Query i found ids[offsets[i]] .. ids[offsets[i + 1]]
+    struct BatchResult {
+        std::vector<uint32_t> offsets;
+        std::vector<uint64_t> ids;
+    };
+
+    explicit SpatialHash(float cell_size = 8.0f);
+
+    float cell_size() const { return m_cell_size; }
+    size_t size() const { return m_items.size(); }
+    size_t cell_count() const { return m_cells.size(); }
+
+    // Insert, or move and retag an id already present
+    void insert(uint64_t id, glm::vec2 position, uint32_t tags = 1);
+    // False if the id is not present
+    bool move(uint64_t id, glm::vec2 position);
+    bool remove(uint64_t id);
+    bool contains(uint64_t id) const { return m_item_of.contains(id); }
+    void clear();
+
+    // Append the ids matching any of `tags`, in no particular order
+    void query_radius(glm::vec2 center, float radius, std::vector<uint64_t>& out, uint32_t tags = ALL_TAGS) const;
+    void query_box(glm::vec2 min, glm::vec2 max, std::vector<uint64_t>& out, uint32_t tags = ALL_TAGS) const;
+
+    // The k nearest within max_radius (0 = anywhere), nearest first, ties
+    // by id so the order is deterministic
+    void query_nearest(glm::vec2 center, size_t k, std::vector<Hit>& out, uint32_t tags = ALL_TAGS,
+                       float max_radius = 0.0f) const;
+
+    // Every query over the jobs; results land in query order
+    void query(std::span<const Query> queries, BatchResult& out, JobSystem& jobs) const;
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    struct Entry {
+        glm::vec2 position;
+        uint32_t tags;
+        uint32_t item;
+    };
+
+    struct Cell {
+        int32_t x;
+        int32_t y;
+        std::vector<Entry> entries;
+    };
+
+    struct Item {
+        uint64_t id;
+        uint32_t cell;
+        uint32_t slot;                 // Index in the cell's entries
+    };
+
+    glm::ivec2 cell_coords(glm::vec2 position) const;
+    uint32_t find_cell(int32_t x, int32_t y) const;
+    uint32_t get_or_add_cell(int32_t x, int32_t y);
+    void grow_table();
+    void place(uint32_t item, glm::vec2 position, uint32_t tags);
+    void unplace(uint32_t item);
+
+    // fn(const Cell&) for every existing cell overlapping the cell range
+    template<typename Fn>
+    void each_cell(glm::ivec2 lo, glm::ivec2 hi, Fn&& fn) const;
+
+    float m_cell_size;
+    float m_inv_cell_size;
+    std::vector<Cell> m_cells;
+    std::vector<uint32_t> m_table;     // Cell index or EMPTY; power of two, at most half full
+    glm::ivec2 m_cell_min{std::numeric_limits<int32_t>::max()};
+    glm::ivec2 m_cell_max{std::numeric_limits<int32_t>::min()};
+    std::vector<Item> m_items;
+    std::unordered_map<uint64_t, uint32_t> m_item_of;
+};
+
+} // namespace ascii
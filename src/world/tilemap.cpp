@@ -0,0 +1,427 @@
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace ascii {
+
+namespace {
+
+constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+constexpr size_t CHUNK_TILES = Tilemap::CHUNK_SIZE * Tilemap::CHUNK_SIZE;
+
+// Bytes in the UTF-8 sequence starting at text[0] (1 for invalid or truncated ones)
+size_t sequence_length(std::string_view text) {
+    const uint8_t lead = static_cast<uint8_t>(text[0]);
+    size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return length <= text.size() ? length : 1;
+}
+
+} // anonymous namespace
+
+uint32_t decode_glyph(std::string_view text, size_t* length_out) {
+    if (text.empty()) {
+        if (length_out) {
+            *length_out = 0;
+        }
+        return 0;
+    }
+
+    const size_t length = sequence_length(text);
+    if (length_out) {
+        *length_out = length;
+    }
+    const uint8_t lead = static_cast<uint8_t>(text[0]);
+    if (length == 1) {
+        return lead;
+    }
+    uint32_t codepoint = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; i++) {
+        codepoint = (codepoint << 6) | (static_cast<uint8_t>(text[i]) & 0x3F);
+    }
+    return codepoint;
+}
+
+std::string encode_glyph(uint32_t glyph) {
+    std::string out;
+    if (glyph == 0) {
+        return out;
+    }
+    if (glyph < 0x80) {
+        out += static_cast<char>(glyph);
+    } else if (glyph < 0x800) {
+        out += static_cast<char>(0xC0 | (glyph >> 6));
+        out += static_cast<char>(0x80 | (glyph & 0x3F));
+    } else if (glyph < 0x10000) {
+        out += static_cast<char>(0xE0 | (glyph >> 12));
+        out += static_cast<char>(0x80 | ((glyph >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (glyph & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (glyph >> 18));
+        out += static_cast<char>(0x80 | ((glyph >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((glyph >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (glyph & 0x3F));
+    }
+    return out;
+}
+
+void Tilemap::resize(int width, int height, int layers) {
+    if (width < 0 || height < 0 || layers < 0) {
+        throw std::runtime_error("Tilemap dimensions must not be negative");
+    }
+    if (m_snapshot) {
+        save_whole(false);
+    }
+
+    m_width = width;
+    m_height = height;
+    m_chunks_x = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks_y = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    const size_t tiles = static_cast<size_t>(width) * height;
+    m_layers.assign(layers, Layer{});
+    for (auto& layer : m_layers) {
+        layer.glyph.assign(tiles, 0);
+        layer.material.assign(tiles, 0);
+        layer.height.assign(tiles, 0.0f);
+    }
+
+    m_dirty.assign(static_cast<size_t>(chunk_count()), 0);
+    m_dirty_count = 0;
+    m_chunk_revision.assign(static_cast<size_t>(chunk_count()), 0);
+    mark_all_dirty();
+}
+
+void Tilemap::assign_layer(int layer, const uint32_t* glyphs, const uint16_t* materials, const float* heights) {
+    if (m_snapshot) {
+        save_whole(true);
+    }
+    Layer& target = m_layers[layer];
+    const size_t tiles = target.glyph.size();
+    std::copy(glyphs, glyphs + tiles, target.glyph.begin());
+    std::copy(materials, materials + tiles, target.material.begin());
+    std::copy(heights, heights + tiles, target.height.begin());
+    mark_all_dirty();
+}
+
+void Tilemap::set_layer_base(int layer, float base) {
+    if (m_layers[layer].base != base) {
+        m_layers[layer].base = base;
+        mark_all_dirty();
+    }
+}
+
+Tile Tilemap::get(int layer, int x, int y) const {
+    if (!in_bounds(layer, x, y)) {
+        return {};
+    }
+    const Layer& l = m_layers[layer];
+    const size_t i = index(x, y);
+    return {l.glyph[i], l.material[i], l.height[i]};
+}
+
+bool Tilemap::write(Layer& layer, size_t i, const Tile& tile) {
+    if (layer.glyph[i] == tile.glyph && layer.material[i] == tile.material && layer.height[i] == tile.height) {
+        return false;
+    }
+    if (m_snapshot) {
+        save_chunk(i);
+    }
+    if (m_recorder) {
+        const int x = static_cast<int>(i % m_width);
+        const int y = static_cast<int>(i / m_width);
+        m_recorder->push_back({static_cast<int>(&layer - m_layers.data()), x, y,
+                               {layer.glyph[i], layer.material[i], layer.height[i]}, tile});
+    }
+    layer.glyph[i] = tile.glyph;
+    layer.material[i] = tile.material;
+    layer.height[i] = tile.height;
+    return true;
+}
+
+size_t Tilemap::set(int layer, int x, int y, const Tile& tile) {
+    if (!in_bounds(layer, x, y) || !write(m_layers[layer], index(x, y), tile)) {
+        return 0;
+    }
+    mark_dirty(x, y);
+    return 1;
+}
+
+size_t Tilemap::fill_rect(int layer, int x, int y, int w, int h, const Tile& tile) {
+    if (layer < 0 || layer >= layers()) {
+        return 0;
+    }
+    const int x0 = std::max(x, 0);
+    const int y0 = std::max(y, 0);
+    const int x1 = std::min(x + w, m_width) - 1;
+    const int y1 = std::min(y + h, m_height) - 1;
+    if (x0 > x1 || y0 > y1) {
+        return 0;
+    }
+
+    Layer& l = m_layers[layer];
+    size_t changed = 0;
+    for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++) {
+            changed += write(l, index(tx, ty), tile) ? 1 : 0;
+        }
+    }
+    if (changed > 0) {
+        mark_dirty_rect(x0, y0, x1, y1);
+    }
+    return changed;
+}
+
+size_t Tilemap::flood_fill(int layer, int x, int y, const Tile& tile) {
+    if (!in_bounds(layer, x, y)) {
+        return 0;
+    }
+    const Tile target = get(layer, x, y);
+    if (target == tile) {
+        return 0;
+    }
+
+    Layer& l = m_layers[layer];
+    auto matches = [&](int px, int py) {
+        const size_t i = index(px, py);
+        return l.glyph[i] == target.glyph && l.material[i] == target.material && l.height[i] == target.height;
+    };
+
+    // Scanline fill: fill a whole horizontal span, then queue the first
+    // matching tile of each run above and below it
+    size_t changed = 0;
+    std::vector<std::pair<int, int>> stack = {{x, y}};
+    while (!stack.empty()) {
+        auto [sx, sy] = stack.back();
+        stack.pop_back();
+        if (!matches(sx, sy)) {
+            continue;
+        }
+
+        int left = sx;
+        while (left > 0 && matches(left - 1, sy)) {
+            left--;
+        }
+        int right = sx;
+        while (right < m_width - 1 && matches(right + 1, sy)) {
+            right++;
+        }
+
+        for (int px = left; px <= right; px++) {
+            write(l, index(px, sy), tile);
+        }
+        changed += static_cast<size_t>(right - left + 1);
+        mark_dirty_rect(left, sy, right, sy);
+
+        for (int ny : {sy - 1, sy + 1}) {
+            if (ny < 0 || ny >= m_height) {
+                continue;
+            }
+            bool in_run = false;
+            for (int px = left; px <= right; px++) {
+                if (matches(px, ny)) {
+                    if (!in_run) {
+                        stack.push_back({px, ny});
+                        in_run = true;
+                    }
+                } else {
+                    in_run = false;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+size_t Tilemap::paste(int layer, int x, int y, const std::vector<std::string>& rows,
+                      const std::unordered_map<uint32_t, Tile>& legend) {
+    if (layer < 0 || layer >= layers()) {
+        return 0;
+    }
+
+    Layer& l = m_layers[layer];
+    size_t changed = 0;
+    for (size_t row = 0; row < rows.size(); row++) {
+        const int ty = y + static_cast<int>(row);
+        std::string_view text = rows[row];
+        int tx = x;
+        while (!text.empty()) {
+            size_t length = 0;
+            const uint32_t glyph = decode_glyph(text, &length);
+            text.remove_prefix(length);
+
+            auto it = legend.find(glyph);
+            if (it != legend.end() && tx >= 0 && tx < m_width && ty >= 0 && ty < m_height &&
+                write(l, index(tx, ty), it->second)) {
+                mark_dirty(tx, ty);
+                changed++;
+            }
+            tx++;
+        }
+    }
+    return changed;
+}
+
+void Tilemap::mark_dirty(int x, int y) {
+    const int chunk = (y / CHUNK_SIZE) * m_chunks_x + x / CHUNK_SIZE;
+    m_chunk_revision[chunk] = ++m_revision;
+    if (!m_dirty[chunk]) {
+        m_dirty[chunk] = 1;
+        m_dirty_count++;
+    }
+}
+
+void Tilemap::mark_dirty_rect(int x0, int y0, int x1, int y1) {
+    ++m_revision;
+    for (int cy = y0 / CHUNK_SIZE; cy <= y1 / CHUNK_SIZE; cy++) {
+        for (int cx = x0 / CHUNK_SIZE; cx <= x1 / CHUNK_SIZE; cx++) {
+            const int chunk = cy * m_chunks_x + cx;
+            m_chunk_revision[chunk] = m_revision;
+            if (!m_dirty[chunk]) {
+                m_dirty[chunk] = 1;
+                m_dirty_count++;
+            }
+        }
+    }
+}
+
+void Tilemap::mark_all_dirty() {
+    std::fill(m_chunk_revision.begin(), m_chunk_revision.end(), ++m_revision);
+    std::fill(m_dirty.begin(), m_dirty.end(), 1);
+    m_dirty_count = m_dirty.size();
+}
+
+std::vector<int> Tilemap::take_dirty_chunks() {
+    std::vector<int> chunks;
+    chunks.reserve(m_dirty_count);
+    for (int i = 0; i < chunk_count(); i++) {
+        if (m_dirty[i]) {
+            chunks.push_back(i);
+            m_dirty[i] = 0;
+        }
+    }
+    m_dirty_count = 0;
+    return chunks;
+}
+
+void Tilemap::begin_snapshot() {
+    m_snapshot = std::make_unique<Snapshot>();
+    m_snapshot->width = m_width;
+    m_snapshot->height = m_height;
+    m_snapshot->origin = origin;
+    m_snapshot->tile_size = tile_size;
+    for (const Layer& layer : m_layers) {
+        m_snapshot->bases.push_back(layer.base);
+    }
+}
+
+void Tilemap::save_chunk(size_t i) {
+    Snapshot& snapshot = *m_snapshot;
+    if (snapshot.has_whole) {
+        return;
+    }
+    const int x = static_cast<int>(i % m_width);
+    const int y = static_cast<int>(i / m_width);
+    const int chunk = (y / CHUNK_SIZE) * m_chunks_x + x / CHUNK_SIZE;
+    if (snapshot.slot_of.empty()) {
+        snapshot.slot_of.assign(static_cast<size_t>(chunk_count()), NO_SLOT);
+    }
+    if (snapshot.slot_of[chunk] != NO_SLOT) {
+        return;
+    }
+    snapshot.slot_of[chunk] = static_cast<uint32_t>(snapshot.chunks.size());
+    snapshot.chunks.push_back(chunk);
+
+    const int x0 = (chunk % m_chunks_x) * CHUNK_SIZE;
+    const int y0 = (chunk / m_chunks_x) * CHUNK_SIZE;
+    const int x1 = std::min(x0 + CHUNK_SIZE, m_width);
+    const int y1 = std::min(y0 + CHUNK_SIZE, m_height);
+    size_t out = snapshot.tiles.size();
+    snapshot.tiles.resize(out + CHUNK_TILES * m_layers.size());
+    for (const Layer& layer : m_layers) {
+        for (int ty = y0; ty < y1; ty++) {
+            for (int tx = x0; tx < x1; tx++) {
+                const size_t t = index(tx, ty);
+                snapshot.tiles[out + (ty - y0) * CHUNK_SIZE + (tx - x0)] = {layer.glyph[t], layer.material[t], layer.height[t]};
+            }
+        }
+        out += CHUNK_TILES;
+    }
+}
+
+void Tilemap::save_whole(bool keep_layers) {
+    Snapshot& snapshot = *m_snapshot;
+    if (snapshot.has_whole) {
+        return;
+    }
+    // Chunks saved so far are laid over these layers on restore
+    if (keep_layers) {
+        snapshot.whole = m_layers;
+    } else {
+        snapshot.whole = std::move(m_layers);
+        m_layers.clear();
+    }
+    snapshot.has_whole = true;
+}
+
+void Tilemap::restore_snapshot() {
+    if (!m_snapshot) {
+        return;
+    }
+    std::unique_ptr<Snapshot> snapshot = std::move(m_snapshot);
+    origin = snapshot->origin;
+    tile_size = snapshot->tile_size;
+    if (snapshot->has_whole) {
+        m_width = snapshot->width;
+        m_height = snapshot->height;
+        m_chunks_x = (m_width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        m_chunks_y = (m_height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        m_layers = std::move(snapshot->whole);
+        m_dirty.assign(static_cast<size_t>(chunk_count()), 0);
+        m_chunk_revision.assign(static_cast<size_t>(chunk_count()), 0);
+    }
+    for (size_t l = 0; l < m_layers.size(); l++) {
+        m_layers[l].base = snapshot->bases[l];
+    }
+
+    size_t in = 0;
+    for (int chunk : snapshot->chunks) {
+        const int x0 = (chunk % m_chunks_x) * CHUNK_SIZE;
+        const int y0 = (chunk / m_chunks_x) * CHUNK_SIZE;
+        const int x1 = std::min(x0 + CHUNK_SIZE, m_width);
+        const int y1 = std::min(y0 + CHUNK_SIZE, m_height);
+        for (Layer& layer : m_layers) {
+            for (int ty = y0; ty < y1; ty++) {
+                for (int tx = x0; tx < x1; tx++) {
+                    const Tile& tile = snapshot->tiles[in + (ty - y0) * CHUNK_SIZE + (tx - x0)];
+                    const size_t t = index(tx, ty);
+                    layer.glyph[t] = tile.glyph;
+                    layer.material[t] = tile.material;
+                    layer.height[t] = tile.height;
+                }
+            }
+            in += CHUNK_TILES;
+        }
+        if (!snapshot->has_whole) {
+            mark_dirty_rect(x0, y0, x1 - 1, y1 - 1);
+        }
+    }
+    if (snapshot->has_whole) {
+        mark_all_dirty();
+    }
+}
+
+size_t Tilemap::snapshot_bytes() const {
+    if (!m_snapshot) {
+        return 0;
+    }
+    size_t bytes = m_snapshot->tiles.capacity() * sizeof(Tile) + m_snapshot->slot_of.capacity() * sizeof(uint32_t);
+    for (const Layer& layer : m_snapshot->whole) {
+        bytes += layer.glyph.capacity() * sizeof(uint32_t) + layer.material.capacity() * sizeof(uint16_t) +
+                 layer.height.capacity() * sizeof(float);
+    }
+    return bytes;
+}
+
+} // namespace ascii
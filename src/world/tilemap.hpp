@@ -0,0 +1,158 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ascii {
+
+struct Tile {
+    uint32_t glyph = 0;        // Unicode codepoint, 0 = no tile
+    uint16_t material = 0;     // MaterialTable id
+    float height = 0.0f;       // Extrusion above the layer base
+
+    bool empty() const { return glyph == 0; }
+    bool operator==(const Tile& other) const {
+        return glyph == other.glyph && material == other.material && height == other.height;
+    }
+};
+
+// One tile an edit changed
+struct TileChange {
+    int layer = 0;
+    int x = 0;
+    int y = 0;
+    Tile before;
+    Tile after;
+};
+
+// First codepoint of a UTF-8 string (0 for an empty string). length, if
+// given, receives the bytes it took (invalid bytes decode as themselves).
+uint32_t decode_glyph(std::string_view text, size_t* length = nullptr);
+std::string encode_glyph(uint32_t glyph);
+
+// Layered 2D tile map stored as dense per-layer arrays (glyph, material,
+// height), split into CHUNK_SIZE x CHUNK_SIZE chunks. Every edit marks the
+// chunks it touches; the renderer re-emits only those (see TilemapRenderer).
+// Tile (x, y) lies at world (origin.x + x * tile_size, origin.z + y * tile_size);
+// a layer's tiles start at origin.y + layer_base.
+class Tilemap {
+public:
+    static constexpr int CHUNK_SIZE = 16;
+
+    void resize(int width, int height, int layers);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int layers() const { return static_cast<int>(m_layers.size()); }
+    int chunks_x() const { return m_chunks_x; }
+    int chunks_y() const { return m_chunks_y; }
+    int chunk_count() const { return m_chunks_x * m_chunks_y; }
+
+    glm::vec3 origin{0.0f};
+    float tile_size = 1.0f;
+
+    float layer_base(int layer) const { return m_layers[layer].base; }
+    void set_layer_base(int layer, float base);
+
+    bool in_bounds(int layer, int x, int y) const {
+        return layer >= 0 && layer < layers() && x >= 0 && x < m_width && y >= 0 && y < m_height;
+    }
+
+    // Out-of-bounds reads return an empty tile; out-of-bounds writes are ignored.
+    // Edits return the number of tiles that actually changed.
+    Tile get(int layer, int x, int y) const;
+    size_t set(int layer, int x, int y, const Tile& tile);
+    size_t fill_rect(int layer, int x, int y, int w, int h, const Tile& tile);
+
+    // 4-connected fill of the region matching the tile at (x, y)
+    size_t flood_fill(int layer, int x, int y, const Tile& tile);
+
+    // Stamp ASCII rows with (x, y) as the top-left corner. Glyphs missing
+    // from the legend are transparent and leave the map untouched.
+    size_t paste(int layer, int x, int y, const std::vector<std::string>& rows,
+                 const std::unordered_map<uint32_t, Tile>& legend);
+
+    // Raw layer columns, width() * height() tiles each in row-major order
+    const uint32_t* layer_glyphs(int layer) const { return m_layers[layer].glyph.data(); }
+    const uint16_t* layer_materials(int layer) const { return m_layers[layer].material.data(); }
+    const float* layer_heights(int layer) const { return m_layers[layer].height.data(); }
+
+    // Overwrite a whole layer from raw columns and mark every chunk dirty
+    void assign_layer(int layer, const uint32_t* glyphs, const uint16_t* materials, const float* heights);
+
+    // Dirty chunk tracking (shared by all layers)
+    bool has_dirty() const { return m_dirty_count > 0; }
+    size_t dirty_count() const { return m_dirty_count; }
+    bool chunk_dirty(int chunk) const { return m_dirty[chunk] != 0; }
+    void mark_all_dirty();
+
+    // Returns the dirty chunk indices (cy * chunks_x + cx) and clears them
+    std::vector<int> take_dirty_chunks();
+
+    // Edit stamps for readers other than the renderer: revision() grows with
+    // every edit and chunk_revision() is the revision of the last edit that
+    // touched the chunk, so a reader can find what changed since it looked
+    uint64_t revision() const { return m_revision; }
+    uint64_t chunk_revision(int chunk) const { return m_chunk_revision[chunk]; }
+
+    // While set, edits append every tile they change to out (edit history)
+    void record_changes(std::vector<TileChange>* out) { m_recorder = out; }
+
+    // Copy-on-write snapshot (play mode). Taking one copies nothing; the
+    // first edit that changes a chunk copies that chunk's tiles on every
+    // layer, and restore_snapshot() copies them back and marks them dirty.
+    // resize() and assign_layer() keep the whole map instead.
+    void begin_snapshot();
+    void restore_snapshot();
+    void commit_snapshot() { m_snapshot.reset(); }
+    bool snapshot_active() const { return m_snapshot != nullptr; }
+    size_t snapshot_bytes() const;
+
+private:
+    struct Layer {
+        std::vector<uint32_t> glyph;
+        std::vector<uint16_t> material;
+        std::vector<float> height;
+        float base = 0.0f;
+    };
+
+    struct Snapshot {
+        int width = 0;
+        int height = 0;
+        glm::vec3 origin{0.0f};
+        float tile_size = 1.0f;
+        std::vector<float> bases;
+        std::vector<uint32_t> slot_of;      // Chunk -> saved slot, sized on the first save
+        std::vector<int> chunks;            // Chunk of each saved slot
+        std::vector<Tile> tiles;            // CHUNK_SIZE^2 tiles per layer per saved slot
+        std::vector<Layer> whole;           // Every layer, once resize/assign_layer ran
+        bool has_whole = false;
+    };
+
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * m_width + x; }
+    bool write(Layer& layer, size_t i, const Tile& tile);
+    void save_chunk(size_t i);
+    void save_whole(bool keep_layers);
+    void mark_dirty(int x, int y);
+    void mark_dirty_rect(int x0, int y0, int x1, int y1);  // Inclusive
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_chunks_x = 0;
+    int m_chunks_y = 0;
+    std::vector<Layer> m_layers;
+    std::vector<uint8_t> m_dirty;
+    size_t m_dirty_count = 0;
+    std::vector<uint64_t> m_chunk_revision;
+    uint64_t m_revision = 0;
+    std::unique_ptr<Snapshot> m_snapshot;
+    std::vector<TileChange>* m_recorder = nullptr;
+};
+
+} // namespace ascii
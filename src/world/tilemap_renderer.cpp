@@ -0,0 +1,223 @@
+#include "tilemap_renderer.hpp"
+#include "renderer/material_table.hpp"
+#include "renderer/static_geometry.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace ascii {
+
+namespace {
+
+const glm::quat NO_ROTATION(1.0f, 0.0f, 0.0f, 0.0f);
+constexpr uint8_t VISIBLE_MASK = 0xFF;
+
+} // anonymous namespace
+
+TilemapRenderer::TilemapRenderer(AccelerationStructureManager& accel,
+                                 InstanceStore& instances,
+                                 uint32_t cube_blas,
+                                 Mode mode)
+    : m_accel(accel)
+    , m_instances(instances)
+    , m_cube_blas(cube_blas)
+    , m_mode(mode)
+{
+}
+
+uint32_t TilemapRenderer::triangle_count() const {
+    return std::accumulate(m_chunk_triangles.begin(), m_chunk_triangles.end(), 0u);
+}
+
+void TilemapRenderer::reset() {
+    release_chunks();
+    m_slots.clear();
+}
+
+// Chunk BLASes go to the free list; the slots stay owned
+void TilemapRenderer::release_chunks() {
+    for (uint32_t blas : m_chunk_blas) {
+        if (blas != NO_BLAS) {
+            m_free_blas.push_back(blas);
+        }
+    }
+    m_chunk_first.clear();
+    m_chunk_blas.clear();
+    m_chunk_triangles.clear();
+    m_chunks_x = m_chunks_y = m_layers = 0;
+}
+
+void TilemapRenderer::allocate_slots(const Tilemap& map) {
+    // Slots can't be removed from the instance store, so a resized map
+    // hides the ones it owns and reuses them before adding more
+    for (uint32_t slot : m_slots) {
+        m_instances.set_mask(slot, 0);
+    }
+    release_chunks();
+
+    m_chunks_x = map.chunks_x();
+    m_chunks_y = map.chunks_y();
+    m_layers = map.layers();
+    m_slots_per_chunk = m_mode == Mode::ChunkMeshes
+        ? 1u
+        : static_cast<uint32_t>(Tilemap::CHUNK_SIZE * Tilemap::CHUNK_SIZE * m_layers);
+
+    const int chunk_count = map.chunk_count();
+    m_chunk_first.assign(chunk_count, 0);
+    m_chunk_blas.assign(chunk_count, NO_BLAS);
+    m_chunk_triangles.assign(chunk_count, 0);
+
+    const size_t needed = static_cast<size_t>(chunk_count) * m_slots_per_chunk;
+    if (needed > m_slots.size()) {
+        m_instances.reserve(m_instances.size() + needed - m_slots.size());
+        m_slots.reserve(needed);
+        while (m_slots.size() < needed) {
+            uint32_t slot = m_instances.add(glm::vec3(0.0f), NO_ROTATION, glm::vec3(1.0f), m_cube_blas, 0);
+            m_instances.set_mask(slot, 0);
+            m_slots.push_back(slot);
+        }
+    }
+    for (int chunk = 0; chunk < chunk_count; chunk++) {
+        m_chunk_first[chunk] = static_cast<uint32_t>(chunk) * m_slots_per_chunk;
+        if (!m_free_blas.empty()) {
+            m_chunk_blas[chunk] = m_free_blas.back();
+            m_free_blas.pop_back();
+        }
+    }
+}
+
+bool TilemapRenderer::sync(Tilemap& map) {
+    m_chunks_rebuilt = 0;
+
+    bool layout_changed = false;
+    if (map.chunks_x() != m_chunks_x || map.chunks_y() != m_chunks_y || map.layers() != m_layers ||
+        m_chunk_first.size() != static_cast<size_t>(map.chunk_count())) {
+        allocate_slots(map);
+        map.mark_all_dirty();
+        layout_changed = true;
+    }
+    if (!map.has_dirty()) {
+        return layout_changed;
+    }
+
+    for (int chunk : map.take_dirty_chunks()) {
+        if (m_mode == Mode::ChunkMeshes) {
+            rebuild_chunk_mesh(map, chunk);
+        } else {
+            rebuild_chunk_cubes(map, chunk);
+        }
+        m_chunks_rebuilt++;
+    }
+
+    spdlog::debug("Tilemap: rebuilt {} chunks", m_chunks_rebuilt);
+    return true;
+}
+
+void TilemapRenderer::rebuild_chunk_mesh(const Tilemap& map, int chunk) {
+    const int cx = chunk % map.chunks_x();
+    const int cy = chunk / map.chunks_x();
+    const int x0 = cx * Tilemap::CHUNK_SIZE;
+    const int y0 = cy * Tilemap::CHUNK_SIZE;
+    const int w = std::min(Tilemap::CHUNK_SIZE, map.width() - x0);
+    const int h = std::min(Tilemap::CHUNK_SIZE, map.height() - y0);
+
+    // Vertical cells of the bake grid: every distinct tile bottom and top in
+    // the chunk, so tiles of any height map onto whole cells
+    std::vector<float> breaks;
+    for (int layer = 0; layer < map.layers(); layer++) {
+        const float base = map.layer_base(layer);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                Tile tile = map.get(layer, x0 + x, y0 + y);
+                if (!tile.empty() && tile.height > 0.0f) {
+                    breaks.push_back(base);
+                    breaks.push_back(base + tile.height);
+                }
+            }
+        }
+    }
+    std::sort(breaks.begin(), breaks.end());
+    breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+    const uint32_t slot = m_slots[m_chunk_first[chunk]];
+    if (breaks.size() < 2) {
+        // Nothing solid: hide the slot, keep the BLAS for later edits
+        m_instances.set_mask(slot, 0);
+        m_chunk_triangles[chunk] = 0;
+        return;
+    }
+
+    std::vector<float> heights(breaks.size() - 1);
+    for (size_t i = 0; i + 1 < breaks.size(); i++) {
+        heights[i] = breaks[i + 1] - breaks[i];
+    }
+
+    StaticTileGrid grid;
+    grid.resize(w, h, heights);
+    grid.origin = map.origin + glm::vec3(x0 * map.tile_size, breaks.front(), y0 * map.tile_size);
+    grid.cell_size = glm::vec2(map.tile_size);
+
+    for (int layer = 0; layer < map.layers(); layer++) {
+        const float base = map.layer_base(layer);
+        const int first = static_cast<int>(std::lower_bound(breaks.begin(), breaks.end(), base) - breaks.begin());
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                Tile tile = map.get(layer, x0 + x, y0 + y);
+                if (tile.empty() || tile.height <= 0.0f) {
+                    continue;
+                }
+                const float top = base + tile.height;
+                for (int cell = first; cell < grid.layers() && breaks[cell] < top; cell++) {
+                    grid.set(x, cell, y, tile.material);
+                }
+            }
+        }
+    }
+
+    // Faces on chunk borders are kept even when the neighbouring chunk is
+    // solid there; the mesher only sees this chunk
+    StaticMesh mesh = compile_static_geometry(grid);
+    if (m_chunk_blas[chunk] == NO_BLAS) {
+        m_chunk_blas[chunk] = m_accel.create_blas(mesh.vertices, mesh.indices, mesh.primitives);
+    } else {
+        m_accel.update_blas(m_chunk_blas[chunk], mesh.vertices, mesh.indices, mesh.primitives);
+    }
+    m_chunk_triangles[chunk] = mesh.triangle_count();
+
+    // Mesh is baked in world space
+    m_instances.set_blas(slot, m_chunk_blas[chunk]);
+    m_instances.set_mask(slot, VISIBLE_MASK);
+}
+
+void TilemapRenderer::rebuild_chunk_cubes(const Tilemap& map, int chunk) {
+    const int cx = chunk % map.chunks_x();
+    const int cy = chunk / map.chunks_x();
+    const uint32_t* slot = m_slots.data() + m_chunk_first[chunk];
+
+    for (int layer = 0; layer < map.layers(); layer++) {
+        const float base = map.origin.y + map.layer_base(layer);
+        for (int ty = 0; ty < Tilemap::CHUNK_SIZE; ty++) {
+            for (int tx = 0; tx < Tilemap::CHUNK_SIZE; tx++, slot++) {
+                const int x = cx * Tilemap::CHUNK_SIZE + tx;
+                const int y = cy * Tilemap::CHUNK_SIZE + ty;
+                Tile tile = map.get(layer, x, y);  // Empty past the map edge
+                if (tile.empty() || tile.height <= 0.0f) {
+                    m_instances.set_mask(*slot, 0);
+                    continue;
+                }
+
+                glm::vec3 center(map.origin.x + (x + 0.5f) * map.tile_size,
+                                 base + tile.height * 0.5f,
+                                 map.origin.z + (y + 0.5f) * map.tile_size);
+                m_instances.set_position(*slot, center);
+                m_instances.set_scale(*slot, glm::vec3(map.tile_size, tile.height, map.tile_size));
+                m_instances.set_custom_index(*slot, MaterialTable::custom_index(tile.material));
+                m_instances.set_mask(*slot, VISIBLE_MASK);
+            }
+        }
+    }
+}
+
+} // namespace ascii
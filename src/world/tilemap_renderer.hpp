@@ -0,0 +1,69 @@
+#pragma once
+
+#include "tilemap.hpp"
+#include "renderer/acceleration.hpp"
+#include "renderer/instance_store.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ascii {
+
+// Re-emits the dirty chunks of a Tilemap into the instance store.
+// Every chunk owns a fixed run of instance slots, allocated on the first
+// sync, so edits only rewrite slots in place and never reorder instances.
+// A resized map hands the runs out again and adds only the slots it needs
+// beyond those.
+//  - ChunkMeshes: one slot per chunk holding a greedy-merged mesh of all its
+//    layers (see compile_static_geometry), rebuilt with update_blas()
+//  - TileCubes: one cube slot per tile and layer (the unmerged path)
+// Unused slots are kept with mask 0 so rays never see them.
+class TilemapRenderer {
+public:
+    enum class Mode { ChunkMeshes, TileCubes };
+
+    TilemapRenderer(AccelerationStructureManager& accel,
+                    InstanceStore& instances,
+                    uint32_t cube_blas,
+                    Mode mode);
+
+    // Rebuild the chunks the map marked dirty. Returns true when instances
+    // changed and the TLAS has to be rebuilt.
+    bool sync(Tilemap& map);
+
+    // Forget the slots (call after clearing the instance store).
+    // Chunk BLASes are kept and reused by the next sync.
+    void reset();
+
+    Mode mode() const { return m_mode; }
+    uint32_t chunks_rebuilt() const { return m_chunks_rebuilt; }     // By the last sync
+    uint32_t triangle_count() const;                                  // Chunk meshes only
+
+private:
+    static constexpr uint32_t NO_BLAS = 0xFFFFFFFFu;
+
+    void release_chunks();
+    void allocate_slots(const Tilemap& map);
+    void rebuild_chunk_mesh(const Tilemap& map, int chunk);
+    void rebuild_chunk_cubes(const Tilemap& map, int chunk);
+
+    AccelerationStructureManager& m_accel;
+    InstanceStore& m_instances;
+    uint32_t m_cube_blas;
+    Mode m_mode;
+
+    // Slot layout the chunks were allocated for
+    int m_chunks_x = 0;
+    int m_chunks_y = 0;
+    int m_layers = 0;
+    uint32_t m_slots_per_chunk = 0;
+
+    std::vector<uint32_t> m_slots;                 // Instance slots added so far, hidden when unused
+    std::vector<uint32_t> m_chunk_first;           // Into m_slots; a chunk's slots follow it
+    std::vector<uint32_t> m_chunk_blas;            // ChunkMeshes: BLAS owned by the chunk (NO_BLAS until needed)
+    std::vector<uint32_t> m_chunk_triangles;
+    std::vector<uint32_t> m_free_blas;             // From chunks that no longer exist
+    uint32_t m_chunks_rebuilt = 0;
+};
+
+} // namespace ascii
@@ -62,6 +62,11 @@ function Type.define(name, definition)
   -- Preview renderer (optional - for thumbnail/card preview)
   t.preview = definition.preview
 
+  -- Packed native layout for the numeric fields (only when running in the engine)
+  if engine and engine.schema_compile then
+    t.native = engine.schema_compile(name, t.components)
+  end
+
   -- Register
   registry[name] = t
 
@@ -171,6 +176,15 @@ function Type:createInstance(overrides)
   return instance
 end
 
+-- Attach a native instance to a scene entity; fields of the returned view
+-- read and write the engine's packed columns. nil outside the engine.
+function Type:attach(entity, overrides)
+  if not (self.native and engine and engine.component_add) then
+    return nil
+  end
+  return engine.component_add(entity, self.name, overrides)
+end
+
 -- ─────────────────────────────────────────────────────────────────────────────
 -- Utilities
 -- ─────────────────────────────────────────────────────────────────────────────